@@ -902,8 +902,8 @@ generate_connections(const struct fbp_data *data)
         struct port_description *src_port_desc, *dst_port_desc;
 
         /* The graph is expected to be valid. */
-        assert(conn->src < data->graph.nodes.len);
-        assert(conn->dst < data->graph.nodes.len);
+        assert(conn->src < (int)data->graph.nodes.len);
+        assert(conn->dst < (int)data->graph.nodes.len);
 
         spec->src = conn->src;
         spec->dst = conn->dst;
@@ -1010,12 +1010,12 @@ generate_exports(const struct fbp_data *data)
 {
     struct sol_fbp_exported_port *e;
     struct type_description *n;
-    uint16_t i;
+    uint32_t i;
 
     if (data->graph.exported_in_ports.len > 0) {
         out("    static const struct sol_flow_static_port_spec exported_in[] = {\n");
         SOL_VECTOR_FOREACH_IDX (&data->graph.exported_in_ports, e, i) {
-            assert(e->node < data->graph.nodes.len);
+            assert(e->node < (int)data->graph.nodes.len);
             n = get_node_type_description(data, e->node);
             if (!generate_exported_port(n->name, &n->in_ports, e, data->filename))
                 return false;
@@ -1027,7 +1027,7 @@ generate_exports(const struct fbp_data *data)
     if (data->graph.exported_out_ports.len > 0) {
         out("    static const struct sol_flow_static_port_spec exported_out[] = {\n");
         SOL_VECTOR_FOREACH_IDX (&data->graph.exported_out_ports, e, i) {
-            assert(e->node < data->graph.nodes.len);
+            assert(e->node < (int)data->graph.nodes.len);
             n = get_node_type_description(data, e->node);
             if (!generate_exported_port(n->name, &n->out_ports, e, data->filename))
                 return false;
@@ -1403,7 +1403,8 @@ generate_memory_map_struct(const struct sol_ptr_vector *maps, int *elements)
     const struct sol_memmap_map *map;
     const struct sol_str_table_ptr *iter;
     const struct sol_memmap_entry *entry;
-    int i, entry_idx;
+    uint32_t i;
+    int entry_idx;
 
     *elements = 0;
 
@@ -152,7 +152,7 @@ load_memory_maps(const struct sol_ptr_vector *maps)
 {
 #ifdef USE_MEMMAP
     struct sol_memmap_map *map;
-    int i;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_IDX (maps, map, i) {
         if (sol_memmap_add_map(map) < 0)
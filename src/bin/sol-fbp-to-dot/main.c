@@ -171,7 +171,7 @@ convert_fbp_to_dot(struct sol_fbp_graph *g, const char *out)
      */
 
     SOL_VECTOR_FOREACH_IDX (&g->nodes, node, idx) {
-        int i;
+        uint32_t i;
         struct sol_fbp_port *port;
         uint32_t node_color = get_node_color(node);
         uint32_t input_color = darken_color(node_color);
@@ -0,0 +1,158 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Prints the binary log records saved with $SOL_LOG_BINARY_FILE as
+ * text, the same way sol_log_print_function_file() would.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sol-buffer.h"
+#include "sol-log-binary.h"
+#include "sol-log.h"
+#include "sol-mainloop.h"
+#include "sol-util-internal.h"
+
+static int
+print_record(const struct sol_log_binary_record *rec, struct sol_buffer *text, uint64_t main_thread, uint32_t main_pid)
+{
+    char level_str[4] = { 0 };
+    int len, r;
+
+    len = sol_log_binary_format(text->data, text->capacity, rec->format,
+        rec->args, rec->args_size);
+    if (len < 0)
+        return len;
+    if ((size_t)len >= text->capacity) {
+        r = sol_buffer_ensure(text, len + 1);
+        if (r < 0)
+            return r;
+        sol_log_binary_format(text->data, text->capacity, rec->format,
+            rec->args, rec->args_size);
+    }
+
+    sol_log_level_to_str(rec->level, level_str, sizeof(level_str));
+
+    if (rec->pid != main_pid)
+        printf("P:%" PRIu32 " ", rec->pid);
+    if (rec->thread != main_thread)
+        printf("T%" PRIu64 " ", rec->thread);
+
+    printf("%s:%s %s:%d %s() %s", level_str, rec->domain, rec->file,
+        rec->line, rec->function, (const char *)text->data);
+    if (len == 0 || ((const char *)text->data)[len - 1] != '\n')
+        putchar('\n');
+
+    return 0;
+}
+
+static int
+decode(FILE *fp, const char *name)
+{
+    struct sol_buffer storage = SOL_BUFFER_INIT_EMPTY;
+    struct sol_buffer text = SOL_BUFFER_INIT_EMPTY;
+    struct sol_log_binary_record rec;
+    uint64_t main_thread;
+    uint32_t main_pid;
+    int r;
+
+    r = sol_log_binary_read_header(fp, &main_thread, &main_pid);
+    if (r < 0) {
+        fprintf(stderr, "ERROR: %s: not a binary log file or from another architecture: %s\n",
+            name, sol_util_strerrora(-r));
+        return r;
+    }
+
+    r = sol_buffer_ensure(&text, 512);
+    if (r < 0)
+        goto end;
+
+    while ((r = sol_log_binary_read(fp, &storage, &rec)) == 0) {
+        r = print_record(&rec, &text, main_thread, main_pid);
+        if (r < 0)
+            fprintf(stderr, "ERROR: %s: could not format \"%s\": %s\n",
+                name, rec.format, sol_util_strerrora(-r));
+    }
+
+    if (r == -ENODATA)
+        r = 0;
+    else
+        fprintf(stderr, "ERROR: %s: truncated or corrupted record: %s\n",
+            name, sol_util_strerrora(-r));
+
+end:
+    sol_buffer_fini(&text);
+    sol_buffer_fini(&storage);
+    return r;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int i, r, result = EXIT_SUCCESS;
+
+    if (argc > 1 && (streq(argv[1], "-h") || streq(argv[1], "--help"))) {
+        printf("Usage:\n\t%s [file...]\n\n"
+            "Prints the log records saved with $SOL_LOG_BINARY_FILE, "
+            "from the standard input if no files or '-' are given.\n",
+            argv[0]);
+        return EXIT_SUCCESS;
+    }
+
+    /* don't truncate the file being decoded with our own records */
+    unsetenv("SOL_LOG_BINARY_FILE");
+    unsetenv("SOL_LOG_BINARY");
+
+    r = sol_init();
+    if (r < 0) {
+        fprintf(stderr, "ERROR: %s\n", sol_util_strerrora(-r));
+        return EXIT_FAILURE;
+    }
+
+    if (argc < 2 && decode(stdin, "<stdin>") < 0)
+        result = EXIT_FAILURE;
+
+    for (i = 1; i < argc; i++) {
+        FILE *fp;
+
+        if (streq(argv[i], "-")) {
+            if (decode(stdin, "<stdin>") < 0)
+                result = EXIT_FAILURE;
+            continue;
+        }
+
+        fp = fopen(argv[i], "re");
+        if (!fp) {
+            fprintf(stderr, "ERROR: could not open %s: %s\n", argv[i],
+                sol_util_strerrora(errno));
+            result = EXIT_FAILURE;
+            continue;
+        }
+
+        if (decode(fp, argv[i]) < 0)
+            result = EXIT_FAILURE;
+        fclose(fp);
+    }
+
+    sol_shutdown();
+    return result;
+}
@@ -21,6 +21,7 @@
 #include "sol-common-buildopts.h"
 
 #include "sol-macros.h"
+#include <errno.h>
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdarg.h>
@@ -569,6 +570,14 @@ sol_log_domain_init_level(struct sol_log_domain *domain)
  *      function name in output. Enabled by default.
  * @li @c $SOL_LOG_SHOW_LINE=[0|1] will disable or enable the line
  *       number in output. Enabled by default.
+ * @li @c $SOL_LOG_ASYNC=[0|1] will disable or enable writing messages
+ *       from a separate thread, see sol_log_set_async(). Disabled by
+ *       default.
+ * @li @c $SOL_LOG_BINARY=[0|1] will disable or enable deferred
+ *       formatting, see sol_log_set_binary(). Disabled by default.
+ * @li @c $SOL_LOG_BINARY_FILE=PATH will save messages to @c PATH as
+ *       binary records, to be read with @c sol-log-decode, instead of
+ *       printing them. Implies @c $SOL_LOG_BINARY=1.
  *
  * @note use the SOL_LOG(), SOL_CRI(), SOL_ERR(), SOL_WRN(), SOL_INF() or
  *       SOL_DBG() macros instead of this one, it should be easier to
@@ -858,6 +867,81 @@ sol_log_print_function_journal(void *data, const struct sol_log_domain *domain,
  * @param enabled Enables line number output if @c true, disables if @c false
  */
 
+/**
+ * @fn int sol_log_set_async(bool enabled)
+ *
+ * @brief Enable/Disables writing log messages from a separate thread.
+ *
+ * When enabled, messages are still formatted by the thread calling
+ * sol_log_print(), but are queued and handed to the print function by
+ * a writer thread, so slow outputs such as files or the journal don't
+ * stall the caller. Messages keep their order and the thread that
+ * originated them. Messages that trigger an abort, as set by
+ * sol_log_set_abort_level(), are always printed synchronously, after
+ * the queued ones.
+ *
+ * The queue is bounded: if the writer can't keep up, new messages are
+ * dropped and counted, see sol_log_get_async_dropped().
+ *
+ * @param enabled Enables the writer thread if @c true, disables it
+ *        (after writing the queued messages) if @c false
+ *
+ * @return @c 0 on success, @c -ENOTSUP if not supported by the
+ *         platform or other negative error code on failure.
+ */
+
+/**
+ * @fn bool sol_log_get_async(void)
+ *
+ * @brief Get if log messages are written from a separate thread.
+ *
+ * @return @c true if enabled, @c false otherwise
+ */
+
+/**
+ * @fn uint64_t sol_log_get_async_dropped(void)
+ *
+ * @brief Get the number of messages dropped because the asynchronous
+ * writer could not keep up.
+ *
+ * @return number of dropped messages since the initialization
+ */
+
+/**
+ * @fn int sol_log_set_binary(bool enabled)
+ *
+ * @brief Enable/Disables deferred formatting of log messages.
+ *
+ * When enabled, the thread calling sol_log_print() doesn't format the
+ * message: the format pointer and a copy of the arguments, including
+ * the contents of strings, are queued instead, and the message is
+ * formatted by the writer thread, which is started if needed (see
+ * sol_log_set_async()). If @c $SOL_LOG_BINARY_FILE is set, messages
+ * aren't formatted at all, but saved as binary records to be read
+ * later with @c sol-log-decode.
+ *
+ * Formats that can't be deferred, like those using positional
+ * arguments or @c %m, are formatted right away.
+ *
+ * @note the format, file and function strings given to
+ *       sol_log_print() must stay valid until the message is written,
+ *       which is the case of string literals.
+ *
+ * @param enabled Enables deferred formatting if @c true, disables it if
+ *        @c false
+ *
+ * @return @c 0 on success, @c -ENOTSUP if not supported by the
+ *         platform or other negative error code on failure.
+ */
+
+/**
+ * @fn bool sol_log_get_binary(void)
+ *
+ * @brief Get if formatting of log messages is deferred.
+ *
+ * @return @c true if enabled, @c false otherwise
+ */
+
 #ifdef SOL_LOG_ENABLED
 /*
  * Those implementing custom logging functions may use the following getters
@@ -870,6 +954,9 @@ bool sol_log_get_show_colors(void);
 bool sol_log_get_show_file(void);
 bool sol_log_get_show_function(void);
 bool sol_log_get_show_line(void);
+bool sol_log_get_async(void);
+uint64_t sol_log_get_async_dropped(void);
+bool sol_log_get_binary(void);
 
 /*
  * To force some logging setting independent of platform initializations,
@@ -881,6 +968,8 @@ void sol_log_set_show_colors(bool enabled);
 void sol_log_set_show_file(bool enabled);
 void sol_log_set_show_function(bool enabled);
 void sol_log_set_show_line(bool enabled);
+int sol_log_set_async(bool enabled);
+int sol_log_set_binary(bool enabled);
 #else
 static inline void
 sol_log_level_to_str(uint8_t level, char *buf, size_t buflen)
@@ -945,6 +1034,31 @@ static inline void
 sol_log_set_show_line(bool enabled)
 {
 }
+static inline bool
+sol_log_get_async(void)
+{
+    return false;
+}
+static inline uint64_t
+sol_log_get_async_dropped(void)
+{
+    return 0;
+}
+static inline int
+sol_log_set_async(bool enabled)
+{
+    return enabled ? -ENOTSUP : 0;
+}
+static inline bool
+sol_log_get_binary(void)
+{
+    return false;
+}
+static inline int
+sol_log_set_binary(bool enabled)
+{
+    return enabled ? -ENOTSUP : 0;
+}
 #endif
 
 /**
@@ -0,0 +1,137 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <inttypes.h>
+
+#include "sol-common-buildopts.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file
+ * @brief These routines are used to run short jobs on a pool of worker threads.
+ */
+
+/**
+ * @defgroup TaskPool Task Pool
+ *
+ * @brief A fixed set of worker threads running tasks submitted from
+ * the main thread.
+ *
+ * Spawning a worker thread (sol_worker_thread_new()) per job is
+ * expensive for short jobs, like computing a digest or encoding a
+ * blob. A task pool keeps its threads around: each one has its own
+ * queue of tasks and takes tasks from the others when it runs out of
+ * work. Completion callbacks are delivered on the main thread, as
+ * many of them as finished at once, from a single main loop wake up.
+ *
+ * @note Only available on Linux.
+ *
+ * @{
+ */
+
+struct sol_task_pool;
+
+struct sol_task;
+
+/**
+ * @brief Task pool configuration.
+ */
+struct sol_task_pool_config {
+#ifndef SOL_NO_API_VERSION
+#define SOL_TASK_POOL_CONFIG_API_VERSION (1)
+    /** must match SOL_TASK_POOL_CONFIG_API_VERSION in runtime */
+    uint16_t api_version;
+#endif
+    /** number of worker threads, @c 0 for one per online CPU */
+    unsigned int threads;
+};
+
+/**
+ * @brief Create a task pool and start its threads.
+ *
+ * @param config the pool configuration, may be @c NULL for the defaults.
+ *
+ * @return a new pool or @c NULL on errors.
+ */
+struct sol_task_pool *sol_task_pool_new(const struct sol_task_pool_config *config);
+
+/**
+ * @brief Stop and delete a task pool.
+ *
+ * Waits for the tasks being run, then calls the @c done callback of
+ * every task not delivered yet: with the status returned by @c work
+ * for the ones that ran and with @c -ECANCELED for the others.
+ *
+ * @param pool the pool to be deleted.
+ */
+void sol_task_pool_del(struct sol_task_pool *pool);
+
+/**
+ * @brief Submit a task to a pool.
+ *
+ * Must be called from the main thread.
+ *
+ * @param pool the pool to run the task.
+ * @param work function to be called from one of the @b worker threads.
+ * Its return value is given to @a done as status. Must not be @c NULL.
+ * @param done function to be called from the @b main thread once @a
+ * work returns or the task is cancelled (with @c -ECANCELED as status).
+ * It's always called exactly once. May be @c NULL.
+ * @param data the context data given to @a work and @a done.
+ *
+ * @return a handle to the task, valid until @a done is called, or @c
+ * NULL on errors.
+ */
+struct sol_task *sol_task_pool_submit(struct sol_task_pool *pool, int (*work)(void *data), void (*done)(void *data, int status), const void *data);
+
+/**
+ * @brief Cancel a task that didn't start yet.
+ *
+ * Its @c done callback is still called, with @c -ECANCELED as status,
+ * along with the next completed tasks.
+ *
+ * @param pool the pool the task was submitted to.
+ * @param task the task to be cancelled.
+ *
+ * @return @c 0 on success, @c -EBUSY if the task is already running or
+ * done.
+ */
+int sol_task_pool_cancel(struct sol_task_pool *pool, struct sol_task *task);
+
+/**
+ * @brief Number of threads of a pool.
+ *
+ * @param pool the pool.
+ *
+ * @return the number of worker threads running tasks for @a pool.
+ */
+unsigned int sol_task_pool_get_thread_count(const struct sol_task_pool *pool);
+
+/**
+ * @}
+ */
+
+#ifdef __cplusplus
+}
+#endif
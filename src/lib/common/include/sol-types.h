@@ -521,6 +521,122 @@ void sol_blob_unref(struct sol_blob *blob);
  */
 void sol_blob_set_parent(struct sol_blob *blob, struct sol_blob *parent);
 
+/**
+ * @brief Creates a blob for a range of another blob, without copying.
+ *
+ * The new blob points inside @a blob's memory and holds a reference
+ * to it, so that memory stays valid while the slice is alive.
+ *
+ * @param blob The blob to slice
+ * @param offset Where the slice starts, in bytes from the start of @a blob
+ * @param size Slice size, @a offset plus @a size must be within @a blob
+ *
+ * @return A new blob instance (to be released with sol_blob_unref()) or
+ * @c NULL on errors, with @c errno set to @c EINVAL if the range is out
+ * of @a blob or @c ENOMEM.
+ */
+struct sol_blob *sol_blob_slice(struct sol_blob *blob, size_t offset, size_t size);
+
+/**
+ * @brief A sequence of blobs to be handled as a single piece of data,
+ * like the @c iovec arrays of @c writev(2) and @c sendmsg(2).
+ *
+ * Chains hold a reference to each of their blobs, so parts of
+ * different messages (like a header and a payload) can be put together
+ * without copying them.
+ *
+ * @see sol_blob_chain_append()
+ * @see sol_blob_chain_flatten()
+ */
+struct sol_blob_chain {
+    struct sol_ptr_vector blobs; /**< @brief The blobs, in order */
+    size_t size; /**< @brief Sum of the sizes of all blobs */
+};
+
+/**
+ * @brief Helper macro to initialize an empty blob chain.
+ */
+#define SOL_BLOB_CHAIN_INIT { .blobs = SOL_PTR_VECTOR_INIT, .size = 0 }
+
+/**
+ * @brief Initializes an empty blob chain.
+ *
+ * @param chain The chain
+ */
+void sol_blob_chain_init(struct sol_blob_chain *chain);
+
+/**
+ * @brief Appends a blob to the end of the chain.
+ *
+ * A reference to @a blob is taken.
+ *
+ * @param chain The chain
+ * @param blob The blob to append
+ *
+ * @return @c 0 on success, error code (always negative) otherwise.
+ */
+int sol_blob_chain_append(struct sol_blob_chain *chain, struct sol_blob *blob);
+
+/**
+ * @brief Appends a range of a blob to the end of the chain.
+ *
+ * Same as creating the slice with sol_blob_slice() and appending it,
+ * but the whole @a blob is used when the range covers it.
+ *
+ * @param chain The chain
+ * @param blob The blob
+ * @param offset Where the range starts
+ * @param size Range size
+ *
+ * @return @c 0 on success, error code (always negative) otherwise.
+ */
+int sol_blob_chain_append_slice(struct sol_blob_chain *chain, struct sol_blob *blob, size_t offset, size_t size);
+
+/**
+ * @brief Releases the references to all blobs in the chain and empties it.
+ *
+ * @param chain The chain
+ */
+void sol_blob_chain_clear(struct sol_blob_chain *chain);
+
+/**
+ * @brief Puts the contents of the chain in a single blob.
+ *
+ * Data is only copied if the chain has more than one blob, otherwise
+ * a new reference to that blob is returned. Empty chains result in an
+ * empty blob.
+ *
+ * @param chain The chain
+ *
+ * @return A blob (to be released with sol_blob_unref()) or @c NULL on
+ * errors.
+ */
+struct sol_blob *sol_blob_chain_flatten(const struct sol_blob_chain *chain);
+
+/**
+ * @brief Returns the number of blobs in the chain.
+ *
+ * @param chain The chain
+ *
+ * @return The number of blobs
+ */
+static inline uint32_t
+sol_blob_chain_get_len(const struct sol_blob_chain *chain)
+{
+    return sol_ptr_vector_get_len(&chain->blobs);
+}
+
+/**
+ * @def SOL_BLOB_CHAIN_FOREACH_IDX(chain, itrvar, idx)
+ * @brief Macro to iterate over the blobs of a chain.
+ *
+ * @param chain The chain
+ * @param itrvar Variable pointing to the current blob
+ * @param idx Variable used as the loop counter
+ */
+#define SOL_BLOB_CHAIN_FOREACH_IDX(chain, itrvar, idx) \
+    SOL_PTR_VECTOR_FOREACH_IDX (&(chain)->blobs, itrvar, idx)
+
 /**
  * @brief Data type to describe <key, value> pairs of strings.
  */
@@ -17,6 +17,7 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 
 #define SOL_LOG_DOMAIN &_sol_blob_log_domain
@@ -158,6 +159,119 @@ sol_blob_set_parent(struct sol_blob *blob, struct sol_blob *parent)
     blob->parent = parent;
 }
 
+SOL_API struct sol_blob *
+sol_blob_slice(struct sol_blob *blob, size_t offset, size_t size)
+{
+    struct sol_blob *slice;
+
+    SOL_BLOB_CHECK(blob, NULL);
+
+    if (offset > blob->size || size > blob->size - offset) {
+        SOL_WRN("Slice of %zu bytes at %zu out of blob %p of %zu bytes",
+            size, offset, blob, blob->size);
+        errno = EINVAL;
+        return NULL;
+    }
+
+    slice = sol_blob_new(SOL_BLOB_TYPE_NO_FREE, blob,
+        (char *)blob->mem + offset, size);
+    if (!slice)
+        errno = ENOMEM;
+    return slice;
+}
+
+SOL_API void
+sol_blob_chain_init(struct sol_blob_chain *chain)
+{
+    SOL_NULL_CHECK(chain);
+
+    sol_ptr_vector_init(&chain->blobs);
+    chain->size = 0;
+}
+
+SOL_API int
+sol_blob_chain_append(struct sol_blob_chain *chain, struct sol_blob *blob)
+{
+    int r;
+
+    SOL_NULL_CHECK(chain, -EINVAL);
+    SOL_BLOB_CHECK(blob, -EINVAL);
+
+    r = sol_ptr_vector_append(&chain->blobs, blob);
+    SOL_INT_CHECK(r, < 0, r);
+
+    if (!sol_blob_ref(blob)) {
+        sol_ptr_vector_del_last(&chain->blobs);
+        return -errno;
+    }
+
+    chain->size += blob->size;
+    return 0;
+}
+
+SOL_API int
+sol_blob_chain_append_slice(struct sol_blob_chain *chain, struct sol_blob *blob, size_t offset, size_t size)
+{
+    struct sol_blob *slice;
+    int r;
+
+    SOL_NULL_CHECK(chain, -EINVAL);
+    SOL_BLOB_CHECK(blob, -EINVAL);
+
+    if (offset == 0 && size == blob->size)
+        return sol_blob_chain_append(chain, blob);
+
+    slice = sol_blob_slice(blob, offset, size);
+    SOL_NULL_CHECK(slice, -errno);
+
+    r = sol_blob_chain_append(chain, slice);
+    sol_blob_unref(slice);
+    return r;
+}
+
+SOL_API void
+sol_blob_chain_clear(struct sol_blob_chain *chain)
+{
+    struct sol_blob *blob;
+    uint32_t i;
+
+    SOL_NULL_CHECK(chain);
+
+    SOL_BLOB_CHAIN_FOREACH_IDX (chain, blob, i)
+        sol_blob_unref(blob);
+    sol_ptr_vector_clear(&chain->blobs);
+    chain->size = 0;
+}
+
+SOL_API struct sol_blob *
+sol_blob_chain_flatten(const struct sol_blob_chain *chain)
+{
+    struct sol_blob *blob, *flat;
+    char *mem, *p;
+    uint32_t i;
+
+    SOL_NULL_CHECK(chain, NULL);
+
+    if (sol_blob_chain_get_len(chain) == 1)
+        return sol_blob_ref(sol_ptr_vector_get_no_check(&chain->blobs, 0));
+
+    if (!chain->size)
+        return sol_blob_new(SOL_BLOB_TYPE_DEFAULT, NULL, NULL, 0);
+
+    mem = malloc(chain->size);
+    SOL_NULL_CHECK(mem, NULL);
+
+    p = mem;
+    SOL_BLOB_CHAIN_FOREACH_IDX (chain, blob, i) {
+        memcpy(p, blob->mem, blob->size);
+        p += blob->size;
+    }
+
+    flat = sol_blob_new(SOL_BLOB_TYPE_DEFAULT, NULL, mem, chain->size);
+    if (!flat)
+        free(mem);
+    return flat;
+}
 
 static void
 blob_free(struct sol_blob *blob)
@@ -87,7 +87,7 @@ sol_cert_load_from_file(const char *filename)
 {
     struct sol_cert *cert;
     char *path;
-    int idx;
+    uint32_t idx;
     int r;
 
     SOL_NULL_CHECK(filename, NULL);
@@ -0,0 +1,515 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sol-log-binary.h"
+#include "sol-log-impl.h"
+#include "sol-util-internal.h"
+
+/*
+ * Asynchronous log writer.
+ *
+ * Callers format their message right away, in their own thread, into a
+ * slot of a bounded ring shared by all threads. Slots are claimed with
+ * a compare-and-swap on the ring head and published by bumping their
+ * sequence number, thus producers never take a lock (see Dmitry
+ * Vyukov's bounded MPMC queue, here with a single consumer). A writer
+ * thread takes records in order and hands them to the current print
+ * function. If the ring is full, messages are dropped and counted.
+ *
+ * In binary mode, callers don't even format their messages: the
+ * format pointer and the raw arguments are stored in the slot (see
+ * sol-log-binary.h) and the writer formats them, or saves them as they
+ * are to a file, to be decoded by sol-log-decode.
+ */
+
+/* must be a power of 2 */
+#define RING_SLOTS 512
+#define RING_MASK (RING_SLOTS - 1)
+
+/* messages longer than this are copied to the heap */
+#define RECORD_TEXT_SIZE 216
+
+struct log_record {
+    uint64_t seq;
+    const struct sol_log_domain *domain;
+    const char *file;
+    const char *function;
+    char *text;
+    const char *format; /* if set, inline_text has its packed arguments */
+    size_t args_size;
+    pthread_t thread;
+    int line;
+    uint8_t level;
+    char inline_text[RECORD_TEXT_SIZE];
+};
+
+struct log_ring {
+    uint64_t head; /* next slot to be claimed by producers */
+    uint64_t tail; /* next slot to be written out */
+    uint64_t dropped;
+    uint64_t reported; /* drops already reported by the writer */
+    struct log_record records[RING_SLOTS];
+};
+
+static struct log_ring *_ring;
+static pid_t _ring_pid;
+static bool _accepting;
+
+static pthread_t _writer;
+static bool _writer_running;
+static bool _stopping;
+static bool _sleeping;
+static pthread_mutex_t _sleep_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _sleep_cond = PTHREAD_COND_INITIALIZER;
+/* broadcast by the writer each time it catches up with the ring */
+static pthread_cond_t _flushed_cond = PTHREAD_COND_INITIALIZER;
+
+static bool _binary;
+static FILE *_binary_fp;
+/* origin of the record being written, only set in the writer thread */
+static __thread pthread_t _writing_origin;
+
+static void
+_wake_writer(void)
+{
+    pthread_mutex_lock(&_sleep_lock);
+    pthread_cond_signal(&_sleep_cond);
+    pthread_mutex_unlock(&_sleep_lock);
+}
+
+SOL_ATTR_PRINTF(6, 7)
+static void
+_call_print_function(const struct sol_log_domain *domain, uint8_t level, const char *file, const char *function, int line, const char *format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    _print_function((void *)_print_function_data,
+        domain, level, file, function, line, format, args);
+    va_end(args);
+}
+
+static void
+_write_binary(const struct log_record *rec, const char *format, const void *args, size_t args_size)
+{
+    struct sol_log_binary_record binary = {
+        .domain = rec->domain->name,
+        .file = rec->file,
+        .function = rec->function,
+        .format = format,
+        .args = args,
+        .args_size = args_size,
+        .thread = (uint64_t)(uintptr_t)rec->thread,
+        .pid = _ring_pid,
+        .line = rec->line,
+        .level = rec->level,
+    };
+
+    /* nowhere to report errors to */
+    sol_log_binary_write(_binary_fp, &binary);
+}
+
+/* Returns the message formatted in @a buf or, if it's too long, in
+ * @a *heap, to be freed.
+ */
+static const char *
+_format_packed(const struct log_record *rec, char *buf, size_t size, char **heap)
+{
+    int len;
+
+    len = sol_log_binary_format(buf, size, rec->format, rec->inline_text,
+        rec->args_size);
+    if (len < 0)
+        return rec->format;
+    if ((size_t)len < size)
+        return buf;
+
+    *heap = malloc(len + 1);
+    if (!*heap)
+        return buf;
+    sol_log_binary_format(*heap, len + 1, rec->format, rec->inline_text,
+        rec->args_size);
+    return *heap;
+}
+
+static void
+_write_record(struct log_record *rec)
+{
+    const char *text = rec->text ? rec->text : rec->inline_text;
+    char buf[512], *heap = NULL;
+
+    if (_binary_fp) {
+        if (rec->format)
+            _write_binary(rec, rec->format, rec->inline_text, rec->args_size);
+        else
+            _write_binary(rec, "%s", text, strlen(text) + 1);
+        return;
+    }
+
+    if (rec->format)
+        text = _format_packed(rec, buf, sizeof(buf), &heap);
+
+    if (sol_log_impl_lock()) {
+        _writing_origin = rec->thread;
+        _call_print_function(rec->domain, rec->level, rec->file, rec->function,
+            rec->line, "%s", text);
+        _writing_origin = 0;
+        sol_log_impl_unlock();
+    }
+
+    free(heap);
+}
+
+static void
+_write_dropped(uint64_t count)
+{
+    struct log_record rec = {
+        .domain = &_global_domain,
+        .file = __FILE__,
+        .function = __PRETTY_FUNCTION__,
+        .line = __LINE__,
+        .level = SOL_LOG_LEVEL_WARNING,
+        .thread = pthread_self(),
+    };
+
+    snprintf(rec.inline_text, sizeof(rec.inline_text),
+        "%" PRIu64 " log messages dropped, writer could not keep up", count);
+    _write_record(&rec);
+}
+
+/* Returns false if the ring is empty or the next record is still
+ * being formatted.
+ */
+static bool
+_write_next(struct log_ring *ring)
+{
+    struct log_record *rec = &ring->records[ring->tail & RING_MASK];
+
+    if (__atomic_load_n(&rec->seq, __ATOMIC_SEQ_CST) != ring->tail + 1)
+        return false;
+
+    _write_record(rec);
+    free(rec->text);
+    rec->text = NULL;
+
+    /* give the slot back to producers, one lap ahead */
+    __atomic_store_n(&rec->seq, ring->tail + RING_SLOTS, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
+
+static void *
+_writer_main(void *data)
+{
+    struct log_ring *ring = data;
+    uint64_t dropped;
+
+    while (true) {
+        while (_write_next(ring))
+            ;
+
+        dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if (dropped != ring->reported) {
+            _write_dropped(dropped - ring->reported);
+            ring->reported = dropped;
+        }
+
+        if (_binary_fp)
+            fflush(_binary_fp);
+
+        pthread_mutex_lock(&_sleep_lock);
+        pthread_cond_broadcast(&_flushed_cond);
+        if (_stopping && ring->tail == __atomic_load_n(&ring->head, __ATOMIC_SEQ_CST)) {
+            pthread_mutex_unlock(&_sleep_lock);
+            break;
+        }
+
+        __atomic_store_n(&_sleeping, true, __ATOMIC_SEQ_CST);
+        /* producers check _sleeping after publishing, so either they
+         * see it set and wake us or we see their record here
+         */
+        if (!_stopping && __atomic_load_n(&ring->records[ring->tail & RING_MASK].seq,
+            __ATOMIC_SEQ_CST) != ring->tail + 1)
+            pthread_cond_wait(&_sleep_cond, &_sleep_lock);
+        __atomic_store_n(&_sleeping, false, __ATOMIC_SEQ_CST);
+        pthread_mutex_unlock(&_sleep_lock);
+    }
+
+    return NULL;
+}
+
+static int
+_writer_start(void)
+{
+    sigset_t all, old;
+    int r;
+
+    if (!_ring) {
+        uint32_t i;
+
+        _ring = calloc(1, sizeof(*_ring));
+        if (!_ring)
+            return -ENOMEM;
+        for (i = 0; i < RING_SLOTS; i++)
+            _ring->records[i].seq = i;
+    }
+
+    _stopping = false;
+    _ring_pid = getpid();
+
+    /* signals are for the main thread to handle */
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK, &all, &old);
+    r = pthread_create(&_writer, NULL, _writer_main, _ring);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (r)
+        return -r;
+
+    _writer_running = true;
+    __atomic_store_n(&_accepting, true, __ATOMIC_SEQ_CST);
+
+    return 0;
+}
+
+static void
+_writer_stop(void)
+{
+    /* the ring itself is kept: producers that saw _accepting set may
+     * still be writing to it, the records they publish are written
+     * out before the writer exits or by the next one.
+     */
+    __atomic_store_n(&_accepting, false, __ATOMIC_SEQ_CST);
+
+    pthread_mutex_lock(&_sleep_lock);
+    _stopping = true;
+    pthread_cond_signal(&_sleep_cond);
+    pthread_mutex_unlock(&_sleep_lock);
+
+    pthread_join(_writer, NULL);
+    _writer_running = false;
+}
+
+int
+sol_log_impl_async_set(bool enabled)
+{
+    if (enabled == _writer_running)
+        return 0;
+
+    if (enabled)
+        return _writer_start();
+
+    _writer_stop();
+    return 0;
+}
+
+bool
+sol_log_impl_async_get(void)
+{
+    return _writer_running;
+}
+
+uint64_t
+sol_log_impl_async_get_dropped(void)
+{
+    if (!_ring)
+        return 0;
+    return __atomic_load_n(&_ring->dropped, __ATOMIC_RELAXED);
+}
+
+void
+sol_log_impl_async_set_binary(bool enabled)
+{
+    __atomic_store_n(&_binary, enabled, __ATOMIC_RELAXED);
+}
+
+bool
+sol_log_impl_async_get_binary(void)
+{
+    return __atomic_load_n(&_binary, __ATOMIC_RELAXED);
+}
+
+int
+sol_log_impl_async_set_binary_file(const char *path)
+{
+    FILE *fp;
+    int r;
+
+    /* the writer thread owns the file */
+    if (_writer_running)
+        return -EBUSY;
+
+    fp = fopen(path, "we");
+    if (!fp)
+        return -errno;
+
+    r = sol_log_binary_write_header(fp, (uint64_t)(uintptr_t)pthread_self(),
+        getpid());
+    if (r < 0) {
+        fclose(fp);
+        return r;
+    }
+
+    if (_binary_fp)
+        fclose(_binary_fp);
+    _binary_fp = fp;
+
+    return 0;
+}
+
+bool
+sol_log_impl_async_get_origin(pthread_t *thread)
+{
+    if (!_writing_origin)
+        return false;
+
+    *thread = _writing_origin;
+    return true;
+}
+
+bool
+sol_log_impl_async_print(const struct sol_log_domain *domain, uint8_t message_level, const char *file, const char *function, int line, const char *format, va_list args)
+{
+    struct log_ring *ring;
+    struct log_record *rec;
+    uint64_t pos, seq;
+    ssize_t packed;
+    va_list copy;
+    int len;
+
+    if (!__atomic_load_n(&_accepting, __ATOMIC_ACQUIRE))
+        return false;
+
+    /* the writer thread doesn't survive fork(), nor should the child
+     * write its parent's records
+     */
+    if (getpid() != _ring_pid)
+        return false;
+
+    /* print functions must not log, but don't deadlock if they do */
+    if (pthread_equal(pthread_self(), _writer))
+        return false;
+
+    ring = _ring;
+    pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    while (true) {
+        rec = &ring->records[pos & RING_MASK];
+        seq = __atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE);
+        if (seq == pos) {
+            if (__atomic_compare_exchange_n(&ring->head, &pos, pos + 1, true,
+                __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (seq < pos) {
+            /* slot from the previous lap is still to be written */
+            __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+            return true;
+        } else
+            pos = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+    }
+
+    rec->domain = domain;
+    rec->file = file;
+    rec->function = function;
+    rec->line = line;
+    rec->level = message_level;
+    rec->thread = pthread_self();
+    rec->text = NULL;
+    rec->format = NULL;
+
+    if (__atomic_load_n(&_binary, __ATOMIC_RELAXED)) {
+        va_copy(copy, args);
+        packed = sol_log_binary_pack(rec->inline_text, sizeof(rec->inline_text),
+            format, copy);
+        va_end(copy);
+        if (packed >= 0) {
+            rec->format = format;
+            rec->args_size = packed;
+        }
+    }
+
+    if (!rec->format) {
+        va_copy(copy, args);
+        len = vsnprintf(rec->inline_text, sizeof(rec->inline_text), format, copy);
+        va_end(copy);
+        if (len >= (int)sizeof(rec->inline_text)) {
+            rec->text = malloc(len + 1);
+            /* if it fails, the message is truncated */
+            if (rec->text)
+                vsnprintf(rec->text, len + 1, format, args);
+        } else if (len < 0)
+            rec->inline_text[0] = '\0';
+    }
+
+    __atomic_store_n(&rec->seq, pos + 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&_sleeping, __ATOMIC_SEQ_CST))
+        _wake_writer();
+
+    return true;
+}
+
+void
+sol_log_impl_async_flush(void)
+{
+    uint64_t head;
+
+    if (!__atomic_load_n(&_accepting, __ATOMIC_ACQUIRE) ||
+        getpid() != _ring_pid || pthread_equal(pthread_self(), _writer))
+        return;
+
+    head = __atomic_load_n(&_ring->head, __ATOMIC_SEQ_CST);
+    pthread_mutex_lock(&_sleep_lock);
+    while (__atomic_load_n(&_ring->tail, __ATOMIC_ACQUIRE) < head) {
+        pthread_cond_signal(&_sleep_cond);
+        pthread_cond_wait(&_flushed_cond, &_sleep_lock);
+    }
+    pthread_mutex_unlock(&_sleep_lock);
+}
+
+void
+sol_log_impl_async_shutdown(void)
+{
+    uint64_t i;
+
+    if (_writer_running)
+        _writer_stop();
+
+    if (!_ring)
+        return;
+
+    /* published after the writer was stopped */
+    for (i = _ring->tail; i < _ring->head; i++)
+        free(_ring->records[i & RING_MASK].text);
+
+    free(_ring);
+    _ring = NULL;
+
+    if (_binary_fp) {
+        fclose(_binary_fp);
+        _binary_fp = NULL;
+    }
+    _binary = false;
+}
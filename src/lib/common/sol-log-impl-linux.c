@@ -28,6 +28,7 @@
 #include <systemd/sd-journal.h>
 #endif
 
+#include "sol-buffer.h"
 #include "sol-log-impl.h"
 #include "sol-util-file.h"
 #include "sol-util-internal.h"
@@ -38,6 +39,24 @@ static pid_t _main_pid;
 #include <pthread.h>
 static pthread_t _main_thread;
 static pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t
+_thread_self(void)
+{
+#ifdef LOG_ASYNC
+    pthread_t origin;
+
+    /* messages written by the async writer carry their own thread */
+    if (sol_log_impl_async_get_origin(&origin))
+        return origin;
+#endif
+    return pthread_self();
+}
+#endif
+
+#ifdef LOG_ASYNC
+static bool _async;
+static bool _binary;
 #endif
 
 static bool
@@ -130,6 +149,10 @@ _kcmdline_parse_var(const char *start, size_t len)
         SPEC("SHOW_FILE", &_show_file, _bool_parse_wrapper),
         SPEC("SHOW_FUNCTION", &_show_function, _bool_parse_wrapper),
         SPEC("SHOW_LINE", &_show_line, _bool_parse_wrapper),
+#ifdef LOG_ASYNC
+        SPEC("ASYNC", &_async, _bool_parse_wrapper),
+        SPEC("BINARY", &_binary, _bool_parse_wrapper),
+#endif
 #undef SPEC
     };
     const struct spec *itr, *itr_end;
@@ -194,6 +217,9 @@ int
 sol_log_impl_init(void)
 {
     const char *func_name = getenv("SOL_LOG_PRINT_FUNCTION");
+#ifdef LOG_ASYNC
+    const char *binary_file;
+#endif
 
 #ifdef HAVE_ISATTY
     if (isatty(STDOUT_FILENO)) {
@@ -228,6 +254,10 @@ sol_log_impl_init(void)
     _env_bool_get("SOL_LOG_SHOW_FILE", &_show_file);
     _env_bool_get("SOL_LOG_SHOW_FUNCTION", &_show_function);
     _env_bool_get("SOL_LOG_SHOW_LINE", &_show_line);
+#ifdef LOG_ASYNC
+    _env_bool_get("SOL_LOG_ASYNC", &_async);
+    _env_bool_get("SOL_LOG_BINARY", &_binary);
+#endif
 
     if (_main_pid == 1)
         _kcmdline_load();
@@ -257,12 +287,39 @@ sol_log_impl_init(void)
         }
     }
 
+#ifdef LOG_ASYNC
+    binary_file = getenv("SOL_LOG_BINARY_FILE");
+    if (binary_file && *binary_file) {
+        int r = sol_log_impl_async_set_binary_file(binary_file);
+
+        if (r < 0)
+            fprintf(stderr, "ERROR: could not open SOL_LOG_BINARY_FILE=%s: %s\n",
+                binary_file, strerror(-r));
+        else
+            _binary = true;
+    }
+
+    /* binary records are formatted by the writer thread */
+    if (_binary) {
+        sol_log_impl_async_set_binary(true);
+        _async = true;
+    }
+
+    if (_async && sol_log_impl_async_set(true) < 0)
+        fputs("ERROR: could not start asynchronous log writer\n", stderr);
+#endif
+
     return 0;
 }
 
 void
 sol_log_impl_shutdown(void)
 {
+#ifdef LOG_ASYNC
+    sol_log_impl_async_shutdown();
+    _async = false;
+    _binary = false;
+#endif
     _main_pid = 0;
 #ifdef PTHREAD
     _main_thread = 0;
@@ -307,8 +364,8 @@ sol_log_impl_print_function_stderr(void *data, const struct sol_log_domain *doma
     if (_main_pid != getpid())
         fprintf(stderr, "P%u ", getpid());
 #ifdef PTHREAD
-    if (_main_thread != pthread_self())
-        fprintf(stderr, "T%" PRIu64 " ", (uint64_t)(uintptr_t)pthread_self());
+    if (_main_thread != _thread_self())
+        fprintf(stderr, "T%" PRIu64 " ", (uint64_t)(uintptr_t)_thread_self());
 #endif
 
     if (_show_file && _show_function && _show_line) {
@@ -382,8 +439,8 @@ sol_log_print_function_file(void *data, const struct sol_log_domain *domain, uin
     if (_main_pid != getpid())
         fprintf(fp, "P:%u ", getpid());
 #ifdef PTHREAD
-    if (_main_thread != pthread_self())
-        fprintf(fp, "T%" PRIu64 " ", (uint64_t)(uintptr_t)pthread_self());
+    if (_main_thread != _thread_self())
+        fprintf(fp, "T%" PRIu64 " ", (uint64_t)(uintptr_t)_thread_self());
 #endif
 
     if (_show_file && _show_function && _show_line)
@@ -443,34 +500,34 @@ SOL_API void
 sol_log_print_function_journal(void *data, const struct sol_log_domain *domain, uint8_t message_level, const char *file, const char *function, int line, const char *format, va_list args)
 {
 #ifdef PLATFORM_SYSTEMD
-    char *code_file = NULL;
-    char *code_line = NULL;
-    char *msg = NULL;
+    SOL_BUFFER_DECLARE_INLINE(code_file, 128);
+    SOL_BUFFER_DECLARE_INLINE(code_line, 32);
+    SOL_BUFFER_DECLARE_INLINE(msg, 256);
     int r, sd_level = _sol_log_level_to_syslog(message_level);
 
-    r = asprintf(&code_file, "CODE_FILE=%s", file);
-    if (r == -1)
-        fprintf(stderr, "ERR: asprintf() CODE_FILE=%s failed\n", file);
+    r = sol_buffer_append_printf(&code_file, "CODE_FILE=%s", file);
+    if (r < 0)
+        fprintf(stderr, "ERR: formatting CODE_FILE=%s failed\n", file);
 
-    r = asprintf(&code_line, "CODE_LINE=%d", line);
-    if (r == -1)
-        fprintf(stderr, "ERR: asprintf() CODE_LINE=%d failed\n", line);
+    r = sol_buffer_append_printf(&code_line, "CODE_LINE=%d", line);
+    if (r < 0)
+        fprintf(stderr, "ERR: formatting CODE_LINE=%d failed\n", line);
 
-    r = vasprintf(&msg, format, args);
-    if (r == -1)
-        fprintf(stderr, "ERR: asprintf() %s failed\n", format);
+    r = sol_buffer_append_vprintf(&msg, format, args);
+    if (r < 0)
+        fprintf(stderr, "ERR: formatting %s failed\n", format);
 
-    sd_journal_send_with_location(code_file, code_line, function,
+    sd_journal_send_with_location(code_file.data, code_line.data, function,
         "PRIORITY=%i", sd_level,
-        "MESSAGE=%s", msg ? msg : format,
+        "MESSAGE=%s", r == 0 ? (const char *)msg.data : format,
 #ifdef PTHREAD
-        "THREAD=%" PRIu64, (uint64_t)(uintptr_t)pthread_self(),
+        "THREAD=%" PRIu64, (uint64_t)(uintptr_t)_thread_self(),
 #endif
         NULL);
 
-    free(code_file);
-    free(code_line);
-    free(msg);
+    sol_buffer_fini(&code_file);
+    sol_buffer_fini(&code_line);
+    sol_buffer_fini(&msg);
 #else
     static bool once = false;
     if (!once) {
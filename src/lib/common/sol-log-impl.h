@@ -36,3 +36,21 @@ void sol_log_impl_unlock(void);
 bool sol_log_level_parse(const char *str, size_t size, uint8_t *storage);
 bool sol_log_levels_parse(const char *str, size_t size);
 void sol_log_impl_print_function_stderr(void *data, const struct sol_log_domain *domain, uint8_t message_level, const char *file, const char *function, int line, const char *format, va_list args);
+
+#ifdef LOG_ASYNC
+#include <pthread.h>
+
+int sol_log_impl_async_set(bool enabled);
+bool sol_log_impl_async_get(void);
+uint64_t sol_log_impl_async_get_dropped(void);
+bool sol_log_impl_async_print(const struct sol_log_domain *domain, uint8_t message_level, const char *file, const char *function, int line, const char *format, va_list args) SOL_ATTR_PRINTF(6, 0);
+void sol_log_impl_async_flush(void);
+void sol_log_impl_async_shutdown(void);
+/* capture format and arguments instead of formatting on the caller */
+void sol_log_impl_async_set_binary(bool enabled);
+bool sol_log_impl_async_get_binary(void);
+/* save records to a file instead of printing, before starting the writer */
+int sol_log_impl_async_set_binary_file(const char *path);
+/* the thread that logged the message being printed by the writer thread */
+bool sol_log_impl_async_get_origin(pthread_t *thread);
+#endif
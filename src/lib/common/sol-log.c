@@ -68,6 +68,7 @@ SOL_API struct sol_log_domain *sol_log_global_domain = &_global_domain;
 
 /* used in sol-mainloop.c */
 int sol_log_init(void);
+void sol_log_flush(void);
 void sol_log_shutdown(void);
 
 int
@@ -80,6 +81,16 @@ sol_log_init(void)
     return r;
 }
 
+/* Queued messages keep pointers to their domain, file and function
+ * names, so they must be written out before modules are unloaded */
+void
+sol_log_flush(void)
+{
+#ifdef LOG_ASYNC
+    sol_log_impl_async_flush();
+#endif
+}
+
 void
 sol_log_shutdown(void)
 {
@@ -316,6 +327,17 @@ sol_log_vprint(const struct sol_log_domain *domain, uint8_t message_level, const
 
     errno = errno_bkp;
 
+#ifdef LOG_ASYNC
+    /* messages that abort are printed right away, after the queued ones */
+    if (message_level > _abort_level &&
+        sol_log_impl_async_print(domain, message_level, file, function, line, format, args)) {
+        errno = errno_bkp;
+        return;
+    }
+    sol_log_impl_async_flush();
+    errno = errno_bkp;
+#endif
+
     if (!sol_log_impl_lock()) {
         fprintf(stderr,
             "ERROR: sol_log_print() cannot lock "
@@ -338,6 +360,11 @@ sol_log_set_print_function(void (*cb)(void *data, const struct sol_log_domain *d
 {
     SOL_LOG_INIT_CHECK("cb=%p, data=%p", cb, data);
 
+#ifdef LOG_ASYNC
+    /* queued messages go to the function that was set when they were logged */
+    sol_log_impl_async_flush();
+#endif
+
     if (cb) {
         _print_function = cb;
         _print_function_data = data;
@@ -469,6 +496,68 @@ sol_log_get_show_function(void)
     return _show_function;
 }
 
+SOL_API int
+sol_log_set_async(bool enabled)
+{
+    SOL_LOG_INIT_CHECK("enabled=%hhu", enabled);
+#ifdef LOG_ASYNC
+    return sol_log_impl_async_set(enabled);
+#else
+    return enabled ? -ENOTSUP : 0;
+#endif
+}
+
+SOL_API bool
+sol_log_get_async(void)
+{
+    SOL_LOG_INIT_CHECK("");
+#ifdef LOG_ASYNC
+    return sol_log_impl_async_get();
+#else
+    return false;
+#endif
+}
+
+SOL_API uint64_t
+sol_log_get_async_dropped(void)
+{
+    SOL_LOG_INIT_CHECK("");
+#ifdef LOG_ASYNC
+    return sol_log_impl_async_get_dropped();
+#else
+    return 0;
+#endif
+}
+
+SOL_API int
+sol_log_set_binary(bool enabled)
+{
+    SOL_LOG_INIT_CHECK("enabled=%hhu", enabled);
+#ifdef LOG_ASYNC
+    if (enabled) {
+        int r = sol_log_impl_async_set(true);
+
+        if (r < 0)
+            return r;
+    }
+    sol_log_impl_async_set_binary(enabled);
+    return 0;
+#else
+    return enabled ? -ENOTSUP : 0;
+#endif
+}
+
+SOL_API bool
+sol_log_get_binary(void)
+{
+    SOL_LOG_INIT_CHECK("");
+#ifdef LOG_ASYNC
+    return sol_log_impl_async_get() && sol_log_impl_async_get_binary();
+#else
+    return false;
+#endif
+}
+
 SOL_API void
 sol_log_set_show_line(bool enabled)
 {
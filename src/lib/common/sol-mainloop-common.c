@@ -70,7 +70,7 @@ static inline void
 timeout_vector_update(struct sol_ptr_vector *to, struct sol_ptr_vector *from)
 {
     struct sol_timeout_common *itr;
-    uint16_t i;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_IDX (from, itr, i)
         sol_ptr_vector_insert_sorted(to, itr, timeout_compare);
@@ -120,7 +120,7 @@ void
 sol_mainloop_impl_shutdown(void)
 {
     void *ptr;
-    uint16_t i;
+    uint32_t i;
 
     sol_mainloop_impl_platform_shutdown();
 
@@ -140,7 +140,7 @@ static inline void
 timeout_cleanup(void)
 {
     struct sol_timeout_common *timeout;
-    uint16_t i;
+    uint32_t i;
 
     if (!timeout_pending_deletion)
         return;
@@ -214,7 +214,7 @@ static inline void
 idler_cleanup(void)
 {
     struct sol_idler_common *idler;
-    uint16_t i;
+    uint32_t i;
 
     if (!idler_pending_deletion)
         return;
@@ -236,7 +236,7 @@ void
 sol_mainloop_common_idler_process(void)
 {
     struct sol_idler_common *idler;
-    uint16_t i;
+    uint32_t i;
 
     sol_mainloop_impl_lock();
     sol_ptr_vector_steal(&IDLER_PROCESS, &IDLER_ACUM);
@@ -280,7 +280,7 @@ static struct sol_timeout_common *
 sol_mainloop_common_timeout_first(void)
 {
     struct sol_timeout_common *timeout;
-    uint16_t i;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_IDX (&timeout_vector, timeout, i) {
         if (timeout->remove_me)
@@ -321,7 +321,7 @@ struct sol_idler_common *
 sol_mainloop_common_idler_first(void)
 {
     struct sol_idler_common *idler;
-    uint16_t i;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_IDX (&idler_vector, idler, i) {
         if (idler->status == idler_deleted)
@@ -336,7 +336,7 @@ static inline void
 source_cleanup(void)
 {
     struct sol_mainloop_source_common *source;
-    uint16_t i;
+    uint32_t i;
 
     if (!source_pending_deletion)
         return;
@@ -364,7 +364,7 @@ bool
 sol_mainloop_common_source_prepare(void)
 {
     struct sol_mainloop_source_common *source;
-    uint16_t i;
+    uint32_t i;
     bool ready = false;
 
     sol_mainloop_impl_lock();
@@ -399,7 +399,7 @@ sol_mainloop_common_source_get_next_timeout_locked(struct timespec *timeout)
 {
     bool found = false;
     struct sol_mainloop_source_common *source;
-    uint16_t i;
+    uint32_t i;
 
     sol_ptr_vector_steal(&SOURCE_PROCESS, &SOURCE_ACUM);
     source_processing = true;
@@ -452,7 +452,7 @@ bool
 sol_mainloop_common_source_check(void)
 {
     struct sol_mainloop_source_common *source;
-    uint16_t i;
+    uint32_t i;
     bool ready = false;
 
     sol_mainloop_impl_lock();
@@ -482,7 +482,7 @@ void
 sol_mainloop_common_source_dispatch(void)
 {
     struct sol_mainloop_source_common *source;
-    uint16_t i;
+    uint32_t i;
 
     sol_mainloop_impl_lock();
     sol_ptr_vector_steal(&SOURCE_PROCESS, &SOURCE_ACUM);
@@ -512,7 +512,7 @@ void
 sol_mainloop_common_source_shutdown(void)
 {
     struct sol_mainloop_source_common *source;
-    uint16_t i;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_IDX (&source_vector, source, i) {
         source->remove_me = true;
@@ -57,7 +57,7 @@ sol_ptr_vector_update(struct sol_ptr_vector *to, struct sol_ptr_vector *from)
 {
 #ifdef THREADS
     void *itr;
-    uint16_t i;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_IDX (from, itr, i) {
         /* FIXME: Handle when it fails properly */
@@ -170,7 +170,7 @@ sol_mainloop_contiki_event_handler_add(const process_event_t *ev, const process_
 bool
 sol_mainloop_contiki_event_handler_del(const process_event_t *ev, const process_data_t ev_data, void (*cb)(void *user_data, process_event_t ev, process_data_t ev_data), const void *data)
 {
-    int i;
+    uint32_t i;
     struct sol_event_handler_contiki *event_handler;
 
     SOL_PTR_VECTOR_FOREACH_IDX (&event_handler_vector, event_handler, i) {
@@ -217,7 +217,7 @@ event_handler_cleanup(void)
 static void
 event_dispatch(void)
 {
-    int i;
+    uint32_t i;
     struct sol_event_handler_contiki *event_handler;
 
     if (event != sensors_event)
@@ -200,7 +200,7 @@ static struct child_exit_status *
 find_child_exit_status(pid_t pid)
 {
     struct child_exit_status *itr;
-    uint16_t i;
+    uint32_t i;
 
     SOL_VECTOR_FOREACH_IDX (&child_exit_status_vector, itr, i) {
         if (itr->pid == pid)
@@ -347,7 +347,7 @@ signals_process(void)
 {
     unsigned char i;
     struct sol_child_watch_posix *one_child;
-    uint16_t vector_index;
+    uint32_t vector_index;
 
     SIGPROCMASK(SIG_BLOCK, &sig_blockset, NULL);
 
@@ -405,7 +405,7 @@ sol_mainloop_impl_platform_shutdown(void)
 {
     const struct siginfo_handler *sih;
     void *ptr;
-    uint16_t i;
+    uint32_t i;
 
     threads_shutdown();
 
@@ -438,7 +438,7 @@ static inline void
 child_watch_cleanup(void)
 {
     struct sol_child_watch_posix *child_watch;
-    uint16_t i;
+    uint32_t i;
 
     if (!child_watch_pending_deletion)
         return;
@@ -460,7 +460,7 @@ static inline void
 child_watch_process(void)
 {
     struct sol_child_watch_posix *child_watch;
-    uint16_t i;
+    uint32_t i;
 
     sol_mainloop_impl_lock();
     sol_ptr_vector_steal(&CHILD_WATCH_PROCESS, &CHILD_WATCH_ACUM);
@@ -540,7 +540,7 @@ fd_prepare(void)
 {
     const struct sol_fd_posix *handler;
     unsigned int fds, new_count, nfds;
-    uint16_t i;
+    uint32_t i;
 
     if (!fd_changed)
         return;
@@ -575,7 +575,7 @@ static inline void
 fd_cleanup(void)
 {
     struct sol_fd_posix *fd;
-    uint16_t i;
+    uint32_t i;
 
     if (!fd_pending_deletion)
         return;
@@ -632,7 +632,7 @@ fd_process(void)
     struct sol_fd_posix *handler;
     struct timespec ts;
     sigset_t emptyset;
-    uint16_t i, j;
+    uint32_t i, j;
     bool use_ts, sources_ready;
     int nfds;
 
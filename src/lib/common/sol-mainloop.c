@@ -30,6 +30,7 @@ SOL_LOG_INTERNAL_DECLARE(_sol_mainloop_log_domain, "mainloop");
 
 #ifdef SOL_LOG_ENABLED
 extern int sol_log_init(void);
+extern void sol_log_flush(void);
 extern void sol_log_shutdown(void);
 #else
 static inline int
@@ -38,6 +39,10 @@ sol_log_init(void)
     return 0;
 }
 static inline void
+sol_log_flush(void)
+{
+}
+static inline void
 sol_log_shutdown(void)
 {
 }
@@ -77,6 +82,15 @@ extern int sol_update_init(void);
 extern void sol_update_shutdown(void);
 #endif
 
+#ifdef USE_STORAGE
+extern void sol_storage_shutdown(void);
+#else
+static inline void
+sol_storage_shutdown(void)
+{
+}
+#endif
+
 static const struct sol_mainloop_implementation _sol_mainloop_implementation_default = {
     SOL_SET_API_VERSION(.api_version = SOL_MAINLOOP_IMPLEMENTATION_API_VERSION, )
     .init = sol_mainloop_impl_init,
@@ -261,10 +275,12 @@ sol_shutdown(void)
     sol_flow_shutdown();
 #endif
     sol_crypto_shutdown();
+    sol_storage_shutdown();
     sol_blob_shutdown();
     sol_pin_mux_shutdown();
     sol_platform_shutdown();
     mainloop_impl->shutdown();
+    sol_log_flush();
     sol_modules_clear_cache();
 #ifdef USE_UPDATE
     sol_update_shutdown();
@@ -0,0 +1,426 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#define SOL_LOG_DOMAIN &_log_domain
+#include "sol-log-internal.h"
+SOL_LOG_INTERNAL_DECLARE_STATIC(_log_domain, "task-pool");
+
+#include "sol-list.h"
+#include "sol-macros.h"
+#include "sol-mainloop.h"
+#include "sol-task-pool.h"
+#include "sol-util-internal.h"
+#include "sol-worker-thread.h"
+
+enum task_state {
+    TASK_QUEUED,
+    TASK_RUNNING
+};
+
+struct sol_task {
+    struct sol_list list;
+    struct task_worker *owner;
+    int (*work)(void *data);
+    void (*done)(void *data, int status);
+    const void *data;
+    enum task_state state; /* guarded by the owner's lock */
+    int status;
+};
+
+/* Each thread runs the tasks of its own queue from the head and, when
+ * it's empty, steals from the tail of the other queues. */
+struct task_worker {
+    struct sol_task_pool *pool;
+    struct sol_worker_thread *thread;
+    pthread_mutex_t lock;
+    struct sol_list tasks;
+};
+
+struct sol_task_pool {
+    struct task_worker *workers;
+    unsigned int n_workers;
+    unsigned int next_worker;
+
+    /* Protects the fields below, threads sleep on cond */
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned int queued;
+    bool stopping;
+    struct sol_list completed;
+
+    int event_fd;
+    struct sol_fd *watch;
+    uint16_t dispatching;
+    bool deleted;
+};
+
+static struct sol_task *
+take_task(struct task_worker *worker)
+{
+    struct sol_task_pool *pool = worker->pool;
+    struct task_worker *victim;
+    struct sol_task *task = NULL;
+    unsigned int i;
+
+    for (i = 0; i < pool->n_workers && !task; i++) {
+        victim = pool->workers + ((worker - pool->workers) + i) % pool->n_workers;
+
+        pthread_mutex_lock(&victim->lock);
+        if (!sol_list_is_empty(&victim->tasks)) {
+            if (victim == worker)
+                task = SOL_LIST_GET_CONTAINER(victim->tasks.next, struct sol_task, list);
+            else
+                task = SOL_LIST_GET_CONTAINER(victim->tasks.prev, struct sol_task, list);
+            sol_list_remove(&task->list);
+            task->state = TASK_RUNNING;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+
+    return task;
+}
+
+/* Must be called with the pool lock held. The first task to complete
+ * after a dispatch wakes the main loop, the others join its batch. */
+static void
+complete_task(struct sol_task_pool *pool, struct sol_task *task)
+{
+    static const uint64_t one = 1;
+    bool wake = sol_list_is_empty(&pool->completed);
+
+    sol_list_append(&pool->completed, &task->list);
+
+    if (wake && write(pool->event_fd, &one, sizeof(one)) < 0)
+        SOL_WRN("Could not wake main loop up: %s", sol_util_strerrora(errno));
+}
+
+static bool
+worker_iterate(void *data)
+{
+    struct task_worker *worker = data;
+    struct sol_task_pool *pool = worker->pool;
+    struct sol_task *task;
+
+    pthread_mutex_lock(&pool->lock);
+    while (!pool->queued && !pool->stopping)
+        pthread_cond_wait(&pool->cond, &pool->lock);
+    if (pool->stopping) {
+        pthread_mutex_unlock(&pool->lock);
+        return false;
+    }
+    pool->queued--;
+    pthread_mutex_unlock(&pool->lock);
+
+    /* May come back empty handed if the task was cancelled meanwhile */
+    task = take_task(worker);
+    if (!task)
+        return true;
+
+    task->status = task->work((void *)task->data);
+
+    pthread_mutex_lock(&pool->lock);
+    complete_task(pool, task);
+    pthread_mutex_unlock(&pool->lock);
+
+    return true;
+}
+
+static void
+worker_finished(void *data)
+{
+    struct task_worker *worker = data;
+
+    worker->thread = NULL;
+}
+
+static void
+task_dispatch(struct sol_task *task)
+{
+    if (task->done)
+        task->done((void *)task->data, task->status);
+    free(task);
+}
+
+static void
+pool_free(struct sol_task_pool *pool)
+{
+    unsigned int i;
+
+    for (i = 0; i < pool->n_workers; i++)
+        pthread_mutex_destroy(&pool->workers[i].lock);
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->lock);
+    close(pool->event_fd);
+    free(pool->workers);
+    free(pool);
+}
+
+static void
+dispatch_completed(struct sol_task_pool *pool)
+{
+    struct sol_list *itr, *itr_next, completed;
+
+    pthread_mutex_lock(&pool->lock);
+    if (sol_list_is_empty(&pool->completed)) {
+        pthread_mutex_unlock(&pool->lock);
+        return;
+    }
+    sol_list_steal(&pool->completed, &completed);
+    pthread_mutex_unlock(&pool->lock);
+
+    pool->dispatching++;
+    SOL_LIST_FOREACH_SAFE(&completed, itr, itr_next) {
+        sol_list_remove(itr);
+        task_dispatch(SOL_LIST_GET_CONTAINER(itr, struct sol_task, list));
+    }
+    pool->dispatching--;
+}
+
+static bool
+on_event(void *data, int fd, uint32_t active_flags)
+{
+    struct sol_task_pool *pool = data;
+    uint64_t count;
+
+    if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        SOL_WRN("Could not read task pool events: %s", sol_util_strerrora(errno));
+
+    dispatch_completed(pool);
+
+    /* One of the callbacks deleted the pool */
+    if (pool->deleted) {
+        if (!pool->dispatching)
+            pool_free(pool);
+        return false;
+    }
+
+    return true;
+}
+
+static void
+stop_workers(struct sol_task_pool *pool)
+{
+    unsigned int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stopping = true;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    /* Cancelling waits for the task being run, if any */
+    for (i = 0; i < pool->n_workers; i++) {
+        if (pool->workers[i].thread)
+            sol_worker_thread_cancel(pool->workers[i].thread);
+    }
+}
+
+SOL_API struct sol_task_pool *
+sol_task_pool_new(const struct sol_task_pool_config *config)
+{
+    struct sol_worker_thread_config thread_config = {
+        SOL_SET_API_VERSION(.api_version = SOL_WORKER_THREAD_CONFIG_API_VERSION, )
+        .iterate = worker_iterate,
+        .finished = worker_finished,
+    };
+    struct sol_task_pool *pool;
+    unsigned int i, threads = 0;
+    long cpus;
+
+    SOL_LOG_INTERNAL_INIT_ONCE;
+
+    if (config) {
+#ifndef SOL_NO_API_VERSION
+        if (SOL_UNLIKELY(config->api_version != SOL_TASK_POOL_CONFIG_API_VERSION)) {
+            SOL_WRN("Couldn't create task pool with unsupported version '%u', "
+                "expected version is '%u'",
+                config->api_version, SOL_TASK_POOL_CONFIG_API_VERSION);
+            return NULL;
+        }
+#endif
+        threads = config->threads;
+    }
+
+    if (!threads) {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = cpus > 0 ? cpus : 1;
+    }
+
+    pool = calloc(1, sizeof(*pool));
+    SOL_NULL_CHECK(pool, NULL);
+
+    pool->workers = calloc(threads, sizeof(*pool->workers));
+    SOL_NULL_CHECK_GOTO(pool->workers, error_workers);
+
+    pool->event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (pool->event_fd < 0) {
+        SOL_WRN("Could not create task pool event fd: %s",
+            sol_util_strerrora(errno));
+        goto error_fd;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+    sol_list_init(&pool->completed);
+
+    for (; pool->n_workers < threads; pool->n_workers++) {
+        struct task_worker *worker = pool->workers + pool->n_workers;
+
+        worker->pool = pool;
+        pthread_mutex_init(&worker->lock, NULL);
+        sol_list_init(&worker->tasks);
+    }
+
+    pool->watch = sol_fd_add(pool->event_fd, SOL_FD_FLAGS_IN, on_event, pool);
+    SOL_NULL_CHECK_GOTO(pool->watch, error_watch);
+
+    for (i = 0; i < pool->n_workers; i++) {
+        thread_config.data = pool->workers + i;
+        pool->workers[i].thread = sol_worker_thread_new(&thread_config);
+        SOL_NULL_CHECK_GOTO(pool->workers[i].thread, error_thread);
+    }
+
+    return pool;
+
+error_thread:
+    stop_workers(pool);
+    sol_fd_del(pool->watch);
+error_watch:
+    pool_free(pool);
+    return NULL;
+
+error_fd:
+    free(pool->workers);
+error_workers:
+    free(pool);
+    return NULL;
+}
+
+SOL_API void
+sol_task_pool_del(struct sol_task_pool *pool)
+{
+    struct sol_list *itr, *itr_next;
+    unsigned int i;
+
+    SOL_NULL_CHECK(pool);
+    SOL_EXP_CHECK(pool->deleted);
+
+    pool->deleted = true;
+    stop_workers(pool);
+
+    /* No thread is left, tasks still queued are cancelled */
+    for (i = 0; i < pool->n_workers; i++) {
+        SOL_LIST_FOREACH_SAFE(&pool->workers[i].tasks, itr, itr_next) {
+            struct sol_task *task = SOL_LIST_GET_CONTAINER(itr, struct sol_task, list);
+
+            sol_list_remove(itr);
+            task->status = -ECANCELED;
+            complete_task(pool, task);
+        }
+    }
+
+    pool->dispatching++;
+    dispatch_completed(pool);
+    pool->dispatching--;
+
+    /* Called from a done callback: on_event() frees it */
+    if (pool->dispatching)
+        return;
+
+    sol_fd_del(pool->watch);
+    pool_free(pool);
+}
+
+SOL_API struct sol_task *
+sol_task_pool_submit(struct sol_task_pool *pool, int (*work)(void *data), void (*done)(void *data, int status), const void *data)
+{
+    struct task_worker *worker;
+    struct sol_task *task;
+
+    SOL_NULL_CHECK(pool, NULL);
+    SOL_NULL_CHECK(work, NULL);
+    SOL_EXP_CHECK(pool->deleted, NULL);
+
+    task = calloc(1, sizeof(*task));
+    SOL_NULL_CHECK(task, NULL);
+
+    task->work = work;
+    task->done = done;
+    task->data = data;
+    task->state = TASK_QUEUED;
+
+    worker = pool->workers + pool->next_worker;
+    pool->next_worker = (pool->next_worker + 1) % pool->n_workers;
+    task->owner = worker;
+
+    pthread_mutex_lock(&worker->lock);
+    sol_list_append(&worker->tasks, &task->list);
+    pthread_mutex_unlock(&worker->lock);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->queued++;
+    pthread_cond_signal(&pool->cond);
+    pthread_mutex_unlock(&pool->lock);
+
+    return task;
+}
+
+SOL_API int
+sol_task_pool_cancel(struct sol_task_pool *pool, struct sol_task *task)
+{
+    struct task_worker *worker;
+    bool queued;
+
+    SOL_NULL_CHECK(pool, -EINVAL);
+    SOL_NULL_CHECK(task, -EINVAL);
+
+    worker = task->owner;
+    pthread_mutex_lock(&worker->lock);
+    queued = task->state == TASK_QUEUED;
+    if (queued)
+        sol_list_remove(&task->list);
+    pthread_mutex_unlock(&worker->lock);
+
+    if (!queued)
+        return -EBUSY;
+
+    /* A thread may have counted on this task already, then it finds
+     * nothing to do and goes back to sleep */
+    pthread_mutex_lock(&pool->lock);
+    if (pool->queued)
+        pool->queued--;
+    task->status = -ECANCELED;
+    complete_task(pool, task);
+    pthread_mutex_unlock(&pool->lock);
+
+    return 0;
+}
+
+SOL_API unsigned int
+sol_task_pool_get_thread_count(const struct sol_task_pool *pool)
+{
+    SOL_NULL_CHECK(pool, 0);
+
+    return pool->n_workers;
+}
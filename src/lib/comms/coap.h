@@ -20,6 +20,7 @@
 
 #include <inttypes.h>
 #include "sol-buffer.h"
+#include "sol-types.h"
 
 #if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
 struct coap_header {
@@ -41,10 +42,16 @@ struct coap_header {
 #error "Unknown byte order"
 #endif
 
+/* Most requests and responses fit, saving a second allocation */
+#define COAP_PACKET_INLINE_SIZE 128
+
 struct sol_coap_packet {
     int refcnt;
     struct sol_buffer buf;
     size_t payload_start;
+    /* Sent after buf, without being copied into it */
+    struct sol_blob_chain payload_blobs;
+    uint8_t storage[COAP_PACKET_INLINE_SIZE];
 };
 
 struct option_context {
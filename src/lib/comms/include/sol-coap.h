@@ -20,6 +20,7 @@
 
 #include <sol-network.h>
 #include <sol-str-slice.h>
+#include <sol-types.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -604,6 +605,9 @@ void sol_coap_packet_unref(struct sol_coap_packet *pkt);
  * in @a buf the packet's buffer and in @a offset, where in that
  * buffer the user's payload actually begins.
  *
+ * Fails once blobs were added to the payload with
+ * sol_coap_packet_add_payload_blob().
+ *
  * @param pkt The packet to fetch the payload of.
  * @param buf Where to store the address of the payload buffer.
  * @param offset Where to store the offset, in @a buf, where the
@@ -625,6 +629,25 @@ int sol_coap_packet_get_payload(struct sol_coap_packet *pkt, struct sol_buffer *
  */
 bool sol_coap_packet_has_payload(struct sol_coap_packet *pkt);
 
+/**
+ * @brief Appends a blob to the packet's payload, without copying it.
+ *
+ * The packet keeps a reference to @a blob until it's freed, and sends
+ * it right after what was appended to the payload buffer, if anything,
+ * in the same datagram. Large payloads that already live in a blob, or
+ * payloads made of many parts, are then never copied into the packet.
+ *
+ * As with sol_coap_packet_get_payload(), options can't be added after
+ * this. The payload buffer can't be fetched anymore either, any further
+ * payload must be added as blobs too.
+ *
+ * @param pkt The packet to add the payload to.
+ * @param blob The payload data. Empty blobs are ignored.
+ *
+ * @return 0 on success, -errno on failure.
+ */
+int sol_coap_packet_add_payload_blob(struct sol_coap_packet *pkt, struct sol_blob *blob);
+
 /**
  * @brief Adds an option to the CoAP packet.
  *
@@ -207,6 +207,149 @@ int sol_http_server_set_last_modified(struct sol_http_server *server, const char
  */
 int sol_http_server_send_response(struct sol_http_request *request, struct sol_http_response *response);
 
+/**
+ * @struct sol_http_progressive_response
+ * @brief Opaque handler for a streamed (chunked) response.
+ *
+ * It's created with sol_http_server_send_progressive_response() and
+ * data is pushed to the client with sol_http_progressive_response_feed()
+ * or sol_http_progressive_response_sse_feed(). It's finished with
+ * sol_http_progressive_response_del() or when the client goes away,
+ * which is informed by @c on_close in
+ * @ref sol_http_server_progressive_config.
+ */
+struct sol_http_progressive_response;
+
+/**
+ * @brief Configuration used to create a progressive response.
+ *
+ * @see sol_http_server_send_progressive_response()
+ */
+struct sol_http_server_progressive_config {
+#ifndef SOL_NO_API_VERSION
+#define SOL_HTTP_SERVER_PROGRESSIVE_CONFIG_API_VERSION (1)
+    /**
+     * api_version must match SOL_HTTP_SERVER_PROGRESSIVE_CONFIG_API_VERSION
+     * at runtime.
+     */
+    uint16_t api_version;
+#endif
+    /**
+     * Called when a blob given to sol_http_progressive_response_feed()
+     * or sol_http_progressive_response_sse_feed() was completely written
+     * (@c status is @c 0) or was discarded because the connection was
+     * closed (@c status is negative). May be @c NULL.
+     */
+    void (*on_feed_done)(void *data, struct sol_http_progressive_response *progressive,
+        struct sol_blob *blob, int status);
+    /**
+     * Called when the connection was closed by the client or the
+     * server was deleted. After this call @c progressive must not be
+     * used anymore. May be @c NULL.
+     */
+    void (*on_close)(void *data, const struct sol_http_progressive_response *progressive);
+    /**
+     * The user data given to the callbacks.
+     */
+    const void *user_data;
+    /**
+     * The maximum amount of bytes that may be queued and not yet
+     * written to the client. Feeding more than that returns
+     * @c -ENOSPC, so slow clients don't make the server buffer data
+     * without bounds. If @c 0, no limit is enforced.
+     */
+    size_t feed_size;
+};
+
+/**
+ * @brief Send a response whose body is streamed to the client.
+ *
+ * The status line and headers in @a response are sent right away and
+ * the connection is kept open, using chunked transfer encoding. The
+ * body is built by feeding blobs with
+ * sol_http_progressive_response_feed() or, when the response
+ * content type is @c text/event-stream, with
+ * sol_http_progressive_response_sse_feed(). The @c content of
+ * @a response, if any, is sent as the first chunk.
+ *
+ * After this call, @a request should not be used anymore.
+ *
+ * @param request The request given on the callback of
+ * @c sol_http_server_register_handler
+ * @param response The response headers and parameters
+ * @param config The progressive response configuration
+ *
+ * @return a handle to the progressive response on success, @c NULL otherwise.
+ */
+struct sol_http_progressive_response *sol_http_server_send_progressive_response(struct sol_http_request *request,
+    const struct sol_http_response *response, const struct sol_http_server_progressive_config *config);
+
+/**
+ * @brief Queue data to be sent on a progressive response.
+ *
+ * A reference to @a blob is taken and released once its content was
+ * written to the client. The blob may be shared between several
+ * progressive responses, so the same data can be pushed to many
+ * clients without copying it.
+ *
+ * @param progressive The progressive response handle
+ * @param blob The data to be sent
+ *
+ * @return @c 0 on success, @c -ENOSPC if the amount of queued data
+ * would exceed @c feed_size, other negative error code otherwise.
+ */
+int sol_http_progressive_response_feed(struct sol_http_progressive_response *progressive,
+    struct sol_blob *blob);
+
+/**
+ * @brief Queue a Server-Sent Event on a progressive response.
+ *
+ * Same as sol_http_progressive_response_feed(), but the content of
+ * @a blob is framed as the @c data field of an event, that is, each
+ * line is prefixed by @c "data: " and the event is terminated by an
+ * empty line.
+ *
+ * The event is framed on every call. To push the same event to many
+ * clients, frame it once with sol_http_progressive_response_sse_frame()
+ * and give the result to sol_http_progressive_response_feed().
+ *
+ * @param progressive The progressive response handle
+ * @param blob The event data
+ *
+ * @return @c 0 on success, @c -ENOSPC if the amount of queued data
+ * would exceed @c feed_size, other negative error code otherwise.
+ */
+int sol_http_progressive_response_sse_feed(struct sol_http_progressive_response *progressive,
+    struct sol_blob *blob);
+
+/**
+ * @brief Frame data as a Server-Sent Event.
+ *
+ * The framing is the one done by sol_http_progressive_response_sse_feed().
+ *
+ * @param blob The event data
+ *
+ * @return A new blob with the framed event, to be released with
+ * sol_blob_unref(), or @c NULL on error, with @c errno set.
+ */
+struct sol_blob *sol_http_progressive_response_sse_frame(const struct sol_blob *blob);
+
+/**
+ * @brief Finish a progressive response.
+ *
+ * If @a graceful_del is @c true, data already queued is sent before
+ * the stream is closed, otherwise it's discarded. No callback from
+ * @ref sol_http_server_progressive_config is called after this
+ * function and @a progressive must not be used anymore.
+ *
+ * @param progressive The progressive response handle
+ * @param graceful_del Whether pending data should be sent first
+ *
+ * @return @c 0 on success, error code (always negative) otherwise.
+ */
+int sol_http_progressive_response_del(struct sol_http_progressive_response *progressive,
+    bool graceful_del);
+
 /**
  * @brief Gets the URL from a given request.
  *
@@ -237,8 +237,10 @@ struct sol_mqtt_handlers {
      * This does not include PING messages, only messages incoming due
      * to publish request from other clients or the broker itself.
      *
-     * The memory associated to the message object will be freed after
-     * the callback returns.
+     * Messages received since the last mainloop iteration are
+     * delivered in a row. The message object, its topic and payload
+     * point to internal memory that is reused after the callback
+     * returns, so copy whatever must be retained.
      */
     void (*message) (void *data, struct sol_mqtt *mqtt, const struct sol_mqtt_message *message);
 
@@ -400,6 +402,17 @@ int sol_mqtt_publish(const struct sol_mqtt *mqtt, struct sol_mqtt_message *messa
  */
 int sol_mqtt_subscribe(const struct sol_mqtt *mqtt, const char *topic, sol_mqtt_qos qos);
 
+/**
+ * @brief Ask the Broker to remove a subscription to a given topic
+ *
+ * @param mqtt MQTT Object
+ * @param topic Null terminated string with the topic filter, exactly
+ * as given to sol_mqtt_subscribe()
+ *
+ * @return 0 on success, -EINVAL otherwise
+ */
+int sol_mqtt_unsubscribe(const struct sol_mqtt *mqtt, const char *topic);
+
 #ifndef SOL_NO_API_VERSION
 /**
  * @brief Macro used to check if a struct @c struct sol_mqtt_message has
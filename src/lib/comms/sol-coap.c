@@ -460,6 +460,7 @@ sol_coap_packet_ref(struct sol_coap_packet *pkt)
 static void
 coap_packet_free(struct sol_coap_packet *pkt)
 {
+    sol_blob_chain_clear(&pkt->payload_blobs);
     sol_buffer_fini(&pkt->buf);
     free(pkt);
 }
@@ -487,8 +488,10 @@ packet_new(struct sol_buffer *buf)
     SOL_NULL_CHECK(pkt, NULL);
 
     pkt->refcnt = 1;
+    sol_blob_chain_init(&pkt->payload_blobs);
     pkt->buf = buf ? *buf :
-        SOL_BUFFER_INIT_FLAGS(NULL, 0, SOL_BUFFER_FLAGS_NO_NUL_BYTE);
+        SOL_BUFFER_INIT_FLAGS(pkt->storage, sizeof(pkt->storage),
+        SOL_BUFFER_FLAGS_INLINE | SOL_BUFFER_FLAGS_NO_NUL_BYTE);
 
     r = sol_buffer_ensure(&pkt->buf, sizeof(struct coap_header));
     SOL_INT_CHECK_GOTO(r, < 0, err);
@@ -561,7 +564,7 @@ static struct outgoing *
 next_in_queue(struct sol_coap_server *server, int *idx)
 {
     struct outgoing *o;
-    uint16_t i;
+    uint32_t i;
 
     SOL_NULL_CHECK(idx, NULL);
 
@@ -613,7 +616,8 @@ pending_reply_free(struct pending_reply *reply)
 static bool
 call_reply_timeout_cb(struct sol_coap_server *server, struct sol_coap_packet *pkt)
 {
-    uint16_t i, id;
+    uint32_t i;
+    uint16_t id;
     struct pending_reply *reply;
 
     sol_coap_header_get_id(pkt, &id);
@@ -636,7 +640,8 @@ timeout_expired(struct sol_coap_server *server, struct outgoing *outgoing)
 {
     struct outgoing *o;
     int timeout;
-    uint16_t i, id;
+    uint32_t i;
+    uint16_t id;
     uint8_t type;
     int max_retransmit;
     bool expired = false;
@@ -678,6 +683,42 @@ timeout_expired(struct sol_coap_server *server, struct outgoing *outgoing)
     return expired;
 }
 
+static int
+packet_send(struct sol_socket *s, struct outgoing *outgoing)
+{
+    struct sol_coap_packet *pkt = outgoing->pkt;
+    struct sol_blob_chain chain;
+    struct sol_blob *header, *blob;
+    uint32_t i;
+    int r;
+
+    if (!sol_blob_chain_get_len(&pkt->payload_blobs))
+        return sol_socket_sendmsg(s, pkt->buf.data, pkt->buf.used,
+            &outgoing->cliaddr);
+
+    /* Header, options and payload marker go first, then the payload
+     * blobs, all in one datagram and without copying them together */
+    header = sol_blob_new(SOL_BLOB_TYPE_NO_FREE, NULL, pkt->buf.data,
+        pkt->buf.used);
+    SOL_NULL_CHECK(header, -ENOMEM);
+
+    sol_blob_chain_init(&chain);
+    r = sol_blob_chain_append(&chain, header);
+    sol_blob_unref(header);
+
+    SOL_BLOB_CHAIN_FOREACH_IDX (&pkt->payload_blobs, blob, i) {
+        if (r < 0)
+            break;
+        r = sol_blob_chain_append(&chain, blob);
+    }
+
+    if (r >= 0)
+        r = sol_socket_sendmsg_chain(s, &chain, &outgoing->cliaddr);
+
+    sol_blob_chain_clear(&chain);
+    return r;
+}
+
 static bool
 on_can_write(void *data, struct sol_socket *s)
 {
@@ -696,15 +737,15 @@ on_can_write(void *data, struct sol_socket *s)
     if (!outgoing)
         return false;
 
-    err = sol_socket_sendmsg(s, outgoing->pkt->buf.data,
-        outgoing->pkt->buf.used, &outgoing->cliaddr);
+    err = packet_send(s, outgoing);
     /* Eventually we are going to re-send it. */
     if (err == -EAGAIN)
         return true;
 
     SOL_DBG("CoAP packet sent (payload of %zu bytes, "
         "buffer holding it with %zu bytes)",
-        outgoing->pkt->buf.used, outgoing->pkt->buf.capacity);
+        outgoing->pkt->buf.used + outgoing->pkt->payload_blobs.size,
+        outgoing->pkt->buf.capacity);
     sol_coap_packet_debug(outgoing->pkt);
     if (err < 0) {
         uint16_t id;
@@ -843,7 +884,7 @@ static struct resource_context *
 find_context(struct sol_coap_server *server, const struct sol_coap_resource *resource)
 {
     struct resource_context *c;
-    uint16_t i;
+    uint32_t i;
 
     SOL_VECTOR_FOREACH_IDX (&server->contexts, c, i) {
         if (c->resource == resource)
@@ -860,7 +901,7 @@ sol_coap_packet_send_notification(struct sol_coap_server *server,
     struct resource_context *c;
     struct sol_coap_packet *p;
     uint8_t tkl;
-    uint16_t i;
+    uint32_t i;
     int r = 0;
 
     SOL_NULL_CHECK(server, -EINVAL);
@@ -1120,7 +1161,7 @@ well_known_get(struct sol_coap_server *server,
     struct resource_context *c;
     struct sol_coap_packet *resp;
     size_t len;
-    uint16_t i;
+    uint32_t i;
     int r;
 
     resp = sol_coap_packet_new(req);
@@ -1216,7 +1257,7 @@ register_observer(struct resource_context *c, struct sol_coap_packet *req,
     const struct sol_network_link_addr *cliaddr, int observe)
 {
     struct resource_observer *o;
-    uint16_t i;
+    uint32_t i;
     uint8_t *token, tkl;
     int r;
 
@@ -1300,7 +1341,8 @@ err:
 static void
 remove_outgoing_confirmable_packet(struct sol_coap_server *server, struct sol_coap_packet *req)
 {
-    uint16_t i, id;
+    uint32_t i;
+    uint16_t id;
     struct outgoing *o;
 
     sol_coap_header_get_id(req, &id);
@@ -1394,7 +1436,7 @@ respond_packet(struct sol_coap_server *server, struct sol_coap_packet *req,
     struct pending_reply *reply;
     struct resource_context *c;
     int observe, r = 0;
-    uint16_t i;
+    uint32_t i;
     uint8_t code;
     bool remove_outgoing = true;
 
@@ -1555,7 +1597,7 @@ static void
 destroy_context(struct resource_context *context)
 {
     struct resource_observer *o;
-    uint16_t i;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_REVERSE_IDX (&context->observers, o, i) {
         free(o);
@@ -1569,7 +1611,7 @@ sol_coap_server_destroy(struct sol_coap_server *server)
     struct resource_context *c;
     struct pending_reply *reply;
     struct outgoing *o;
-    uint16_t i;
+    uint32_t i;
 
     sol_socket_del(server->socket);
 
@@ -1610,7 +1652,7 @@ join_mcast_groups(struct sol_socket *s, const struct sol_network_link *link)
 {
     struct sol_network_link_addr groupaddr = { };
     struct sol_network_link_addr *addr;
-    uint16_t i;
+    uint32_t i;
 
     if (!(link->flags & SOL_NETWORK_LINK_RUNNING) && !(link->flags & SOL_NETWORK_LINK_MULTICAST))
         return 0;
@@ -1659,7 +1701,7 @@ sol_coap_server_new_full(enum sol_socket_type type, const struct sol_network_lin
     struct sol_network_link *link;
     struct sol_coap_server *server;
     struct sol_socket *s;
-    uint16_t i;
+    uint32_t i;
     int on = 1;
 
     SOL_LOG_INTERNAL_INIT_ONCE;
@@ -1775,21 +1817,40 @@ sol_coap_packet_has_payload(struct sol_coap_packet *pkt)
            (uint8_t *)pkt->buf.data + offset;
 }
 
+static int
+packet_start_payload(struct sol_coap_packet *pkt)
+{
+    int r;
+
+    if (pkt->payload_start)
+        return 0;
+
+    r = sol_buffer_append_char(&pkt->buf, COAP_MARKER);
+    SOL_INT_CHECK(r, < 0, r);
+
+    pkt->payload_start = pkt->buf.used;
+    return 0;
+}
+
 SOL_API int
 sol_coap_packet_get_payload(struct sol_coap_packet *pkt,
     struct sol_buffer **buf,
     size_t *offset)
 {
+    int r;
+
     SOL_NULL_CHECK(pkt, -EINVAL);
     SOL_NULL_CHECK(buf, -EINVAL);
 
-    if (!pkt->payload_start) {
-        int r;
-        r = sol_buffer_append_char(&pkt->buf, COAP_MARKER);
-        SOL_INT_CHECK(r, < 0, r);
-
-        pkt->payload_start = pkt->buf.used;
+    if (sol_blob_chain_get_len(&pkt->payload_blobs)) {
+        SOL_WRN("packet %p has payload blobs, its buffer would be sent"
+            " before them", pkt);
+        return -EINVAL;
     }
+
+    r = packet_start_payload(pkt);
+    SOL_INT_CHECK(r, < 0, r);
+
     if (offset)
         *offset = pkt->payload_start;
 
@@ -1798,6 +1859,24 @@ sol_coap_packet_get_payload(struct sol_coap_packet *pkt,
     return 0;
 }
 
+SOL_API int
+sol_coap_packet_add_payload_blob(struct sol_coap_packet *pkt, struct sol_blob *blob)
+{
+    int r;
+
+    SOL_NULL_CHECK(pkt, -EINVAL);
+    SOL_NULL_CHECK(blob, -EINVAL);
+
+    /* The payload marker can't be followed by an empty payload */
+    if (!blob->size)
+        return 0;
+
+    r = packet_start_payload(pkt);
+    SOL_INT_CHECK(r, < 0, r);
+
+    return sol_blob_chain_append(&pkt->payload_blobs, blob);
+}
+
 SOL_API int
 sol_coap_server_register_resource(struct sol_coap_server *server,
     const struct sol_coap_resource *resource, const void *data)
@@ -1831,7 +1910,7 @@ sol_coap_server_unregister_resource(struct sol_coap_server *server,
     const struct sol_coap_resource *resource)
 {
     struct resource_context *c;
-    uint16_t idx;
+    uint32_t idx;
 
     SOL_NULL_CHECK(server, -EINVAL);
     SOL_NULL_CHECK(resource, -EINVAL);
@@ -1854,9 +1933,10 @@ sol_coap_server_unregister_resource(struct sol_coap_server *server,
 SOL_API int
 sol_coap_cancel_send_packet(struct sol_coap_server *server, struct sol_coap_packet *pkt, struct sol_network_link_addr *cliaddr)
 {
-    uint16_t id, i, cancel = 0;
     struct pending_reply *reply;
     struct outgoing *o;
+    uint32_t i, cancel = 0;
+    uint16_t id;
     int r;
 
     SOL_NULL_CHECK(server, -EINVAL);
@@ -1894,7 +1974,7 @@ SOL_API int
 sol_coap_unobserve_server(struct sol_coap_server *server, const struct sol_network_link_addr *cliaddr, uint8_t *token, uint8_t tkl)
 {
     int r;
-    uint16_t i;
+    uint32_t i;
     struct pending_reply *reply;
 
     SOL_NULL_CHECK(server, -EINVAL);
@@ -48,6 +48,8 @@
 #define READABLE_BY_EVERYONE (S_IRUSR | S_IRGRP | S_IROTH)
 
 #define SOL_HTTP_REQUEST_BUFFER_SIZE 4096
+#define SOL_HTTP_PROGRESSIVE_BLOCK_SIZE 4096
+#define SOL_HTTP_SSE_DATA_PREFIX "data: "
 
 struct http_handler {
     time_t last_modified;
@@ -57,6 +59,7 @@ struct http_handler {
 };
 
 struct sol_http_request {
+    struct sol_http_server *server;
     struct MHD_Connection *connection;
     struct MHD_PostProcessor *pp;
     const char *url;
@@ -88,6 +91,7 @@ struct sol_http_server {
     struct sol_vector fds;
     struct sol_vector defaults;
     struct sol_ptr_vector requests;
+    struct sol_ptr_vector progressives;
 #ifdef HAVE_LIBMAGIC
     magic_t magic;
 #endif
@@ -99,6 +103,27 @@ struct http_connection {
     int fd;
 };
 
+struct progressive_pending {
+    struct sol_blob *blob; /* what is written to the connection */
+    struct sol_blob *fed; /* what was given by the user */
+};
+
+struct sol_http_progressive_response {
+    struct sol_http_server *server;
+    struct MHD_Connection *connection;
+    struct sol_vector pending;
+    void (*on_feed_done)(void *data, struct sol_http_progressive_response *progressive,
+        struct sol_blob *blob, int status);
+    void (*on_close)(void *data, const struct sol_http_progressive_response *progressive);
+    const void *user_data;
+    size_t feed_size;
+    size_t accumulated;
+    size_t offset;
+    bool suspended : 1;
+    bool graceful_del : 1;
+    bool delete_me : 1;
+};
+
 static const char *
 get_file_mime_type(struct sol_http_server *server, int fd)
 {
@@ -205,19 +230,14 @@ set_last_modified_header(struct MHD_Response *response, time_t last_modified)
     return true;
 }
 
-static struct MHD_Response *
-build_mhd_response(const struct sol_http_response *response, time_t last_modified)
+static bool
+set_response_params(struct MHD_Response *r, const struct sol_http_response *response,
+    time_t last_modified)
 {
     struct sol_buffer buf;
-    uint16_t idx;
-    struct MHD_Response *r;
+    uint32_t idx;
     struct sol_http_param_value *value;
 
-    r = MHD_create_response_from_buffer(response->content.used, response->content.data,
-        MHD_RESPMEM_MUST_COPY);
-    if (!r)
-        return NULL;
-
     sol_buffer_init(&buf);
     SOL_HTTP_PARAMS_FOREACH_IDX (&response->param, value, idx) {
         int ret;
@@ -262,12 +282,29 @@ build_mhd_response(const struct sol_http_response *response, time_t last_modifie
         goto err;
 
     sol_buffer_fini(&buf);
-    return r;
+    return true;
 
 err:
     sol_buffer_fini(&buf);
-    MHD_destroy_response(r);
-    return NULL;
+    return false;
+}
+
+static struct MHD_Response *
+build_mhd_response(const struct sol_http_response *response, time_t last_modified)
+{
+    struct MHD_Response *r;
+
+    r = MHD_create_response_from_buffer(response->content.used, response->content.data,
+        MHD_RESPMEM_MUST_COPY);
+    if (!r)
+        return NULL;
+
+    if (!set_response_params(r, response, last_modified)) {
+        MHD_destroy_response(r);
+        return NULL;
+    }
+
+    return r;
 }
 
 static int
@@ -421,7 +458,7 @@ static struct MHD_Response *
 get_default_response(const struct sol_http_server *server, enum sol_http_status_code error)
 {
     int r;
-    uint16_t i;
+    uint32_t i;
     char buf[32];
     struct stat st;
     struct default_page *def;
@@ -479,8 +516,9 @@ http_server_get_method(const char *method)
         SOL_STR_TABLE_ITEM("PATCH",   SOL_HTTP_METHOD_PATCH),
         { }
     };
+    SOL_STR_TABLE_HASH_DECLARE(table_hash, table);
 
-    return sol_str_table_lookup_fallback(table, sol_str_slice_from_str(method),
+    return sol_str_table_hash_lookup_fallback(&table_hash, sol_str_slice_from_str(method),
         SOL_HTTP_METHOD_INVALID);
 }
 
@@ -489,7 +527,7 @@ http_server_static_response(struct sol_http_server *server, struct sol_http_requ
     enum sol_http_status_code *status)
 {
     int fd, r;
-    uint16_t i;
+    uint32_t i;
     struct static_dir *dir;
     struct MHD_Response *response = NULL;
 
@@ -545,7 +583,7 @@ http_server_handler(void *data, struct MHD_Connection *connection, const char *u
     const char *version, const char *upload_data, size_t *upload_data_size, void **ptr)
 {
     int ret;
-    uint16_t i;
+    uint32_t i;
     char *path = NULL;
     struct MHD_Response *mhd_response = NULL;
     struct sol_http_server *server = data;
@@ -565,6 +603,7 @@ http_server_handler(void *data, struct MHD_Connection *connection, const char *u
         }
 
         sol_http_params_init(&req->params);
+        req->server = server;
         req->url = url;
         sol_buffer_init(&req->buffer);
         req->connection = connection;
@@ -663,7 +702,7 @@ end:
 static bool
 connection_watch_cb(void *data, int fd, uint32_t flags)
 {
-    uint16_t i;
+    uint32_t i;
     fd_set rs, ws, es;
     struct sol_http_server *server = data;
     struct http_connection *connection;
@@ -733,7 +772,7 @@ notify_connection_cb(void *data, struct MHD_Connection *connection, void **socke
 static void
 free_request(struct sol_http_request *request)
 {
-    uint16_t idx;
+    uint32_t idx;
     struct sol_http_param_value *param;
 
     if (request->pp)
@@ -793,6 +832,7 @@ sol_http_server_new(uint16_t port)
     sol_vector_init(&server->dirs, sizeof(struct static_dir));
     sol_vector_init(&server->defaults, sizeof(struct default_page));
     sol_ptr_vector_init(&server->requests);
+    sol_ptr_vector_init(&server->progressives);
 
     server->buf_size = SOL_HTTP_REQUEST_BUFFER_SIZE;
 
@@ -823,6 +863,7 @@ err_daemon:
     sol_vector_clear(&server->fds);
     sol_vector_clear(&server->dirs);
     sol_ptr_vector_clear(&server->requests);
+    sol_ptr_vector_clear(&server->progressives);
     free(server);
     return NULL;
 }
@@ -830,12 +871,13 @@ err_daemon:
 SOL_API void
 sol_http_server_del(struct sol_http_server *server)
 {
-    uint16_t i;
+    uint32_t i;
     struct static_dir *dir;
     struct default_page *def;
     struct http_handler *handler;
     struct http_connection *connection;
     struct sol_http_request *request;
+    struct sol_http_progressive_response *progressive;
 
     SOL_NULL_CHECK(server);
 
@@ -844,6 +886,16 @@ sol_http_server_del(struct sol_http_server *server)
     }
     sol_ptr_vector_clear(&server->requests);
 
+    /* Streams are finished by MHD_stop_daemon(), which calls
+     * progressive_response_free_cb() and thus on_close() for each one.
+     * Suspended connections must be resumed before that. */
+    SOL_PTR_VECTOR_FOREACH_IDX (&server->progressives, progressive, i) {
+        if (progressive->suspended) {
+            MHD_resume_connection(progressive->connection);
+            progressive->suspended = false;
+        }
+    }
+
     SOL_VECTOR_FOREACH_IDX (&server->handlers, handler, i)
         free((char *)handler->path.data);
     sol_vector_clear(&server->handlers);
@@ -863,6 +915,7 @@ sol_http_server_del(struct sol_http_server *server)
     sol_vector_clear(&server->defaults);
 
     MHD_stop_daemon(server->daemon);
+    sol_ptr_vector_clear(&server->progressives);
 
 #ifdef HAVE_LIBMAGIC
     if (server->magic)
@@ -877,7 +930,7 @@ sol_http_server_register_handler(struct sol_http_server *server, const char *pat
     int (*request_cb)(void *data, struct sol_http_request *request),
     const void *data)
 {
-    uint16_t i;
+    uint32_t i;
     char *p;
     struct http_handler *handler;
 
@@ -917,7 +970,7 @@ err:
 SOL_API int
 sol_http_server_unregister_handler(struct sol_http_server *server, const char *path)
 {
-    uint16_t i;
+    uint32_t i;
     struct http_handler *handler;
 
     SOL_NULL_CHECK(server, -EINVAL);
@@ -959,10 +1012,331 @@ sol_http_server_send_response(struct sol_http_request *request, struct sol_http_
     return ret;
 }
 
+static void
+progressive_pending_done(struct sol_http_progressive_response *progressive,
+    struct progressive_pending *pending, int status)
+{
+    if (!progressive->delete_me && progressive->on_feed_done)
+        progressive->on_feed_done((void *)progressive->user_data, progressive,
+            pending->fed, status);
+
+    sol_blob_unref(pending->blob);
+    sol_blob_unref(pending->fed);
+}
+
+static void
+progressive_pending_clear(struct sol_http_progressive_response *progressive,
+    int status)
+{
+    struct progressive_pending pending;
+
+    while (progressive->pending.len) {
+        pending = *(struct progressive_pending *)
+            sol_vector_get_no_check(&progressive->pending, 0);
+        sol_vector_del(&progressive->pending, 0);
+        progressive_pending_done(progressive, &pending, status);
+    }
+
+    sol_vector_clear(&progressive->pending);
+    progressive->accumulated = 0;
+    progressive->offset = 0;
+}
+
+static ssize_t
+progressive_response_reader_cb(void *data, uint64_t pos, char *buf, size_t max)
+{
+    struct sol_http_progressive_response *progressive = data;
+    struct progressive_pending *pending, done;
+    size_t written = 0, len;
+
+    if (progressive->delete_me && !progressive->graceful_del)
+        return MHD_CONTENT_READER_END_WITH_ERROR;
+
+    while (written < max && progressive->pending.len) {
+        pending = sol_vector_get_no_check(&progressive->pending, 0);
+
+        len = sol_min(max - written, pending->blob->size - progressive->offset);
+        memcpy(buf + written, (char *)pending->blob->mem + progressive->offset, len);
+        written += len;
+        progressive->offset += len;
+        progressive->accumulated -= len;
+
+        if (progressive->offset < pending->blob->size)
+            break;
+
+        /* on_feed_done() may feed again, so the vector must be
+         * consistent before calling it */
+        done = *pending;
+        sol_vector_del(&progressive->pending, 0);
+        progressive->offset = 0;
+        progressive_pending_done(progressive, &done, 0);
+    }
+
+    if (written)
+        return written;
+
+    if (progressive->delete_me)
+        return MHD_CONTENT_READER_END_OF_STREAM;
+
+    /* Nothing to write, stop polling this connection until more data
+     * is fed */
+    MHD_suspend_connection(progressive->connection);
+    progressive->suspended = true;
+    return 0;
+}
+
+static void
+progressive_response_free_cb(void *data)
+{
+    struct sol_http_progressive_response *progressive = data;
+
+    progressive_pending_clear(progressive, -ECANCELED);
+
+    if (!progressive->delete_me && progressive->on_close)
+        progressive->on_close((void *)progressive->user_data, progressive);
+
+    sol_ptr_vector_remove(&progressive->server->progressives, progressive);
+    free(progressive);
+}
+
+static int
+progressive_response_enqueue(struct sol_http_progressive_response *progressive,
+    struct sol_blob *blob, struct sol_blob *fed)
+{
+    struct progressive_pending *pending;
+
+    if (progressive->feed_size &&
+        progressive->accumulated + blob->size > progressive->feed_size)
+        return -ENOSPC;
+
+    pending = sol_vector_append(&progressive->pending);
+    SOL_NULL_CHECK(pending, -ENOMEM);
+
+    pending->blob = sol_blob_ref(blob);
+    SOL_NULL_CHECK_GOTO(pending->blob, err_blob);
+    pending->fed = sol_blob_ref(fed);
+    SOL_NULL_CHECK_GOTO(pending->fed, err_fed);
+
+    progressive->accumulated += blob->size;
+
+    if (progressive->suspended) {
+        MHD_resume_connection(progressive->connection);
+        progressive->suspended = false;
+    }
+
+    return 0;
+
+err_fed:
+    sol_blob_unref(pending->blob);
+err_blob:
+    sol_vector_del_last(&progressive->pending);
+    return -EOVERFLOW;
+}
+
+SOL_API struct sol_http_progressive_response *
+sol_http_server_send_progressive_response(struct sol_http_request *request,
+    const struct sol_http_response *response,
+    const struct sol_http_server_progressive_config *config)
+{
+    int ret;
+    struct MHD_Response *mhd_response;
+    struct sol_http_progressive_response *progressive;
+
+    SOL_NULL_CHECK(request, NULL);
+    SOL_NULL_CHECK(request->connection, NULL);
+    SOL_NULL_CHECK(response, NULL);
+    SOL_NULL_CHECK(config, NULL);
+
+    SOL_HTTP_RESPONSE_CHECK_API_VERSION(response, NULL);
+
+#ifndef SOL_NO_API_VERSION
+    if (config->api_version != SOL_HTTP_SERVER_PROGRESSIVE_CONFIG_API_VERSION) {
+        SOL_WRN("config->api_version=%hu, "
+            "expected version is %hu.",
+            config->api_version, SOL_HTTP_SERVER_PROGRESSIVE_CONFIG_API_VERSION);
+        return NULL;
+    }
+#endif
+
+    progressive = calloc(1, sizeof(*progressive));
+    SOL_NULL_CHECK(progressive, NULL);
+
+    sol_vector_init(&progressive->pending, sizeof(struct progressive_pending));
+    progressive->server = request->server;
+    progressive->connection = request->connection;
+    progressive->on_feed_done = config->on_feed_done;
+    progressive->on_close = config->on_close;
+    progressive->user_data = config->user_data;
+    progressive->feed_size = config->feed_size;
+
+    if (response->content.used) {
+        struct sol_blob *blob;
+        void *mem;
+
+        mem = sol_util_memdup(response->content.data, response->content.used);
+        SOL_NULL_CHECK_GOTO(mem, err_content);
+
+        blob = sol_blob_new(SOL_BLOB_TYPE_DEFAULT, NULL, mem,
+            response->content.used);
+        if (!blob) {
+            free(mem);
+            goto err_content;
+        }
+
+        ret = progressive_response_enqueue(progressive, blob, blob);
+        sol_blob_unref(blob);
+        SOL_INT_CHECK_GOTO(ret, < 0, err_content);
+    }
+
+    ret = sol_ptr_vector_append(&request->server->progressives, progressive);
+    SOL_INT_CHECK_GOTO(ret, < 0, err_content);
+
+    /* From now on, the connection life is bound to the progressive
+     * response, not to the request */
+    sol_ptr_vector_remove(&request->server->requests, request);
+    MHD_resume_connection(request->connection);
+
+    mhd_response = MHD_create_response_from_callback(MHD_SIZE_UNKNOWN,
+        SOL_HTTP_PROGRESSIVE_BLOCK_SIZE, progressive_response_reader_cb,
+        progressive, progressive_response_free_cb);
+    SOL_NULL_CHECK_GOTO(mhd_response, err_response);
+
+    /* Whatever happens now, progressive_response_free_cb() is going
+     * to release progressive, so don't notify the user on errors */
+    if (!set_response_params(mhd_response, response, request->last_modified)) {
+        progressive->delete_me = true;
+        MHD_destroy_response(mhd_response);
+        return NULL;
+    }
+
+    ret = MHD_queue_response(request->connection, response->response_code, mhd_response);
+    if (ret != MHD_YES)
+        progressive->delete_me = true;
+    MHD_destroy_response(mhd_response);
+    SOL_INT_CHECK(ret, != MHD_YES, NULL);
+
+    return progressive;
+
+err_response:
+    sol_ptr_vector_remove(&request->server->progressives, progressive);
+err_content:
+    progressive->delete_me = true;
+    progressive_pending_clear(progressive, -ECANCELED);
+    free(progressive);
+    return NULL;
+}
+
+SOL_API int
+sol_http_progressive_response_feed(struct sol_http_progressive_response *progressive,
+    struct sol_blob *blob)
+{
+    SOL_NULL_CHECK(progressive, -EINVAL);
+    SOL_NULL_CHECK(blob, -EINVAL);
+    SOL_EXP_CHECK(progressive->delete_me, -EINVAL);
+
+    return progressive_response_enqueue(progressive, blob, blob);
+}
+
+SOL_API struct sol_blob *
+sol_http_progressive_response_sse_frame(const struct sol_blob *blob)
+{
+    int r;
+    size_t len;
+    void *mem;
+    struct sol_blob *framed;
+    struct sol_str_slice data, line;
+    struct sol_buffer buf = SOL_BUFFER_INIT_EMPTY;
+
+    if (!blob) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    /* Each line of the payload becomes a 'data:' field, the event
+     * itself is terminated by an empty line */
+    data = sol_str_slice_from_blob(blob);
+    do {
+        const char *nl = memchr(data.data, '\n', data.len);
+
+        line = SOL_STR_SLICE_STR(data.data, nl ? (size_t)(nl - data.data) : data.len);
+        r = sol_buffer_append_slice(&buf, sol_str_slice_from_str(SOL_HTTP_SSE_DATA_PREFIX));
+        SOL_INT_CHECK_GOTO(r, < 0, err);
+        r = sol_buffer_append_slice(&buf, line);
+        SOL_INT_CHECK_GOTO(r, < 0, err);
+        r = sol_buffer_append_char(&buf, '\n');
+        SOL_INT_CHECK_GOTO(r, < 0, err);
+
+        if (!nl)
+            break;
+        data.data = nl + 1;
+        data.len -= line.len + 1;
+    } while (data.len);
+
+    r = sol_buffer_append_char(&buf, '\n');
+    SOL_INT_CHECK_GOTO(r, < 0, err);
+
+    mem = sol_buffer_steal(&buf, &len);
+    framed = sol_blob_new(SOL_BLOB_TYPE_DEFAULT, NULL, mem, len);
+    if (!framed) {
+        free(mem);
+        errno = ENOMEM;
+    }
+
+    return framed;
+
+err:
+    sol_buffer_fini(&buf);
+    errno = -r;
+    return NULL;
+}
+
+SOL_API int
+sol_http_progressive_response_sse_feed(struct sol_http_progressive_response *progressive,
+    struct sol_blob *blob)
+{
+    int r;
+    struct sol_blob *framed;
+
+    SOL_NULL_CHECK(progressive, -EINVAL);
+    SOL_NULL_CHECK(blob, -EINVAL);
+    SOL_EXP_CHECK(progressive->delete_me, -EINVAL);
+
+    framed = sol_http_progressive_response_sse_frame(blob);
+    if (!framed)
+        return -errno;
+
+    r = progressive_response_enqueue(progressive, framed, blob);
+    sol_blob_unref(framed);
+    return r;
+}
+
+SOL_API int
+sol_http_progressive_response_del(struct sol_http_progressive_response *progressive,
+    bool graceful_del)
+{
+    SOL_NULL_CHECK(progressive, -EINVAL);
+    SOL_EXP_CHECK(progressive->delete_me, -EINVAL);
+
+    progressive->delete_me = true;
+    progressive->graceful_del = graceful_del;
+
+    if (!graceful_del)
+        progressive_pending_clear(progressive, -ECANCELED);
+
+    /* The reader callback will end the stream and
+     * progressive_response_free_cb() will release it */
+    if (progressive->suspended) {
+        MHD_resume_connection(progressive->connection);
+        progressive->suspended = false;
+    }
+
+    return 0;
+}
+
 SOL_API int
 sol_http_server_set_last_modified(struct sol_http_server *server, const char *path, time_t modified)
 {
-    uint16_t idx;
+    uint32_t idx;
     struct http_handler *handler;
 
     SOL_NULL_CHECK(server, -EINVAL);
@@ -981,7 +1355,7 @@ sol_http_server_set_last_modified(struct sol_http_server *server, const char *pa
 SOL_API int
 sol_http_server_add_dir(struct sol_http_server *server, const char *basename, const char *rootdir)
 {
-    uint16_t i;
+    uint32_t i;
     char *p;
     struct static_dir *dir;
 
@@ -1023,7 +1397,7 @@ SOL_API int
 sol_http_server_remove_dir(struct sol_http_server *server, const char *basename, const char *rootdir)
 {
     int r = -ENOMEM;
-    uint16_t i;
+    uint32_t i;
     char *root = NULL, *p = NULL;
     struct static_dir *dir;
 
@@ -1104,7 +1478,7 @@ sol_http_server_set_error_page(struct sol_http_server *server,
     const enum sol_http_status_code error, const char *page)
 {
     int r;
-    uint16_t i;
+    uint32_t i;
     char *p;
     struct default_page *def;
 
@@ -1146,7 +1520,7 @@ SOL_API int
 sol_http_server_remove_error_page(struct sol_http_server *server,
     const enum sol_http_status_code error)
 {
-    uint16_t i;
+    uint32_t i;
     struct default_page *def;
 
     SOL_NULL_CHECK(server, -EINVAL);
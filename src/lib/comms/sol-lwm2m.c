@@ -281,7 +281,7 @@ dispatch_registration_event(struct sol_lwm2m_server *server,
     struct sol_lwm2m_client_info *cinfo,
     enum sol_lwm2m_registration_event event)
 {
-    uint16_t i;
+    uint32_t i;
     struct sol_monitors_entry *m;
 
     SOL_MONITORS_WALK (&server->registration, m, i)
@@ -292,7 +292,8 @@ dispatch_registration_event(struct sol_lwm2m_server *server,
 static void
 client_objects_clear(struct sol_ptr_vector *objects)
 {
-    uint16_t i, j, *id;
+    uint32_t i, j;
+    uint16_t *id;
     struct sol_lwm2m_client_object *object;
 
     SOL_PTR_VECTOR_FOREACH_IDX (objects, object, i) {
@@ -337,7 +338,7 @@ get_binding_mode_from_str(const struct sol_str_slice binding)
 static void
 clients_to_delete_clear(struct sol_ptr_vector *to_delete)
 {
-    uint16_t i;
+    uint32_t i;
     struct sol_lwm2m_client_info *cinfo;
 
     SOL_PTR_VECTOR_FOREACH_IDX (to_delete, cinfo, i)
@@ -372,7 +373,7 @@ static struct sol_lwm2m_client_object *
 find_client_object_by_id(struct sol_ptr_vector *objects,
     uint16_t id)
 {
-    uint16_t i;
+    uint32_t i;
     struct sol_lwm2m_client_object *cobject;
 
     SOL_PTR_VECTOR_FOREACH_IDX (objects, cobject, i) {
@@ -394,7 +395,7 @@ fill_client_objects(struct sol_lwm2m_client_info *cinfo,
     uint16_t *instance;
     bool has_content;
     size_t offset;
-    uint16_t i;
+    uint32_t i;
     int r;
 
 #define TO_INT(_data, _endptr, _len, _i, _label) \
@@ -632,7 +633,7 @@ reschedule_timeout(struct sol_lwm2m_server *server)
     struct sol_lwm2m_client_info *cinfo;
     uint32_t smallest_remaining, remaining, lf = 0;
     time_t now;
-    uint16_t i;
+    uint32_t i;
     int r;
 
     clients_to_delete_clear(&server->clients_to_delete);
@@ -681,7 +682,7 @@ lifetime_server_timeout(void *data)
     struct sol_ptr_vector to_delete = SOL_PTR_VECTOR_INIT;
     struct sol_lwm2m_server *server = data;
     struct sol_lwm2m_client_info *cinfo;
-    uint16_t i;
+    uint32_t i;
     int r;
 
     SOL_DBG("Lifetime timeout! (%" PRIu32 ")", server->lifetime_ctx.lifetime);
@@ -838,7 +839,7 @@ get_client_info_by_name(struct sol_ptr_vector *clients,
     const char *name)
 {
     struct sol_lwm2m_client_info *cinfo;
-    uint16_t i;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_IDX (clients, cinfo, i) {
         if (streq(name, cinfo->name))
@@ -951,7 +952,7 @@ static struct observer_entry *
 find_observer_entry(struct sol_ptr_vector *entries,
     struct sol_lwm2m_client_info *cinfo, const char *path)
 {
-    uint16_t i;
+    uint32_t i;
     struct observer_entry *entry;
 
     SOL_PTR_VECTOR_FOREACH_IDX (entries, entry, i) {
@@ -1049,7 +1050,7 @@ err_coap:
 SOL_API void
 sol_lwm2m_server_del(struct sol_lwm2m_server *server)
 {
-    uint16_t i;
+    uint32_t i;
     struct sol_lwm2m_client_info *cinfo;
     struct observer_entry *entry;
 
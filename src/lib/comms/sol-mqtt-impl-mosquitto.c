@@ -19,6 +19,7 @@
 #include <errno.h>
 #include <mosquitto.h>
 #include <stdbool.h>
+#include <sys/ioctl.h>
 
 #define SOL_LOG_DOMAIN &_sol_mqtt_log_domain
 #include <sol-log-internal.h>
@@ -65,6 +66,23 @@ static int init_ref;
 #define MQTT_CHECK_HANDLER_API(ptr, ...)
 #endif
 
+/* Upper bound of packets read from the socket on a single wakeup, so a
+ * busy broker can't starve the other mainloop sources */
+#define MQTT_MAX_READS_PER_WAKEUP 64
+
+/*
+ * Incoming messages are queued in sol_mqtt::message_queue as this
+ * header followed by the nul terminated topic and the payload, and
+ * are delivered all at once on the next mainloop iteration.
+ */
+struct queued_message {
+    size_t topic_len;
+    size_t payload_len;
+    int id;
+    sol_mqtt_qos qos;
+    bool retain;
+};
+
 struct sol_mqtt {
     struct mosquitto *mosq;
 
@@ -77,6 +95,8 @@ struct sol_mqtt {
     struct sol_timeout *unsubscribe_timeout;
     struct sol_timeout *message_timeout;
 
+    struct sol_buffer message_queue;
+
     void *data;
 
     struct sol_mqtt_handlers handlers;
@@ -86,51 +106,10 @@ struct sol_mqtt {
     int connection_status;
 
     time_t keepalive;
-};
-
-static struct sol_mqtt_message *
-sol_mqtt_message_new(const char *topic, const struct sol_buffer *payload, sol_mqtt_qos qos, bool retain)
-{
-    struct sol_mqtt_message *message;
-
-    SOL_NULL_CHECK(topic, NULL);
-    SOL_NULL_CHECK(payload, NULL);
-
-    message = calloc(1, sizeof(struct sol_mqtt_message));
-    SOL_NULL_CHECK(message, NULL);
-
-    SOL_SET_API_VERSION(message->api_version = SOL_MQTT_MESSAGE_API_VERSION, )
-
-    message->topic = sol_util_memdup(topic, strlen(topic) + 1);
-    SOL_NULL_CHECK_GOTO(message->topic, topic_error);
-
-    message->payload = sol_buffer_copy(payload);
-    SOL_NULL_CHECK_GOTO(message->payload, payload_error);
-
-    message->qos = qos;
-    message->retain = retain;
-
-    return message;
-
-payload_error:
-    free(message->topic);
-topic_error:
-    free(message);
 
-    return NULL;
-}
-
-static void
-sol_mqtt_message_free(struct sol_mqtt_message *message)
-{
-    if (!message)
-        return;
-
-    sol_buffer_fini(message->payload);
-    free(message->payload);
-    free(message->topic);
-    free(message);
-}
+    bool dispatching : 1;
+    bool deleted : 1;
+};
 
 static void
 sol_mqtt_init(void)
@@ -157,9 +136,20 @@ static bool
 sol_mqtt_event_loop(void *data, int fd, uint32_t active_flags)
 {
     struct sol_mqtt *mqtt = data;
-    int r;
+    int r, pending = 0;
+    uint16_t reads = 0;
+
+    /* mosquitto reads a single packet per call, so keep reading while
+     * the socket has data instead of waiting for another wakeup for
+     * each packet */
+    do {
+        r = mosquitto_loop_read(mqtt->mosq, 1);
+        if (r != MOSQ_ERR_SUCCESS || ++reads == MQTT_MAX_READS_PER_WAKEUP)
+            break;
+        if (ioctl(fd, FIONREAD, &pending) < 0)
+            break;
+    } while (pending > 0);
 
-    r = mosquitto_loop_read(mqtt->mosq, 1);
     r |= mosquitto_loop_write(mqtt->mosq, 1);
     r |= mosquitto_loop_misc(mqtt->mosq);
 
@@ -251,30 +241,61 @@ sol_mqtt_on_publish(struct mosquitto *mosq, void *data, int id)
     mqtt->publish_timeout = sol_timeout_add(0, sol_mqtt_on_publish_wrapper, mqtt);
 }
 
-struct message_wrapper_data {
-    struct sol_mqtt *mqtt;
-    struct sol_mqtt_message *message;
-};
+static void
+sol_mqtt_free(struct sol_mqtt *mqtt)
+{
+    sol_buffer_fini(&mqtt->message_queue);
+    free(mqtt);
+}
 
 static bool
-sol_mqtt_on_message_wrapper(void *data)
+sol_mqtt_on_message_dispatch(void *data)
 {
-    struct message_wrapper_data *wrapper_data = data;
-    struct sol_mqtt *mqtt = wrapper_data->mqtt;
-    struct sol_mqtt_message *message = wrapper_data->message;
+    struct sol_mqtt *mqtt = data;
+    struct queued_message header;
+    struct sol_mqtt_message message;
+    struct sol_buffer payload;
+    size_t offset = 0;
+    char *mem;
 
-    SOL_NULL_CHECK_GOTO(mqtt, end);
-    SOL_NULL_CHECK_GOTO(message, end);
+    mqtt->message_timeout = NULL;
+    mqtt->dispatching = true;
+
+    /* Messages are views on the queue memory, valid only during the
+     * handler call, so no copies are made for handlers that don't
+     * retain them */
+    while (offset < mqtt->message_queue.used && !mqtt->deleted) {
+        mem = sol_buffer_at(&mqtt->message_queue, offset);
+        memcpy(&header, mem, sizeof(header));
+        mem += sizeof(header);
+
+        payload = SOL_BUFFER_INIT_CONST(mem + header.topic_len + 1,
+            header.payload_len);
+        message = (struct sol_mqtt_message) {
+            SOL_SET_API_VERSION(.api_version = SOL_MQTT_MESSAGE_API_VERSION, )
+            .topic = mem,
+            .payload = &payload,
+            .id = header.id,
+            .qos = header.qos,
+            .retain = header.retain,
+        };
+
+        offset += sizeof(header) + header.topic_len + 1 + header.payload_len;
+
+        mqtt->handlers.message(mqtt->data, mqtt, &message);
+    }
 
-    if (mqtt->handlers.message)
-        mqtt->handlers.message(mqtt->data, mqtt, message);
+    mqtt->dispatching = false;
 
-end:
-    free(wrapper_data);
+    /* sol_mqtt_disconnect() was called from the handler */
+    if (mqtt->deleted) {
+        sol_mqtt_free(mqtt);
+        return false;
+    }
 
-    sol_mqtt_message_free(message);
+    /* Keep the memory around for the next batch */
+    sol_buffer_reset(&mqtt->message_queue);
 
-    mqtt->message_timeout = NULL;
     return false;
 }
 
@@ -282,9 +303,9 @@ static void
 sol_mqtt_on_message(struct mosquitto *mosq, void *data, const struct mosquitto_message *m_message)
 {
     struct sol_mqtt *mqtt = data;
-    struct sol_mqtt_message *message;
-    struct message_wrapper_data *wrapper_data;
-    struct sol_buffer payload;
+    struct queued_message header;
+    size_t used;
+    int r;
 
     SOL_NULL_CHECK(mqtt);
     SOL_NULL_CHECK(m_message);
@@ -292,24 +313,37 @@ sol_mqtt_on_message(struct mosquitto *mosq, void *data, const struct mosquitto_m
     if (!mqtt->handlers.message)
         return;
 
-    wrapper_data = malloc(sizeof(*wrapper_data));
-    SOL_NULL_CHECK(wrapper_data);
-
-    payload = SOL_BUFFER_INIT_CONST(m_message->payload, m_message->payloadlen);
-    message = sol_mqtt_message_new(m_message->topic, &payload, (sol_mqtt_qos)m_message->qos, m_message->retain);
-    SOL_NULL_CHECK_GOTO(message, error);
-
-    message->id = m_message->mid;
+    header = (struct queued_message) {
+        .topic_len = strlen(m_message->topic),
+        .payload_len = m_message->payloadlen,
+        .id = m_message->mid,
+        .qos = (sol_mqtt_qos)m_message->qos,
+        .retain = m_message->retain,
+    };
+
+    used = mqtt->message_queue.used;
+
+    r = sol_buffer_append_bytes(&mqtt->message_queue, (const uint8_t *)&header,
+        sizeof(header));
+    SOL_INT_CHECK_GOTO(r, < 0, error);
+    r = sol_buffer_append_bytes(&mqtt->message_queue,
+        (const uint8_t *)m_message->topic, header.topic_len + 1);
+    SOL_INT_CHECK_GOTO(r, < 0, error);
+    r = sol_buffer_append_bytes(&mqtt->message_queue,
+        m_message->payload, header.payload_len);
+    SOL_INT_CHECK_GOTO(r, < 0, error);
 
-    wrapper_data->mqtt = mqtt;
-    wrapper_data->message = message;
+    if (mqtt->message_timeout)
+        return;
 
-    mqtt->message_timeout = sol_timeout_add(0, sol_mqtt_on_message_wrapper, wrapper_data);
+    mqtt->message_timeout = sol_timeout_add(0, sol_mqtt_on_message_dispatch, mqtt);
+    SOL_NULL_CHECK_GOTO(mqtt->message_timeout, error);
 
     return;
 
 error:
-    free(wrapper_data);
+    SOL_WRN("Unable to queue message from '%s'", m_message->topic);
+    mqtt->message_queue.used = used;
 }
 
 static void
@@ -369,6 +403,8 @@ sol_mqtt_connect(const char *host, uint16_t port, const struct sol_mqtt_config *
 
     mqtt->handlers = config->handlers;
 
+    sol_buffer_init(&mqtt->message_queue);
+
     /* It comes as const, but goes back to user on the callbacks as
      * not const, for convenience */
     mqtt->data = (void *)data;
@@ -496,7 +532,12 @@ sol_mqtt_disconnect(struct sol_mqtt *mqtt)
     mosquitto_disconnect(mqtt->mosq);
 
     mosquitto_destroy(mqtt->mosq);
-    free(mqtt);
+
+    /* Released by sol_mqtt_on_message_dispatch() */
+    if (mqtt->dispatching)
+        mqtt->deleted = true;
+    else
+        sol_mqtt_free(mqtt);
 
     sol_mqtt_shutdown();
 }
@@ -551,3 +592,25 @@ sol_mqtt_subscribe(const struct sol_mqtt *mqtt, const char *topic, sol_mqtt_qos
     return 0;
 }
 
+SOL_API int
+sol_mqtt_unsubscribe(const struct sol_mqtt *mqtt, const char *topic)
+{
+    int r;
+
+    CHECK_INIT(-EINVAL);
+    SOL_NULL_CHECK(mqtt, -EINVAL);
+    SOL_NULL_CHECK(topic, -EINVAL);
+
+    r = mosquitto_unsubscribe(mqtt->mosq, NULL, topic);
+    if (r != MOSQ_ERR_SUCCESS) {
+        SOL_WRN("Unable to unsubscribe from '%s'", topic);
+        return -EINVAL;
+    }
+
+    if (mosquitto_want_write(mqtt->mosq) && !sol_fd_set_flags(mqtt->socket_watch,
+        sol_fd_get_flags(mqtt->socket_watch) | SOL_FD_FLAGS_OUT))
+        return -EINVAL;
+
+    return 0;
+}
+
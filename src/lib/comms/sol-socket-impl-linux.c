@@ -16,7 +16,9 @@
  * limitations under the License.
  */
 
+#include <limits.h>
 #include <netinet/in.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
@@ -354,15 +356,12 @@ is_multicast(enum sol_network_family family, const struct sockaddr *sockaddr)
 }
 
 static int
-sol_socket_linux_sendmsg(struct sol_socket *socket, const void *buf, size_t len,
+sendmsg_iov(struct sol_socket_linux *s, struct iovec *iov, size_t iovlen,
     const struct sol_network_link_addr *cliaddr)
 {
-    struct sol_socket_linux *s = (struct sol_socket_linux *)socket;
     uint8_t sockaddr[sizeof(struct sockaddr_in6)] = { };
-    struct iovec iov = { .iov_base = (void *)buf,
-                         .iov_len = len };
-    struct msghdr msg = { .msg_iov = &iov,
-                          .msg_iovlen = 1 };
+    struct msghdr msg = { .msg_iov = iov,
+                          .msg_iovlen = iovlen };
     socklen_t l;
 
     l = sizeof(struct sockaddr_in6);
@@ -381,6 +380,47 @@ sol_socket_linux_sendmsg(struct sol_socket *socket, const void *buf, size_t len,
     return 0;
 }
 
+static int
+sol_socket_linux_sendmsg(struct sol_socket *socket, const void *buf, size_t len,
+    const struct sol_network_link_addr *cliaddr)
+{
+    struct iovec iov = { .iov_base = (void *)buf,
+                         .iov_len = len };
+
+    return sendmsg_iov((struct sol_socket_linux *)socket, &iov, 1, cliaddr);
+}
+
+/* chains longer than this get their iovec array from the heap */
+#define CHAIN_IOV_STACK_LEN 16
+
+static int
+sol_socket_linux_sendmsg_chain(struct sol_socket *socket, const struct sol_blob_chain *chain,
+    const struct sol_network_link_addr *cliaddr)
+{
+    struct iovec iov_stack[CHAIN_IOV_STACK_LEN], *iov = iov_stack;
+    uint32_t i, len = sol_blob_chain_get_len(chain);
+    struct sol_blob *blob;
+    int r;
+
+    SOL_INT_CHECK(len, > IOV_MAX, -EMSGSIZE);
+
+    if (len > CHAIN_IOV_STACK_LEN) {
+        iov = malloc(len * sizeof(*iov));
+        SOL_NULL_CHECK(iov, -ENOMEM);
+    }
+
+    SOL_BLOB_CHAIN_FOREACH_IDX (chain, blob, i) {
+        iov[i].iov_base = blob->mem;
+        iov[i].iov_len = blob->size;
+    }
+
+    r = sendmsg_iov((struct sol_socket_linux *)socket, iov, len, cliaddr);
+
+    if (iov != iov_stack)
+        free(iov);
+    return r;
+}
+
 static int
 sol_socket_linux_join_group(struct sol_socket *socket, int ifindex, const struct sol_network_link_addr *group)
 {
@@ -508,6 +548,7 @@ sol_socket_linux_get_impl(void)
         .bind = sol_socket_linux_bind,
         .join_group = sol_socket_linux_join_group,
         .sendmsg = sol_socket_linux_sendmsg,
+        .sendmsg_chain = sol_socket_linux_sendmsg_chain,
         .recvmsg = sol_socket_linux_recvmsg,
         .set_on_write = sol_socket_linux_set_on_write,
         .set_on_read = sol_socket_linux_set_on_read,
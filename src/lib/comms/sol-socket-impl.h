@@ -33,6 +33,10 @@ struct sol_socket_impl {
     int (*sendmsg)(struct sol_socket *s, const void *buf, size_t len,
         const struct sol_network_link_addr *cliaddr);
 
+    /* optional, sol_socket_sendmsg_chain() uses sendmsg if missing */
+    int (*sendmsg_chain)(struct sol_socket *s, const struct sol_blob_chain *chain,
+        const struct sol_network_link_addr *cliaddr);
+
     int (*join_group)(struct sol_socket *s, int ifindex, const struct sol_network_link_addr *group);
 
     int (*bind)(struct sol_socket *s, const struct sol_network_link_addr *addr);
@@ -118,6 +118,30 @@ sol_socket_sendmsg(struct sol_socket *s, const void *buf, size_t len,
     return s->impl->sendmsg(s, buf, len, cliaddr);
 }
 
+SOL_API int
+sol_socket_sendmsg_chain(struct sol_socket *s, const struct sol_blob_chain *chain,
+    const struct sol_network_link_addr *cliaddr)
+{
+    struct sol_blob *flat;
+    int r;
+
+    SOL_NULL_CHECK(s, -EINVAL);
+    SOL_NULL_CHECK(chain, -EINVAL);
+
+    if (s->impl->sendmsg_chain)
+        return s->impl->sendmsg_chain(s, chain, cliaddr);
+
+    SOL_NULL_CHECK(s->impl->sendmsg, -ENOSYS);
+
+    flat = sol_blob_chain_flatten(chain);
+    SOL_NULL_CHECK(flat, -ENOMEM);
+
+    r = s->impl->sendmsg(s, flat->mem, flat->size, cliaddr);
+    sol_blob_unref(flat);
+
+    return r;
+}
+
 SOL_API int
 sol_socket_join_group(struct sol_socket *s, int ifindex, const struct sol_network_link_addr *group)
 {
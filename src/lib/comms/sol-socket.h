@@ -19,6 +19,7 @@
 #pragma once
 
 #include "sol-network.h"
+#include "sol-types.h"
 
 struct sol_socket_impl;
 
@@ -61,6 +62,12 @@ ssize_t sol_socket_recvmsg(struct sol_socket *s, void *buf, size_t len, struct s
 int sol_socket_sendmsg(struct sol_socket *s, const void *buf, size_t len,
     const struct sol_network_link_addr *cliaddr);
 
+/* Sends the blobs in @a chain as a single datagram. Implementations
+ * with scatter-gather I/O send it without copying, for the others it
+ * is flattened into a temporary buffer first. */
+int sol_socket_sendmsg_chain(struct sol_socket *s, const struct sol_blob_chain *chain,
+    const struct sol_network_link_addr *cliaddr);
+
 int sol_socket_join_group(struct sol_socket *s, int ifindex, const struct sol_network_link_addr *group);
 
 int sol_socket_bind(struct sol_socket *s, const struct sol_network_link_addr *addr);
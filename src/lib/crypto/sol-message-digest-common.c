@@ -17,8 +17,7 @@
  */
 
 #include <errno.h>
-#include <unistd.h>
-#include <fcntl.h>
+#include <stdint.h>
 
 #include "sol-message-digest-common.h"
 
@@ -37,29 +36,41 @@ sol_message_digest_common_init(void)
     return 0;
 }
 
-void
-sol_message_digest_common_shutdown(void)
-{
-}
-
-#ifdef WORKER_THREAD
-#define MESSAGE_DIGEST_USE_THREAD
+#if defined(WORKER_THREAD) && defined(PTHREAD)
+#define MESSAGE_DIGEST_USE_POOL
 #endif
 
-#if !defined(MESSAGE_DIGEST_USE_THREAD) && !defined(MESSAGE_DIGEST_MAX_FEED_BLOCK_SIZE)
+#ifndef MESSAGE_DIGEST_MAX_FEED_BLOCK_SIZE
 #define MESSAGE_DIGEST_MAX_FEED_BLOCK_SIZE 40960
 #endif
 
+#ifdef MESSAGE_DIGEST_USE_POOL
+#include "sol-task-pool.h"
+
+/* Inputs up to this size are digested from the main thread, larger
+ * ones are handed to a pool of threads shared by all handles.
+ */
+#ifndef MESSAGE_DIGEST_INLINE_MAX
+#define MESSAGE_DIGEST_INLINE_MAX 4096
+#endif
+
+#ifndef MESSAGE_DIGEST_POOL_THREADS
+#define MESSAGE_DIGEST_POOL_THREADS 2
+#endif
 
-#ifdef MESSAGE_DIGEST_USE_THREAD
-#ifdef LINUX
-#include <pthread.h>
-#elif defined(RIOT)
-#include <mutex.h>
-#include <thread.h>
+static struct sol_task_pool *pool;
 #endif
-#include "sol-worker-thread.h"
+
+void
+sol_message_digest_common_shutdown(void)
+{
+#ifdef MESSAGE_DIGEST_USE_POOL
+    if (pool) {
+        sol_task_pool_del(pool);
+        pool = NULL;
+    }
 #endif
+}
 
 struct sol_message_digest_pending_feed {
     struct sol_blob *blob;
@@ -67,32 +78,17 @@ struct sol_message_digest_pending_feed {
     bool is_last;
 };
 
-#ifdef MESSAGE_DIGEST_USE_THREAD
-struct sol_message_digest_pending_dispatch {
-    struct sol_blob *blob;
-    bool is_digest;
-};
-#endif
-
 struct sol_message_digest {
     void (*on_digest_ready)(void *data, struct sol_message_digest *handle, struct sol_blob *output);
     void (*on_feed_done)(void *data, struct sol_message_digest *handle, struct sol_blob *input);
     const void *data;
     const struct sol_message_digest_common_ops *ops;
-#ifdef MESSAGE_DIGEST_USE_THREAD
-    struct sol_worker_thread *thread; /* current kcapi is not poll() friendly, it won't report IN/OUT, thus we use a thread */
-    struct sol_vector pending_dispatch;
-#ifdef LINUX
-    int thread_pipe[2];
-    pthread_mutex_t lock;
-#elif defined(RIOT)
-    kernel_pid_t waiting_pid;
-    char cmd;
-    mutex_t lock;
+#ifdef MESSAGE_DIGEST_USE_POOL
+    struct sol_task *task;
+    struct sol_vector running; /* feeds owned by the task until it's done */
+    uint32_t running_fed;
 #endif
-#else
     struct sol_timeout *timer; /* current kcapi is not poll() friendly, it won't report IN/OUT, thus we use a timer to poll */
-#endif
     struct sol_blob *digest;
     struct sol_vector pending_feed;
     size_t digest_offset;
@@ -102,145 +98,6 @@ struct sol_message_digest {
     bool deleted;
 };
 
-static void
-_sol_message_digest_lock(struct sol_message_digest *handle)
-{
-#ifdef MESSAGE_DIGEST_USE_THREAD
-#ifdef LINUX
-    pthread_mutex_lock(&handle->lock);
-#elif defined(RIOT)
-    mutex_lock(&handle->lock);
-#endif
-#endif
-}
-
-static void
-_sol_message_digest_unlock(struct sol_message_digest *handle)
-{
-#ifdef MESSAGE_DIGEST_USE_THREAD
-#ifdef LINUX
-    pthread_mutex_unlock(&handle->lock);
-#elif defined(RIOT)
-    mutex_unlock(&handle->lock);
-#endif
-#endif
-}
-
-#ifdef MESSAGE_DIGEST_USE_THREAD
-static void
-_sol_message_digest_thread_send(struct sol_message_digest *handle, char cmd)
-{
-#ifdef LINUX
-    while (write(handle->thread_pipe[1], &cmd, 1) != 1) {
-        if (errno != EAGAIN && errno != EINTR) {
-            SOL_WRN("handle %p couldn't send thread command %c: %s",
-                handle, cmd, sol_util_strerrora(errno));
-            return;
-        }
-    }
-#elif defined(RIOT)
-    kernel_pid_t waiting_pid;
-
-    _sol_message_digest_lock(handle);
-    waiting_pid = handle->waiting_pid;
-    handle->waiting_pid = KERNEL_PID_UNDEF;
-    handle->cmd = cmd;
-    _sol_message_digest_unlock(handle);
-    if (waiting_pid != KERNEL_PID_UNDEF)
-        thread_wakeup(waiting_pid);
-#endif
-}
-
-static char
-_sol_message_digest_thread_recv(struct sol_message_digest *handle)
-{
-    char cmd = 0;
-
-#ifdef LINUX
-    while (read(handle->thread_pipe[0], &cmd, 1) != 1) {
-        if (errno != EAGAIN && errno != EINTR) {
-            SOL_WRN("handle %p couldn't receive thread command: %s",
-                handle, sol_util_strerrora(errno));
-            return 0;
-        }
-    }
-#elif defined(RIOT)
-    do {
-        _sol_message_digest_lock(handle);
-        cmd = handle->cmd;
-        handle->cmd = 0;
-        if (!cmd)
-            handle->waiting_pid = thread_getpid();
-        _sol_message_digest_unlock(handle);
-        if (!cmd)
-            thread_sleep();
-    } while (!cmd);
-#endif
-
-    return cmd;
-}
-#endif
-
-static int
-_sol_message_digest_thread_init(struct sol_message_digest *handle)
-{
-#ifdef MESSAGE_DIGEST_USE_THREAD
-    int err = 0;
-
-    sol_vector_init(&handle->pending_dispatch,
-        sizeof(struct sol_message_digest_pending_dispatch));
-#ifdef LINUX
-    if (pipe2(handle->thread_pipe, O_CLOEXEC) < 0)
-        return errno;
-
-    err = pthread_mutex_init(&handle->lock, NULL);
-    if (err) {
-        close(handle->thread_pipe[0]);
-        close(handle->thread_pipe[1]);
-    }
-#elif defined(RIOT)
-    mutex_init(&handle->lock);
-#endif
-    return err;
-#else
-    return 0;
-#endif
-}
-
-static void
-_sol_message_digest_thread_fini(struct sol_message_digest *handle)
-{
-#ifdef MESSAGE_DIGEST_USE_THREAD
-    struct sol_message_digest_pending_dispatch *pd;
-    uint16_t i;
-
-#ifdef LINUX
-    close(handle->thread_pipe[0]);
-    close(handle->thread_pipe[1]);
-    pthread_mutex_destroy(&handle->lock);
-#endif
-
-    SOL_VECTOR_FOREACH_IDX (&handle->pending_dispatch, pd, i) {
-        sol_blob_unref(pd->blob);
-    }
-    sol_vector_clear(&handle->pending_dispatch);
-#else
-    if (handle->timer)
-        sol_timeout_del(handle->timer);
-#endif
-}
-
-static void
-_sol_message_digest_thread_stop(struct sol_message_digest *handle)
-{
-#ifdef MESSAGE_DIGEST_USE_THREAD
-    if (!handle->thread)
-        return;
-    _sol_message_digest_thread_send(handle, 'c');
-    sol_worker_thread_cancel(handle->thread);
-#endif
-}
-
 void *
 sol_message_digest_common_get_context(const struct sol_message_digest *handle)
 {
@@ -258,7 +115,6 @@ sol_message_digest_common_new(const struct sol_message_digest_common_new_params
     const struct sol_message_digest_config *config = params.config;
     struct sol_message_digest *handle;
     size_t padding;
-    int errno_bkp;
 
     SOL_NULL_CHECK(params.ops, NULL);
     SOL_NULL_CHECK(params.ops->feed, NULL);
@@ -286,40 +142,44 @@ sol_message_digest_common_new(const struct sol_message_digest_common_new_params
     handle->data = config->data;
     sol_vector_init(&handle->pending_feed,
         sizeof(struct sol_message_digest_pending_feed));
+#ifdef MESSAGE_DIGEST_USE_POOL
+    sol_vector_init(&handle->running,
+        sizeof(struct sol_message_digest_pending_feed));
+#endif
 
     handle->digest_size = params.digest_size;
 
-    errno = _sol_message_digest_thread_init(handle);
-    if (errno)
-        goto error;
-
     SOL_DBG("handle %p algorithm=\"%s\"", handle, config->algorithm);
 
     errno = 0;
     return handle;
-
-error:
-    errno_bkp = errno;
-    free(handle);
-    errno = errno_bkp;
-    return NULL;
 }
 
 static void
-_sol_message_digest_free(struct sol_message_digest *handle)
+_sol_message_digest_release_feeds(struct sol_vector *feeds)
 {
     struct sol_message_digest_pending_feed *pf;
-    uint16_t i;
+    uint32_t i;
+
+    SOL_VECTOR_FOREACH_IDX (feeds, pf, i) {
+        sol_blob_unref(pf->blob);
+    }
+    sol_vector_clear(feeds);
+}
 
-    SOL_DBG("free handle %p pending_feed=%hu, digest=%p",
+static void
+_sol_message_digest_free(struct sol_message_digest *handle)
+{
+    SOL_DBG("free handle %p pending_feed=%" PRIu32 ", digest=%p",
         handle, handle->pending_feed.len, handle->digest);
 
-    _sol_message_digest_thread_fini(handle);
+    if (handle->timer)
+        sol_timeout_del(handle->timer);
 
-    SOL_VECTOR_FOREACH_IDX (&handle->pending_feed, pf, i) {
-        sol_blob_unref(pf->blob);
-    }
-    sol_vector_clear(&handle->pending_feed);
+    _sol_message_digest_release_feeds(&handle->pending_feed);
+#ifdef MESSAGE_DIGEST_USE_POOL
+    _sol_message_digest_release_feeds(&handle->running);
+#endif
 
     if (handle->digest)
         sol_blob_unref(handle->digest);
@@ -352,15 +212,35 @@ sol_message_digest_del(struct sol_message_digest *handle)
 
     handle->deleted = true;
 
-    _sol_message_digest_thread_stop(handle);
+#ifdef MESSAGE_DIGEST_USE_POOL
+    /* if it's already running, it holds a reference until it's done */
+    if (handle->task)
+        sol_task_pool_cancel(pool, handle->task);
+#endif
 
     SOL_DBG("del handle %p refcnt=%" PRIu32
-        ", pending_feed=%hu, digest=%p",
+        ", pending_feed=%" PRIu32 ", digest=%p",
         handle, handle->refcnt,
         handle->pending_feed.len, handle->digest);
     _sol_message_digest_unref(handle);
 }
 
+static void
+_sol_message_digest_fail(struct sol_message_digest *handle, int err)
+{
+    SOL_WRN("handle %p failed: %s, dropping its pending data",
+        handle, sol_util_strerrora(-err));
+
+    _sol_message_digest_release_feeds(&handle->pending_feed);
+    if (handle->digest) {
+        sol_blob_unref(handle->digest);
+        handle->digest = NULL;
+    }
+
+    /* no digest will ever be delivered, refuse further feeds */
+    handle->finished = true;
+}
+
 static void
 _sol_message_digest_setup_receive_digest(struct sol_message_digest *handle)
 {
@@ -379,6 +259,8 @@ _sol_message_digest_setup_receive_digest(struct sol_message_digest *handle)
         mem, handle->digest_size);
     SOL_NULL_CHECK_GOTO(handle->digest, error);
 
+    handle->digest_offset = 0;
+
     SOL_DBG("handle %p to receive digest of %zd bytes at blob %p mem=%p",
         handle, handle->digest_size,
         handle->digest, handle->digest->mem);
@@ -389,143 +271,76 @@ error:
     free(mem);
 }
 
-static void
-_sol_message_digest_report_feed_blob(struct sol_message_digest *handle, struct sol_blob *input)
-{
-#ifdef MESSAGE_DIGEST_USE_THREAD
-    struct sol_message_digest_pending_dispatch *pd;
-
-    _sol_message_digest_lock(handle);
-
-    pd = sol_vector_append(&handle->pending_dispatch);
-    SOL_NULL_CHECK_GOTO(pd, error);
-    pd->blob = input;
-    pd->is_digest = false;
-
-    _sol_message_digest_unlock(handle);
-    sol_worker_thread_feedback(handle->thread);
-    return;
-
-error:
-    _sol_message_digest_unlock(handle);
-    sol_blob_unref(input); /* this may cause problems if main thread changes blob refcnt */
-
-#else
-    _sol_message_digest_ref(handle);
-
-    if (handle->on_feed_done)
-        handle->on_feed_done((void *)handle->data, handle, input);
-
-    sol_blob_unref(input);
-    _sol_message_digest_unref(handle);
-#endif
-}
-
-static void
-_sol_message_digest_report_digest_ready(struct sol_message_digest *handle)
-{
-#ifdef MESSAGE_DIGEST_USE_THREAD
-    struct sol_message_digest_pending_dispatch *pd;
-
-    _sol_message_digest_lock(handle);
-
-    pd = sol_vector_append(&handle->pending_dispatch);
-    SOL_NULL_CHECK_GOTO(pd, end);
-    pd->blob = handle->digest;
-    pd->is_digest = true;
-
-    handle->digest = NULL;
-
-end:
-    _sol_message_digest_unlock(handle);
-    sol_worker_thread_feedback(handle->thread);
-
-#else
-    _sol_message_digest_ref(handle);
-
-    handle->on_digest_ready((void *)handle->data, handle, handle->digest);
-
-    sol_blob_unref(handle->digest);
-    handle->digest = NULL;
-
-    _sol_message_digest_unref(handle);
-#endif
-}
-
-static void
-_sol_message_digest_feed_blob(struct sol_message_digest *handle)
+/*
+ * Feeds the blobs of @a feeds, starting at index @a *fed, to the
+ * algorithm, at most @a max bytes. If the implementation provides
+ * feed_multiple(), consecutive blobs are given to it in a single call.
+ *
+ * @a *fed is incremented with the number of blobs fully consumed.
+ *
+ * May be called from a pool thread, must not touch anything but the
+ * given feeds and the digest.
+ */
+static ssize_t
+_sol_message_digest_feed_step(struct sol_message_digest *handle, struct sol_vector *feeds, uint32_t *fed, size_t max)
 {
+    struct sol_str_slice slices[SOL_MESSAGE_DIGEST_COMMON_FEED_MULTIPLE_MAX];
     struct sol_message_digest_pending_feed *pf;
-    struct sol_blob *input;
-    const uint8_t *mem;
-    bool is_last;
-    size_t offset, len;
+    size_t count = 0, max_count = 1, total = 0, len;
+    bool is_last = false;
+    uint32_t i;
     ssize_t n;
 
-    _sol_message_digest_lock(handle);
-    pf = sol_vector_get(&handle->pending_feed, 0);
-    SOL_NULL_CHECK_GOTO(pf, error);
-
-    input = pf->blob;
-    mem = input->mem;
-    offset = pf->offset;
-    mem += offset;
-    len = input->size - offset;
-    is_last = pf->is_last;
-
-#ifdef MESSAGE_DIGEST_MAX_FEED_BLOCK_SIZE
-    if (len > MESSAGE_DIGEST_MAX_FEED_BLOCK_SIZE) {
-        len = MESSAGE_DIGEST_MAX_FEED_BLOCK_SIZE;
-        if (is_last)
-            is_last = false;
-    }
-#endif
+    if (handle->ops->feed_multiple)
+        max_count = SOL_UTIL_ARRAY_SIZE(slices);
 
-    _sol_message_digest_unlock(handle);
-
-    n = handle->ops->feed(handle, mem, len, is_last);
-    SOL_DBG("handle %p feed mem=%p (%zd bytes) (pending=%hu) is_last=%hhu:"
-        " %zd bytes",
-        handle, mem, len, handle->pending_feed.len, is_last, n);
-    if (n >= 0) {
-        if (offset + n < input->size) { /* not fully sent, need to try again later */
-            /* fetch first pending again as it's a sol_vector and
-             * calls to sol_message_digest_feed() may realloc() the vector,
-             * resulting in new pointer for the first element.
-             */
-            _sol_message_digest_lock(handle);
-            pf = sol_vector_get(&handle->pending_feed, 0);
-            SOL_NULL_CHECK_GOTO(pf, error);
-            pf->offset += n;
-            _sol_message_digest_unlock(handle);
-            return;
-        }
-
-        if (is_last)
-            _sol_message_digest_setup_receive_digest(handle);
+    for (i = *fed; i < feeds->len && count < max_count && total < max; i++) {
+        pf = sol_vector_get_no_check(feeds, i);
+        len = pf->blob->size - pf->offset;
+        if (len > max - total)
+            len = max - total;
+        else
+            is_last = pf->is_last;
 
-        _sol_message_digest_lock(handle);
-        sol_vector_del(&handle->pending_feed, 0);
-        _sol_message_digest_unlock(handle);
+        slices[count++] = SOL_STR_SLICE_STR((const char *)pf->blob->mem + pf->offset, len);
+        total += len;
+    }
 
-        _sol_message_digest_report_feed_blob(handle, input);
+    if (count == 0)
+        return 0;
 
-    } else {
-        errno = -n;
-        if (errno != EAGAIN && errno != EINTR) {
-            SOL_WRN("couldn't feed handle %p with %p of %zd bytes: %s",
-                handle, mem, len, sol_util_strerrora(errno));
+    if (count > 1)
+        n = handle->ops->feed_multiple(handle, slices, count, is_last);
+    else
+        n = handle->ops->feed(handle, slices[0].data, slices[0].len, is_last);
+
+    SOL_DBG("handle %p fed %zu blobs (%zu bytes) is_last=%hhu: %zd bytes",
+        handle, count, total, is_last, n);
+    if (n < 0)
+        return n;
+
+    total = n;
+    for (i = *fed; count > 0; i++, count--) {
+        pf = sol_vector_get_no_check(feeds, i);
+        len = pf->blob->size - pf->offset;
+        if (total < len) { /* not fully sent, continue from there later */
+            pf->offset += total;
+            break;
         }
-    }
 
-    return;
+        pf->offset += len;
+        total -= len;
+        (*fed)++;
 
-error:
-    _sol_message_digest_unlock(handle);
-    SOL_WRN("no pending feed for handle %p", handle);
+        if (pf->is_last)
+            _sol_message_digest_setup_receive_digest(handle);
+    }
+
+    return n;
 }
 
-static void
+/* May be called from a pool thread, see _sol_message_digest_feed_step() */
+static int
 _sol_message_digest_receive_digest(struct sol_message_digest *handle)
 {
     uint8_t *mem;
@@ -539,165 +354,231 @@ _sol_message_digest_receive_digest(struct sol_message_digest *handle)
     n = handle->ops->read_digest(handle, mem, len);
     SOL_DBG("handle %p read digest mem=%p (%zd bytes): %zd bytes",
         handle, mem, len, n);
-    if (n >= 0) {
-        handle->digest_offset += n;
-        if (handle->digest_offset < handle->digest->size) /* more to do... */
-            return;
+    if (n < 0)
+        return n;
 
-        _sol_message_digest_report_digest_ready(handle);
+    handle->digest_offset += n;
+    return 0;
+}
 
-    } else {
-        errno = -n;
-        if (errno != EAGAIN && errno != EINTR) {
-            SOL_WRN("couldn't recv digest handle %p with %p of %zd bytes: %s",
-                handle, mem, len, sol_util_strerrora(errno));
-        }
-    }
+static inline bool
+_sol_message_digest_is_ready(const struct sol_message_digest *handle)
+{
+    return handle->digest && handle->digest_offset == handle->digest->size;
 }
 
-#ifdef MESSAGE_DIGEST_USE_THREAD
+static inline bool
+_sol_message_digest_is_error(int err)
+{
+    return err < 0 && err != -EAGAIN && err != -EINTR;
+}
 
-static struct sol_blob *
-_sol_message_digest_peek_first_pending_blob(struct sol_message_digest *handle)
+/* Must be called with a reference held, callbacks may delete the handle */
+static void
+_sol_message_digest_report_feeds(struct sol_message_digest *handle, struct sol_vector *feeds, uint32_t count)
 {
     struct sol_message_digest_pending_feed *pf;
-    struct sol_blob *blob = NULL;
-
-    _sol_message_digest_lock(handle);
-    if (handle->pending_feed.len) {
-        pf = sol_vector_get(&handle->pending_feed, 0);
-        if (pf)
-            blob = pf->blob;
+    struct sol_blob *input;
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+        /* fetch it again every time: callbacks may feed more data and
+         * realloc() the vector
+         */
+        pf = sol_vector_get_no_check(feeds, i);
+        input = pf->blob;
+        pf->blob = NULL;
+
+        if (!handle->deleted && handle->on_feed_done)
+            handle->on_feed_done((void *)handle->data, handle, input);
+        sol_blob_unref(input);
     }
-    _sol_message_digest_unlock(handle);
 
-    return blob;
+    while (count-- > 0)
+        sol_vector_del(feeds, 0);
 }
 
-static bool
-_sol_message_digest_thread_iterate(void *data)
+/* Must be called with a reference held, the callback may delete the handle */
+static void
+_sol_message_digest_report_digest_ready(struct sol_message_digest *handle)
 {
-    struct sol_message_digest *handle = data;
-    struct sol_blob *current = NULL;
-    char cmd;
+    struct sol_blob *digest = handle->digest;
 
-    cmd = _sol_message_digest_thread_recv(handle);
-    if (cmd == 'c' || cmd == 0)
-        return false;
+    handle->digest = NULL;
 
-    current = _sol_message_digest_peek_first_pending_blob(handle);
-    while (current && !sol_worker_thread_is_cancelled(handle->thread)) {
-        struct sol_blob *blob;
+    if (!handle->deleted)
+        handle->on_digest_ready((void *)handle->data, handle, digest);
+    sol_blob_unref(digest);
+}
+
+static int _sol_message_digest_schedule(struct sol_message_digest *handle);
 
-        _sol_message_digest_feed_blob(handle);
+#ifdef MESSAGE_DIGEST_USE_POOL
+static size_t
+_sol_message_digest_pending_size(const struct sol_message_digest *handle)
+{
+    const struct sol_message_digest_pending_feed *pf;
+    size_t total = 0;
+    uint32_t i;
 
-        blob = _sol_message_digest_peek_first_pending_blob(handle);
-        if (blob != current)
+    SOL_VECTOR_FOREACH_IDX (&handle->pending_feed, pf, i) {
+        total += pf->blob->size - pf->offset;
+        if (total > MESSAGE_DIGEST_INLINE_MAX)
             break;
     }
 
-    while (handle->digest && !sol_worker_thread_is_cancelled(handle->thread))
-        _sol_message_digest_receive_digest(handle);
-
-    return true;
+    return total;
 }
 
-static void
-_sol_message_digest_thread_finished(void *data)
+static int
+_sol_message_digest_task_work(void *data)
 {
     struct sol_message_digest *handle = data;
+    ssize_t n;
+    int r;
 
-    handle->thread = NULL;
-    _sol_message_digest_unref(handle);
+    while (handle->running_fed < handle->running.len) {
+        n = _sol_message_digest_feed_step(handle, &handle->running,
+            &handle->running_fed, SIZE_MAX);
+        if (n < 0 && _sol_message_digest_is_error(n))
+            return n;
+    }
+
+    while (handle->digest && !_sol_message_digest_is_ready(handle)) {
+        r = _sol_message_digest_receive_digest(handle);
+        if (_sol_message_digest_is_error(r))
+            return r;
+    }
+
+    return 0;
 }
 
 static void
-_sol_message_digest_thread_feedback(void *data)
+_sol_message_digest_task_done(void *data, int status)
 {
     struct sol_message_digest *handle = data;
-    struct sol_message_digest_pending_dispatch *pd;
-    struct sol_vector v;
-    uint16_t i;
 
-    _sol_message_digest_lock(handle);
-    v = handle->pending_dispatch;
-    sol_vector_init(&handle->pending_dispatch,
-        sizeof(struct sol_message_digest_pending_dispatch));
-    _sol_message_digest_unlock(handle);
+    handle->task = NULL;
 
-    _sol_message_digest_ref(handle);
+    _sol_message_digest_report_feeds(handle, &handle->running,
+        handle->running_fed);
+    handle->running_fed = 0;
+    /* leftovers were not fed due to errors or cancellation */
+    _sol_message_digest_release_feeds(&handle->running);
 
-    SOL_VECTOR_FOREACH_IDX (&v, pd, i) {
-        if (!handle->deleted) {
-            if (pd->is_digest)
-                handle->on_digest_ready((void *)handle->data, handle, pd->blob);
-            else if (handle->on_feed_done)
-                handle->on_feed_done((void *)handle->data, handle, pd->blob);
-        }
-        sol_blob_unref(pd->blob);
-    }
+    if (status < 0 && status != -ECANCELED)
+        _sol_message_digest_fail(handle, status);
+    else if (_sol_message_digest_is_ready(handle))
+        _sol_message_digest_report_digest_ready(handle);
+
+    if (!handle->deleted && handle->pending_feed.len > 0)
+        _sol_message_digest_schedule(handle);
 
     _sol_message_digest_unref(handle);
+}
 
-    sol_vector_clear(&v);
+static int
+_sol_message_digest_task_submit(struct sol_message_digest *handle)
+{
+    if (!pool) {
+        pool = sol_task_pool_new(&(struct sol_task_pool_config) {
+                SOL_SET_API_VERSION(.api_version = SOL_TASK_POOL_CONFIG_API_VERSION, )
+                .threads = MESSAGE_DIGEST_POOL_THREADS
+            });
+        SOL_NULL_CHECK(pool, -ENOMEM);
+    }
+
+    /* hand all pending feeds to the task, new ones are queued for the
+     * next batch
+     */
+    handle->running = handle->pending_feed;
+    handle->running_fed = 0;
+    sol_vector_init(&handle->pending_feed,
+        sizeof(struct sol_message_digest_pending_feed));
+
+    handle->task = sol_task_pool_submit(pool, _sol_message_digest_task_work,
+        _sol_message_digest_task_done, handle);
+    if (!handle->task) {
+        handle->pending_feed = handle->running;
+        sol_vector_init(&handle->running,
+            sizeof(struct sol_message_digest_pending_feed));
+        return -ENOMEM;
+    }
+
+    _sol_message_digest_ref(handle);
+    SOL_DBG("handle %p submitted task %p with %" PRIu32 " blobs",
+        handle, handle->task, handle->running.len);
+
+    return 0;
 }
+#endif
 
-#else
 static bool
 _sol_message_digest_on_timer(void *data)
 {
     struct sol_message_digest *handle = data;
-    bool ret;
+    size_t budget = MESSAGE_DIGEST_MAX_FEED_BLOCK_SIZE;
+    uint32_t fed = 0, last_fed;
+    bool ret = false;
+    int r = 0;
 
-    SOL_DBG("handle %p pending=%hu, digest=%p",
+    SOL_DBG("handle %p pending=%" PRIu32 ", digest=%p",
         handle, handle->pending_feed.len, handle->digest);
 
+    if (handle->deleted) {
+        handle->timer = NULL;
+        return false;
+    }
+
     _sol_message_digest_ref(handle);
 
-    if (handle->pending_feed.len > 0)
-        _sol_message_digest_feed_blob(handle);
+#ifdef MESSAGE_DIGEST_USE_POOL
+    if (_sol_message_digest_pending_size(handle) > MESSAGE_DIGEST_INLINE_MAX &&
+        _sol_message_digest_task_submit(handle) == 0)
+        goto end;
+#endif
 
-    if (handle->digest)
-        _sol_message_digest_receive_digest(handle);
+    while (fed < handle->pending_feed.len && budget > 0) {
+        last_fed = fed;
+        r = _sol_message_digest_feed_step(handle, &handle->pending_feed,
+            &fed, budget);
+        if (r < 0 || (r == 0 && fed == last_fed))
+            break;
+        budget -= r;
+    }
+
+    _sol_message_digest_report_feeds(handle, &handle->pending_feed, fed);
+
+    if (!_sol_message_digest_is_error(r) && !handle->deleted && handle->digest) {
+        r = _sol_message_digest_receive_digest(handle);
+        if (_sol_message_digest_is_ready(handle))
+            _sol_message_digest_report_digest_ready(handle);
+    }
 
-    ret = (handle->pending_feed.len > 0 || handle->digest);
+    if (_sol_message_digest_is_error(r) && !handle->deleted)
+        _sol_message_digest_fail(handle, r);
+
+    ret = !handle->deleted &&
+        (handle->pending_feed.len > 0 || handle->digest);
+
+#ifdef MESSAGE_DIGEST_USE_POOL
+end:
+#endif
     if (!ret)
         handle->timer = NULL;
 
     _sol_message_digest_unref(handle);
     return ret;
 }
-#endif
 
 static int
-_sol_message_digest_thread_start(struct sol_message_digest *handle)
+_sol_message_digest_schedule(struct sol_message_digest *handle)
 {
-#ifdef MESSAGE_DIGEST_USE_THREAD
-    struct sol_worker_thread_config config = {
-        SOL_SET_API_VERSION(.api_version = SOL_WORKER_THREAD_CONFIG_API_VERSION, )
-        .data = handle,
-        .iterate = _sol_message_digest_thread_iterate,
-        .finished = _sol_message_digest_thread_finished,
-        .feedback = _sol_message_digest_thread_feedback
-    };
-
-    if (handle->thread)
-        goto end;
-
-    _sol_message_digest_ref(handle);
-    handle->thread = sol_worker_thread_new(&config);
-    SOL_NULL_CHECK_GOTO(handle->thread, error);
-
-end:
-    _sol_message_digest_thread_send(handle, 'a');
-
-    return 0;
-
-error:
-    _sol_message_digest_unref(handle);
-    return -ENOMEM;
+#ifdef MESSAGE_DIGEST_USE_POOL
+    if (handle->task) /* its completion schedules new feeds */
+        return 0;
+#endif
 
-#else
     if (handle->timer)
         return 0;
 
@@ -705,7 +586,6 @@ error:
     SOL_NULL_CHECK(handle->timer, -ENOMEM);
 
     return 0;
-#endif
 }
 
 SOL_API int
@@ -720,23 +600,20 @@ sol_message_digest_feed(struct sol_message_digest *handle, struct sol_blob *inpu
     SOL_INT_CHECK(handle->refcnt, < 1, -EINVAL);
     SOL_NULL_CHECK(input, -EINVAL);
 
-    _sol_message_digest_lock(handle);
     pf = sol_vector_append(&handle->pending_feed);
-    SOL_NULL_CHECK_GOTO(pf, error_append);
+    SOL_NULL_CHECK(pf, -ENOMEM);
 
     pf->blob = sol_blob_ref(input);
     pf->offset = 0;
     pf->is_last = is_last;
 
-    _sol_message_digest_unlock(handle);
-
-    r = _sol_message_digest_thread_start(handle);
+    r = _sol_message_digest_schedule(handle);
     SOL_INT_CHECK_GOTO(r, < 0, error);
 
     if (is_last)
         handle->finished = true;
 
-    SOL_DBG("handle %p blob=%p (%zd bytes), pending %hu",
+    SOL_DBG("handle %p blob=%p (%zd bytes), pending %" PRIu32,
         handle, input, input->size, handle->pending_feed.len);
 
     return 0;
@@ -745,10 +622,5 @@ error:
     sol_blob_unref(input);
     sol_vector_del_last(&handle->pending_feed);
 
-    return -ENOMEM;
-
-error_append:
-    _sol_message_digest_unlock(handle);
-
     return -ENOMEM;
 }
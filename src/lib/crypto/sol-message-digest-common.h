@@ -25,6 +25,14 @@ extern struct sol_log_domain _sol_message_digest_common_log_domain;
 int sol_message_digest_common_init(void);
 void sol_message_digest_common_shutdown(void);
 
+/**
+ * Maximum number of chunks given to
+ * sol_message_digest_common_ops::feed_multiple() at once.
+ *
+ * @internal
+ */
+#define SOL_MESSAGE_DIGEST_COMMON_FEED_MULTIPLE_MAX 16
+
 /**
  * Operations to use with the common message digest implementation.
  *
@@ -35,15 +43,15 @@ struct sol_message_digest_common_ops {
     /**
      * Feed the algorithm with more data (@c mem of @c len bytes).
      *
-     * This function is called from a thread if defined(PTHREAD) &&
-     * defined(WORKER_THREAD), and in such case care may be needed
-     * depending on the platform.
+     * This function is called either from the main thread or, if
+     * defined(PTHREAD) && defined(WORKER_THREAD), from one of the
+     * threads of a pool shared by all handles, and in such case care
+     * may be needed depending on the platform.
      *
-     * It is guaranteed that the same handle is not called from
-     * different worker thread, both @c feed and @c read_digest are
-     * called from the same worker thread, while @c cleanup is called
-     * from the main thread once the worker thread is already
-     * finalized.
+     * It is guaranteed that calls for the same handle never overlap,
+     * but consecutive calls may happen from different threads, while
+     * @c cleanup is called from the main thread once no more calls
+     * are pending.
      *
      * If this function returns less then the requested amount of
      * bytes (@c len), then it is called again with a new @c mem
@@ -58,18 +66,36 @@ struct sol_message_digest_common_ops {
      * @return number of bytes fed or -errno.
      */
     ssize_t (*feed)(struct sol_message_digest *handle, const void *mem, size_t len, bool is_last);
+    /**
+     * Feed the algorithm with multiple consecutive chunks at once.
+     *
+     * Optional, if provided, blobs queued to the same handle are
+     * given in a single call, at most
+     * SOL_MESSAGE_DIGEST_COMMON_FEED_MULTIPLE_MAX of them. Called
+     * under the same conditions as @c feed and may also feed less
+     * than the whole set, in which case it is called again from where
+     * it stopped.
+     *
+     * @param handle the message digest handle feeding the algorithm.
+     * @param slices the chunks of memory to be fed, in order.
+     * @param count the number of @c slices, always more than one.
+     * @param is_last if the last slice is the last chunk to be feed.
+     *
+     * @return number of bytes fed or -errno.
+     */
+    ssize_t (*feed_multiple)(struct sol_message_digest *handle, const struct sol_str_slice *slices, size_t count, bool is_last);
     /**
      * Read the digest from the message.
      *
-     * This function is called from a thread if defined(PTHREAD) &&
-     * defined(WORKER_THREAD), and in such case care may be needed
-     * depending on the platform.
+     * This function is called either from the main thread or, if
+     * defined(PTHREAD) && defined(WORKER_THREAD), from one of the
+     * threads of a pool shared by all handles, and in such case care
+     * may be needed depending on the platform.
      *
-     * It is guaranteed that the same handle is not called from
-     * different worker thread, both @c feed and @c read_digest are
-     * called from the same worker thread, while @c cleanup is called
-     * from the main thread once the worker thread is already
-     * finalized.
+     * It is guaranteed that calls for the same handle never overlap,
+     * but consecutive calls may happen from different threads, while
+     * @c cleanup is called from the main thread once no more calls
+     * are pending.
      *
      * If this function returns less then the requested amount of
      * bytes (@c len), then it is called again with a new @c mem
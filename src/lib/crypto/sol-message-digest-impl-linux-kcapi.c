@@ -23,6 +23,7 @@
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 
 #ifndef AF_ALG
@@ -226,7 +227,7 @@ static const struct sol_message_digest_algorithm_info *
 _sol_message_digest_get_algorithm_info(const char *name)
 {
     struct sol_message_digest_algorithm_info *info;
-    uint16_t i;
+    uint32_t i;
     size_t namelen;
 
     namelen = strlen(name);
@@ -264,6 +265,32 @@ _sol_message_digest_linux_kcapi_feed(struct sol_message_digest *handle, const vo
         return -errno;
 }
 
+static ssize_t
+_sol_message_digest_linux_kcapi_feed_multiple(struct sol_message_digest *handle, const struct sol_str_slice *slices, size_t count, bool is_last)
+{
+    int *pfd = sol_message_digest_common_get_context(handle);
+    struct iovec iov[SOL_MESSAGE_DIGEST_COMMON_FEED_MULTIPLE_MAX];
+    struct msghdr msg = {
+        .msg_iov = iov,
+        .msg_iovlen = count,
+    };
+    ssize_t n;
+    size_t i;
+
+    SOL_INT_CHECK(count, > SOL_UTIL_ARRAY_SIZE(iov), -EINVAL);
+
+    for (i = 0; i < count; i++) {
+        iov[i].iov_base = (void *)slices[i].data;
+        iov[i].iov_len = slices[i].len;
+    }
+
+    n = sendmsg(*pfd, &msg, is_last ? 0 : MSG_MORE);
+    if (n >= 0)
+        return n;
+    else
+        return -errno;
+}
+
 static ssize_t
 _sol_message_digest_linux_kcapi_read_digest(struct sol_message_digest *handle, void *mem, size_t len)
 {
@@ -286,6 +313,7 @@ _sol_message_digest_linux_kcapi_cleanup(struct sol_message_digest *handle)
 
 static const struct sol_message_digest_common_ops _sol_message_digest_linux_kcapi_ops = {
     .feed = _sol_message_digest_linux_kcapi_feed,
+    .feed_multiple = _sol_message_digest_linux_kcapi_feed_multiple,
     .read_digest = _sol_message_digest_linux_kcapi_read_digest,
     .cleanup = _sol_message_digest_linux_kcapi_cleanup
 };
@@ -38,6 +38,11 @@ extern "C" {
  * @brief An arena is an object that does allocation on user's behalf and can
  * deallocate all at once.
  *
+ * Memory is handed out from large chunks, so allocating is usually just
+ * moving a pointer forward and nothing is freed individually: it all
+ * goes away with sol_arena_del(), or back to a point recorded with
+ * sol_arena_get_mark() using sol_arena_reset().
+ *
  * @see Str_Slice
  *
  * @{
@@ -52,6 +57,18 @@ extern "C" {
  */
 struct sol_arena;
 
+/**
+ * @struct sol_arena_mark
+ *
+ * @brief A position in the arena, see sol_arena_get_mark().
+ *
+ * Its members are only meaningful to the arena functions.
+ */
+struct sol_arena_mark {
+    const void *chunk; /**< @brief Chunk in use when the mark was taken */
+    size_t used; /**< @brief Bytes used in that chunk */
+};
+
 /**
  * @brief Creates an Arena.
  *
@@ -69,6 +86,47 @@ struct sol_arena *sol_arena_new(void);
  */
 void sol_arena_del(struct sol_arena *arena);
 
+/**
+ * @brief Allocate memory from the arena.
+ *
+ * The memory is not initialized and is valid until the arena is deleted
+ * or reset to a mark taken before this call.
+ *
+ * @param arena The arena
+ * @param size Number of bytes to allocate, greater than @c 0
+ * @param align Alignment of the returned pointer, a power of two
+ * (e.g. @c __alignof__ of the type to be stored)
+ *
+ * @return The allocated memory, @c NULL with @c errno set on errors
+ */
+void *sol_arena_alloc(struct sol_arena *arena, size_t size, size_t align);
+
+/**
+ * @brief Record the current position of the arena.
+ *
+ * Everything allocated after this can be released at once with
+ * sol_arena_reset().
+ *
+ * @param arena The arena
+ * @param mark Where to store the position
+ */
+void sol_arena_get_mark(const struct sol_arena *arena, struct sol_arena_mark *mark);
+
+/**
+ * @brief Release the memory allocated after a mark was taken.
+ *
+ * Memory allocated before @a mark is kept untouched, and marks taken
+ * after it become invalid.
+ *
+ * @param arena The arena
+ * @param mark Position returned by sol_arena_get_mark(), or @c NULL to
+ * release all the memory allocated by the arena
+ *
+ * @return @c 0 on success, @c -EINVAL if @a mark doesn't belong to the
+ * arena or was already released
+ */
+int sol_arena_reset(struct sol_arena *arena, const struct sol_arena_mark *mark);
+
 /**
  * @brief Store a copy of a given string in the arena.
  *
@@ -94,6 +94,15 @@ enum sol_buffer_flags {
      * SOL_BUFFER_FLAGS_MEMORY_NOT_OWNED
      */
     SOL_BUFFER_FLAGS_CLEAR_MEMORY = (1 << 3) | SOL_BUFFER_FLAGS_MEMORY_NOT_OWNED,
+    /**
+     * @c buf->data is storage not owned by sol_buffer, usually in the
+     * stack, used until it gets too small: then the data is moved to
+     * the heap and the flag cleared, so the buffer works as one with
+     * SOL_BUFFER_FLAGS_DEFAULT. While the storage is used, it implies
+     * SOL_BUFFER_FLAGS_NO_FREE. Can't be used with
+     * SOL_BUFFER_FLAGS_FIXED_CAPACITY or SOL_BUFFER_FLAGS_CLEAR_MEMORY.
+     */
+    SOL_BUFFER_FLAGS_INLINE = (1 << 4) | SOL_BUFFER_FLAGS_NO_FREE,
 };
 
 /**
@@ -195,6 +204,33 @@ enum sol_decode_case {
     uint8_t name_ ## storage[(size_)] = { 0 }; \
     struct sol_buffer name_ = SOL_BUFFER_INIT_FLAGS(name_ ## storage, (size_), SOL_BUFFER_FLAGS_MEMORY_NOT_OWNED)
 
+/**
+ * @def SOL_BUFFER_DECLARE_INLINE(name_, size_)
+ *
+ * @brief A helper macro to create a buffer using inline storage while
+ * its contents fit, growing into the heap after that.
+ *
+ * Meant for short lived buffers that usually take a few bytes, saving
+ * their allocation. As any other buffer, sol_buffer_fini() must be
+ * called when done, while sol_buffer_steal() only succeeds after the
+ * data went to the heap (use sol_buffer_steal_or_copy()).
+ *
+ * This macro will expand into the following code:
+ * @code{.c}
+ * // SOL_BUFFER_DECLARE_INLINE(buf, 64);
+ * uint8_t buf_storage[64] = { 0 };
+ * struct sol_buffer buf = SOL_BUFFER_INIT_FLAGS(buf_storage, 64, SOL_BUFFER_FLAGS_INLINE);
+ * @endcode
+ *
+ * @param name_ The name of the struct sol_buffer variable
+ * @param size_ The capacity of the inline storage
+ *
+ * @see SOL_BUFFER_FLAGS_INLINE
+ */
+#define SOL_BUFFER_DECLARE_INLINE(name_, size_) \
+    uint8_t name_ ## storage[(size_)] = { 0 }; \
+    struct sol_buffer name_ = SOL_BUFFER_INIT_FLAGS(name_ ## storage, (size_), SOL_BUFFER_FLAGS_INLINE)
+
 /**
  * @brief Initializes a @c sol_buffer structure.
  *
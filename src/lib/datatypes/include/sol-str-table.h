@@ -190,6 +190,169 @@ const void *sol_str_table_ptr_lookup_fallback(const struct sol_str_table_ptr *ta
  * @}
  */
 
+/**
+ * @defgroup Str_Table_Hash String table perfect hash
+ * @ingroup Datatypes
+ *
+ * @brief Constant time lookups on @ref Str_Table and @ref Str_Table_Ptr.
+ *
+ * The lookups in @ref sol_str_table_lookup_fallback and
+ * @ref sol_str_table_ptr_lookup_fallback compare the key with every
+ * entry. For tables that are looked up often, a minimal perfect hash
+ * can be declared next to the table: on the first lookup it is built
+ * in the storage declared with it, then every lookup hashes the key
+ * once (twice at most) and compares it to a single entry.
+ *
+ * @code{.c}
+ * static const struct sol_str_table table[] = {
+ *     SOL_STR_TABLE_ITEM("one", 1),
+ *     SOL_STR_TABLE_ITEM("two", 2),
+ *     { }
+ * };
+ * SOL_STR_TABLE_HASH_DECLARE(table_hash, table);
+ *
+ * int16_t v = sol_str_table_hash_lookup_fallback(&table_hash, key, -1);
+ * @endcode
+ *
+ * @note The hash is built by the first lookup, meanwhile lookups from
+ * other threads go through the table as
+ * @ref sol_str_table_lookup_fallback does. If no hash is found for the
+ * table (as when it has repeated keys), it keeps being used that way.
+ *
+ * @{
+ */
+
+/**
+ * @struct sol_str_table_hash
+ *
+ * @brief Perfect hash of a string table.
+ *
+ * Declare it with @ref SOL_STR_TABLE_HASH_DECLARE or
+ * @ref SOL_STR_TABLE_PTR_HASH_DECLARE, its members are private.
+ */
+struct sol_str_table_hash {
+    const void *table; /**< @brief The @c sol_str_table or @c sol_str_table_ptr array */
+    int16_t *displacements; /**< @brief Per bucket seed or entry */
+    uint16_t *entries; /**< @brief Table index of each slot */
+    uint16_t size; /**< @brief Number of entries, without the terminating one */
+    uint8_t kind; /**< @brief Table type */
+    uint8_t state; /**< @brief Whether the hash was built */
+    bool full_key; /**< @brief Whether every byte of the keys is hashed */
+};
+
+/**
+ * @brief Entry count of a table, without the terminating @c { }.
+ *
+ * @param _table A @c sol_str_table or @c sol_str_table_ptr array
+ */
+#define SOL_STR_TABLE_HASH_SIZE(_table) (sizeof(_table) / sizeof((_table)[0]) - 1)
+
+/**
+ * @brief Storage for @ref SOL_STR_TABLE_HASH_DECLARE.
+ */
+#define SOL_STR_TABLE_HASH_DECLARE_KIND(_name, _table, _kind) \
+    static int16_t _name ## _displacements[SOL_STR_TABLE_HASH_SIZE(_table) ? SOL_STR_TABLE_HASH_SIZE(_table) : 1]; \
+    static uint16_t _name ## _entries[SOL_STR_TABLE_HASH_SIZE(_table) ? SOL_STR_TABLE_HASH_SIZE(_table) : 1]; \
+    static struct sol_str_table_hash _name = { \
+        .table = _table, \
+        .displacements = _name ## _displacements, \
+        .entries = _name ## _entries, \
+        .size = SOL_STR_TABLE_HASH_SIZE(_table), \
+        .kind = _kind, \
+    }
+
+/**
+ * @def SOL_STR_TABLE_HASH_DECLARE(_name, _table)
+ *
+ * @brief Declares a perfect hash for a @c sol_str_table array.
+ *
+ * The hash, named @a _name, and its storage are static variables in the
+ * scope the macro is used. @a _table must be an array (not a pointer)
+ * ending with @c { }, and with less than @c INT16_MAX entries.
+ *
+ * @param _name Name of the @c struct sol_str_table_hash variable
+ * @param _table The @c sol_str_table array
+ */
+#define SOL_STR_TABLE_HASH_DECLARE(_name, _table) \
+    SOL_STR_TABLE_HASH_DECLARE_KIND(_name, _table, 0)
+
+/**
+ * @def SOL_STR_TABLE_PTR_HASH_DECLARE(_name, _table_ptr)
+ *
+ * @brief Declares a perfect hash for a @c sol_str_table_ptr array.
+ *
+ * Same as @ref SOL_STR_TABLE_HASH_DECLARE, to be used with
+ * @ref sol_str_table_ptr_hash_lookup_fallback.
+ *
+ * @param _name Name of the @c struct sol_str_table_hash variable
+ * @param _table_ptr The @c sol_str_table_ptr array
+ */
+#define SOL_STR_TABLE_PTR_HASH_DECLARE(_name, _table_ptr) \
+    SOL_STR_TABLE_HASH_DECLARE_KIND(_name, _table_ptr, 1)
+
+/**
+ * @brief Same as @ref sol_str_table_lookup_fallback, using a perfect hash.
+ *
+ * @param hash Hash declared with @ref SOL_STR_TABLE_HASH_DECLARE
+ * @param key Key to search
+ * @param fallback Fallback value
+ *
+ * @return If @c key is found, return it's value, otherwise @c fallback is returned.
+ */
+int16_t sol_str_table_hash_lookup_fallback(struct sol_str_table_hash *hash,
+    const struct sol_str_slice key,
+    int16_t fallback) SOL_ATTR_NONNULL(1);
+
+/**
+ * @def sol_str_table_hash_lookup(_hash, _key, _pval)
+ *
+ * @brief Same as @ref sol_str_table_lookup, using a perfect hash.
+ *
+ * @param _hash Hash declared with @ref SOL_STR_TABLE_HASH_DECLARE
+ * @param _key Key to search
+ * @param _pval Pointer that will hold the found value
+ */
+#define sol_str_table_hash_lookup(_hash, _key, _pval) ({ \
+        int16_t _v = sol_str_table_hash_lookup_fallback(_hash, _key, INT16_MAX); \
+        if (_v != INT16_MAX) \
+            *_pval = _v; \
+        _v != INT16_MAX; \
+    })
+
+/**
+ * @brief Same as @ref sol_str_table_ptr_lookup_fallback, using a perfect hash.
+ *
+ * @param hash Hash declared with @ref SOL_STR_TABLE_PTR_HASH_DECLARE
+ * @param key Key to search
+ * @param fallback Fallback pointer
+ *
+ * @return If @c key is found, return it's value, otherwise @c fallback is returned.
+ */
+const void *sol_str_table_ptr_hash_lookup_fallback(struct sol_str_table_hash *hash,
+    const struct sol_str_slice key,
+    const void *fallback) SOL_ATTR_NONNULL(1);
+
+/**
+ * @def sol_str_table_ptr_hash_lookup(_hash, _key, _pval)
+ *
+ * @brief Same as @ref sol_str_table_ptr_lookup, using a perfect hash.
+ *
+ * @param _hash Hash declared with @ref SOL_STR_TABLE_PTR_HASH_DECLARE
+ * @param _key Key to search
+ * @param _pval Pointer to pointer that will hold the found value
+ */
+#define sol_str_table_ptr_hash_lookup(_hash, _key, _pval) ({ \
+        const void *_v = sol_str_table_ptr_hash_lookup_fallback(_hash, \
+            _key, NULL); \
+        if (_v != NULL) \
+            *_pval = _v; \
+        _v != NULL; \
+    })
+
+/**
+ * @}
+ */
+
 #ifdef __cplusplus
 }
 #endif
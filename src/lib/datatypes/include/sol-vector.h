@@ -37,7 +37,12 @@ extern "C" {
  * @ingroup Datatypes
  *
  * @brief Soletta vector is an array that grows dynamically. It's suited for
- * storing a small set of contiguous data.
+ * storing contiguous data, up to @c INT32_MAX elements.
+ *
+ * Its capacity doubles whenever it's exhausted and is halved only after
+ * the length drops to a quarter of it, so appending and removing the
+ * last element take amortized constant time, even when alternating
+ * around a power of two.
  *
  * @warning Its dynamic resize might shuffle the data around, so pointers returned from
  * sol_vector_get() and sol_vector_append() should be considered invalid
@@ -59,8 +64,9 @@ extern "C" {
  */
 struct sol_vector {
     void *data; /**< @brief Vector data */
-    uint16_t len; /**< @brief Vector length */
+    uint32_t len; /**< @brief Vector length */
     uint16_t elem_size; /**< @brief Size of each element in bytes */
+    uint32_t capacity; /**< @brief Number of elements allocated, managed by the vector functions */
 };
 
 /**
@@ -68,7 +74,7 @@ struct sol_vector {
  * @brief Helper macro to initialize a @c sol_vector structure to hold
  * elements of type @c TYPE.
  */
-#define SOL_VECTOR_INIT(TYPE) { NULL, 0, sizeof(TYPE) }
+#define SOL_VECTOR_INIT(TYPE) { NULL, 0, sizeof(TYPE), 0 }
 
 /**
  * @brief Initializes a @c sol_vector structure.
@@ -105,7 +111,7 @@ void *sol_vector_append(struct sol_vector *v);
  *
  * @remark Time complexity: amortized linear in the number of elements appended
  */
-void *sol_vector_append_n(struct sol_vector *v, uint16_t n);
+void *sol_vector_append_n(struct sol_vector *v, uint32_t n);
 
 /**
  * @brief Return the element of the vector at the given index (no safety checks).
@@ -124,13 +130,13 @@ void *sol_vector_append_n(struct sol_vector *v, uint16_t n);
  * @see sol_vector_get()
  */
 static inline void *
-sol_vector_get_no_check(const struct sol_vector *v, uint16_t i)
+sol_vector_get_no_check(const struct sol_vector *v, uint32_t i)
 {
     const unsigned char *data;
 
     data = (const unsigned char *)v->data;
 
-    return (void *)&data[v->elem_size * i];
+    return (void *)&data[(size_t)v->elem_size * i];
 }
 
 /**
@@ -144,7 +150,7 @@ sol_vector_get_no_check(const struct sol_vector *v, uint16_t i)
  * @remark Time complexity: constant
  */
 static inline void *
-sol_vector_get(const struct sol_vector *v, uint16_t i)
+sol_vector_get(const struct sol_vector *v, uint32_t i)
 {
     if (i >= v->len)
         return NULL;
@@ -164,7 +170,7 @@ sol_vector_get(const struct sol_vector *v, uint16_t i)
  *
  * @remark Time complexity: linear in distance between @a i and the end of the vector
  */
-int sol_vector_del(struct sol_vector *v, uint16_t i);
+int sol_vector_del(struct sol_vector *v, uint32_t i);
 
 /**
  * @brief Remove an element from the vector.
@@ -226,6 +232,7 @@ sol_vector_take_data(struct sol_vector *v)
 
     v->data = NULL;
     v->len = 0;
+    v->capacity = 0;
     return data;
 }
 
@@ -304,7 +311,7 @@ struct sol_ptr_vector {
  * @def SOL_PTR_VECTOR_INIT
  * @brief Helper macro to initialize a @c struct @c sol_ptr_vector.
  */
-#define SOL_PTR_VECTOR_INIT { { NULL, 0, sizeof(void *) } }
+#define SOL_PTR_VECTOR_INIT { { NULL, 0, sizeof(void *), 0 } }
 
 /**
  * @brief Initializes a @c sol_ptr_vector structure.
@@ -326,7 +333,7 @@ sol_ptr_vector_init(struct sol_ptr_vector *pv)
  *
  * @remark Time complexity: linear in the number of elements @c n
  */
-int sol_ptr_vector_init_n(struct sol_ptr_vector *pv, uint16_t n);
+int sol_ptr_vector_init_n(struct sol_ptr_vector *pv, uint32_t n);
 
 /**
  * @brief Returns the number of pointers stored in the vector.
@@ -337,7 +344,7 @@ int sol_ptr_vector_init_n(struct sol_ptr_vector *pv, uint16_t n);
  *
  * @remark Time complexity: constant
  */
-static inline uint16_t
+static inline uint32_t
 sol_ptr_vector_get_len(const struct sol_ptr_vector *pv)
 {
     return pv->base.len;
@@ -374,7 +381,7 @@ int sol_ptr_vector_append(struct sol_ptr_vector *pv, const void *ptr);
  * @see sol_ptr_vector_get()
  */
 static inline void *
-sol_ptr_vector_get_no_check(const struct sol_ptr_vector *pv, uint16_t i)
+sol_ptr_vector_get_no_check(const struct sol_ptr_vector *pv, uint32_t i)
 {
     void **data;
 
@@ -393,7 +400,7 @@ sol_ptr_vector_get_no_check(const struct sol_ptr_vector *pv, uint16_t i)
  * @remark Time complexity: constant
  */
 static inline void *
-sol_ptr_vector_get(const struct sol_ptr_vector *pv, uint16_t i)
+sol_ptr_vector_get(const struct sol_ptr_vector *pv, uint32_t i)
 {
     if (i >= pv->base.len)
         return NULL;
@@ -412,7 +419,7 @@ sol_ptr_vector_get(const struct sol_ptr_vector *pv, uint16_t i)
  *
  * @remark Time complexity: constant
  */
-int sol_ptr_vector_set(struct sol_ptr_vector *pv, uint16_t i, const void *ptr);
+int sol_ptr_vector_set(struct sol_ptr_vector *pv, uint32_t i, const void *ptr);
 
 /**
  * @brief Insert a pointer in the pointer vector, using the given comparison function
@@ -463,7 +470,7 @@ int32_t sol_ptr_vector_insert_sorted(struct sol_ptr_vector *pv, const void *ptr,
  * @remark Time complexity: linear in number of elements between updated position and the
  * end of the vector or logarithmic in the size of the vector, whichever is greater
  */
-int32_t sol_ptr_vector_update_sorted(struct sol_ptr_vector *pv, uint16_t i, int (*compare_cb)(const void *data1, const void *data2));
+int32_t sol_ptr_vector_update_sorted(struct sol_ptr_vector *pv, uint32_t i, int (*compare_cb)(const void *data1, const void *data2));
 
 /**
  * @brief Insert a pointer in the pointer vector at a given position.
@@ -489,7 +496,7 @@ int32_t sol_ptr_vector_update_sorted(struct sol_ptr_vector *pv, uint16_t i, int
  * @see sol_ptr_vector_find_first_sorted()
  * @see sol_ptr_vector_find_last_sorted()
  */
-int sol_ptr_vector_insert_at(struct sol_ptr_vector *pv, uint16_t i, const void *ptr);
+int sol_ptr_vector_insert_at(struct sol_ptr_vector *pv, uint32_t i, const void *ptr);
 
 /**
  * @brief Remove an pointer from the vector.
@@ -527,7 +534,7 @@ int sol_ptr_vector_remove(struct sol_ptr_vector *pv, const void *ptr);
  * @see sol_ptr_vector_find_sorted()
  */
 static inline int
-sol_ptr_vector_del(struct sol_ptr_vector *pv, uint16_t i)
+sol_ptr_vector_del(struct sol_ptr_vector *pv, uint32_t i)
 {
     return sol_vector_del(&pv->base, i);
 }
@@ -575,7 +582,7 @@ sol_ptr_vector_del_last(struct sol_ptr_vector *pv)
  * @remark Time complexity: linear in distance between @a i and the end of the vector
  */
 static inline void *
-sol_ptr_vector_take(struct sol_ptr_vector *pv, uint16_t i)
+sol_ptr_vector_take(struct sol_ptr_vector *pv, uint32_t i)
 {
     void *result = sol_ptr_vector_get(pv, i);
 
@@ -697,7 +704,7 @@ sol_ptr_vector_take_data(struct sol_ptr_vector *pv)
 static inline int
 sol_ptr_vector_find_last(const struct sol_ptr_vector *pv, const void *elem)
 {
-    uint16_t i;
+    uint32_t i;
     const void *p;
 
     SOL_PTR_VECTOR_FOREACH_REVERSE_IDX (pv, p, i) {
@@ -730,7 +737,7 @@ sol_ptr_vector_find_last(const struct sol_ptr_vector *pv, const void *elem)
 static inline int
 sol_ptr_vector_find_first(const struct sol_ptr_vector *pv, const void *elem)
 {
-    uint16_t i;
+    uint32_t i;
     const void *p;
 
     SOL_PTR_VECTOR_FOREACH_IDX (pv, p, i) {
@@ -768,7 +775,7 @@ sol_ptr_vector_find_first(const struct sol_ptr_vector *pv, const void *elem)
 static inline int32_t
 sol_ptr_vector_match_first(const struct sol_ptr_vector *pv, const void *elem, int (*compare_cb)(const void *data1, const void *data2))
 {
-    uint16_t i;
+    uint32_t i;
     const void *p;
 
     SOL_PTR_VECTOR_FOREACH_IDX (pv, p, i) {
@@ -806,7 +813,7 @@ sol_ptr_vector_match_first(const struct sol_ptr_vector *pv, const void *elem, in
 static inline int32_t
 sol_ptr_vector_match_last(const struct sol_ptr_vector *pv, const void *elem, int (*compare_cb)(const void *data1, const void *data2))
 {
-    uint16_t i;
+    uint32_t i;
     const void *p;
 
     SOL_PTR_VECTOR_FOREACH_REVERSE_IDX (pv, p, i) {
@@ -883,7 +890,7 @@ int32_t sol_ptr_vector_match_sorted(const struct sol_ptr_vector *pv, const void
 static inline int32_t
 sol_ptr_vector_find_sorted(const struct sol_ptr_vector *pv, const void *elem, int (*compare_cb)(const void *data1, const void *data2))
 {
-    uint16_t i;
+    uint32_t i;
     int32_t r;
 
     r = sol_ptr_vector_match_sorted(pv, elem, compare_cb);
@@ -939,7 +946,7 @@ sol_ptr_vector_find_sorted(const struct sol_ptr_vector *pv, const void *elem, in
 static inline int32_t
 sol_ptr_vector_find_last_sorted(const struct sol_ptr_vector *pv, const void *elem, int (*compare_cb)(const void *data1, const void *data2))
 {
-    uint16_t i;
+    uint32_t i;
     int32_t r, found_i = -ENODATA;
 
     r = sol_ptr_vector_match_sorted(pv, elem, compare_cb);
@@ -998,7 +1005,7 @@ sol_ptr_vector_find_last_sorted(const struct sol_ptr_vector *pv, const void *ele
 static inline int32_t
 sol_ptr_vector_find_first_sorted(const struct sol_ptr_vector *pv, const void *elem, int (*compare_cb)(const void *data1, const void *data2))
 {
-    uint16_t i;
+    uint32_t i;
     int32_t r, found_i = -ENODATA;
 
     r = sol_ptr_vector_match_sorted(pv, elem, compare_cb);
@@ -23,11 +23,26 @@
 #include "sol-arena.h"
 #include "sol-util-internal.h"
 
-/* TODO: check if it's worthwhile to implement this as a single
- * growing buffer. */
+/* Memory is handed out from chunks by bumping an offset, only freed
+ * when the arena is deleted or reset. Chunks start small, as most
+ * arenas hold a handful of names, and double up to ARENA_CHUNK_MAX;
+ * larger allocations get a chunk of their own size.
+ */
+#define ARENA_CHUNK_MIN (512 - sizeof(struct arena_chunk))
+#define ARENA_CHUNK_MAX (64 * 1024 - sizeof(struct arena_chunk))
+
+struct arena_chunk {
+    struct arena_chunk *prev;
+    size_t size;
+    size_t used;
+    unsigned char data[];
+};
 
 struct sol_arena {
-    struct sol_ptr_vector str_vector;
+    struct arena_chunk *current;
+    /* kept by sol_arena_reset() so a reused arena doesn't malloc() again */
+    struct arena_chunk *spare;
+    size_t next_size;
 };
 
 SOL_API struct sol_arena *
@@ -38,48 +53,134 @@ sol_arena_new(void)
     arena = calloc(1, sizeof(struct sol_arena));
     SOL_NULL_CHECK(arena, NULL);
 
-    sol_ptr_vector_init(&arena->str_vector);
+    arena->next_size = ARENA_CHUNK_MIN;
     return arena;
 }
 
+static void
+arena_chunks_free(struct arena_chunk *chunk, const struct arena_chunk *until)
+{
+    while (chunk != until) {
+        struct arena_chunk *prev = chunk->prev;
+
+        free(chunk);
+        chunk = prev;
+    }
+}
+
 SOL_API void
 sol_arena_del(struct sol_arena *arena)
 {
-    char *s;
-    uint16_t i;
-
     SOL_NULL_CHECK(arena);
 
-    SOL_PTR_VECTOR_FOREACH_IDX (&arena->str_vector, s, i)
-        free(s);
-
-    sol_ptr_vector_clear(&arena->str_vector);
+    arena_chunks_free(arena->current, NULL);
+    free(arena->spare);
     free(arena);
 }
 
-SOL_API int
-sol_arena_slice_dup_str_n(struct sol_arena *arena, struct sol_str_slice *dst, const char *str, size_t n)
+static struct arena_chunk *
+arena_chunk_new(struct sol_arena *arena, size_t needed)
 {
-    struct sol_str_slice slice;
+    struct arena_chunk *chunk;
+    size_t size, total;
     int r;
 
-    SOL_NULL_CHECK(arena, -EINVAL);
-    SOL_NULL_CHECK(str, -EINVAL);
-    SOL_INT_CHECK(n, <= 0, -EINVAL);
+    if (arena->spare && arena->spare->size >= needed) {
+        chunk = arena->spare;
+        arena->spare = NULL;
+        goto end;
+    }
+
+    size = needed > arena->next_size ? needed : arena->next_size;
+    r = sol_util_size_add(size, sizeof(struct arena_chunk), &total);
+    if (r < 0) {
+        errno = -r;
+        return NULL;
+    }
+
+    chunk = malloc(total);
+    SOL_NULL_CHECK(chunk, NULL);
+    chunk->size = size;
+
+    if (arena->next_size < ARENA_CHUNK_MAX / 2)
+        arena->next_size *= 2;
+    else
+        arena->next_size = ARENA_CHUNK_MAX;
+
+end:
+    chunk->used = 0;
+    chunk->prev = arena->current;
+    arena->current = chunk;
+    return chunk;
+}
+
+static inline size_t
+arena_chunk_align(const struct arena_chunk *chunk, size_t align)
+{
+    uintptr_t p = (uintptr_t)(chunk->data + chunk->used);
 
-    slice.data = strndup(str, n);
-    SOL_NULL_CHECK(slice.data, -errno);
+    return chunk->used + (((p + align - 1) & ~((uintptr_t)align - 1)) - p);
+}
 
-    slice.len = n;
+static void *
+arena_alloc(struct sol_arena *arena, size_t size, size_t align)
+{
+    struct arena_chunk *chunk = arena->current;
+    size_t offset, needed;
+    int r;
 
-    r = sol_ptr_vector_append(&arena->str_vector, (char *)slice.data);
+    if (chunk) {
+        offset = arena_chunk_align(chunk, align);
+        if (offset <= chunk->size && size <= chunk->size - offset)
+            goto end;
+    }
+
+    r = sol_util_size_add(size, align - 1, &needed);
     if (r < 0) {
-        free((char *)slice.data);
-        return r;
+        errno = -r;
+        return NULL;
     }
 
-    *dst = slice;
-    return 0;
+    chunk = arena_chunk_new(arena, needed);
+    if (!chunk)
+        return NULL;
+    offset = arena_chunk_align(chunk, align);
+
+end:
+    chunk->used = offset + size;
+    return chunk->data + offset;
+}
+
+SOL_API void *
+sol_arena_alloc(struct sol_arena *arena, size_t size, size_t align)
+{
+    if (!arena || !size || !align || (align & (align - 1))) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    return arena_alloc(arena, size, align);
+}
+
+static char *
+arena_memdup(struct sol_arena *arena, const char *str, size_t len)
+{
+    char *result;
+
+    result = arena_alloc(arena, len + 1, 1);
+    if (!result)
+        return NULL;
+
+    memcpy(result, str, len);
+    result[len] = '\0';
+    return result;
+}
+
+SOL_API int
+sol_arena_slice_dup_str_n(struct sol_arena *arena, struct sol_str_slice *dst, const char *str, size_t n)
+{
+    SOL_NULL_CHECK(str, -EINVAL);
+    return sol_arena_slice_dup(arena, dst, SOL_STR_SLICE_STR(str, strnlen(str, n)));
 }
 
 SOL_API int
@@ -92,30 +193,62 @@ sol_arena_slice_dup_str(struct sol_arena *arena, struct sol_str_slice *dst, cons
 SOL_API int
 sol_arena_slice_dup(struct sol_arena *arena, struct sol_str_slice *dst, struct sol_str_slice slice)
 {
-    return sol_arena_slice_dup_str_n(arena, dst, slice.data, slice.len);
+    char *data;
+
+    SOL_NULL_CHECK(arena, -EINVAL);
+    SOL_NULL_CHECK(dst, -EINVAL);
+    SOL_NULL_CHECK(slice.data, -EINVAL);
+    SOL_INT_CHECK(slice.len, <= 0, -EINVAL);
+
+    data = arena_memdup(arena, slice.data, slice.len);
+    SOL_NULL_CHECK(data, -errno);
+
+    *dst = SOL_STR_SLICE_STR(data, slice.len);
+    return 0;
 }
 
 SOL_API int
 sol_arena_slice_sprintf(struct sol_arena *arena, struct sol_str_slice *dst, const char *fmt, ...)
 {
-    va_list ap;
-    char *str;
+    struct arena_chunk *chunk;
+    va_list ap, ap_copy;
+    size_t offset = 0, avail = 0;
+    char *str = NULL;
     int r;
 
-    va_start(ap, fmt);
-    r = vasprintf(&str, fmt, ap);
-    va_end(ap);
-    SOL_INT_CHECK(r, < 0, r);
+    SOL_NULL_CHECK(arena, -EINVAL);
+    SOL_NULL_CHECK(dst, -EINVAL);
+    SOL_NULL_CHECK(fmt, -EINVAL);
 
-    dst->data = str;
-    dst->len = r;
+    /* try to print right into the current chunk first */
+    chunk = arena->current;
+    if (chunk && chunk->used < chunk->size) {
+        offset = chunk->used;
+        avail = chunk->size - offset;
+        str = (char *)chunk->data + offset;
+    }
 
-    r = sol_ptr_vector_append(&arena->str_vector, str);
+    va_start(ap, fmt);
+    va_copy(ap_copy, ap);
+    r = vsnprintf(str, avail, fmt, ap);
+    va_end(ap);
     if (r < 0) {
-        free(str);
-        return r;
+        va_end(ap_copy);
+        return -EINVAL;
+    }
+
+    if ((size_t)r < avail) {
+        chunk->used = offset + r + 1;
+    } else {
+        str = arena_alloc(arena, (size_t)r + 1, 1);
+        if (str)
+            vsnprintf(str, (size_t)r + 1, fmt, ap_copy);
     }
+    va_end(ap_copy);
+    SOL_NULL_CHECK(str, -errno);
 
+    dst->data = str;
+    dst->len = r;
     return 0;
 }
 
@@ -129,23 +262,11 @@ sol_arena_strdup(struct sol_arena *arena, const char *str)
 SOL_API char *
 sol_arena_strndup(struct sol_arena *arena, const char *str, size_t n)
 {
-    char *result;
-    int r;
-
     SOL_NULL_CHECK(arena, NULL);
     SOL_NULL_CHECK(str, NULL);
     SOL_INT_CHECK(n, <= 0, NULL);
 
-    result = strndup(str, n);
-    SOL_NULL_CHECK(result, NULL);
-
-    r = sol_ptr_vector_append(&arena->str_vector, result);
-    if (r < 0) {
-        free(result);
-        return NULL;
-    }
-
-    return result;
+    return arena_memdup(arena, str, strnlen(str, n));
 }
 
 SOL_API char *
@@ -153,3 +274,48 @@ sol_arena_strdup_slice(struct sol_arena *arena, const struct sol_str_slice slice
 {
     return sol_arena_strndup(arena, slice.data, slice.len);
 }
+
+SOL_API void
+sol_arena_get_mark(const struct sol_arena *arena, struct sol_arena_mark *mark)
+{
+    SOL_NULL_CHECK(arena);
+    SOL_NULL_CHECK(mark);
+
+    mark->chunk = arena->current;
+    mark->used = arena->current ? arena->current->used : 0;
+}
+
+SOL_API int
+sol_arena_reset(struct sol_arena *arena, const struct sol_arena_mark *mark)
+{
+    struct arena_chunk *chunk, *until = NULL;
+
+    SOL_NULL_CHECK(arena, -EINVAL);
+
+    if (mark && mark->chunk) {
+        for (chunk = arena->current; chunk; chunk = chunk->prev) {
+            if (chunk == mark->chunk)
+                break;
+        }
+        SOL_NULL_CHECK(chunk, -EINVAL);
+        SOL_INT_CHECK(mark->used, > chunk->used, -EINVAL);
+        until = chunk;
+    }
+
+    while (arena->current != until) {
+        chunk = arena->current;
+        arena->current = chunk->prev;
+
+        if (!arena->spare || arena->spare->size < chunk->size) {
+            free(arena->spare);
+            arena->spare = chunk;
+        } else {
+            free(chunk);
+        }
+    }
+
+    if (until)
+        until->used = mark->used;
+
+    return 0;
+}
@@ -30,12 +30,41 @@ nul_byte_size(const struct sol_buffer *buf)
     return (buf->flags & SOL_BUFFER_FLAGS_NO_NUL_BYTE) ? 0 : 1;
 }
 
+/* Inline storage isn't shrunk, when too small the data goes to the heap */
+static int
+inline_resize(struct sol_buffer *buf, size_t new_size)
+{
+    char *new_data;
+
+    if (new_size <= buf->capacity) {
+        if (buf->used > new_size)
+            buf->used = new_size;
+        return 0;
+    }
+
+    new_data = malloc(new_size);
+    if (!new_data)
+        return -errno;
+
+    if (buf->capacity)
+        memcpy(new_data, buf->data, buf->capacity);
+
+    buf->data = new_data;
+    buf->capacity = new_size;
+    buf->flags &= ~SOL_BUFFER_FLAGS_INLINE;
+    return 0;
+}
+
 SOL_API int
 sol_buffer_resize(struct sol_buffer *buf, size_t new_size)
 {
     char *new_data;
 
     SOL_NULL_CHECK(buf, -EINVAL);
+
+    if ((buf->flags & SOL_BUFFER_FLAGS_INLINE) == SOL_BUFFER_FLAGS_INLINE)
+        return inline_resize(buf, new_size);
+
     SOL_EXP_CHECK(buf->flags & SOL_BUFFER_FLAGS_MEMORY_NOT_OWNED, -EPERM);
 
     if (buf->capacity == new_size)
@@ -310,9 +339,7 @@ end:
 SOL_API int
 sol_buffer_insert_vprintf(struct sol_buffer *buf, size_t pos, const char *fmt, va_list args)
 {
-    char *s;
-    ssize_t len;
-    struct sol_str_slice slice;
+    SOL_BUFFER_DECLARE_INLINE(tmp, 128);
     int r;
 
     SOL_NULL_CHECK(buf, -EINVAL);
@@ -322,13 +349,11 @@ sol_buffer_insert_vprintf(struct sol_buffer *buf, size_t pos, const char *fmt, v
     if (pos == buf->used)
         return sol_buffer_append_vprintf(buf, fmt, args);
 
-    len = vasprintf(&s, fmt, args);
-    if (len < 0)
-        return -errno;
+    r = sol_buffer_append_vprintf(&tmp, fmt, args);
+    if (r == 0)
+        r = sol_buffer_insert_bytes(buf, pos, tmp.data, tmp.used);
 
-    slice = SOL_STR_SLICE_STR(s, len);
-    r = sol_buffer_insert_slice(buf, pos, slice);
-    free(s);
+    sol_buffer_fini(&tmp);
     return r;
 }
 
@@ -383,13 +408,14 @@ sol_buffer_copy(const struct sol_buffer *buf)
     b_copy = sol_util_memdup(buf, sizeof(*buf));
     if (!b_copy) return NULL;
 
-    b_copy->data = sol_util_memdup(buf->data, buf->used + nul_byte_size(buf));
+    b_copy->capacity = buf->used + nul_byte_size(buf);
+    b_copy->data = sol_util_memdup(buf->data, b_copy->capacity);
     if (!b_copy->data) {
         free(b_copy);
         return NULL;
     }
 
-    b_copy->flags &= ~SOL_BUFFER_FLAGS_NO_FREE;
+    b_copy->flags &= ~SOL_BUFFER_FLAGS_INLINE;
 
     return b_copy;
 }
@@ -17,7 +17,9 @@
  */
 
 #include <inttypes.h>
+#include <stdlib.h>
 
+#include "sol-log.h"
 #include "sol-macros.h"
 #include "sol-str-table.h"
 #include "sol-util-internal.h"
@@ -63,3 +65,319 @@ sol_str_table_ptr_lookup_fallback(const struct sol_str_table_ptr *table,
     }
     return fallback;
 }
+
+/* Kinds as given by SOL_STR_TABLE_HASH_DECLARE_KIND() */
+enum table_kind {
+    TABLE_KIND_INT = 0,
+    TABLE_KIND_PTR = 1
+};
+
+enum hash_state {
+    HASH_STATE_PENDING = 0,
+    HASH_STATE_BUILDING,
+    HASH_STATE_READY,
+    HASH_STATE_LINEAR
+};
+
+static inline void
+entry_get_key(const struct sol_str_table_hash *hash, uint16_t i, const char **key, size_t *len)
+{
+    if (hash->kind == TABLE_KIND_PTR) {
+        const struct sol_str_table_ptr *entry = (const struct sol_str_table_ptr *)hash->table + i;
+
+        *key = entry->key;
+        *len = entry->len;
+    } else {
+        const struct sol_str_table *entry = (const struct sol_str_table *)hash->table + i;
+
+        *key = entry->key;
+        *len = entry->len;
+    }
+}
+
+/*
+ * Keys are told apart by their length and first and last bytes, so
+ * hashing doesn't depend on the key length. Tables with keys that
+ * differ only in the middle hash every byte instead (FNV-1a).
+ */
+static inline uint64_t
+key_hash(const struct sol_str_table_hash *hash, const char *key, size_t len)
+{
+    uint64_t h, a, b;
+    uint32_t a32, b32;
+    size_t i;
+
+    if (SOL_UNLIKELY(hash->full_key)) {
+        h = 14695981039346656037ULL;
+        for (i = 0; i < len; i++) {
+            h ^= (uint8_t)key[i];
+            h *= 1099511628211ULL;
+        }
+    } else {
+        if (len >= sizeof(a)) {
+            memcpy(&a, key, sizeof(a));
+            memcpy(&b, key + len - sizeof(b), sizeof(b));
+        } else if (len >= sizeof(a32)) {
+            memcpy(&a32, key, sizeof(a32));
+            memcpy(&b32, key + len - sizeof(b32), sizeof(b32));
+            a = a32;
+            b = b32;
+        } else if (len > 0) {
+            a = (uint8_t)key[0] | (uint8_t)key[len / 2] << 8 |
+                (uint8_t)key[len - 1] << 16;
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+        h = a ^ ((b << 29) | (b >> 35)) ^ (len * 0x9e3779b97f4a7c15ULL);
+    }
+
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/* maps to [0, n) without a division */
+static inline uint16_t
+hash_reduce(uint32_t h, uint16_t n)
+{
+    return ((uint64_t)h * n) >> 32;
+}
+
+static inline uint16_t
+hash_bucket(uint64_t h, uint16_t n)
+{
+    return hash_reduce(h >> 32, n);
+}
+
+/* slot of a key in a bucket with displacement d, the key isn't hashed again */
+static inline uint16_t
+hash_slot(uint64_t h, uint16_t d, uint16_t n)
+{
+    h ^= d * 0x9e3779b97f4a7c15ULL;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    return hash_reduce(h >> 32, n);
+}
+
+/*
+ * Hash and displace: the keys are split into buckets, then, from the
+ * largest bucket, a displacement placing all of its keys in free slots
+ * is searched for. Buckets with a single key get the free slots left,
+ * kept as -(slot + 1), so nothing has to be searched for them. Empty
+ * buckets are 0.
+ */
+static bool
+hash_place(struct sol_str_table_hash *hash, uint64_t *hashes, uint16_t *scratch)
+{
+    uint16_t *count, *start, *members, *slots, *used;
+    uint16_t n = hash->size, i, j, k, b, d, size, max_count = 0, free_slot;
+
+    count = scratch;
+    start = count + n;
+    members = start + n + 1;
+    slots = members + n;
+    used = slots + n;
+    memset(scratch, 0, (5 * (size_t)n + 1) * sizeof(uint16_t));
+
+    for (i = 0; i < n; i++) {
+        b = hash_bucket(hashes[i], n);
+        count[b]++;
+        if (count[b] > max_count)
+            max_count = count[b];
+    }
+
+    for (b = 0; b < n; b++)
+        start[b + 1] = start[b] + count[b];
+    for (i = 0; i < n; i++) {
+        b = hash_bucket(hashes[i], n);
+        members[start[b + 1] - count[b]] = i;
+        count[b]--;
+    }
+
+    for (size = max_count; size > 1; size--) {
+        for (b = 0; b < n; b++) {
+            const uint16_t *m = members + start[b];
+
+            if (start[b + 1] - start[b] != size)
+                continue;
+
+            for (d = 1; d < INT16_MAX; d++) {
+                for (j = 0; j < size; j++) {
+                    slots[j] = hash_slot(hashes[m[j]], d, n);
+                    if (used[slots[j]])
+                        break;
+                    for (k = 0; k < j; k++) {
+                        if (slots[k] == slots[j])
+                            break;
+                    }
+                    if (k < j)
+                        break;
+                }
+                if (j == size)
+                    break;
+            }
+            if (d == INT16_MAX)
+                return false;
+
+            hash->displacements[b] = d;
+            for (j = 0; j < size; j++) {
+                used[slots[j]] = 1;
+                hash->entries[slots[j]] = m[j];
+            }
+        }
+    }
+
+    free_slot = 0;
+    for (b = 0; b < n; b++) {
+        if (start[b + 1] - start[b] != 1) {
+            if (start[b + 1] == start[b])
+                hash->displacements[b] = 0;
+            continue;
+        }
+
+        while (used[free_slot])
+            free_slot++;
+        used[free_slot] = 1;
+        hash->entries[free_slot] = members[start[b]];
+        hash->displacements[b] = -(int16_t)free_slot - 1;
+    }
+
+    return true;
+}
+
+static bool
+hash_build(struct sol_str_table_hash *hash)
+{
+    uint16_t n = hash->size, i;
+    uint64_t *hashes;
+    const char *key;
+    size_t len;
+    bool ret = false;
+
+    if (n == 0)
+        return true;
+
+    if (n >= INT16_MAX) {
+        SOL_WRN("Table %p has too many entries (%" PRIu16 ") to be hashed",
+            hash->table, n);
+        return false;
+    }
+
+    entry_get_key(hash, n, &key, &len);
+    if (key) {
+        SOL_WRN("Table %p doesn't end after its %" PRIu16 " entries",
+            hash->table, n);
+        return false;
+    }
+
+    hashes = malloc(n * sizeof(uint64_t) + (5 * (size_t)n + 1) * sizeof(uint16_t));
+    SOL_NULL_CHECK(hashes, false);
+
+    for (hash->full_key = false;; hash->full_key = true) {
+        for (i = 0; i < n; i++) {
+            entry_get_key(hash, i, &key, &len);
+            if (!key) {
+                SOL_WRN("Table %p ends before its %" PRIu16 " entries",
+                    hash->table, n);
+                goto end;
+            }
+            hashes[i] = key_hash(hash, key, len);
+        }
+
+        ret = hash_place(hash, hashes, (uint16_t *)(hashes + n));
+        if (ret || hash->full_key)
+            break;
+    }
+
+    if (!ret)
+        SOL_WRN("No perfect hash found for table %p, are there repeated keys?",
+            hash->table);
+
+end:
+    free(hashes);
+    return ret;
+}
+
+/* The first lookup builds the hash, others meanwhile go linear */
+static bool
+hash_is_ready(struct sol_str_table_hash *hash)
+{
+    uint8_t state = __atomic_load_n(&hash->state, __ATOMIC_ACQUIRE);
+
+    if (SOL_LIKELY(state == HASH_STATE_READY))
+        return true;
+    if (state != HASH_STATE_PENDING)
+        return false;
+
+    if (!__atomic_compare_exchange_n(&hash->state, &state, HASH_STATE_BUILDING,
+        false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        return false;
+
+    state = hash_build(hash) ? HASH_STATE_READY : HASH_STATE_LINEAR;
+    __atomic_store_n(&hash->state, state, __ATOMIC_RELEASE);
+    return state == HASH_STATE_READY;
+}
+
+/* Returns the index of the entry with @a key or -1 */
+static inline int32_t
+hash_find(const struct sol_str_table_hash *hash, const struct sol_str_slice key)
+{
+    const char *entry_key;
+    size_t entry_len;
+    uint64_t h;
+    uint16_t slot;
+    int16_t d;
+
+    if (SOL_UNLIKELY(key.len > INT16_MAX) || hash->size == 0)
+        return -1;
+
+    h = key_hash(hash, key.data, key.len);
+    d = hash->displacements[hash_bucket(h, hash->size)];
+    if (d == 0)
+        return -1;
+    if (d < 0)
+        slot = -(d + 1);
+    else
+        slot = hash_slot(h, d, hash->size);
+
+    entry_get_key(hash, hash->entries[slot], &entry_key, &entry_len);
+    if (entry_len != key.len || memcmp(entry_key, key.data, entry_len) != 0)
+        return -1;
+
+    return hash->entries[slot];
+}
+
+SOL_API int16_t
+sol_str_table_hash_lookup_fallback(struct sol_str_table_hash *hash,
+    const struct sol_str_slice key,
+    int16_t fallback)
+{
+    const struct sol_str_table *table = hash->table;
+    int32_t i;
+
+    SOL_INT_CHECK(hash->kind, != TABLE_KIND_INT, fallback);
+
+    if (!hash_is_ready(hash))
+        return sol_str_table_lookup_fallback(table, key, fallback);
+
+    i = hash_find(hash, key);
+    return i < 0 ? fallback : table[i].val;
+}
+
+SOL_API const void *
+sol_str_table_ptr_hash_lookup_fallback(struct sol_str_table_hash *hash,
+    const struct sol_str_slice key,
+    const void *fallback)
+{
+    const struct sol_str_table_ptr *table = hash->table;
+    int32_t i;
+
+    SOL_INT_CHECK(hash->kind, != TABLE_KIND_PTR, fallback);
+
+    if (!hash_is_ready(hash))
+        return sol_str_table_ptr_lookup_fallback(table, key, fallback);
+
+    i = hash_find(hash, key);
+    return i < 0 ? fallback : table[i].val;
+}
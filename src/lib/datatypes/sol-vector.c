@@ -30,33 +30,42 @@ sol_vector_init(struct sol_vector *v, uint16_t elem_size)
     v->data = NULL;
     v->len = 0;
     v->elem_size = elem_size;
+    v->capacity = 0;
 }
 
 static int
-sol_vector_grow(struct sol_vector *v, uint16_t amount)
+sol_vector_realloc(struct sol_vector *v, uint32_t cap)
 {
-    size_t new_cap, old_cap;
-    uint16_t new_len;
+    void *data;
+    size_t data_size;
+    int r;
 
-    if (v->len > UINT16_MAX - amount)
-        return -EOVERFLOW;
+    r = sol_util_size_mul(v->elem_size, cap, &data_size);
+    SOL_INT_CHECK(r, < 0, r);
 
-    new_len = v->len + amount;
-    old_cap = align_power2(v->len);
-    new_cap = align_power2(new_len);
+    data = realloc(v->data, data_size);
+    if (!data)
+        return -ENOMEM;
 
-    if (new_cap != old_cap) {
-        void *data;
-        int r;
-        size_t data_size;
+    v->data = data;
+    v->capacity = cap;
+    return 0;
+}
 
-        r = sol_util_size_mul(v->elem_size, new_cap, &data_size);
-        SOL_INT_CHECK(r, < 0, r);
+static int
+sol_vector_grow(struct sol_vector *v, uint32_t amount)
+{
+    uint32_t new_len;
 
-        data = realloc(v->data, data_size);
-        if (!data)
-            return -ENOMEM;
-        v->data = data;
+    /* keeps indexes representable by the int32_t returned by finders */
+    if (amount > INT32_MAX || v->len > INT32_MAX - amount)
+        return -EOVERFLOW;
+
+    new_len = v->len + amount;
+    if (new_len > v->capacity) {
+        int r = sol_vector_realloc(v, align_power2_uint(new_len));
+        if (r < 0)
+            return r;
     }
 
     v->len = new_len;
@@ -70,7 +79,7 @@ sol_vector_append(struct sol_vector *v)
 }
 
 SOL_API void *
-sol_vector_append_n(struct sol_vector *v, uint16_t n)
+sol_vector_append_n(struct sol_vector *v, uint32_t n)
 {
     void *new_elems;
     int err;
@@ -86,38 +95,35 @@ sol_vector_append_n(struct sol_vector *v, uint16_t n)
         return NULL;
     }
 
-    new_elems = (unsigned char *)v->data + (v->elem_size * (v->len - n));
+    new_elems = (unsigned char *)v->data + ((size_t)v->elem_size * (v->len - n));
     memset(new_elems, 0, (size_t)v->elem_size * n);
 
     return new_elems;
 }
 
+/* Only halves the capacity once it's 4 times the length, so deleting
+ * right after appending around a power of two doesn't realloc() every
+ * time.
+ */
 static void
 sol_vector_shrink(struct sol_vector *v)
 {
-    unsigned int new_cap, old_cap;
-    void *data;
-
     if (v->len == 0) {
         free(v->data);
         v->data = NULL;
+        v->capacity = 0;
         return;
     }
 
-    old_cap = align_power2(v->len + 1U);
-    new_cap = align_power2(v->len);
-    if (new_cap == old_cap)
+    if (v->len > v->capacity / 4)
         return;
 
-    data = realloc(v->data, new_cap * v->elem_size);
-    if (!data)
-        return;
-
-    v->data = data;
+    /* keeping the larger buffer is fine if realloc() fails */
+    sol_vector_realloc(v, v->capacity / 2);
 }
 
 SOL_API int
-sol_vector_del(struct sol_vector *v, uint16_t i)
+sol_vector_del(struct sol_vector *v, uint32_t i)
 {
     size_t tail_len;
 
@@ -130,7 +136,7 @@ sol_vector_del(struct sol_vector *v, uint16_t i)
     if (tail_len) {
         unsigned char *data, *dst, *src;
         data = v->data;
-        dst = &data[v->elem_size * i];
+        dst = &data[(size_t)v->elem_size * i];
         src = dst + v->elem_size;
         memmove(dst, src, v->elem_size * tail_len);
     }
@@ -145,13 +151,14 @@ sol_vector_clear(struct sol_vector *v)
     free(v->data);
     v->data = NULL;
     v->len = 0;
+    v->capacity = 0;
 }
 
 /* this function returns an approximate match if dir != 0. */
-static uint16_t
-ptr_vector_find_sorted(const struct sol_ptr_vector *pv, uint16_t low, uint16_t high, const void *ptr, int (*compare)(const void *data1, const void *data2), int *dir)
+static uint32_t
+ptr_vector_find_sorted(const struct sol_ptr_vector *pv, uint32_t low, uint32_t high, const void *ptr, int (*compare)(const void *data1, const void *data2), int *dir)
 {
-    uint16_t mid;
+    uint32_t mid;
 
     *dir = compare(ptr, sol_ptr_vector_get_no_check(pv, low));
     if (*dir <= 0 || low == high)
@@ -167,7 +174,7 @@ ptr_vector_find_sorted(const struct sol_ptr_vector *pv, uint16_t low, uint16_t h
             return low;
         }
 
-        mid = ((uint32_t)low + (uint32_t)high) >> 1;
+        mid = low + (high - low) / 2;
         *dir = compare(ptr, sol_ptr_vector_get_no_check(pv, mid));
         if (*dir == 0)
             return mid;
@@ -179,7 +186,7 @@ ptr_vector_find_sorted(const struct sol_ptr_vector *pv, uint16_t low, uint16_t h
 }
 
 SOL_API int
-sol_ptr_vector_insert_at(struct sol_ptr_vector *pv, uint16_t i, const void *ptr)
+sol_ptr_vector_insert_at(struct sol_ptr_vector *pv, uint32_t i, const void *ptr)
 {
     unsigned char *data, *dst, *src;
 
@@ -192,8 +199,8 @@ sol_ptr_vector_insert_at(struct sol_ptr_vector *pv, uint16_t i, const void *ptr)
         return -ENOMEM;
 
     data = pv->base.data;
-    dst = &data[pv->base.elem_size * (i + 1)];
-    src = &data[pv->base.elem_size * i];
+    dst = &data[(size_t)pv->base.elem_size * (i + 1)];
+    src = &data[(size_t)pv->base.elem_size * i];
     memmove(dst, src, (size_t)pv->base.elem_size * (pv->base.len - 1 - i));
 
     return sol_ptr_vector_set(pv, i, ptr);
@@ -228,7 +235,7 @@ sol_ptr_vector_insert_sorted(struct sol_ptr_vector *pv, const void *ptr, int (*c
 }
 
 SOL_API int32_t
-sol_ptr_vector_update_sorted(struct sol_ptr_vector *pv, uint16_t i, int (*compare_cb)(const void *data1, const void *data2))
+sol_ptr_vector_update_sorted(struct sol_ptr_vector *pv, uint32_t i, int (*compare_cb)(const void *data1, const void *data2))
 {
     void *ptr, *other;
     size_t tail_len;
@@ -261,7 +268,7 @@ fix_it:
     if (tail_len) {
         unsigned char *data, *dst, *src;
         data = pv->base.data;
-        dst = &data[pv->base.elem_size * i];
+        dst = &data[(size_t)pv->base.elem_size * i];
         src = dst + pv->base.elem_size;
         memmove(dst, src, pv->base.elem_size * tail_len);
     }
@@ -273,7 +280,7 @@ SOL_API int32_t
 sol_ptr_vector_match_sorted(const struct sol_ptr_vector *pv, const void *elem, int (*compare_cb)(const void *data1, const void *data2))
 {
     int dir;
-    uint16_t i;
+    uint32_t i;
 
     if (!pv->base.len) {
         return -ENODATA;
@@ -299,7 +306,7 @@ sol_ptr_vector_append(struct sol_ptr_vector *pv, const void *ptr)
 }
 
 SOL_API int
-sol_ptr_vector_set(struct sol_ptr_vector *pv, uint16_t i, const void *ptr)
+sol_ptr_vector_set(struct sol_ptr_vector *pv, uint32_t i, const void *ptr)
 {
     void **data;
 
@@ -322,7 +329,7 @@ sol_ptr_vector_remove(struct sol_ptr_vector *pv, const void *ptr)
 }
 
 SOL_API int
-sol_ptr_vector_init_n(struct sol_ptr_vector *pv, uint16_t n)
+sol_ptr_vector_init_n(struct sol_ptr_vector *pv, uint32_t n)
 {
     sol_vector_init(&pv->base, sizeof(void *));
     if (!sol_vector_append_n(&pv->base, n))
@@ -350,7 +357,7 @@ SOL_API int
 sol_ptr_vector_del_element(struct sol_ptr_vector *pv, const void *elem)
 {
     int r;
-    uint16_t i, removed = 0;
+    uint32_t i, removed = 0;
     void *cur;
 
     SOL_PTR_VECTOR_FOREACH_REVERSE_IDX (pv, cur, i)
@@ -1254,9 +1254,10 @@ get_member_alignment(const struct sol_flow_node_options_member_description *memb
         SOL_STR_TABLE_ITEM("string", __alignof__(member->defvalue.s)),
         { }
     };
+    SOL_STR_TABLE_HASH_DECLARE(alignments_hash, alignments);
 
     t = SOL_STR_SLICE_STR(member->data_type, strlen(member->data_type));
-    return sol_str_table_lookup_fallback(alignments, t, __alignof__(void *));
+    return sol_str_table_hash_lookup_fallback(&alignments_hash, t, __alignof__(void *));
 }
 
 SOL_API int
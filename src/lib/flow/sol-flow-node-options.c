@@ -668,6 +668,7 @@ static const struct sol_str_table member_str_to_type[] = {
     SOL_STR_TABLE_ITEM("string", SOL_FLOW_NODE_OPTIONS_MEMBER_STRING),
     {}
 };
+SOL_STR_TABLE_HASH_DECLARE(member_str_to_type_hash, member_str_to_type);
 
 /* TODO: Change type description to use the enum and remove this
  * function. */
@@ -676,7 +677,7 @@ sol_flow_node_options_member_type_from_string(const char *data_type)
 {
     if (!data_type)
         return SOL_FLOW_NODE_OPTIONS_MEMBER_UNKNOWN;
-    return sol_str_table_lookup_fallback(member_str_to_type,
+    return sol_str_table_hash_lookup_fallback(&member_str_to_type_hash,
         sol_str_slice_from_str(data_type), SOL_FLOW_NODE_OPTIONS_MEMBER_UNKNOWN);
 }
 
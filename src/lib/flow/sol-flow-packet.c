@@ -1148,6 +1148,7 @@ sol_flow_packet_get_packet_type_as_string(const struct sol_str_slice type)
         SOL_STR_TABLE_PTR_ITEM("http-response", "SOL_FLOW_PACKET_TYPE_HTTP_RESPONSE"),
         { }
     };
+    SOL_STR_TABLE_PTR_HASH_DECLARE(map_hash, map);
 
-    return sol_str_table_ptr_lookup_fallback(map, type, NULL);
+    return sol_str_table_ptr_hash_lookup_fallback(&map_hash, type, NULL);
 }
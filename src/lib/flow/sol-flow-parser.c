@@ -277,7 +277,8 @@ append_node_options(
     const struct sol_flow_node_type *type,
     struct sol_flow_node_named_options *named_opts)
 {
-    struct sol_buffer key = SOL_BUFFER_INIT_EMPTY, value = SOL_BUFFER_INIT_EMPTY;
+    SOL_BUFFER_DECLARE_INLINE(key, 64);
+    SOL_BUFFER_DECLARE_INLINE(value, 128);
     struct sol_flow_node_named_options result;
     struct sol_flow_node_named_options_member *m;
     struct sol_fbp_meta *meta;
@@ -810,9 +811,11 @@ build_flow(struct parse_state *state)
     struct sol_fbp_exported_port *ep;
     struct sol_fbp_option *opt;
     struct sol_flow_node_type *type = NULL;
-    struct sol_buffer src_port_buf = SOL_BUFFER_INIT_EMPTY, dst_port_buf = SOL_BUFFER_INIT_EMPTY;
-    struct sol_buffer opt_name_buf = SOL_BUFFER_INIT_EMPTY;
-    int i, err = 0;
+    SOL_BUFFER_DECLARE_INLINE(src_port_buf, 64);
+    SOL_BUFFER_DECLARE_INLINE(dst_port_buf, 64);
+    SOL_BUFFER_DECLARE_INLINE(opt_name_buf, 64);
+    uint32_t i;
+    int err = 0;
 
     fbp_error = sol_fbp_parse(state->input, &state->graph);
     if (fbp_error) {
@@ -73,6 +73,16 @@ int sol_efivars_write_raw(const char *name, struct sol_blob *blob,
  */
 int sol_efivars_read_raw(const char *name, struct sol_buffer *buffer);
 
+/**
+ * @brief Number of EFI variable writes not completed yet.
+ *
+ * Variables are written from a worker thread, as firmware storage may
+ * take a long time to commit them.
+ *
+ * @return number of writes in flight
+ */
+unsigned int sol_efivars_get_queue_depth(void);
+
 /**
  * @brief Macro to create a struct @ref sol_buffer with value passed as argument
  * and flags SOL_BUFFER_FLAGS_MEMORY_NOT_OWNED and SOL_BUFFER_FLAGS_NO_NUL_BYTE.
@@ -44,9 +44,124 @@ extern "C" {
  * current directory. Property name is used as file name, so it can
  * contain a path - like 'foo/bar'.
  *
+ * Alternatively, properties written with sol_fs_log_write_raw() are
+ * kept in a single append-only log file instead: writes issued within the
+ * configured flush interval are appended as one batch followed by a
+ * single fdatasync(), every record carries a CRC32 so a torn tail left
+ * by a power cut is detected and discarded on the next open, and the
+ * log is compacted to its live records once it grows past the
+ * configured threshold. Properties not found in the log are still
+ * looked up as plain files, so existing data keeps being readable.
+ *
  * @{
  */
 
+/**
+ * @brief Log-structured storage configuration.
+ *
+ * @see sol_fs_log_open()
+ */
+struct sol_fs_log_config {
+#ifndef SOL_NO_API_VERSION
+#define SOL_FS_LOG_CONFIG_API_VERSION (1)
+    /**
+     * Should always be set to SOL_FS_LOG_CONFIG_API_VERSION
+     */
+    uint16_t api_version;
+#endif
+    /**
+     * Path of the log file, created if missing.
+     */
+    const char *path;
+    /**
+     * Time, in milliseconds, writes are held before being appended and
+     * synced to the log. All writes issued in this window cost a single
+     * write() and fdatasync(). Zero flushes on the next main loop
+     * iteration.
+     */
+    uint32_t flush_interval;
+    /**
+     * Log size, in bytes, past which it is compacted when at least
+     * half of it is made of superseded records. Zero means 64KiB.
+     */
+    size_t compaction_threshold;
+};
+
+/**
+ * @brief Open the log-structured storage.
+ *
+ * From this point on, sol_fs_log_write_raw() and sol_fs_log_read_raw()
+ * store and fetch properties from the log file. sol_fs_write_raw(),
+ * sol_fs_read_raw() and the typed helpers keep using one file per
+ * property. Calls are reference counted: opening again with the same
+ * path (or with @c NULL config) just takes a new reference.
+ *
+ * @param config the log configuration, or @c NULL to use the defaults:
+ * path given by @c SOL_FS_LOG_PATH environment variable, falling back
+ * to "sol-fs-storage.log", and a flush interval of 100 milliseconds.
+ *
+ * @return 0 on success, -EBUSY if a log with a different path is
+ * already open, other negative errno on failure.
+ *
+ * @see sol_fs_log_close()
+ */
+int sol_fs_log_open(const struct sol_fs_log_config *config);
+
+/**
+ * @brief Release a reference to the log-structured storage.
+ *
+ * When the last reference is gone, pending writes are flushed and the
+ * log is closed.
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int sol_fs_log_close(void);
+
+/**
+ * @brief Flush pending writes to the log right away.
+ *
+ * Write callbacks are called before this function returns.
+ *
+ * @return 0 on success, negative errno on failure
+ */
+int sol_fs_log_flush(void);
+
+/**
+ * @brief Writes blob contents to the log-structured storage.
+ *
+ * Writes are batched, @c cb is called once the batch holding this one
+ * is on disk. A newer write to the same property before that cancels
+ * this one, and @c cb is then called with -ECANCELED.
+ *
+ * @param name name of property
+ * @param blob blob that will be written
+ * @param cb callback to be called when writing finishes. It contains status
+ * of writing: if failed, is lesser than zero.
+ * @param data user data to be sent to callback @c cb
+ *
+ * @return 0 on success, -EBADF if the log isn't open, other negative
+ * errno on failure.
+ *
+ * @see sol_fs_log_open()
+ */
+int sol_fs_log_write_raw(const char *name, struct sol_blob *blob,
+    void (*cb)(void *data, const char *name, struct sol_blob *blob, int status),
+    const void *data);
+
+/**
+ * @brief Read contents of a property from the log-structured storage.
+ *
+ * Properties not found in the log are looked up with sol_fs_read_raw(),
+ * so values stored before the log was used are still found.
+ *
+ * @param name name of property
+ * @param buffer buffer that will be set with read contents.
+ *
+ * @return 0 on success, -EBADF if the log isn't open, other negative
+ * errno on failure.
+ */
+int sol_fs_log_read_raw(const char *name, struct sol_buffer *buffer);
+
 /**
  * @brief Writes buffer contents to storage.
  *
@@ -77,6 +192,18 @@ int sol_fs_write_raw(const char *name, struct sol_blob *blob,
  */
 int sol_fs_read_raw(const char *name, struct sol_buffer *buffer);
 
+/**
+ * @brief Number of writes being done by the storage I/O worker.
+ *
+ * Files are written from a worker thread, so blocking on a slow device
+ * doesn't stall the main loop. This is how many writes were handed to
+ * it and didn't complete yet, a growing number means the device can't
+ * keep up with the write rate.
+ *
+ * @return number of writes in flight
+ */
+unsigned int sol_fs_get_queue_depth(void);
+
 /**
  * @brief Macro to create a struct @ref sol_buffer with value passed as argument
  * and flags SOL_BUFFER_FLAGS_MEMORY_NOT_OWNED and SOL_BUFFER_FLAGS_NO_NUL_BYTE.
@@ -137,7 +137,7 @@ enum sol_gpio_drive {
  */
 struct sol_gpio_config {
 #ifndef SOL_NO_API_VERSION
-#define SOL_GPIO_CONFIG_API_VERSION (1)
+#define SOL_GPIO_CONFIG_API_VERSION (2)
     uint16_t api_version;
 #endif
     /**
@@ -213,6 +213,14 @@ struct sol_gpio_config {
              * lose events.
              */
             uint32_t poll_timeout;
+            /**
+             * Time, in microseconds, the input must be stable for a
+             * change to be reported. 0 disables debouncing.
+             *
+             * It's done by the kernel when using Linux GPIO character
+             * devices, and ignored otherwise.
+             */
+            uint32_t debounce_period;
         } in;
         /**
          * Configuration parameters for output GPIOs.
@@ -304,6 +312,80 @@ bool sol_gpio_write(struct sol_gpio *gpio, bool value);
  */
 int sol_gpio_read(struct sol_gpio *gpio);
 
+/**
+ * @brief Get the kernel timestamp of the event being notified.
+ *
+ * Only meaningful from within the @c cb given on sol_gpio_config, as
+ * events may be delivered some time after they happened, several of
+ * them at once.
+ *
+ * @param gpio The @c sol_gpio whose event is being notified.
+ * @param timestamp Where to store the time of the event, in nanoseconds
+ *                  of @c CLOCK_MONOTONIC.
+ *
+ * @return @c 0 on success, @c -ENOTSUP if the platform or the GPIO
+ * interface in use doesn't timestamp events.
+ *
+ * @note Only available on Linux, it always fails with @c -ENOTSUP on
+ * other platforms.
+ */
+int sol_gpio_get_event_timestamp(const struct sol_gpio *gpio, uint64_t *timestamp);
+
+/**
+ * @brief Maximum number of pins of a @c sol_gpio_bank.
+ */
+#define SOL_GPIO_BANK_MAX 64
+
+struct sol_gpio_bank;
+
+/**
+ * @brief Opens a set of pins to be read or written together.
+ *
+ * When the Linux GPIO character device is available, pins are grouped
+ * by GPIO chip and the lines of each chip are requested at once, so
+ * sol_gpio_bank_read() and sol_gpio_bank_write() take a single system
+ * call per chip. Otherwise each pin is opened on its own.
+ *
+ * @param pins The pins to be opened, bit @c i of values refers to @c pins[i].
+ * @param count Number of pins, up to #SOL_GPIO_BANK_MAX.
+ * @param config Configuration of all the pins. Edge events are not
+ *               supported, input trigger mode must be #SOL_GPIO_EDGE_NONE.
+ *
+ * @return A new @c sol_gpio_bank instance on success, @c NULL otherwise.
+ *
+ * @note Only available on Linux, on other platforms @c NULL is returned
+ * and @c errno is set to @c ENOTSUP.
+ */
+struct sol_gpio_bank *sol_gpio_bank_open(const uint32_t *pins, unsigned int count, const struct sol_gpio_config *config) SOL_ATTR_WARN_UNUSED_RESULT;
+
+/**
+ * @brief Closes a set of pins opened with sol_gpio_bank_open().
+ *
+ * @param bank The bank to be closed.
+ */
+void sol_gpio_bank_close(struct sol_gpio_bank *bank);
+
+/**
+ * @brief Reads all pins of a bank.
+ *
+ * @param bank The bank to be read.
+ * @param values Where to store the values, one bit per pin.
+ *
+ * @return @c 0 on success, a negative errno value otherwise.
+ */
+int sol_gpio_bank_read(struct sol_gpio_bank *bank, uint64_t *values);
+
+/**
+ * @brief Writes pins of a bank.
+ *
+ * @param bank The bank to be written.
+ * @param values Values to be set, one bit per pin.
+ * @param mask Which pins should be set, pins not in @a mask are untouched.
+ *
+ * @return @c 0 on success, a negative errno value otherwise.
+ */
+int sol_gpio_bank_write(struct sol_gpio_bank *bank, uint64_t values, uint64_t mask);
+
 /**
  * @}
  */
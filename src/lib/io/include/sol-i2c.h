@@ -122,6 +122,9 @@ void sol_i2c_close_raw(struct sol_i2c *i2c);
  * in between your own ones, though, it's highly advisable that you
  * issue this call before using any of the I2C read/write functions.
  *
+ * @note On Linux, operations already queued are still delivered to
+ * the address set when they were issued.
+ *
  * @param i2c The I2C bus handle
  * @param slave_address The slave device address to deliver commands to
  *
@@ -179,8 +182,10 @@ struct sol_i2c_pending *sol_i2c_write_quick(struct sol_i2c *i2c, bool rw, void (
  *
  * @note The caller should guarantee that data will not be freed until the
  * callback is called.
- * Also there is no transfer queue, calling this function when there is
- * another I2C operation running will return false.
+ * On Linux, operations are queued per bus and done in order, so this
+ * may be called while other I2C operations are pending. On other
+ * platforms there is no transfer queue, calling this function when
+ * there is another I2C operation running will return @c NULL.
  *
  * @return pending An I2C pending operation handle on success,
  * otherwise @c NULL. It's only valid before @a read_cb is called. It
@@ -207,9 +212,11 @@ struct sol_i2c_pending *sol_i2c_read(struct sol_i2c *i2c, uint8_t *data, size_t
  * @param cb_data The first parameter of callback
  *
  * @note The caller should guarantee that data will not be freed until
- * the callback is called. Also there is no transfer queue, calling
+ * the callback is called. On Linux, operations are queued per bus and
+ * done in order, so this may be called while other I2C operations are
+ * pending. On other platforms there is no transfer queue, calling
  * this function when there is another I2C operation running will
- * return false.
+ * return @c NULL.
  *
  * @return pending An I2C pending operation handle on success,
  * otherwise @c NULL. It's only valid before @a write_cb is called. It
@@ -231,9 +238,11 @@ struct sol_i2c_pending *sol_i2c_write(struct sol_i2c *i2c, uint8_t *data, size_t
  * @param cb_data The first parameter of callback
  *
  * @note The caller should guarantee that data will not be freed until
- * the callback is called. Also there is no transfer queue, calling
+ * the callback is called. On Linux, operations are queued per bus and
+ * done in order, so this may be called while other I2C operations are
+ * pending. On other platforms there is no transfer queue, calling
  * this function when there is another I2C operation running will
- * return false.
+ * return @c NULL.
  *
  * @return pending An I2C pending operation handle on success,
  * otherwise @c NULL. It's only valid before @a read_reg_cb is called.
@@ -255,9 +264,11 @@ struct sol_i2c_pending *sol_i2c_read_register(struct sol_i2c *i2c, uint8_t reg,
  * @param cb_data The first parameter of callback
  *
  * @note The caller should guarantee that data will not be freed until
- * the callback is called. Also there is no transfer queue, calling
+ * the callback is called. On Linux, operations are queued per bus and
+ * done in order, so this may be called while other I2C operations are
+ * pending. On other platforms there is no transfer queue, calling
  * this function when there is another I2C operation running will
- * return false.
+ * return @c NULL.
  *
  * @return pending An I2C pending operation handle on success,
  * otherwise @c NULL. It's only valid before @a write_reg_cb is
@@ -293,9 +304,17 @@ struct sol_i2c_pending *sol_i2c_write_register(struct sol_i2c *i2c, uint8_t reg,
  * @param cb_data The first parameter of callback
  *
  * @note The caller should guarantee that data will not be freed until
- * the callback is called. Also there is no transfer queue, calling
+ * the callback is called. On Linux, operations are queued per bus and
+ * done in order, so this may be called while other I2C operations are
+ * pending. On other platforms there is no transfer queue, calling
  * this function when there is another I2C operation running will
- * return false.
+ * return @c NULL.
+ *
+ * @note On Linux, adjacent queued operations to the same device that
+ * are done with plain-I2C messages (this one and register reads and
+ * writes longer than 32 bytes) are combined in a single I2C_RDWR
+ * transfer. As the kernel doesn't tell which message of a transfer
+ * failed, all of them get the same error status in that case.
  *
  * @return pending An I2C pending operation handle on success,
  * otherwise @c NULL. It's only valid before @a read_reg_multiple_cb
@@ -308,6 +327,10 @@ struct sol_i2c_pending *sol_i2c_read_register_multiple(struct sol_i2c *i2c, uint
  * operation. This function should be called before issuing any other
  * I2C function.
  *
+ * @note On Linux, the bus is busy while it has queued operations or
+ * completed ones whose callbacks were not called yet. Issuing I2C
+ * functions on a busy bus queues them after the pending ones.
+ *
  * @param i2c The I2C bus handle
  *
  * @return true is busy or false if idle
@@ -326,6 +349,10 @@ uint8_t sol_i2c_bus_get(const struct sol_i2c *i2c);
 /**
  * @brief Cancel a pending operation.
  *
+ * The operation callback is still called. On Linux, its status is
+ * @c -ECANCELED if it was not done yet, and if its transfer is being
+ * done, this waits for it to finish.
+ *
  * @param i2c the I2C bus handle
  * @param pending the operation handle
  */
@@ -44,7 +44,7 @@ struct sol_iio_channel;
 
 struct sol_iio_config {
 #ifndef SOL_NO_API_VERSION
-#define SOL_IIO_CONFIG_API_VERSION (1)
+#define SOL_IIO_CONFIG_API_VERSION (2)
     uint16_t api_version;
 #endif
     const char *trigger_name; /**< Name of IIO trigger to be used on this device. If NULL or empty, will try to use device current trigger. If device has no current trigger, will create a 'sysfs_trigger' and use it. */
@@ -52,6 +52,7 @@ struct sol_iio_config {
     const void *data; /**< User defined data to be sent to sol_iio_reader_cb */
     int buffer_size; /**< size of reading buffer. 0: use device default; -1: disable buffer and readings will be performed on channel files on sysfs. */
     int sampling_frequency; /**< Device sampling frequency. -1 uses device default */
+    int batch_size; /**< Number of scans read from buffer at once. 'sol_iio_reader_cb' is then called once for all of them, see sol_iio_read_channel_samples(). 0 or 1 calls it for every scan. Only meaningful when buffer is enabled. */
 };
 
 struct sol_iio_channel_config {
@@ -78,6 +79,10 @@ struct sol_iio_channel_config {
  *
  * @param id Id of iio device. It's the number which identifies device
  * on file system. Can be found at '/sys/bus/iio/devices/iio:deviceX'.
+ * That directory may be replaced by the one given by
+ * @c SOL_IIO_SYSFS_DEVICES_PATH environment variable, as done to test
+ * against a fake sysfs tree. Likewise, @c SOL_IIO_DEV_PATH replaces
+ * '/dev', where buffer device nodes are looked for.
  * @param config IIO config.
  *
  * @return A new IIO handle
@@ -98,7 +103,9 @@ void sol_iio_close(struct sol_iio_device *device);
  * @param name Name of channel. Eg 'in_anglvel_x'.
  * @param config Channel config.
  *
- * @return A new IIO channel handle
+ * @return A new IIO channel handle, or @c NULL if the channel doesn't
+ * exist. When buffer is disabled, failing to open the channel file is
+ * not reported here, but by sol_iio_read_channel_value().
  */
 struct sol_iio_channel *sol_iio_add_channel(struct sol_iio_device *device, const char *name, const struct sol_iio_channel_config *config);
 
@@ -107,7 +114,10 @@ struct sol_iio_channel *sol_iio_add_channel(struct sol_iio_device *device, const
  *
  * If buffer is enabled, it will read from last buffer data. Callback
  * 'sol_iio_reader_cb' is called when there are new data on buffer.
- * If buffer is disabled, will read from channel file on sysfs.
+ * If buffer is disabled, will read from channel file on sysfs, which
+ * is kept open while channel exists. If that file could not be opened
+ * when the channel was added, it's tried again on every reading until
+ * it succeeds.
  *
  * @param channel IIO channel handle to be read
  * @param value Where read value will be stored
@@ -203,6 +213,23 @@ bool sol_iio_address_device(const char *commands, void (*cb)(void *data, int dev
 struct sol_str_slice
 sol_iio_read_channel_raw_buffer(struct sol_iio_channel *channel);
 
+/**
+ * @brief Returns channel values of all scans of the last buffer reading.
+ *
+ * When config @c batch_size is bigger than 1, each call of
+ * 'sol_iio_reader_cb' delivers up to @c batch_size scans at once. All of
+ * them are already decoded, adjusted by channel offset and scale, and
+ * can be read here. sol_iio_read_channel_value() only gives the last one.
+ *
+ * @param channel channel to get samples
+ * @param count where the number of samples will be stored
+ *
+ * @return array of @a count samples, oldest first, valid until next
+ * call of 'sol_iio_reader_cb'. NULL if buffer is not enabled or channel
+ * has more than 64 storage bits.
+ */
+const double *sol_iio_read_channel_samples(struct sol_iio_channel *channel, unsigned int *count);
+
 /**
  * @}
  */
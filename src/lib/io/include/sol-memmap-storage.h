@@ -58,6 +58,12 @@ extern "C" {
  * Multiple writes for the same key before timeout end will result in previous
  * writes being replaced, and their callbacks will be informed with status
  * -ECANCELED.
+ * When the storage is a regular file at least as large as the map, it is
+ * mmap()ed once and reads and writes become memory accesses, with all writes
+ * performed at a timeout end flushed by a single synchronous msync(). Such a
+ * file must not be truncated while its map is in use. Other storages, like
+ * device nodes, are accessed with pread() and pwrite() on a file descriptor
+ * kept open.
  *
  * @{
  */
@@ -189,6 +195,17 @@ bool sol_memmap_set_timeout(struct sol_memmap_map *map, uint32_t timeout);
  */
 uint32_t sol_memmap_get_timeout(const struct sol_memmap_map *map);
 
+/**
+ * @brief Number of write batches not completed yet.
+ *
+ * Storage that can't be memory mapped, like device nodes, is written
+ * from a worker thread, which also flushes writes to mapped files.
+ * Pending writes are waited for when the map is removed.
+ *
+ * @return number of write batches in flight
+ */
+unsigned int sol_memmap_get_queue_depth(void);
+
 /**
  * @brief Macro to create a struct @ref sol_buffer with value passed as argument
  * and flags SOL_BUFFER_FLAGS_MEMORY_NOT_OWNED and SOL_BUFFER_FLAGS_NO_NUL_BYTE.
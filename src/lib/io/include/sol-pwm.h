@@ -204,6 +204,11 @@ int32_t sol_pwm_get_period(const struct sol_pwm *pwm);
  * @param duty_cycle_ns Duty cycle in nanoseconds.
  *
  * @return @c true on success and @c false on error.
+ *
+ * @note Setting the same duty cycle that was last set is a no-op, so
+ * it's cheap to call this from control loops. The same goes for
+ * sol_pwm_set_period() and sol_pwm_set_enabled(), except when the period
+ * is set for the whole chip, as it may be changed through other handles.
  */
 bool sol_pwm_set_duty_cycle(struct sol_pwm *pwm, uint32_t duty_cycle_ns);
 
@@ -20,6 +20,8 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
 
 #include <sol-common-buildopts.h>
 
@@ -100,9 +102,56 @@ struct sol_spi_config {
  * freed until callback is called.
  * Also there is no transfer queue, calling this function when there is
  * transfer happening would return false.
+ * Transfers longer than @c UINT32_MAX bytes are refused, with @c errno
+ * set to @c EINVAL.
  */
 bool sol_spi_transfer(struct sol_spi *spi, const uint8_t *tx, uint8_t *rx, size_t count, void (*transfer_cb)(void *cb_data, struct sol_spi *spi, const uint8_t *tx, uint8_t *rx, ssize_t status), const void *cb_data);
 
+/**
+ * @brief Maximum number of transfers of a sol_spi_transfer_chain() call.
+ */
+#define SOL_SPI_CHAIN_MAX 256
+
+/**
+ * @brief One transfer of a chain given to sol_spi_transfer_chain().
+ */
+struct sol_spi_chain_item {
+    const uint8_t *tx; /**< The output buffer, may be @c NULL to send zeros */
+    uint8_t *rx; /**< The input buffer, may be @c NULL */
+    size_t count; /**< Number of bytes of this transfer */
+    uint16_t delay_usecs; /**< Delay after this transfer, before the next one or deselecting the chip */
+    bool cs_change; /**< Deselect the chip after this transfer, before the next one */
+};
+
+/**
+ * @brief Perform a chain of SPI transfers asynchronously.
+ *
+ * All transfers are done in a single system call, one after the
+ * other and with the chip selected from the first to the last one,
+ * unless @c cs_change is set on some of them. Only one callback is
+ * called for the whole chain, so many small transfers (like the
+ * pixels of a LED strip frame) cost about the same as a single one.
+ *
+ * @param spi The SPI bus handle
+ * @param items The transfers to be done, in order
+ * @param count Number of transfers, up to #SOL_SPI_CHAIN_MAX. Each one
+ * may be up to @c UINT32_MAX bytes long, otherwise the chain is refused
+ * with @c errno set to @c EINVAL.
+ * @param chain_cb callback to be called when all transfers finish, in
+ * case of success the status parameter is the total of bytes
+ * transferred, otherwise a negative value. If any transfer fails, the
+ * ones after it are not done.
+ * @param cb_data user data, first parameter of chain_cb
+ * @return true if the transfers were started.
+ *
+ * Caller should guarantee that @a items and its buffers will not be
+ * freed until callback is called. The transfers are done in place of
+ * a sol_spi_transfer(), so only one of them may be pending at a time.
+ *
+ * @note Only available on Linux.
+ */
+bool sol_spi_transfer_chain(struct sol_spi *spi, const struct sol_spi_chain_item *items, unsigned int count, void (*chain_cb)(void *cb_data, struct sol_spi *spi, const struct sol_spi_chain_item *items, unsigned int count, ssize_t status), const void *cb_data);
+
 /**
  * @brief Close an SPI bus.
  *
@@ -17,6 +17,7 @@
  */
 
 #include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
 #include <stdbool.h>
 #include <stdint.h>
@@ -24,33 +25,38 @@
 #include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #define SOL_LOG_DOMAIN &_log_domain
 #include "sol-log-internal.h"
 SOL_LOG_INTERNAL_DECLARE_STATIC(_log_domain, "aio");
 
 #include "sol-aio.h"
+#include "sol-util-file.h"
 #ifdef WORKER_THREAD
 #include "sol-worker-thread.h"
 #endif
 
 #define AIO_BASE_PATH "/sys/bus/iio/devices"
+/* Same as IIO, lets sysfs tree be replaced by a fake one */
+#define AIO_BASE_PATH_ENVVAR "SOL_IIO_SYSFS_DEVICES_PATH"
 
 #define AIO_PATH(dst, device, pin) \
     ({ \
-        int _tmp = snprintf(dst, sizeof(dst), AIO_BASE_PATH "/iio:device%d/in_voltage%d_raw", \
-            device, pin); \
+        int _tmp = snprintf(dst, sizeof(dst), "%s/iio:device%d/in_voltage%d_raw", \
+            _aio_base_path(), device, pin); \
         (_tmp > 0 && _tmp < PATH_MAX); \
     })
 
 #define AIO_DEV_PATH(dst, device) \
     ({ \
-        int _tmp = snprintf(dst, sizeof(dst), AIO_BASE_PATH "/iio:device%d", device); \
+        int _tmp = snprintf(dst, sizeof(dst), "%s/iio:device%d", \
+            _aio_base_path(), device); \
         (_tmp > 0 && _tmp < PATH_MAX); \
     })
 
 struct sol_aio {
-    FILE *fp;
+    int fd;
     int device;
     int pin;
     unsigned int mask;
@@ -78,20 +84,32 @@ struct sol_aio {
 #define BUSY_CHECK(aio, ret) SOL_EXP_CHECK(aio->async.timeout, ret);
 #endif
 
+static const char *
+_aio_base_path(void)
+{
+    static const char *base_path;
+
+    if (!base_path) {
+        base_path = getenv(AIO_BASE_PATH_ENVVAR);
+        if (!base_path || !base_path[0])
+            base_path = AIO_BASE_PATH;
+    }
+
+    return base_path;
+}
+
 static bool
-_aio_open_fp(struct sol_aio *aio)
+_aio_open_fd(struct sol_aio *aio)
 {
     char path[PATH_MAX];
 
     if (!AIO_PATH(path, aio->device, aio->pin))
         return false;
 
-    aio->fp = fopen(path, "re");
-    if (!aio->fp)
-        return false;
-    setvbuf(aio->fp, NULL, _IONBF, 0);
+    /* Kept open, each reading is a pread() from its start */
+    aio->fd = open(path, O_RDONLY | O_CLOEXEC);
 
-    return true;
+    return aio->fd > -1;
 }
 
 SOL_API struct sol_aio *
@@ -119,7 +137,7 @@ sol_aio_open_raw(const int device, const int pin, const unsigned int precision)
     aio->pin = pin;
     aio->mask = (0x01 << precision) - 1;
 
-    if (!_aio_open_fp((struct sol_aio *)aio)) {
+    if (!_aio_open_fd(aio)) {
         if (!AIO_DEV_PATH(path, device) || stat(path, &st))
             SOL_WRN("aio #%d,%d: aio device %d does not exist", device, pin, device);
         else
@@ -137,8 +155,8 @@ sol_aio_close(struct sol_aio *aio)
 {
     SOL_NULL_CHECK(aio);
 
-    if (aio->fp)
-        fclose(aio->fp);
+    if (aio->fd > -1)
+        close(aio->fd);
 
     free(aio);
 }
@@ -146,12 +164,16 @@ sol_aio_close(struct sol_aio *aio)
 static void
 _aio_get_value(struct sol_aio *aio, unsigned int *val)
 {
-    rewind(aio->fp);
+    int64_t value;
 
-    if (fscanf(aio->fp, "%u", val) < 1) {
+    if (sol_util_fd_read_int64(aio->fd, &value) < 0 || value < 0 ||
+        value > UINT_MAX) {
         SOL_WRN("AIO #%d,%d: Could not read value.", aio->device, aio->pin);
         *val = -EIO;
+        return;
     }
+
+    *val = value;
 }
 
 #ifdef WORKER_THREAD
@@ -230,7 +252,7 @@ sol_aio_get_value(struct sol_aio *aio,
 #endif
 
     SOL_NULL_CHECK(aio, NULL);
-    SOL_NULL_CHECK(aio->fp, NULL);
+    SOL_INT_CHECK(aio->fd, < 0, NULL);
     BUSY_CHECK(aio, NULL);
 
     aio->async.value = 0;
@@ -244,7 +266,7 @@ sol_aio_get_value(struct sol_aio *aio,
 
     return (struct sol_aio_pending *)aio->async.worker;
 #else
-    aio->async.timeout = sol_timeout_add(0, aio_read_timeout_cb, aio);
+    aio->async.timeout = sol_timeout_add(0, aio_get_value_timeout_cb, aio);
     SOL_NULL_CHECK(aio->async.timeout, NULL);
 
     return (struct sol_aio_pending *)aio->async.timeout;
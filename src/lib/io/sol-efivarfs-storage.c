@@ -28,6 +28,7 @@
 #include "sol-buffer.h"
 #include "sol-log.h"
 #include "sol-mainloop.h"
+#include "sol-storage-worker.h"
 #include "sol-util-internal.h"
 #include "sol-util-file.h"
 
@@ -44,35 +45,46 @@ struct pending_write_data {
 };
 
 static struct sol_ptr_vector pending_writes = SOL_PTR_VECTOR_INIT;
+static struct sol_storage_queue efivars_queue = SOL_STORAGE_QUEUE_INIT("efivars");
 
 static const int EFIVARS_DEFAULT_ATTR = 0x7;
 
-static bool
-perform_pending_write(void *data)
+static void
+finish_pending_write(struct pending_write_data *pending_write)
+{
+    pending_write->cb((void *)pending_write->data, pending_write->name,
+        pending_write->blob, pending_write->status);
+
+    sol_blob_unref(pending_write->blob);
+    free(pending_write->name);
+    sol_ptr_vector_remove(&pending_writes, pending_write);
+    free(pending_write);
+}
+
+/* Runs on the storage worker */
+static int
+write_var(void *data)
 {
     FILE *file = NULL;
     char path[PATH_MAX];
     struct pending_write_data *pending_write = data;
     int r;
 
-    if (pending_write->status == -ECANCELED)
-        goto callback;
-
     r = snprintf(path, sizeof(path), EFIVARFS_VAR_PATH, pending_write->name);
     if (r < 0 || r >= PATH_MAX) {
         SOL_WRN("Could not create path for efivars persistence file [%s]", path);
-        pending_write->status = -EINVAL;
-        goto callback;
+        return -EINVAL;
     }
 
     file = fopen(path, "w+e");
     if (!file) {
+        r = -errno;
         SOL_WRN("Could not open persistence file [%s]: %s", path,
-            sol_util_strerrora(errno));
-        pending_write->status = -errno;
-        goto callback;
+            sol_util_strerrora(-r));
+        return r;
     }
 
+    r = 0;
     fwrite(&EFIVARS_DEFAULT_ATTR, sizeof(EFIVARS_DEFAULT_ATTR), 1, file);
     if (ferror(file)) {
         SOL_WRN("Coud not write peristence file [%s] attributes", path);
@@ -83,21 +95,42 @@ perform_pending_write(void *data)
     fwrite(pending_write->blob->mem, pending_write->blob->size, 1, file);
     if (ferror(file)) {
         SOL_WRN("Could not write to persistence file [%s]", path);
-        pending_write->status = -EIO;
+        r = -EIO;
     }
 
 close:
-    if (fclose(file) < 0 && !pending_write->status)
-        pending_write->status = -errno;
+    if (fclose(file) < 0 && !r)
+        r = -errno;
 
-callback:
-    pending_write->cb((void *)pending_write->data, pending_write->name,
-        pending_write->blob, pending_write->status);
+    return r;
+}
 
-    sol_blob_unref(pending_write->blob);
-    free(pending_write->name);
-    sol_ptr_vector_remove(&pending_writes, pending_write);
-    free(pending_write);
+static void
+write_var_done(void *data, int status)
+{
+    struct pending_write_data *pending_write = data;
+
+    /* If superseded while being written, keep reporting it as such */
+    if (pending_write->status != -ECANCELED)
+        pending_write->status = status;
+
+    finish_pending_write(pending_write);
+}
+
+static bool
+perform_pending_write(void *data)
+{
+    struct pending_write_data *pending_write = data;
+
+    if (pending_write->status == -ECANCELED) {
+        finish_pending_write(pending_write);
+        return false;
+    }
+
+    /* Still listed in pending_writes, so reads see it until it's done */
+    if (sol_storage_queue_submit(&efivars_queue, write_var, write_var_done,
+        pending_write) < 0)
+        write_var_done(pending_write, write_var(pending_write));
 
     return false;
 }
@@ -106,7 +139,7 @@ static void
 cancel_pending_write(const char *name)
 {
     struct pending_write_data *pending_write;
-    int i;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_IDX (&pending_writes, pending_write, i) {
         if (streq(pending_write->name, name))
@@ -118,7 +151,7 @@ static bool
 read_from_pending(const char *name, struct sol_buffer *buffer)
 {
     struct pending_write_data *pending_write;
-    int i;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_IDX (&pending_writes, pending_write, i) {
         if (streq(pending_write->name, name)) {
@@ -134,6 +167,12 @@ read_from_pending(const char *name, struct sol_buffer *buffer)
     return false;
 }
 
+SOL_API unsigned int
+sol_efivars_get_queue_depth(void)
+{
+    return sol_storage_queue_get_depth(&efivars_queue);
+}
+
 SOL_API int
 sol_efivars_write_raw(const char *name, struct sol_blob *blob,
     void (*cb)(void *data, const char *name, struct sol_blob *blob, int status),
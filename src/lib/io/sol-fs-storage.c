@@ -22,12 +22,14 @@
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include "sol-buffer.h"
 #include "sol-log.h"
 #include "sol-mainloop.h"
+#include "sol-storage-worker.h"
 #include "sol-util-internal.h"
 #include "sol-util-file.h"
 
@@ -40,40 +42,73 @@ struct pending_write_data {
 };
 
 static struct sol_ptr_vector pending_writes = SOL_PTR_VECTOR_INIT;
+static struct sol_storage_queue fs_queue = SOL_STORAGE_QUEUE_INIT("fs");
 
-static bool
-perform_pending_write(void *data)
+static void
+finish_pending_write(struct pending_write_data *pending_write)
+{
+    pending_write->cb((void *)pending_write->data, pending_write->name,
+        pending_write->blob, pending_write->status);
+
+    sol_blob_unref(pending_write->blob);
+    free(pending_write->name);
+    sol_ptr_vector_remove(&pending_writes, pending_write);
+    free(pending_write);
+}
+
+/* Runs on the storage worker */
+static int
+write_file(void *data)
 {
     FILE *file;
     struct pending_write_data *pending_write = data;
-
-    if (pending_write->status == -ECANCELED)
-        goto callback;
+    int r = 0;
 
     file = fopen(pending_write->name, "w+e");
     if (!file) {
+        r = -errno;
         SOL_WRN("Could not open persistence file [%s]: %s", pending_write->name,
-            sol_util_strerrora(errno));
-        pending_write->status = -errno;
-        goto callback;
+            sol_util_strerrora(-r));
+        return r;
     }
 
     fwrite(pending_write->blob->mem, pending_write->blob->size, 1, file);
     if (ferror(file)) {
         SOL_WRN("Could not write to persistence file [%s]", pending_write->name);
-        pending_write->status = -EIO;
+        r = -EIO;
     }
-    if (fclose(file) < 0 && !pending_write->status)
-        pending_write->status = -errno;
+    if (fclose(file) < 0 && !r)
+        r = -errno;
 
-callback:
-    pending_write->cb((void *)pending_write->data, pending_write->name,
-        pending_write->blob, pending_write->status);
+    return r;
+}
 
-    sol_blob_unref(pending_write->blob);
-    free(pending_write->name);
-    sol_ptr_vector_remove(&pending_writes, pending_write);
-    free(pending_write);
+static void
+write_file_done(void *data, int status)
+{
+    struct pending_write_data *pending_write = data;
+
+    /* If superseded while being written, keep reporting it as such */
+    if (pending_write->status != -ECANCELED)
+        pending_write->status = status;
+
+    finish_pending_write(pending_write);
+}
+
+static bool
+perform_pending_write(void *data)
+{
+    struct pending_write_data *pending_write = data;
+
+    if (pending_write->status == -ECANCELED) {
+        finish_pending_write(pending_write);
+        return false;
+    }
+
+    /* Still listed in pending_writes, so reads see it until it's done */
+    if (sol_storage_queue_submit(&fs_queue, write_file, write_file_done,
+        pending_write) < 0)
+        write_file_done(pending_write, write_file(pending_write));
 
     return false;
 }
@@ -82,7 +117,7 @@ static void
 cancel_pending_write(const char *name)
 {
     struct pending_write_data *pending_write;
-    int i;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_IDX (&pending_writes, pending_write, i) {
         if (streq(pending_write->name, name))
@@ -90,19 +125,38 @@ cancel_pending_write(const char *name)
     }
 }
 
+static int
+copy_to_buffer(struct sol_buffer *buffer, const void *mem, size_t size)
+{
+    int r;
+
+    r = sol_buffer_ensure(buffer, size);
+    SOL_INT_CHECK(r, < 0, r);
+
+    memcpy(buffer->data, mem, size);
+    buffer->used = size;
+
+    if (buffer->flags & SOL_BUFFER_FLAGS_NO_NUL_BYTE)
+        return 0;
+
+    return sol_buffer_ensure_nul_byte(buffer);
+}
+
 static bool
-read_from_pending(const char *name, struct sol_buffer *buffer)
+read_from_pending(const struct sol_ptr_vector *pending, const char *name,
+    struct sol_buffer *buffer)
 {
     struct pending_write_data *pending_write;
     int i;
 
-    SOL_PTR_VECTOR_FOREACH_IDX (&pending_writes, pending_write, i) {
+    /* Latest write wins, earlier ones were cancelled by it */
+    SOL_PTR_VECTOR_FOREACH_REVERSE_IDX (pending, pending_write, i) {
         if (streq(pending_write->name, name)) {
-            if (sol_buffer_ensure(buffer, pending_write->blob->size) < 0) {
+            if (copy_to_buffer(buffer, pending_write->blob->mem,
+                pending_write->blob->size) < 0) {
                 SOL_WRN("Could not ensure buffer size to fit pending blob");
                 return false;
             }
-            memcpy(buffer->data, pending_write->blob->mem, pending_write->blob->size);
             return true;
         }
     }
@@ -110,6 +164,824 @@ read_from_pending(const char *name, struct sol_buffer *buffer)
     return false;
 }
 
+/*
+ * Log-structured storage: a header followed by records of
+ * [crc32][name length][value length][name][value], all integers in
+ * little endian and the CRC covering everything after itself. The
+ * last record of a name holds its value.
+ */
+#define FS_LOG_MAGIC "SOLFSLOG"
+#define FS_LOG_MAGIC_LEN (sizeof(FS_LOG_MAGIC) - 1)
+#define FS_LOG_VERSION 1
+#define FS_LOG_HEADER_SIZE (FS_LOG_MAGIC_LEN + sizeof(uint32_t))
+#define FS_LOG_RECORD_HEADER_SIZE (3 * sizeof(uint32_t))
+#define FS_LOG_DEFAULT_PATH "sol-fs-storage.log"
+#define FS_LOG_DEFAULT_FLUSH_INTERVAL 100
+#define FS_LOG_DEFAULT_COMPACTION_THRESHOLD (64 * 1024)
+
+struct fs_log_entry {
+    char *name;
+    void *value;
+    size_t size;
+};
+
+static struct {
+    char *path;
+    struct sol_ptr_vector entries; /* sorted by name */
+    struct sol_ptr_vector pending_writes;
+    struct sol_timeout *timeout;
+    struct fs_log_batch *batch; /* being appended */
+    size_t size; /* bytes in the log file */
+    size_t live; /* bytes of header and current records */
+    size_t compaction_threshold;
+    uint32_t flush_interval;
+    unsigned int refcnt;
+    int status; /* first append error since the last sync flush */
+    int fd;
+    bool busy; /* an append or compaction is in flight */
+} fs_log = {
+    .entries = SOL_PTR_VECTOR_INIT,
+    .pending_writes = SOL_PTR_VECTOR_INIT,
+    .fd = -1,
+};
+
+static struct sol_storage_queue fs_log_queue = SOL_STORAGE_QUEUE_INIT("fs-log");
+
+static uint32_t
+fs_log_crc32(uint32_t crc, const void *mem, size_t len)
+{
+    static uint32_t table[256];
+    const uint8_t *p = mem;
+    uint32_t c;
+    unsigned int i, j;
+
+    if (!table[1]) {
+        for (i = 0; i < 256; i++) {
+            c = i;
+            for (j = 0; j < 8; j++)
+                c = (c & 1) ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+    }
+
+    crc = ~crc;
+    while (len--)
+        crc = table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+    return ~crc;
+}
+
+static size_t
+fs_log_record_size(size_t name_len, size_t value_len)
+{
+    return FS_LOG_RECORD_HEADER_SIZE + name_len + value_len;
+}
+
+static int
+fs_log_record_append(struct sol_buffer *buf, const char *name,
+    const void *value, size_t value_len)
+{
+    size_t name_len = strlen(name), offset = buf->used;
+    uint32_t u32[3];
+    int r;
+
+    SOL_INT_CHECK(name_len, > UINT32_MAX, -EOVERFLOW);
+    SOL_INT_CHECK(value_len, > UINT32_MAX, -EOVERFLOW);
+
+    u32[1] = sol_util_cpu_to_le32(name_len);
+    u32[2] = sol_util_cpu_to_le32(value_len);
+
+    r = sol_buffer_append_bytes(buf, (const uint8_t *)u32, sizeof(u32));
+    SOL_INT_CHECK_GOTO(r, < 0, err);
+    r = sol_buffer_append_bytes(buf, (const uint8_t *)name, name_len);
+    SOL_INT_CHECK_GOTO(r, < 0, err);
+    r = sol_buffer_append_bytes(buf, value, value_len);
+    SOL_INT_CHECK_GOTO(r, < 0, err);
+
+    u32[0] = sol_util_cpu_to_le32(fs_log_crc32(0,
+        (uint8_t *)buf->data + offset + sizeof(uint32_t),
+        buf->used - offset - sizeof(uint32_t)));
+    memcpy((uint8_t *)buf->data + offset, u32, sizeof(uint32_t));
+
+    return 0;
+
+err:
+    buf->used = offset;
+    return r;
+}
+
+static int
+fs_log_write_all(int fd, const void *mem, size_t len, off_t offset)
+{
+    const uint8_t *p = mem;
+    ssize_t w;
+
+    while (len) {
+        w = pwrite(fd, p, len, offset);
+        if (w < 0) {
+            if (errno == EINTR)
+                continue;
+            return -errno;
+        }
+        p += w;
+        len -= w;
+        offset += w;
+    }
+
+    return 0;
+}
+
+static int
+fs_log_entry_compare(const void *data1, const void *data2)
+{
+    const struct fs_log_entry *a = data1, *b = data2;
+
+    return strcmp(a->name, b->name);
+}
+
+static struct fs_log_entry *
+fs_log_entry_find(const char *name)
+{
+    struct fs_log_entry key = { .name = (char *)name };
+    int32_t i;
+
+    i = sol_ptr_vector_match_sorted(&fs_log.entries, &key,
+        fs_log_entry_compare);
+    if (i < 0)
+        return NULL;
+
+    return sol_ptr_vector_get_no_check(&fs_log.entries, i);
+}
+
+/* Sets the value of a name, keeping the live bytes count in sync */
+static int
+fs_log_entry_set(const char *name, size_t name_len, const void *value,
+    size_t size)
+{
+    struct fs_log_entry *entry;
+    void *copy;
+    int32_t r;
+
+    copy = malloc(size ? size : 1);
+    SOL_NULL_CHECK(copy, -ENOMEM);
+    memcpy(copy, value, size);
+
+    entry = fs_log_entry_find(name);
+    if (entry) {
+        fs_log.live -= fs_log_record_size(name_len, entry->size);
+        free(entry->value);
+        goto set;
+    }
+
+    entry = calloc(1, sizeof(*entry));
+    SOL_NULL_CHECK_GOTO(entry, err_entry);
+
+    entry->name = strndup(name, name_len);
+    SOL_NULL_CHECK_GOTO(entry->name, err_name);
+
+    r = sol_ptr_vector_insert_sorted(&fs_log.entries, entry,
+        fs_log_entry_compare);
+    SOL_INT_CHECK_GOTO(r, < 0, err_insert);
+
+set:
+    entry->value = copy;
+    entry->size = size;
+    fs_log.live += fs_log_record_size(name_len, size);
+
+    return 0;
+
+err_insert:
+    free(entry->name);
+err_name:
+    free(entry);
+err_entry:
+    free(copy);
+    return -ENOMEM;
+}
+
+static void
+fs_log_entries_clear(void)
+{
+    struct fs_log_entry *entry;
+    uint32_t i;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&fs_log.entries, entry, i) {
+        free(entry->name);
+        free(entry->value);
+        free(entry);
+    }
+    sol_ptr_vector_clear(&fs_log.entries);
+}
+
+/* Replays the log, discarding anything past the first bad record */
+static int
+fs_log_load(void)
+{
+    struct sol_buffer *buf;
+    const uint8_t *p, *end;
+    uint32_t u32[3], crc;
+    char header[FS_LOG_HEADER_SIZE], *name;
+    size_t rec_size;
+    int r = 0;
+
+    buf = sol_util_load_file_fd_raw(fs_log.fd);
+    SOL_NULL_CHECK(buf, -EIO);
+
+    memcpy(header, FS_LOG_MAGIC, FS_LOG_MAGIC_LEN);
+    u32[0] = sol_util_cpu_to_le32(FS_LOG_VERSION);
+    memcpy(header + FS_LOG_MAGIC_LEN, u32, sizeof(uint32_t));
+
+    if (buf->used < FS_LOG_HEADER_SIZE) {
+        if (buf->used && memcmp(buf->data, header, buf->used)) {
+            SOL_WRN("[%s] is not a storage log", fs_log.path);
+            r = -EINVAL;
+            goto end;
+        }
+
+        /* New (or torn while being created) log */
+        r = fs_log_write_all(fs_log.fd, header, sizeof(header), 0);
+        if (r >= 0 && ftruncate(fs_log.fd, sizeof(header)) < 0)
+            r = -errno;
+        if (r >= 0 && fdatasync(fs_log.fd) < 0)
+            r = -errno;
+        fs_log.size = fs_log.live = sizeof(header);
+        goto end;
+    }
+
+    if (memcmp(buf->data, header, sizeof(header))) {
+        SOL_WRN("[%s] is not a storage log or has an unsupported version",
+            fs_log.path);
+        r = -EINVAL;
+        goto end;
+    }
+
+    fs_log.live = sizeof(header);
+    p = (const uint8_t *)buf->data + sizeof(header);
+    end = (const uint8_t *)buf->data + buf->used;
+    while ((size_t)(end - p) >= FS_LOG_RECORD_HEADER_SIZE) {
+        memcpy(u32, p, sizeof(u32));
+        crc = sol_util_le32_to_cpu(u32[0]);
+        u32[1] = sol_util_le32_to_cpu(u32[1]);
+        u32[2] = sol_util_le32_to_cpu(u32[2]);
+
+        if ((size_t)(end - p) - FS_LOG_RECORD_HEADER_SIZE < u32[1] ||
+            (size_t)(end - p) - FS_LOG_RECORD_HEADER_SIZE - u32[1] < u32[2])
+            break;
+
+        rec_size = fs_log_record_size(u32[1], u32[2]);
+        if (fs_log_crc32(0, p + sizeof(uint32_t),
+            rec_size - sizeof(uint32_t)) != crc)
+            break;
+
+        name = strndup((const char *)p + FS_LOG_RECORD_HEADER_SIZE, u32[1]);
+        SOL_NULL_CHECK_GOTO(name, err_nomem);
+        r = fs_log_entry_set(name, u32[1],
+            p + FS_LOG_RECORD_HEADER_SIZE + u32[1], u32[2]);
+        free(name);
+        SOL_INT_CHECK_GOTO(r, < 0, end);
+
+        p += rec_size;
+    }
+
+    fs_log.size = p - (const uint8_t *)buf->data;
+    if (p != end) {
+        SOL_WRN("Discarding %zu bytes of incomplete or corrupted records"
+            " at the end of [%s]", (size_t)(end - p), fs_log.path);
+        if (ftruncate(fs_log.fd, fs_log.size) < 0)
+            r = -errno;
+    }
+
+end:
+    sol_buffer_free(buf);
+    return r;
+
+err_nomem:
+    sol_buffer_free(buf);
+    return -ENOMEM;
+}
+
+static int
+fs_log_sync_dir(const char *path)
+{
+    char *dir, *slash;
+    int fd, r = 0;
+
+    dir = strdup(path);
+    SOL_NULL_CHECK(dir, -ENOMEM);
+
+    slash = strrchr(dir, '/');
+    if (slash == dir)
+        slash[1] = '\0';
+    else if (slash)
+        *slash = '\0';
+
+    fd = open(slash ? dir : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0 || fsync(fd) < 0)
+        r = -errno;
+    if (fd >= 0)
+        close(fd);
+
+    free(dir);
+    return r;
+}
+
+struct fs_log_compaction {
+    struct sol_buffer buf;
+    char *path;
+    char *tmp_path;
+};
+
+/* Runs on the storage worker, returns the new log fd */
+static int
+fs_log_compact_work(void *data)
+{
+    struct fs_log_compaction *compaction = data;
+    int fd, r;
+
+    fd = open(compaction->tmp_path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC,
+        0644);
+    if (fd < 0) {
+        r = -errno;
+        SOL_WRN("Could not create [%s]: %s", compaction->tmp_path,
+            sol_util_strerrora(-r));
+        return r;
+    }
+
+    r = fs_log_write_all(fd, compaction->buf.data, compaction->buf.used, 0);
+    if (r >= 0 && fdatasync(fd) < 0)
+        r = -errno;
+    if (r >= 0 && rename(compaction->tmp_path, compaction->path) < 0)
+        r = -errno;
+    if (r < 0) {
+        SOL_WRN("Could not compact [%s]: %s", compaction->path,
+            sol_util_strerrora(-r));
+        close(fd);
+        unlink(compaction->tmp_path);
+        return r;
+    }
+
+    /* The rename must hit the disk before appending to the new log */
+    r = fs_log_sync_dir(compaction->path);
+    if (r < 0)
+        SOL_WRN("Could not sync directory of [%s]: %s", compaction->path,
+            sol_util_strerrora(-r));
+
+    return fd;
+}
+
+static void fs_log_flush_start(void);
+static bool fs_log_flush_cb(void *data);
+
+static void
+fs_log_compact_done(void *data, int status)
+{
+    struct fs_log_compaction *compaction = data;
+
+    fs_log.busy = false;
+
+    /* Records are only added by flushes, which wait for us, so the
+     * compacted log holds exactly the current entries */
+    if (status >= 0) {
+        close(fs_log.fd);
+        fs_log.fd = status;
+        fs_log.size = fs_log.live = compaction->buf.used;
+    }
+
+    sol_buffer_fini(&compaction->buf);
+    free(compaction->tmp_path);
+    free(compaction->path);
+    free(compaction);
+
+    /* Writes queued meanwhile wait for their flush interval */
+    if (!fs_log.timeout)
+        fs_log_flush_start();
+}
+
+/* Rewrites the log with the current records only */
+static int
+fs_log_compact(void)
+{
+    struct fs_log_compaction *compaction;
+    struct fs_log_entry *entry;
+    uint32_t version;
+    uint32_t i;
+    int r;
+
+    compaction = calloc(1, sizeof(*compaction));
+    SOL_NULL_CHECK(compaction, -ENOMEM);
+
+    sol_buffer_init_flags(&compaction->buf, NULL, 0,
+        SOL_BUFFER_FLAGS_NO_NUL_BYTE);
+
+    compaction->path = strdup(fs_log.path);
+    SOL_NULL_CHECK_GOTO(compaction->path, err_nomem);
+    r = asprintf(&compaction->tmp_path, "%s.tmp", fs_log.path);
+    if (r < 0) {
+        compaction->tmp_path = NULL;
+        goto err_nomem;
+    }
+
+    r = sol_buffer_ensure(&compaction->buf, fs_log.live);
+    SOL_INT_CHECK_GOTO(r, < 0, err);
+
+    version = sol_util_cpu_to_le32(FS_LOG_VERSION);
+    r = sol_buffer_append_bytes(&compaction->buf,
+        (const uint8_t *)FS_LOG_MAGIC, FS_LOG_MAGIC_LEN);
+    SOL_INT_CHECK_GOTO(r, < 0, err);
+    r = sol_buffer_append_bytes(&compaction->buf, (const uint8_t *)&version,
+        sizeof(version));
+    SOL_INT_CHECK_GOTO(r, < 0, err);
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&fs_log.entries, entry, i) {
+        r = fs_log_record_append(&compaction->buf, entry->name, entry->value,
+            entry->size);
+        SOL_INT_CHECK_GOTO(r, < 0, err);
+    }
+
+    r = sol_storage_queue_submit(&fs_log_queue, fs_log_compact_work,
+        fs_log_compact_done, compaction);
+    SOL_INT_CHECK_GOTO(r, < 0, err);
+
+    fs_log.busy = true;
+    return 0;
+
+err_nomem:
+    r = -ENOMEM;
+err:
+    sol_buffer_fini(&compaction->buf);
+    free(compaction->tmp_path);
+    free(compaction->path);
+    free(compaction);
+    return r;
+}
+
+struct fs_log_batch {
+    struct sol_buffer buf;
+    struct sol_ptr_vector writes;
+    size_t offset;
+    int fd;
+};
+
+/* Runs on the storage worker */
+static int
+fs_log_append_work(void *data)
+{
+    struct fs_log_batch *batch = data;
+    int r;
+
+    r = fs_log_write_all(batch->fd, batch->buf.data, batch->buf.used,
+        batch->offset);
+    if (r >= 0 && fdatasync(batch->fd) < 0)
+        r = -errno;
+    if (r < 0) {
+        SOL_WRN("Could not write to storage log: %s", sol_util_strerrora(-r));
+        /* Don't leave a partial batch behind for the next one */
+        if (ftruncate(batch->fd, batch->offset) < 0)
+            SOL_WRN("Could not truncate storage log: %s",
+                sol_util_strerrora(errno));
+    }
+
+    return r;
+}
+
+static void
+fs_log_append_done(void *data, int status)
+{
+    struct fs_log_batch *batch = data;
+    struct pending_write_data *pending_write;
+    uint32_t i;
+
+    fs_log.busy = false;
+    fs_log.batch = NULL;
+    if (status < 0 && !fs_log.status)
+        fs_log.status = status;
+
+    if (status >= 0)
+        fs_log.size += batch->buf.used;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&batch->writes, pending_write, i) {
+        if (pending_write->status != -ECANCELED) {
+            if (status < 0)
+                pending_write->status = status;
+            else
+                pending_write->status = fs_log_entry_set(pending_write->name,
+                    strlen(pending_write->name), pending_write->blob->mem,
+                    pending_write->blob->size);
+        }
+
+        pending_write->cb((void *)pending_write->data, pending_write->name,
+            pending_write->blob, pending_write->status);
+
+        sol_blob_unref(pending_write->blob);
+        free(pending_write->name);
+        free(pending_write);
+    }
+    sol_ptr_vector_clear(&batch->writes);
+    sol_buffer_fini(&batch->buf);
+    free(batch);
+
+    /* A callback may have closed the log */
+    if (!fs_log.refcnt)
+        return;
+
+    if (status >= 0 && fs_log.size > fs_log.compaction_threshold &&
+        fs_log.size / 2 > fs_log.live && fs_log_compact() >= 0)
+        return;
+
+    if (!fs_log.timeout)
+        fs_log_flush_start();
+}
+
+/* Hands all pending writes to the storage worker, to be appended with
+ * a single write() and fdatasync(). Only one batch or compaction is
+ * in flight at a time. If the flush interval ends meanwhile, the next
+ * batch starts as soon as it's done. */
+static void
+fs_log_flush_start(void)
+{
+    struct fs_log_batch *batch;
+    struct pending_write_data *pending_write;
+    uint32_t i;
+    int r = 0;
+
+    if (fs_log.busy || !sol_ptr_vector_get_len(&fs_log.pending_writes))
+        return;
+
+    if (fs_log.timeout) {
+        sol_timeout_del(fs_log.timeout);
+        fs_log.timeout = NULL;
+    }
+
+    batch = calloc(1, sizeof(*batch));
+    SOL_NULL_CHECK_GOTO(batch, err);
+
+    sol_buffer_init_flags(&batch->buf, NULL, 0, SOL_BUFFER_FLAGS_NO_NUL_BYTE);
+    batch->writes = fs_log.pending_writes;
+    batch->offset = fs_log.size;
+    batch->fd = fs_log.fd;
+    sol_ptr_vector_init(&fs_log.pending_writes);
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&batch->writes, pending_write, i) {
+        if (pending_write->status == -ECANCELED)
+            continue;
+        r = fs_log_record_append(&batch->buf, pending_write->name,
+            pending_write->blob->mem, pending_write->blob->size);
+        SOL_INT_CHECK_GOTO(r, < 0, fail);
+    }
+
+    fs_log.busy = true;
+    fs_log.batch = batch;
+
+    /* Everything was superseded, nothing to write */
+    if (!batch->buf.used) {
+        fs_log_append_done(batch, 0);
+        return;
+    }
+
+    r = sol_storage_queue_submit(&fs_log_queue, fs_log_append_work,
+        fs_log_append_done, batch);
+    if (r < 0)
+        fs_log_append_done(batch, fs_log_append_work(batch));
+
+    return;
+
+fail:
+    fs_log.busy = true;
+    fs_log_append_done(batch, r);
+    return;
+
+err:
+    /* Try again later */
+    if (!fs_log.timeout)
+        fs_log.timeout = sol_timeout_add(fs_log.flush_interval,
+            fs_log_flush_cb, NULL);
+}
+
+static bool
+fs_log_flush_cb(void *data)
+{
+    fs_log.timeout = NULL;
+    fs_log_flush_start();
+
+    return false;
+}
+
+/* Waits for all pending writes to hit the log */
+static int
+fs_log_flush_sync(void)
+{
+    fs_log.status = 0;
+
+    do {
+        sol_storage_queue_drain(&fs_log_queue);
+        fs_log_flush_start();
+    } while (fs_log.busy);
+
+    return fs_log.status;
+}
+
+static int
+fs_log_write(const char *name, struct sol_blob *blob,
+    void (*cb)(void *data, const char *name, struct sol_blob *blob, int status),
+    const void *data)
+{
+    struct pending_write_data *pending_write, *other;
+    uint32_t i;
+    int r;
+
+    pending_write = calloc(1, sizeof(struct pending_write_data));
+    SOL_NULL_CHECK(pending_write, -ENOMEM);
+
+    pending_write->name = strdup(name);
+    SOL_NULL_CHECK_GOTO(pending_write->name, err_name);
+
+    pending_write->blob = blob;
+    pending_write->data = data;
+    pending_write->cb = cb;
+
+    /* The interval also runs while a batch is in flight, so writes
+     * made meanwhile are still grouped */
+    if (!fs_log.timeout) {
+        fs_log.timeout = sol_timeout_add(fs_log.flush_interval,
+            fs_log_flush_cb, NULL);
+        SOL_NULL_CHECK_GOTO(fs_log.timeout, err_timeout);
+    }
+
+    r = sol_ptr_vector_append(&fs_log.pending_writes, pending_write);
+    SOL_INT_CHECK_GOTO(r, < 0, err_timeout);
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&fs_log.pending_writes, other, i) {
+        if (other != pending_write && streq(other->name, name))
+            other->status = -ECANCELED;
+    }
+
+    sol_blob_ref(blob);
+
+    return 0;
+
+err_timeout:
+    free(pending_write->name);
+err_name:
+    free(pending_write);
+    return -ENOMEM;
+}
+
+static int
+fs_log_read(const char *name, struct sol_buffer *buffer)
+{
+    struct fs_log_entry *entry;
+
+    if (read_from_pending(&fs_log.pending_writes, name, buffer))
+        return 0;
+
+    if (fs_log.batch && read_from_pending(&fs_log.batch->writes, name, buffer))
+        return 0;
+
+    entry = fs_log_entry_find(name);
+    if (!entry)
+        return -ENOENT;
+
+    return copy_to_buffer(buffer, entry->value, entry->size);
+}
+
+SOL_API int
+sol_fs_log_open(const struct sol_fs_log_config *config)
+{
+    const char *path = NULL;
+    int r;
+
+    if (config) {
+#ifndef SOL_NO_API_VERSION
+        if (SOL_UNLIKELY(config->api_version !=
+            SOL_FS_LOG_CONFIG_API_VERSION)) {
+            SOL_WRN("Couldn't open storage log that has unsupported version"
+                " '%u', expected version is '%u'",
+                config->api_version, SOL_FS_LOG_CONFIG_API_VERSION);
+            return -EINVAL;
+        }
+#endif
+        path = config->path;
+        SOL_NULL_CHECK(path, -EINVAL);
+    }
+
+    if (fs_log.refcnt) {
+        if (path && !streq(path, fs_log.path)) {
+            SOL_WRN("Storage log [%s] already open, can't open [%s]",
+                fs_log.path, path);
+            return -EBUSY;
+        }
+        fs_log.refcnt++;
+        return 0;
+    }
+
+    if (!path) {
+        path = getenv("SOL_FS_LOG_PATH");
+        if (!path || !*path)
+            path = FS_LOG_DEFAULT_PATH;
+    }
+
+    fs_log.path = strdup(path);
+    SOL_NULL_CHECK(fs_log.path, -ENOMEM);
+
+    fs_log.flush_interval = config ? config->flush_interval :
+        FS_LOG_DEFAULT_FLUSH_INTERVAL;
+    fs_log.compaction_threshold = config && config->compaction_threshold ?
+        config->compaction_threshold : FS_LOG_DEFAULT_COMPACTION_THRESHOLD;
+
+    fs_log.fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fs_log.fd < 0) {
+        r = -errno;
+        SOL_WRN("Could not open storage log [%s]: %s", path,
+            sol_util_strerrora(errno));
+        goto err;
+    }
+
+    r = fs_log_load();
+    SOL_INT_CHECK_GOTO(r, < 0, err);
+
+    fs_log.refcnt = 1;
+    return 0;
+
+err:
+    fs_log_entries_clear();
+    if (fs_log.fd >= 0)
+        close(fs_log.fd);
+    fs_log.fd = -1;
+    free(fs_log.path);
+    fs_log.path = NULL;
+    return r;
+}
+
+SOL_API int
+sol_fs_log_flush(void)
+{
+    SOL_INT_CHECK(fs_log.refcnt, == 0, -EBADF);
+
+    return fs_log_flush_sync();
+}
+
+SOL_API int
+sol_fs_log_close(void)
+{
+    int r;
+
+    SOL_INT_CHECK(fs_log.refcnt, == 0, -EBADF);
+
+    if (--fs_log.refcnt)
+        return 0;
+
+    /* Keep it open so callbacks still see the log */
+    fs_log.refcnt++;
+    r = fs_log_flush_sync();
+    fs_log.refcnt--;
+
+    fs_log_entries_clear();
+    if (close(fs_log.fd) < 0 && r >= 0)
+        r = -errno;
+    fs_log.fd = -1;
+    free(fs_log.path);
+    fs_log.path = NULL;
+
+    return r;
+}
+
+SOL_API int
+sol_fs_log_write_raw(const char *name, struct sol_blob *blob,
+    void (*cb)(void *data, const char *name, struct sol_blob *blob, int status),
+    const void *data)
+{
+    SOL_NULL_CHECK(name, -EINVAL);
+    SOL_NULL_CHECK(blob, -EINVAL);
+    SOL_NULL_CHECK(cb, -EINVAL);
+    SOL_INT_CHECK(fs_log.refcnt, == 0, -EBADF);
+
+    return fs_log_write(name, blob, cb, data);
+}
+
+SOL_API int
+sol_fs_log_read_raw(const char *name, struct sol_buffer *buffer)
+{
+    int r;
+
+    SOL_NULL_CHECK(name, -EINVAL);
+    SOL_NULL_CHECK(buffer, -EINVAL);
+    SOL_INT_CHECK(fs_log.refcnt, == 0, -EBADF);
+
+    r = fs_log_read(name, buffer);
+    if (r != -ENOENT)
+        return r;
+
+    /* Not in the log yet, may still be on its own file */
+    return sol_fs_read_raw(name, buffer);
+}
+
+SOL_API unsigned int
+sol_fs_get_queue_depth(void)
+{
+    return sol_storage_queue_get_depth(&fs_queue) +
+           sol_storage_queue_get_depth(&fs_log_queue);
+}
+
 SOL_API int
 sol_fs_write_raw(const char *name, struct sol_blob *blob,
     void (*cb)(void *data, const char *name, struct sol_blob *blob, int status),
@@ -162,7 +1034,7 @@ sol_fs_read_raw(const char *name, struct sol_buffer *buffer)
     SOL_NULL_CHECK(name, -EINVAL);
     SOL_NULL_CHECK(buffer, -EINVAL);
 
-    if (read_from_pending(name, buffer))
+    if (read_from_pending(&pending_writes, name, buffer))
         return 0;
 
     fd = open(name, O_RDONLY | O_CLOEXEC);
@@ -27,6 +27,11 @@
 #include <limits.h>
 #include <errno.h>
 
+#ifdef HAVE_GPIO_CDEV
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#endif
+
 #define SOL_LOG_DOMAIN &_log_domain
 #include "sol-log-internal.h"
 #include "sol-gpio.h"
@@ -41,10 +46,23 @@ SOL_LOG_INTERNAL_DECLARE_STATIC(_log_domain, "gpio");
 
 #define EXPORT_STAT_RETRIES 10
 
+#ifdef HAVE_GPIO_CDEV
+#define GPIO_CHIP_PATH "/dev/gpiochip%u"
+#define GPIO_CHIP_DEVICE_PATH "/sys/bus/gpio/devices/gpiochip%u"
+#define GPIO_CHIP_MAX 64
+#define GPIO_CONSUMER "soletta"
+/* Edge events read from the kernel at once */
+#define GPIO_EVENT_BATCH 16
+#endif
+
 struct sol_gpio {
     uint32_t pin;
 
     FILE *fp;
+#ifdef HAVE_GPIO_CDEV
+    int line_fd; /* line request on a gpiochip, -1 when using sysfs */
+    uint64_t event_timestamp;
+#endif
     struct {
         struct sol_fd *fd_watch;
         struct sol_timeout *timer;
@@ -53,11 +71,31 @@ struct sol_gpio {
         bool last_value : 1;
         bool on_raise : 1;
         bool on_fall : 1;
+        bool dispatching : 1;
+        bool pending_close : 1;
     } irq;
 
     bool owned;
 };
 
+#ifdef HAVE_GPIO_CDEV
+/* Lines of a bank living in the same chip, requested at once */
+struct gpio_bank_lines {
+    int fd;
+    unsigned int count;
+    uint8_t pins[GPIO_V2_LINES_MAX]; /* bank index of each line */
+};
+#endif
+
+struct sol_gpio_bank {
+#ifdef HAVE_GPIO_CDEV
+    struct gpio_bank_lines *lines; /* NULL when using gpios */
+    unsigned int n_lines;
+#endif
+    unsigned int count;
+    struct sol_gpio *gpios[];
+};
+
 static bool
 _gpio_export(uint32_t gpio, bool unexport)
 {
@@ -281,12 +319,304 @@ _gpio_config(struct sol_gpio *gpio, const struct sol_gpio_config *config)
     return 0;
 }
 
+#ifdef HAVE_GPIO_CDEV
+struct chip_base_data {
+    const char *device;
+    size_t parent_len;
+    const char *label;
+    uint32_t lines;
+    int base;
+    unsigned int matches;
+};
+
+/* The sysfs gpiochip<base> entries are children of their chip's parent
+ * device or, for chips without one, of the gpiochipN device itself.
+ * Label and number of lines only tell apart chips of the same parent. */
+static bool
+_gpio_chip_base_cb(void *data, const char *dir_path, struct dirent *ent)
+{
+    struct chip_base_data *chip = data;
+    char path[PATH_MAX], device[PATH_MAX], *label = NULL;
+    unsigned int ngpio;
+    size_t device_len;
+    int base, len;
+    bool found;
+
+    if (strncmp(ent->d_name, "gpiochip", strlen("gpiochip")))
+        return false;
+
+    len = snprintf(path, sizeof(path), "%s/%s/device", dir_path, ent->d_name);
+    if (len < 0 || len >= PATH_MAX || !realpath(path, device))
+        return false;
+    device_len = strlen(device);
+    if (!streq(device, chip->device) && (device_len != chip->parent_len ||
+        strncmp(device, chip->device, device_len)))
+        return false;
+
+    len = snprintf(path, sizeof(path), "%s/%s/ngpio", dir_path, ent->d_name);
+    if (len < 0 || len >= PATH_MAX ||
+        sol_util_read_file(path, "%u", &ngpio) < 0 || ngpio != chip->lines)
+        return false;
+
+    len = snprintf(path, sizeof(path), "%s/%s/label", dir_path, ent->d_name);
+    if (len < 0 || len >= PATH_MAX ||
+        sol_util_read_file(path, "%ms", &label) < 0)
+        return false;
+    found = streq(label, chip->label);
+    free(label);
+    if (!found)
+        return false;
+
+    len = snprintf(path, sizeof(path), "%s/%s/base", dir_path, ent->d_name);
+    if (len < 0 || len >= PATH_MAX || sol_util_read_file(path, "%d", &base) < 0)
+        return false;
+
+    chip->base = base;
+    chip->matches++;
+    return false;
+}
+
+static int
+_gpio_chip_base_get(unsigned int chip_index, const struct gpiochip_info *info)
+{
+    struct chip_base_data chip = {
+        .label = info->label,
+        .lines = info->lines,
+    };
+    char path[PATH_MAX], device[PATH_MAX], *sep;
+
+    snprintf(path, sizeof(path), GPIO_CHIP_DEVICE_PATH, chip_index);
+    if (!realpath(path, device))
+        return -errno;
+
+    sep = strrchr(device, '/');
+    chip.device = device;
+    chip.parent_len = sep ? (size_t)(sep - device) : 0;
+
+    sol_util_iterate_dir(GPIO_BASE, _gpio_chip_base_cb, &chip);
+    if (chip.matches != 1)
+        return -ENODEV;
+
+    return chip.base;
+}
+
+struct gpio_chip {
+    int fd;
+    uint32_t base;
+    uint32_t lines;
+};
+
+/* Pins are numbered as in sysfs: chip base plus line offset. If sysfs
+ * is not available to tell chip bases, chips are numbered one after
+ * another, in gpiochip order. Chips whose base sysfs can't tell are
+ * left out, so their pins are handled through sysfs. */
+static unsigned int
+_gpio_chips_open(struct gpio_chip *chips)
+{
+    struct gpiochip_info info;
+    char path[PATH_MAX];
+    uint32_t next_base = 0;
+    unsigned int i, count = 0;
+    bool has_sysfs;
+    int fd, base;
+
+    has_sysfs = !access(GPIO_BASE, R_OK);
+
+    for (i = 0; i < GPIO_CHIP_MAX; i++) {
+        snprintf(path, sizeof(path), GPIO_CHIP_PATH, i);
+        fd = open(path, O_RDWR | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+
+        if (ioctl(fd, GPIO_GET_CHIPINFO_IOCTL, &info) < 0) {
+            close(fd);
+            continue;
+        }
+
+        base = next_base;
+        next_base += info.lines;
+        if (has_sysfs) {
+            base = _gpio_chip_base_get(i, &info);
+            if (base < 0) {
+                SOL_DBG("gpiochip%u: could not find its base on sysfs", i);
+                close(fd);
+                continue;
+            }
+        }
+
+        chips[count].fd = fd;
+        chips[count].base = base;
+        chips[count].lines = info.lines;
+        count++;
+    }
+
+    return count;
+}
+
+static void
+_gpio_chips_close(struct gpio_chip *chips, unsigned int count)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++)
+        close(chips[i].fd);
+}
+
+static struct gpio_chip *
+_gpio_chip_find(struct gpio_chip *chips, unsigned int count, uint32_t pin,
+    uint32_t *offset)
+{
+    unsigned int i;
+
+    for (i = 0; i < count; i++) {
+        if (pin >= chips[i].base && pin - chips[i].base < chips[i].lines) {
+            *offset = pin - chips[i].base;
+            return &chips[i];
+        }
+    }
+
+    return NULL;
+}
+
+static int
+_gpio_cdev_request(int chip_fd, const uint32_t *offsets, unsigned int count,
+    const struct sol_gpio_config *config)
+{
+    struct gpio_v2_line_request req = { };
+    struct gpio_v2_line_config *lc = &req.config;
+    unsigned int i;
+
+    memcpy(req.offsets, offsets, count * sizeof(*offsets));
+    req.num_lines = count;
+    strncpy(req.consumer, GPIO_CONSUMER, sizeof(req.consumer) - 1);
+
+    if (config->active_low)
+        lc->flags |= GPIO_V2_LINE_FLAG_ACTIVE_LOW;
+
+    if (config->drive_mode == SOL_GPIO_DRIVE_PULL_UP)
+        lc->flags |= GPIO_V2_LINE_FLAG_BIAS_PULL_UP;
+    else if (config->drive_mode == SOL_GPIO_DRIVE_PULL_DOWN)
+        lc->flags |= GPIO_V2_LINE_FLAG_BIAS_PULL_DOWN;
+
+    if (config->dir == SOL_GPIO_DIR_OUT) {
+        lc->flags |= GPIO_V2_LINE_FLAG_OUTPUT;
+        lc->attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES;
+        lc->attrs[0].attr.values = config->out.value ? UINT64_MAX : 0;
+        for (i = 0; i < count; i++)
+            lc->attrs[0].mask |= (uint64_t)1 << i;
+        lc->num_attrs = 1;
+    } else {
+        lc->flags |= GPIO_V2_LINE_FLAG_INPUT;
+        if (config->in.trigger_mode == SOL_GPIO_EDGE_RISING ||
+            config->in.trigger_mode == SOL_GPIO_EDGE_BOTH)
+            lc->flags |= GPIO_V2_LINE_FLAG_EDGE_RISING;
+        if (config->in.trigger_mode == SOL_GPIO_EDGE_FALLING ||
+            config->in.trigger_mode == SOL_GPIO_EDGE_BOTH)
+            lc->flags |= GPIO_V2_LINE_FLAG_EDGE_FALLING;
+
+        if (config->in.debounce_period) {
+            lc->attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_DEBOUNCE;
+            lc->attrs[0].attr.debounce_period_us = config->in.debounce_period;
+            for (i = 0; i < count; i++)
+                lc->attrs[0].mask |= (uint64_t)1 << i;
+            lc->num_attrs = 1;
+        }
+    }
+
+    if (ioctl(chip_fd, GPIO_V2_GET_LINE_IOCTL, &req) < 0)
+        return -errno;
+
+    return req.fd;
+}
+
+static void _gpio_free(struct sol_gpio *gpio);
+
+static bool
+_gpio_cdev_on_event(void *userdata, int fd, uint32_t cond)
+{
+    struct sol_gpio *gpio = userdata;
+    struct gpio_v2_line_event events[GPIO_EVENT_BATCH];
+    ssize_t len;
+    size_t i, n;
+
+    if (cond & (SOL_FD_FLAGS_ERR | SOL_FD_FLAGS_HUP | SOL_FD_FLAGS_NVAL)) {
+        SOL_WRN("gpio #%u: error polling line events", gpio->pin);
+        gpio->irq.fd_watch = NULL;
+        return false;
+    }
+
+    len = read(fd, events, sizeof(events));
+    if (len < 0) {
+        if (errno != EAGAIN && errno != EINTR)
+            SOL_WRN("gpio #%u: could not read line events: %s", gpio->pin,
+                sol_util_strerrora(errno));
+        return true;
+    }
+
+    /* A close() from the callback is only carried out after the batch */
+    gpio->irq.dispatching = true;
+    n = len / sizeof(events[0]);
+    for (i = 0; i < n && !gpio->irq.pending_close; i++) {
+        gpio->event_timestamp = events[i].timestamp_ns;
+        gpio->irq.cb((void *)gpio->irq.data, gpio,
+            events[i].id == GPIO_V2_LINE_EVENT_RISING_EDGE);
+    }
+    gpio->irq.dispatching = false;
+
+    if (gpio->irq.pending_close) {
+        gpio->irq.fd_watch = NULL;
+        _gpio_free(gpio);
+        return false;
+    }
+
+    return true;
+}
+
+static int
+_gpio_cdev_open(struct sol_gpio *gpio, const struct sol_gpio_config *config)
+{
+    struct gpio_chip chips[GPIO_CHIP_MAX], *chip;
+    unsigned int count;
+    uint32_t offset;
+    int r = -ENODEV;
+
+    count = _gpio_chips_open(chips);
+    chip = _gpio_chip_find(chips, count, gpio->pin, &offset);
+    if (chip)
+        r = _gpio_cdev_request(chip->fd, &offset, 1, config);
+    _gpio_chips_close(chips, count);
+    if (r < 0)
+        return r;
+    gpio->line_fd = r;
+
+    if (config->dir == SOL_GPIO_DIR_OUT ||
+        config->in.trigger_mode == SOL_GPIO_EDGE_NONE)
+        return 0;
+
+    gpio->irq.cb = config->in.cb;
+    gpio->irq.data = config->in.user_data;
+    gpio->irq.fd_watch = sol_fd_add(gpio->line_fd,
+        SOL_FD_FLAGS_IN | SOL_FD_FLAGS_ERR | SOL_FD_FLAGS_HUP,
+        _gpio_cdev_on_event, gpio);
+    if (!gpio->irq.fd_watch) {
+        close(gpio->line_fd);
+        gpio->line_fd = -1;
+        return -ENOMEM;
+    }
+
+    return 0;
+}
+#endif
+
 SOL_API struct sol_gpio *
 sol_gpio_open_raw(uint32_t pin, const struct sol_gpio_config *config)
 {
     struct sol_gpio *gpio;
     char gpio_dir[PATH_MAX];
     struct stat st;
+#ifdef HAVE_GPIO_CDEV
+    int r;
+#endif
 
     SOL_LOG_INTERNAL_INIT_ONCE;
 
@@ -305,6 +635,20 @@ sol_gpio_open_raw(uint32_t pin, const struct sol_gpio_config *config)
         return NULL;
     }
 
+    gpio->pin = pin;
+
+#ifdef HAVE_GPIO_CDEV
+    gpio->line_fd = -1;
+    r = _gpio_cdev_open(gpio, config);
+    if (r == 0)
+        return gpio;
+    SOL_DBG("gpio #%u: could not use GPIO character device (%s), "
+        "falling back to sysfs", pin, sol_util_strerrora(-r));
+#endif
+
+    if (config->dir == SOL_GPIO_DIR_IN && config->in.debounce_period)
+        SOL_INF("gpio #%u: debounce is not supported by sysfs, ignoring it", pin);
+
     snprintf(gpio_dir, sizeof(gpio_dir), GPIO_BASE "/gpio%u", pin);
     if (stat(gpio_dir, &st)) {
         if (!_gpio_export(pin, false)) {
@@ -314,8 +658,6 @@ sol_gpio_open_raw(uint32_t pin, const struct sol_gpio_config *config)
         gpio->owned = true;
     }
 
-    gpio->pin = pin;
-
     if (_gpio_config(gpio, config) < 0)
         goto open_error;
 
@@ -328,16 +670,18 @@ export_error:
     return NULL;
 }
 
-SOL_API void
-sol_gpio_close(struct sol_gpio *gpio)
+static void
+_gpio_free(struct sol_gpio *gpio)
 {
-    SOL_NULL_CHECK(gpio);
-
     if (gpio->irq.fd_watch)
         sol_fd_del(gpio->irq.fd_watch);
     if (gpio->irq.timer)
         sol_timeout_del(gpio->irq.timer);
 
+#ifdef HAVE_GPIO_CDEV
+    if (gpio->line_fd > -1)
+        close(gpio->line_fd);
+#endif
     if (gpio->fp)
         fclose(gpio->fp);
 
@@ -346,11 +690,32 @@ sol_gpio_close(struct sol_gpio *gpio)
     free(gpio);
 }
 
+SOL_API void
+sol_gpio_close(struct sol_gpio *gpio)
+{
+    SOL_NULL_CHECK(gpio);
+
+    if (gpio->irq.dispatching) {
+        gpio->irq.pending_close = true;
+        return;
+    }
+
+    _gpio_free(gpio);
+}
+
 SOL_API bool
 sol_gpio_write(struct sol_gpio *gpio, bool val)
 {
     SOL_NULL_CHECK(gpio, false);
 
+#ifdef HAVE_GPIO_CDEV
+    if (gpio->line_fd > -1) {
+        struct gpio_v2_line_values values = { .bits = val, .mask = 1 };
+
+        return ioctl(gpio->line_fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &values) == 0;
+    }
+#endif
+
     return fprintf(gpio->fp, "%d", val) > 0;
 }
 
@@ -361,6 +726,18 @@ sol_gpio_read(struct sol_gpio *gpio)
 
     SOL_NULL_CHECK(gpio, -EINVAL);
 
+#ifdef HAVE_GPIO_CDEV
+    if (gpio->line_fd > -1) {
+        struct gpio_v2_line_values values = { .mask = 1 };
+
+        if (ioctl(gpio->line_fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values) < 0) {
+            SOL_WRN("gpio #%u: could not read value", gpio->pin);
+            return -errno;
+        }
+        return values.bits & 1;
+    }
+#endif
+
     rewind(gpio->fp);
     if (fscanf(gpio->fp, "%d", &val) < 1) {
         SOL_WRN("gpio #%u: could not read value", gpio->pin);
@@ -369,3 +746,272 @@ sol_gpio_read(struct sol_gpio *gpio)
 
     return val;
 }
+
+SOL_API int
+sol_gpio_get_event_timestamp(const struct sol_gpio *gpio, uint64_t *timestamp)
+{
+    SOL_NULL_CHECK(gpio, -EINVAL);
+    SOL_NULL_CHECK(timestamp, -EINVAL);
+
+#ifdef HAVE_GPIO_CDEV
+    if (gpio->line_fd > -1 && gpio->irq.dispatching) {
+        *timestamp = gpio->event_timestamp;
+        return 0;
+    }
+#endif
+
+    return -ENOTSUP;
+}
+
+#ifdef HAVE_GPIO_CDEV
+static void
+_gpio_bank_lines_close(struct sol_gpio_bank *bank)
+{
+    unsigned int i;
+
+    for (i = 0; i < bank->n_lines; i++)
+        close(bank->lines[i].fd);
+    free(bank->lines);
+    bank->lines = NULL;
+    bank->n_lines = 0;
+}
+#endif
+
+static void
+_gpio_bank_free(struct sol_gpio_bank *bank)
+{
+    unsigned int i;
+
+#ifdef HAVE_GPIO_CDEV
+    _gpio_bank_lines_close(bank);
+#endif
+    for (i = 0; i < bank->count; i++) {
+        if (bank->gpios[i])
+            sol_gpio_close(bank->gpios[i]);
+    }
+    free(bank);
+}
+
+#ifdef HAVE_GPIO_CDEV
+static uint64_t
+_gpio_lines_mask(unsigned int count)
+{
+    return count == 64 ? UINT64_MAX : ((uint64_t)1 << count) - 1;
+}
+
+/* Chips are looked up once, then pins are grouped in a single request
+ * per chip */
+static int
+_gpio_bank_cdev_open(struct sol_gpio_bank *bank, const uint32_t *pins,
+    const struct sol_gpio_config *config)
+{
+    struct gpio_chip chips[GPIO_CHIP_MAX], *chip;
+    struct gpio_chip *pin_chips[SOL_GPIO_BANK_MAX];
+    uint32_t pin_offsets[SOL_GPIO_BANK_MAX], offsets[GPIO_V2_LINES_MAX];
+    struct gpio_bank_lines *lines;
+    unsigned int i, j, count;
+    int r = 0;
+
+    count = _gpio_chips_open(chips);
+    for (i = 0; i < bank->count; i++) {
+        pin_chips[i] = _gpio_chip_find(chips, count, pins[i], &pin_offsets[i]);
+        if (!pin_chips[i]) {
+            r = -ENODEV;
+            goto end;
+        }
+    }
+
+    bank->lines = calloc(bank->count, sizeof(*bank->lines));
+    if (!bank->lines) {
+        r = -ENOMEM;
+        goto end;
+    }
+
+    for (i = 0; i < bank->count; i++) {
+        chip = pin_chips[i];
+        if (!chip)
+            continue;
+
+        lines = &bank->lines[bank->n_lines];
+        for (j = i; j < bank->count; j++) {
+            if (pin_chips[j] != chip)
+                continue;
+            offsets[lines->count] = pin_offsets[j];
+            lines->pins[lines->count++] = j;
+            pin_chips[j] = NULL;
+        }
+
+        r = _gpio_cdev_request(chip->fd, offsets, lines->count, config);
+        if (r < 0) {
+            _gpio_bank_lines_close(bank);
+            goto end;
+        }
+        lines->fd = r;
+        bank->n_lines++;
+        r = 0;
+    }
+
+end:
+    _gpio_chips_close(chips, count);
+    return r;
+}
+#endif
+
+SOL_API struct sol_gpio_bank *
+sol_gpio_bank_open(const uint32_t *pins, unsigned int count,
+    const struct sol_gpio_config *config)
+{
+    struct sol_gpio_bank *bank;
+    unsigned int i;
+#ifdef HAVE_GPIO_CDEV
+    int r;
+#endif
+
+    SOL_LOG_INTERNAL_INIT_ONCE;
+
+    SOL_NULL_CHECK(pins, NULL);
+    SOL_NULL_CHECK(config, NULL);
+    SOL_INT_CHECK(count, == 0, NULL);
+    SOL_INT_CHECK(count, > SOL_GPIO_BANK_MAX, NULL);
+
+#ifndef SOL_NO_API_VERSION
+    if (SOL_UNLIKELY(config->api_version != SOL_GPIO_CONFIG_API_VERSION)) {
+        SOL_WRN("Couldn't open gpio bank that has unsupported version '%u', "
+            "expected version is '%u'",
+            config->api_version, SOL_GPIO_CONFIG_API_VERSION);
+        return NULL;
+    }
+#endif
+
+    if (config->dir == SOL_GPIO_DIR_IN &&
+        config->in.trigger_mode != SOL_GPIO_EDGE_NONE) {
+        SOL_WRN("gpio bank: edge events are not supported, open each gpio instead");
+        return NULL;
+    }
+
+    bank = calloc(1, sizeof(*bank) + count * sizeof(struct sol_gpio *));
+    SOL_NULL_CHECK(bank, NULL);
+    bank->count = count;
+
+#ifdef HAVE_GPIO_CDEV
+    r = _gpio_bank_cdev_open(bank, pins, config);
+    if (r == 0)
+        return bank;
+    SOL_DBG("gpio bank: could not request lines per chip (%s), "
+        "opening them one by one", sol_util_strerrora(-r));
+#endif
+
+    for (i = 0; i < count; i++) {
+        bank->gpios[i] = sol_gpio_open_raw(pins[i], config);
+        if (!bank->gpios[i]) {
+            SOL_WRN("gpio bank: could not open gpio #%u", pins[i]);
+            goto error;
+        }
+    }
+
+    return bank;
+
+error:
+    _gpio_bank_free(bank);
+    return NULL;
+}
+
+SOL_API void
+sol_gpio_bank_close(struct sol_gpio_bank *bank)
+{
+    SOL_NULL_CHECK(bank);
+
+    _gpio_bank_free(bank);
+}
+
+SOL_API int
+sol_gpio_bank_read(struct sol_gpio_bank *bank, uint64_t *values)
+{
+    unsigned int i;
+    int r;
+
+    SOL_NULL_CHECK(bank, -EINVAL);
+    SOL_NULL_CHECK(values, -EINVAL);
+
+    *values = 0;
+
+#ifdef HAVE_GPIO_CDEV
+    if (bank->lines) {
+        struct gpio_v2_line_values lv;
+        struct gpio_bank_lines *lines;
+        unsigned int j;
+
+        for (i = 0; i < bank->n_lines; i++) {
+            lines = &bank->lines[i];
+            lv.bits = 0;
+            lv.mask = _gpio_lines_mask(lines->count);
+            if (ioctl(lines->fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &lv) < 0)
+                return -errno;
+            for (j = 0; j < lines->count; j++) {
+                if (lv.bits & ((uint64_t)1 << j))
+                    *values |= (uint64_t)1 << lines->pins[j];
+            }
+        }
+        return 0;
+    }
+#endif
+
+    for (i = 0; i < bank->count; i++) {
+        r = sol_gpio_read(bank->gpios[i]);
+        if (r < 0)
+            return r;
+        if (r)
+            *values |= (uint64_t)1 << i;
+    }
+
+    return 0;
+}
+
+SOL_API int
+sol_gpio_bank_write(struct sol_gpio_bank *bank, uint64_t values, uint64_t mask)
+{
+    unsigned int i;
+
+    SOL_NULL_CHECK(bank, -EINVAL);
+
+    if (bank->count < 64)
+        mask &= ((uint64_t)1 << bank->count) - 1;
+    if (!mask)
+        return 0;
+
+#ifdef HAVE_GPIO_CDEV
+    if (bank->lines) {
+        struct gpio_v2_line_values lv;
+        struct gpio_bank_lines *lines;
+        uint64_t bit;
+        unsigned int j;
+
+        for (i = 0; i < bank->n_lines; i++) {
+            lines = &bank->lines[i];
+            lv.bits = lv.mask = 0;
+            for (j = 0; j < lines->count; j++) {
+                bit = (uint64_t)1 << lines->pins[j];
+                if (!(mask & bit))
+                    continue;
+                lv.mask |= (uint64_t)1 << j;
+                if (values & bit)
+                    lv.bits |= (uint64_t)1 << j;
+            }
+            if (!lv.mask)
+                continue;
+            if (ioctl(lines->fd, GPIO_V2_LINE_SET_VALUES_IOCTL, &lv) < 0)
+                return -errno;
+        }
+        return 0;
+    }
+#endif
+
+    for (i = 0; i < bank->count; i++) {
+        if (!(mask & ((uint64_t)1 << i)))
+            continue;
+        if (!sol_gpio_write(bank->gpios[i], values & ((uint64_t)1 << i)))
+            return -EIO;
+    }
+
+    return 0;
+}
@@ -238,3 +238,38 @@ sol_gpio_read(struct sol_gpio *gpio)
 
     return gpio->active_low ^ !!value;
 }
+
+SOL_API int
+sol_gpio_get_event_timestamp(const struct sol_gpio *gpio, uint64_t *timestamp)
+{
+    SOL_NULL_CHECK(gpio, -EINVAL);
+    SOL_NULL_CHECK(timestamp, -EINVAL);
+
+    return -ENOTSUP;
+}
+
+SOL_API struct sol_gpio_bank *
+sol_gpio_bank_open(const uint32_t *pins, unsigned int count,
+    const struct sol_gpio_config *config)
+{
+    SOL_WRN("gpio bank: not supported on this platform");
+    errno = ENOTSUP;
+    return NULL;
+}
+
+SOL_API void
+sol_gpio_bank_close(struct sol_gpio_bank *bank)
+{
+}
+
+SOL_API int
+sol_gpio_bank_read(struct sol_gpio_bank *bank, uint64_t *values)
+{
+    return -ENOTSUP;
+}
+
+SOL_API int
+sol_gpio_bank_write(struct sol_gpio_bank *bank, uint64_t values, uint64_t mask)
+{
+    return -ENOTSUP;
+}
@@ -46,10 +46,13 @@
 SOL_LOG_INTERNAL_DECLARE_STATIC(_log_domain, "i2c");
 
 #include "sol-i2c.h"
+#include "sol-list.h"
 #include "sol-macros.h"
 #include "sol-mainloop.h"
 #include "sol-util-internal.h"
 #ifdef WORKER_THREAD
+#include <pthread.h>
+
 #include "sol-worker-thread.h"
 #endif
 
@@ -63,45 +66,75 @@ struct i2c_create_device {
     int result;
 };
 
+enum i2c_op_type {
+    I2C_OP_WRITE_QUICK,
+    I2C_OP_READ,
+    I2C_OP_WRITE,
+    I2C_OP_READ_REGISTER,
+    I2C_OP_WRITE_REGISTER,
+    I2C_OP_READ_REGISTER_MULTIPLE
+};
+
+struct i2c_op {
+    struct sol_list list;
+    const void *cb_data;
+    uint8_t *data;
+    size_t count;
+    ssize_t status;
+    enum i2c_op_type type;
+    uint8_t addr;
+    uint8_t reg;
+    uint8_t times; // Only used on read_register_multiple()
+    bool rw; // Only used on write_quick()
+
+    union {
+        void (*write_quick_cb)(void *cb_data, struct sol_i2c *i2c, ssize_t status);
+        void (*read_write_cb)(void *cb_data, struct sol_i2c *i2c, uint8_t *data, ssize_t status);
+        void (*read_write_reg_cb)(void *cb_data, struct sol_i2c *i2c, uint8_t reg, uint8_t *data, ssize_t status);
+    };
+
+    /* Register followed by the payload, for plain-I2C register writes */
+    uint8_t buf[];
+};
+
 struct sol_i2c {
     int dev;
     uint8_t bus;
     uint8_t addr;
+    uint8_t dev_addr; // Address last set on dev, only touched by the executor
     bool plain_i2c;
-    struct {
-        const void *cb_data;
+    bool closing;
+    uint16_t dispatching;
+
+    /* Operations move from queued to running (while their transfer is
+     * done) to completed (until their callbacks are dispatched) */
+    struct sol_list queued;
+    struct sol_list running;
+    struct sol_list completed;
 #ifdef WORKER_THREAD
-        struct sol_worker_thread *worker;
+    pthread_mutex_t lock;
+    struct sol_worker_thread *worker;
+    struct sol_idle *dispatcher;
 #else
-        struct sol_timeout *timeout;
+    struct sol_timeout *timeout;
 #endif
-        uint8_t *data;
-        size_t count;
-        ssize_t status;
-        uint8_t reg;
-        uint8_t times; // Only used on read_register_multiple()
-        void (*dispatch)(struct sol_i2c *i2c);
-
-        union {
-            struct {
-                void (*cb)(void *cb_data, struct sol_i2c *i2c, ssize_t status);
-            } write_quick_cb;
-            struct {
-                void (*cb)(void *cb_data, struct sol_i2c *i2c, uint8_t *data, ssize_t status);
-            } read_write_cb;
-            struct {
-                void (*cb)(void *cb_data, struct sol_i2c *i2c, uint8_t reg, uint8_t *data, ssize_t status);
-            } read_write_reg_cb;
-        };
-    } async;
-
 };
 
+static void
+i2c_lock(struct sol_i2c *i2c)
+{
 #ifdef WORKER_THREAD
-#define BUSY_CHECK(i2c, ret) SOL_EXP_CHECK(i2c->async.worker, ret);
-#else
-#define BUSY_CHECK(i2c, ret) SOL_EXP_CHECK(i2c->async.timeout, ret);
+    pthread_mutex_lock(&i2c->lock);
+#endif
+}
+
+static void
+i2c_unlock(struct sol_i2c *i2c)
+{
+#ifdef WORKER_THREAD
+    pthread_mutex_unlock(&i2c->lock);
 #endif
+}
 
 SOL_API struct sol_i2c *
 sol_i2c_open_raw(uint8_t bus, enum sol_i2c_speed speed)
@@ -133,6 +166,9 @@ sol_i2c_open_raw(uint8_t bus, enum sol_i2c_speed speed)
     }
     i2c->bus = bus;
     i2c->dev = dev;
+    sol_list_init(&i2c->queued);
+    sol_list_init(&i2c->running);
+    sol_list_init(&i2c->completed);
 
     /* check if the given I2C adapter supports plain-i2c messages */
     if (ioctl(i2c->dev, I2C_FUNCS, &funcs) == -1)
@@ -140,6 +176,13 @@ sol_i2c_open_raw(uint8_t bus, enum sol_i2c_speed speed)
 
     i2c->plain_i2c = (funcs & I2C_FUNC_I2C);
 
+#ifdef WORKER_THREAD
+    if (pthread_mutex_init(&i2c->lock, NULL) != 0) {
+        SOL_WRN("i2c #%u: could not create lock", bus);
+        goto ioctl_error;
+    }
+#endif
+
     return i2c;
 
 ioctl_error:
@@ -149,23 +192,104 @@ open_error:
     return NULL;
 }
 
+static void
+i2c_dispatch_op(struct sol_i2c *i2c, struct i2c_op *op)
+{
+    switch (op->type) {
+    case I2C_OP_WRITE_QUICK:
+        if (op->write_quick_cb)
+            op->write_quick_cb((void *)op->cb_data, i2c, op->status);
+        break;
+    case I2C_OP_READ:
+    case I2C_OP_WRITE:
+        if (op->read_write_cb)
+            op->read_write_cb((void *)op->cb_data, i2c, op->data, op->status);
+        break;
+    default:
+        if (op->read_write_reg_cb)
+            op->read_write_reg_cb((void *)op->cb_data, i2c, op->reg, op->data,
+                op->status);
+    }
+
+    free(op);
+}
+
+static void
+i2c_free(struct sol_i2c *i2c)
+{
+    struct sol_list *list;
+    struct i2c_op *op;
+
+    /* Callbacks of the operations left behind are still called, with
+     * -ECANCELED as status if they never ran */
+    i2c->dispatching++;
+    while (!sol_list_is_empty(&i2c->completed) || !sol_list_is_empty(&i2c->queued)) {
+        list = sol_list_is_empty(&i2c->completed) ? &i2c->queued : &i2c->completed;
+        op = SOL_LIST_GET_CONTAINER(list->next, struct i2c_op, list);
+        sol_list_remove(&op->list);
+        i2c_dispatch_op(i2c, op);
+    }
+
+#ifdef WORKER_THREAD
+    pthread_mutex_destroy(&i2c->lock);
+#endif
+    close(i2c->dev);
+    free(i2c);
+}
+
+static void
+i2c_dispatch_completed(struct sol_i2c *i2c)
+{
+    struct i2c_op *op;
+
+    i2c->dispatching++;
+    while (!i2c->closing) {
+        i2c_lock(i2c);
+        if (sol_list_is_empty(&i2c->completed)) {
+            i2c_unlock(i2c);
+            break;
+        }
+        op = SOL_LIST_GET_CONTAINER(i2c->completed.next, struct i2c_op, list);
+        sol_list_remove(&op->list);
+        i2c_unlock(i2c);
+
+        i2c_dispatch_op(i2c, op);
+    }
+    i2c->dispatching--;
+
+    /* One of the callbacks closed the bus */
+    if (i2c->closing && !i2c->dispatching)
+        i2c_free(i2c);
+}
+
 SOL_API void
 sol_i2c_close_raw(struct sol_i2c *i2c)
 {
-    struct sol_i2c_pending *pending;
-
     SOL_NULL_CHECK(i2c);
+    SOL_EXP_CHECK(i2c->closing);
+
+    i2c->closing = true;
 
 #ifdef WORKER_THREAD
-    pending = (struct sol_i2c_pending *)i2c->async.worker;
+    /* Cancelling waits for the transfer being done, if any */
+    if (i2c->worker)
+        sol_worker_thread_cancel(i2c->worker);
+    if (i2c->dispatcher) {
+        sol_idle_del(i2c->dispatcher);
+        i2c->dispatcher = NULL;
+    }
 #else
-    pending = (struct sol_i2c_pending *)i2c->async.timeout;
+    if (i2c->timeout) {
+        sol_timeout_del(i2c->timeout);
+        i2c->timeout = NULL;
+    }
 #endif
-    if (pending)
-        sol_i2c_pending_cancel(i2c, pending);
 
-    close(i2c->dev);
-    free(i2c);
+    /* Called from an operation callback: the dispatcher frees it */
+    if (i2c->dispatching)
+        return;
+
+    i2c_free(i2c);
 }
 
 static int32_t
@@ -196,7 +320,26 @@ _i2c_smbus_ioctl(int dev, uint8_t rw, uint8_t command, size_t size, union i2c_sm
     return 0;
 }
 
-static void
+static int
+_i2c_select_address(struct sol_i2c *i2c, uint8_t addr)
+{
+    int r;
+
+    if (i2c->dev_addr == addr)
+        return 0;
+
+    if (ioctl(i2c->dev, I2C_SLAVE, addr) == -1) {
+        r = -errno;
+        SOL_WRN("I2C (bus = %u): could not specify device address 0x%x",
+            i2c->bus, addr);
+        return r;
+    }
+    i2c->dev_addr = addr;
+
+    return 0;
+}
+
+static ssize_t
 _i2c_write_quick(struct sol_i2c *i2c, bool rw)
 {
     struct i2c_smbus_ioctl_data ioctldata = {
@@ -207,91 +350,18 @@ _i2c_write_quick(struct sol_i2c *i2c, bool rw)
     };
 
     if (ioctl(i2c->dev, I2C_SMBUS, &ioctldata) == -1) {
+        ssize_t r = -errno;
+
         SOL_WRN("Unable to perform I2C-SMBus write quick (bus = %u,"
-            " device address = %u): %s", i2c->bus, i2c->addr,
-            sol_util_strerrora(errno));
-        return;
+            " device address = %u): %s", i2c->bus, i2c->dev_addr,
+            sol_util_strerrora(-r));
+        return r;
     }
 
-    i2c->async.status = 1;
-}
-
-static void
-_i2c_write_quick_dispatch(struct sol_i2c *i2c)
-{
-    if (!i2c->async.write_quick_cb.cb) return;
-    i2c->async.write_quick_cb.cb((void *)i2c->async.cb_data, i2c,
-        i2c->async.status);
-}
-
-#ifdef WORKER_THREAD
-static bool
-i2c_write_quick_worker_thread_iterate(void *data)
-{
-    struct sol_i2c *i2c = data;
-
-    _i2c_write_quick(i2c, (bool)(intptr_t)i2c->async.data);
-    return false;
-}
-
-static void
-i2c_worker_thread_finished(void *data)
-{
-    struct sol_i2c *i2c = data;
-
-    i2c->async.worker = NULL;
-    i2c->async.dispatch(i2c);
-}
-#else
-static bool
-i2c_write_quick_timeout_cb(void *data)
-{
-    struct sol_i2c *i2c = data;
-
-    _i2c_write_quick(i2c, (bool)(intptr_t)i2c->async.data);
-    i2c->async.timeout = NULL;
-    i2c->async.dispatch(i2c);
-    return false;
-}
-#endif
-
-SOL_API struct sol_i2c_pending *
-sol_i2c_write_quick(struct sol_i2c *i2c, bool rw, void (*write_quick_cb)(void *cb_data, struct sol_i2c *i2c, ssize_t status), const void *cb_data)
-{
-#ifdef WORKER_THREAD
-    struct sol_worker_thread_config config = {
-        SOL_SET_API_VERSION(.api_version = SOL_WORKER_THREAD_CONFIG_API_VERSION, )
-        .setup = NULL,
-        .cleanup = NULL,
-        .iterate = i2c_write_quick_worker_thread_iterate,
-        .finished = i2c_worker_thread_finished,
-        .feedback = NULL,
-        .data = i2c
-    };
-#endif
-
-    SOL_NULL_CHECK(i2c, NULL);
-    SOL_INT_CHECK(i2c->dev, == 0, NULL);
-    BUSY_CHECK(i2c, NULL);
-
-    i2c->async.data = (uint8_t *)(long)rw;
-    i2c->async.status = -1;
-    i2c->async.write_quick_cb.cb = write_quick_cb;
-    i2c->async.dispatch = _i2c_write_quick_dispatch;
-    i2c->async.cb_data = cb_data;
-
-#ifdef WORKER_THREAD
-    i2c->async.worker = sol_worker_thread_new(&config);
-    SOL_NULL_CHECK(i2c->async.worker, NULL);
-    return (struct sol_i2c_pending *)i2c->async.worker;
-#else
-    i2c->async.timeout = sol_timeout_add(0, i2c_write_quick_timeout_cb, i2c);
-    SOL_NULL_CHECK(i2c->async.timeout, NULL);
-    return (struct sol_i2c_pending *)i2c->async.timeout;
-#endif
+    return 1;
 }
 
-static bool
+static int
 write_byte(const struct sol_i2c *i2c, uint8_t byte)
 {
     struct i2c_smbus_ioctl_data ioctldata = {
@@ -302,15 +372,17 @@ write_byte(const struct sol_i2c *i2c, uint8_t byte)
     };
 
     if (ioctl(i2c->dev, I2C_SMBUS, &ioctldata) == -1) {
+        int r = -errno;
+
         SOL_WRN("Unable to perform I2C-SMBus write byte (bus = %u,"
             " device address = %u): %s",
-            i2c->bus, i2c->addr, sol_util_strerrora(errno));
-        return false;
+            i2c->bus, i2c->dev_addr, sol_util_strerrora(-r));
+        return r;
     }
-    return true;
+    return 0;
 }
 
-static bool
+static int
 read_byte(const struct sol_i2c *i2c, uint8_t *byte)
 {
     union i2c_smbus_data data;
@@ -322,176 +394,50 @@ read_byte(const struct sol_i2c *i2c, uint8_t *byte)
     };
 
     if (ioctl(i2c->dev, I2C_SMBUS, &ioctldata) == -1) {
+        int r = -errno;
+
         SOL_WRN("Unable to perform I2C-SMBus read byte (bus = %u,"
             " device address = %u): %s",
-            i2c->bus, i2c->addr, sol_util_strerrora(errno));
-        return false;
+            i2c->bus, i2c->dev_addr, sol_util_strerrora(-r));
+        return r;
     }
 
     *byte = data.byte;
 
-    return true;
+    return 0;
 }
 
-static void
-_i2c_read(struct sol_i2c *i2c, uint8_t *values)
+static ssize_t
+_i2c_read(struct sol_i2c *i2c, uint8_t *values, size_t count)
 {
     size_t i;
+    int r;
 
-    for (i = 0; i < i2c->async.count; i++) {
-        uint8_t byte;
-        if (!read_byte(i2c, &byte))
-            return;
-        *values = byte;
-        values++;
+    for (i = 0; i < count; i++) {
+        r = read_byte(i2c, values + i);
+        if (r < 0)
+            return r;
     }
-    i2c->async.status = i2c->async.count;
-}
-
-static void
-_i2c_read_write_dispatch(struct sol_i2c *i2c)
-{
-    if (!i2c->async.read_write_cb.cb) return;
-    i2c->async.read_write_cb.cb((void *)i2c->async.cb_data, i2c,
-        i2c->async.data, i2c->async.status);
-}
-
-#ifdef WORKER_THREAD
-static bool
-i2c_read_worker_thread_iterate(void *data)
-{
-    struct sol_i2c *i2c = data;
-
-    _i2c_read(i2c, i2c->async.data);
-    return false;
-}
-#else
-static bool
-i2c_read_timeout_cb(void *data)
-{
-    struct sol_i2c *i2c = data;
-
-    _i2c_read(i2c, i2c->async.data);
-    i2c->async.timeout = NULL;
-    i2c->async.dispatch(i2c);
-    return false;
-}
-#endif
-
-SOL_API struct sol_i2c_pending *
-sol_i2c_read(struct sol_i2c *i2c, uint8_t *values, size_t count, void (*read_cb)(void *cb_data, struct sol_i2c *i2c, uint8_t *data, ssize_t status), const void *cb_data)
-{
-#ifdef WORKER_THREAD
-    struct sol_worker_thread_config config = {
-        SOL_SET_API_VERSION(.api_version = SOL_WORKER_THREAD_CONFIG_API_VERSION, )
-        .setup = NULL,
-        .cleanup = NULL,
-        .iterate = i2c_read_worker_thread_iterate,
-        .finished = i2c_worker_thread_finished,
-        .feedback = NULL,
-        .data = i2c
-    };
-#endif
-
-    SOL_NULL_CHECK(i2c, NULL);
-    SOL_NULL_CHECK(values, NULL);
-    SOL_INT_CHECK(count, == 0, NULL);
-    SOL_INT_CHECK(i2c->dev, == 0, NULL);
-    BUSY_CHECK(i2c, NULL);
-
-    i2c->async.data = values;
-    i2c->async.count = count;
-    i2c->async.status = -1;
-    i2c->async.read_write_cb.cb = read_cb;
-    i2c->async.dispatch = _i2c_read_write_dispatch;
-    i2c->async.cb_data = cb_data;
 
-#ifdef WORKER_THREAD
-    i2c->async.worker = sol_worker_thread_new(&config);
-    SOL_NULL_CHECK(i2c->async.worker, NULL);
-    return (struct sol_i2c_pending *)i2c->async.worker;
-#else
-    i2c->async.timeout = sol_timeout_add(0, i2c_read_timeout_cb, i2c);
-    SOL_NULL_CHECK(i2c->async.timeout, NULL);
-    return (struct sol_i2c_pending *)i2c->async.timeout;
-#endif
+    return count;
 }
 
-static void
-_i2c_write(struct sol_i2c *i2c, uint8_t *values)
+static ssize_t
+_i2c_write(struct sol_i2c *i2c, const uint8_t *values, size_t count)
 {
     size_t i;
+    int r;
 
-    for (i = 0; i < i2c->async.count; i++) {
-        if (!write_byte(i2c, *values))
-            return;
-        values++;
+    for (i = 0; i < count; i++) {
+        r = write_byte(i2c, values[i]);
+        if (r < 0)
+            return r;
     }
-    i2c->async.status = i2c->async.count;
-}
-
-#ifdef WORKER_THREAD
-static bool
-i2c_write_worker_thread_iterate(void *data)
-{
-    struct sol_i2c *i2c = data;
-
-    _i2c_write(i2c, i2c->async.data);
-    return false;
-}
-#else
-static bool
-i2c_write_timeout_cb(void *data)
-{
-    struct sol_i2c *i2c = data;
-
-    _i2c_write(i2c, i2c->async.data);
-    i2c->async.timeout = NULL;
-    i2c->async.dispatch(i2c);
-    return false;
-}
-#endif
-
-SOL_API struct sol_i2c_pending *
-sol_i2c_write(struct sol_i2c *i2c, uint8_t *values, size_t count, void (*write_cb)(void *cb_data, struct sol_i2c *i2c, uint8_t *data, ssize_t status), const void *cb_data)
-{
-#ifdef WORKER_THREAD
-    struct sol_worker_thread_config config = {
-        SOL_SET_API_VERSION(.api_version = SOL_WORKER_THREAD_CONFIG_API_VERSION, )
-        .setup = NULL,
-        .cleanup = NULL,
-        .iterate = i2c_write_worker_thread_iterate,
-        .finished = i2c_worker_thread_finished,
-        .feedback = NULL,
-        .data = i2c
-    };
-#endif
-
-    SOL_NULL_CHECK(i2c, NULL);
-    SOL_NULL_CHECK(values, NULL);
-    SOL_INT_CHECK(count, == 0, NULL);
-    SOL_INT_CHECK(i2c->dev, == 0, NULL);
-    BUSY_CHECK(i2c, NULL);
 
-    i2c->async.data = values;
-    i2c->async.count = count;
-    i2c->async.status = -1;
-    i2c->async.read_write_cb.cb = write_cb;
-    i2c->async.dispatch = _i2c_read_write_dispatch;
-    i2c->async.cb_data = cb_data;
-
-#ifdef WORKER_THREAD
-    i2c->async.worker = sol_worker_thread_new(&config);
-    SOL_NULL_CHECK(i2c->async.worker, NULL);
-    return (struct sol_i2c_pending *)i2c->async.worker;
-#else
-    i2c->async.timeout = sol_timeout_add(0, i2c_write_timeout_cb, i2c);
-    SOL_NULL_CHECK(i2c->async.timeout, NULL);
-    return (struct sol_i2c_pending *)i2c->async.timeout;
-#endif
+    return count;
 }
 
-static int
+static ssize_t
 sol_i2c_plain_read_register(const struct sol_i2c *i2c,
     uint8_t command,
     uint8_t *values,
@@ -499,13 +445,13 @@ sol_i2c_plain_read_register(const struct sol_i2c *i2c,
 {
     struct i2c_msg msgs[] = {
         {
-            .addr = i2c->addr,
+            .addr = i2c->dev_addr,
             .flags = 0,
             .len = 1,
             .buf = &command
         },
         {
-            .addr = i2c->addr,
+            .addr = i2c->dev_addr,
             .flags = I2C_M_RD,
             .len = count,
             .buf = values,
@@ -520,43 +466,38 @@ sol_i2c_plain_read_register(const struct sol_i2c *i2c,
         SOL_WRN("Unable to read I2C data (bus = %u, device address = 0x%x, "
             "register = 0x%x): the bus/adapter does not support"
             " plain-I2C commands (only SMBus ones)",
-            i2c->bus, i2c->addr, command);
+            i2c->bus, i2c->dev_addr, command);
         return -ENOTSUP;
     }
 
     if (ioctl(i2c->dev, I2C_RDWR, &i2c_data) < 0) {
+        ssize_t r = -errno;
+
         SOL_WRN("Unable to perform I2C read/write (bus = %u,"
             " device address = 0x%x, register = 0x%x): %s",
-            i2c->bus, i2c->addr, command, sol_util_strerrora(errno));
-        return -errno;
+            i2c->bus, i2c->dev_addr, command, sol_util_strerrora(-r));
+        return r;
     }
 
     return count;
 }
 
-static void
-_i2c_read_register(struct sol_i2c *i2c)
+static ssize_t
+_i2c_read_register(struct sol_i2c *i2c, uint8_t command, uint8_t *values, size_t count)
 {
     union i2c_smbus_data data;
     ssize_t length;
     int32_t error;
-    size_t count = i2c->async.count;
-    uint8_t command = i2c->async.reg;
-    uint8_t *values = i2c->async.data;
-
-    if (count > 32) {
-        int ret = sol_i2c_plain_read_register(i2c, command, values, count);
-        if (ret > 0)
-            i2c->async.status = count;
-        return;
-    }
+
+    if (count > 32)
+        return sol_i2c_plain_read_register(i2c, command, values, count);
 
     if ((error = _i2c_smbus_ioctl(i2c->dev, I2C_SMBUS_READ, command,
             count, &data)) < 0) {
         SOL_WRN("Unable to perform I2C-SMBus read (byte/word/block) data "
             "(bus = %u, device address = 0x%x, register = 0x%x): %s",
-            i2c->bus, i2c->addr, command, sol_util_strerrora(-error));
-        return;
+            i2c->bus, i2c->dev_addr, command, sol_util_strerrora(-error));
+        return error;
     }
 
     // block[0] is the data block length. Up to I2C_SMBUS_BLOCK_MAX.
@@ -571,109 +512,36 @@ _i2c_read_register(struct sol_i2c *i2c)
     } else
         memcpy(values, data.block + 1, length);
 
-    i2c->async.status = count;
+    return count;
 }
 
-static void
-_i2c_read_write_reg_dispatch(struct sol_i2c *i2c)
+static ssize_t
+_i2c_read_register_multiple(struct sol_i2c *i2c, uint8_t command, uint8_t *values, size_t count, uint8_t times)
 {
-    if (!i2c->async.read_write_reg_cb.cb) return;
-    i2c->async.read_write_reg_cb.cb((void *)i2c->async.cb_data, i2c,
-        i2c->async.reg, i2c->async.data, i2c->async.status);
-}
+    struct i2c_msg msgs[I2C_RDRW_IOCTL_MAX_MSGS] = { };
+    struct i2c_rdwr_ioctl_data data = { };
+    const unsigned int max_times = I2C_RDRW_IOCTL_MAX_MSGS / 2;
+    uint8_t *p = values;
+    uint8_t left = times;
 
-#ifdef WORKER_THREAD
-static bool
-i2c_read_reg_worker_thread_iterate(void *data)
-{
-    struct sol_i2c *i2c = data;
+    if (!i2c->plain_i2c) {
+        SOL_WRN("Unable to read I2C data (bus = %u, device address = 0x%x, "
+            "register = 0x%x): the bus/adapter does not support"
+            " plain-I2C commands (only SMBus ones)",
+            i2c->bus, i2c->dev_addr, command);
+        return -ENOTSUP;
+    }
 
-    _i2c_read_register(i2c);
-    return false;
-}
-#else
-static bool
-i2c_read_reg_timeout_cb(void *data)
-{
-    struct sol_i2c *i2c = data;
-
-    _i2c_read_register(i2c);
-    i2c->async.timeout = NULL;
-    i2c->async.dispatch(i2c);
-    return false;
-}
-#endif
-
-SOL_API struct sol_i2c_pending *
-sol_i2c_read_register(struct sol_i2c *i2c, uint8_t reg, uint8_t *values, size_t count, void (*read_reg_cb)(void *cb_data, struct sol_i2c *i2c, uint8_t reg, uint8_t *data, ssize_t status), const void *cb_data)
-{
-#ifdef WORKER_THREAD
-    struct sol_worker_thread_config config = {
-        SOL_SET_API_VERSION(.api_version = SOL_WORKER_THREAD_CONFIG_API_VERSION, )
-        .setup = NULL,
-        .cleanup = NULL,
-        .iterate = i2c_read_reg_worker_thread_iterate,
-        .finished = i2c_worker_thread_finished,
-        .feedback = NULL,
-        .data = i2c
-    };
-#endif
-
-    SOL_NULL_CHECK(i2c, NULL);
-    SOL_NULL_CHECK(values, NULL);
-    SOL_INT_CHECK(count, == 0, NULL);
-    SOL_INT_CHECK(i2c->dev, == 0, NULL);
-    BUSY_CHECK(i2c, NULL);
-
-    i2c->async.data = values;
-    i2c->async.count = count;
-    i2c->async.status = -1;
-    i2c->async.read_write_reg_cb.cb = read_reg_cb;
-    i2c->async.dispatch = _i2c_read_write_reg_dispatch;
-    i2c->async.reg = reg;
-    i2c->async.cb_data = cb_data;
-
-#ifdef WORKER_THREAD
-    i2c->async.worker = sol_worker_thread_new(&config);
-    SOL_NULL_CHECK(i2c->async.worker, NULL);
-    return (struct sol_i2c_pending *)i2c->async.worker;
-#else
-    i2c->async.timeout = sol_timeout_add(0, i2c_read_reg_timeout_cb, i2c);
-    SOL_NULL_CHECK(i2c->async.timeout, NULL);
-    return (struct sol_i2c_pending *)i2c->async.timeout;
-#endif
-}
-
-static void
-_i2c_read_register_multiple(struct sol_i2c *i2c)
-{
-    struct i2c_msg msgs[I2C_RDRW_IOCTL_MAX_MSGS] = { };
-    struct i2c_rdwr_ioctl_data data = { };
-    const unsigned int max_times = I2C_RDRW_IOCTL_MAX_MSGS / 2;
-    uint8_t command = i2c->async.reg;
-    size_t count = i2c->async.count;
-    uint8_t times = i2c->async.times;
-    uint8_t *values = i2c->async.data;
-
-    if (!i2c->plain_i2c) {
-        SOL_WRN("Unable to read I2C data (bus = %u, device address = 0x%x, "
-            "register = 0x%x): the bus/adapter does not support"
-            " plain-I2C commands (only SMBus ones)",
-            i2c->bus, i2c->addr, command);
-        return;
-    }
-
-    while (times > 0) {
-        unsigned int n = times > max_times ? max_times : times;
-        unsigned int i;
-        uint8_t *p = values;
+    while (left > 0) {
+        unsigned int n = left > max_times ? max_times : left;
+        unsigned int i;
 
         for (i = 0; i < n * 2; i += 2) {
-            msgs[i].addr = i2c->addr;
+            msgs[i].addr = i2c->dev_addr;
             msgs[i].flags = 0;
             msgs[i].len = 1;
             msgs[i].buf = &command;
-            msgs[i + 1].addr = i2c->addr;
+            msgs[i + 1].addr = i2c->dev_addr;
             msgs[i + 1].flags = I2C_M_RD;
             msgs[i + 1].len = count;
             msgs[i + 1].buf = p;
@@ -684,92 +552,29 @@ _i2c_read_register_multiple(struct sol_i2c *i2c)
         data.nmsgs = 2 * n;
 
         if (ioctl(i2c->dev, I2C_RDWR, &data) == -1) {
+            ssize_t r = -errno;
+
             SOL_WRN("Unable to perform I2C read/write (bus = %u,"
                 " device address = 0x%x, register = 0x%x): %s",
-                i2c->bus, i2c->addr, command, sol_util_strerrora(errno));
-            return;
+                i2c->bus, i2c->dev_addr, command, sol_util_strerrora(-r));
+            return r;
         }
 
-        times -= n;
+        left -= n;
     }
 
-    i2c->async.status = i2c->async.count * i2c->async.times;
+    return count * times;
 }
 
-#ifdef WORKER_THREAD
-static bool
-i2c_read_reg_multiple_worker_thread_iterate(void *data)
+static ssize_t
+sol_i2c_plain_write_register(const struct sol_i2c *i2c, struct i2c_op *op)
 {
-    struct sol_i2c *i2c = data;
-
-    _i2c_read_register_multiple(i2c);
-    return false;
-}
-#else
-static bool
-i2c_read_reg_multiple_timeout_cb(void *data)
-{
-    struct sol_i2c *i2c = data;
-
-    _i2c_read_register_multiple(i2c);
-    i2c->async.timeout = NULL;
-    i2c->async.dispatch(i2c);
-    return false;
-}
-#endif
-
-SOL_API struct sol_i2c_pending *
-sol_i2c_read_register_multiple(struct sol_i2c *i2c, uint8_t reg, uint8_t *values, size_t count, uint8_t times, void (*read_reg_multiple_cb)(void *cb_data, struct sol_i2c *i2c, uint8_t reg, uint8_t *data, ssize_t status), const void *cb_data)
-{
-#ifdef WORKER_THREAD
-    struct sol_worker_thread_config config = {
-        SOL_SET_API_VERSION(.api_version = SOL_WORKER_THREAD_CONFIG_API_VERSION, )
-        .setup = NULL,
-        .cleanup = NULL,
-        .iterate = i2c_read_reg_multiple_worker_thread_iterate,
-        .finished = i2c_worker_thread_finished,
-        .feedback = NULL,
-        .data = i2c
-    };
-#endif
-
-    SOL_NULL_CHECK(i2c, NULL);
-    SOL_NULL_CHECK(values, NULL);
-    SOL_INT_CHECK(count, == 0, NULL);
-    SOL_INT_CHECK(times, == 0, NULL);
-    SOL_INT_CHECK(i2c->dev, == 0, NULL);
-    BUSY_CHECK(i2c, NULL);
-
-    i2c->async.data = values;
-    i2c->async.count = count;
-    i2c->async.status = -1;
-    i2c->async.read_write_reg_cb.cb = read_reg_multiple_cb;
-    i2c->async.dispatch = _i2c_read_write_reg_dispatch;
-    i2c->async.reg = reg;
-    i2c->async.cb_data = cb_data;
-    i2c->async.times = times;
-
-#ifdef WORKER_THREAD
-    i2c->async.worker = sol_worker_thread_new(&config);
-    SOL_NULL_CHECK(i2c->async.worker, NULL);
-    return (struct sol_i2c_pending *)i2c->async.worker;
-#else
-    i2c->async.timeout = sol_timeout_add(0, i2c_read_reg_multiple_timeout_cb, i2c);
-    SOL_NULL_CHECK(i2c->async.timeout, NULL);
-    return (struct sol_i2c_pending *)i2c->async.timeout;
-#endif
-}
-
-static bool
-sol_i2c_plain_write_register(const struct sol_i2c *i2c, uint8_t command, const uint8_t *values, size_t count)
-{
-    uint8_t buf[count + 1];
     struct i2c_msg msgs[] = {
         {
-            .addr = i2c->addr,
+            .addr = i2c->dev_addr,
             .flags = 0,
-            .len = count + 1,
-            .buf = buf
+            .len = op->count + 1,
+            .buf = op->buf
         }
     };
     struct i2c_rdwr_ioctl_data i2c_data = {
@@ -781,37 +586,32 @@ sol_i2c_plain_write_register(const struct sol_i2c *i2c, uint8_t command, const u
         SOL_WRN("Unable to write I2C data (bus = %u, device address = 0x%x, "
             "register = 0x%x): the bus/adapter does not support"
             " plain-I2C commands (only SMBus ones)",
-            i2c->bus, i2c->addr, command);
-        return false;
+            i2c->bus, i2c->dev_addr, op->reg);
+        return -ENOTSUP;
     }
 
-    buf[0] = command;
-    memcpy(buf + 1, values, count);
-
     if (ioctl(i2c->dev, I2C_RDWR, &i2c_data) == -1) {
+        ssize_t r = -errno;
+
         SOL_WRN("Unable to perform I2C write (bus = %u,"
             " device address = 0x%x, register = 0x%x): %s",
-            i2c->bus, i2c->addr, command, sol_util_strerrora(errno));
-        return false;
+            i2c->bus, i2c->dev_addr, op->reg, sol_util_strerrora(-r));
+        return r;
     }
 
-    return true;
+    return op->count;
 }
 
-static void
-_i2c_write_register(struct sol_i2c *i2c)
+static ssize_t
+_i2c_write_register(struct sol_i2c *i2c, struct i2c_op *op)
 {
     int32_t error;
     union i2c_smbus_data data = { 0 };
-    size_t count = i2c->async.count;
-    uint8_t command = i2c->async.reg;
-    uint8_t *values = i2c->async.data;
+    size_t count = op->count;
+    uint8_t *values = op->data;
 
-    if (count > 32) {
-        if (sol_i2c_plain_write_register(i2c, command, values, count) == count)
-            i2c->async.status = count;
-        return;
-    }
+    if (count > 32)
+        return sol_i2c_plain_write_register(i2c, op);
 
     switch (count) {
     case 1:
@@ -825,91 +625,511 @@ _i2c_write_register(struct sol_i2c *i2c)
         memcpy(data.block + 1, values, count);
     }
 
-    if ((error = _i2c_smbus_ioctl(i2c->dev, I2C_SMBUS_WRITE, command, count,
+    if ((error = _i2c_smbus_ioctl(i2c->dev, I2C_SMBUS_WRITE, op->reg, count,
             &data)) < 0) {
         SOL_WRN("Unable to perform I2C-SMBus write (byte/word/block) data "
             " (bus = %u, device address = 0x%x, register = 0x%x:): %s",
-            i2c->bus, i2c->addr, command, sol_util_strerrora(-error));
+            i2c->bus, i2c->dev_addr, op->reg, sol_util_strerrora(-error));
+        return error;
+    }
+
+    return count;
+}
+
+static ssize_t
+i2c_op_run(struct sol_i2c *i2c, struct i2c_op *op)
+{
+    int r;
+
+    r = _i2c_select_address(i2c, op->addr);
+    if (r < 0)
+        return r;
+
+    switch (op->type) {
+    case I2C_OP_WRITE_QUICK:
+        return _i2c_write_quick(i2c, op->rw);
+    case I2C_OP_READ:
+        return _i2c_read(i2c, op->data, op->count);
+    case I2C_OP_WRITE:
+        return _i2c_write(i2c, op->data, op->count);
+    case I2C_OP_READ_REGISTER:
+        return _i2c_read_register(i2c, op->reg, op->data, op->count);
+    case I2C_OP_WRITE_REGISTER:
+        return _i2c_write_register(i2c, op);
+    case I2C_OP_READ_REGISTER_MULTIPLE:
+        return _i2c_read_register_multiple(i2c, op->reg, op->data, op->count,
+            op->times);
+    }
+
+    return -EINVAL;
+}
+
+/* Number of messages @a op takes in a combined I2C_RDWR transfer, 0 if
+ * it can't be part of one. Only the operations that are done with
+ * plain-I2C messages anyway are combined, the SMBus ones keep their
+ * own framing. */
+static unsigned int
+i2c_op_msgs_count(const struct sol_i2c *i2c, const struct i2c_op *op)
+{
+    if (!i2c->plain_i2c)
+        return 0;
+
+    switch (op->type) {
+    case I2C_OP_READ_REGISTER_MULTIPLE:
+        return 2 * op->times;
+    case I2C_OP_READ_REGISTER:
+        return op->count > I2C_SMBUS_BLOCK_MAX ? 2 : 0;
+    case I2C_OP_WRITE_REGISTER:
+        return op->count > I2C_SMBUS_BLOCK_MAX ? 1 : 0;
+    default:
+        return 0;
+    }
+}
+
+static unsigned int
+i2c_op_fill_msgs(struct i2c_op *op, struct i2c_msg *msgs)
+{
+    unsigned int i, times;
+    uint8_t *p = op->data;
+
+    if (op->type == I2C_OP_WRITE_REGISTER) {
+        msgs[0].addr = op->addr;
+        msgs[0].flags = 0;
+        msgs[0].len = op->count + 1;
+        msgs[0].buf = op->buf;
+        return 1;
+    }
+
+    times = op->type == I2C_OP_READ_REGISTER_MULTIPLE ? op->times : 1;
+    for (i = 0; i < times * 2; i += 2) {
+        msgs[i].addr = op->addr;
+        msgs[i].flags = 0;
+        msgs[i].len = 1;
+        msgs[i].buf = &op->reg;
+        msgs[i + 1].addr = op->addr;
+        msgs[i + 1].flags = I2C_M_RD;
+        msgs[i + 1].len = op->count;
+        msgs[i + 1].buf = p;
+        p += op->count;
+    }
+
+    return times * 2;
+}
+
+/* Must be called with the lock held. Moves the next operations to be
+ * done to the running list: either a single one or a run of adjacent
+ * ones to the same device that fit together in a single I2C_RDWR
+ * transfer. Returns how many were moved. */
+static unsigned int
+i2c_take_batch(struct sol_i2c *i2c)
+{
+    struct sol_list *itr, *itr_next;
+    struct i2c_op *op;
+    unsigned int n, nmsgs = 0, taken = 0;
+    uint8_t addr = 0;
+
+    SOL_LIST_FOREACH_SAFE(&i2c->queued, itr, itr_next) {
+        op = SOL_LIST_GET_CONTAINER(itr, struct i2c_op, list);
+        n = i2c_op_msgs_count(i2c, op);
+        if (taken && (!n || op->addr != addr ||
+            nmsgs + n > I2C_RDRW_IOCTL_MAX_MSGS))
+            break;
+
+        sol_list_remove(itr);
+        sol_list_append(&i2c->running, itr);
+        addr = op->addr;
+        nmsgs += n;
+        taken++;
+
+        if (!n || nmsgs > I2C_RDRW_IOCTL_MAX_MSGS)
+            break;
+    }
+
+    return taken;
+}
+
+/* Does the transfers of the running list. Called without the lock
+ * held: nothing but the executor touches dev or that list's nodes. */
+static void
+i2c_run_batch(struct sol_i2c *i2c, unsigned int count)
+{
+    struct i2c_msg msgs[I2C_RDRW_IOCTL_MAX_MSGS];
+    struct i2c_rdwr_ioctl_data data = {
+        .msgs = msgs,
+        .nmsgs = 0
+    };
+    struct sol_list *itr;
+    struct i2c_op *op;
+    ssize_t r = 0;
+
+    if (count == 1) {
+        op = SOL_LIST_GET_CONTAINER(i2c->running.next, struct i2c_op, list);
+        op->status = i2c_op_run(i2c, op);
         return;
     }
 
-    i2c->async.status = i2c->async.count;
+    SOL_LIST_FOREACH(&i2c->running, itr) {
+        op = SOL_LIST_GET_CONTAINER(itr, struct i2c_op, list);
+        data.nmsgs += i2c_op_fill_msgs(op, msgs + data.nmsgs);
+    }
+
+    /* The kernel stops at the first failing message and doesn't tell
+     * which one it was, so the whole batch fails together */
+    if (ioctl(i2c->dev, I2C_RDWR, &data) == -1) {
+        r = -errno;
+        SOL_WRN("Unable to perform combined I2C transfer of %u messages"
+            " (bus = %u, device address = 0x%x): %s", data.nmsgs,
+            i2c->bus, msgs[0].addr, sol_util_strerrora(-r));
+    }
+
+    SOL_LIST_FOREACH(&i2c->running, itr) {
+        op = SOL_LIST_GET_CONTAINER(itr, struct i2c_op, list);
+        if (r < 0)
+            op->status = r;
+        else if (op->type == I2C_OP_READ_REGISTER_MULTIPLE)
+            op->status = op->count * op->times;
+        else
+            op->status = op->count;
+    }
+}
+
+/* Must be called with the lock held */
+static void
+i2c_complete_batch(struct sol_i2c *i2c)
+{
+    struct sol_list *itr, *itr_next;
+
+    SOL_LIST_FOREACH_SAFE(&i2c->running, itr, itr_next) {
+        sol_list_remove(itr);
+        sol_list_append(&i2c->completed, itr);
+    }
+}
+
+static bool
+i2c_op_find(struct sol_list *list, const struct i2c_op *op)
+{
+    struct sol_list *itr;
+
+    SOL_LIST_FOREACH(list, itr) {
+        if (itr == &op->list)
+            return true;
+    }
+
+    return false;
 }
 
+static int i2c_schedule(struct sol_i2c *i2c);
+
 #ifdef WORKER_THREAD
 static bool
-i2c_write_reg_worker_thread_iterate(void *data)
+i2c_dispatcher_cb(void *data)
 {
     struct sol_i2c *i2c = data;
 
-    _i2c_write_register(i2c);
+    i2c_lock(i2c);
+    i2c->dispatcher = NULL;
+    i2c_unlock(i2c);
+
+    i2c_dispatch_completed(i2c);
     return false;
 }
+
+static bool
+i2c_worker_thread_iterate(void *data)
+{
+    struct sol_i2c *i2c = data;
+    unsigned int count;
+
+    i2c_lock(i2c);
+    count = i2c_take_batch(i2c);
+    i2c_unlock(i2c);
+    if (!count)
+        return false;
+
+    i2c_run_batch(i2c, count);
+
+    i2c_lock(i2c);
+    i2c_complete_batch(i2c);
+    if (!i2c->dispatcher) {
+        i2c->dispatcher = sol_idle_add(i2c_dispatcher_cb, i2c);
+        if (!i2c->dispatcher)
+            SOL_WRN("Could not schedule I2C operations completion");
+    }
+    i2c_unlock(i2c);
+
+    return true;
+}
+
+static void
+i2c_worker_thread_finished(void *data)
+{
+    struct sol_i2c *i2c = data;
+    struct sol_list *itr, *itr_next;
+    struct i2c_op *op;
+    int r;
+
+    i2c->worker = NULL;
+    if (i2c->closing)
+        return;
+
+    /* Operations queued while the thread was leaving are left for us */
+    if (!sol_list_is_empty(&i2c->queued)) {
+        r = i2c_schedule(i2c);
+        if (r < 0) {
+            SOL_LIST_FOREACH_SAFE(&i2c->queued, itr, itr_next) {
+                op = SOL_LIST_GET_CONTAINER(itr, struct i2c_op, list);
+                op->status = r;
+                sol_list_remove(itr);
+                sol_list_append(&i2c->completed, itr);
+            }
+        }
+    }
+
+    if (i2c->dispatcher) {
+        sol_idle_del(i2c->dispatcher);
+        i2c->dispatcher = NULL;
+    }
+    i2c_dispatch_completed(i2c);
+}
 #else
 static bool
-i2c_write_reg_timeout_cb(void *data)
+i2c_timeout_cb(void *data)
 {
     struct sol_i2c *i2c = data;
+    unsigned int count;
 
-    _i2c_write_register(i2c);
-    i2c->async.timeout = NULL;
-    i2c->async.dispatch(i2c);
+    while ((count = i2c_take_batch(i2c))) {
+        i2c_run_batch(i2c, count);
+        i2c_complete_batch(i2c);
+    }
+
+    i2c->timeout = NULL;
+    i2c_dispatch_completed(i2c);
     return false;
 }
 #endif
 
-SOL_API struct sol_i2c_pending *
-sol_i2c_write_register(struct sol_i2c *i2c, uint8_t reg, const uint8_t *values, size_t count, void (*write_reg_cb)(void *cb_data, struct sol_i2c *i2c, uint8_t reg, uint8_t *data, ssize_t status), const void *cb_data)
+static int
+i2c_schedule(struct sol_i2c *i2c)
 {
 #ifdef WORKER_THREAD
     struct sol_worker_thread_config config = {
         SOL_SET_API_VERSION(.api_version = SOL_WORKER_THREAD_CONFIG_API_VERSION, )
         .setup = NULL,
         .cleanup = NULL,
-        .iterate = i2c_write_reg_worker_thread_iterate,
+        .iterate = i2c_worker_thread_iterate,
         .finished = i2c_worker_thread_finished,
         .feedback = NULL,
         .data = i2c
     };
+
+    if (i2c->worker)
+        return 0;
+
+    i2c->worker = sol_worker_thread_new(&config);
+    SOL_NULL_CHECK(i2c->worker, -ENOMEM);
+#else
+    if (i2c->timeout)
+        return 0;
+
+    i2c->timeout = sol_timeout_add(0, i2c_timeout_cb, i2c);
+    SOL_NULL_CHECK(i2c->timeout, -ENOMEM);
 #endif
 
+    return 0;
+}
+
+static struct i2c_op *
+i2c_op_new(struct sol_i2c *i2c, enum i2c_op_type type, size_t buf_size, const void *cb_data)
+{
+    struct i2c_op *op;
+
+    op = calloc(1, sizeof(*op) + buf_size);
+    SOL_NULL_CHECK(op, NULL);
+
+    op->type = type;
+    op->addr = i2c->addr;
+    op->status = -ECANCELED;
+    op->cb_data = cb_data;
+
+    return op;
+}
+
+static struct sol_i2c_pending *
+i2c_queue_op(struct sol_i2c *i2c, struct i2c_op *op)
+{
+    i2c_lock(i2c);
+    sol_list_append(&i2c->queued, &op->list);
+    i2c_unlock(i2c);
+
+    if (i2c_schedule(i2c) < 0) {
+        i2c_lock(i2c);
+        sol_list_remove(&op->list);
+        i2c_unlock(i2c);
+        free(op);
+        return NULL;
+    }
+
+    return (struct sol_i2c_pending *)op;
+}
+
+SOL_API struct sol_i2c_pending *
+sol_i2c_write_quick(struct sol_i2c *i2c, bool rw, void (*write_quick_cb)(void *cb_data, struct sol_i2c *i2c, ssize_t status), const void *cb_data)
+{
+    struct i2c_op *op;
+
+    SOL_NULL_CHECK(i2c, NULL);
+    SOL_INT_CHECK(i2c->dev, == 0, NULL);
+    SOL_EXP_CHECK(i2c->closing, NULL);
+
+    op = i2c_op_new(i2c, I2C_OP_WRITE_QUICK, 0, cb_data);
+    SOL_NULL_CHECK(op, NULL);
+
+    op->rw = rw;
+    op->write_quick_cb = write_quick_cb;
+
+    return i2c_queue_op(i2c, op);
+}
+
+SOL_API struct sol_i2c_pending *
+sol_i2c_read(struct sol_i2c *i2c, uint8_t *values, size_t count, void (*read_cb)(void *cb_data, struct sol_i2c *i2c, uint8_t *data, ssize_t status), const void *cb_data)
+{
+    struct i2c_op *op;
+
     SOL_NULL_CHECK(i2c, NULL);
     SOL_NULL_CHECK(values, NULL);
     SOL_INT_CHECK(count, == 0, NULL);
     SOL_INT_CHECK(i2c->dev, == 0, NULL);
-    BUSY_CHECK(i2c, NULL);
+    SOL_EXP_CHECK(i2c->closing, NULL);
 
-    i2c->async.data = (uint8_t *)values;
-    i2c->async.count = count;
-    i2c->async.status = -1;
-    i2c->async.read_write_reg_cb.cb = write_reg_cb;
-    i2c->async.dispatch = _i2c_read_write_reg_dispatch;
-    i2c->async.reg = reg;
-    i2c->async.cb_data = cb_data;
+    op = i2c_op_new(i2c, I2C_OP_READ, 0, cb_data);
+    SOL_NULL_CHECK(op, NULL);
 
-#ifdef WORKER_THREAD
-    i2c->async.worker = sol_worker_thread_new(&config);
-    SOL_NULL_CHECK(i2c->async.worker, NULL);
-    return (struct sol_i2c_pending *)i2c->async.worker;
-#else
-    i2c->async.timeout = sol_timeout_add(0, i2c_write_reg_timeout_cb, i2c);
-    SOL_NULL_CHECK(i2c->async.timeout, NULL);
-    return (struct sol_i2c_pending *)i2c->async.timeout;
-#endif
+    op->data = values;
+    op->count = count;
+    op->read_write_cb = read_cb;
+
+    return i2c_queue_op(i2c, op);
+}
+
+SOL_API struct sol_i2c_pending *
+sol_i2c_write(struct sol_i2c *i2c, uint8_t *values, size_t count, void (*write_cb)(void *cb_data, struct sol_i2c *i2c, uint8_t *data, ssize_t status), const void *cb_data)
+{
+    struct i2c_op *op;
+
+    SOL_NULL_CHECK(i2c, NULL);
+    SOL_NULL_CHECK(values, NULL);
+    SOL_INT_CHECK(count, == 0, NULL);
+    SOL_INT_CHECK(i2c->dev, == 0, NULL);
+    SOL_EXP_CHECK(i2c->closing, NULL);
+
+    op = i2c_op_new(i2c, I2C_OP_WRITE, 0, cb_data);
+    SOL_NULL_CHECK(op, NULL);
+
+    op->data = values;
+    op->count = count;
+    op->read_write_cb = write_cb;
+
+    return i2c_queue_op(i2c, op);
+}
+
+SOL_API struct sol_i2c_pending *
+sol_i2c_read_register(struct sol_i2c *i2c, uint8_t reg, uint8_t *values, size_t count, void (*read_reg_cb)(void *cb_data, struct sol_i2c *i2c, uint8_t reg, uint8_t *data, ssize_t status), const void *cb_data)
+{
+    struct i2c_op *op;
+
+    SOL_NULL_CHECK(i2c, NULL);
+    SOL_NULL_CHECK(values, NULL);
+    SOL_INT_CHECK(count, == 0, NULL);
+    SOL_INT_CHECK(i2c->dev, == 0, NULL);
+    SOL_EXP_CHECK(i2c->closing, NULL);
+
+    op = i2c_op_new(i2c, I2C_OP_READ_REGISTER, 0, cb_data);
+    SOL_NULL_CHECK(op, NULL);
+
+    op->data = values;
+    op->count = count;
+    op->reg = reg;
+    op->read_write_reg_cb = read_reg_cb;
+
+    return i2c_queue_op(i2c, op);
+}
+
+SOL_API struct sol_i2c_pending *
+sol_i2c_read_register_multiple(struct sol_i2c *i2c, uint8_t reg, uint8_t *values, size_t count, uint8_t times, void (*read_reg_multiple_cb)(void *cb_data, struct sol_i2c *i2c, uint8_t reg, uint8_t *data, ssize_t status), const void *cb_data)
+{
+    struct i2c_op *op;
+
+    SOL_NULL_CHECK(i2c, NULL);
+    SOL_NULL_CHECK(values, NULL);
+    SOL_INT_CHECK(count, == 0, NULL);
+    SOL_INT_CHECK(times, == 0, NULL);
+    SOL_INT_CHECK(i2c->dev, == 0, NULL);
+    SOL_EXP_CHECK(i2c->closing, NULL);
+
+    op = i2c_op_new(i2c, I2C_OP_READ_REGISTER_MULTIPLE, 0, cb_data);
+    SOL_NULL_CHECK(op, NULL);
+
+    op->data = values;
+    op->count = count;
+    op->reg = reg;
+    op->times = times;
+    op->read_write_reg_cb = read_reg_multiple_cb;
+
+    return i2c_queue_op(i2c, op);
+}
+
+SOL_API struct sol_i2c_pending *
+sol_i2c_write_register(struct sol_i2c *i2c, uint8_t reg, const uint8_t *values, size_t count, void (*write_reg_cb)(void *cb_data, struct sol_i2c *i2c, uint8_t reg, uint8_t *data, ssize_t status), const void *cb_data)
+{
+    struct i2c_op *op;
+    bool plain;
+
+    SOL_NULL_CHECK(i2c, NULL);
+    SOL_NULL_CHECK(values, NULL);
+    SOL_INT_CHECK(count, == 0, NULL);
+    SOL_INT_CHECK(i2c->dev, == 0, NULL);
+    SOL_EXP_CHECK(i2c->closing, NULL);
+
+    /* Writes too big for SMBus go as a single plain-I2C message,
+     * register first */
+    plain = count > 32;
+    op = i2c_op_new(i2c, I2C_OP_WRITE_REGISTER, plain ? count + 1 : 0,
+        cb_data);
+    SOL_NULL_CHECK(op, NULL);
+
+    op->data = (uint8_t *)values;
+    op->count = count;
+    op->reg = reg;
+    op->read_write_reg_cb = write_reg_cb;
+    if (plain) {
+        op->buf[0] = reg;
+        memcpy(op->buf + 1, values, count);
+    }
+
+    return i2c_queue_op(i2c, op);
 }
 
 SOL_API bool
 sol_i2c_set_slave_address(struct sol_i2c *i2c, uint8_t slave_address)
 {
     SOL_NULL_CHECK(i2c, false);
-    BUSY_CHECK(i2c, false);
+
+#ifdef WORKER_THREAD
+    /* The worker thread owns dev while alive: it switches to this
+     * address once it gets to the operations queued from now on */
+    if (i2c->worker) {
+        i2c->addr = slave_address;
+        return true;
+    }
+#endif
 
     if (ioctl(i2c->dev, I2C_SLAVE, slave_address) == -1) {
         SOL_WRN("I2C (bus = %u): could not specify device address 0x%x",
             i2c->bus, slave_address);
         return false;
     }
-    i2c->addr = slave_address;
+    i2c->addr = i2c->dev_addr = slave_address;
 
     return true;
 }
@@ -931,34 +1151,52 @@ sol_i2c_bus_get(const struct sol_i2c *i2c)
 SOL_API bool
 sol_i2c_busy(struct sol_i2c *i2c)
 {
+    bool busy;
+
     SOL_NULL_CHECK(i2c, true);
-#ifdef WORKER_THREAD
-    return i2c->async.worker;
-#else
-    return i2c->async.timeout;
-#endif
+
+    i2c_lock(i2c);
+    busy = !sol_list_is_empty(&i2c->queued) ||
+        !sol_list_is_empty(&i2c->running) ||
+        !sol_list_is_empty(&i2c->completed);
+    i2c_unlock(i2c);
+
+    return busy;
 }
 
 SOL_API void
 sol_i2c_pending_cancel(struct sol_i2c *i2c, struct sol_i2c_pending *pending)
 {
+    struct i2c_op *op = (struct i2c_op *)pending;
+    bool found, running;
+
     SOL_NULL_CHECK(i2c);
     SOL_NULL_CHECK(pending);
 
+    i2c_lock(i2c);
+    found = i2c_op_find(&i2c->queued, op) || i2c_op_find(&i2c->completed, op);
+    if (found)
+        sol_list_remove(&op->list);
+    running = !found && i2c_op_find(&i2c->running, op);
+    i2c_unlock(i2c);
+
+    if (found) {
+        i2c_dispatch_op(i2c, op);
+        return;
+    }
+
 #ifdef WORKER_THREAD
-    if (i2c->async.worker == (struct sol_worker_thread *)pending) {
-        sol_worker_thread_cancel(i2c->async.worker);
-        i2c->async.worker = NULL;
-    } else {
+    /* Cancelling waits for the transfer being done, then its callback
+     * is dispatched with the other completed operations */
+    if (running) {
+        sol_worker_thread_cancel(i2c->worker);
+        return;
+    }
 #else
-    if (i2c->async.timeout == (struct sol_timeout *)pending) {
-        sol_timeout_del(i2c->async.timeout);
-        i2c->async.dispatch(i2c);
-        i2c->async.timeout = NULL;
-    } else {
+    (void)running;
 #endif
-        SOL_WRN("Invalid I2C pending handle.");
-    }
+
+    SOL_WRN("Invalid I2C pending handle.");
 }
 
 static bool
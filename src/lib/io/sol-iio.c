@@ -48,8 +48,12 @@ struct sol_iio_device {
     const void *reader_cb_data;
     struct sol_fd *fd_handler;
     struct sol_buffer buffer;
-    size_t buffer_size;
+    size_t buffer_size; /* size of a single scan */
+    size_t consumed; /* bytes of buffer already delivered */
+    double *samples; /* batch_size decoded values per channel */
     struct sol_ptr_vector channels;
+    unsigned int batch_size;
+    unsigned int scan_count; /* scans delivered on last reading */
     int device_id;
     int trigger_id;
     int fd;
@@ -60,9 +64,11 @@ struct sol_iio_device {
 
 struct sol_iio_channel {
     struct sol_iio_device *device;
+    double *samples;
     double scale;
     int index;
     int offset;
+    int fd; /* '_raw' or '_input' attribute, kept open if not buffered */
 
     unsigned int storagebits;
     unsigned int bits;
@@ -97,8 +103,11 @@ struct resolve_absolute_path_data {
     int id;
 };
 
-#define DEVICE_PATH "/dev/iio:device%d"
+#define DEV_PATH "/dev"
+#define DEV_PATH_ENVVAR "SOL_IIO_DEV_PATH"
+#define DEVICE_PATH DEV_PATH "/iio:device%d"
 #define SYSFS_DEVICES_PATH "/sys/bus/iio/devices"
+#define SYSFS_DEVICES_PATH_ENVVAR "SOL_IIO_SYSFS_DEVICES_PATH"
 #define SYSFS_DEVICE_PATH "/sys/bus/iio/devices/%s"
 
 #define DEVICE_NAME_PATH SYSFS_DEVICES_PATH "/iio:device%d/name"
@@ -106,6 +115,7 @@ struct resolve_absolute_path_data {
 
 #define BUFFER_ENABLE_DEVICE_PATH SYSFS_DEVICES_PATH "/iio:device%d/buffer/enable"
 #define BUFFER_LENGHT_DEVICE_PATH SYSFS_DEVICES_PATH "/iio:device%d/buffer/length"
+#define BUFFER_WATERMARK_DEVICE_PATH SYSFS_DEVICES_PATH "/iio:device%d/buffer/watermark"
 #define CURRENT_TRIGGER_DEVICE_PATH SYSFS_DEVICES_PATH "/iio:device%d/trigger/current_trigger"
 
 #define SYSFS_TRIGGER_NOW_PATH SYSFS_DEVICES_PATH "/%s/trigger_now"
@@ -135,16 +145,66 @@ struct resolve_absolute_path_data {
 
 static bool create_or_resolve_device_address_dispatch(void *data);
 
-SOL_ATTR_PRINTF(3, 4)
+/* Lets sysfs tree and device nodes be replaced by fake ones, as done by
+ * benchmarks and tests */
+static const char *
+get_path_from_env(const char **cached, const char *envvar, const char *path)
+{
+    if (!*cached) {
+        *cached = getenv(envvar);
+        if (!*cached || !(*cached)[0])
+            *cached = path;
+    }
+
+    return *cached;
+}
+
+static const char *
+get_sysfs_devices_path(void)
+{
+    static const char *sysfs_devices_path;
+
+    return get_path_from_env(&sysfs_devices_path, SYSFS_DEVICES_PATH_ENVVAR,
+        SYSFS_DEVICES_PATH);
+}
+
+static const char *
+get_dev_path(void)
+{
+    static const char *dev_path;
+
+    return get_path_from_env(&dev_path, DEV_PATH_ENVVAR, DEV_PATH);
+}
+
+static int
+replace_path_prefix(char *path, size_t size, int len, const char *prefix, const char *replacement)
+{
+    const size_t prefix_len = strlen(prefix);
+    char tmp[PATH_MAX];
+
+    if (len < 0 || (size_t)len >= size || !strcmp(prefix, replacement) ||
+        strncmp(path, prefix, prefix_len))
+        return len;
+
+    len = snprintf(tmp, sizeof(tmp), "%s%s", replacement, path + prefix_len);
+    if (len >= 0 && (size_t)len < size)
+        memcpy(path, tmp, len + 1);
+
+    return len;
+}
+
+SOL_ATTR_PRINTF(3, 0)
 static bool
-craft_filename_path(char *path, size_t size, const char *base, ...)
+craft_filename_path_va(char *path, size_t size, const char *base, va_list args)
 {
-    va_list args;
     int len;
 
-    va_start(args, base);
     len = vsnprintf(path, size, base, args);
-    va_end(args);
+    if (strstartswith(path, SYSFS_DEVICES_PATH))
+        len = replace_path_prefix(path, size, len, SYSFS_DEVICES_PATH,
+            get_sysfs_devices_path());
+    else
+        len = replace_path_prefix(path, size, len, DEV_PATH, get_dev_path());
 
     if (len < 0)
         path[0] = '\0';
@@ -154,20 +214,34 @@ craft_filename_path(char *path, size_t size, const char *base, ...)
     return len >= 0 && (size_t)len < size;
 }
 
+SOL_ATTR_PRINTF(3, 4)
+static bool
+craft_filename_path(char *path, size_t size, const char *base, ...)
+{
+    va_list args;
+    bool r;
+
+    va_start(args, base);
+    r = craft_filename_path_va(path, size, base, args);
+    va_end(args);
+
+    return r;
+}
+
 SOL_ATTR_PRINTF(1, 2)
 static bool
 check_file_existence(const char *base, ...)
 {
     char path[PATH_MAX];
     va_list args;
-    int len;
     struct stat st;
+    bool r;
 
     va_start(args, base);
-    len = vsnprintf(path, sizeof(path), base, args);
+    r = craft_filename_path_va(path, sizeof(path), base, args);
     va_end(args);
 
-    return len >= 0 && (size_t)len < PATH_MAX && !stat(path, &st);
+    return r && !stat(path, &st);
 }
 
 static bool
@@ -210,14 +284,14 @@ check_manual_triggering(struct sol_iio_device *device)
      * by opening all triggers on /sys/bus/iio/devices
      * and checking name by name =/ */
 
-    dir = opendir(SYSFS_DEVICES_PATH);
+    dir = opendir(get_sysfs_devices_path());
     if (!dir) {
         SOL_WRN("No IIO devices available");
         return false;
     }
 
     /* See readdir_r(3) */
-    name_max = pathconf(SYSFS_DEVICES_PATH, _PC_NAME_MAX);
+    name_max = pathconf(get_sysfs_devices_path(), _PC_NAME_MAX);
     if (name_max == -1)
         name_max = 255;
     len = offsetof(struct dirent, d_name) + name_max + 1;
@@ -349,7 +423,7 @@ set_buffer_size(struct sol_iio_device *device, int buffer_size)
     char path[PATH_MAX];
     int r;
 
-    if (craft_filename_path(path, sizeof(path), BUFFER_LENGHT_DEVICE_PATH, device->device_id)) {
+    if (!craft_filename_path(path, sizeof(path), BUFFER_LENGHT_DEVICE_PATH, device->device_id)) {
         SOL_WRN("Could not set IIO device buffer size");
         return;
     }
@@ -378,49 +452,158 @@ set_buffer_enabled(struct sol_iio_device *device, bool enabled)
     return true;
 }
 
+static void
+set_buffer_watermark(struct sol_iio_device *device, unsigned int watermark)
+{
+    char path[PATH_MAX];
+    int r;
+
+    if (!craft_filename_path(path, sizeof(path), BUFFER_WATERMARK_DEVICE_PATH,
+        device->device_id)) {
+        SOL_WRN("Could not set IIO device buffer watermark");
+        return;
+    }
+
+    /* Older kernels have no watermark, device is then polled for every
+     * scan and batches are only as big as what piled up meanwhile */
+    if ((r = sol_util_write_file(path, "%u", watermark)) < 0) {
+        SOL_INF("Could not set IIO device buffer watermark to %u at '%s': %s",
+            watermark, path, sol_util_strerrora(-r));
+    }
+}
+
+static int
+compare_channel_index(const void *data1, const void *data2)
+{
+    const struct sol_iio_channel *c1 = data1, *c2 = data2;
+
+    return sol_util_int_compare(c1->index, c2->index);
+}
+
+/* Channels are laid out on the scan by their index, each one aligned to
+ * its storage size, and the scan is padded to the biggest storage. */
 static size_t
-calc_buffer_size(const struct sol_iio_device *device)
+calc_scan_layout(struct sol_iio_device *device)
 {
+    struct sol_ptr_vector sorted = SOL_PTR_VECTOR_INIT;
     struct sol_iio_channel *channel;
-    int i;
-    size_t size = 0;
+    size_t size = 0, bytes, biggest = 1;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_IDX (&device->channels, channel, i) {
-        size += channel->storagebits;
+        if (sol_ptr_vector_insert_sorted(&sorted, channel, compare_channel_index) < 0) {
+            sol_ptr_vector_clear(&sorted);
+            return 0;
+        }
     }
 
-    return size / 8 + (size % 8 != 0);
+    SOL_PTR_VECTOR_FOREACH_IDX (&sorted, channel, i) {
+        bytes = channel->storagebits / 8 + (channel->storagebits % 8 != 0);
+        if (bytes)
+            size = (size + bytes - 1) / bytes * bytes;
+        channel->offset_in_buffer = size * 8;
+        size += bytes;
+        biggest = sol_max(biggest, bytes);
+    }
+    sol_ptr_vector_clear(&sorted);
+
+    return (size + biggest - 1) / biggest * biggest;
+}
+
+/* Decodes a channel on @a count consecutive scans in a single pass. Sign
+ * extension, offset and scale are branch free, so per sample work is
+ * just loading the storage bytes. */
+static void
+decode_channel_samples(const struct sol_iio_channel *channel,
+    const uint8_t *scans, size_t scan_size, unsigned int count, double *out)
+{
+    const uint8_t *p = scans + channel->offset_in_buffer / 8;
+    unsigned int n, storage_bytes = channel->storagebits / 8;
+    unsigned int sign_shift = 64 - channel->bits;
+    double offset = channel->processed ? 0 : channel->offset;
+    double scale = channel->processed ? 1 : channel->scale;
+    uint64_t data;
+    int i, j;
+
+    for (n = 0; n < count; n++, p += scan_size) {
+        data = 0;
+        if (channel->little_endian) {
+            for (i = 0, j = 0; i < (int)storage_bytes; i++, j += 8)
+                data |= (uint64_t)p[i] << j;
+        } else {
+            for (i = storage_bytes - 1, j = 0; i >= 0; i--, j += 8)
+                data |= (uint64_t)p[i] << j;
+        }
+
+        data = (data >> channel->shift) & channel->mask;
+        if (channel->is_signed)
+            out[n] = ((int64_t)(data << sign_shift) >> sign_shift) + offset;
+        else
+            out[n] = data + offset;
+        out[n] *= scale;
+    }
 }
 
 static bool
 device_reader_cb(void *data, int fd, uint32_t active_flags)
 {
     struct sol_iio_device *device = data;
-    bool result = true;
+    struct sol_iio_channel *channel;
+    uint8_t *buffer = device->buffer.data;
+    unsigned int scans;
     ssize_t ret;
+    uint32_t i;
 
     if (active_flags & (SOL_FD_FLAGS_ERR | SOL_FD_FLAGS_HUP | SOL_FD_FLAGS_NVAL)) {
         SOL_WRN("Unexpected reading");
-        result = false;
+        goto error;
     }
 
-    ret = sol_util_fill_buffer(fd, &device->buffer, device->buffer_size - device->buffer.used);
-    if (ret <= 0) {
-        result = false;
-    } else if (device->buffer.used == device->buffer_size) {
-        if (device->reader_cb) {
-            device->reader_cb((void *)device->reader_cb_data, device);
-        }
-        sol_buffer_reset(&device->buffer);
+    /* Buffer not started yet */
+    if (!device->buffer_size)
+        return true;
+
+    /* Drop scans delivered on last reading, keeping any partial one */
+    if (device->consumed) {
+        memmove(buffer, buffer + device->consumed,
+            device->buffer.used - device->consumed);
+        device->buffer.used -= device->consumed;
+        device->consumed = 0;
     }
 
-    if (!result) {
-        device->fd_handler = NULL;
-        close(device->fd);
-        device->fd = -1;
+    /* Buffer capacity may be bigger than asked for, but samples arrays
+     * only hold batch_size scans */
+    ret = read(fd, buffer + device->buffer.used,
+        device->buffer_size * device->batch_size - device->buffer.used);
+    if (ret < 0 && (errno == EAGAIN || errno == EINTR))
+        return true;
+    if (ret <= 0)
+        goto error;
+
+    device->buffer.used += ret;
+    scans = device->buffer.used / device->buffer_size;
+    if (!scans)
+        return true;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&device->channels, channel, i) {
+        if (channel->storagebits <= 64)
+            decode_channel_samples(channel, buffer, device->buffer_size,
+                scans, channel->samples);
     }
+    device->scan_count = scans;
+    device->consumed = scans * device->buffer_size;
 
-    return result;
+    if (device->reader_cb)
+        device->reader_cb((void *)device->reader_cb_data, device);
+
+    return true;
+
+error:
+    device->fd_handler = NULL;
+    close(device->fd);
+    device->fd = -1;
+
+    return false;
 }
 
 static bool
@@ -615,6 +798,7 @@ SOL_API struct sol_iio_device *
 sol_iio_open(int device_id, const struct sol_iio_config *config)
 {
     bool r;
+    int buffer_size;
     char path[PATH_MAX];
     struct sol_iio_device *device = NULL;
 
@@ -673,8 +857,22 @@ sol_iio_open(int device_id, const struct sol_iio_config *config)
             goto error;
         }
 
-        if (config->buffer_size != 0)
-            set_buffer_size(device, config->buffer_size);
+        if (config->batch_size < 0) {
+            SOL_WRN("Invalid batch size %d for device%d", config->batch_size,
+                device->device_id);
+            goto error;
+        }
+        device->batch_size = sol_max(config->batch_size, 1);
+
+        buffer_size = config->buffer_size;
+        if (device->batch_size > 1) {
+            /* Kernel buffer must hold more than a batch while it's read */
+            if (buffer_size < 2 * config->batch_size)
+                buffer_size = 2 * config->batch_size;
+            set_buffer_size(device, buffer_size);
+            set_buffer_watermark(device, device->batch_size);
+        } else if (buffer_size != 0)
+            set_buffer_size(device, buffer_size);
 
         if (!device->manual_triggering) {
             SOL_WRN("No 'trigger_now' file on device%d current trigger. "
@@ -857,6 +1055,8 @@ end:
 static void
 iio_del_channel(struct sol_iio_channel *channel)
 {
+    if (channel->fd > -1)
+        close(channel->fd);
     free(channel);
 }
 
@@ -878,6 +1078,7 @@ sol_iio_close(struct sol_iio_device *device)
     if (device->name_fd > -1) close(device->name_fd);
 
     sol_buffer_fini(&device->buffer);
+    free(device->samples);
     free(device->trigger_name);
     free(device);
 }
@@ -897,6 +1098,23 @@ read_channel_index_in_buffer(struct sol_iio_channel *channel)
     return true;
 }
 
+static bool
+open_channel_value(struct sol_iio_channel *channel)
+{
+    char path[PATH_MAX];
+
+    if (!craft_filename_path(path, sizeof(path),
+        channel->processed ? CHANNEL_PROCESSED_PATH : CHANNEL_RAW_PATH,
+        channel->device->device_id, channel->name))
+        return false;
+
+    /* sysfs attributes are regenerated on every read from offset 0, so
+     * keeping them open saves an open()/close() pair per reading */
+    channel->fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    return channel->fd > -1;
+}
+
 SOL_API struct sol_iio_channel *
 sol_iio_add_channel(struct sol_iio_device *device, const char *name, const struct sol_iio_channel_config *config)
 {
@@ -933,6 +1151,7 @@ sol_iio_add_channel(struct sol_iio_device *device, const char *name, const struc
 
     channel->device = device;
     channel->processed = processed;
+    channel->fd = -1;
 
     if (config->scale > -1)
         iio_set_channel_scale(channel, config->scale);
@@ -963,7 +1182,19 @@ sol_iio_add_channel(struct sol_iio_device *device, const char *name, const struc
             goto error;
         }
 
-        channel->mask = (1 << channel->bits) - 1;
+        if (!channel->bits || channel->bits > 64) {
+            SOL_WRN("Invalid bits %u of channel [%s] in device%d",
+                channel->bits, channel->name, device->device_id);
+            goto error;
+        }
+
+        channel->mask = channel->bits == 64 ? UINT64_MAX :
+            ((uint64_t)1 << channel->bits) - 1;
+    } else if (!open_channel_value(channel)) {
+        /* As when it was opened on every reading, that is only an
+         * error once the channel is read: it's tried again then */
+        SOL_INF("Could not open channel [%s] in device%d: %s",
+            channel->name, device->device_id, sol_util_strerrora(errno));
     }
 
     r = sol_ptr_vector_append(&channel->device->channels, channel);
@@ -984,15 +1215,7 @@ error:
 static bool
 iio_read_buffer_channel_value(struct sol_iio_channel *channel, double *value)
 {
-    uint64_t data = 0;
-    int64_t s_data;
-    unsigned j, offset_bytes;
-    int i, storage_bytes;
-    bool negative = false;
     struct sol_iio_device *device = channel->device;
-    uint8_t *buffer = device->buffer.data;
-
-    SOL_NULL_CHECK(buffer, false);
 
     if (channel->storagebits > 64) {
         SOL_WRN("Could not read channel [%s] value - more than 64 bits of"
@@ -1001,41 +1224,12 @@ iio_read_buffer_channel_value(struct sol_iio_channel *channel, double *value)
         return false;
     }
 
-    if (channel->offset_in_buffer + channel->storagebits > device->buffer_size * 8) {
-        SOL_WRN("Invalid read on buffer.");
+    if (!device->scan_count) {
+        SOL_WRN("No readings on buffer of device%d yet", device->device_id);
         return false;
     }
 
-    offset_bytes = channel->offset_in_buffer / 8;
-    storage_bytes = channel->storagebits / 8;
-    if (channel->little_endian) {
-        for (i = 0, j = 0; i < storage_bytes; i++, j += 8) {
-            data |= (uint64_t)buffer[i + offset_bytes] << j;
-        }
-    } else {
-        for (i = storage_bytes - 1, j = 0; i >= 0; i--, j += 8) {
-            data |= (uint64_t)buffer[i + offset_bytes] << j;
-        }
-    }
-
-    data >>= channel->shift;
-
-    /* Remove the top useless bits */
-    data &= channel->mask;
-
-    /* If signed and msb is 1, we have a negative number */
-    if (channel->is_signed) {
-        negative = data & (1 << (channel->bits - 1));
-    }
-
-    if (negative) {
-        s_data = data | ~channel->mask;
-        *value = s_data;
-    } else
-        *value = data;
-
-    if (!channel->processed)
-        *value = (*value + channel->offset) * channel->scale;
+    *value = channel->samples[device->scan_count - 1];
 
     return true;
 }
@@ -1043,11 +1237,8 @@ iio_read_buffer_channel_value(struct sol_iio_channel *channel, double *value)
 SOL_API bool
 sol_iio_read_channel_value(struct sol_iio_channel *channel, double *value)
 {
-    int len;
     int64_t raw_value;
-    char path[PATH_MAX];
     struct sol_iio_device *device;
-    bool r;
 
     SOL_NULL_CHECK(channel, false);
     SOL_NULL_CHECK(value, false);
@@ -1058,17 +1249,13 @@ sol_iio_read_channel_value(struct sol_iio_channel *channel, double *value)
         return iio_read_buffer_channel_value(channel, value);
     }
 
-    r = craft_filename_path(path, sizeof(path),
-        channel->processed ? CHANNEL_PROCESSED_PATH : CHANNEL_RAW_PATH,
-        device->device_id, channel->name);
-    if (!r) {
-        SOL_WRN("Could not read channel [%s] in device%d", channel->name,
+    if (channel->fd < 0 && !open_channel_value(channel)) {
+        SOL_WRN("Could not open channel [%s] in device%d", channel->name,
             device->device_id);
         return false;
     }
 
-    len = sol_util_read_file(path, "%" SCNd64, &raw_value);
-    if (len < 0) {
+    if (sol_util_fd_read_int64(channel->fd, &raw_value) < 0) {
         SOL_WRN("Could not read channel [%s] in device%d", channel->name,
             device->device_id);
         return false;
@@ -1081,20 +1268,6 @@ sol_iio_read_channel_value(struct sol_iio_channel *channel, double *value)
     return true;
 }
 
-static int
-calc_channel_offset_in_buffer(const struct sol_iio_channel *channel)
-{
-    struct sol_iio_channel *channel_itr;
-    int i, offset = 0;
-
-    SOL_PTR_VECTOR_FOREACH_IDX (&channel->device->channels, channel_itr, i) {
-        if (channel_itr->index < channel->index)
-            offset += channel->storagebits;
-    }
-
-    return offset;
-}
-
 SOL_API bool
 sol_iio_device_trigger_now(struct sol_iio_device *device)
 {
@@ -1130,7 +1303,8 @@ SOL_API bool
 sol_iio_device_start_buffer(struct sol_iio_device *device)
 {
     struct sol_iio_channel *channel;
-    int i;
+    uint32_t i;
+    int r;
 
     SOL_NULL_CHECK(device, false);
 
@@ -1140,19 +1314,29 @@ sol_iio_device_start_buffer(struct sol_iio_device *device)
         return false;
     }
 
-    device->buffer_size = calc_buffer_size(device);
-    i = sol_buffer_ensure(&device->buffer, device->buffer_size);
-    if (i < 0) {
-        SOL_WRN("Could not alloc buffer for device. No readings will be performed");
-        return false;
-    }
-
     /* Now that all channels have been added, calc their offset in buffer */
-    SOL_PTR_VECTOR_FOREACH_IDX (&device->channels, channel, i) {
-        channel->offset_in_buffer = calc_channel_offset_in_buffer(channel);
-    }
+    device->buffer_size = calc_scan_layout(device);
+    if (!device->buffer_size)
+        goto error;
+
+    r = sol_buffer_ensure(&device->buffer, device->buffer_size * device->batch_size);
+    if (r < 0)
+        goto error;
+
+    free(device->samples);
+    device->samples = calloc(sol_ptr_vector_get_len(&device->channels) *
+        device->batch_size, sizeof(double));
+    SOL_NULL_CHECK_GOTO(device->samples, error);
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&device->channels, channel, i)
+        channel->samples = device->samples + i * device->batch_size;
 
     return true;
+
+error:
+    device->buffer_size = 0;
+    SOL_WRN("Could not alloc buffer for device. No readings will be performed");
+    return false;
 }
 
 static bool
@@ -1186,7 +1370,7 @@ resolve_name_path(const char *name)
 {
     struct resolve_name_path_data data = { .id = -1, .name = name };
 
-    sol_util_iterate_dir(SYSFS_DEVICES_PATH, resolve_name_path_cb, &data);
+    sol_util_iterate_dir(get_sysfs_devices_path(), resolve_name_path_cb, &data);
 
     return data.id;
 }
@@ -1219,7 +1403,7 @@ resolve_absolute_path(const char *address)
 
     if (realpath(address, real_path)) {
         result.path = real_path;
-        sol_util_iterate_dir(SYSFS_DEVICES_PATH, resolve_absolute_path_cb, &result);
+        sol_util_iterate_dir(get_sysfs_devices_path(), resolve_absolute_path_cb, &result);
     }
 
     return result.id;
@@ -1243,7 +1427,7 @@ resolve_i2c_path(const char *address)
          * destination as the i2c dir */
         if (realpath(path, real_path)) {
             result.path = real_path;
-            sol_util_iterate_dir(SYSFS_DEVICES_PATH, resolve_absolute_path_cb, &result);
+            sol_util_iterate_dir(get_sysfs_devices_path(), resolve_absolute_path_cb, &result);
         }
     }
 
@@ -1450,20 +1634,53 @@ sol_iio_read_channel_raw_buffer(struct sol_iio_channel *channel)
     struct sol_str_slice slice = SOL_STR_SLICE_EMPTY;
     unsigned int offset_bytes, storage_bytes;
 
+    struct sol_iio_device *device;
+
     SOL_NULL_CHECK(channel, slice);
-    SOL_NULL_CHECK(channel->device->buffer.data, slice);
+    device = channel->device;
+    SOL_NULL_CHECK(device->buffer.data, slice);
 
-    if (!channel->device->buffer_enabled) {
+    if (!device->buffer_enabled) {
         SOL_WRN("sol_iio_read_channel_raw_buffer() only works when buffer"
             " is enabled.");
         return slice;
     }
 
-    offset_bytes = channel->offset_in_buffer / 8;
+    if (!device->scan_count)
+        return slice;
+
+    /* Last scan of the batch */
+    offset_bytes = (device->scan_count - 1) * device->buffer_size +
+        channel->offset_in_buffer / 8;
     storage_bytes = channel->storagebits / 8;
 
     slice.len = storage_bytes;
-    slice.data = (char *)channel->device->buffer.data + offset_bytes;
+    slice.data = (char *)device->buffer.data + offset_bytes;
 
     return slice;
 }
+
+SOL_API const double *
+sol_iio_read_channel_samples(struct sol_iio_channel *channel, unsigned int *count)
+{
+    struct sol_iio_device *device;
+
+    SOL_NULL_CHECK(channel, NULL);
+    SOL_NULL_CHECK(count, NULL);
+    device = channel->device;
+
+    if (!device->buffer_enabled) {
+        SOL_WRN("sol_iio_read_channel_samples() only works when buffer"
+            " is enabled.");
+        return NULL;
+    }
+
+    if (channel->storagebits > 64) {
+        SOL_WRN("Could not read channel [%s] samples - more than 64 bits of"
+            " storage - found %d.", channel->name, channel->storagebits);
+        return NULL;
+    }
+
+    *count = device->scan_count;
+    return channel->samples;
+}
@@ -22,12 +22,14 @@
 #include <fcntl.h>
 #include <sched.h>
 #include <stdio.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include "sol-buffer.h"
 #include "sol-log.h"
 #include "sol-mainloop.h"
+#include "sol-storage-worker.h"
 #include "sol-str-slice.h"
 #include "sol-str-table.h"
 #include "sol-util-file.h"
@@ -49,6 +51,7 @@ struct pending_write_data {
     void (*cb)(void *data, const char *name, struct sol_blob *blob, int status);
     const void *data;
     uint64_t mask;
+    int status;
 };
 
 struct map_internal {
@@ -56,10 +59,31 @@ struct map_internal {
     struct sol_timeout *timeout;
     char *resolved_path;
     struct sol_vector pending_writes;
+    /* Storage is opened once. Regular files are mmap()ed, so reads and
+     * writes are plain memory accesses, flushed to the file by the
+     * storage worker; anything else (device nodes, sysfs attributes)
+     * falls back to pread()/pwrite() on the fd. */
+    uint8_t *mem;
+    size_t size;
+    size_t dirty_start;
+    size_t dirty_end;
+    int fd;
     bool checked;
+    struct memmap_batch *inflight;
+};
+
+/* Pending writes are handed to the storage worker, one batch per map
+ * at a time: it writes them to storage that couldn't be mmap()ed, or
+ * flushes the mapping they were copied to. */
+struct memmap_batch {
+    const struct sol_memmap_map *map;
+    /* Copy of the map state: the fd, or the mapping and its dirty range */
+    struct map_internal storage;
+    struct sol_vector writes;
 };
 
 static struct sol_vector memory_maps = SOL_VECTOR_INIT(struct map_internal);
+static struct sol_storage_queue memmap_queue = SOL_STORAGE_QUEUE_INIT("memmap");
 
 static bool
 get_entry_metadata_on_map(const char *name, const struct sol_memmap_map *map, const struct sol_memmap_entry **entry, uint64_t *mask)
@@ -83,7 +107,7 @@ get_entry_metadata_on_map(const char *name, const struct sol_memmap_map *map, co
 static bool
 get_entry_metadata(const char *name, struct map_internal **map_internal, const struct sol_memmap_entry **entry, uint64_t *mask)
 {
-    int i;
+    uint32_t i;
 
     SOL_VECTOR_FOREACH_IDX (&memory_maps, *map_internal, i) {
         if (get_entry_metadata_on_map(name, (*map_internal)->map, entry, mask))
@@ -96,141 +120,259 @@ get_entry_metadata(const char *name, struct map_internal **map_internal, const s
     return false;
 }
 
+static size_t
+get_map_size(const struct sol_memmap_map *map)
+{
+    const struct sol_str_table_ptr *iter;
+    const struct sol_memmap_entry *entry;
+    size_t size = 0;
+
+    for (iter = map->entries; iter->key; iter++) {
+        entry = iter->val;
+        size = sol_max(size, entry->offset + entry->size);
+    }
+
+    return size;
+}
+
 static int
-sol_memmap_read_raw_do(const char *path, const struct sol_memmap_entry *entry, uint64_t mask, struct sol_buffer *buffer)
+storage_open(struct map_internal *map_internal)
 {
-    int fd, ret = 0;
-    uint64_t value = 0;
-    uint32_t i, j;
+    struct stat st;
+    void *mem;
+
+    if (map_internal->fd >= 0)
+        return 0;
 
-    fd = open(path, O_RDWR | O_CLOEXEC);
-    if (fd < 0) {
-        SOL_WRN("Could not open memory file [%s]: %s", path,
-            sol_util_strerrora(errno));
+    map_internal->fd = open(map_internal->resolved_path, O_RDWR | O_CLOEXEC);
+    if (map_internal->fd < 0) {
+        SOL_WRN("Could not open memory file [%s]: %s",
+            map_internal->resolved_path, sol_util_strerrora(errno));
         return -errno;
     }
 
-    if (lseek(fd, entry->offset, SEEK_SET) < 0)
-        goto error;
+    map_internal->size = get_map_size(map_internal->map);
+    if (!map_internal->size || fstat(map_internal->fd, &st) < 0 ||
+        !S_ISREG(st.st_mode) || (size_t)st.st_size < map_internal->size)
+        goto no_mmap;
+
+    mem = mmap(NULL, map_internal->size, PROT_READ | PROT_WRITE, MAP_SHARED,
+        map_internal->fd, 0);
+    if (mem == MAP_FAILED) {
+        SOL_DBG("Could not mmap() memory file [%s], using read/write: %s",
+            map_internal->resolved_path, sol_util_strerrora(errno));
+        goto no_mmap;
+    }
 
-    if ((ret = sol_util_fill_buffer_exactly(fd, buffer, entry->size)) < 0)
-        goto error;
+    map_internal->mem = mem;
+    return 0;
 
-    if (mask) {
-        for (i = 0, j = 0; i < entry->size; i++, j += 8)
-            value |= (uint64_t)((uint8_t *)buffer->data)[i] << j;
+no_mmap:
+    map_internal->mem = NULL;
+    return 0;
+}
 
-        value &= mask;
-        value >>= entry->bit_offset;
+static void
+storage_close(struct map_internal *map_internal)
+{
+    if (map_internal->mem) {
+        munmap(map_internal->mem, map_internal->size);
+        map_internal->mem = NULL;
+    }
 
-        memset(buffer->data, 0, buffer->capacity);
-        for (i = 0; i < entry->size; i++, value >>= 8)
-            ((uint8_t *)buffer->data)[i] = value & 0xff;
+    if (map_internal->fd >= 0) {
+        close(map_internal->fd);
+        map_internal->fd = -1;
     }
+}
 
-    if (close(fd) < 0)
-        return -errno;
+static int
+storage_read(struct map_internal *map_internal, size_t offset, void *buf, size_t size)
+{
+    ssize_t r;
+
+    if (map_internal->mem) {
+        memcpy(buf, map_internal->mem + offset, size);
+        return 0;
+    }
+
+    while (size) {
+        r = pread(map_internal->fd, buf, size, offset);
+        if (r < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+        if (r < 0)
+            return -errno;
+        if (r == 0)
+            return -EIO;
+
+        buf = (uint8_t *)buf + r;
+        offset += r;
+        size -= r;
+    }
 
     return 0;
+}
 
-error:
-    if (!ret)
-        ret = -errno;
-    close(fd);
+static int
+storage_write(struct map_internal *map_internal, size_t offset, const void *buf, size_t size)
+{
+    ssize_t r;
+
+    if (map_internal->mem) {
+        memcpy(map_internal->mem + offset, buf, size);
+        if (map_internal->dirty_end == map_internal->dirty_start) {
+            map_internal->dirty_start = offset;
+            map_internal->dirty_end = offset + size;
+        } else {
+            map_internal->dirty_start = sol_min(map_internal->dirty_start, offset);
+            map_internal->dirty_end = sol_max(map_internal->dirty_end, offset + size);
+        }
+        return 0;
+    }
 
-    return ret;
+    while (size) {
+        r = pwrite(map_internal->fd, buf, size, offset);
+        if (r < 0 && (errno == EINTR || errno == EAGAIN))
+            continue;
+        if (r < 0)
+            return -errno;
+        if (r == 0)
+            return -EIO;
+
+        buf = (const uint8_t *)buf + r;
+        offset += r;
+        size -= r;
+    }
+
+    return 0;
 }
 
+/* Writes applied to the mapping since the last sync are flushed by a
+ * single msync() covering all of them. MS_SYNC waits for the pages to
+ * reach the file, so it's only called from the storage worker, and
+ * write callbacks are only called once the data is stored. */
 static int
-sol_memmap_write_raw_do(const char *path, const char *name, const struct sol_memmap_entry *entry, uint64_t mask, struct sol_blob *blob,
-    void (*cb)(void *data, const char *name, struct sol_blob *blob, int status),
-    const void *data, FILE *reuse_file)
+storage_sync(struct map_internal *map_internal)
 {
-    FILE *file = NULL;
-    int ret = 0;
+    size_t start, len;
+    long page_size;
 
-    if (!sol_blob_ref(blob))
-        return -ENOMEM;
+    if (!map_internal->mem || map_internal->dirty_end == map_internal->dirty_start)
+        return 0;
 
-    if (reuse_file) {
-        file = reuse_file;
-    } else {
-        file = fopen(path, "r+e");
-        if (!file) {
-            SOL_WRN("Could not open memory file [%s]: %s", path,
-                sol_util_strerrora(errno));
-            goto error;
-        }
+    page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0)
+        page_size = 4096;
+
+    start = map_internal->dirty_start & ~((size_t)page_size - 1);
+    len = map_internal->dirty_end - start;
+    map_internal->dirty_start = map_internal->dirty_end = 0;
+
+    if (msync(map_internal->mem + start, len, MS_SYNC) < 0) {
+        SOL_WRN("Could not sync memory file [%s]: %s",
+            map_internal->resolved_path, sol_util_strerrora(errno));
+        return -errno;
     }
 
-    if (fseek(file, entry->offset, SEEK_SET) < 0)
-        goto error;
+    return 0;
+}
+
+static int
+sol_memmap_read_raw_do(struct map_internal *map_internal, const struct sol_memmap_entry *entry, uint64_t mask, struct sol_buffer *buffer)
+{
+    uint64_t value = 0;
+    uint8_t *data;
+    uint32_t i, j;
+    size_t total;
+    int ret;
+
+    ret = storage_open(map_internal);
+    SOL_INT_CHECK(ret, < 0, ret);
+
+    ret = sol_util_size_add(buffer->used, entry->size, &total);
+    SOL_INT_CHECK(ret, < 0, ret);
+
+    ret = sol_buffer_ensure(buffer, total);
+    SOL_INT_CHECK(ret, < 0, ret);
+
+    data = (uint8_t *)buffer->data + buffer->used;
+    ret = storage_read(map_internal, entry->offset, data, entry->size);
+    if (ret < 0) {
+        SOL_DBG("Error reading from file [%s]: %s",
+            map_internal->resolved_path, sol_util_strerrora(-ret));
+        return ret;
+    }
+
+    if (mask) {
+        for (i = 0, j = 0; i < entry->size; i++, j += 8)
+            value |= (uint64_t)data[i] << j;
+
+        value &= mask;
+        value >>= entry->bit_offset;
+
+        for (i = 0; i < entry->size; i++, value >>= 8)
+            data[i] = value & 0xff;
+    }
+
+    buffer->used = total;
+
+    if (SOL_BUFFER_NEEDS_NUL_BYTE(buffer))
+        return sol_buffer_ensure_nul_byte(buffer);
+
+    return 0;
+}
+
+static int
+sol_memmap_write_raw_do(struct map_internal *map_internal, const struct sol_memmap_entry *entry, uint64_t mask, const void *mem, size_t size)
+{
+    int ret;
+
+    ret = storage_open(map_internal);
+    SOL_INT_CHECK(ret, < 0, ret);
 
     if (mask) {
-        uint64_t value = 0, old_value;
+        uint64_t value = 0, old_value = 0;
+        uint8_t bytes[sizeof(uint64_t)];
         uint32_t i, j;
 
         /* entry->size > 8 implies that no mask should be used */
         assert(entry->size <= 8);
 
-        for (i = 0, j = 0; i < entry->size; i++, j += 8)
-            value |= (uint64_t)((uint8_t *)blob->mem)[i] << j;
+        for (i = 0, j = 0; i < sol_min(entry->size, size); i++, j += 8)
+            value |= (uint64_t)((const uint8_t *)mem)[i] << j;
 
-        ret = fread(&old_value, entry->size, 1, file);
-        if (!ret || ferror(file) || feof(file)) {
-            errno = EIO;
+        ret = storage_read(map_internal, entry->offset, bytes, entry->size);
+        if (ret < 0)
             goto error;
-        }
 
-        /* We just read from file, let's rewind */
-        if (fseek(file, entry->offset, SEEK_SET) < 0)
-            goto error;
+        for (i = 0, j = 0; i < entry->size; i++, j += 8)
+            old_value |= (uint64_t)bytes[i] << j;
 
         value <<= entry->bit_offset;
         value &= mask;
         value |= (old_value & ~mask);
-        fwrite(&value, entry->size, 1, file);
+
+        for (i = 0; i < entry->size; i++, value >>= 8)
+            bytes[i] = value & 0xff;
+
+        ret = storage_write(map_internal, entry->offset, bytes, entry->size);
     } else {
-        fwrite(blob->mem, sol_min(entry->size, blob->size), 1, file);
+        ret = storage_write(map_internal, entry->offset, mem,
+            sol_min(entry->size, size));
     }
 
-    if (ferror(file)) {
-        errno = EIO;
+    if (ret < 0)
         goto error;
-    }
 
-    errno = 0;
-    if (!reuse_file)
-        fclose(file);
-
-    if (cb)
-        cb((void *)data, name, blob, -errno);
-
-    sol_blob_unref(blob);
-
-    return -errno;
+    return 0;
 
 error:
-    SOL_DBG("Error writing to file [%s]: %s", path, sol_util_strerrora(errno));
-    ret = -errno;
-    if (file && !reuse_file)
-        fclose(file);
-
-    if (cb)
-        cb((void *)data, name, blob, ret);
-
-    sol_blob_unref(blob);
-
+    SOL_DBG("Error writing to file [%s]: %s", map_internal->resolved_path,
+        sol_util_strerrora(-ret));
     return ret;
 }
 
-static void
-version_write_cb(void *data, const char *name, struct sol_blob *blob, int status)
-{
-    if (status < 0)
-        SOL_WRN("Could not write version to file: %d", status);
-    sol_blob_unref(blob);
-}
+static bool perform_pending_writes(void *data);
 
 static bool
 check_version(struct map_internal *map_internal)
@@ -240,7 +382,6 @@ check_version(struct map_internal *map_internal)
         SOL_BUFFER_FLAGS_MEMORY_NOT_OWNED | SOL_BUFFER_FLAGS_NO_NUL_BYTE);
     const struct sol_memmap_entry *entry;
     uint64_t mask;
-    struct sol_blob *blob;
     int ret;
 
     if (map_internal->checked)
@@ -261,18 +402,16 @@ check_version(struct map_internal *map_internal)
         return false;
     }
 
-    ret = sol_memmap_read_raw_do(map_internal->resolved_path, entry, mask, &buf);
+    ret = sol_memmap_read_raw_do(map_internal, entry, mask, &buf);
     if (ret >= 0 && (version == 0 || version == 255)) {
-        blob = sol_blob_new(SOL_BLOB_TYPE_NO_FREE, NULL, &map_internal->map->api_version, sizeof(uint16_t));
-        SOL_NULL_CHECK(blob, false);
-
         /* No version on file, we should be initialising it */
         version = map_internal->map->api_version;
-        if ((ret = sol_memmap_write_raw_do(map_internal->resolved_path, MEMMAP_VERSION_ENTRY, entry, mask, blob, version_write_cb, NULL, NULL)) < 0) {
+        ret = sol_memmap_write_raw_do(map_internal, entry, mask, &version,
+            sizeof(version));
+        if (ret < 0) {
             SOL_WRN("Could not write current map version to file [%s]: %s",
                 map_internal->resolved_path,
                 sol_util_strerrora(-ret));
-            sol_blob_unref(blob);
             return false;
         }
     } else if (ret < 0) {
@@ -289,48 +428,183 @@ check_version(struct map_internal *map_internal)
     }
 
     map_internal->checked = true;
+
+    /* A version written to the mapping is flushed with the next batch */
+    if (map_internal->dirty_end != map_internal->dirty_start &&
+        !map_internal->timeout && !map_internal->inflight)
+        perform_pending_writes(map_internal);
+
     return true;
 }
 
+static struct map_internal *
+find_map_internal(const struct sol_memmap_map *map)
+{
+    struct map_internal *map_internal;
+    uint32_t i;
+
+    SOL_VECTOR_FOREACH_IDX (&memory_maps, map_internal, i) {
+        if (map_internal->map == map)
+            return map_internal;
+    }
+
+    return NULL;
+}
+
+static void
+apply_writes(struct map_internal *map_internal, struct sol_vector *writes)
+{
+    struct pending_write_data *pending;
+    uint32_t i;
+
+    SOL_VECTOR_FOREACH_IDX (writes, pending, i)
+        pending->status = sol_memmap_write_raw_do(map_internal, pending->entry,
+            pending->mask, pending->blob->mem, pending->blob->size);
+}
+
+static void
+finish_writes(struct sol_vector *writes, int r)
+{
+    struct pending_write_data *pending;
+    uint32_t i;
+
+    SOL_VECTOR_FOREACH_IDX (writes, pending, i) {
+        if (pending->cb)
+            pending->cb((void *)pending->data, pending->name, pending->blob,
+                pending->status < 0 ? pending->status : r);
+        free(pending->name);
+        sol_blob_unref(pending->blob);
+    }
+    sol_vector_clear(writes);
+}
+
+/* Runs on the storage worker. Writes to a mapping were already copied
+ * to it from the main thread, so only the flush is left. */
+static int
+write_batch(void *data)
+{
+    struct memmap_batch *batch = data;
+
+    if (!batch->storage.mem)
+        apply_writes(&batch->storage, &batch->writes);
+
+    return storage_sync(&batch->storage);
+}
+
+static void
+write_batch_done(void *data, int status)
+{
+    struct memmap_batch *batch = data;
+    struct map_internal *map_internal;
+
+    map_internal = find_map_internal(batch->map);
+    if (map_internal)
+        map_internal->inflight = NULL;
+
+    finish_writes(&batch->writes, status);
+
+    SOL_DBG("Performed pending writes on [%s]", batch->storage.resolved_path);
+
+    /* Callbacks may have added or removed maps */
+    map_internal = find_map_internal(batch->map);
+    free(batch);
+
+    if (map_internal && !map_internal->timeout &&
+        (map_internal->pending_writes.len ||
+        map_internal->dirty_end != map_internal->dirty_start))
+        perform_pending_writes(map_internal);
+}
+
 static bool
 perform_pending_writes(void *data)
 {
-    int i, r;
-    struct pending_write_data *pending;
-    FILE *file = NULL;
     struct map_internal *map_internal = data;
+    struct memmap_batch *batch;
     struct sol_vector tmp_vector;
+    int r;
 
     map_internal->timeout = NULL;
 
-    file = fopen(map_internal->resolved_path, "r+e");
-    if (!file) {
-        SOL_WRN("Error opening file [%s]: %s", map_internal->resolved_path,
-            sol_util_strerrora(errno));
+    /* Writes added meanwhile are sent once the current batch is done */
+    if (map_internal->inflight)
         return false;
-    }
 
     tmp_vector = map_internal->pending_writes;
     sol_vector_init(&map_internal->pending_writes, sizeof(struct pending_write_data));
 
-    SOL_VECTOR_FOREACH_IDX (&tmp_vector, pending, i) {
-        sol_memmap_write_raw_do(map_internal->map->path, pending->name, pending->entry,
-            pending->mask, pending->blob, pending->cb, pending->data, file);
-        free(pending->name);
-        sol_blob_unref(pending->blob);
+    r = storage_open(map_internal);
+    if (r < 0)
+        goto inline_writes;
+
+    /* Copying to the mapping is cheap and lets reads see the new values
+     * right away, the worker is left with flushing it */
+    if (map_internal->mem)
+        apply_writes(map_internal, &tmp_vector);
+
+    if (!tmp_vector.len && map_internal->dirty_end == map_internal->dirty_start)
+        return false;
+
+    batch = malloc(sizeof(*batch));
+    if (!batch) {
+        r = -ENOMEM;
+        goto inline_writes;
+    }
+
+    batch->map = map_internal->map;
+    batch->storage = *map_internal;
+    batch->writes = tmp_vector;
+
+    /* The batch flushes everything dirtied so far */
+    map_internal->dirty_start = map_internal->dirty_end = 0;
+
+    map_internal->inflight = batch;
+    r = sol_storage_queue_submit(&memmap_queue, write_batch, write_batch_done,
+        batch);
+    if (r < 0) {
+        map_internal->inflight = NULL;
+        map_internal->dirty_start = batch->storage.dirty_start;
+        map_internal->dirty_end = batch->storage.dirty_end;
+        free(batch);
+        goto inline_writes;
+    }
+
+    return false;
+
+inline_writes:
+    /* The mapping is left dirty for the next batch to flush, so its
+     * writes can't be reported as stored yet */
+    if (map_internal->mem) {
+        finish_writes(&tmp_vector, r);
+        return false;
     }
-    sol_vector_clear(&tmp_vector);
 
-    r = fclose(file);
-    if (r)
-        SOL_WRN("Error closing file [%s]: %s", map_internal->resolved_path,
-            sol_util_strerrora(errno));
+    apply_writes(map_internal, &tmp_vector);
+    finish_writes(&tmp_vector, 0);
 
     SOL_DBG("Performed pending writes on [%s]", map_internal->resolved_path);
 
     return false;
 }
 
+/* Completing a batch may start another one, with the writes added
+ * while it was being done */
+static void
+flush_pending_writes(const struct sol_memmap_map *map)
+{
+    struct map_internal *map_internal;
+
+    while ((map_internal = find_map_internal(map))) {
+        if (map_internal->timeout) {
+            sol_timeout_del(map_internal->timeout);
+            perform_pending_writes(map_internal);
+        } else if (!map_internal->inflight) {
+            break;
+        }
+
+        sol_storage_queue_drain(&memmap_queue);
+    }
+}
+
 static bool
 replace_pending_write(struct sol_vector *pending_writes, const char *name,
     const struct sol_memmap_entry *entry, uint64_t mask, struct sol_blob *blob,
@@ -338,7 +612,7 @@ replace_pending_write(struct sol_vector *pending_writes, const char *name,
     const void *data)
 {
     struct pending_write_data *pending;
-    int i;
+    uint32_t i;
 
     SOL_VECTOR_FOREACH_IDX (pending_writes, pending, i) {
         if (streq(pending->name, name)) {
@@ -440,28 +714,40 @@ sol_memmap_write_raw(const char *name, struct sol_blob *blob,
 }
 
 static bool
-read_from_pending(const char *name, struct sol_buffer *buffer)
+read_from_vector(struct sol_vector *writes, const char *name, struct sol_buffer *buffer)
 {
     struct pending_write_data *pending;
+    uint32_t i;
+
+    SOL_VECTOR_FOREACH_IDX (writes, pending, i) {
+        if (streq(name, pending->name)) {
+            // TODO maybe a sol_buffer_append_blob?
+            if (sol_buffer_ensure(buffer, pending->blob->size) < 0) {
+                // TODO how bad is this? return old value? fail reading?
+                SOL_WRN("Could not ensure buffer size to fit pending blob");
+                return false;
+            }
+            memcpy(buffer->data, pending->blob->mem, pending->blob->size);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static bool
+read_from_pending(const char *name, struct sol_buffer *buffer)
+{
     struct map_internal *map_internal;
-    int i, j;
+    uint32_t i;
 
+    /* Writes being done by the worker may not have reached storage yet */
     SOL_VECTOR_FOREACH_IDX (&memory_maps, map_internal, i) {
-        if (!map_internal->pending_writes.len)
-            continue;
-
-        SOL_VECTOR_FOREACH_IDX (&map_internal->pending_writes, pending, j) {
-            if (streq(name, pending->name)) {
-                // TODO maybe a sol_buffer_append_blob?
-                if (sol_buffer_ensure(buffer, pending->blob->size) < 0) {
-                    // TODO how bad is this? return old value? fail reading?
-                    SOL_WRN("Could not ensure buffer size to fit pending blob");
-                    return false;
-                }
-                memcpy(buffer->data, pending->blob->mem, pending->blob->size);
-                return true;
-            }
-        }
+        if (read_from_vector(&map_internal->pending_writes, name, buffer))
+            return true;
+        if (map_internal->inflight &&
+            read_from_vector(&map_internal->inflight->writes, name, buffer))
+            return true;
     }
 
     return false;
@@ -488,7 +774,7 @@ sol_memmap_read_raw(const char *name, struct sol_buffer *buffer)
     if (read_from_pending(name, buffer))
         return 0;
 
-    return sol_memmap_read_raw_do(map_internal->resolved_path, entry, mask, buffer);
+    return sol_memmap_read_raw_do(map_internal, entry, mask, buffer);
 }
 
 static bool
@@ -673,10 +959,15 @@ sol_memmap_add_map(const struct sol_memmap_map *map)
 
     map_internal->map = map;
     map_internal->resolved_path = resolve_map_path(map);
-    SOL_NULL_CHECK_GOTO(map_internal, error);
+    SOL_NULL_CHECK_GOTO(map_internal->resolved_path, error);
 
     sol_vector_init(&map_internal->pending_writes, sizeof(struct pending_write_data));
 
+    /* Storage may not be available yet, in which case it is opened on
+     * first access */
+    map_internal->fd = -1;
+    storage_open(map_internal);
+
     return 0;
 
 error:
@@ -688,16 +979,16 @@ SOL_API int
 sol_memmap_remove_map(const struct sol_memmap_map *map)
 {
     struct map_internal *map_internal;
-    int i;
+    uint32_t i;
 
     SOL_NULL_CHECK(map, -EINVAL);
 
+    flush_pending_writes(map);
+
     SOL_VECTOR_FOREACH_IDX (&memory_maps, map_internal, i) {
         if (map_internal->map == map) {
-            if (map_internal->timeout) {
-                sol_timeout_del(map_internal->timeout);
-                perform_pending_writes(map_internal);
-            }
+            storage_close(map_internal);
+            free(map_internal->resolved_path);
             return sol_vector_del(&memory_maps, i);
         }
     }
@@ -705,11 +996,17 @@ sol_memmap_remove_map(const struct sol_memmap_map *map)
     return -ENOENT;
 }
 
+SOL_API unsigned int
+sol_memmap_get_queue_depth(void)
+{
+    return sol_storage_queue_get_depth(&memmap_queue);
+}
+
 SOL_API bool
 sol_memmap_set_timeout(struct sol_memmap_map *map, uint32_t timeout)
 {
     struct map_internal *map_internal;
-    int i;
+    uint32_t i;
 
     SOL_NULL_CHECK(map, false);
 
@@ -731,7 +1028,7 @@ SOL_API uint32_t
 sol_memmap_get_timeout(const struct sol_memmap_map *map)
 {
     struct map_internal *map_internal;
-    int i;
+    uint32_t i;
 
     SOL_NULL_CHECK(map, false);
 
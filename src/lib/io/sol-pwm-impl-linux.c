@@ -37,22 +37,50 @@
 SOL_LOG_INTERNAL_DECLARE_STATIC(_log_domain, "pwm");
 
 #define PWM_BASE "/sys/class/pwm"
+/* Lets sysfs tree be replaced by a fake one, as done by benchmarks */
+#define PWM_BASE_ENVVAR "SOL_PWM_SYSFS_PATH"
 
 #define EXPORT_STAT_RETRIES 10
 
 #define PWM_PATH(dst, pwm, action) \
-    snprintf(dst, sizeof(dst), PWM_BASE "/pwmchip%d/pwm%d/%s", pwm->device, pwm->channel, action);
+    snprintf(dst, sizeof(dst), "%s/pwmchip%d/pwm%d/%s", _pwm_base_path(), \
+    pwm->device, pwm->channel, action);
 
 struct sol_pwm {
     int device;
     int channel;
 
-    FILE *period;
-    FILE *duty_cycle;
+    /* Attribute files kept open, -1 if closed */
+    int period;
+    int duty_cycle;
+    int enable;
+
+    /* Last values written, so unchanged ones aren't written again.
+     * -1 if unknown. */
+    int64_t period_value;
+    int64_t duty_cycle_value;
+    int enabled_value;
 
     bool owned;
+    /* period is the chip-wide pwm_period, which other handles on the
+     * same chip may change behind our back */
+    bool chip_period;
 };
 
+static const char *
+_pwm_base_path(void)
+{
+    static const char *base_path;
+
+    if (!base_path) {
+        base_path = getenv(PWM_BASE_ENVVAR);
+        if (!base_path || !base_path[0])
+            base_path = PWM_BASE;
+    }
+
+    return base_path;
+}
+
 static bool
 _pwm_export(int device, int channel, bool export)
 {
@@ -62,7 +90,8 @@ _pwm_export(int device, int channel, bool export)
     bool ret = false;
 
     if (export) {
-        snprintf(path, sizeof(path), PWM_BASE "/pwmchip%d/npwm", device);
+        snprintf(path, sizeof(path), "%s/pwmchip%d/npwm", _pwm_base_path(),
+            device);
         if (sol_util_read_file(path, "%d", &npwm) < 1) {
             SOL_WRN("pwm #%d: could not read number of PWM channels available", device);
             return false;
@@ -74,7 +103,8 @@ _pwm_export(int device, int channel, bool export)
         }
     }
 
-    snprintf(path, sizeof(path), PWM_BASE "/pwmchip%d/%s", device, what);
+    snprintf(path, sizeof(path), "%s/pwmchip%d/%s", _pwm_base_path(), device,
+        what);
     if (sol_util_write_file(path, "%d", channel) < 0) {
         SOL_WRN("Failed writing to PWM export file");
         return false;
@@ -83,7 +113,8 @@ _pwm_export(int device, int channel, bool export)
     if (!export)
         return true;
 
-    len = snprintf(path, sizeof(path), PWM_BASE "/pwmchip%d/pwm%d", device, channel);
+    len = snprintf(path, sizeof(path), "%s/pwmchip%d/pwm%d", _pwm_base_path(),
+        device, channel);
     if (len < 0 || len >= (int)sizeof(path))
         return false;
 
@@ -137,16 +168,10 @@ _pwm_write(struct sol_pwm *pwm, const char *file, const char *fmt, ...)
     return ret;
 }
 
-static FILE *
-_pwm_fopen(const char *path)
+static int
+_pwm_open_fd(const char *path)
 {
-    FILE *fp;
-
-    fp = fopen(path, "w+e");
-    if (!fp)
-        return NULL;
-    setvbuf(fp, NULL, _IONBF, 0);
-    return fp;
+    return open(path, O_RDWR | O_CLOEXEC);
 }
 
 static bool
@@ -156,19 +181,20 @@ _pwm_open_period(struct sol_pwm *pwm)
     struct stat st;
 
     /* try 2 different paths to set periods */
-    snprintf(path, sizeof(path), PWM_BASE "/pwmchip%d/device/pwm_period",
-        pwm->device);
+    snprintf(path, sizeof(path), "%s/pwmchip%d/device/pwm_period",
+        _pwm_base_path(), pwm->device);
     if (!stat(path, &st)) {
-        pwm->period = _pwm_fopen(path);
-        if (!pwm->period)
+        pwm->period = _pwm_open_fd(path);
+        if (pwm->period < 0)
             SOL_WRN("pwm #%d,%d: could not open period file %s", pwm->device,
                 pwm->channel, path);
     }
+    pwm->chip_period = pwm->period >= 0;
 
-    if (!pwm->period) {
+    if (pwm->period < 0) {
         PWM_PATH(path, pwm, "period");
-        pwm->period = _pwm_fopen(path);
-        if (!pwm->period) {
+        pwm->period = _pwm_open_fd(path);
+        if (pwm->period < 0) {
             SOL_WRN("pwm #%d,%d: could not open period file %s", pwm->device,
                 pwm->channel, path);
             return false;
@@ -178,6 +204,15 @@ _pwm_open_period(struct sol_pwm *pwm)
     return true;
 }
 
+static void
+_pwm_close_fd(int *fd)
+{
+    if (*fd > -1) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
 static int
 _pwm_config(struct sol_pwm *pwm, const struct sol_pwm_config *config)
 {
@@ -186,6 +221,14 @@ _pwm_config(struct sol_pwm *pwm, const struct sol_pwm_config *config)
     char pol_value[10];
     int r;
 
+    PWM_PATH(path, pwm, "enable");
+    pwm->enable = _pwm_open_fd(path);
+    if (pwm->enable < 0) {
+        SOL_WRN("pwm #%d,%d: could not open enable file", pwm->device,
+            pwm->channel);
+        return -errno;
+    }
+
     sol_pwm_set_enabled(pwm, false);
 
     switch (config->polarity) {
@@ -218,17 +261,14 @@ _pwm_config(struct sol_pwm *pwm, const struct sol_pwm_config *config)
         }
     }
 
-    if (!_pwm_open_period(pwm)) {
-        fclose(pwm->period);
+    if (!_pwm_open_period(pwm))
         return -ENOENT;
-    }
 
     PWM_PATH(path, pwm, "duty_cycle");
-    pwm->duty_cycle = _pwm_fopen(path);
-    if (!pwm->duty_cycle) {
+    pwm->duty_cycle = _pwm_open_fd(path);
+    if (pwm->duty_cycle < 0) {
         SOL_WRN("pwm #%d,%d: could not open duty_cycle file", pwm->device,
             pwm->channel);
-        fclose(pwm->period);
         return -EIO;
     }
 
@@ -239,8 +279,7 @@ _pwm_config(struct sol_pwm *pwm, const struct sol_pwm_config *config)
          */
         sol_pwm_set_duty_cycle(pwm, 0);
         sol_pwm_set_period(pwm, config->period_ns);
-        fclose(pwm->period);
-        pwm->period = NULL;
+        _pwm_close_fd(&pwm->period);
     }
 
     if (config->duty_cycle_ns != -1)
@@ -275,14 +314,22 @@ sol_pwm_open_raw(int device, int channel, const struct sol_pwm_config *config)
         return NULL;
     }
 
-    snprintf(path, sizeof(path), PWM_BASE "/pwmchip%d", device);
+    pwm->period = -1;
+    pwm->duty_cycle = -1;
+    pwm->enable = -1;
+    pwm->period_value = -1;
+    pwm->duty_cycle_value = -1;
+    pwm->enabled_value = -1;
+
+    snprintf(path, sizeof(path), "%s/pwmchip%d", _pwm_base_path(), device);
     if (stat(path, &st)) {
         SOL_WRN("pwm #%d,%d: pwm device %d does not exist", device, channel,
             device);
         goto open_error;
     }
 
-    snprintf(path, sizeof(path), PWM_BASE "/pwmchip%d/pwm%d", device, channel);
+    snprintf(path, sizeof(path), "%s/pwmchip%d/pwm%d", _pwm_base_path(),
+        device, channel);
     if (stat(path, &st)) {
         if (!_pwm_export(device, channel, true)) {
             SOL_WRN("pwm #%d,%d: could not export", device, channel);
@@ -300,6 +347,9 @@ sol_pwm_open_raw(int device, int channel, const struct sol_pwm_config *config)
 
     return pwm;
 config_error:
+    _pwm_close_fd(&pwm->enable);
+    _pwm_close_fd(&pwm->period);
+    _pwm_close_fd(&pwm->duty_cycle);
     if (pwm->owned)
         _pwm_export(device, channel, false);
 open_error:
@@ -313,14 +363,13 @@ sol_pwm_close(struct sol_pwm *pwm)
     SOL_NULL_CHECK(pwm);
 
     sol_pwm_set_enabled(pwm, false);
+    _pwm_close_fd(&pwm->enable);
 
     sol_pwm_set_duty_cycle(pwm, 0);
-    if (pwm->duty_cycle)
-        fclose(pwm->duty_cycle);
+    _pwm_close_fd(&pwm->duty_cycle);
 
     sol_pwm_set_period(pwm, 0);
-    if (pwm->period)
-        fclose(pwm->period);
+    _pwm_close_fd(&pwm->period);
 
     if (pwm->owned)
         _pwm_export(pwm->device, pwm->channel, false);
@@ -332,22 +381,27 @@ sol_pwm_set_enabled(struct sol_pwm *pwm, bool enable)
 {
     SOL_NULL_CHECK(pwm, false);
 
-    if (_pwm_write(pwm, "enable", "%d", enable) < 0) {
+    if (pwm->enabled_value == enable)
+        return true;
+
+    if (sol_util_fd_write_int64(pwm->enable, enable) < 0) {
         SOL_WRN("pwm #%d,%d: could not %s", pwm->device, pwm->channel, enable ? "enable" : "disable");
+        pwm->enabled_value = -1;
         return false;
     }
 
+    pwm->enabled_value = enable;
     return true;
 }
 
 SOL_API bool
 sol_pwm_get_enabled(const struct sol_pwm *pwm)
 {
-    int value;
+    int64_t value;
 
     SOL_NULL_CHECK(pwm, false);
 
-    if (_pwm_read(pwm, "enable", "%d", &value) < 1) {
+    if (sol_util_fd_read_int64(pwm->enable, &value) < 0) {
         SOL_WRN("pwm #%d,%d: could not get enable value", pwm->device, pwm->channel);
         return false;
     }
@@ -360,35 +414,50 @@ sol_pwm_set_period(struct sol_pwm *pwm, uint32_t period_ns)
 {
     SOL_NULL_CHECK(pwm, false);
 
-    if (!pwm->period) {
+    if (pwm->period_value == period_ns)
+        return true;
+
+    if (pwm->period < 0) {
         if (!_pwm_open_period(pwm))
             return false;
     }
-    if (fprintf(pwm->period, "%u", period_ns) < 0) {
+    if (sol_util_fd_write_int64(pwm->period, period_ns) < 0) {
         SOL_WRN("pwm #%d,%d: could not set period", pwm->device, pwm->channel);
+        pwm->period_value = -1;
         return false;
     }
 
+    /* A chip-wide period can't be cached per handle */
+    if (pwm->chip_period)
+        pwm->period_value = -1;
+    else
+        pwm->period_value = period_ns;
     return true;
 }
 
 SOL_API int32_t
 sol_pwm_get_period(const struct sol_pwm *pwm)
 {
-    int value, r;
+    int64_t value;
+    int r;
 
     SOL_NULL_CHECK(pwm, -EINVAL);
 
-    if (!pwm->period) {
-        r = _pwm_read(pwm, "period", "%d", &value);
-    } else {
-        rewind(pwm->period);
-        r = fscanf(pwm->period, "%d", &value);
+    if (pwm->period < 0) {
+        int v;
+
+        r = _pwm_read(pwm, "period", "%d", &v);
+        if (r < 1) {
+            SOL_WRN("pwm #%d,%d: could not read period", pwm->device, pwm->channel);
+            return r < 0 ? r : -EIO;
+        }
+        return v;
     }
 
-    if (r < 1) {
+    r = sol_util_fd_read_int64(pwm->period, &value);
+    if (r < 0) {
         SOL_WRN("pwm #%d,%d: could not read period", pwm->device, pwm->channel);
-        return -errno;
+        return r;
     }
 
     return value;
@@ -399,25 +468,31 @@ sol_pwm_set_duty_cycle(struct sol_pwm *pwm, uint32_t duty_cycle_ns)
 {
     SOL_NULL_CHECK(pwm, false);
 
-    if (fprintf(pwm->duty_cycle, "%u", duty_cycle_ns) < 0) {
+    if (pwm->duty_cycle_value == duty_cycle_ns)
+        return true;
+
+    if (sol_util_fd_write_int64(pwm->duty_cycle, duty_cycle_ns) < 0) {
         SOL_WRN("pwm #%d,%d: could not set duty_cycle", pwm->device, pwm->channel);
+        pwm->duty_cycle_value = -1;
         return false;
     }
 
+    pwm->duty_cycle_value = duty_cycle_ns;
     return true;
 }
 
 SOL_API int32_t
 sol_pwm_get_duty_cycle(const struct sol_pwm *pwm)
 {
-    int value;
+    int64_t value;
+    int r;
 
     SOL_NULL_CHECK(pwm, -EINVAL);
 
-    rewind(pwm->duty_cycle);
-    if (fscanf(pwm->duty_cycle, "%d", &value) < 1) {
+    r = sol_util_fd_read_int64(pwm->duty_cycle, &value);
+    if (r < 0) {
         SOL_WRN("pwm #%d,%d: could not read duty_cycle", pwm->device, pwm->channel);
-        return -errno;
+        return r;
     }
 
     return value;
@@ -22,6 +22,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
 #include <limits.h>
@@ -47,42 +48,51 @@ struct sol_spi {
 
     struct {
         void (*cb)(void *cb_data, struct sol_spi *spi, const uint8_t *tx, uint8_t *rx, ssize_t status);
+        void (*chain_cb)(void *cb_data, struct sol_spi *spi, const struct sol_spi_chain_item *items, unsigned int count, ssize_t status);
         const void *cb_data;
         const uint8_t *tx;
         uint8_t *rx;
+        const struct sol_spi_chain_item *items;
 #ifdef WORKER_THREAD
         struct sol_worker_thread *worker;
 #else
         struct sol_timeout *timeout;
 #endif
-        size_t count;
+        /* Kept across transfers, grown as longer chains come */
+        struct spi_ioc_transfer *msgs;
+        unsigned int msgs_len;
+        unsigned int msgs_size;
         ssize_t status;
     } transfer;
 };
 
 static void
-spi_transfer(struct sol_spi *spi, const uint8_t *tx, uint8_t *rx, size_t size)
+spi_transfer(struct sol_spi *spi)
 {
-    struct spi_ioc_transfer tr;
+    int r;
 
-    memset(&tr, 0, sizeof(struct spi_ioc_transfer));
-    tr.tx_buf = (uintptr_t)tx;
-    tr.rx_buf = (uintptr_t)rx;
-    tr.len = size;
-    tr.bits_per_word = spi->bits_per_word;
-
-    if (ioctl(spi->fd, SPI_IOC_MESSAGE(1), &tr) == -1) {
+    r = ioctl(spi->fd, SPI_IOC_MESSAGE(spi->transfer.msgs_len),
+        spi->transfer.msgs);
+    if (r == -1) {
         SOL_WRN("%u,%u: Unable to perform SPI transfer: %s", spi->bus,
             spi->chip_select, sol_util_strerrora(errno));
         return;
     }
 
-    spi->transfer.status = size;
+    spi->transfer.status = r;
 }
 
 static void
 spi_transfer_dispatch(struct sol_spi *spi)
 {
+    if (spi->transfer.items) {
+        if (!spi->transfer.chain_cb) return;
+        spi->transfer.chain_cb((void *)spi->transfer.cb_data, spi,
+            spi->transfer.items, spi->transfer.msgs_len,
+            spi->transfer.status);
+        return;
+    }
+
     if (!spi->transfer.cb) return;
     spi->transfer.cb((void *)spi->transfer.cb_data, spi, spi->transfer.tx,
         spi->transfer.rx, spi->transfer.status);
@@ -103,7 +113,7 @@ spi_worker_thread_iterate(void *data)
 {
     struct sol_spi *spi = data;
 
-    spi_transfer(spi, spi->transfer.tx, spi->transfer.rx, spi->transfer.count);
+    spi_transfer(spi);
     return false;
 }
 #else
@@ -112,7 +122,7 @@ spi_timeout_cb(void *data)
 {
     struct sol_spi *spi = data;
 
-    spi_transfer(spi, spi->transfer.tx, spi->transfer.rx, spi->transfer.count);
+    spi_transfer(spi);
     spi->transfer.timeout = NULL;
     spi_transfer_dispatch(spi);
 
@@ -120,8 +130,37 @@ spi_timeout_cb(void *data)
 }
 #endif
 
-SOL_API bool
-sol_spi_transfer(struct sol_spi *spi, const uint8_t *tx, uint8_t *rx, size_t size, void (*transfer_cb)(void *cb_data, struct sol_spi *spi, const uint8_t *tx, uint8_t *rx, ssize_t status), const void *cb_data)
+/* spi_ioc_transfer lengths are 32 bits wide */
+static bool
+spi_len_valid(size_t len)
+{
+#if SIZE_MAX > UINT32_MAX
+    return len <= UINT32_MAX;
+#else
+    return true;
+#endif
+}
+
+static bool
+spi_msgs_prepare(struct sol_spi *spi, unsigned int len)
+{
+    struct spi_ioc_transfer *msgs;
+
+    if (len > spi->transfer.msgs_size) {
+        msgs = realloc(spi->transfer.msgs, len * sizeof(*msgs));
+        SOL_NULL_CHECK(msgs, false);
+        spi->transfer.msgs = msgs;
+        spi->transfer.msgs_size = len;
+    }
+
+    memset(spi->transfer.msgs, 0, len * sizeof(*spi->transfer.msgs));
+    spi->transfer.msgs_len = len;
+
+    return true;
+}
+
+static bool
+spi_transfer_start(struct sol_spi *spi)
 {
 #ifdef WORKER_THREAD
     struct sol_worker_thread_config config = {
@@ -135,30 +174,102 @@ sol_spi_transfer(struct sol_spi *spi, const uint8_t *tx, uint8_t *rx, size_t siz
     };
 #endif
 
+    spi->transfer.status = -1;
+
+#ifdef WORKER_THREAD
+    spi->transfer.worker = sol_worker_thread_new(&config);
+    SOL_NULL_CHECK(spi->transfer.worker, false);
+#else
+    spi->transfer.timeout = sol_timeout_add(0, spi_timeout_cb, spi);
+    SOL_NULL_CHECK(spi->transfer.timeout, false);
+#endif
+
+    return true;
+}
+
+SOL_API bool
+sol_spi_transfer(struct sol_spi *spi, const uint8_t *tx, uint8_t *rx, size_t size, void (*transfer_cb)(void *cb_data, struct sol_spi *spi, const uint8_t *tx, uint8_t *rx, ssize_t status), const void *cb_data)
+{
+    struct spi_ioc_transfer *tr;
+
     SOL_NULL_CHECK(spi, false);
     SOL_INT_CHECK(size, == 0, false);
+    if (!spi_len_valid(size)) {
+        SOL_WRN("%u,%u: Transfer of %zu bytes is too long", spi->bus,
+            spi->chip_select, size);
+        errno = EINVAL;
+        return false;
+    }
 #ifdef WORKER_THREAD
     SOL_EXP_CHECK(spi->transfer.worker, false);
 #else
     SOL_EXP_CHECK(spi->transfer.timeout, false);
 #endif
 
+    if (!spi_msgs_prepare(spi, 1))
+        return false;
+
+    tr = spi->transfer.msgs;
+    tr->tx_buf = (uintptr_t)tx;
+    tr->rx_buf = (uintptr_t)rx;
+    tr->len = size;
+    tr->bits_per_word = spi->bits_per_word;
+
     spi->transfer.tx = tx;
     spi->transfer.rx = rx;
-    spi->transfer.count = size;
+    spi->transfer.items = NULL;
     spi->transfer.cb = transfer_cb;
+    spi->transfer.chain_cb = NULL;
     spi->transfer.cb_data = cb_data;
-    spi->transfer.status = -1;
 
+    return spi_transfer_start(spi);
+}
+
+SOL_API bool
+sol_spi_transfer_chain(struct sol_spi *spi, const struct sol_spi_chain_item *items, unsigned int count, void (*chain_cb)(void *cb_data, struct sol_spi *spi, const struct sol_spi_chain_item *items, unsigned int count, ssize_t status), const void *cb_data)
+{
+    struct spi_ioc_transfer *tr;
+    unsigned int i;
+
+    SOL_NULL_CHECK(spi, false);
+    SOL_NULL_CHECK(items, false);
+    SOL_INT_CHECK(count, == 0, false);
+    SOL_INT_CHECK(count, > SOL_SPI_CHAIN_MAX, false);
 #ifdef WORKER_THREAD
-    spi->transfer.worker = sol_worker_thread_new(&config);
-    SOL_NULL_CHECK(spi->transfer.worker, false);
+    SOL_EXP_CHECK(spi->transfer.worker, false);
 #else
-    spi->transfer.timeout = sol_timeout_add(0, spi_timeout_cb, spi);
-    SOL_NULL_CHECK(spi->transfer.timeout, false);
+    SOL_EXP_CHECK(spi->transfer.timeout, false);
 #endif
 
-    return true;
+    for (i = 0; i < count; i++) {
+        if (!spi_len_valid(items[i].count)) {
+            SOL_WRN("%u,%u: Transfer %u of %zu bytes is too long", spi->bus,
+                spi->chip_select, i, items[i].count);
+            errno = EINVAL;
+            return false;
+        }
+    }
+
+    if (!spi_msgs_prepare(spi, count))
+        return false;
+
+    for (i = 0, tr = spi->transfer.msgs; i < count; i++, tr++) {
+        tr->tx_buf = (uintptr_t)items[i].tx;
+        tr->rx_buf = (uintptr_t)items[i].rx;
+        tr->len = items[i].count;
+        tr->delay_usecs = items[i].delay_usecs;
+        tr->cs_change = items[i].cs_change;
+        tr->bits_per_word = spi->bits_per_word;
+    }
+
+    spi->transfer.tx = NULL;
+    spi->transfer.rx = NULL;
+    spi->transfer.items = items;
+    spi->transfer.cb = NULL;
+    spi->transfer.chain_cb = chain_cb;
+    spi->transfer.cb_data = cb_data;
+
+    return spi_transfer_start(spi);
 }
 
 SOL_API void
@@ -178,6 +289,7 @@ sol_spi_close(struct sol_spi *spi)
 #endif
     close(spi->fd);
 
+    free(spi->transfer.msgs);
     free(spi);
 }
 
@@ -235,6 +347,8 @@ sol_spi_open(unsigned int bus, const struct sol_spi_config *config)
 #else
     spi->transfer.timeout = NULL;
 #endif
+    spi->transfer.msgs = NULL;
+    spi->transfer.msgs_size = 0;
     return spi;
 
 config_error:
@@ -0,0 +1,330 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "sol-storage-worker.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+#include "sol-list.h"
+#include "sol-log.h"
+#include "sol-mainloop.h"
+#include "sol-util-internal.h"
+
+#if defined(WORKER_THREAD) && defined(PTHREAD)
+#define STORAGE_USE_POOL
+#include <pthread.h>
+
+#include "sol-task-pool.h"
+
+/* Storage I/O is bound by the devices, not by the CPU: a couple of
+ * threads are enough so a slow backend doesn't hold the others. The
+ * pool is not shared with CPU bound users, like message digests, so
+ * their tasks never wait behind a slow fdatasync(). */
+#define STORAGE_POOL_THREADS 2u
+#endif
+
+struct storage_job {
+    struct sol_list list;
+    struct sol_storage_queue *queue;
+    int (*work)(void *data);
+    void (*done)(void *data, int status);
+    const void *data;
+#ifdef STORAGE_USE_POOL
+    struct sol_task *task;
+    bool finished; /* work returned, guarded by lock */
+    bool dispatched; /* done was called by a drain */
+#endif
+    int status;
+};
+
+/* Jobs waiting for their queue to be idle, in submission order */
+static struct sol_list queued_jobs = SOL_LIST_INIT(queued_jobs);
+static struct sol_idle *inline_runner;
+
+#ifdef STORAGE_USE_POOL
+/* Jobs handed to the pool, at most one per queue */
+static struct sol_list running_jobs = SOL_LIST_INIT(running_jobs);
+static struct sol_task_pool *pool;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t finished_cond = PTHREAD_COND_INITIALIZER;
+#endif
+
+/* With @a queue, takes the oldest job of that queue, otherwise the
+ * oldest job of any idle queue */
+static struct storage_job *
+take_job(struct sol_storage_queue *queue)
+{
+    struct sol_list *itr;
+    struct storage_job *job;
+
+    SOL_LIST_FOREACH(&queued_jobs, itr) {
+        job = SOL_LIST_GET_CONTAINER(itr, struct storage_job, list);
+        if (queue ? job->queue != queue :
+            job->queue->busy || job->queue->draining)
+            continue;
+
+        sol_list_remove(itr);
+        return job;
+    }
+
+    return NULL;
+}
+
+static void
+finish_job(struct storage_job *job)
+{
+    job->queue->depth--;
+    job->done((void *)job->data, job->status);
+}
+
+static void
+run_jobs_inline(void)
+{
+    struct storage_job *job;
+
+    while ((job = take_job(NULL))) {
+        job->queue->busy = true;
+        job->status = job->work((void *)job->data);
+        job->queue->busy = false;
+
+        finish_job(job);
+        free(job);
+    }
+}
+
+static bool
+run_jobs_inline_cb(void *data)
+{
+    inline_runner = NULL;
+    run_jobs_inline();
+
+    return false;
+}
+
+static void
+schedule_inline(void)
+{
+    if (inline_runner)
+        return;
+
+    inline_runner = sol_idle_add(run_jobs_inline_cb, NULL);
+    if (!inline_runner) {
+        SOL_WRN("Could not schedule storage jobs, running them right away");
+        run_jobs_inline();
+    }
+}
+
+#ifdef STORAGE_USE_POOL
+/* Runs on a pool thread */
+static int
+job_work(void *data)
+{
+    struct storage_job *job = data;
+    int status;
+
+    status = job->work((void *)job->data);
+
+    pthread_mutex_lock(&lock);
+    job->status = status;
+    job->finished = true;
+    pthread_cond_broadcast(&finished_cond);
+    pthread_mutex_unlock(&lock);
+
+    return status;
+}
+
+static void start_jobs(void);
+
+static void
+job_done(void *data, int status)
+{
+    struct storage_job *job = data;
+
+    if (job->dispatched) {
+        free(job);
+        return;
+    }
+
+    sol_list_remove(&job->list);
+    job->queue->busy = false;
+    job->status = status;
+
+    finish_job(job);
+    free(job);
+
+    start_jobs();
+}
+
+/* Hands the oldest job of each idle queue to the pool */
+static void
+start_jobs(void)
+{
+    struct storage_job *job;
+
+    if (!pool) {
+        pool = sol_task_pool_new(&(struct sol_task_pool_config) {
+                SOL_SET_API_VERSION(.api_version = SOL_TASK_POOL_CONFIG_API_VERSION, )
+                .threads = STORAGE_POOL_THREADS
+            });
+        if (!pool) {
+            SOL_WRN("Could not start storage worker threads, doing I/O from the main loop");
+            schedule_inline();
+            return;
+        }
+    }
+
+    while ((job = take_job(NULL))) {
+        job->task = sol_task_pool_submit(pool, job_work, job_done, job);
+        if (!job->task) {
+            SOL_WRN("Could not submit storage job, doing I/O from the main loop");
+            sol_list_prepend(&queued_jobs, &job->list);
+            schedule_inline();
+            return;
+        }
+
+        job->queue->busy = true;
+        sol_list_append(&running_jobs, &job->list);
+    }
+}
+
+/* Finishes the job of @a queue handed to the pool, if any. Jobs that
+ * didn't start yet are run right away, otherwise this waits for
+ * them. The pool still delivers them later, but they are just freed
+ * then. */
+static void
+finish_running_job(struct sol_storage_queue *queue)
+{
+    struct sol_list *itr;
+    struct storage_job *job;
+
+    SOL_LIST_FOREACH(&running_jobs, itr) {
+        job = SOL_LIST_GET_CONTAINER(itr, struct storage_job, list);
+        if (job->queue != queue)
+            continue;
+
+        sol_list_remove(itr);
+        job->dispatched = true;
+
+        if (sol_task_pool_cancel(pool, job->task) == 0) {
+            job->status = job->work((void *)job->data);
+        } else {
+            pthread_mutex_lock(&lock);
+            while (!job->finished)
+                pthread_cond_wait(&finished_cond, &lock);
+            pthread_mutex_unlock(&lock);
+        }
+
+        queue->busy = false;
+        finish_job(job);
+        return;
+    }
+}
+#endif
+
+int
+sol_storage_queue_submit(struct sol_storage_queue *queue,
+    int (*work)(void *data), void (*done)(void *data, int status),
+    const void *data)
+{
+    struct storage_job *job;
+
+    SOL_NULL_CHECK(queue, -EINVAL);
+    SOL_NULL_CHECK(work, -EINVAL);
+    SOL_NULL_CHECK(done, -EINVAL);
+
+    job = calloc(1, sizeof(*job));
+    SOL_NULL_CHECK(job, -ENOMEM);
+
+    job->queue = queue;
+    job->work = work;
+    job->done = done;
+    job->data = data;
+
+    sol_list_append(&queued_jobs, &job->list);
+
+    queue->depth++;
+    SOL_DBG("Storage queue [%s] depth is %u", queue->name, queue->depth);
+
+#ifdef STORAGE_USE_POOL
+    start_jobs();
+#else
+    schedule_inline();
+#endif
+
+    return 0;
+}
+
+void
+sol_storage_queue_drain(struct sol_storage_queue *queue)
+{
+    struct storage_job *job;
+    bool draining;
+
+    SOL_NULL_CHECK(queue);
+
+    /* Jobs submitted by the completion callbacks are run here too,
+     * instead of being handed to the pool */
+    draining = queue->draining;
+    queue->draining = true;
+
+#ifdef STORAGE_USE_POOL
+    finish_running_job(queue);
+#endif
+
+    while ((job = take_job(queue))) {
+        job->status = job->work((void *)job->data);
+        finish_job(job);
+        free(job);
+    }
+
+    queue->draining = draining;
+}
+
+void
+sol_storage_shutdown(void)
+{
+    struct sol_list *first;
+    struct storage_job *job;
+
+    while (true) {
+        if (!sol_list_is_empty(&queued_jobs))
+            first = queued_jobs.next;
+#ifdef STORAGE_USE_POOL
+        else if (!sol_list_is_empty(&running_jobs))
+            first = running_jobs.next;
+#endif
+        else
+            break;
+
+        job = SOL_LIST_GET_CONTAINER(first, struct storage_job, list);
+        sol_storage_queue_drain(job->queue);
+    }
+
+    if (inline_runner) {
+        sol_idle_del(inline_runner);
+        inline_runner = NULL;
+    }
+
+#ifdef STORAGE_USE_POOL
+    /* Delivers the jobs finished by drains, which are just freed */
+    if (pool) {
+        sol_task_pool_del(pool);
+        pool = NULL;
+    }
+#endif
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+/*
+ * Blocking storage I/O shared by the storage backends. Jobs run on a
+ * sol_task_pool of their own (or from the main loop when worker
+ * threads are disabled) and their completion callbacks are always
+ * called from the main thread.
+ *
+ * Jobs submitted to the same queue run one at a time, in submission
+ * order, so a backend never sees its writes reordered. Different
+ * queues run in parallel.
+ */
+
+struct sol_storage_queue {
+    const char *name;
+    unsigned int depth; /* submitted jobs not completed yet */
+    bool busy; /* a job of this queue is running */
+    bool draining; /* sol_storage_queue_drain() is running */
+};
+
+#define SOL_STORAGE_QUEUE_INIT(_name) { .name = (_name) }
+
+/*
+ * @a work is called from a worker thread and must only touch data
+ * owned by the job, its return is given as @a status to @a done,
+ * called from the main thread.
+ */
+int sol_storage_queue_submit(struct sol_storage_queue *queue,
+    int (*work)(void *data), void (*done)(void *data, int status),
+    const void *data);
+
+/*
+ * Blocks until all jobs submitted to @a queue are done, including
+ * calling their completion callbacks.
+ */
+void sol_storage_queue_drain(struct sol_storage_queue *queue);
+
+static inline unsigned int
+sol_storage_queue_get_depth(const struct sol_storage_queue *queue)
+{
+    return queue->depth;
+}
+
+/*
+ * Runs all pending jobs and stops the worker threads, called by
+ * sol_shutdown().
+ */
+void sol_storage_shutdown(void);
@@ -1018,6 +1018,117 @@ sol_json_path_is_array_key(struct sol_str_slice slice)
     for (end_reason = SOL_JSON_LOOP_REASON_OK; \
         sol_json_path_get_next_segment(&scanner, &key_slice, &end_reason);)
 
+/**
+ * @struct sol_json_index
+ *
+ * @brief Structural index of a JSON document.
+ *
+ * The index is built by a single full pass over the document and
+ * records, for every value, its offsets in memory, the hash of its
+ * key (for object members) and direct links to the members of each
+ * object or array. Lookups by key, index or JSON Path then cost one
+ * step per path segment instead of a re-scan of the document, which
+ * pays off when the same document is queried several times.
+ *
+ * The index does not copy the document, so the memory given to
+ * sol_json_index_new() must remain valid and unchanged while the
+ * index is in use.
+ *
+ * Tokens returned by the index functions span the whole value, that
+ * is, for objects and arrays @c end points one past the closing
+ * bracket.
+ *
+ * @see sol_json_index_new()
+ */
+struct sol_json_index;
+
+/**
+ * @brief Build the structural index of a JSON document.
+ *
+ * @param mem The JSON document.
+ * @param size The size of @a mem in bytes.
+ *
+ * @return A new index on success, @c NULL on failure with errno set
+ *         to @c EINVAL if @a mem is not a valid JSON document, @c
+ *         EOVERFLOW if it is too large or @c ENOMEM.
+ *
+ * @see sol_json_index_del()
+ */
+struct sol_json_index *sol_json_index_new(const void *mem, size_t size);
+
+/**
+ * @brief Delete an index created with sol_json_index_new().
+ *
+ * @param index The index to delete.
+ */
+void sol_json_index_del(struct sol_json_index *index);
+
+/**
+ * @brief Get the number of members of the root object or array.
+ *
+ * @param index The index of the document.
+ *
+ * @return The number of keys of the root object or the number of
+ *         elements of the root array. Zero if the root is neither.
+ */
+uint32_t sol_json_index_get_member_count(const struct sol_json_index *index) SOL_ATTR_NONNULL(1);
+
+/**
+ * @brief Get the member at position @a i of the root object or array.
+ *
+ * @param index The index of the document.
+ * @param i The position of the desired member.
+ * @param key If not @c NULL and the root is an object, filled with
+ *        the key of the member, as a string token. Set to an empty
+ *        token if the root is an array.
+ * @param value Filled with the value of the member.
+ *
+ * @return 0 on success, -EINVAL if the root is neither an object
+ *         nor an array and -ENOENT if @a i is out of bounds.
+ */
+int sol_json_index_get_member(const struct sol_json_index *index, uint32_t i, struct sol_json_token *key, struct sol_json_token *value) SOL_ATTR_NONNULL(1, 4);
+
+/**
+ * @brief Indexed version of sol_json_object_get_value_by_key().
+ *
+ * @param index The index of a document whose root is a JSON Object.
+ * @param key_slice The key of the desired element.
+ * @param value Filled with the value referenced by @a key_slice.
+ *
+ * @return 0 on success, -EINVAL if the root is not a JSON Object and
+ *         -ENOENT if @a key_slice is not present.
+ */
+int sol_json_index_object_get_value_by_key(const struct sol_json_index *index, const struct sol_str_slice key_slice, struct sol_json_token *value) SOL_ATTR_NONNULL(1, 3);
+
+/**
+ * @brief Indexed version of sol_json_array_get_at_index().
+ *
+ * @param index The index of a document whose root is a JSON Array.
+ * @param i The position of the desired element.
+ * @param value Filled with the value at position @a i.
+ *
+ * @return 0 on success, -EINVAL if the root is not a JSON Array and
+ *         -ENOENT if @a i is larger than the array's length.
+ */
+int sol_json_index_array_get_at_index(const struct sol_json_index *index, uint16_t i, struct sol_json_token *value) SOL_ATTR_NONNULL(1, 3);
+
+/**
+ * @brief Indexed version of sol_json_get_value_by_path().
+ *
+ * Unlike sol_json_get_value_by_path(), the root path ("$") yields the
+ * whole document.
+ *
+ * @param index The index of a document whose root is a JSON Object
+ *        or a JSON Array.
+ * @param path The JSON Path of the desired element.
+ * @param value Filled with the value referenced by @a path.
+ *
+ * @return 0 on success, -EINVAL if the root is neither a JSON Object
+ *         nor a JSON Array and -ENOENT if @a path is invalid or does
+ *         not reference an element of the document.
+ */
+int sol_json_index_get_value_by_path(const struct sol_json_index *index, struct sol_str_slice path, struct sol_json_token *value) SOL_ATTR_NONNULL(1, 3);
+
 /**
  * @}
  */
@@ -0,0 +1,332 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sol-log.h"
+#include "sol-macros.h"
+#include "sol-util-internal.h"
+
+#include "sol-json-scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define JSON_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+static inline bool
+is_json_whitespace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline bool
+is_string_delim(char c)
+{
+    return c == '"' || c == '\\';
+}
+
+static inline bool
+is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static const char *
+skip_whitespace_scalar(const char *p, const char *end)
+{
+    while (p < end && is_json_whitespace(*p))
+        p++;
+    return p;
+}
+
+static const char *
+find_string_delim_scalar(const char *p, const char *end)
+{
+    while (p < end && !is_string_delim(*p))
+        p++;
+    return p;
+}
+
+static const char *
+skip_digits_scalar(const char *p, const char *end)
+{
+    while (p < end && is_digit(*p))
+        p++;
+    return p;
+}
+
+static const struct sol_json_scan_ops scan_ops_scalar = {
+    .skip_whitespace = skip_whitespace_scalar,
+    .find_string_delim = find_string_delim_scalar,
+    .skip_digits = skip_digits_scalar,
+    .name = "scalar",
+};
+
+#ifdef JSON_SCAN_X86
+
+/* Runs are usually short (a single space after ':', a couple of
+ * digits) so all vector versions check the first byte before loading
+ * a whole block, and leave the tail shorter than a block to the scalar
+ * loop instead of reading past end.
+ */
+
+static inline __m128i
+whitespace_mask_sse2(__m128i v)
+{
+    return _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+        _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'))),
+        _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')),
+        _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))));
+}
+
+static inline __m128i
+digit_mask_sse2(__m128i v)
+{
+    /* '0' <= v <= '9' using unsigned min/max */
+    return _mm_and_si128(
+        _mm_cmpeq_epi8(_mm_max_epu8(v, _mm_set1_epi8('0')), v),
+        _mm_cmpeq_epi8(_mm_min_epu8(v, _mm_set1_epi8('9')), v));
+}
+
+static const char *
+skip_whitespace_sse2(const char *p, const char *end)
+{
+    unsigned int mask;
+
+    if (p < end && !is_json_whitespace(*p))
+        return p;
+
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+
+        mask = ~_mm_movemask_epi8(whitespace_mask_sse2(v)) & 0xffff;
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+
+    return skip_whitespace_scalar(p, end);
+}
+
+static const char *
+find_string_delim_sse2(const char *p, const char *end)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    unsigned int mask;
+
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+
+        mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+            _mm_cmpeq_epi8(v, backslash)));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+
+    return find_string_delim_scalar(p, end);
+}
+
+static const char *
+skip_digits_sse2(const char *p, const char *end)
+{
+    unsigned int mask;
+
+    if (p < end && !is_digit(*p))
+        return p;
+
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+
+        mask = ~_mm_movemask_epi8(digit_mask_sse2(v)) & 0xffff;
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+
+    return skip_digits_scalar(p, end);
+}
+
+static const struct sol_json_scan_ops scan_ops_sse2 = {
+    .skip_whitespace = skip_whitespace_sse2,
+    .find_string_delim = find_string_delim_sse2,
+    .skip_digits = skip_digits_sse2,
+    .name = "sse2",
+};
+
+#define AVX2 __attribute__((target("avx2")))
+
+static inline AVX2 __m256i
+whitespace_mask_avx2(__m256i v)
+{
+    return _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'))),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')),
+        _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))));
+}
+
+static inline AVX2 __m256i
+digit_mask_avx2(__m256i v)
+{
+    return _mm256_and_si256(
+        _mm256_cmpeq_epi8(_mm256_max_epu8(v, _mm256_set1_epi8('0')), v),
+        _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8('9')), v));
+}
+
+static AVX2 const char *
+skip_whitespace_avx2(const char *p, const char *end)
+{
+    uint32_t mask;
+
+    if (p < end && !is_json_whitespace(*p))
+        return p;
+
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+
+        mask = ~(uint32_t)_mm256_movemask_epi8(whitespace_mask_avx2(v));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+
+    return skip_whitespace_sse2(p, end);
+}
+
+static AVX2 const char *
+find_string_delim_avx2(const char *p, const char *end)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    uint32_t mask;
+
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+
+        mask = _mm256_movemask_epi8(_mm256_or_si256(
+            _mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+
+    return find_string_delim_sse2(p, end);
+}
+
+static AVX2 const char *
+skip_digits_avx2(const char *p, const char *end)
+{
+    uint32_t mask;
+
+    if (p < end && !is_digit(*p))
+        return p;
+
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)p);
+
+        mask = ~(uint32_t)_mm256_movemask_epi8(digit_mask_avx2(v));
+        if (mask)
+            return p + __builtin_ctz(mask);
+    }
+
+    return skip_digits_sse2(p, end);
+}
+
+#undef AVX2
+
+static const struct sol_json_scan_ops scan_ops_avx2 = {
+    .skip_whitespace = skip_whitespace_avx2,
+    .find_string_delim = find_string_delim_avx2,
+    .skip_digits = skip_digits_avx2,
+    .name = "avx2",
+};
+
+static const struct sol_json_scan_ops *
+scan_ops_get(const char *name)
+{
+    if (streq(name, "scalar"))
+        return &scan_ops_scalar;
+    if (streq(name, "sse2"))
+        return &scan_ops_sse2;
+
+    __builtin_cpu_init();
+    if (streq(name, "avx2") && __builtin_cpu_supports("avx2"))
+        return &scan_ops_avx2;
+
+    return NULL;
+}
+
+static const struct sol_json_scan_ops *
+scan_ops_select(void)
+{
+    /* SOL_JSON_SCAN=scalar|sse2|avx2 forces an implementation, mostly
+     * useful to compare them */
+    const char *cap = getenv("SOL_JSON_SCAN");
+    const struct sol_json_scan_ops *ops;
+
+    if (cap) {
+        ops = scan_ops_get(cap);
+        if (ops)
+            return ops;
+        SOL_WRN("Unsupported JSON scanner implementation '%s'", cap);
+    }
+
+    ops = scan_ops_get("avx2");
+    if (ops)
+        return ops;
+
+    return &scan_ops_sse2;
+}
+
+#else
+
+static const struct sol_json_scan_ops *
+scan_ops_get(const char *name)
+{
+    if (streq(name, "scalar"))
+        return &scan_ops_scalar;
+
+    return NULL;
+}
+
+static const struct sol_json_scan_ops *
+scan_ops_select(void)
+{
+    return &scan_ops_scalar;
+}
+
+#endif
+
+const struct sol_json_scan_ops *sol_json_scan_ops;
+
+const struct sol_json_scan_ops *
+sol_json_scan_ops_get(const char *name)
+{
+    return scan_ops_get(name);
+}
+
+const struct sol_json_scan_ops *
+sol_json_scan_ops_select(void)
+{
+    const struct sol_json_scan_ops *ops = scan_ops_select();
+
+    SOL_DBG("JSON scanner using %s implementation", ops->name);
+    return ops;
+}
@@ -0,0 +1,55 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "sol-macros.h"
+
+/* Byte-run scanners used by the JSON tokenizer. Every function takes
+ * the [p, end) range and returns the first position that does not
+ * belong to the run, or end. The implementation is picked at runtime
+ * from the best instruction set supported by the CPU (AVX2, SSE2 or
+ * plain C), see sol_json_scan_get_ops().
+ */
+struct sol_json_scan_ops {
+    /* skips ' ', '\t', '\n' and '\r' */
+    const char *(*skip_whitespace)(const char *p, const char *end);
+    /* stops at '"' or '\\' */
+    const char *(*find_string_delim)(const char *p, const char *end);
+    /* skips '0' to '9' */
+    const char *(*skip_digits)(const char *p, const char *end);
+    const char *name;
+};
+
+extern const struct sol_json_scan_ops *sol_json_scan_ops;
+
+const struct sol_json_scan_ops *sol_json_scan_ops_select(void);
+
+/* Returns the "scalar", "sse2" or "avx2" implementation, or NULL if
+ * it is unknown or not supported by the CPU. Assigning the result to
+ * sol_json_scan_ops lets tests run against every implementation. */
+const struct sol_json_scan_ops *sol_json_scan_ops_get(const char *name);
+
+static inline const struct sol_json_scan_ops *
+sol_json_scan_get_ops(void)
+{
+    /* racing threads all pick the same pointer, no need for a lock */
+    if (SOL_UNLIKELY(!sol_json_scan_ops))
+        sol_json_scan_ops = sol_json_scan_ops_select();
+    return sol_json_scan_ops;
+}
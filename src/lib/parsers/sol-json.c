@@ -32,6 +32,8 @@
 #include <float.h>
 #include <math.h>
 
+#include "sol-json-scan.h"
+
 static const char sol_json_escapable_chars[] = { '\\', '\"', '/', '\b', '\f', '\n', '\r', '\t' };
 
 static bool
@@ -60,32 +62,41 @@ check_symbol(struct sol_json_scanner *scanner, struct sol_json_token *token,
     return true;
 }
 
+static inline bool
+is_json_whitespace(char c)
+{
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
 static bool
-check_string(struct sol_json_scanner *scanner, struct sol_json_token *token)
+check_string(struct sol_json_scanner *scanner, struct sol_json_token *token,
+    const struct sol_json_scan_ops *ops)
 {
     static const char escapable_chars[] = { '"', '\\', '/', 'b', 'f', 'n', 'r', 't', 'u' };
-    bool escaped = false;
 
     token->start = scanner->current;
     for (scanner->current++; scanner->current < scanner->mem_end; scanner->current++) {
-        char c = scanner->current[0];
-        if (escaped) {
-            escaped = false;
-            if (!memchr(escapable_chars, c, sizeof(escapable_chars))) {
-                SOL_ERR("%u: cannot escape %#x (%c)",
-                    sol_json_scanner_get_mem_offset(scanner, scanner->current),
-                    scanner->current[0], scanner->current[0]);
-                token->start = NULL;
-                errno = EINVAL;
-                return false;
-            }
-        } else if (c == '\\') {
-            escaped = true;
-        } else if (c == '"') {
+        scanner->current = ops->find_string_delim(scanner->current, scanner->mem_end);
+        if (scanner->current == scanner->mem_end)
+            break;
+
+        if (scanner->current[0] == '"') {
             token->end = scanner->current + 1;
             scanner->current = token->end;
             return true;
         }
+
+        /* backslash, validate the escaped char */
+        if (++scanner->current == scanner->mem_end)
+            break;
+        if (!memchr(escapable_chars, scanner->current[0], sizeof(escapable_chars))) {
+            SOL_ERR("%u: cannot escape %#x (%c)",
+                sol_json_scanner_get_mem_offset(scanner, scanner->current),
+                scanner->current[0], scanner->current[0]);
+            token->start = NULL;
+            errno = EINVAL;
+            return false;
+        }
     }
     SOL_ERR("%u: unfinished string.", sol_json_scanner_get_mem_offset(scanner, scanner->current));
     token->start = NULL;
@@ -93,21 +104,35 @@ check_string(struct sol_json_scanner *scanner, struct sol_json_token *token)
     return false;
 }
 
+static inline const char *
+skip_digits(const struct sol_json_scan_ops *ops, const char *p, const char *end)
+{
+    const char *short_end = end - p > 8 ? p + 8 : end;
+
+    /* most numbers are short, only long runs are worth a vector scan */
+    while (p < short_end && *p >= '0' && *p <= '9')
+        p++;
+    if (p == short_end && p < end)
+        return ops->skip_digits(p, end);
+    return p;
+}
+
 static bool
-check_number(struct sol_json_scanner *scanner, struct sol_json_token *token)
+check_number(struct sol_json_scanner *scanner, struct sol_json_token *token,
+    const struct sol_json_scan_ops *ops)
 {
     const char *frac = NULL;
     const char *exp = NULL;
 
     token->start = scanner->current;
     for (scanner->current++; scanner->current < scanner->mem_end; scanner->current++) {
-        char c = scanner->current[0];
-        if (c >= '0' && c <= '9')
-            continue;
+        char c;
 
-        if (exp)
+        scanner->current = skip_digits(ops, scanner->current, scanner->mem_end);
+        if (scanner->current == scanner->mem_end || exp)
             break;
 
+        c = scanner->current[0];
         if (c == 'e' || c == 'E') {
             if (scanner->current + 1 < scanner->mem_end) {
                 c = scanner->current[1];
@@ -432,11 +457,21 @@ sol_json_token_get_double(const struct sol_json_token *token, double *value)
 SOL_API bool
 sol_json_scanner_next(struct sol_json_scanner *scanner, struct sol_json_token *token)
 {
+    const struct sol_json_scan_ops *ops = sol_json_scan_get_ops();
+
     token->start = NULL;
     token->end = NULL;
 
     for (; scanner->current < scanner->mem_end; scanner->current++) {
-        enum sol_json_type type = sol_json_mem_get_type(scanner->current);
+        enum sol_json_type type;
+
+        if (is_json_whitespace(scanner->current[0])) {
+            scanner->current = ops->skip_whitespace(scanner->current, scanner->mem_end);
+            if (scanner->current == scanner->mem_end)
+                break;
+        }
+
+        type = sol_json_mem_get_type(scanner->current);
         switch (type) {
         case SOL_JSON_TYPE_UNKNOWN:
             if (!isspace((uint8_t)scanner->current[0])) {
@@ -469,10 +504,10 @@ sol_json_scanner_next(struct sol_json_scanner *scanner, struct sol_json_token *t
             return check_symbol(scanner, token, "null", sizeof("null") - 1);
 
         case SOL_JSON_TYPE_STRING:
-            return check_string(scanner, token);
+            return check_string(scanner, token, ops);
 
         case SOL_JSON_TYPE_NUMBER:
-            return check_number(scanner, token);
+            return check_number(scanner, token, ops);
         }
     }
 
@@ -811,13 +846,21 @@ sol_json_token_get_unescaped_string(const struct sol_json_token *token, struct s
         goto invalid_json_string;
 
     for (start = p = token->start + 1; p < token->end - 1; p++) {
-        if (!is_escaped && *p == '\\') {
-            struct sol_str_slice slice = { .data = start, .len = p - start };
+        if (!is_escaped) {
+            struct sol_str_slice slice;
 
+            /* jump over the whole unescaped run at once */
+            p = memchr(p, '\\', token->end - 1 - p);
+            if (!p) {
+                p = token->end - 1;
+                break;
+            }
+
+            slice = SOL_STR_SLICE_STR(start, p - start);
             r = sol_buffer_append_slice(buffer, slice);
             SOL_INT_CHECK_GOTO(r, < 0, error);
             is_escaped = true;
-        } else if (is_escaped) {
+        } else {
             is_escaped = false;
             start = p + 1;
             switch (*p) {
@@ -1011,6 +1054,13 @@ sol_json_get_value_by_path(struct sol_json_scanner *scanner, struct sol_str_slic
     SOL_NULL_CHECK(path.data, -EINVAL);
     SOL_NULL_CHECK(value, -EINVAL);
 
+    /* Resolve the root the same way sol_json_scanner_next() and the
+     * index do, so that leading whitespace is not mistaken for it */
+    scanner->current = sol_json_scan_get_ops()->skip_whitespace(
+        scanner->current, scanner->mem_end);
+    if (scanner->current == scanner->mem_end)
+        return -ENOENT;
+
     sol_json_path_scanner_init(&path_scanner, path);
     start = scanner->current;
 
@@ -1114,3 +1164,469 @@ sol_json_path_array_get_segment_index(struct sol_str_slice key)
 
     return index_val;
 }
+
+#define JSON_INDEX_NONE UINT32_MAX
+
+struct sol_json_index_node {
+    uint32_t start; /* offset of the value */
+    uint32_t end; /* offset one past the value */
+    uint32_t key_start; /* offset of the key token, object members only */
+    uint32_t key_end;
+    uint32_t key_hash;
+    uint32_t parent;
+    uint32_t first; /* containers: first member slot in index->members */
+    uint32_t count; /* containers: number of members */
+};
+
+struct sol_json_index {
+    const char *mem;
+    struct sol_json_index_node *nodes;
+    uint32_t *members;
+    uint32_t len;
+    uint32_t capacity;
+};
+
+enum json_index_expect {
+    JSON_INDEX_EXPECT_VALUE,
+    JSON_INDEX_EXPECT_VALUE_OR_END,
+    JSON_INDEX_EXPECT_KEY,
+    JSON_INDEX_EXPECT_KEY_OR_END,
+    JSON_INDEX_EXPECT_PAIR_SEP,
+    JSON_INDEX_EXPECT_SEP_OR_END,
+    JSON_INDEX_EXPECT_NOTHING,
+};
+
+/* FNV-1a, over the raw (still escaped) key bytes */
+static uint32_t
+json_index_hash(const char *str, size_t len)
+{
+    uint32_t hash = 2166136261u;
+    const char *end = str + len;
+
+    for (; str < end; str++) {
+        hash ^= (uint8_t)*str;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+static inline enum sol_json_type
+json_index_node_get_type(const struct sol_json_index *index,
+    const struct sol_json_index_node *node)
+{
+    return sol_json_mem_get_type(index->mem + node->start);
+}
+
+static inline void
+json_index_node_to_token(const struct sol_json_index *index,
+    const struct sol_json_index_node *node, struct sol_json_token *value)
+{
+    value->start = index->mem + node->start;
+    value->end = index->mem + node->end;
+}
+
+static struct sol_json_index_node *
+json_index_node_append(struct sol_json_index *index)
+{
+    struct sol_json_index_node *node;
+
+    if (index->len == index->capacity) {
+        uint32_t capacity = index->capacity ? index->capacity * 2 : 16;
+        size_t total;
+
+        if (capacity < index->capacity ||
+            sol_util_size_mul(capacity, sizeof(*node), &total) < 0) {
+            errno = EOVERFLOW;
+            return NULL;
+        }
+
+        node = realloc(index->nodes, total);
+        if (!node) {
+            errno = ENOMEM;
+            return NULL;
+        }
+        index->nodes = node;
+        index->capacity = capacity;
+    }
+
+    node = index->nodes + index->len++;
+    memset(node, 0, sizeof(*node));
+    return node;
+}
+
+static int
+json_index_link_members(struct sol_json_index *index)
+{
+    uint32_t i, slot = 0;
+
+    if (index->len < 2)
+        return 0;
+
+    index->members = calloc(index->len - 1, sizeof(*index->members));
+    SOL_NULL_CHECK(index->members, -ENOMEM);
+
+    /* Members of a container are laid out contiguously, in document
+     * order, so arrays are indexed directly and objects are walked by
+     * key hash without touching nested values. */
+    for (i = 0; i < index->len; i++) {
+        struct sol_json_index_node *node = index->nodes + i;
+
+        if (!node->count)
+            continue;
+        node->first = slot;
+        slot += node->count;
+        node->count = 0;
+    }
+
+    for (i = 1; i < index->len; i++) {
+        struct sol_json_index_node *parent;
+
+        parent = index->nodes + index->nodes[i].parent;
+        index->members[parent->first + parent->count++] = i;
+    }
+
+    return 0;
+}
+
+SOL_API struct sol_json_index *
+sol_json_index_new(const void *mem, size_t size)
+{
+    enum json_index_expect expect = JSON_INDEX_EXPECT_VALUE;
+    struct sol_json_token token, key = { NULL, NULL };
+    struct sol_json_index_node *node;
+    struct sol_json_scanner scanner;
+    struct sol_json_index *index;
+    uint32_t parent = JSON_INDEX_NONE;
+    enum sol_json_type type;
+    int r;
+
+    if (!mem) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    if (size >= UINT32_MAX) {
+        errno = EOVERFLOW;
+        return NULL;
+    }
+
+    index = calloc(1, sizeof(*index));
+    if (!index) {
+        errno = ENOMEM;
+        return NULL;
+    }
+    index->mem = mem;
+
+    sol_json_scanner_init(&scanner, mem, size);
+    while (sol_json_scanner_next(&scanner, &token)) {
+        type = sol_json_token_get_type(&token);
+        switch (type) {
+        case SOL_JSON_TYPE_STRING:
+            if (expect == JSON_INDEX_EXPECT_KEY ||
+                expect == JSON_INDEX_EXPECT_KEY_OR_END) {
+                key = token;
+                expect = JSON_INDEX_EXPECT_PAIR_SEP;
+                break;
+            }
+        /* fall through */
+        case SOL_JSON_TYPE_OBJECT_START:
+        case SOL_JSON_TYPE_ARRAY_START:
+        case SOL_JSON_TYPE_TRUE:
+        case SOL_JSON_TYPE_FALSE:
+        case SOL_JSON_TYPE_NULL:
+        case SOL_JSON_TYPE_NUMBER:
+            if (expect != JSON_INDEX_EXPECT_VALUE &&
+                expect != JSON_INDEX_EXPECT_VALUE_OR_END)
+                goto invalid;
+
+            node = json_index_node_append(index);
+            SOL_NULL_CHECK_GOTO(node, error);
+            node->start = token.start - (const char *)mem;
+            node->end = token.end - (const char *)mem;
+            node->parent = parent;
+
+            if (parent != JSON_INDEX_NONE) {
+                struct sol_json_index_node *p = index->nodes + parent;
+
+                p->count++;
+                if (json_index_node_get_type(index, p) ==
+                    SOL_JSON_TYPE_OBJECT_START) {
+                    node->key_start = key.start - (const char *)mem;
+                    node->key_end = key.end - (const char *)mem;
+                    node->key_hash = json_index_hash(key.start + 1,
+                        sol_json_token_get_size(&key) - 2);
+                }
+            }
+
+            if (type == SOL_JSON_TYPE_OBJECT_START) {
+                parent = index->len - 1;
+                expect = JSON_INDEX_EXPECT_KEY_OR_END;
+            } else if (type == SOL_JSON_TYPE_ARRAY_START) {
+                parent = index->len - 1;
+                expect = JSON_INDEX_EXPECT_VALUE_OR_END;
+            } else if (parent == JSON_INDEX_NONE)
+                expect = JSON_INDEX_EXPECT_NOTHING;
+            else
+                expect = JSON_INDEX_EXPECT_SEP_OR_END;
+            break;
+        case SOL_JSON_TYPE_PAIR_SEP:
+            if (expect != JSON_INDEX_EXPECT_PAIR_SEP)
+                goto invalid;
+            expect = JSON_INDEX_EXPECT_VALUE;
+            break;
+        case SOL_JSON_TYPE_ELEMENT_SEP:
+            if (expect != JSON_INDEX_EXPECT_SEP_OR_END)
+                goto invalid;
+            if (json_index_node_get_type(index, index->nodes + parent) ==
+                SOL_JSON_TYPE_OBJECT_START)
+                expect = JSON_INDEX_EXPECT_KEY;
+            else
+                expect = JSON_INDEX_EXPECT_VALUE;
+            break;
+        case SOL_JSON_TYPE_OBJECT_END:
+        case SOL_JSON_TYPE_ARRAY_END:
+            if (parent == JSON_INDEX_NONE)
+                goto invalid;
+
+            node = index->nodes + parent;
+            if (type == SOL_JSON_TYPE_OBJECT_END) {
+                if (json_index_node_get_type(index, node) !=
+                    SOL_JSON_TYPE_OBJECT_START)
+                    goto invalid;
+                if (expect != JSON_INDEX_EXPECT_SEP_OR_END &&
+                    expect != JSON_INDEX_EXPECT_KEY_OR_END)
+                    goto invalid;
+            } else {
+                if (json_index_node_get_type(index, node) !=
+                    SOL_JSON_TYPE_ARRAY_START)
+                    goto invalid;
+                if (expect != JSON_INDEX_EXPECT_SEP_OR_END &&
+                    expect != JSON_INDEX_EXPECT_VALUE_OR_END)
+                    goto invalid;
+            }
+
+            node->end = token.end - (const char *)mem;
+            parent = node->parent;
+            if (parent == JSON_INDEX_NONE)
+                expect = JSON_INDEX_EXPECT_NOTHING;
+            else
+                expect = JSON_INDEX_EXPECT_SEP_OR_END;
+            break;
+        default:
+            goto invalid;
+        }
+    }
+
+    if (errno != 0 || expect != JSON_INDEX_EXPECT_NOTHING)
+        goto invalid;
+
+    r = json_index_link_members(index);
+    if (r < 0) {
+        errno = -r;
+        goto error;
+    }
+
+    return index;
+
+invalid:
+    errno = EINVAL;
+error:
+    r = errno;
+    sol_json_index_del(index);
+    errno = r;
+    return NULL;
+}
+
+SOL_API void
+sol_json_index_del(struct sol_json_index *index)
+{
+    if (!index)
+        return;
+
+    free(index->members);
+    free(index->nodes);
+    free(index);
+}
+
+static bool
+json_index_node_is_container(const struct sol_json_index *index,
+    const struct sol_json_index_node *node)
+{
+    enum sol_json_type type = json_index_node_get_type(index, node);
+
+    return type == SOL_JSON_TYPE_OBJECT_START ||
+           type == SOL_JSON_TYPE_ARRAY_START;
+}
+
+static const struct sol_json_index_node *
+json_index_node_get_by_key(const struct sol_json_index *index,
+    const struct sol_json_index_node *object, const struct sol_str_slice key)
+{
+    const uint32_t *itr, *end;
+    uint32_t hash;
+
+    hash = json_index_hash(key.data, key.len);
+    itr = index->members + object->first;
+    end = itr + object->count;
+    for (; itr < end; itr++) {
+        const struct sol_json_index_node *node = index->nodes + *itr;
+
+        if (node->key_hash == hash &&
+            node->key_end - node->key_start == key.len + 2 &&
+            memcmp(index->mem + node->key_start + 1, key.data, key.len) == 0)
+            return node;
+    }
+
+    return NULL;
+}
+
+static const struct sol_json_index_node *
+json_index_node_get_at(const struct sol_json_index *index,
+    const struct sol_json_index_node *array, uint32_t i)
+{
+    if (i >= array->count)
+        return NULL;
+    return index->nodes + index->members[array->first + i];
+}
+
+SOL_API uint32_t
+sol_json_index_get_member_count(const struct sol_json_index *index)
+{
+    SOL_NULL_CHECK(index, 0);
+
+    if (!json_index_node_is_container(index, index->nodes))
+        return 0;
+    return index->nodes->count;
+}
+
+SOL_API int
+sol_json_index_get_member(const struct sol_json_index *index, uint32_t i,
+    struct sol_json_token *key, struct sol_json_token *value)
+{
+    const struct sol_json_index_node *node;
+
+    SOL_NULL_CHECK(index, -EINVAL);
+    SOL_NULL_CHECK(value, -EINVAL);
+
+    if (!json_index_node_is_container(index, index->nodes))
+        return -EINVAL;
+
+    node = json_index_node_get_at(index, index->nodes, i);
+    if (!node)
+        return -ENOENT;
+
+    if (key) {
+        if (json_index_node_get_type(index, index->nodes) ==
+            SOL_JSON_TYPE_OBJECT_START) {
+            key->start = index->mem + node->key_start;
+            key->end = index->mem + node->key_end;
+        } else {
+            key->start = NULL;
+            key->end = NULL;
+        }
+    }
+
+    json_index_node_to_token(index, node, value);
+    return 0;
+}
+
+SOL_API int
+sol_json_index_object_get_value_by_key(const struct sol_json_index *index,
+    const struct sol_str_slice key_slice, struct sol_json_token *value)
+{
+    const struct sol_json_index_node *node;
+
+    SOL_NULL_CHECK(index, -EINVAL);
+    SOL_NULL_CHECK(key_slice.data, -EINVAL);
+    SOL_NULL_CHECK(value, -EINVAL);
+
+    if (json_index_node_get_type(index, index->nodes) !=
+        SOL_JSON_TYPE_OBJECT_START)
+        return -EINVAL;
+
+    node = json_index_node_get_by_key(index, index->nodes, key_slice);
+    if (!node)
+        return -ENOENT;
+
+    json_index_node_to_token(index, node, value);
+    return 0;
+}
+
+SOL_API int
+sol_json_index_array_get_at_index(const struct sol_json_index *index,
+    uint16_t i, struct sol_json_token *value)
+{
+    const struct sol_json_index_node *node;
+
+    SOL_NULL_CHECK(index, -EINVAL);
+    SOL_NULL_CHECK(value, -EINVAL);
+
+    if (json_index_node_get_type(index, index->nodes) !=
+        SOL_JSON_TYPE_ARRAY_START)
+        return -EINVAL;
+
+    node = json_index_node_get_at(index, index->nodes, i);
+    if (!node)
+        return -ENOENT;
+
+    json_index_node_to_token(index, node, value);
+    return 0;
+}
+
+SOL_API int
+sol_json_index_get_value_by_path(const struct sol_json_index *index,
+    struct sol_str_slice path, struct sol_json_token *value)
+{
+    const struct sol_json_index_node *node;
+    struct sol_str_slice key_slice = SOL_STR_SLICE_EMPTY;
+    struct sol_json_path_scanner path_scanner;
+    enum sol_json_loop_reason reason;
+    struct sol_buffer current_key;
+    int32_t index_val;
+    int r;
+
+    SOL_NULL_CHECK(index, -EINVAL);
+    SOL_NULL_CHECK(path.data, -EINVAL);
+    SOL_NULL_CHECK(value, -EINVAL);
+
+    node = index->nodes;
+    if (!json_index_node_is_container(index, node))
+        return -EINVAL;
+
+    sol_json_path_scanner_init(&path_scanner, path);
+    SOL_JSON_PATH_FOREACH(path_scanner, key_slice, reason) {
+        switch (json_index_node_get_type(index, node)) {
+        case SOL_JSON_TYPE_OBJECT_START:
+            if (sol_json_path_is_array_key(key_slice))
+                return -ENOENT;
+
+            r = json_path_parse_object_key(key_slice, &current_key);
+            SOL_INT_CHECK(r, < 0, r);
+
+            node = json_index_node_get_by_key(index, node,
+                sol_buffer_get_slice(&current_key));
+            sol_buffer_fini(&current_key);
+            break;
+        case SOL_JSON_TYPE_ARRAY_START:
+            if (!sol_json_path_is_array_key(key_slice))
+                return -ENOENT;
+
+            index_val = sol_json_path_array_get_segment_index(key_slice);
+            SOL_INT_CHECK(index_val, < 0, -ENOENT);
+
+            node = json_index_node_get_at(index, node, index_val);
+            break;
+        default:
+            return -ENOENT;
+        }
+
+        if (!node)
+            return -ENOENT;
+    }
+    if (reason != SOL_JSON_LOOP_REASON_OK)
+        return -ENOENT;
+
+    json_index_node_to_token(index, node, value);
+    return 0;
+}
@@ -576,7 +576,7 @@ setup_description(struct http_composed_client_type *type)
     SOL_NULL_CHECK_GOTO(desc->ports_in, fail_ports_in);
 
     p = (struct sol_flow_port_description **)desc->ports_in;
-    for (i = 0; i < type->ports_in.len; i++) {
+    for (i = 0; i < (int)type->ports_in.len; i++) {
         p[i] = calloc(1, sizeof(struct sol_flow_port_description));
         SOL_NULL_CHECK_GOTO(p[i], fail_ports_in_desc);
 
@@ -595,7 +595,7 @@ setup_description(struct http_composed_client_type *type)
     SOL_NULL_CHECK_GOTO(desc->ports_out, fail_ports_in_desc);
 
     p = (struct sol_flow_port_description **)desc->ports_out;
-    for (j = 0; j < type->ports_out.len; j++) {
+    for (j = 0; j < (int)type->ports_out.len; j++) {
         p[j] = calloc(1, sizeof(struct sol_flow_port_description));
         SOL_NULL_CHECK_GOTO(p[j], fail_ports_out_desc);
 
@@ -634,7 +634,7 @@ static void
 free_description(struct http_composed_client_type *type)
 {
     struct sol_flow_node_type_description *desc;
-    uint16_t i;
+    uint32_t i;
 
     desc = (struct sol_flow_node_type_description *)type->base.description;
 
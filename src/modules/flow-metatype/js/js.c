@@ -1376,7 +1376,7 @@ setup_description(struct flow_js_type *type)
     SOL_NULL_CHECK_GOTO(desc->ports_in, fail_ports_in);
 
     p = (struct sol_flow_port_description **)desc->ports_in;
-    for (i = 0; i < type->ports_in.len; i++) {
+    for (i = 0; i < (int)type->ports_in.len; i++) {
         p[i] = calloc(1, sizeof(struct sol_flow_port_description));
         SOL_NULL_CHECK_GOTO(p[i], fail_ports_in_desc);
 
@@ -1395,7 +1395,7 @@ setup_description(struct flow_js_type *type)
     SOL_NULL_CHECK_GOTO(desc->ports_out, fail_ports_in_desc);
 
     p = (struct sol_flow_port_description **)desc->ports_out;
-    for (j = 0; j < type->ports_out.len; j++) {
+    for (j = 0; j < (int)type->ports_out.len; j++) {
         p[j] = calloc(1, sizeof(struct sol_flow_port_description));
         SOL_NULL_CHECK_GOTO(p[j], fail_ports_out_desc);
 
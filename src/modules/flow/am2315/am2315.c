@@ -77,7 +77,8 @@ am2315_open(uint8_t bus, uint8_t slave)
 {
     struct am2315 *device;
     struct sol_i2c *i2c;
-    int i;
+    uint32_t i;
+    int r;
 
     /* Is the requested device already open? */
     SOL_PTR_VECTOR_FOREACH_IDX (&devices, device, i) {
@@ -98,8 +99,8 @@ am2315_open(uint8_t bus, uint8_t slave)
     device->slave = slave;
     device->refcount++;
 
-    i = sol_ptr_vector_append(&devices, device);
-    SOL_INT_CHECK_GOTO(i, < 0, fail_append);
+    r = sol_ptr_vector_append(&devices, device);
+    SOL_INT_CHECK_GOTO(r, < 0, fail_append);
 
     return device;
 
@@ -115,7 +116,7 @@ void
 am2315_close(struct am2315 *device)
 {
     struct am2315 *itr;
-    int i;
+    uint32_t i;
 
     device->refcount--;
     if (device->refcount) return;
@@ -815,7 +815,7 @@ drange_to_string_convert(struct sol_flow_node *node, void *data, uint16_t port,
     int r;
     struct sol_drange in_value;
     struct string_converter *mdata = data;
-    struct sol_buffer out = SOL_BUFFER_INIT_EMPTY;
+    SOL_BUFFER_DECLARE_INLINE(out, 64);
 
     mdata->node = node;
 
@@ -872,7 +872,7 @@ irange_to_string_convert(struct sol_flow_node *node,
     int r;
     struct sol_irange in_value;
     struct string_converter *mdata = data;
-    struct sol_buffer out = SOL_BUFFER_INIT_EMPTY;
+    SOL_BUFFER_DECLARE_INLINE(out, 64);
 
     mdata->node = node;
 
@@ -951,7 +951,7 @@ int32_format_append_do(struct sol_flow_node *node,
     struct sol_buffer *out)
 {
     int r = -EINVAL;
-    struct sol_buffer digits = SOL_BUFFER_INIT_EMPTY;
+    SOL_BUFFER_DECLARE_INLINE(digits, 64);
     ssize_t inumeric_chars;
     char sign_char = '\0';
     ssize_t n_digits;
@@ -1587,8 +1587,8 @@ float_format_append_do(struct sol_flow_node *node,
     const struct format_spec_data *format,
     struct sol_buffer *out)
 {
-    struct sol_buffer digits = SOL_BUFFER_INIT_EMPTY;
-    struct sol_buffer tmp = SOL_BUFFER_INIT_EMPTY;
+    SOL_BUFFER_DECLARE_INLINE(digits, 64);
+    SOL_BUFFER_DECLARE_INLINE(tmp, 64);
     int precision, default_precision = 6;
     struct number_field_widths spec;
     char type = format->type;
@@ -1496,8 +1496,9 @@ translate_http_method(const char *method)
         SOL_STR_TABLE_ITEM("PATCH", SOL_HTTP_METHOD_PATCH),
         { }
     };
+    SOL_STR_TABLE_HASH_DECLARE(http_methods_hash, http_methods);
 
-    return sol_str_table_lookup_fallback(http_methods,
+    return sol_str_table_hash_lookup_fallback(&http_methods_hash,
         sol_str_slice_from_str(method), SOL_HTTP_METHOD_INVALID);
 }
 
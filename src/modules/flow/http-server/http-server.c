@@ -37,9 +37,15 @@
 #define HTTP_HEADER_CONTENT_TYPE "Content-Type"
 #define HTTP_HEADER_CONTENT_TYPE_TEXT "text/plain"
 #define HTTP_HEADER_CONTENT_TYPE_JSON "application/json"
+#define HTTP_HEADER_CONTENT_TYPE_SSE "text/event-stream"
+#define HTTP_HEADER_CACHE_CONTROL "Cache-Control"
 
 #define DOUBLE_STRING_LEN 64
 
+/* Maximum amount of bytes queued for each event stream client. Updates
+ * are dropped for clients that don't keep up. */
+#define SSE_FEED_SIZE 4096
+
 struct server_data {
     struct sol_http_server *server;
     int port;
@@ -57,6 +63,7 @@ struct http_data {
     } value;
 
     struct server_data *sdata;
+    struct sol_ptr_vector sse_clients;
     char *path;
     char *basename;
     uint8_t allowed_methods;
@@ -200,12 +207,157 @@ server_unref(struct server_data *sdata)
     servers_clear();
 }
 
+static void
+sse_client_close_cb(void *data, const struct sol_http_progressive_response *progressive)
+{
+    struct http_data *mdata = data;
+
+    sol_ptr_vector_remove(&mdata->sse_clients, progressive);
+}
+
+/* Serializes the current value, framed as an event */
+static struct sol_blob *
+sse_event_new(struct http_data *mdata, const struct http_server_node_type *type)
+{
+    int r;
+    void *mem;
+    size_t len;
+    struct sol_blob *blob, *event;
+    struct sol_buffer buf = SOL_BUFFER_INIT_EMPTY;
+
+    r = type->response_cb(mdata, &buf, false);
+    SOL_INT_CHECK_GOTO(r, < 0, err);
+
+    mem = sol_buffer_steal(&buf, &len);
+    blob = sol_blob_new(SOL_BLOB_TYPE_DEFAULT, NULL, mem, len);
+    if (!blob) {
+        free(mem);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    event = sol_http_progressive_response_sse_frame(blob);
+    sol_blob_unref(blob);
+    return event;
+
+err:
+    sol_buffer_fini(&buf);
+    errno = -r;
+    return NULL;
+}
+
+static void
+sse_clients_notify(struct http_data *mdata, const struct http_server_node_type *type)
+{
+    int r;
+    uint32_t i;
+    struct sol_blob *blob;
+    struct sol_http_progressive_response *progressive;
+
+    if (!sol_ptr_vector_get_len(&mdata->sse_clients))
+        return;
+
+    /* The event is serialized and framed once, the same blob is queued
+     * for every client */
+    blob = sse_event_new(mdata, type);
+    SOL_NULL_CHECK(blob);
+
+    SOL_PTR_VECTOR_FOREACH_REVERSE_IDX (&mdata->sse_clients, progressive, i) {
+        r = sol_http_progressive_response_feed(progressive, blob);
+        if (r == -ENOSPC) {
+            SOL_DBG("Event stream client of %s is not keeping up, dropping update",
+                mdata->path);
+        } else if (r < 0) {
+            SOL_WRN("Could not feed event stream client of %s: %s",
+                mdata->path, sol_util_strerrora(-r));
+            sol_ptr_vector_del(&mdata->sse_clients, i);
+            sol_http_progressive_response_del(progressive, false);
+        }
+    }
+
+    sol_blob_unref(blob);
+}
+
+static void
+sse_clients_clear(struct http_data *mdata)
+{
+    uint32_t i;
+    struct sol_http_progressive_response *progressive;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&mdata->sse_clients, progressive, i)
+        sol_http_progressive_response_del(progressive, false);
+    sol_ptr_vector_clear(&mdata->sse_clients);
+}
+
+static int
+sse_client_add(struct http_data *mdata, const struct http_server_node_type *type,
+    struct sol_http_request *request, bool *owned)
+{
+    int r;
+    struct sol_blob *blob;
+    struct sol_http_progressive_response *progressive;
+    struct sol_http_response response = {
+        SOL_SET_API_VERSION(.api_version = SOL_HTTP_RESPONSE_API_VERSION, )
+        .content = SOL_BUFFER_INIT_EMPTY,
+        .param = SOL_HTTP_REQUEST_PARAMS_INIT,
+        .response_code = SOL_HTTP_STATUS_OK
+    };
+    struct sol_http_server_progressive_config config = {
+        SOL_SET_API_VERSION(.api_version = SOL_HTTP_SERVER_PROGRESSIVE_CONFIG_API_VERSION, )
+        .on_close = sse_client_close_cb,
+        .user_data = mdata,
+        .feed_size = SSE_FEED_SIZE
+    };
+
+    response.url = sol_http_request_get_url(request);
+    *owned = false;
+
+    r = -ENOMEM;
+    if (!sol_http_param_add(&response.param, SOL_HTTP_REQUEST_PARAM_HEADER(
+        HTTP_HEADER_CONTENT_TYPE, HTTP_HEADER_CONTENT_TYPE_SSE)) ||
+        !sol_http_param_add(&response.param, SOL_HTTP_REQUEST_PARAM_HEADER(
+        HTTP_HEADER_CACHE_CONTROL, "no-cache")))
+        goto end;
+
+    progressive = sol_http_server_send_progressive_response(request,
+        &response, &config);
+    SOL_NULL_CHECK_GOTO(progressive, end);
+
+    /* The connection now belongs to the progressive response: deleting
+     * it closes the stream, so no other reply may be sent */
+    *owned = true;
+
+    r = sol_ptr_vector_append(&mdata->sse_clients, progressive);
+    if (r < 0) {
+        sol_http_progressive_response_del(progressive, false);
+        goto end;
+    }
+
+    /* Clients start with the current value */
+    blob = sse_event_new(mdata, type);
+    if (!blob) {
+        r = -errno;
+    } else {
+        r = sol_http_progressive_response_feed(progressive, blob);
+        sol_blob_unref(blob);
+    }
+
+    if (r < 0) {
+        sol_ptr_vector_remove(&mdata->sse_clients, progressive);
+        sol_http_progressive_response_del(progressive, false);
+    }
+
+end:
+    sol_http_params_clear(&response.param);
+    return r;
+}
+
 static int
 common_response_cb(void *data, struct sol_http_request *request)
 {
     int r = 0;
     uint16_t idx;
-    bool send_json = false, updated = false;
+    bool send_json = false, updated = false, owned;
     enum sol_http_method method;
     struct sol_flow_node *node = data;
     struct http_data *mdata = sol_flow_node_get_private_data(node);
@@ -233,6 +385,23 @@ common_response_cb(void *data, struct sol_http_request *request)
         return 0;
     }
 
+    if (method == SOL_HTTP_METHOD_GET) {
+        SOL_HTTP_PARAMS_FOREACH_IDX (sol_http_request_get_params(request), value, idx) {
+            if (value->type != SOL_HTTP_PARAM_HEADER ||
+                !sol_str_slice_str_caseeq(value->value.key_value.key, HTTP_HEADER_ACCEPT) ||
+                !sol_str_slice_str_contains(value->value.key_value.value, HTTP_HEADER_CONTENT_TYPE_SSE))
+                continue;
+
+            r = sse_client_add(mdata, type, request, &owned);
+            if (!owned)
+                goto end;
+            if (r < 0)
+                sol_flow_send_error_packet(node, -r,
+                    "Could not start the event stream for %s", mdata->path);
+            return 0;
+        }
+    }
+
     SOL_HTTP_PARAMS_FOREACH_IDX (sol_http_request_get_params(request), value, idx) {
         switch (value->type) {
         case SOL_HTTP_PARAM_POST_FIELD:
@@ -286,8 +455,11 @@ common_response_cb(void *data, struct sol_http_request *request)
     response.response_code = SOL_HTTP_STATUS_INTERNAL_SERVER_ERROR;
     SOL_INT_CHECK_GOTO(r, < 0, end);
 
-    if ((method == SOL_HTTP_METHOD_POST) && type->send_packet_cb && updated)
-        type->send_packet_cb(mdata, node);
+    if ((method == SOL_HTTP_METHOD_POST) && updated) {
+        sse_clients_notify(mdata, type);
+        if (type->send_packet_cb)
+            type->send_packet_cb(mdata, node);
+    }
 
 end:
     if (r < 0) {
@@ -319,6 +491,8 @@ start_server(struct http_data *http, struct sol_flow_node *node,
 {
     int r = -ENOMEM;
 
+    sol_ptr_vector_init(&http->sse_clients);
+
     http->sdata = server_ref(opt_port);
     SOL_NULL_CHECK(http->sdata, r);
 
@@ -345,6 +519,7 @@ err_path:
 static void
 stop_server(struct http_data *http)
 {
+    sse_clients_clear(http);
     sol_http_server_unregister_handler(http->sdata->server, http->path);
     free(http->path);
     server_unref(http->sdata);
@@ -495,6 +670,8 @@ common_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t c
         mdata->path, time(NULL));
     SOL_INT_CHECK(r, < 0, r);
 
+    sse_clients_notify(mdata, type);
+
     if (type->send_packet_cb)
         type->send_packet_cb(mdata, node);
 
@@ -25,6 +25,44 @@
 
 #include <sol-iio.h>
 
+/* Sends all scans of a batched reading as a single blob of doubles,
+ * every sample of first channel, then every sample of the next one */
+static int
+send_samples_packet(struct sol_flow_node *node, uint16_t port,
+    struct sol_iio_channel **channels, size_t n_channels)
+{
+    struct sol_blob *blob;
+    const double *samples;
+    unsigned int count;
+    double *mem = NULL;
+    size_t i;
+    int r;
+
+    for (i = 0; i < n_channels; i++) {
+        samples = sol_iio_read_channel_samples(channels[i], &count);
+        SOL_NULL_CHECK_GOTO(samples, error);
+
+        if (!mem) {
+            mem = malloc(sizeof(double) * count * n_channels);
+            SOL_NULL_CHECK(mem, -ENOMEM);
+        }
+        memcpy(mem + i * count, samples, sizeof(double) * count);
+    }
+
+    blob = sol_blob_new(SOL_BLOB_TYPE_DEFAULT, NULL, mem,
+        sizeof(double) * count * n_channels);
+    SOL_NULL_CHECK_GOTO(blob, error);
+
+    r = sol_flow_send_blob_packet(node, port, blob);
+    sol_blob_unref(blob);
+
+    return r;
+
+error:
+    free(mem);
+    return -EIO;
+}
+
 struct gyroscope_data {
     struct sol_iio_config config;
     struct sol_direction_vector scale;
@@ -34,6 +72,7 @@ struct gyroscope_data {
     struct sol_iio_channel *channel_x;
     struct sol_iio_channel *channel_y;
     struct sol_iio_channel *channel_z;
+    unsigned int batch_size;
     bool buffer_enabled : 1;
     bool use_device_default_scale : 1;
     bool use_device_default_offset : 1;
@@ -63,6 +102,16 @@ reader_cb(void *data, struct sol_iio_device *device)
     sol_flow_send_direction_vector_packet(node,
         SOL_FLOW_NODE_TYPE_IIO_GYROSCOPE__OUT__OUT, &out);
 
+    if (mdata->batch_size > 1) {
+        struct sol_iio_channel *channels[] = {
+            mdata->channel_x, mdata->channel_y, mdata->channel_z
+        };
+
+        if (send_samples_packet(node, SOL_FLOW_NODE_TYPE_IIO_GYROSCOPE__OUT__BATCH,
+            channels, SOL_UTIL_ARRAY_SIZE(channels)) < 0)
+            goto error;
+    }
+
     return;
 
 error:
@@ -124,6 +173,12 @@ gyroscope_open(struct sol_flow_node *node, void *data, const struct sol_flow_nod
 
     mdata->config.buffer_size = opts->buffer_size;
     mdata->config.sampling_frequency = opts->sampling_frequency;
+    if (opts->batch_size < 0) {
+        SOL_WRN("Invalid batch_size %" PRId32, opts->batch_size);
+        goto err;
+    }
+    mdata->config.batch_size = opts->batch_size;
+    mdata->batch_size = opts->batch_size;
 
     if (mdata->buffer_enabled) {
         mdata->config.sol_iio_reader_cb = reader_cb;
@@ -796,6 +851,7 @@ struct accelerate_data {
     struct sol_iio_channel *channel_x;
     struct sol_iio_channel *channel_y;
     struct sol_iio_channel *channel_z;
+    unsigned int batch_size;
     bool buffer_enabled : 1;
     bool use_device_default_scale : 1;
     bool use_device_default_offset : 1;
@@ -825,6 +881,16 @@ accelerate_reader_cb(void *data, struct sol_iio_device *device)
     sol_flow_send_direction_vector_packet(node,
         SOL_FLOW_NODE_TYPE_IIO_ACCELERATE__OUT__OUT, &out);
 
+    if (mdata->batch_size > 1) {
+        struct sol_iio_channel *channels[] = {
+            mdata->channel_x, mdata->channel_y, mdata->channel_z
+        };
+
+        if (send_samples_packet(node, SOL_FLOW_NODE_TYPE_IIO_ACCELERATE__OUT__BATCH,
+            channels, SOL_UTIL_ARRAY_SIZE(channels)) < 0)
+            goto error;
+    }
+
     return;
 
 error:
@@ -886,6 +952,12 @@ accelerate_open(struct sol_flow_node *node, void *data, const struct sol_flow_no
 
     mdata->config.buffer_size = opts->buffer_size;
     mdata->config.sampling_frequency = opts->sampling_frequency;
+    if (opts->batch_size < 0) {
+        SOL_WRN("Invalid batch_size %" PRId32, opts->batch_size);
+        goto err;
+    }
+    mdata->config.batch_size = opts->batch_size;
+    mdata->batch_size = opts->batch_size;
     if (mdata->buffer_enabled) {
         mdata->config.sol_iio_reader_cb = accelerate_reader_cb;
         mdata->config.data = node;
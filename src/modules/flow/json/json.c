@@ -30,6 +30,127 @@ struct sol_json_node_data {
     char *key;
 };
 
+/*
+ * Structural indexes of the JSON blobs being queried, so that several
+ * nodes holding the same blob (e.g. many object-get-path nodes fed
+ * from one source) don't re-scan it from the start on every lookup.
+ * An index is built on the second lookup of a blob: a blob queried
+ * once is cheaper to scan directly. Entries hold a reference to their
+ * blob and are dropped once the cache is the only holder left.
+ */
+#define JSON_INDEX_CACHE_SIZE 8
+
+struct json_index_cache_entry {
+    struct sol_blob *blob;
+    struct sol_json_index *index;
+    bool indexable;
+};
+
+static struct json_index_cache_entry json_index_cache[JSON_INDEX_CACHE_SIZE];
+static unsigned int json_index_cache_users;
+
+static void
+json_index_cache_entry_clear(struct json_index_cache_entry *entry)
+{
+    sol_json_index_del(entry->index);
+    sol_blob_unref(entry->blob);
+    entry->blob = NULL;
+    entry->index = NULL;
+}
+
+static void
+json_index_cache_purge(bool all)
+{
+    struct json_index_cache_entry *entry;
+    unsigned int i, len = 0;
+
+    for (i = 0; i < JSON_INDEX_CACHE_SIZE; i++) {
+        entry = json_index_cache + i;
+        if (!entry->blob)
+            break;
+
+        if (all || entry->blob->refcnt == 1)
+            json_index_cache_entry_clear(entry);
+        else
+            json_index_cache[len++] = *entry;
+    }
+
+    for (i = len; i < JSON_INDEX_CACHE_SIZE; i++)
+        json_index_cache[i].blob = NULL;
+}
+
+static const struct sol_json_index *
+json_index_get(struct sol_blob *blob, bool build)
+{
+    struct json_index_cache_entry entry = { 0 };
+    unsigned int i;
+
+    json_index_cache_purge(false);
+
+    for (i = 0; i < JSON_INDEX_CACHE_SIZE; i++) {
+        if (json_index_cache[i].blob == blob) {
+            entry = json_index_cache[i];
+            break;
+        }
+    }
+
+    if (!build || !json_index_cache_users) {
+        if (i == JSON_INDEX_CACHE_SIZE)
+            return NULL;
+        return entry.index;
+    }
+
+    if (i == JSON_INDEX_CACHE_SIZE) {
+        entry.blob = sol_blob_ref(blob);
+        SOL_NULL_CHECK(entry.blob, NULL);
+        entry.indexable = true;
+
+        i = JSON_INDEX_CACHE_SIZE - 1;
+        if (json_index_cache[i].blob)
+            json_index_cache_entry_clear(json_index_cache + i);
+    } else if (!entry.index && entry.indexable) {
+        entry.index = sol_json_index_new(blob->mem, blob->size);
+        entry.indexable = !!entry.index;
+    }
+
+    /* most recently used first */
+    memmove(json_index_cache + 1, json_index_cache,
+        i * sizeof(struct json_index_cache_entry));
+    json_index_cache[0] = entry;
+
+    return entry.index;
+}
+
+static const struct sol_json_index *
+json_index_get_typed(struct sol_blob *blob, enum sol_json_type root_type)
+{
+    const struct sol_json_index *index;
+    struct sol_json_token root;
+
+    index = json_index_get(blob, false);
+    if (!index || sol_json_index_get_value_by_path(index,
+        sol_str_slice_from_str("$"), &root) < 0 ||
+        sol_json_token_get_type(&root) != root_type)
+        return NULL;
+
+    return index;
+}
+
+static void
+json_index_cache_ref(void)
+{
+    json_index_cache_users++;
+}
+
+static void
+json_index_cache_unref(void)
+{
+    if (--json_index_cache_users == 0)
+        json_index_cache_purge(true);
+    else
+        json_index_cache_purge(false);
+}
+
 struct json_node_type {
     struct sol_flow_node_type base;
     int (*process)(struct sol_flow_node *node,
@@ -52,6 +173,7 @@ json_node_key_open(struct sol_flow_node *node, void *data, const struct sol_flow
     mdata->key = strdup(opts->key);
     SOL_NULL_CHECK(mdata->key, -ENOMEM);
 
+    json_index_cache_ref();
     return 0;
 }
 
@@ -63,6 +185,7 @@ json_node_close(struct sol_flow_node *node, void *data)
     if (mdata->json_element)
         sol_blob_unref(mdata->json_element);
     free(mdata->key);
+    json_index_cache_unref();
 }
 
 static struct sol_blob *
@@ -71,7 +194,7 @@ create_sub_json(struct sol_blob *parent, struct sol_json_scanner *scanner, struc
     const char *mem;
 
     if (sol_json_mem_get_type(token->end - 1) == type)
-        return sol_blob_new(SOL_BLOB_TYPE_NO_FREE, parent, token->start,
+        return sol_blob_slice(parent, token->start - (const char *)parent->mem,
             token->end - token->start);
 
     mem = token->start;
@@ -83,7 +206,8 @@ create_sub_json(struct sol_blob *parent, struct sol_json_scanner *scanner, struc
         return NULL;
     }
 
-    return sol_blob_new(SOL_BLOB_TYPE_NO_FREE, parent, mem, token->end - mem);
+    return sol_blob_slice(parent, mem - (const char *)parent->mem,
+        token->end - mem);
 }
 
 static int
@@ -109,8 +233,9 @@ send_token_packet(struct sol_flow_node *node, struct sol_json_scanner *scanner,
         return r;
     case SOL_JSON_TYPE_ARRAY_START:
         if (sol_json_token_get_size(token) > 1) {
-            new_blob = sol_blob_new(SOL_BLOB_TYPE_NO_FREE,
-                json, token->start, sol_json_token_get_size(token));
+            new_blob = sol_blob_slice(json,
+                token->start - (const char *)json->mem,
+                sol_json_token_get_size(token));
             SOL_NULL_CHECK(new_blob, -errno);
             r = sol_flow_send_json_array_packet(node,
                 SOL_FLOW_NODE_TYPE_JSON_OBJECT_GET_KEY__OUT__ARRAY, new_blob);
@@ -167,8 +292,10 @@ error:
 static int
 json_object_key_process(struct sol_flow_node *node, struct sol_json_node_data *mdata)
 {
+    const struct sol_json_index *index;
     struct sol_json_token value;
     struct sol_json_scanner scanner;
+    int r;
 
     if (!mdata->key[0] || !mdata->json_element)
         return 0;
@@ -176,8 +303,15 @@ json_object_key_process(struct sol_flow_node *node, struct sol_json_node_data *m
     sol_json_scanner_init(&scanner, mdata->json_element->mem,
         mdata->json_element->size);
 
-    if (sol_json_object_get_value_by_key(&scanner,
-        sol_str_slice_from_str(mdata->key), &value) == 0)
+    index = json_index_get(mdata->json_element, true);
+    if (index)
+        r = sol_json_index_object_get_value_by_key(index,
+            sol_str_slice_from_str(mdata->key), &value);
+    else
+        r = sol_json_object_get_value_by_key(&scanner,
+            sol_str_slice_from_str(mdata->key), &value);
+
+    if (r == 0)
         return send_token_packet(node, &scanner, mdata->json_element, &value);
 
     return sol_flow_send_error_packet(node, EINVAL,
@@ -187,7 +321,8 @@ json_object_key_process(struct sol_flow_node *node, struct sol_json_node_data *m
 static int
 json_object_path_process(struct sol_flow_node *node, struct sol_json_node_data *mdata)
 {
-    struct sol_json_token value;
+    const struct sol_json_index *index;
+    struct sol_json_token value, root;
     enum sol_json_type type;
     struct sol_json_scanner scanner;
     int r;
@@ -195,16 +330,28 @@ json_object_path_process(struct sol_flow_node *node, struct sol_json_node_data *
     if (!mdata->key[0] || !mdata->json_element)
         return 0;
 
+    sol_json_scanner_init(&scanner, mdata->json_element->mem,
+        mdata->json_element->size);
+    if (!sol_json_scanner_next(&scanner, &root))
+        return sol_flow_send_error_packet(node, EINVAL,
+            "JSON element doesn't contain path %s", mdata->key);
+
     sol_json_scanner_init(&scanner, mdata->json_element->mem,
         mdata->json_element->size);
 
-    r = sol_json_get_value_by_path(&scanner, sol_str_slice_from_str(mdata->key), &value);
+    index = json_index_get(mdata->json_element, true);
+    if (index)
+        r = sol_json_index_get_value_by_path(index,
+            sol_str_slice_from_str(mdata->key), &value);
+    else
+        r = sol_json_get_value_by_path(&scanner,
+            sol_str_slice_from_str(mdata->key), &value);
     if (r < 0)
         return sol_flow_send_error_packet(node, -r,
             "JSON element doesn't contain path %s", mdata->key);
 
-    //If path is root
-    if (value.start == mdata->json_element->mem) {
+    //If path is root (both lookups skip leading whitespace)
+    if (value.start == root.start) {
         type = sol_json_mem_get_type(value.start);
         if (type == SOL_JSON_TYPE_OBJECT_START)
             return sol_flow_send_json_object_packet(node,
@@ -266,11 +413,21 @@ json_object_length_process(struct sol_flow_node *node, void *data, uint16_t port
     struct sol_json_scanner scanner;
     enum sol_json_loop_reason reason;
     struct sol_json_token token, key, value;
+    const struct sol_json_index *index;
     struct sol_irange len = { 0, 0, INT32_MAX, 1 };
 
     r = sol_flow_packet_get_json_object(packet, &in_value);
     SOL_INT_CHECK(r, < 0, r);
 
+    index = json_index_get_typed(in_value, SOL_JSON_TYPE_OBJECT_START);
+    if (index) {
+        if (sol_json_index_get_member_count(index) >= INT32_MAX)
+            return -ERANGE;
+        len.val = sol_json_index_get_member_count(index);
+        return sol_flow_send_irange_packet(node,
+            SOL_FLOW_NODE_TYPE_JSON_OBJECT_LENGTH__OUT__OUT, &len);
+    }
+
     sol_json_scanner_init(&scanner, in_value->mem, in_value->size);
     SOL_JSON_SCANNER_OBJECT_LOOP (&scanner, &token, &key, &value, reason) {
         if (len.val == INT32_MAX)
@@ -283,6 +440,22 @@ json_object_length_process(struct sol_flow_node *node, void *data, uint16_t port
         SOL_FLOW_NODE_TYPE_JSON_OBJECT_LENGTH__OUT__OUT, &len);
 }
 
+static int
+send_key_packet(struct sol_flow_node *node, struct sol_json_token *key)
+{
+    struct sol_buffer buffer;
+    int r;
+
+    r = sol_json_token_get_unescaped_string(key, &buffer);
+    SOL_INT_CHECK(r, < 0, r);
+    r = sol_flow_send_string_slice_packet(node,
+        SOL_FLOW_NODE_TYPE_JSON_OBJECT_GET_ALL_KEYS__OUT__OUT,
+        sol_buffer_get_slice(&buffer));
+    sol_buffer_fini(&buffer);
+
+    return r;
+}
+
 static int
 json_object_get_all_keys_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t conn_id, const struct sol_flow_packet *packet)
 {
@@ -291,25 +464,31 @@ json_object_get_all_keys_process(struct sol_flow_node *node, void *data, uint16_
     struct sol_json_scanner scanner;
     enum sol_json_loop_reason reason;
     struct sol_json_token token, key, value;
-    struct sol_buffer buffer;
+    const struct sol_json_index *index;
+    uint32_t i;
     bool empty = true;
 
     r = sol_flow_packet_get_json_object(packet, &in_value);
     SOL_INT_CHECK(r, < 0, r);
 
+    index = json_index_get_typed(in_value, SOL_JSON_TYPE_OBJECT_START);
+    if (index) {
+        for (i = 0; sol_json_index_get_member(index, i, &key, &value) == 0; i++) {
+            r = send_key_packet(node, &key);
+            SOL_INT_CHECK(r, < 0, r);
+            empty = false;
+        }
+        goto end;
+    }
+
     sol_json_scanner_init(&scanner, in_value->mem, in_value->size);
     SOL_JSON_SCANNER_OBJECT_LOOP (&scanner, &token, &key, &value, reason) {
-        r = sol_json_token_get_unescaped_string(&key, &buffer);
-        SOL_INT_CHECK(r, < 0, r);
-        r = sol_flow_send_string_slice_packet(node,
-            SOL_FLOW_NODE_TYPE_JSON_OBJECT_GET_ALL_KEYS__OUT__OUT,
-            sol_buffer_get_slice(&buffer));
-        sol_buffer_fini(&buffer);
+        r = send_key_packet(node, &key);
         SOL_INT_CHECK(r, < 0, r);
-
         empty = false;
     }
 
+end:
     return sol_flow_send_boolean_packet(node,
         SOL_FLOW_NODE_TYPE_JSON_OBJECT_GET_ALL_KEYS__OUT__EMPTY, empty);
 }
@@ -333,6 +512,7 @@ json_array_get_index_open(struct sol_flow_node *node, void *data, const struct s
 
     mdata->index = opts->index;
 
+    json_index_cache_ref();
     return 0;
 }
 
@@ -343,11 +523,13 @@ json_array_get_index_close(struct sol_flow_node *node, void *data)
 
     if (mdata->json_array)
         sol_blob_unref(mdata->json_array);
+    json_index_cache_unref();
 }
 
 static int
 json_array_index_process(struct sol_flow_node *node, struct sol_json_array_index *mdata)
 {
+    const struct sol_json_index *index;
     struct sol_json_scanner scanner;
     struct sol_json_token token;
     int r;
@@ -357,7 +539,12 @@ json_array_index_process(struct sol_flow_node *node, struct sol_json_array_index
 
     sol_json_scanner_init(&scanner, mdata->json_array->mem,
         mdata->json_array->size);
-    r = sol_json_array_get_at_index(&scanner, mdata->index, &token);
+
+    index = json_index_get(mdata->json_array, true);
+    if (index)
+        r = sol_json_index_array_get_at_index(index, mdata->index, &token);
+    else
+        r = sol_json_array_get_at_index(&scanner, mdata->index, &token);
     if (r == 0)
         return send_token_packet(node, &scanner, mdata->json_array, &token);
     if (r == -ENOENT)
@@ -413,11 +600,21 @@ json_array_length_process(struct sol_flow_node *node, void *data, uint16_t port,
     struct sol_json_scanner scanner;
     enum sol_json_loop_reason reason;
     struct sol_json_token token;
+    const struct sol_json_index *index;
     struct sol_irange len = { 0, 0, INT32_MAX, 1 };
 
     r = sol_flow_packet_get_json_array(packet, &in_value);
     SOL_INT_CHECK(r, < 0, r);
 
+    index = json_index_get_typed(in_value, SOL_JSON_TYPE_ARRAY_START);
+    if (index) {
+        if (sol_json_index_get_member_count(index) >= INT32_MAX)
+            return -ERANGE;
+        len.val = sol_json_index_get_member_count(index);
+        return sol_flow_send_irange_packet(node,
+            SOL_FLOW_NODE_TYPE_JSON_ARRAY_LENGTH__OUT__OUT, &len);
+    }
+
     sol_json_scanner_init(&scanner, in_value->mem, in_value->size);
     SOL_JSON_SCANNER_ARRAY_LOOP_ALL(&scanner, &token, reason) {
         if (!sol_json_scanner_skip_over(&scanner, &token))
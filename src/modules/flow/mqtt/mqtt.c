@@ -25,6 +25,39 @@
 #include <sol-util-internal.h>
 #include <errno.h>
 
+#include "topic-trie.h"
+
+
+/* Nodes pointing to the same broker with the same credentials share a
+ * single connection. Incoming messages are routed to the subscribed
+ * nodes through a topic filter trie, so each message is matched and
+ * copied once no matter how many nodes are attached. Only filters not
+ * covered by other ones are subscribed on the broker, as it would send
+ * a message once per matching subscription.
+ */
+struct mqtt_connection {
+    struct sol_mqtt *mqtt;
+
+    char *host;
+    int port;
+
+    char *user;
+    char *pass;
+
+    char *id;
+
+    int keepalive;
+
+    bool clean_session;
+
+    struct sol_cert *ca_cert;
+    struct sol_cert *client_cert;
+    struct sol_cert *private_key;
+
+    struct sol_ptr_vector clients;
+    struct topic_level topics;
+    struct sol_vector broker_filters; /* struct topic_filter, subscribed on the broker */
+};
 
 struct client_data {
     struct sol_flow_node *node;
@@ -49,12 +82,33 @@ struct client_data {
     char *topic;
     struct sol_blob *payload;
 
-    struct sol_mqtt *mqtt;
+    struct mqtt_connection *conn;
+    struct sol_ptr_vector subscriptions;
 
     bool pending_publish;
     bool pending_subscribe;
 };
 
+static struct sol_ptr_vector connections = SOL_PTR_VECTOR_INIT;
+
+static bool
+streq_null(const char *a, const char *b)
+{
+    if (!a || !b)
+        return a == b;
+    return streq(a, b);
+}
+
+static struct sol_cert *
+cert_ref(struct sol_cert *cert)
+{
+    if (!cert)
+        return NULL;
+
+    /* certificates are cached, loading it again adds a reference */
+    return sol_cert_load_from_file(sol_cert_get_filename(cert));
+}
+
 static void
 publish(struct client_data *mdata)
 {
@@ -75,33 +129,162 @@ publish(struct client_data *mdata)
         .retain = false,
     };
 
-    r = sol_mqtt_publish(mdata->mqtt, &message);
+    r = sol_mqtt_publish(mdata->conn->mqtt, &message);
 
     if (r != 0)
         sol_flow_send_error_packet(mdata->node, ENOTCONN, "Disconnected from MQTT broker");
 }
 
+static bool
+has_subscription(const struct client_data *mdata, const char *filter)
+{
+    const char *itr;
+    uint32_t i;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&mdata->subscriptions, itr, i) {
+        if (streq(itr, filter))
+            return true;
+    }
+
+    return false;
+}
+
+static struct topic_filter *
+find_filter(const struct sol_vector *filters, const char *filter)
+{
+    struct topic_filter *f;
+    uint32_t i;
+
+    SOL_VECTOR_FOREACH_IDX (filters, f, i) {
+        if (streq(f->filter, filter))
+            return f;
+    }
+
+    return NULL;
+}
+
+/* Bring the broker subscriptions in line with the filters in the trie.
+ * New filters are subscribed before the ones they cover are dropped,
+ * so no message is missed meanwhile. */
+static int
+connection_update_filters(struct mqtt_connection *conn)
+{
+    struct sol_vector wanted;
+    struct topic_filter *f, *cur;
+    uint32_t i;
+    int r, err = 0;
+
+    r = topic_trie_get_broker_filters(&conn->topics, &wanted);
+    SOL_INT_CHECK(r, < 0, r);
+
+    SOL_VECTOR_FOREACH_IDX (&wanted, f, i) {
+        cur = find_filter(&conn->broker_filters, f->filter);
+        if (cur && cur->qos >= f->qos)
+            continue;
+
+        if (sol_mqtt_subscribe(conn->mqtt, f->filter, f->qos) != 0) {
+            err = -ENOTCONN;
+            continue;
+        }
+
+        if (cur) {
+            cur->qos = f->qos;
+            continue;
+        }
+
+        cur = sol_vector_append(&conn->broker_filters);
+        if (!cur) {
+            /* not tracked, so it stays subscribed until disconnection */
+            err = -ENOMEM;
+            continue;
+        }
+        *cur = *f;
+        f->filter = NULL;
+    }
+
+    for (i = conn->broker_filters.len; i > 0; i--) {
+        cur = sol_vector_get_no_check(&conn->broker_filters, i - 1);
+        if (find_filter(&wanted, cur->filter))
+            continue;
+
+        sol_mqtt_unsubscribe(conn->mqtt, cur->filter);
+        free(cur->filter);
+        sol_vector_del(&conn->broker_filters, i - 1);
+    }
+
+    topic_filters_clear(&wanted);
+    return err;
+}
+
 static void
 subscribe(struct client_data *mdata)
 {
+    struct mqtt_connection *conn = mdata->conn;
+    char *filter;
     int r;
 
-    r = sol_mqtt_subscribe(mdata->mqtt, mdata->topic, mdata->qos);
+    r = topic_trie_add(&conn->topics, mdata->topic, mdata, mdata->qos);
+    if (r < 0) {
+        sol_flow_send_error_packet(mdata->node, -r, "Invalid MQTT topic filter '%s'",
+            mdata->topic ? mdata->topic : "");
+        return;
+    }
 
-    if (r != 0)
+    if (!has_subscription(mdata, mdata->topic)) {
+        filter = strdup(mdata->topic);
+        SOL_NULL_CHECK_GOTO(filter, error);
+
+        r = sol_ptr_vector_append(&mdata->subscriptions, filter);
+        if (r < 0) {
+            free(filter);
+            goto error;
+        }
+    }
+
+    r = connection_update_filters(conn);
+    if (r == -ENOTCONN)
         sol_flow_send_error_packet(mdata->node, ENOTCONN, "Disconnected from MQTT broker");
+    else if (r < 0)
+        sol_flow_send_error_packet(mdata->node, -r, "Unable to subscribe to '%s'",
+            mdata->topic);
+
+    return;
+
+error:
+    topic_trie_del(&conn->topics, mdata->topic, mdata);
+    sol_flow_send_error_packet(mdata->node, ENOMEM, "Unable to subscribe to '%s'",
+        mdata->topic);
 }
 
 static void
-on_connect(void *data, struct sol_mqtt *mqtt)
+unsubscribe_all(struct client_data *mdata)
 {
-    struct client_data *mdata = data;
+    struct mqtt_connection *conn = mdata->conn;
+    char *filter;
+    uint32_t i;
+    int r;
 
-    if (sol_mqtt_get_connection_status(mqtt) != SOL_MQTT_CONNECTED) {
-        sol_flow_send_error_packet(mdata->node, ENOTCONN, "Unable to connect to MQTT broker");
-        return;
+    SOL_PTR_VECTOR_FOREACH_IDX (&mdata->subscriptions, filter, i) {
+        if (conn)
+            topic_trie_del(&conn->topics, filter, mdata);
+        free(filter);
+    }
+
+    if (conn && sol_ptr_vector_get_len(&mdata->subscriptions)) {
+        /* filters that were covered by the removed ones may have to be
+         * subscribed on the broker again */
+        r = connection_update_filters(conn);
+        if (r < 0)
+            SOL_WRN("Could not update MQTT subscriptions: %s",
+                sol_util_strerrora(-r));
     }
 
+    sol_ptr_vector_clear(&mdata->subscriptions);
+}
+
+static void
+flush_pending(struct client_data *mdata)
+{
     if (mdata->pending_publish) {
         mdata->pending_publish = false;
         publish(mdata);
@@ -113,53 +296,139 @@ on_connect(void *data, struct sol_mqtt *mqtt)
     }
 }
 
+static void
+connection_del(struct mqtt_connection *conn)
+{
+    sol_ptr_vector_remove(&connections, conn);
+
+    if (conn->mqtt)
+        sol_mqtt_disconnect(conn->mqtt);
+
+    topic_trie_fini(&conn->topics);
+    topic_filters_clear(&conn->broker_filters);
+    sol_ptr_vector_clear(&conn->clients);
+
+    sol_cert_unref(conn->ca_cert);
+    sol_cert_unref(conn->client_cert);
+    sol_cert_unref(conn->private_key);
+
+    free(conn->host);
+    free(conn->user);
+    free(conn->pass);
+    free(conn->id);
+    free(conn);
+}
+
+static void
+connection_detach(struct mqtt_connection *conn, struct client_data *mdata)
+{
+    unsubscribe_all(mdata);
+    mdata->conn = NULL;
+
+    sol_ptr_vector_remove(&conn->clients, mdata);
+    if (!sol_ptr_vector_get_len(&conn->clients))
+        connection_del(conn);
+}
+
+static void
+on_connect(void *data, struct sol_mqtt *mqtt)
+{
+    struct mqtt_connection *conn = data;
+    struct client_data *mdata;
+    uint32_t i;
+
+    if (sol_mqtt_get_connection_status(mqtt) != SOL_MQTT_CONNECTED) {
+        SOL_PTR_VECTOR_FOREACH_IDX (&conn->clients, mdata, i)
+            sol_flow_send_error_packet(mdata->node, ENOTCONN, "Unable to connect to MQTT broker");
+        return;
+    }
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&conn->clients, mdata, i)
+        flush_pending(mdata);
+}
+
 static void
 on_disconnect(void *data, struct sol_mqtt *mqtt)
 {
-    struct client_data *mdata = data;
+    struct mqtt_connection *conn = data;
+    struct client_data *mdata;
+    uint32_t i;
+
+    /* Nodes will connect again on their next publish or subscribe
+     * request, which gives them a fresh shared session. */
+    SOL_PTR_VECTOR_FOREACH_IDX (&conn->clients, mdata, i) {
+        mdata->conn = NULL;
+        unsubscribe_all(mdata);
+    }
 
-    sol_mqtt_disconnect(mdata->mqtt);
-    mdata->mqtt = NULL;
+    connection_del(conn);
 }
 
 static void
 on_message(void *data, struct sol_mqtt *mqtt, const struct sol_mqtt_message *message)
 {
-    struct client_data *mdata = data;
+    struct mqtt_connection *conn = data;
+    struct sol_ptr_vector matches = SOL_PTR_VECTOR_INIT;
+    struct client_data *mdata;
     struct sol_blob *blob;
     char *payload;
+    uint32_t i;
+    int r;
 
     SOL_NULL_CHECK(message);
     SOL_MQTT_MESSAGE_CHECK_API_VERSION(message);
 
+    r = topic_trie_match(&conn->topics, message->topic, &matches);
+    SOL_INT_CHECK_GOTO(r, < 0, end);
+
+    if (!sol_ptr_vector_get_len(&matches))
+        return;
+
     payload = sol_util_memdup(message->payload->data, message->payload->used);
-    SOL_NULL_CHECK(payload);
+    SOL_NULL_CHECK_GOTO(payload, end);
 
     blob = sol_blob_new(SOL_BLOB_TYPE_DEFAULT, NULL, payload, message->payload->used);
-    SOL_NULL_CHECK_GOTO(blob, error);
+    if (!blob) {
+        free(payload);
+        goto end;
+    }
 
-    sol_flow_send_blob_packet(mdata->node, SOL_FLOW_NODE_TYPE_MQTT_CLIENT__OUT__OUTDATA, blob);
+    SOL_PTR_VECTOR_FOREACH_IDX (&matches, mdata, i)
+        sol_flow_send_blob_packet(mdata->node, SOL_FLOW_NODE_TYPE_MQTT_CLIENT__OUT__OUTDATA, blob);
     sol_blob_unref(blob);
 
-    return;
+end:
+    sol_ptr_vector_clear(&matches);
+}
 
-error:
-    free(payload);
+static bool
+connection_matches(const struct mqtt_connection *conn, const struct client_data *mdata)
+{
+    return conn->port == mdata->port &&
+           conn->keepalive == mdata->keepalive &&
+           conn->clean_session == mdata->clean_session &&
+           conn->ca_cert == mdata->ca_cert &&
+           conn->client_cert == mdata->client_cert &&
+           conn->private_key == mdata->private_key &&
+           streq_null(conn->host, mdata->host) &&
+           streq_null(conn->user, mdata->user) &&
+           streq_null(conn->pass, mdata->pass) &&
+           streq_null(conn->id, mdata->id);
 }
 
-static void
-mqtt_init(struct client_data *mdata)
+static struct sol_mqtt *
+connection_connect(struct mqtt_connection *conn)
 {
     struct sol_mqtt_config config = {
         SOL_SET_API_VERSION(.api_version = SOL_MQTT_CONFIG_API_VERSION, )
-        .clean_session = mdata->clean_session,
-        .keepalive = mdata->keepalive,
-        .username = mdata->user,
-        .client_id = mdata->id,
-        .password = mdata->pass,
-        .ca_cert = mdata->ca_cert,
-        .client_cert = mdata->client_cert,
-        .private_key = mdata->private_key,
+        .clean_session = conn->clean_session,
+        .keepalive = conn->keepalive,
+        .username = conn->user,
+        .client_id = conn->id,
+        .password = conn->pass,
+        .ca_cert = conn->ca_cert,
+        .client_cert = conn->client_cert,
+        .private_key = conn->private_key,
         .handlers = {
             SOL_SET_API_VERSION(.api_version = SOL_MQTT_HANDLERS_API_VERSION, )
             .connect = on_connect,
@@ -168,12 +437,93 @@ mqtt_init(struct client_data *mdata)
         },
     };
 
-    mdata->mqtt = sol_mqtt_connect(mdata->host, mdata->port, &config, mdata);
+    return sol_mqtt_connect(conn->host, conn->port, &config, conn);
+}
+
+static struct mqtt_connection *
+connection_new(const struct client_data *mdata)
+{
+    struct mqtt_connection *conn;
+    int r;
+
+    conn = calloc(1, sizeof(*conn));
+    SOL_NULL_CHECK(conn, NULL);
+
+    sol_ptr_vector_init(&conn->clients);
+    topic_trie_init(&conn->topics);
+    sol_vector_init(&conn->broker_filters, sizeof(struct topic_filter));
+
+    conn->port = mdata->port;
+    conn->keepalive = mdata->keepalive;
+    conn->clean_session = mdata->clean_session;
+
+#define DUP_AND_CHECK(field) \
+    do { \
+        if (mdata->field) { \
+            conn->field = strdup(mdata->field); \
+            SOL_NULL_CHECK_GOTO(conn->field, error); \
+        } \
+    } while (0)
+
+    DUP_AND_CHECK(host);
+    DUP_AND_CHECK(user);
+    DUP_AND_CHECK(pass);
+    DUP_AND_CHECK(id);
+
+#undef DUP_AND_CHECK
+
+    conn->ca_cert = cert_ref(mdata->ca_cert);
+    conn->client_cert = cert_ref(mdata->client_cert);
+    conn->private_key = cert_ref(mdata->private_key);
+
+    conn->mqtt = connection_connect(conn);
+    SOL_NULL_CHECK_GOTO(conn->mqtt, error);
+
+    r = sol_ptr_vector_append(&connections, conn);
+    SOL_INT_CHECK_GOTO(r, < 0, error);
 
-    if (!mdata->mqtt) {
-        sol_flow_send_error_packet(mdata->node, ENOMEM,
-            "Unable to create MQTT session. Retrying...");
+    return conn;
+
+error:
+    connection_del(conn);
+    return NULL;
+}
+
+static void
+mqtt_init(struct client_data *mdata)
+{
+    struct mqtt_connection *conn;
+    bool new_conn = false;
+    uint32_t i;
+    int r;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&connections, conn, i) {
+        if (connection_matches(conn, mdata))
+            goto attach;
     }
+
+    conn = connection_new(mdata);
+    SOL_NULL_CHECK_GOTO(conn, error);
+    new_conn = true;
+
+attach:
+    r = sol_ptr_vector_append(&conn->clients, mdata);
+    SOL_INT_CHECK_GOTO(r, < 0, error_append);
+
+    mdata->conn = conn;
+
+    /* a new connection flushes its clients once the broker accepts it */
+    if (!new_conn && sol_mqtt_get_connection_status(conn->mqtt) == SOL_MQTT_CONNECTED)
+        flush_pending(mdata);
+
+    return;
+
+error_append:
+    if (new_conn)
+        connection_del(conn);
+error:
+    sol_flow_send_error_packet(mdata->node, ENOMEM,
+        "Unable to create MQTT session. Retrying...");
 }
 
 static void
@@ -181,15 +531,15 @@ mqtt_client_close(struct sol_flow_node *node, void *data)
 {
     struct client_data *mdata = data;
 
-    if (mdata->mqtt)
-        sol_mqtt_disconnect(mdata->mqtt);
+    if (mdata->conn)
+        connection_detach(mdata->conn, mdata);
 
     if (mdata->payload)
         sol_blob_unref(mdata->payload);
 
     sol_cert_unref(mdata->ca_cert);
     sol_cert_unref(mdata->client_cert);
-    sol_cert_unref(mdata->ca_cert);
+    sol_cert_unref(mdata->private_key);
 
     free(mdata->host);
     free(mdata->user);
@@ -208,6 +558,7 @@ mqtt_client_open(struct sol_flow_node *node, void *data, const struct sol_flow_n
     opts = (const struct sol_flow_node_type_mqtt_client_options *)options;
 
     mdata->node = node;
+    sol_ptr_vector_init(&mdata->subscriptions);
 
 #define ALLOC_AND_CHECK(src, dst, alloc) \
     do { \
@@ -291,7 +642,7 @@ publish_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_t
 {
     struct client_data *mdata = data;
 
-    if (!mdata->mqtt) {
+    if (!mdata->conn) {
         mdata->pending_publish = true;
         mqtt_init(mdata);
     } else {
@@ -306,7 +657,7 @@ subscribe_process(struct sol_flow_node *node, void *data, uint16_t port, uint16_
 {
     struct client_data *mdata = data;
 
-    if (!mdata->mqtt) {
+    if (!mdata->conn) {
         mdata->pending_subscribe = true;
         mqtt_init(mdata);
     } else {
@@ -0,0 +1,449 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <sol-buffer.h>
+#include <sol-log.h>
+#include <sol-str-slice.h>
+#include <sol-util-internal.h>
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "topic-trie.h"
+
+/* Split the first level out of topic, returning where the next level
+ * starts or NULL if it was the last one. Empty levels are valid. */
+static const char *
+split_level(const char *topic, struct sol_str_slice *level)
+{
+    const char *sep = strchr(topic, '/');
+
+    if (!sep) {
+        *level = sol_str_slice_from_str(topic);
+        return NULL;
+    }
+
+    level->data = topic;
+    level->len = sep - topic;
+    return sep + 1;
+}
+
+static bool
+is_system_topic(const struct sol_str_slice level)
+{
+    return level.len > 0 && level.data[0] == '$';
+}
+
+static struct topic_level *
+topic_level_new(const struct sol_str_slice name)
+{
+    struct topic_level *level;
+
+    level = calloc(1, sizeof(*level));
+    SOL_NULL_CHECK(level, NULL);
+
+    level->name = sol_str_slice_to_string(name);
+    SOL_NULL_CHECK_GOTO(level->name, error);
+
+    sol_ptr_vector_init(&level->children);
+    sol_ptr_vector_init(&level->subscribers);
+
+    return level;
+
+error:
+    free(level);
+    return NULL;
+}
+
+static void
+topic_level_del(struct topic_level *level)
+{
+    topic_trie_fini(level);
+    free(level->name);
+    free(level);
+}
+
+static int
+topic_level_find_child(const struct topic_level *level, const struct sol_str_slice name)
+{
+    struct topic_level *child;
+    uint32_t i;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&level->children, child, i) {
+        if (sol_str_slice_str_eq(name, child->name))
+            return i;
+    }
+
+    return -ENOENT;
+}
+
+void
+topic_trie_init(struct topic_level *root)
+{
+    root->name = NULL;
+    root->qos = SOL_MQTT_QOS_AT_MOST_ONCE;
+    sol_ptr_vector_init(&root->children);
+    sol_ptr_vector_init(&root->subscribers);
+}
+
+void
+topic_trie_fini(struct topic_level *root)
+{
+    struct topic_level *child;
+    uint32_t i;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&root->children, child, i)
+        topic_level_del(child);
+
+    sol_ptr_vector_clear(&root->children);
+    sol_ptr_vector_clear(&root->subscribers);
+}
+
+bool
+topic_filter_is_valid(const char *filter)
+{
+    struct sol_str_slice level;
+    const char *next = filter;
+
+    if (!filter || !*filter)
+        return false;
+
+    do {
+        next = split_level(next, &level);
+
+        /* '#' must be alone and last, '+' must be alone */
+        if (memchr(level.data, '#', level.len) && (level.len != 1 || next))
+            return false;
+        if (memchr(level.data, '+', level.len) && level.len != 1)
+            return false;
+    } while (next);
+
+    return true;
+}
+
+int
+topic_trie_add(struct topic_level *root, const char *filter, const void *subscriber, sol_mqtt_qos qos)
+{
+    struct topic_level *level = root, *child;
+    struct sol_str_slice name;
+    const char *next = filter;
+    int r;
+
+    SOL_NULL_CHECK(root, -EINVAL);
+
+    if (!topic_filter_is_valid(filter))
+        return -EINVAL;
+
+    do {
+        next = split_level(next, &name);
+
+        r = topic_level_find_child(level, name);
+        if (r >= 0) {
+            child = sol_ptr_vector_get_no_check(&level->children, r);
+        } else {
+            child = topic_level_new(name);
+            SOL_NULL_CHECK(child, -ENOMEM);
+
+            r = sol_ptr_vector_append(&level->children, child);
+            if (r < 0) {
+                topic_level_del(child);
+                return r;
+            }
+        }
+        level = child;
+    } while (next);
+
+    if (sol_ptr_vector_find_first(&level->subscribers, subscriber) < 0) {
+        r = sol_ptr_vector_append(&level->subscribers, subscriber);
+        SOL_INT_CHECK(r, < 0, r);
+
+        if (sol_ptr_vector_get_len(&level->subscribers) == 1) {
+            level->qos = qos;
+            return 0;
+        }
+    }
+
+    if (qos > level->qos)
+        level->qos = qos;
+
+    return 0;
+}
+
+static int
+topic_level_del_subscriber(struct topic_level *level, const char *next, const void *subscriber)
+{
+    struct topic_level *child;
+    struct sol_str_slice name;
+    int idx, r;
+
+    if (!next) {
+        r = sol_ptr_vector_remove(&level->subscribers, subscriber);
+        SOL_INT_CHECK(r, < 0, r);
+        return 0;
+    }
+
+    next = split_level(next, &name);
+
+    idx = topic_level_find_child(level, name);
+    if (idx < 0)
+        return idx;
+
+    child = sol_ptr_vector_get_no_check(&level->children, idx);
+    r = topic_level_del_subscriber(child, next, subscriber);
+    if (r < 0)
+        return r;
+
+    if (!sol_ptr_vector_get_len(&child->subscribers) &&
+        !sol_ptr_vector_get_len(&child->children)) {
+        sol_ptr_vector_del(&level->children, idx);
+        topic_level_del(child);
+    }
+
+    return 0;
+}
+
+int
+topic_trie_del(struct topic_level *root, const char *filter, const void *subscriber)
+{
+    SOL_NULL_CHECK(root, -EINVAL);
+    SOL_NULL_CHECK(filter, -EINVAL);
+
+    return topic_level_del_subscriber(root, filter, subscriber);
+}
+
+bool
+topic_filter_covers(const char *filter, const char *other)
+{
+    struct sol_str_slice level, other_level;
+    bool first = true;
+
+    SOL_NULL_CHECK(filter, false);
+    SOL_NULL_CHECK(other, false);
+
+    while (filter) {
+        filter = split_level(filter, &level);
+
+        /* '#' also matches the parent level: 'a/#' covers 'a' */
+        if (sol_str_slice_str_eq(level, "#"))
+            return !first || other[0] != '$';
+        if (!other)
+            return false;
+
+        other = split_level(other, &other_level);
+        if (sol_str_slice_str_eq(level, "+")) {
+            if (sol_str_slice_str_eq(other_level, "#"))
+                return false;
+            /* Topics starting with '$' are not matched by a leading wildcard */
+            if (first && is_system_topic(other_level))
+                return false;
+        } else if (!sol_str_slice_eq(level, other_level)) {
+            return false;
+        }
+
+        first = false;
+    }
+
+    return !other;
+}
+
+static int
+collect_filters(const struct topic_level *level, struct sol_buffer *path, struct sol_vector *filters)
+{
+    struct topic_filter *f;
+    struct topic_level *child;
+    size_t used = path->used;
+    uint32_t i;
+    int r;
+
+    if (sol_ptr_vector_get_len(&level->subscribers)) {
+        f = sol_vector_append(filters);
+        SOL_NULL_CHECK(f, -ENOMEM);
+
+        f->qos = level->qos;
+        f->filter = strndup(path->data, path->used);
+        SOL_NULL_CHECK(f->filter, -ENOMEM);
+    }
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&level->children, child, i) {
+        /* the root level has no name */
+        if (level->name) {
+            r = sol_buffer_append_char(path, '/');
+            SOL_INT_CHECK(r, < 0, r);
+        }
+        r = sol_buffer_append_slice(path, sol_str_slice_from_str(child->name));
+        SOL_INT_CHECK(r, < 0, r);
+
+        r = collect_filters(child, path, filters);
+        SOL_INT_CHECK(r, < 0, r);
+
+        path->used = used;
+    }
+
+    return 0;
+}
+
+static bool
+filter_is_covered(const struct sol_vector *filters, const struct topic_filter *f)
+{
+    const struct topic_filter *other;
+    uint32_t i;
+
+    SOL_VECTOR_FOREACH_IDX (filters, other, i) {
+        if (other != f && topic_filter_covers(other->filter, f->filter))
+            return true;
+    }
+
+    return false;
+}
+
+int
+topic_trie_get_broker_filters(const struct topic_level *root, struct sol_vector *filters)
+{
+    struct sol_buffer path = SOL_BUFFER_INIT_EMPTY;
+    struct sol_vector all;
+    struct topic_filter *f, *other, *kept;
+    uint32_t i, j;
+    int r;
+
+    SOL_NULL_CHECK(root, -EINVAL);
+    SOL_NULL_CHECK(filters, -EINVAL);
+
+    sol_vector_init(filters, sizeof(struct topic_filter));
+    sol_vector_init(&all, sizeof(struct topic_filter));
+
+    r = collect_filters(root, &path, &all);
+    sol_buffer_fini(&path);
+    SOL_INT_CHECK_GOTO(r, < 0, end);
+
+    SOL_VECTOR_FOREACH_IDX (&all, f, i) {
+        if (filter_is_covered(&all, f))
+            continue;
+
+        kept = sol_vector_append(filters);
+        if (!kept) {
+            r = -ENOMEM;
+            goto end;
+        }
+
+        kept->qos = f->qos;
+        kept->filter = strdup(f->filter);
+        if (!kept->filter) {
+            r = -ENOMEM;
+            goto end;
+        }
+
+        SOL_VECTOR_FOREACH_IDX (&all, other, j) {
+            if (other->qos > kept->qos &&
+                topic_filter_covers(kept->filter, other->filter))
+                kept->qos = other->qos;
+        }
+    }
+
+end:
+    topic_filters_clear(&all);
+    if (r < 0)
+        topic_filters_clear(filters);
+    return r;
+}
+
+void
+topic_filters_clear(struct sol_vector *filters)
+{
+    struct topic_filter *f;
+    uint32_t i;
+
+    SOL_VECTOR_FOREACH_IDX (filters, f, i)
+        free(f->filter);
+
+    sol_vector_clear(filters);
+}
+
+static int
+append_subscribers(struct sol_ptr_vector *matches, const struct topic_level *level)
+{
+    void *subscriber;
+    uint32_t i;
+    int r;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&level->subscribers, subscriber, i) {
+        if (sol_ptr_vector_find_first(matches, subscriber) >= 0)
+            continue;
+
+        r = sol_ptr_vector_append(matches, subscriber);
+        SOL_INT_CHECK(r, < 0, r);
+    }
+
+    return 0;
+}
+
+static int
+topic_level_match(const struct topic_level *level, const char *next, bool first, struct sol_ptr_vector *matches)
+{
+    struct topic_level *child;
+    struct sol_str_slice name;
+    bool skip_wildcards;
+    uint32_t i;
+    int r;
+
+    if (!next) {
+        r = append_subscribers(matches, level);
+        SOL_INT_CHECK(r, < 0, r);
+
+        /* 'a/#' also matches 'a' */
+        SOL_PTR_VECTOR_FOREACH_IDX (&level->children, child, i) {
+            if (streq(child->name, "#"))
+                return append_subscribers(matches, child);
+        }
+        return 0;
+    }
+
+    next = split_level(next, &name);
+
+    /* Topics starting with '$' are not matched by a leading wildcard */
+    skip_wildcards = first && is_system_topic(name);
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&level->children, child, i) {
+        if (streq(child->name, "#")) {
+            if (skip_wildcards)
+                continue;
+            r = append_subscribers(matches, child);
+        } else if (streq(child->name, "+")) {
+            if (skip_wildcards)
+                continue;
+            r = topic_level_match(child, next, false, matches);
+        } else if (sol_str_slice_str_eq(name, child->name)) {
+            r = topic_level_match(child, next, false, matches);
+        } else {
+            continue;
+        }
+        SOL_INT_CHECK(r, < 0, r);
+    }
+
+    return 0;
+}
+
+int
+topic_trie_match(const struct topic_level *root, const char *topic, struct sol_ptr_vector *matches)
+{
+    SOL_NULL_CHECK(root, -EINVAL);
+    SOL_NULL_CHECK(topic, -EINVAL);
+    SOL_NULL_CHECK(matches, -EINVAL);
+
+    return topic_level_match(root, topic, true, matches);
+}
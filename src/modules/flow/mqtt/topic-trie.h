@@ -0,0 +1,68 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <sol-mqtt.h>
+#include <sol-vector.h>
+
+/* A trie of MQTT topic filters, one level per node, as defined by
+ * section 4.7 of the MQTT 3.1.1 specification. Subscribers are opaque
+ * pointers and the same subscriber may be attached to several
+ * filters. The root level is embedded by the user and has no name.
+ */
+struct topic_level {
+    char *name;
+    struct sol_ptr_vector children;
+    struct sol_ptr_vector subscribers;
+    sol_mqtt_qos qos;
+};
+
+void topic_trie_init(struct topic_level *root);
+
+void topic_trie_fini(struct topic_level *root);
+
+bool topic_filter_is_valid(const char *filter);
+
+struct topic_filter {
+    char *filter;
+    sol_mqtt_qos qos;
+};
+
+/* A filter keeps the highest QoS requested by its subscribers. */
+int topic_trie_add(struct topic_level *root, const char *filter, const void *subscriber, sol_mqtt_qos qos);
+
+int topic_trie_del(struct topic_level *root, const char *filter, const void *subscriber);
+
+/* Whether every topic matched by other is also matched by filter. */
+bool topic_filter_covers(const char *filter, const char *other);
+
+/* Initialize filters as a vector of struct topic_filter with the
+ * filters to subscribe on the broker: the ones with subscribers that
+ * aren't covered by another one, each with the highest QoS among the
+ * filters it covers. A broker sends a message once per matching
+ * subscription, so this way each message is received once. Release
+ * with topic_filters_clear(). */
+int topic_trie_get_broker_filters(const struct topic_level *root, struct sol_vector *filters);
+
+void topic_filters_clear(struct sol_vector *filters);
+
+/* Append to matches every subscriber whose filter matches
+ * topic. Each subscriber is appended at most once, even if it
+ * matches through several filters. */
+int topic_trie_match(const struct topic_level *root, const char *topic, struct sol_ptr_vector *matches);
@@ -22,9 +22,12 @@
 
 #include "sol-buffer.h"
 #include "sol-flow.h"
+#include "sol-list.h"
+#include "sol-mainloop.h"
 #include "sol-str-slice.h"
 #include "sol-str-table.h"
 #include "sol-util-internal.h"
+#include "sol-vector.h"
 #include "sol-flow-internal.h"
 
 #ifdef USE_FILESYSTEM
@@ -44,6 +47,20 @@ struct storage_fn {
         void (*cb)(void *data, const char *name, struct sol_blob *blob, int status),
         const void *data);
     int (*read)(const char *name, struct sol_buffer *buffer);
+    /* Optional, called when a node starts and stops using the storage */
+    int (*open)(void);
+    void (*close)(void);
+};
+
+/* Last value known to be in (or on its way to) storage, shared by all
+ * nodes using the same storage and name. It saves reading storage on
+ * node open and writing values that are already there. */
+struct cache_entry {
+    const struct storage_fn *storage;
+    char *name;
+    void *value; /* NULL if unknown */
+    size_t size;
+    unsigned int refcnt; /* nodes and writes in flight */
 };
 
 struct persist_data {
@@ -52,6 +69,18 @@ struct persist_data {
     char *name;
     char *fs_dir_path;
 
+    struct cache_entry *cache;
+    struct sol_list writes; /* persist_blob in flight */
+    struct persist_blob *spare_blob;
+
+    /* Values received less than min_interval after the last write are
+     * kept here and written when the interval ends */
+    uint32_t min_interval;
+    struct timespec last_write;
+    struct sol_timeout *deferred_timeout;
+    void *deferred_value;
+    bool deferred_send_packet;
+
     struct sol_flow_packet *(*packet_new_fn)(const struct persist_data *data);
     int (*packet_data_get_fn)(size_t packet_data_size, const struct sol_flow_packet *packet, void *value_ptr);
     int (*packet_send_fn)(struct sol_flow_node *node);
@@ -62,17 +91,44 @@ struct persist_data {
     size_t packet_data_size;
 };
 
-struct write_cb_data {
-    struct persist_data *mdata;
+/* A value being written. For fixed size packets, the node keeps the
+ * blob once written and reuses it for the next write. */
+struct persist_blob {
+    struct sol_blob base;
+    struct sol_list list;
+    struct persist_data *mdata; /* NULL once the node is closed */
+    struct cache_entry *cache;
     struct sol_flow_node *node;
     bool send_packet;
+    uint8_t mem[];
 };
 
+static struct sol_ptr_vector cache_entries = SOL_PTR_VECTOR_INIT;
+
 #ifdef USE_FILESYSTEM
 static const struct storage_fn fs_fn = {
     .write = sol_fs_write_raw,
     .read = sol_fs_read_raw
 };
+
+static int
+fs_log_open(void)
+{
+    return sol_fs_log_open(NULL);
+}
+
+static void
+fs_log_close(void)
+{
+    sol_fs_log_close();
+}
+
+static const struct storage_fn fs_log_fn = {
+    .write = sol_fs_log_write_raw,
+    .read = sol_fs_log_read_raw,
+    .open = fs_log_open,
+    .close = fs_log_close
+};
 #endif
 
 #ifdef USE_EFIVARS
@@ -92,6 +148,7 @@ static const struct storage_fn memmap_fn = {
 static const struct sol_str_table_ptr storage_fn_table[] = {
 #ifdef USE_FILESYSTEM
     SOL_STR_TABLE_PTR_ITEM("fs", &fs_fn),
+    SOL_STR_TABLE_PTR_ITEM("fs-log", &fs_log_fn),
 #endif
 #ifdef USE_EFIVARS
     SOL_STR_TABLE_PTR_ITEM("efivars", &efivars_fn),
@@ -118,107 +175,359 @@ update_node_value(struct persist_data *mdata, void *data, size_t len)
     return true;
 }
 
+static int
+cache_entry_compare(const void *data1, const void *data2)
+{
+    const struct cache_entry *e1 = data1, *e2 = data2;
+    int r;
+
+    r = strcmp(e1->name, e2->name);
+    if (r || e1->storage == e2->storage)
+        return r;
+
+    return e1->storage < e2->storage ? -1 : 1;
+}
+
+static struct cache_entry *
+cache_entry_get(const struct storage_fn *storage, const char *name)
+{
+    struct cache_entry key = { .storage = storage, .name = (char *)name };
+    struct cache_entry *entry;
+    int32_t i;
+    int r;
+
+    i = sol_ptr_vector_match_sorted(&cache_entries, &key, cache_entry_compare);
+    if (i >= 0) {
+        entry = sol_ptr_vector_get_no_check(&cache_entries, i);
+        entry->refcnt++;
+        return entry;
+    }
+
+    entry = calloc(1, sizeof(*entry));
+    SOL_NULL_CHECK(entry, NULL);
+
+    entry->name = strdup(name);
+    SOL_NULL_CHECK_GOTO(entry->name, err_name);
+
+    entry->storage = storage;
+    entry->refcnt = 1;
+
+    r = sol_ptr_vector_insert_sorted(&cache_entries, entry, cache_entry_compare);
+    SOL_INT_CHECK_GOTO(r, < 0, err_insert);
+
+    return entry;
+
+err_insert:
+    free(entry->name);
+err_name:
+    free(entry);
+    return NULL;
+}
+
+static void
+cache_entry_unref(struct cache_entry *entry)
+{
+    if (--entry->refcnt)
+        return;
+
+    sol_ptr_vector_remove(&cache_entries, entry);
+    free(entry->value);
+    free(entry->name);
+    free(entry);
+}
+
+static bool
+cache_entry_equal(const struct cache_entry *entry, const void *value, size_t size)
+{
+    return entry->value && entry->size == size &&
+           memcmp(entry->value, value, size) == 0;
+}
+
+static void
+cache_entry_set(struct cache_entry *entry, const void *value, size_t size)
+{
+    void *tmp;
+
+    if (!entry->value || entry->size != size) {
+        tmp = realloc(entry->value, size);
+        if (!tmp) {
+            /* Not knowing the value just makes the next write happen */
+            free(entry->value);
+            entry->value = NULL;
+            return;
+        }
+        entry->value = tmp;
+        entry->size = size;
+    }
+
+    memcpy(entry->value, value, size);
+}
+
+static void
+cache_entry_invalidate(struct cache_entry *entry)
+{
+    free(entry->value);
+    entry->value = NULL;
+}
+
+static void
+persist_blob_free(struct sol_blob *blob)
+{
+    struct persist_blob *pblob = (struct persist_blob *)blob;
+    struct persist_data *mdata = pblob->mdata;
+
+    cache_entry_unref(pblob->cache);
+
+    if (mdata) {
+        sol_list_remove(&pblob->list);
+        if (mdata->packet_data_size && !mdata->spare_blob) {
+            mdata->spare_blob = pblob;
+            return;
+        }
+    }
+
+    free(pblob);
+}
+
+static const struct sol_blob_type persist_blob_type = {
+    SOL_SET_API_VERSION(.api_version = SOL_BLOB_TYPE_API_VERSION, )
+    .free = persist_blob_free
+};
+
+static struct persist_blob *
+persist_blob_new(struct persist_data *mdata, const void *value, size_t size)
+{
+    struct persist_blob *pblob = NULL;
+
+    if (mdata->packet_data_size) {
+        pblob = mdata->spare_blob;
+        mdata->spare_blob = NULL;
+    }
+
+    if (!pblob) {
+        pblob = calloc(1, sizeof(*pblob) + size);
+        SOL_NULL_CHECK(pblob, NULL);
+    }
+
+    memcpy(pblob->mem, value, size);
+    sol_blob_setup(&pblob->base, &persist_blob_type, pblob->mem, size);
+
+    pblob->mdata = mdata;
+    pblob->cache = mdata->cache;
+    pblob->cache->refcnt++;
+    sol_list_append(&mdata->writes, &pblob->list);
+
+    return pblob;
+}
+
 static void
 write_cb(void *data, const char *name, struct sol_blob *blob, int status)
 {
-    struct write_cb_data *cb_data = data;
-    struct persist_data *mdata = cb_data->mdata;
-    struct sol_flow_node *node = cb_data->node;
+    struct persist_blob *pblob = data;
+    struct persist_data *mdata = pblob->mdata;
 
     if (status < 0) {
-        if (status == -ECANCELED)
+        if (status == -ECANCELED) {
             SOL_INF("Writing to [%s] superseeded by another write", name);
-        else
+        } else {
             SOL_WRN("Could not write [%s], error: %d", name, status);
+            /* Storage may still have the previous value */
+            if (cache_entry_equal(pblob->cache, blob->mem, blob->size))
+                cache_entry_invalidate(pblob->cache);
+        }
 
-        goto end;
+        return;
     }
 
+    if (!mdata)
+        return;
+
     if (update_node_value(mdata, blob->mem, blob->size)) {
-        if (cb_data->send_packet)
-            mdata->packet_send_fn(node);
+        if (pblob->send_packet)
+            mdata->packet_send_fn(pblob->node);
     }
-
-end:
-    free(cb_data);
 }
 
 static int
 storage_write(struct persist_data *mdata, void *data, size_t size, struct sol_flow_node *node, bool send_packet)
 {
-    void *cp_data = NULL;
-    struct write_cb_data *cb_data = NULL;
-    struct sol_blob *blob = NULL;
+    struct persist_blob *pblob;
     int r;
 
-    cp_data = malloc(size);
-    SOL_NULL_CHECK(cp_data, -ENOMEM);
+    pblob = persist_blob_new(mdata, data, size);
+    SOL_NULL_CHECK(pblob, -ENOMEM);
 
-    memcpy(cp_data, data, size);
+    pblob->node = node;
+    pblob->send_packet = send_packet;
+
+    r = mdata->storage->write(mdata->name, &pblob->base, write_cb, pblob);
+    if (r >= 0) {
+        cache_entry_set(mdata->cache, data, size);
+        mdata->last_write = sol_util_timespec_get_current();
+    }
 
-    blob = sol_blob_new(SOL_BLOB_TYPE_DEFAULT, NULL, cp_data, size);
-    SOL_NULL_CHECK_GOTO(blob, error);
+    sol_blob_unref(&pblob->base);
 
-    cb_data = malloc(sizeof(struct write_cb_data));
-    SOL_NULL_CHECK_GOTO(cb_data, error);
+    return r;
+}
 
-    cb_data->mdata = mdata;
-    cb_data->node = node;
-    cb_data->send_packet = send_packet;
+static int
+storage_read(struct persist_data *mdata, struct sol_buffer *buf)
+{
+    struct cache_entry *cache = mdata->cache;
+    int r;
 
-    r = mdata->storage->write(mdata->name, blob, write_cb, cb_data);
-    SOL_INT_CHECK_GOTO(r, < 0, error);
+    if (cache->value &&
+        (!mdata->packet_data_size || cache->size == mdata->packet_data_size))
+        return sol_buffer_append_bytes(buf, cache->value, cache->size);
 
-    sol_blob_unref(blob);
+    r = mdata->storage->read(mdata->name, buf);
+    if (r >= 0) {
+        if (mdata->packet_data_size)
+            cache_entry_set(cache, buf->data, mdata->packet_data_size);
+        else if (sol_buffer_ensure_nul_byte(buf) >= 0)
+            cache_entry_set(cache, buf->data, strlen(buf->data) + 1);
+    }
 
     return r;
+}
 
-error:
-    if (blob)
-        sol_blob_unref(blob);
-    free(cb_data);
+static void
+persist_deferred_cancel(struct persist_data *mdata)
+{
+    if (!mdata->deferred_timeout)
+        return;
 
-    return -ENOMEM;
+    sol_timeout_del(mdata->deferred_timeout);
+    mdata->deferred_timeout = NULL;
+    if (!mdata->packet_data_size) {
+        free(mdata->deferred_value);
+        mdata->deferred_value = NULL;
+    }
+}
+
+static size_t
+persist_value_size(const struct persist_data *mdata, const void *value)
+{
+    if (mdata->packet_data_size)
+        return mdata->packet_data_size;
+
+    return strlen(value) + 1; //To include the null terminating char
+}
+
+static bool
+persist_deferred_write(void *data)
+{
+    struct sol_flow_node *node = data;
+    struct persist_data *mdata = sol_flow_node_get_private_data(node);
+    int r;
+
+    mdata->deferred_timeout = NULL;
+
+    r = storage_write(mdata, mdata->deferred_value,
+        persist_value_size(mdata, mdata->deferred_value), node,
+        mdata->deferred_send_packet);
+    if (r < 0)
+        SOL_WRN("Could not write [%s], error: %d", mdata->name, r);
+
+    if (!mdata->packet_data_size) {
+        free(mdata->deferred_value);
+        mdata->deferred_value = NULL;
+    }
+
+    return false;
 }
 
 static int
-storage_read(struct persist_data *mdata, struct sol_buffer *buf)
+persist_defer(struct persist_data *mdata, struct sol_flow_node *node,
+    void *value, bool send_packet, uint64_t elapsed)
 {
-    return mdata->storage->read(mdata->name, buf);
+    if (mdata->packet_data_size) {
+        if (!mdata->deferred_value) {
+            mdata->deferred_value = malloc(mdata->packet_data_size);
+            SOL_NULL_CHECK(mdata->deferred_value, -ENOMEM);
+        }
+        memcpy(mdata->deferred_value, value, mdata->packet_data_size);
+    } else {
+        char *tmp = strdup(value);
+
+        SOL_NULL_CHECK(tmp, -ENOMEM);
+        free(mdata->deferred_value);
+        mdata->deferred_value = tmp;
+    }
+
+    mdata->deferred_send_packet = send_packet;
+
+    if (!mdata->deferred_timeout) {
+        mdata->deferred_timeout = sol_timeout_add(mdata->min_interval - elapsed,
+            persist_deferred_write, node);
+        SOL_NULL_CHECK(mdata->deferred_timeout, -ENOMEM);
+    }
+
+    return 0;
 }
 
 static void
 persist_close(struct sol_flow_node *node, void *data)
 {
     struct persist_data *mdata = data;
+    struct sol_list *itr, *itr_next;
+    struct persist_blob *pblob;
+
+    /* Don't lose the last value received */
+    if (mdata->deferred_timeout) {
+        sol_timeout_del(mdata->deferred_timeout);
+        persist_deferred_write(node);
+    }
+    free(mdata->deferred_value);
+
+    /* Writes in flight complete after the node is gone */
+    SOL_LIST_FOREACH_SAFE(&mdata->writes, itr, itr_next) {
+        pblob = SOL_LIST_GET_CONTAINER(itr, struct persist_blob, list);
+        sol_list_remove(itr);
+        pblob->mdata = NULL;
+    }
+    free(mdata->spare_blob);
 
     if (!mdata->packet_data_size)
         free(mdata->value_ptr);
 
     free(mdata->name);
+
+    cache_entry_unref(mdata->cache);
+
+    if (mdata->storage->close)
+        mdata->storage->close();
 }
 
 static int
 persist_do(struct persist_data *mdata, struct sol_flow_node *node, void *value,
     bool send_packet)
 {
-    size_t size = 0;
+    struct timespec now, elapsed;
+    uint64_t elapsed_ms;
+    size_t size;
     int r;
 
-    if (mdata->packet_data_size)
-        size = mdata->packet_data_size;
-    else
-        size = strlen(value) + 1; //To include the null terminating char
+    size = persist_value_size(mdata, value);
 
-    if (mdata->value_ptr && value) {
-        if (mdata->packet_data_size)
-            r = memcmp(mdata->value_ptr, value, mdata->packet_data_size);
-        else
-            r = strcmp(mdata->value_ptr, value);
-        if (r == 0)
-            return 0;
+    /* Compared to what was last sent to storage, not to the node value,
+     * which is only updated once writes complete */
+    if (cache_entry_equal(mdata->cache, value, size)) {
+        persist_deferred_cancel(mdata);
+        return 0;
+    }
+
+    if (mdata->min_interval) {
+        now = sol_util_timespec_get_current();
+        sol_util_timespec_sub(&now, &mdata->last_write, &elapsed);
+        elapsed_ms = sol_util_msec_from_timespec(&elapsed);
+        if (elapsed_ms < mdata->min_interval)
+            return persist_defer(mdata, node, value, send_packet, elapsed_ms);
     }
 
+    persist_deferred_cancel(mdata);
+
     r = storage_write(mdata, value, size, node, send_packet);
     SOL_INT_CHECK(r, < 0, r);
 
@@ -229,19 +538,22 @@ static int
 persist_reset(struct persist_data *mdata, struct sol_flow_node *node)
 {
     void *value;
-    size_t size;
+    int r;
 
     value = mdata->node_get_default_fn(node);
 
-    if (mdata->packet_data_size)
-        size = mdata->packet_data_size;
-    else
-        size = strlen(value) + 1;
-
-    if (update_node_value(mdata, value, size))
+    if (update_node_value(mdata, value, persist_value_size(mdata, value)))
         mdata->packet_send_fn(node);
 
-    return persist_do(mdata, node, value, false);
+    /* An explicit reset isn't delayed by min_interval */
+    persist_deferred_cancel(mdata);
+    if (cache_entry_equal(mdata->cache, value, persist_value_size(mdata, value)))
+        return 0;
+
+    r = storage_write(mdata, value, persist_value_size(mdata, value), node, false);
+    SOL_INT_CHECK(r, < 0, r);
+
+    return 0;
 }
 
 static int
@@ -284,7 +596,8 @@ static int
 persist_open(struct sol_flow_node *node,
     void *data,
     const char *storage,
-    const char *name)
+    const char *name,
+    int32_t min_interval)
 {
     struct persist_data *mdata = data;
     struct sol_str_slice storage_slice;
@@ -301,9 +614,31 @@ persist_open(struct sol_flow_node *node,
         return -EINVAL;
     }
 
+    if (min_interval < 0) {
+        SOL_WRN("Invalid min_interval %" PRId32 ", must not be negative",
+            min_interval);
+        return -EINVAL;
+    }
+    mdata->min_interval = min_interval;
+
     mdata->name = strdup(name);
     SOL_NULL_CHECK(mdata->name, -ENOMEM);
 
+    sol_list_init(&mdata->writes);
+    mdata->cache = cache_entry_get(mdata->storage, name);
+    SOL_NULL_CHECK_GOTO(mdata->cache, err_cache);
+
+    if (mdata->storage->open) {
+        r = mdata->storage->open();
+        if (r < 0) {
+            SOL_WRN("Could not open storage [%s]: %s", storage,
+                sol_util_strerrora(-r));
+            cache_entry_unref(mdata->cache);
+            free(mdata->name);
+            return r;
+        }
+    }
+
     /* a zero packet_data_size means dynamic size content */
     if (mdata->packet_data_size) {
         struct sol_buffer buf = SOL_BUFFER_INIT_FLAGS(mdata->value_ptr,
@@ -333,6 +668,10 @@ persist_open(struct sol_flow_node *node,
 err:
     persist_close(node, mdata);
     return r;
+
+err_cache:
+    free(mdata->name);
+    return -ENOMEM;
 }
 
 struct persist_boolean_data {
@@ -400,7 +739,8 @@ persist_boolean_open(struct sol_flow_node *node,
     mdata->base.node_get_default_fn = persist_boolean_node_get_default;
     mdata->default_value = opts->default_value;
 
-    return persist_open(node, data, opts->storage, opts->name);
+    return persist_open(node, data, opts->storage, opts->name,
+        opts->min_interval);
 }
 
 struct persist_byte_data {
@@ -467,7 +807,8 @@ persist_byte_open(struct sol_flow_node *node,
     mdata->base.node_get_default_fn = persist_byte_node_get_default;
     mdata->default_value = opts->default_value;
 
-    return persist_open(node, data, opts->storage, opts->name);
+    return persist_open(node, data, opts->storage, opts->name,
+        opts->min_interval);
 }
 
 struct persist_irange_data {
@@ -562,7 +903,8 @@ persist_irange_open(struct sol_flow_node *node,
         &mdata->default_value);
     SOL_INT_CHECK(r, < 0, r);
 
-    return persist_open(node, data, opts->storage, opts->name);
+    return persist_open(node, data, opts->storage, opts->name,
+        opts->min_interval);
 }
 
 struct persist_drange_data {
@@ -660,7 +1002,8 @@ persist_drange_open(struct sol_flow_node *node,
         &mdata->default_value);
     SOL_INT_CHECK(r, < 0, r);
 
-    return persist_open(node, data, opts->storage, opts->name);
+    return persist_open(node, data, opts->storage, opts->name,
+        opts->min_interval);
 }
 
 struct persist_string_data {
@@ -727,7 +1070,8 @@ persist_string_open(struct sol_flow_node *node,
         SOL_NULL_CHECK(mdata->default_value, -ENOMEM);
     }
 
-    r = persist_open(node, data, opts->storage, opts->name);
+    r = persist_open(node, data, opts->storage, opts->name,
+        opts->min_interval);
     if (r < 0)
         free(mdata->default_value);
 
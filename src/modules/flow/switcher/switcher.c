@@ -76,7 +76,7 @@ switcher_close(struct sol_flow_node *node, void *data)
 {
     struct switcher_data *mdata = data;
     void *last_packet;
-    int i;
+    uint32_t i;
 
     if (!mdata->keep_state)
         return;
@@ -615,7 +615,7 @@ static void
 shutdown(void)
 {
     struct sol_update_handle *handle;
-    int i;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_IDX (&handles, handle, i) {
         /* Try to cancel pending tasks, if fail, free handles. */
@@ -0,0 +1,158 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compares short lived buffers starting empty, as most call sites
+ * declared them, with buffers using inline storage
+ * (SOL_BUFFER_DECLARE_INLINE()): formatting a number as the converter
+ * nodes do, building a path from a few segments as CoAP does and
+ * formatting a message longer than the inline storage. Heap
+ * allocations are counted as the times the buffer capacity changed,
+ * each one a malloc() or realloc().
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "soletta.h"
+#include "sol-buffer.h"
+#include "sol-util.h"
+
+enum workload {
+    WORKLOAD_NUMBER,
+    WORKLOAD_PATH,
+    WORKLOAD_LONG
+};
+
+static const char *const segments[] = { "oic", "res", "light", "1" };
+
+static double
+elapsed_ns(const struct timespec *start)
+{
+    struct timespec now, elapsed;
+
+    now = sol_util_timespec_get_current();
+    sol_util_timespec_sub(&now, start, &elapsed);
+    return elapsed.tv_sec * 1.0e9 + elapsed.tv_nsec;
+}
+
+/* Returns the number of times the capacity changed */
+static int
+fill(struct sol_buffer *buf, enum workload workload, unsigned long i)
+{
+    size_t capacity = buf->capacity;
+    unsigned int j;
+    int r = 0, allocations = 0;
+
+    switch (workload) {
+    case WORKLOAD_NUMBER:
+        r = sol_buffer_append_printf(buf, "%lu: %g", i, i * 0.25);
+        if (buf->capacity != capacity)
+            allocations++;
+        break;
+    case WORKLOAD_PATH:
+        for (j = 0; j < SOL_UTIL_ARRAY_SIZE(segments) && r == 0; j++) {
+            r = sol_buffer_append_char(buf, '/');
+            if (r == 0)
+                r = sol_buffer_append_slice(buf,
+                    sol_str_slice_from_str(segments[j]));
+            if (buf->capacity != capacity)
+                allocations++;
+            capacity = buf->capacity;
+        }
+        break;
+    case WORKLOAD_LONG:
+        r = sol_buffer_append_printf(buf, "%lu %-200s|", i, "padded");
+        if (buf->capacity != capacity)
+            allocations++;
+        break;
+    }
+
+    return r < 0 ? r : allocations;
+}
+
+static int
+run(const char *name, enum workload workload, unsigned long iterations)
+{
+    unsigned long i, heap_allocations = 0, inline_allocations = 0;
+    struct timespec start;
+    double heap_ns, inline_ns;
+    int r;
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < iterations; i++) {
+        struct sol_buffer buf = SOL_BUFFER_INIT_EMPTY;
+
+        r = fill(&buf, workload, i);
+        sol_buffer_fini(&buf);
+        if (r < 0)
+            return r;
+        heap_allocations += r;
+    }
+    heap_ns = elapsed_ns(&start) / iterations;
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < iterations; i++) {
+        SOL_BUFFER_DECLARE_INLINE(buf, 64);
+
+        r = fill(&buf, workload, i);
+        sol_buffer_fini(&buf);
+        if (r < 0)
+            return r;
+        inline_allocations += r;
+    }
+    inline_ns = elapsed_ns(&start) / iterations;
+
+    printf("%-16s empty: %7.1f ns/op %5.2f allocs/op, inline: %7.1f ns/op %5.2f allocs/op\n",
+        name, heap_ns, (double)heap_allocations / iterations,
+        inline_ns, (double)inline_allocations / iterations);
+
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    unsigned long iterations = 1000000;
+    int r;
+
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 10);
+        if (!iterations) {
+            fprintf(stderr, "Usage:\n\t%s [iterations]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    r = sol_init();
+    if (r < 0)
+        return EXIT_FAILURE;
+
+    r = run("number", WORKLOAD_NUMBER, iterations);
+    if (r == 0)
+        r = run("path", WORKLOAD_PATH, iterations);
+    if (r == 0)
+        r = run("long message", WORKLOAD_LONG, iterations);
+    if (r < 0)
+        fprintf(stderr, "ERROR: %s\n", sol_util_strerrora(-r));
+
+    sol_shutdown();
+
+    return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures the base64 and base16 codecs through the sol_buffer API,
+ * for inputs the size of a signature or credentials and for larger
+ * payloads, with the default base64 alphabet and a custom one. Run
+ * with SOL_UTIL_CODEC=scalar or SOL_UTIL_CODEC=ssse3 to compare with
+ * the implementation the CPU would otherwise get.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "soletta.h"
+#include "sol-buffer.h"
+#include "sol-util.h"
+
+static const char custom_map[] =
+    "zyxwvutsrqponmlkjihgfedcbaZYXWVUTSRQPONMLKJIHGFEDCBA9876543210!?#";
+
+static double
+elapsed_ns(const struct timespec *start)
+{
+    struct timespec now, elapsed;
+
+    now = sol_util_timespec_get_current();
+    sol_util_timespec_sub(&now, start, &elapsed);
+    return elapsed.tv_sec * 1.0e9 + elapsed.tv_nsec;
+}
+
+static void
+report(const char *name, size_t size, const struct timespec *start, unsigned long iterations)
+{
+    double ns = elapsed_ns(start) / iterations;
+
+    printf("%-24s %6zu bytes: %9.1f ns/op %8.1f MB/s\n", name, size, ns,
+        size / ns * 1.0e3);
+}
+
+static int
+run(const uint8_t *data, size_t size, unsigned long iterations)
+{
+    struct sol_buffer encoded = SOL_BUFFER_INIT_EMPTY;
+    struct sol_buffer decoded = SOL_BUFFER_INIT_EMPTY;
+    struct sol_str_slice input = SOL_STR_SLICE_STR((const char *)data, size);
+    const char *const maps[] = { SOL_BASE64_MAP, custom_map };
+    const char *const names[] = { "default", "custom" };
+    struct timespec start;
+    unsigned long i;
+    unsigned int m;
+    char name[32];
+    int r = 0;
+
+    for (m = 0; m < SOL_UTIL_ARRAY_SIZE(maps); m++) {
+        start = sol_util_timespec_get_current();
+        for (i = 0; i < iterations && r == 0; i++) {
+            encoded.used = 0;
+            r = sol_buffer_append_as_base64(&encoded, input, maps[m]);
+        }
+        if (r < 0)
+            goto end;
+        snprintf(name, sizeof(name), "base64 encode %s", names[m]);
+        report(name, size, &start, iterations);
+
+        start = sol_util_timespec_get_current();
+        for (i = 0; i < iterations && r == 0; i++) {
+            decoded.used = 0;
+            r = sol_buffer_append_from_base64(&decoded,
+                sol_buffer_get_slice(&encoded), maps[m]);
+        }
+        if (r < 0)
+            goto end;
+        snprintf(name, sizeof(name), "base64 decode %s", names[m]);
+        report(name, size, &start, iterations);
+    }
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < iterations && r == 0; i++) {
+        encoded.used = 0;
+        r = sol_buffer_append_as_base16(&encoded, input, false);
+    }
+    if (r < 0)
+        goto end;
+    report("base16 encode", size, &start, iterations);
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < iterations && r == 0; i++) {
+        decoded.used = 0;
+        r = sol_buffer_append_from_base16(&decoded,
+            sol_buffer_get_slice(&encoded), SOL_DECODE_BOTH);
+    }
+    if (r < 0)
+        goto end;
+    report("base16 decode", size, &start, iterations);
+
+    if (decoded.used != size || memcmp(decoded.data, data, size) != 0)
+        r = -EBADMSG;
+
+end:
+    sol_buffer_fini(&encoded);
+    sol_buffer_fini(&decoded);
+    return r;
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const size_t sizes[] = { 32, 256, 4096, 65536 };
+    unsigned long iterations = 2000000;
+    uint8_t *data;
+    unsigned int i;
+    int r = 0;
+
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 10);
+        if (!iterations) {
+            fprintf(stderr, "Usage:\n\t%s [iterations]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    data = malloc(sizes[SOL_UTIL_ARRAY_SIZE(sizes) - 1]);
+    if (!data)
+        return EXIT_FAILURE;
+    for (i = 0; i < sizes[SOL_UTIL_ARRAY_SIZE(sizes) - 1]; i++)
+        data[i] = i * 37 + 11;
+
+    r = sol_init();
+    if (r < 0)
+        goto end;
+
+    /* the same amount of bytes for every size */
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(sizes) && r == 0; i++)
+        r = run(data, sizes[i], iterations / (sizes[i] / sizes[0]));
+
+    if (r < 0)
+        fprintf(stderr, "ERROR: %s\n", sol_util_strerrora(-r));
+
+    sol_shutdown();
+
+end:
+    free(data);
+    return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
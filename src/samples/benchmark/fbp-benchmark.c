@@ -0,0 +1,142 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures how long loading a flow takes: a parser is created, the
+ * FBP is parsed into a node type and everything is released again,
+ * which exercises the many small node, port and option strings kept
+ * in the parser's and graph's arenas. The FBP is either read from the
+ * given file or generated as a chain of the given number of nodes.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "soletta.h"
+#include "sol-buffer.h"
+#include "sol-flow-parser.h"
+#include "sol-util.h"
+#include "sol-util-file.h"
+
+static double
+elapsed_ns(const struct timespec *start)
+{
+    struct timespec now, elapsed;
+
+    now = sol_util_timespec_get_current();
+    sol_util_timespec_sub(&now, start, &elapsed);
+    return elapsed.tv_sec * 1.0e9 + elapsed.tv_nsec;
+}
+
+static int
+generate(struct sol_buffer *buf, unsigned long nodes)
+{
+    unsigned long i;
+    int r;
+
+    r = sol_buffer_append_printf(buf, "n0(boolean/not)\n");
+    for (i = 1; r == 0 && i < nodes; i++)
+        r = sol_buffer_append_printf(buf,
+            "n%lu OUT -> IN n%lu(boolean/not)\n", i - 1, i);
+
+    return r;
+}
+
+static int
+parse(const struct sol_buffer *buf, const char *filename)
+{
+    struct sol_flow_parser *parser;
+    int r = 0;
+
+    parser = sol_flow_parser_new(NULL, NULL);
+    if (!parser)
+        return -ENOMEM;
+
+    if (!sol_flow_parse_buffer(parser, buf->data, buf->used, filename))
+        r = -EINVAL;
+
+    sol_flow_parser_del(parser);
+    return r;
+}
+
+int
+main(int argc, char *argv[])
+{
+    struct sol_buffer buf = SOL_BUFFER_INIT_EMPTY;
+    const char *filename = "generated.fbp";
+    unsigned long nodes = 5000, iterations = 20, i;
+    struct timespec start;
+    char *end;
+    double ns;
+    int r;
+
+    if (argc > 1) {
+        nodes = strtoul(argv[1], &end, 10);
+        if (*end != '\0') {
+            filename = argv[1];
+            nodes = 0;
+        }
+        if (argc > 2)
+            iterations = strtoul(argv[2], NULL, 10);
+        if ((!nodes && filename != argv[1]) || !iterations) {
+            fprintf(stderr, "Usage:\n\t%s [nodes|file.fbp] [iterations]\n",
+                argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    r = sol_init();
+    if (r < 0)
+        return EXIT_FAILURE;
+
+    if (nodes)
+        r = generate(&buf, nodes);
+    else
+        r = sol_util_load_file_buffer(filename, &buf);
+    if (r < 0)
+        goto end;
+
+    /* warms up the resolver and the allocator */
+    r = parse(&buf, filename);
+    if (r < 0)
+        goto end;
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < iterations && r == 0; i++)
+        r = parse(&buf, filename);
+    if (r < 0)
+        goto end;
+    ns = elapsed_ns(&start) / iterations;
+
+    printf("%s: %zu bytes", filename, buf.used);
+    if (nodes)
+        printf(", %lu nodes", nodes);
+    printf(", %lu iterations: %.3f ms/load", iterations, ns / 1.0e6);
+    if (nodes)
+        printf(", %.0f nodes/s", nodes / ns * 1.0e9);
+    putchar('\n');
+
+end:
+    if (r < 0)
+        fprintf(stderr, "ERROR: %s\n", sol_util_strerrora(-r));
+    sol_buffer_fini(&buf);
+    sol_shutdown();
+
+    return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
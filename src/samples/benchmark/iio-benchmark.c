@@ -0,0 +1,235 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures latency of non buffered IIO channel readings
+ * (sol_iio_read_channel_value()) of a 3 axis accelerometer on a fake
+ * sysfs tree created on a temporary directory, next to the same
+ * readings done the way IIO used to do them: sol_util_read_file()
+ * (open, fscanf, close) of channel attribute for every reading.
+ */
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "soletta.h"
+#include "sol-iio.h"
+#include "sol-util.h"
+#include "sol-util-file.h"
+
+#define AXES 3
+
+static const char *const axes[AXES] = {
+    "in_accel_x", "in_accel_y", "in_accel_z"
+};
+
+static const char *const attributes[] = {
+    "raw", "scale", "offset"
+};
+
+static char root[] = "/tmp/sol-iio-benchmark-XXXXXX";
+static char device_dir[PATH_MAX];
+static unsigned int iterations = 100000;
+static struct timespec start;
+
+static double
+elapsed_ns(void)
+{
+    struct timespec now, elapsed;
+
+    now = sol_util_timespec_get_current();
+    sol_util_timespec_sub(&now, &start, &elapsed);
+    return elapsed.tv_sec * 1.0e9 + elapsed.tv_nsec;
+}
+
+static int
+write_attribute(const char *name, const char *value)
+{
+    char path[PATH_MAX];
+    int r;
+
+    r = snprintf(path, sizeof(path), "%s/%s", device_dir, name);
+    if (r < 0 || (size_t)r >= sizeof(path))
+        return -ENAMETOOLONG;
+
+    return sol_util_write_file(path, "%s\n", value);
+}
+
+static int
+create_tree(void)
+{
+    char name[NAME_MAX];
+    unsigned int i, j;
+    int r;
+
+    if (!mkdtemp(root))
+        return -errno;
+
+    r = snprintf(device_dir, sizeof(device_dir), "%s/iio:device0", root);
+    if (r < 0 || (size_t)r >= sizeof(device_dir))
+        return -ENAMETOOLONG;
+    if (mkdir(device_dir, 0700) < 0)
+        return -errno;
+
+    r = write_attribute("name", "fake_accel");
+    if (r < 0)
+        return r;
+
+    for (i = 0; i < AXES; i++) {
+        for (j = 0; j < SOL_UTIL_ARRAY_SIZE(attributes); j++) {
+            snprintf(name, sizeof(name), "%s_%s", axes[i], attributes[j]);
+            r = write_attribute(name, j == 0 ? "-1234" :
+                j == 1 ? "0.000598" : "0");
+            if (r < 0)
+                return r;
+        }
+    }
+
+    return 0;
+}
+
+static void
+remove_tree(void)
+{
+    char name[NAME_MAX];
+    char path[PATH_MAX];
+    unsigned int i, j;
+
+    for (i = 0; i < AXES; i++) {
+        for (j = 0; j < SOL_UTIL_ARRAY_SIZE(attributes); j++) {
+            snprintf(name, sizeof(name), "%s_%s", axes[i], attributes[j]);
+            snprintf(path, sizeof(path), "%s/%s", device_dir, name);
+            unlink(path);
+        }
+    }
+    snprintf(path, sizeof(path), "%s/name", device_dir);
+    unlink(path);
+    rmdir(device_dir);
+    rmdir(root);
+}
+
+static int
+baseline_read(void)
+{
+    char paths[AXES][PATH_MAX];
+    unsigned int i;
+    int64_t value;
+    int r;
+
+    for (i = 0; i < AXES; i++)
+        snprintf(paths[i], sizeof(paths[i]), "%s/%s_raw", device_dir, axes[i]);
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < iterations; i++) {
+        r = sol_util_read_file(paths[i % AXES], "%" SCNd64, &value);
+        if (r < 0)
+            return r;
+    }
+
+    printf("%-32s %10.0f ns/op\n", "read (sol_util_read_file)",
+        elapsed_ns() / iterations);
+    return 0;
+}
+
+static int
+iio_read(void)
+{
+    struct sol_iio_config config = {
+        SOL_SET_API_VERSION(.api_version = SOL_IIO_CONFIG_API_VERSION, )
+        .buffer_size = -1,
+        .sampling_frequency = -1,
+    };
+    struct sol_iio_channel_config channel_config = SOL_IIO_CHANNEL_CONFIG_INIT;
+    struct sol_iio_channel *channels[AXES];
+    struct sol_iio_device *device;
+    unsigned int i;
+    double value;
+    int r = 0;
+
+    device = sol_iio_open(0, &config);
+    if (!device)
+        return -ENODEV;
+
+    for (i = 0; i < AXES; i++) {
+        channels[i] = sol_iio_add_channel(device, axes[i], &channel_config);
+        if (!channels[i]) {
+            r = -ENODEV;
+            goto end;
+        }
+    }
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < iterations; i++) {
+        if (!sol_iio_read_channel_value(channels[i % AXES], &value)) {
+            r = -EIO;
+            goto end;
+        }
+    }
+
+    printf("%-32s %10.0f ns/op\n", "read (sol_iio)",
+        elapsed_ns() / iterations);
+
+end:
+    sol_iio_close(device);
+    return r;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int r;
+
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 10);
+        if (!iterations) {
+            fprintf(stderr, "Usage:\n\t%s [iterations]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    r = create_tree();
+    if (r < 0)
+        goto end;
+
+    setenv("SOL_IIO_SYSFS_DEVICES_PATH", root, 1);
+
+    r = sol_init();
+    if (r < 0)
+        goto end;
+
+    r = baseline_read();
+    if (r >= 0)
+        r = iio_read();
+
+    sol_shutdown();
+end:
+    remove_tree();
+
+    if (r < 0) {
+        fprintf(stderr, "ERROR: %s\n", sol_util_strerrora(-r));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
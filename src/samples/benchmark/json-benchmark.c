@@ -0,0 +1,198 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures the JSON tokenizer (sol_json_scanner_next()) and string
+ * unescaping over a few payload shapes commonly seen when ingesting
+ * cloud or sensor data. Run with SOL_JSON_SCAN=scalar or
+ * SOL_JSON_SCAN=sse2 to compare against the fallback implementations.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "soletta.h"
+#include "sol-buffer.h"
+#include "sol-json.h"
+#include "sol-util.h"
+
+#define PAYLOAD_SIZE (256 * 1024)
+
+struct payload {
+    const char *name;
+    int (*fill)(struct sol_buffer *buf, unsigned int i);
+};
+
+static int
+fill_telemetry(struct sol_buffer *buf, unsigned int i)
+{
+    return sol_buffer_append_printf(buf,
+        "%s{\"id\":%u,\"device\":\"sensor-%04u\",\"ts\":14%08u,"
+        "\"temperature\":%d.%02u,\"humidity\":%u.%u,\"online\":%s,"
+        "\"tags\":[\"indoor\",\"floor-%u\"],\"battery\":null}",
+        i ? "," : "", i, i % 1000, i * 37, 15 + (int)(i % 20), i % 100,
+        30 + i % 60, i % 10, i % 3 ? "true" : "false", i % 8);
+}
+
+static int
+fill_pretty(struct sol_buffer *buf, unsigned int i)
+{
+    return sol_buffer_append_printf(buf,
+        "%s\n    {\n        \"id\": %u,\n        \"name\": \"item number %u\",\n"
+        "        \"position\": {\n            \"x\": %u.%u,\n            \"y\": -%u.%u\n"
+        "        },\n        \"enabled\": %s\n    }",
+        i ? "," : "", i, i, i % 500, i % 7, i % 300, i % 9,
+        i % 2 ? "true" : "false");
+}
+
+static int
+fill_text(struct sol_buffer *buf, unsigned int i)
+{
+    return sol_buffer_append_printf(buf,
+        "%s{\"title\":\"Message %u\",\"body\":\"Lorem ipsum dolor sit amet, "
+        "consectetur adipiscing elit, sed do eiusmod tempor incididunt ut "
+        "labore et dolore magna aliqua. Ut enim ad minim veniam, quis "
+        "nostrud exercitation ullamco laboris nisi ut aliquip ex ea commodo "
+        "consequat.\\nDuis aute irure dolor in \\\"reprehenderit\\\" in "
+        "voluptate velit esse cillum dolore eu fugiat nulla pariatur.\","
+        "\"path\":\"C:\\\\data\\\\%u\\\\log.txt\",\"sign\":\"\\u00e9\"}",
+        i ? "," : "", i, i);
+}
+
+static int
+fill_numbers(struct sol_buffer *buf, unsigned int i)
+{
+    return sol_buffer_append_printf(buf,
+        "%s%u.%06u,-%u,%ue-%u,1234567890123456,%u",
+        i ? "," : "", i * 7919, i % 1000000, i * 31, i % 97 + 1, i % 12,
+        i * 104729);
+}
+
+static const struct payload payloads[] = {
+    { "telemetry (compact objects)", fill_telemetry },
+    { "pretty printed objects", fill_pretty },
+    { "text with escapes", fill_text },
+    { "number arrays", fill_numbers },
+};
+
+static int
+payload_build(const struct payload *payload, struct sol_buffer *buf)
+{
+    unsigned int i;
+    int r;
+
+    r = sol_buffer_append_char(buf, '[');
+    for (i = 0; r >= 0 && buf->used < PAYLOAD_SIZE; i++)
+        r = payload->fill(buf, i);
+    if (r >= 0)
+        r = sol_buffer_append_char(buf, ']');
+
+    return r;
+}
+
+static int
+scan(const struct sol_buffer *buf, size_t *tokens)
+{
+    struct sol_json_scanner scanner;
+    struct sol_json_token token;
+    struct sol_buffer str;
+    int r;
+
+    sol_json_scanner_init(&scanner, buf->data, buf->used);
+    while (sol_json_scanner_next(&scanner, &token)) {
+        (*tokens)++;
+        if (sol_json_token_get_type(&token) != SOL_JSON_TYPE_STRING)
+            continue;
+
+        r = sol_json_token_get_unescaped_string(&token, &str);
+        if (r < 0)
+            return r;
+        sol_buffer_fini(&str);
+    }
+
+    return errno ? -errno : 0;
+}
+
+static int
+run(const struct payload *payload, unsigned int iterations)
+{
+    struct sol_buffer buf = SOL_BUFFER_INIT_EMPTY;
+    struct timespec start, now, elapsed;
+    size_t tokens = 0;
+    unsigned int i;
+    double seconds;
+    int r;
+
+    r = payload_build(payload, &buf);
+    if (r < 0)
+        goto end;
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < iterations; i++) {
+        r = scan(&buf, &tokens);
+        if (r < 0)
+            goto end;
+    }
+    now = sol_util_timespec_get_current();
+    sol_util_timespec_sub(&now, &start, &elapsed);
+    seconds = elapsed.tv_sec + (double)elapsed.tv_nsec / SOL_NSEC_PER_SEC;
+
+    printf("%-30s %8zu bytes %10zu tokens %9.1f MB/s %8.1f Mtokens/s\n",
+        payload->name, buf.used, tokens / iterations,
+        (double)buf.used * iterations / seconds / 1.0e6,
+        (double)tokens / seconds / 1.0e6);
+
+end:
+    sol_buffer_fini(&buf);
+    return r;
+}
+
+int
+main(int argc, char *argv[])
+{
+    unsigned int iterations = 200;
+    size_t i;
+    int r;
+
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 10);
+        if (!iterations) {
+            fprintf(stderr, "Usage:\n\t%s [iterations]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    r = sol_init();
+    if (r < 0)
+        return EXIT_FAILURE;
+
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(payloads); i++) {
+        r = run(&payloads[i], iterations);
+        if (r < 0) {
+            fprintf(stderr, "ERROR: could not scan '%s': %s\n",
+                payloads[i].name, sol_util_strerrora(-r));
+            break;
+        }
+    }
+
+    sol_shutdown();
+
+    return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,174 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures how long the logging thread is kept busy by each message,
+ * printing to a file (/dev/null by default) with the writer in the
+ * caller's thread and with the asynchronous writer thread
+ * (sol_log_set_async()), also deferring the formatting to it
+ * (sol_log_set_binary()), from one and from several threads at once.
+ * The total time, including the writer catching up, and the number of
+ * messages it dropped are also given.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sol-log.h"
+#include "sol-mainloop.h"
+#include "sol-util.h"
+
+static unsigned int iterations = 100000;
+static unsigned int threads = 4;
+static struct sol_log_domain domain = {
+    .color = SOL_LOG_COLOR_CYAN,
+    .name = "benchmark",
+    .level = SOL_LOG_LEVEL_INFO,
+};
+
+static double
+elapsed_ns(const struct timespec *start)
+{
+    struct timespec now, elapsed;
+
+    now = sol_util_timespec_get_current();
+    sol_util_timespec_sub(&now, start, &elapsed);
+    return elapsed.tv_sec * 1.0e9 + elapsed.tv_nsec;
+}
+
+static void *
+log_messages(void *data)
+{
+    unsigned int i;
+
+    for (i = 0; i < iterations; i++)
+        sol_log_print(&domain, SOL_LOG_LEVEL_INFO, __FILE__, __PRETTY_FUNCTION__,
+            __LINE__, "message %u of %u, value=%f", i, iterations, i * 0.5);
+
+    return NULL;
+}
+
+enum mode {
+    MODE_SYNC,
+    MODE_ASYNC,
+    MODE_BINARY
+};
+
+static int
+run(const char *name, enum mode mode, unsigned int nthreads)
+{
+    pthread_t tids[nthreads];
+    struct timespec start;
+    uint64_t dropped;
+    double caller, total;
+    unsigned int i, n;
+    int r;
+
+    r = sol_log_set_async(mode != MODE_SYNC);
+    if (r < 0)
+        return r;
+    r = sol_log_set_binary(mode == MODE_BINARY);
+    if (r < 0)
+        return r;
+
+    dropped = sol_log_get_async_dropped();
+    start = sol_util_timespec_get_current();
+
+    for (n = 0; n < nthreads; n++) {
+        if (pthread_create(tids + n, NULL, log_messages, NULL))
+            break;
+    }
+    for (i = 0; i < n; i++)
+        pthread_join(tids[i], NULL);
+    caller = elapsed_ns(&start);
+
+    /* waits for the writer to catch up */
+    sol_log_set_binary(false);
+    sol_log_set_async(false);
+    total = elapsed_ns(&start);
+
+    if (n < nthreads)
+        return -EAGAIN;
+
+    n *= iterations;
+    printf("%-40s %10.0f ns/msg %10.0f ns/msg total, %" PRIu64 " dropped\n",
+        name, caller / n, total / n, sol_log_get_async_dropped() - dropped);
+
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    const char *path = "/dev/null";
+    FILE *fp;
+    int r;
+
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 10);
+        if (argc > 2)
+            threads = strtoul(argv[2], NULL, 10);
+        if (argc > 3)
+            path = argv[3];
+        if (!iterations || !threads) {
+            fprintf(stderr, "Usage:\n\t%s [iterations] [threads] [file]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    r = sol_init();
+    if (r < 0) {
+        fprintf(stderr, "ERROR: %s\n", sol_util_strerrora(-r));
+        return EXIT_FAILURE;
+    }
+
+    fp = fopen(path, "we");
+    if (!fp) {
+        fprintf(stderr, "ERROR: could not open %s: %s\n", path,
+            sol_util_strerrora(errno));
+        sol_shutdown();
+        return EXIT_FAILURE;
+    }
+
+    sol_log_set_print_function(sol_log_print_function_file, fp);
+
+    printf("%u messages per thread, N=%u threads, to %s\n", iterations,
+        threads, path);
+
+    r = run("1 thread, sync", MODE_SYNC, 1);
+    if (r == 0)
+        r = run("1 thread, async", MODE_ASYNC, 1);
+    if (r == 0)
+        r = run("1 thread, async binary", MODE_BINARY, 1);
+    if (r == 0)
+        r = run("N threads, sync", MODE_SYNC, threads);
+    if (r == 0)
+        r = run("N threads, async", MODE_ASYNC, threads);
+    if (r == 0)
+        r = run("N threads, async binary", MODE_BINARY, threads);
+    if (r < 0)
+        fprintf(stderr, "ERROR: %s\n", sol_util_strerrora(-r));
+
+    sol_log_set_print_function(sol_log_print_function_stderr, NULL);
+    fclose(fp);
+    sol_shutdown();
+
+    return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,281 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures read and write latency of the memory mapped storage
+ * (sol_memmap_read_int32() and sol_memmap_write_int32()) on a
+ * regular file, next to the same accesses done the way the storage
+ * used to do them: open()/lseek()/read() for every read and
+ * fopen()/fseek()/fwrite() for every batch of writes.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "soletta.h"
+#include "sol-memmap-storage.h"
+#include "sol-util.h"
+
+#define FILE_SIZE 4096
+#define BATCH 8
+
+SOL_MEMMAP_ENTRY(version_entry, 0, 1);
+SOL_MEMMAP_ENTRY(value0_entry, 4, 4);
+SOL_MEMMAP_ENTRY(value1_entry, 8, 4);
+SOL_MEMMAP_ENTRY(value2_entry, 12, 4);
+SOL_MEMMAP_ENTRY(value3_entry, 16, 4);
+SOL_MEMMAP_ENTRY(value4_entry, 20, 4);
+SOL_MEMMAP_ENTRY(value5_entry, 24, 4);
+SOL_MEMMAP_ENTRY(value6_entry, 28, 4);
+SOL_MEMMAP_ENTRY(value7_entry, 32, 4);
+
+static const struct sol_str_table_ptr entries[] = {
+    SOL_STR_TABLE_PTR_ITEM(MEMMAP_VERSION_ENTRY, &version_entry),
+    SOL_STR_TABLE_PTR_ITEM("value0", &value0_entry),
+    SOL_STR_TABLE_PTR_ITEM("value1", &value1_entry),
+    SOL_STR_TABLE_PTR_ITEM("value2", &value2_entry),
+    SOL_STR_TABLE_PTR_ITEM("value3", &value3_entry),
+    SOL_STR_TABLE_PTR_ITEM("value4", &value4_entry),
+    SOL_STR_TABLE_PTR_ITEM("value5", &value5_entry),
+    SOL_STR_TABLE_PTR_ITEM("value6", &value6_entry),
+    SOL_STR_TABLE_PTR_ITEM("value7", &value7_entry),
+    { }
+};
+
+static const char *const names[BATCH] = {
+    "value0", "value1", "value2", "value3",
+    "value4", "value5", "value6", "value7",
+};
+
+static struct sol_memmap_map map = {
+    .api_version = 1,
+    .timeout = 0,
+    .entries = entries
+};
+
+static char path[] = "/tmp/sol-memmap-benchmark-XXXXXX";
+static unsigned int iterations = 100000;
+static unsigned int written, batches;
+static struct timespec start;
+static int result;
+
+static double
+elapsed_ns(void)
+{
+    struct timespec now, elapsed;
+
+    now = sol_util_timespec_get_current();
+    sol_util_timespec_sub(&now, &start, &elapsed);
+    return elapsed.tv_sec * 1.0e9 + elapsed.tv_nsec;
+}
+
+static int
+baseline_read(void)
+{
+    unsigned int i;
+    int32_t value;
+    int fd;
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < iterations; i++) {
+        fd = open(path, O_RDWR | O_CLOEXEC);
+        if (fd < 0)
+            return -errno;
+        if (lseek(fd, (i % BATCH) * 4 + 4, SEEK_SET) < 0 ||
+            read(fd, &value, sizeof(value)) != sizeof(value)) {
+            close(fd);
+            return -EIO;
+        }
+        close(fd);
+    }
+
+    printf("%-32s %10.0f ns/op\n", "read (open+lseek+read)",
+        elapsed_ns() / iterations);
+    return 0;
+}
+
+static int
+memmap_read(void)
+{
+    unsigned int i;
+    int32_t value;
+    int r;
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < iterations; i++) {
+        r = sol_memmap_read_int32(names[i % BATCH], &value);
+        if (r < 0)
+            return r;
+    }
+
+    printf("%-32s %10.0f ns/op\n", "read (sol_memmap)",
+        elapsed_ns() / iterations);
+    return 0;
+}
+
+static int
+baseline_write(void)
+{
+    unsigned int i, j, n = iterations / BATCH;
+    int32_t value;
+    FILE *file;
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < n; i++) {
+        file = fopen(path, "r+e");
+        if (!file)
+            return -errno;
+        for (j = 0; j < BATCH; j++) {
+            value = i + j;
+            if (fseek(file, j * 4 + 4, SEEK_SET) < 0 ||
+                fwrite(&value, sizeof(value), 1, file) != 1) {
+                fclose(file);
+                return -EIO;
+            }
+        }
+        if (fclose(file) != 0)
+            return -errno;
+    }
+
+    printf("%-32s %10.0f ns/op\n", "write (fopen+fseek+fwrite)",
+        elapsed_ns() / (n * BATCH));
+    return 0;
+}
+
+static int
+write_batch(void);
+
+static void
+write_cb(void *data, const char *name, struct sol_blob *blob, int status)
+{
+    if (status < 0 && !result)
+        result = status;
+
+    if (++written % BATCH)
+        return;
+
+    if (result < 0 || ++batches == iterations / BATCH) {
+        sol_quit();
+        return;
+    }
+
+    result = write_batch();
+    if (result < 0)
+        sol_quit();
+}
+
+static int
+write_batch(void)
+{
+    unsigned int j;
+    int r;
+
+    for (j = 0; j < BATCH; j++) {
+        r = sol_memmap_write_int32(names[j], batches + j, write_cb, NULL);
+        if (r < 0)
+            return r;
+    }
+
+    return 0;
+}
+
+static bool
+memmap_write_start(void *data)
+{
+    start = sol_util_timespec_get_current();
+
+    result = write_batch();
+    if (result < 0)
+        sol_quit();
+
+    return false;
+}
+
+static int
+memmap_write(void)
+{
+    sol_idle_add(memmap_write_start, NULL);
+    sol_run();
+    if (result < 0)
+        return result;
+
+    /* Each batch of writes is flushed on its own main loop iteration */
+    printf("%-32s %10.0f ns/op\n", "write (sol_memmap)",
+        elapsed_ns() / written);
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int fd, r;
+
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 10);
+        if (iterations < BATCH) {
+            fprintf(stderr, "Usage:\n\t%s [iterations]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    fd = mkstemp(path);
+    if (fd < 0) {
+        fprintf(stderr, "ERROR: could not create %s: %s\n", path,
+            sol_util_strerrora(errno));
+        return EXIT_FAILURE;
+    }
+    r = ftruncate(fd, FILE_SIZE);
+    close(fd);
+    if (r < 0)
+        goto end;
+    map.path = path;
+
+    r = sol_init();
+    if (r < 0)
+        goto end;
+
+    r = sol_memmap_add_map(&map);
+    if (r < 0)
+        goto shutdown;
+
+    r = baseline_read();
+    if (r >= 0)
+        r = memmap_read();
+    if (r >= 0)
+        r = baseline_write();
+    if (r >= 0)
+        r = memmap_write();
+
+    sol_memmap_remove_map(&map);
+
+shutdown:
+    sol_shutdown();
+end:
+    unlink(path);
+
+    if (r < 0) {
+        fprintf(stderr, "ERROR: %s\n", sol_util_strerrora(-r));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,226 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures latency of PWM duty cycle updates (sol_pwm_set_duty_cycle())
+ * on a fake sysfs tree created on a temporary directory, next to the
+ * same updates done the way PWM used to do them: fprintf() on an
+ * unbuffered stdio stream. Updates are done both with a new value
+ * every time, as a fading LED would, and with values repeating, as a
+ * servo holding its position would.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "soletta.h"
+#include "sol-pwm.h"
+#include "sol-util.h"
+#include "sol-util-file.h"
+
+#define PERIOD_NS 20000000
+/* Values repeat every REPEAT updates on the repeating case */
+#define REPEAT 10
+
+static const char *const attributes[] = {
+    "enable", "period", "duty_cycle", "polarity"
+};
+
+static char root[] = "/tmp/sol-pwm-benchmark-XXXXXX";
+static char chip_dir[PATH_MAX];
+static char pwm_dir[PATH_MAX];
+static unsigned int iterations = 100000;
+static struct timespec start;
+
+static double
+elapsed_ns(void)
+{
+    struct timespec now, elapsed;
+
+    now = sol_util_timespec_get_current();
+    sol_util_timespec_sub(&now, &start, &elapsed);
+    return elapsed.tv_sec * 1.0e9 + elapsed.tv_nsec;
+}
+
+static int
+create_tree(void)
+{
+    char path[PATH_MAX];
+    unsigned int i;
+    int r;
+
+    if (!mkdtemp(root))
+        return -errno;
+
+    snprintf(chip_dir, sizeof(chip_dir), "%s/pwmchip0", root);
+    snprintf(pwm_dir, sizeof(pwm_dir), "%s/pwm0", chip_dir);
+    if (mkdir(chip_dir, 0700) < 0 || mkdir(pwm_dir, 0700) < 0)
+        return -errno;
+
+    snprintf(path, sizeof(path), "%s/npwm", chip_dir);
+    r = sol_util_write_file(path, "1\n");
+    if (r < 0)
+        return r;
+
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(attributes); i++) {
+        snprintf(path, sizeof(path), "%s/%s", pwm_dir, attributes[i]);
+        r = sol_util_write_file(path, "%s\n", i == 3 ? "normal" : "0");
+        if (r < 0)
+            return r;
+    }
+
+    return 0;
+}
+
+static void
+remove_tree(void)
+{
+    char path[PATH_MAX];
+    unsigned int i;
+
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(attributes); i++) {
+        snprintf(path, sizeof(path), "%s/%s", pwm_dir, attributes[i]);
+        unlink(path);
+    }
+    snprintf(path, sizeof(path), "%s/npwm", chip_dir);
+    unlink(path);
+    rmdir(pwm_dir);
+    rmdir(chip_dir);
+    rmdir(root);
+}
+
+static uint32_t
+duty_cycle(unsigned int i, bool repeating)
+{
+    if (repeating)
+        i /= REPEAT;
+
+    return (i % 1000) * (PERIOD_NS / 1000);
+}
+
+static int
+baseline_set(bool repeating)
+{
+    char path[PATH_MAX];
+    unsigned int i;
+    FILE *fp;
+
+    snprintf(path, sizeof(path), "%s/duty_cycle", pwm_dir);
+    fp = fopen(path, "w+e");
+    if (!fp)
+        return -errno;
+    setvbuf(fp, NULL, _IONBF, 0);
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < iterations; i++) {
+        if (fprintf(fp, "%u", duty_cycle(i, repeating)) < 0) {
+            fclose(fp);
+            return -EIO;
+        }
+    }
+
+    printf("%-40s %10.0f ns/op\n", repeating ?
+        "set repeating (fprintf)" : "set (fprintf)",
+        elapsed_ns() / iterations);
+
+    fclose(fp);
+    return 0;
+}
+
+static int
+pwm_set(bool repeating)
+{
+    struct sol_pwm_config config = {
+        SOL_SET_API_VERSION(.api_version = SOL_PWM_CONFIG_API_VERSION, )
+        .period_ns = PERIOD_NS,
+        .duty_cycle_ns = 0,
+        .enabled = true,
+        .polarity = SOL_PWM_POLARITY_NORMAL,
+    };
+    struct sol_pwm *pwm;
+    unsigned int i;
+    int r = 0;
+
+    pwm = sol_pwm_open_raw(0, 0, &config);
+    if (!pwm)
+        return -ENODEV;
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < iterations; i++) {
+        if (!sol_pwm_set_duty_cycle(pwm, duty_cycle(i, repeating))) {
+            r = -EIO;
+            goto end;
+        }
+    }
+
+    printf("%-40s %10.0f ns/op\n", repeating ?
+        "set repeating (sol_pwm)" : "set (sol_pwm)",
+        elapsed_ns() / iterations);
+
+end:
+    sol_pwm_close(pwm);
+    return r;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int r;
+
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 10);
+        if (!iterations) {
+            fprintf(stderr, "Usage:\n\t%s [iterations]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    r = create_tree();
+    if (r < 0)
+        goto end;
+
+    setenv("SOL_PWM_SYSFS_PATH", root, 1);
+
+    r = sol_init();
+    if (r < 0)
+        goto end;
+
+    r = baseline_set(false);
+    if (r >= 0)
+        r = pwm_set(false);
+    if (r >= 0)
+        r = baseline_set(true);
+    if (r >= 0)
+        r = pwm_set(true);
+
+    sol_shutdown();
+end:
+    remove_tree();
+
+    if (r < 0) {
+        fprintf(stderr, "ERROR: %s\n", sol_util_strerrora(-r));
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
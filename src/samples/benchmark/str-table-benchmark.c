@@ -0,0 +1,193 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Compares sol_str_table lookups going through the whole table with
+ * the ones using a perfect hash (SOL_STR_TABLE_HASH_DECLARE()), for
+ * tables of the sizes found in the tree (copies of the log level, HTTP
+ * method and packet type tables) and a large one. Every key is looked
+ * up in turn, as well as keys that aren't in the table.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "soletta.h"
+#include "sol-str-table.h"
+#include "sol-util.h"
+
+static const struct sol_str_table boolean_table[] = {
+    SOL_STR_TABLE_ITEM("false", 0),
+    SOL_STR_TABLE_ITEM("true", 1),
+    SOL_STR_TABLE_ITEM("toggle", 2),
+    { }
+};
+
+static const struct sol_str_table http_method_table[] = {
+    SOL_STR_TABLE_ITEM("GET", 0),
+    SOL_STR_TABLE_ITEM("HEAD", 1),
+    SOL_STR_TABLE_ITEM("POST", 2),
+    SOL_STR_TABLE_ITEM("PUT", 3),
+    SOL_STR_TABLE_ITEM("DELETE", 4),
+    SOL_STR_TABLE_ITEM("CONNECT", 5),
+    SOL_STR_TABLE_ITEM("OPTIONS", 6),
+    SOL_STR_TABLE_ITEM("TRACE", 7),
+    SOL_STR_TABLE_ITEM("PATCH", 8),
+    { }
+};
+
+static const struct sol_str_table log_level_table[] = {
+    SOL_STR_TABLE_ITEM("CRI", 0),
+    SOL_STR_TABLE_ITEM("CRIT", 0),
+    SOL_STR_TABLE_ITEM("CRITICAL", 0),
+    SOL_STR_TABLE_ITEM("DBG", 4),
+    SOL_STR_TABLE_ITEM("DEBUG", 4),
+    SOL_STR_TABLE_ITEM("ERR", 1),
+    SOL_STR_TABLE_ITEM("ERROR", 1),
+    SOL_STR_TABLE_ITEM("INF", 3),
+    SOL_STR_TABLE_ITEM("INFO", 3),
+    SOL_STR_TABLE_ITEM("WARN", 2),
+    SOL_STR_TABLE_ITEM("WARNING", 2),
+    SOL_STR_TABLE_ITEM("WRN", 2),
+    { }
+};
+
+static const struct sol_str_table packet_type_table[] = {
+    SOL_STR_TABLE_ITEM("any", 0),
+    SOL_STR_TABLE_ITEM("empty", 1),
+    SOL_STR_TABLE_ITEM("int", 2),
+    SOL_STR_TABLE_ITEM("float", 3),
+    SOL_STR_TABLE_ITEM("string", 4),
+    SOL_STR_TABLE_ITEM("boolean", 5),
+    SOL_STR_TABLE_ITEM("byte", 6),
+    SOL_STR_TABLE_ITEM("blob", 7),
+    SOL_STR_TABLE_ITEM("rgb", 8),
+    SOL_STR_TABLE_ITEM("location", 9),
+    SOL_STR_TABLE_ITEM("timestamp", 10),
+    SOL_STR_TABLE_ITEM("direction-vector", 11),
+    SOL_STR_TABLE_ITEM("error", 12),
+    SOL_STR_TABLE_ITEM("json-object", 13),
+    SOL_STR_TABLE_ITEM("json-array", 14),
+    SOL_STR_TABLE_ITEM("http-response", 15),
+    { }
+};
+
+#define LARGE_TABLE_SIZE 256
+static struct sol_str_table large_table[LARGE_TABLE_SIZE + 1];
+static char large_keys[LARGE_TABLE_SIZE][16];
+
+static const struct sol_str_slice misses[] = {
+    SOL_STR_SLICE_LITERAL("x"),
+    SOL_STR_SLICE_LITERAL("unknown"),
+    SOL_STR_SLICE_LITERAL("ERRORS"),
+    SOL_STR_SLICE_LITERAL("json"),
+};
+
+static double
+elapsed_ns(const struct timespec *start)
+{
+    struct timespec now, elapsed;
+
+    now = sol_util_timespec_get_current();
+    sol_util_timespec_sub(&now, start, &elapsed);
+    return elapsed.tv_sec * 1.0e9 + elapsed.tv_nsec;
+}
+
+static void
+run(const char *name, const struct sol_str_table *table,
+    struct sol_str_table_hash *hash, unsigned long iterations)
+{
+    struct sol_str_slice keys[LARGE_TABLE_SIZE + SOL_UTIL_ARRAY_SIZE(misses)];
+    unsigned long i, lookups;
+    struct timespec start;
+    double linear_ns, hash_ns;
+    uint16_t n, j;
+    int sum = 0;
+
+    for (n = 0; table[n].key; n++)
+        keys[n] = SOL_STR_SLICE_STR(table[n].key, table[n].len);
+    for (j = 0; j < SOL_UTIL_ARRAY_SIZE(misses); j++)
+        keys[n + j] = misses[j];
+    n += SOL_UTIL_ARRAY_SIZE(misses);
+
+    /* builds the hash out of the measurements */
+    sol_str_table_hash_lookup_fallback(hash, keys[0], -1);
+
+    lookups = iterations * n;
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < iterations; i++) {
+        for (j = 0; j < n; j++)
+            sum += sol_str_table_lookup_fallback(table, keys[j], -1);
+    }
+    linear_ns = elapsed_ns(&start) / lookups;
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < iterations; i++) {
+        for (j = 0; j < n; j++)
+            sum -= sol_str_table_hash_lookup_fallback(hash, keys[j], -1);
+    }
+    hash_ns = elapsed_ns(&start) / lookups;
+
+    printf("%-24s %4u keys: linear %6.1f ns/lookup, hash %6.1f ns/lookup%s\n",
+        name, n - (uint16_t)SOL_UTIL_ARRAY_SIZE(misses), linear_ns, hash_ns,
+        sum ? " MISMATCH" : "");
+}
+
+int
+main(int argc, char *argv[])
+{
+    SOL_STR_TABLE_HASH_DECLARE(boolean_hash, boolean_table);
+    SOL_STR_TABLE_HASH_DECLARE(http_method_hash, http_method_table);
+    SOL_STR_TABLE_HASH_DECLARE(log_level_hash, log_level_table);
+    SOL_STR_TABLE_HASH_DECLARE(packet_type_hash, packet_type_table);
+    SOL_STR_TABLE_HASH_DECLARE(large_hash, large_table);
+    unsigned long iterations = 1000000;
+    unsigned int i;
+    int r;
+
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 10);
+        if (!iterations) {
+            fprintf(stderr, "Usage:\n\t%s [iterations]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    r = sol_init();
+    if (r < 0)
+        return EXIT_FAILURE;
+
+    for (i = 0; i < LARGE_TABLE_SIZE; i++) {
+        large_table[i].len = snprintf(large_keys[i], sizeof(large_keys[i]),
+            "option-%u", i);
+        large_table[i].key = large_keys[i];
+        large_table[i].val = i;
+    }
+
+    run("boolean", boolean_table, &boolean_hash, iterations);
+    run("HTTP methods", http_method_table, &http_method_hash, iterations);
+    run("log levels", log_level_table, &log_level_hash, iterations);
+    run("packet types", packet_type_table, &packet_type_hash, iterations);
+    run("large", large_table, &large_hash, iterations / 16);
+
+    sol_shutdown();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,228 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures the time from submitting a short job from the main thread
+ * until its completion is delivered back to the main thread, doing the
+ * job on a worker thread spawned for it (sol_worker_thread_new()) and
+ * on a task pool. Jobs are submitted one after the other completes
+ * (latency) and all at once (throughput).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "sol-mainloop.h"
+#include "sol-task-pool.h"
+#include "sol-util.h"
+#include "sol-worker-thread.h"
+
+static unsigned int iterations = 10000;
+static unsigned int completed;
+static unsigned int threads;
+static struct sol_task_pool *pool;
+static struct timespec start;
+static volatile uint32_t sink;
+
+static double
+elapsed_ns(void)
+{
+    struct timespec now, elapsed;
+
+    now = sol_util_timespec_get_current();
+    sol_util_timespec_sub(&now, &start, &elapsed);
+    return elapsed.tv_sec * 1.0e9 + elapsed.tv_nsec;
+}
+
+/* A short job: hash a few hundred bytes */
+static int
+job(void *data)
+{
+    uint32_t hash = 2166136261u;
+    unsigned int i;
+
+    for (i = 0; i < 256; i++)
+        hash = (hash ^ (uint8_t)(i + (uintptr_t)data)) * 16777619u;
+    sink = hash;
+
+    return 0;
+}
+
+enum stage {
+    STAGE_THREAD,
+    STAGE_POOL_LATENCY,
+    STAGE_POOL_THROUGHPUT,
+    STAGE_END
+};
+
+static const char *const stage_names[] = {
+    [STAGE_THREAD] = "latency (sol_worker_thread per job)",
+    [STAGE_POOL_LATENCY] = "latency (sol_task_pool)",
+    [STAGE_POOL_THROUGHPUT] = "throughput (sol_task_pool)",
+};
+
+static enum stage stage;
+static int result = EXIT_SUCCESS;
+
+static bool stage_start(void *data);
+
+static void
+fail(const char *msg)
+{
+    fprintf(stderr, "ERROR: %s\n", msg);
+    result = EXIT_FAILURE;
+    sol_quit();
+}
+
+static bool
+job_completed(void)
+{
+    if (++completed < iterations)
+        return false;
+
+    printf("%-40s %10.0f ns/job\n", stage_names[stage],
+        elapsed_ns() / iterations);
+    stage++;
+    sol_idle_add(stage_start, NULL);
+    return true;
+}
+
+static bool
+thread_iterate(void *data)
+{
+    job(data);
+    return false;
+}
+
+static void thread_finished(void *data);
+
+static bool
+thread_submit(void)
+{
+    struct sol_worker_thread_config config = {
+        SOL_SET_API_VERSION(.api_version = SOL_WORKER_THREAD_CONFIG_API_VERSION, )
+        .iterate = thread_iterate,
+        .finished = thread_finished,
+    };
+
+    if (sol_worker_thread_new(&config))
+        return true;
+
+    fail("could not create worker thread");
+    return false;
+}
+
+static void
+thread_finished(void *data)
+{
+    if (!job_completed())
+        thread_submit();
+}
+
+static void pool_done(void *data, int status);
+
+static bool
+pool_submit(void)
+{
+    if (sol_task_pool_submit(pool, job, pool_done, NULL))
+        return true;
+
+    fail("could not submit task");
+    return false;
+}
+
+static void
+pool_done(void *data, int status)
+{
+    /* Latency: one task at a time, the next one is submitted from here */
+    if (!job_completed() && stage == STAGE_POOL_LATENCY)
+        pool_submit();
+}
+
+static bool
+stage_start(void *data)
+{
+    unsigned int i;
+
+    completed = 0;
+    start = sol_util_timespec_get_current();
+
+    switch (stage) {
+    case STAGE_THREAD:
+        thread_submit();
+        break;
+    case STAGE_POOL_LATENCY:
+        pool_submit();
+        break;
+    case STAGE_POOL_THROUGHPUT:
+        /* Throughput: all tasks at once */
+        for (i = 0; i < iterations; i++) {
+            if (!pool_submit())
+                break;
+        }
+        break;
+    case STAGE_END:
+        sol_quit();
+        break;
+    }
+
+    return false;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int r;
+
+    if (argc > 1) {
+        iterations = strtoul(argv[1], NULL, 10);
+        if (argc > 2)
+            threads = strtoul(argv[2], NULL, 10);
+        if (!iterations) {
+            fprintf(stderr, "Usage:\n\t%s [iterations] [threads]\n", argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    r = sol_init();
+    if (r < 0) {
+        fprintf(stderr, "ERROR: %s\n", sol_util_strerrora(-r));
+        return EXIT_FAILURE;
+    }
+
+    pool = sol_task_pool_new(&(struct sol_task_pool_config) {
+            SOL_SET_API_VERSION(.api_version = SOL_TASK_POOL_CONFIG_API_VERSION, )
+            .threads = threads
+        });
+    if (!pool) {
+        fprintf(stderr, "ERROR: could not create task pool\n");
+        sol_shutdown();
+        return EXIT_FAILURE;
+    }
+
+    printf("%u jobs, %u pool threads\n", iterations,
+        sol_task_pool_get_thread_count(pool));
+
+    sol_idle_add(stage_start, NULL);
+    sol_run();
+
+    sol_task_pool_del(pool);
+    sol_shutdown();
+
+    return result;
+}
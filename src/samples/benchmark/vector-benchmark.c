@@ -0,0 +1,189 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*
+ * Measures sol_vector and sol_ptr_vector append and delete throughput
+ * with the access patterns of the mainloop and protocol internals:
+ * growing a vector and draining it from the end, adding and removing
+ * a single element right at a power of two (which used to realloc()
+ * on every operation), keeping pointers sorted as timeouts do and
+ * removing entries from the front like the pending reply queues.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "soletta.h"
+#include "sol-util.h"
+#include "sol-vector.h"
+
+struct elem {
+    uint64_t key;
+    void *data;
+};
+
+static double
+elapsed_ns(const struct timespec *start)
+{
+    struct timespec now, elapsed;
+
+    now = sol_util_timespec_get_current();
+    sol_util_timespec_sub(&now, start, &elapsed);
+    return elapsed.tv_sec * 1.0e9 + elapsed.tv_nsec;
+}
+
+static void
+report(const char *name, const struct timespec *start, uint32_t ops)
+{
+    double ns = elapsed_ns(start);
+
+    printf("%-40s %10" PRIu32 " ops %8.1f ns/op %8.2f Mops/s\n", name, ops,
+        ns / ops, ops / ns * 1.0e3);
+}
+
+static int
+append_then_drain(uint32_t elements)
+{
+    struct sol_vector v = SOL_VECTOR_INIT(struct elem);
+    struct timespec start;
+    struct elem *e;
+    uint32_t i;
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < elements; i++) {
+        e = sol_vector_append(&v);
+        if (!e)
+            goto error;
+        e->key = i;
+    }
+    report("append", &start, elements);
+
+    start = sol_util_timespec_get_current();
+    while (v.len > 0)
+        sol_vector_del_last(&v);
+    report("delete last", &start, elements);
+
+    return 0;
+
+error:
+    sol_vector_clear(&v);
+    return -errno;
+}
+
+static int
+churn_at_power_of_two(uint32_t elements)
+{
+    struct sol_vector v = SOL_VECTOR_INIT(struct elem);
+    struct timespec start;
+    uint32_t i;
+    int r = 0;
+
+    /* 1024 is full, the next append grows it and the delete used to
+     * shrink it right back */
+    if (!sol_vector_append_n(&v, 1024))
+        return -errno;
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < elements; i++) {
+        if (!sol_vector_append(&v)) {
+            r = -errno;
+            break;
+        }
+        sol_vector_del_last(&v);
+    }
+    if (r == 0)
+        report("append + delete last at 1024 elements", &start, elements * 2);
+
+    sol_vector_clear(&v);
+    return r;
+}
+
+static int
+compare_ptr(const void *data1, const void *data2)
+{
+    uintptr_t a = (uintptr_t)data1, b = (uintptr_t)data2;
+
+    return (a > b) - (a < b);
+}
+
+static int
+sorted_then_drain_front(uint32_t elements)
+{
+    struct sol_ptr_vector pv = SOL_PTR_VECTOR_INIT;
+    struct timespec start;
+    uint32_t i, key = 1;
+    int32_t r = 0;
+
+    start = sol_util_timespec_get_current();
+    for (i = 0; i < elements; i++) {
+        /* spread over the vector, as timeouts with random intervals */
+        key = key * 1103515245 + 12345;
+        r = sol_ptr_vector_insert_sorted(&pv, (void *)(uintptr_t)key,
+            compare_ptr);
+        if (r < 0)
+            break;
+    }
+    if (r < 0) {
+        sol_ptr_vector_clear(&pv);
+        return r;
+    }
+    report("pointer insert sorted", &start, elements);
+
+    start = sol_util_timespec_get_current();
+    while (sol_ptr_vector_get_len(&pv) > 0)
+        sol_ptr_vector_del(&pv, 0);
+    report("pointer delete first", &start, elements);
+
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    uint32_t elements = 1000000, sorted = 20000;
+    int r;
+
+    if (argc > 1) {
+        elements = strtoul(argv[1], NULL, 10);
+        if (argc > 2)
+            sorted = strtoul(argv[2], NULL, 10);
+        if (!elements || elements > INT32_MAX / 2 || !sorted || sorted > INT32_MAX) {
+            fprintf(stderr, "Usage:\n\t%s [elements] [sorted elements]\n",
+                argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    r = sol_init();
+    if (r < 0)
+        return EXIT_FAILURE;
+
+    r = append_then_drain(elements);
+    if (r == 0)
+        r = churn_at_power_of_two(elements);
+    if (r == 0)
+        r = sorted_then_drain_front(sorted);
+    if (r < 0)
+        fprintf(stderr, "ERROR: %s\n", sol_util_strerrora(-r));
+
+    sol_shutdown();
+
+    return r < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
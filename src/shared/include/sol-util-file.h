@@ -25,6 +25,7 @@
 #include <sys/types.h>
 #include <stdarg.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <strings.h>
 
 #ifdef __cplusplus
@@ -193,6 +194,36 @@ int sol_util_get_rootdir(char *out, size_t size) SOL_ATTR_WARN_UNUSED_RESULT;
  */
 int sol_util_fd_set_flag(int fd, int flag) SOL_ATTR_WARN_UNUSED_RESULT;
 
+/**
+ * @brief Read a decimal integer from the start of file @a fd.
+ *
+ * Meant for attribute files as the ones on sysfs, which are kept open
+ * and read again for every new value: it uses a single @c pread() at
+ * offset 0, and doesn't go through stdio or locale. Leading blanks and
+ * a sign are accepted and parsing stops at the first non digit, as
+ * @c fscanf() would do.
+ *
+ * @param fd A valid file descriptor, opened for reading.
+ * @param value Where to store the value read.
+ *
+ * @return 0 on success, -EINVAL if there's no valid integer or
+ * -errno on errors.
+ */
+int sol_util_fd_read_int64(int fd, int64_t *value);
+
+/**
+ * @brief Write a decimal integer to the start of file @a fd.
+ *
+ * Counterpart of sol_util_fd_read_int64(), with a single @c pwrite()
+ * at offset 0. No new line is written and the file is not truncated.
+ *
+ * @param fd A valid file descriptor, opened for writing.
+ * @param value The value to be written.
+ *
+ * @return 0 on success, -errno on errors.
+ */
+int sol_util_fd_write_int64(int fd, int64_t value);
+
 /**
  * @brief Fills @a buffer with data read from file @a fd.
  *
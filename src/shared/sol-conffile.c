@@ -63,7 +63,7 @@ _entry_sort_cb(const void *data1, const void *data2)
 static void
 _free_entry(struct sol_conffile_entry *entry)
 {
-    int idx;
+    uint32_t idx;
     void *ptr;
 
     if (!entry)
@@ -95,7 +95,7 @@ static void
 _clear_entry_options(struct sol_ptr_vector *vec_options)
 {
     void *ptr;
-    int i;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_IDX (vec_options, ptr, i) {
         free(ptr);
@@ -198,7 +198,7 @@ _clear_memory_maps(void)
 {
     const struct sol_str_table_ptr *iter;
     struct sol_memmap_map *map;
-    int i;
+    uint32_t i;
 
     SOL_PTR_VECTOR_FOREACH_IDX (&_memory_maps, map, i) {
         for (iter = map->entries; iter->key; iter++) {
@@ -340,6 +340,7 @@ _parse_maps(struct sol_json_token token)
     struct sol_str_table_ptr *ptr_table_entry;
     struct sol_buffer path_buffer = { };
     void *data;
+    uint32_t idx;
     int i = 0;
     int r;
 
@@ -417,7 +418,7 @@ _parse_maps(struct sol_json_token token)
 
 error:
     free(map);
-    SOL_VECTOR_FOREACH_IDX (&entries_vector, ptr_table_entry, i) {
+    SOL_VECTOR_FOREACH_IDX (&entries_vector, ptr_table_entry, idx) {
         free((void *)ptr_table_entry->val);
     }
     sol_vector_clear(&entries_vector);
@@ -0,0 +1,609 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sol-log-binary.h"
+#include "sol-util.h"
+
+#define FILE_MAGIC "SOLLOGB"
+#define FILE_VERSION 1
+#define FILE_BYTE_ORDER 0x01020304
+
+/* sanity limit for records read from files */
+#define RECORD_MAX_SIZE (1 << 20)
+
+enum arg_type {
+    ARG_NONE,
+    ARG_INT,
+    ARG_LONG,
+    ARG_LONG_LONG,
+    ARG_INTMAX,
+    ARG_SIZE,
+    ARG_PTRDIFF,
+    ARG_POINTER,
+    ARG_DOUBLE,
+    ARG_LONG_DOUBLE,
+    ARG_STRING
+};
+
+enum arg_length {
+    LENGTH_NONE,
+    LENGTH_LONG,
+    LENGTH_LONG_LONG,
+    LENGTH_INTMAX,
+    LENGTH_SIZE,
+    LENGTH_PTRDIFF,
+    LENGTH_LONG_DOUBLE
+};
+
+struct conversion {
+    const char *end;
+    enum arg_type type;
+    bool star_width;
+    bool star_precision;
+    int precision; /* -1 if not given or given by an argument */
+};
+
+struct file_header {
+    char magic[7];
+    uint8_t version;
+    uint32_t byte_order;
+    uint32_t pid;
+    uint64_t thread;
+    uint8_t long_double_size;
+    uint8_t reserved[7];
+};
+
+struct record_header {
+    uint32_t size; /* of what follows: domain, file, function, format and args */
+    int32_t line;
+    uint64_t thread;
+    uint32_t pid;
+    uint8_t level;
+    uint8_t reserved[3];
+};
+
+static bool
+_is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/* Skips the digits of a '*' argument index, refused as it's positional */
+static bool
+_skip_star(const char **p)
+{
+    const char *itr = *p + 1;
+
+    while (_is_digit(*itr))
+        itr++;
+    if (*itr == '$')
+        return false;
+
+    *p += 1;
+    return true;
+}
+
+/* @a p points to the '%' starting the conversion */
+static bool
+_conversion_parse(const char *p, struct conversion *conv)
+{
+    enum arg_length length = LENGTH_NONE;
+
+    conv->star_width = false;
+    conv->star_precision = false;
+    conv->precision = -1;
+    p++;
+
+    if (*p == '%') {
+        conv->type = ARG_NONE;
+        conv->end = p + 1;
+        return true;
+    }
+
+    while (*p && strchr("-+ #0'I", *p))
+        p++;
+
+    if (*p == '*') {
+        if (!_skip_star(&p))
+            return false;
+        conv->star_width = true;
+    } else {
+        while (_is_digit(*p))
+            p++;
+        if (*p == '$')
+            return false;
+    }
+
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            if (!_skip_star(&p))
+                return false;
+            conv->star_precision = true;
+        } else {
+            conv->precision = 0;
+            for (; _is_digit(*p); p++) {
+                if (conv->precision > (INT_MAX - 9) / 10)
+                    return false;
+                conv->precision = conv->precision * 10 + (*p - '0');
+            }
+        }
+    }
+
+    switch (*p) {
+    case 'h':
+        p++;
+        if (*p == 'h')
+            p++;
+        break;
+    case 'l':
+        p++;
+        if (*p == 'l') {
+            p++;
+            length = LENGTH_LONG_LONG;
+        } else
+            length = LENGTH_LONG;
+        break;
+    case 'q':
+        p++;
+        length = LENGTH_LONG_LONG;
+        break;
+    case 'L':
+        p++;
+        length = LENGTH_LONG_DOUBLE;
+        break;
+    case 'j':
+        p++;
+        length = LENGTH_INTMAX;
+        break;
+    case 'z':
+        p++;
+        length = LENGTH_SIZE;
+        break;
+    case 't':
+        p++;
+        length = LENGTH_PTRDIFF;
+        break;
+    }
+
+    switch (*p) {
+    case 'd':
+    case 'i':
+    case 'o':
+    case 'u':
+    case 'x':
+    case 'X':
+        if (length == LENGTH_LONG_DOUBLE)
+            return false;
+        /* integer types are in the same order as their lengths */
+        conv->type = (enum arg_type)(ARG_INT + length);
+        break;
+    case 'c':
+        if (length != LENGTH_NONE)
+            return false;
+        conv->type = ARG_INT;
+        break;
+    case 's':
+        if (length != LENGTH_NONE)
+            return false;
+        conv->type = ARG_STRING;
+        break;
+    case 'p':
+        if (length != LENGTH_NONE)
+            return false;
+        conv->type = ARG_POINTER;
+        break;
+    case 'a':
+    case 'A':
+    case 'e':
+    case 'E':
+    case 'f':
+    case 'F':
+    case 'g':
+    case 'G':
+        if (length == LENGTH_LONG_DOUBLE)
+            conv->type = ARG_LONG_DOUBLE;
+        else if (length == LENGTH_NONE || length == LENGTH_LONG)
+            conv->type = ARG_DOUBLE;
+        else
+            return false;
+        break;
+    default:
+        /* %n, %m, wide chars or garbage */
+        return false;
+    }
+
+    conv->end = p + 1;
+    return true;
+}
+
+static bool
+_put(uint8_t **p, const uint8_t *end, const void *value, size_t len)
+{
+    if ((size_t)(end - *p) < len)
+        return false;
+
+    memcpy(*p, value, len);
+    *p += len;
+    return true;
+}
+
+static bool
+_get(const uint8_t **p, const uint8_t *end, void *value, size_t len)
+{
+    if ((size_t)(end - *p) < len)
+        return false;
+
+    memcpy(value, *p, len);
+    *p += len;
+    return true;
+}
+
+ssize_t
+sol_log_binary_pack(void *buf, size_t size, const char *format, va_list args)
+{
+    uint8_t *p = buf;
+    const uint8_t *end = p + size;
+    struct conversion conv;
+    const char *itr;
+
+    for (itr = strchr(format, '%'); itr; itr = strchr(conv.end, '%')) {
+        int64_t i = 0;
+        int precision;
+        bool ok;
+
+        if (!_conversion_parse(itr, &conv))
+            return -EINVAL;
+
+        if (conv.star_width) {
+            i = va_arg(args, int);
+            if (!_put(&p, end, &i, sizeof(i)))
+                return -ENOBUFS;
+        }
+
+        precision = conv.precision;
+        if (conv.star_precision) {
+            precision = va_arg(args, int);
+            i = precision;
+            if (!_put(&p, end, &i, sizeof(i)))
+                return -ENOBUFS;
+        }
+
+        switch (conv.type) {
+        case ARG_NONE:
+            continue;
+        case ARG_INT:
+            i = va_arg(args, int);
+            break;
+        case ARG_LONG:
+            i = va_arg(args, long);
+            break;
+        case ARG_LONG_LONG:
+            i = va_arg(args, long long);
+            break;
+        case ARG_INTMAX:
+            i = va_arg(args, intmax_t);
+            break;
+        case ARG_SIZE:
+            i = (int64_t)va_arg(args, size_t);
+            break;
+        case ARG_PTRDIFF:
+            i = va_arg(args, ptrdiff_t);
+            break;
+        case ARG_POINTER:
+            i = (int64_t)(uintptr_t)va_arg(args, void *);
+            break;
+        case ARG_DOUBLE: {
+            double d = va_arg(args, double);
+
+            ok = _put(&p, end, &d, sizeof(d));
+            goto check;
+        }
+        case ARG_LONG_DOUBLE: {
+            long double d = va_arg(args, long double);
+
+            ok = _put(&p, end, &d, sizeof(d));
+            goto check;
+        }
+        case ARG_STRING: {
+            const char *s = va_arg(args, const char *);
+            size_t len;
+
+            if (!s)
+                s = "(null)";
+            len = precision >= 0 ? strnlen(s, precision) : strlen(s);
+            ok = _put(&p, end, s, len) && _put(&p, end, "", 1);
+            goto check;
+        }
+        }
+
+        ok = _put(&p, end, &i, sizeof(i));
+check:
+        if (!ok)
+            return -ENOBUFS;
+    }
+
+    return p - (uint8_t *)buf;
+}
+
+static void
+_append(char *buf, size_t size, size_t *total, const char *str, size_t len)
+{
+    if (*total + 1 < size)
+        memcpy(buf + *total, str, len < size - 1 - *total ? len : size - 1 - *total);
+    *total += len;
+}
+
+/* Copies the conversion spec, replacing '*' by the values packed for them */
+static bool
+_spec_build(char *spec, size_t size, const char *start, const char *end, const uint8_t **p, const uint8_t *args_end)
+{
+    size_t len = 0;
+    int r;
+
+    for (; start < end; start++) {
+        int64_t value;
+
+        if (*start != '*') {
+            if (len + 1 >= size)
+                return false;
+            spec[len++] = *start;
+            continue;
+        }
+
+        if (!_get(p, args_end, &value, sizeof(value)))
+            return false;
+
+        /* negative precision is taken as if it was omitted */
+        if (value < 0 && len > 0 && spec[len - 1] == '.') {
+            len--;
+            continue;
+        }
+
+        r = snprintf(spec + len, size - len, "%d", (int)value);
+        if (r < 0 || (size_t)r >= size - len)
+            return false;
+        len += r;
+    }
+
+    spec[len] = '\0';
+    return true;
+}
+
+int
+sol_log_binary_format(char *buf, size_t size, const char *format, const void *args, size_t args_size)
+{
+    const uint8_t *p = args, *end = p + args_size;
+    struct conversion conv;
+    const char *itr, *next;
+    size_t total = 0;
+    char spec[64];
+
+    for (itr = format; (next = strchr(itr, '%')); itr = conv.end) {
+        char *out;
+        size_t avail;
+        int64_t i = 0;
+        int r;
+
+        _append(buf, size, &total, itr, next - itr);
+        out = total < size ? buf + total : NULL;
+        avail = total < size ? size - total : 0;
+
+        if (!_conversion_parse(next, &conv))
+            return -EINVAL;
+
+        if (conv.type == ARG_NONE) {
+            _append(buf, size, &total, "%", 1);
+            continue;
+        }
+
+        if (!_spec_build(spec, sizeof(spec), next, conv.end, &p, end))
+            return -EINVAL;
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+
+        switch (conv.type) {
+        case ARG_DOUBLE: {
+            double d;
+
+            if (!_get(&p, end, &d, sizeof(d)))
+                return -EINVAL;
+            r = snprintf(out, avail, spec, d);
+            break;
+        }
+        case ARG_LONG_DOUBLE: {
+            long double d;
+
+            if (!_get(&p, end, &d, sizeof(d)))
+                return -EINVAL;
+            r = snprintf(out, avail, spec, d);
+            break;
+        }
+        case ARG_STRING: {
+            const uint8_t *nul = memchr(p, '\0', end - p);
+
+            if (!nul)
+                return -EINVAL;
+            r = snprintf(out, avail, spec, (const char *)p);
+            p = nul + 1;
+            break;
+        }
+        default:
+            if (!_get(&p, end, &i, sizeof(i)))
+                return -EINVAL;
+
+            if (conv.type == ARG_INT)
+                r = snprintf(out, avail, spec, (int)i);
+            else if (conv.type == ARG_LONG)
+                r = snprintf(out, avail, spec, (long)i);
+            else if (conv.type == ARG_LONG_LONG)
+                r = snprintf(out, avail, spec, (long long)i);
+            else if (conv.type == ARG_INTMAX)
+                r = snprintf(out, avail, spec, (intmax_t)i);
+            else if (conv.type == ARG_SIZE)
+                r = snprintf(out, avail, spec, (size_t)i);
+            else if (conv.type == ARG_PTRDIFF)
+                r = snprintf(out, avail, spec, (ptrdiff_t)i);
+            else
+                r = snprintf(out, avail, spec, (void *)(uintptr_t)i);
+        }
+
+#pragma GCC diagnostic pop
+
+        if (r < 0)
+            return -EINVAL;
+        total += r;
+    }
+
+    _append(buf, size, &total, itr, strlen(itr));
+    if (size)
+        buf[total < size ? total : size - 1] = '\0';
+
+    if (total > INT_MAX)
+        return -EOVERFLOW;
+    return total;
+}
+
+int
+sol_log_binary_write_header(FILE *fp, uint64_t main_thread, uint32_t main_pid)
+{
+    struct file_header header = {
+        .version = FILE_VERSION,
+        .byte_order = FILE_BYTE_ORDER,
+        .pid = main_pid,
+        .thread = main_thread,
+        .long_double_size = sizeof(long double),
+    };
+
+    memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    if (fwrite(&header, sizeof(header), 1, fp) != 1)
+        return -EIO;
+
+    return 0;
+}
+
+int
+sol_log_binary_write(FILE *fp, const struct sol_log_binary_record *rec)
+{
+    const char *strings[] = {
+        rec->domain ? rec->domain : "",
+        rec->file,
+        rec->function,
+        rec->format
+    };
+    size_t lens[SOL_UTIL_ARRAY_SIZE(strings)], size = rec->args_size, i;
+    struct record_header header = {
+        .line = rec->line,
+        .thread = rec->thread,
+        .pid = rec->pid,
+        .level = rec->level,
+    };
+
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(strings); i++) {
+        lens[i] = strlen(strings[i]) + 1;
+        size += lens[i];
+    }
+    if (size > RECORD_MAX_SIZE)
+        return -EMSGSIZE;
+    header.size = size;
+
+    if (fwrite(&header, sizeof(header), 1, fp) != 1)
+        return -EIO;
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(strings); i++) {
+        if (fwrite(strings[i], lens[i], 1, fp) != 1)
+            return -EIO;
+    }
+    if (rec->args_size && fwrite(rec->args, rec->args_size, 1, fp) != 1)
+        return -EIO;
+
+    return 0;
+}
+
+int
+sol_log_binary_read_header(FILE *fp, uint64_t *main_thread, uint32_t *main_pid)
+{
+    struct file_header header;
+
+    if (fread(&header, sizeof(header), 1, fp) != 1)
+        return ferror(fp) ? -EIO : -EBADMSG;
+
+    if (memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0)
+        return -EBADMSG;
+
+    /* records are only readable in the same architecture */
+    if (header.version != FILE_VERSION ||
+        header.byte_order != FILE_BYTE_ORDER ||
+        header.long_double_size != sizeof(long double))
+        return -ENOTSUP;
+
+    *main_thread = header.thread;
+    *main_pid = header.pid;
+    return 0;
+}
+
+int
+sol_log_binary_read(FILE *fp, struct sol_buffer *storage, struct sol_log_binary_record *rec)
+{
+    const char **strings[] = { &rec->domain, &rec->file, &rec->function, &rec->format };
+    struct record_header header;
+    const char *p, *end, *nul;
+    size_t n, i;
+    int r;
+
+    n = fread(&header, 1, sizeof(header), fp);
+    if (n == 0 && feof(fp))
+        return -ENODATA;
+    if (n != sizeof(header))
+        return ferror(fp) ? -EIO : -EBADMSG;
+    if (header.size > RECORD_MAX_SIZE)
+        return -EBADMSG;
+
+    r = sol_buffer_ensure(storage, header.size);
+    if (r < 0)
+        return r;
+    if (fread(storage->data, 1, header.size, fp) != header.size)
+        return ferror(fp) ? -EIO : -EBADMSG;
+    storage->used = header.size;
+
+    p = storage->data;
+    end = p + header.size;
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(strings); i++) {
+        nul = memchr(p, '\0', end - p);
+        if (!nul)
+            return -EBADMSG;
+        *strings[i] = p;
+        p = nul + 1;
+    }
+
+    rec->args = p;
+    rec->args_size = end - p;
+    rec->thread = header.thread;
+    rec->pid = header.pid;
+    rec->line = header.line;
+    rec->level = header.level;
+
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+#include "sol-buffer.h"
+
+/*
+ * Binary log records: instead of formatting a message, the arguments
+ * of its printf(3) format are captured as raw values, so it can be
+ * formatted later, by the log writer thread or offline by
+ * sol-log-decode from a file of records.
+ *
+ * Packed arguments follow the order of the conversions in the format.
+ * Integers and pointers take 8 bytes, doubles 8 and long doubles
+ * sizeof(long double), all in host byte order. Strings are copied up
+ * to their precision, if any, with a terminating NUL. Formats using
+ * positional arguments, %n, %m or wide characters can't be packed and
+ * must be formatted right away.
+ */
+
+/*
+ * Packs the arguments for @a format into @a buf. The arguments are
+ * consumed, use va_copy() if they're needed afterwards.
+ *
+ * Returns the number of bytes used, -EINVAL if the format can't be
+ * packed or -ENOBUFS if @a size is not enough.
+ */
+ssize_t sol_log_binary_pack(void *buf, size_t size, const char *format, va_list args);
+
+/*
+ * Formats the arguments packed by sol_log_binary_pack(), with
+ * snprintf(3) semantics: at most @a size bytes, including the trailing
+ * NUL, are written and the length of the whole message is returned.
+ *
+ * Returns -EINVAL if @a args don't match @a format.
+ */
+int sol_log_binary_format(char *buf, size_t size, const char *format, const void *args, size_t args_size);
+
+/*
+ * A file of records starts with a header identifying the thread and
+ * the process that opened it, that is, the ones not explicitly shown
+ * in messages. It's only meant to be read in the same architecture it
+ * was written.
+ */
+struct sol_log_binary_record {
+    const char *domain;
+    const char *file;
+    const char *function;
+    const char *format;
+    const void *args;
+    size_t args_size;
+    uint64_t thread;
+    uint32_t pid;
+    int32_t line;
+    uint8_t level;
+};
+
+int sol_log_binary_write_header(FILE *fp, uint64_t main_thread, uint32_t main_pid);
+int sol_log_binary_write(FILE *fp, const struct sol_log_binary_record *rec);
+
+int sol_log_binary_read_header(FILE *fp, uint64_t *main_thread, uint32_t *main_pid);
+
+/*
+ * Reads the next record, its strings and arguments are kept in
+ * @a storage, and are valid until it's changed.
+ *
+ * Returns 0 on success, -ENODATA at the end of the file or other
+ * negative errno if the file is corrupted or truncated.
+ */
+int sol_log_binary_read(FILE *fp, struct sol_buffer *storage, struct sol_log_binary_record *rec);
@@ -106,7 +106,7 @@ sol_monitors_clear(struct sol_monitors *ms)
         return;
 
     if (ms->cleanup) {
-        int i;
+        uint32_t i;
         ms->walking++;
         for (i = 0; i < ms->entries.len; i++) {
             struct sol_monitors_entry *e;
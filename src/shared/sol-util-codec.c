@@ -0,0 +1,564 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "sol-log.h"
+#include "sol-util-internal.h"
+
+#include "sol-util-codec.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__)))
+#define UTIL_CODEC_X86 1
+#include <immintrin.h>
+#endif
+
+static size_t
+base64_encode_scalar(char *out, const uint8_t *in, size_t len, const char base64_map[SOL_STATIC_ARRAY_SIZE(65)])
+{
+    return 0;
+}
+
+static size_t
+base64_decode_scalar(uint8_t *out, const char *in, size_t len, const char base64_map[SOL_STATIC_ARRAY_SIZE(65)])
+{
+    return 0;
+}
+
+static size_t
+base16_encode_scalar(char *out, const uint8_t *in, size_t len, bool uppercase)
+{
+    return 0;
+}
+
+static size_t
+base16_decode_scalar(uint8_t *out, const char *in, size_t len, char a, char A)
+{
+    return 0;
+}
+
+static const struct sol_util_codec_ops codec_ops_scalar = {
+    .base64_encode = base64_encode_scalar,
+    .base64_decode = base64_decode_scalar,
+    .base16_encode = base16_encode_scalar,
+    .base16_decode = base16_decode_scalar,
+    .name = "scalar",
+};
+
+#ifdef UTIL_CODEC_X86
+
+static inline bool
+is_alnum(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') ||
+           (c >= 'a' && c <= 'z');
+}
+
+/* Decoding classifies characters by range instead of looking them up,
+ * so the alphabet must be A-Z, a-z, 0-9 followed by two other
+ * characters. The padding can't be any of those, otherwise trailing
+ * padding would be decoded as data.
+ */
+static bool
+base64_map_is_decodable(const char base64_map[SOL_STATIC_ARRAY_SIZE(65)])
+{
+    static const char alnum[] =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+
+    return memcmp(base64_map, alnum, sizeof(alnum) - 1) == 0 &&
+           !is_alnum(base64_map[62]) && !is_alnum(base64_map[63]) &&
+           !is_alnum(base64_map[64]) && base64_map[62] != base64_map[63] &&
+           base64_map[64] != base64_map[62] && base64_map[64] != base64_map[63];
+}
+
+#define SSSE3 __attribute__((target("ssse3")))
+
+/* lo <= v <= hi using unsigned min/max */
+static inline SSSE3 __m128i
+range_mask_ssse3(__m128i v, __m128i lo, __m128i hi)
+{
+    return _mm_and_si128(_mm_cmpeq_epi8(_mm_max_epu8(v, lo), v),
+        _mm_cmpeq_epi8(_mm_min_epu8(v, hi), v));
+}
+
+/* Spreads 12 bytes into 16 bytes holding one 6 bit value each, in
+ * output order. Every 3 bytes are shuffled into a 32 bit word as
+ * [b1 b0 b2 b1] and the multiplications shift each field into place.
+ */
+static inline SSSE3 __m128i
+base64_split_ssse3(__m128i v)
+{
+    __m128i t0, t1, t2, t3;
+
+    v = _mm_shuffle_epi8(v, _mm_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+        7, 6, 8, 7, 10, 9, 11, 10));
+    t0 = _mm_and_si128(v, _mm_set1_epi32(0x0fc0fc00));
+    t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+    t2 = _mm_and_si128(v, _mm_set1_epi32(0x003f03f0));
+    t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+
+    return _mm_or_si128(t1, t3);
+}
+
+/* The alphabet is loaded as four 16 entry tables: the low 4 bits of
+ * each value index them and the high 2 bits select the table */
+static inline SSSE3 __m128i
+base64_lookup_ssse3(__m128i v, const __m128i table[4])
+{
+    __m128i quarter, out = _mm_setzero_si128();
+    int i;
+
+    quarter = _mm_and_si128(_mm_srli_epi16(v, 4), _mm_set1_epi8(0x03));
+    for (i = 0; i < 4; i++) {
+        out = _mm_or_si128(out, _mm_and_si128(
+            _mm_cmpeq_epi8(quarter, _mm_set1_epi8(i)),
+            _mm_shuffle_epi8(table[i], v)));
+    }
+
+    return out;
+}
+
+/* Maps 16 characters to their values, valid has 0xff for every
+ * character in the alphabet */
+static inline SSSE3 __m128i
+base64_values_ssse3(__m128i v, __m128i c62, __m128i c63, __m128i *valid)
+{
+    __m128i upper, lower, digit, is62, is63;
+
+    upper = range_mask_ssse3(v, _mm_set1_epi8('A'), _mm_set1_epi8('Z'));
+    lower = range_mask_ssse3(v, _mm_set1_epi8('a'), _mm_set1_epi8('z'));
+    digit = range_mask_ssse3(v, _mm_set1_epi8('0'), _mm_set1_epi8('9'));
+    is62 = _mm_cmpeq_epi8(v, c62);
+    is63 = _mm_cmpeq_epi8(v, c63);
+
+    *valid = _mm_or_si128(_mm_or_si128(upper, lower),
+        _mm_or_si128(digit, _mm_or_si128(is62, is63)));
+
+    return _mm_or_si128(
+        _mm_or_si128(
+        _mm_and_si128(upper, _mm_sub_epi8(v, _mm_set1_epi8('A'))),
+        _mm_and_si128(lower, _mm_sub_epi8(v, _mm_set1_epi8('a' - 26)))),
+        _mm_or_si128(
+        _mm_and_si128(digit, _mm_sub_epi8(v, _mm_set1_epi8('0' - 52))),
+        _mm_or_si128(_mm_and_si128(is62, _mm_set1_epi8(62)),
+        _mm_and_si128(is63, _mm_set1_epi8(63)))));
+}
+
+/* Joins 16 values of 6 bits into 12 bytes, at the start of the
+ * register */
+static inline SSSE3 __m128i
+base64_join_ssse3(__m128i v)
+{
+    v = _mm_maddubs_epi16(v, _mm_set1_epi32(0x01400140));
+    v = _mm_madd_epi16(v, _mm_set1_epi32(0x00011000));
+    return _mm_shuffle_epi8(v, _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+        14, 13, 12, -1, -1, -1, -1));
+}
+
+static inline SSSE3 __m128i
+base16_values_ssse3(__m128i v, __m128i a, __m128i A, __m128i *valid)
+{
+    const __m128i five = _mm_set1_epi8(5);
+    __m128i digit, lower, upper;
+
+    digit = range_mask_ssse3(v, _mm_set1_epi8('0'), _mm_set1_epi8('9'));
+    lower = range_mask_ssse3(v, a, _mm_add_epi8(a, five));
+    upper = range_mask_ssse3(v, A, _mm_add_epi8(A, five));
+
+    *valid = _mm_or_si128(digit, _mm_or_si128(lower, upper));
+
+    return _mm_or_si128(
+        _mm_and_si128(digit, _mm_sub_epi8(v, _mm_set1_epi8('0'))),
+        _mm_or_si128(
+        _mm_and_si128(lower, _mm_sub_epi8(v,
+        _mm_sub_epi8(a, _mm_set1_epi8(10)))),
+        _mm_and_si128(upper, _mm_sub_epi8(v,
+        _mm_sub_epi8(A, _mm_set1_epi8(10))))));
+}
+
+static SSSE3 size_t
+base64_encode_ssse3(char *out, const uint8_t *in, size_t len, const char base64_map[SOL_STATIC_ARRAY_SIZE(65)])
+{
+    __m128i table[4];
+    size_t i, o;
+    int n;
+
+    for (n = 0; n < 4; n++)
+        table[n] = _mm_loadu_si128((const __m128i *)(base64_map + n * 16));
+
+    /* loads 16 bytes but consumes 12 */
+    for (i = 0, o = 0; len - i >= 16; i += 12, o += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+
+        _mm_storeu_si128((__m128i *)(out + o),
+            base64_lookup_ssse3(base64_split_ssse3(v), table));
+    }
+
+    return i;
+}
+
+static SSSE3 size_t
+base64_decode_ssse3(uint8_t *out, const char *in, size_t len, const char base64_map[SOL_STATIC_ARRAY_SIZE(65)])
+{
+    __m128i c62, c63, valid;
+    size_t i, o;
+    int32_t last;
+
+    if (len < 16 || !base64_map_is_decodable(base64_map))
+        return 0;
+
+    c62 = _mm_set1_epi8(base64_map[62]);
+    c63 = _mm_set1_epi8(base64_map[63]);
+
+    for (i = 0, o = 0; len - i >= 16; i += 16, o += 12) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+
+        v = base64_values_ssse3(v, c62, c63, &valid);
+        if (_mm_movemask_epi8(valid) != 0xffff)
+            break;
+
+        v = base64_join_ssse3(v);
+        _mm_storel_epi64((__m128i *)(out + o), v);
+        last = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+        memcpy(out + o + 8, &last, sizeof(last));
+    }
+
+    return i;
+}
+
+static SSSE3 size_t
+base16_encode_ssse3(char *out, const uint8_t *in, size_t len, bool uppercase)
+{
+    const __m128i low_nibble = _mm_set1_epi8(0x0f);
+    __m128i digits;
+    size_t i;
+
+    digits = _mm_loadu_si128((const __m128i *)(uppercase ?
+        "0123456789ABCDEF" : "0123456789abcdef"));
+
+    for (i = 0; len - i >= 16; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+        __m128i hi, lo;
+
+        hi = _mm_shuffle_epi8(digits,
+            _mm_and_si128(_mm_srli_epi16(v, 4), low_nibble));
+        lo = _mm_shuffle_epi8(digits, _mm_and_si128(v, low_nibble));
+        _mm_storeu_si128((__m128i *)(out + i * 2), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *)(out + i * 2 + 16),
+            _mm_unpackhi_epi8(hi, lo));
+    }
+
+    return i;
+}
+
+static SSSE3 size_t
+base16_decode_ssse3(uint8_t *out, const char *in, size_t len, char a, char A)
+{
+    const __m128i va = _mm_set1_epi8(a), vA = _mm_set1_epi8(A);
+    __m128i valid;
+    size_t i;
+
+    for (i = 0; len - i >= 16; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(in + i));
+
+        v = base16_values_ssse3(v, va, vA, &valid);
+        if (_mm_movemask_epi8(valid) != 0xffff)
+            break;
+
+        /* high nibble * 16 + low nibble */
+        v = _mm_maddubs_epi16(v, _mm_set1_epi16(0x0110));
+        _mm_storel_epi64((__m128i *)(out + i / 2), _mm_packus_epi16(v, v));
+    }
+
+    return i;
+}
+
+#undef SSSE3
+
+static const struct sol_util_codec_ops codec_ops_ssse3 = {
+    .base64_encode = base64_encode_ssse3,
+    .base64_decode = base64_decode_ssse3,
+    .base16_encode = base16_encode_ssse3,
+    .base16_decode = base16_decode_ssse3,
+    .name = "ssse3",
+};
+
+/* The AVX2 versions work on two independent 128 bit lanes, as the
+ * byte shuffles don't cross them, and leave the tail to the SSSE3
+ * ones. Those are legacy SSE code, so the upper halves of the
+ * registers are cleared before calling them: compilers don't always
+ * do it and mixing both costs more than the whole conversion of a
+ * short input.
+ */
+#define AVX2 __attribute__((target("avx2")))
+
+static inline AVX2 __m256i
+range_mask_avx2(__m256i v, __m256i lo, __m256i hi)
+{
+    return _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(v, lo), v),
+        _mm256_cmpeq_epi8(_mm256_min_epu8(v, hi), v));
+}
+
+static inline AVX2 __m256i
+base64_split_avx2(__m256i v)
+{
+    __m256i t0, t1, t2, t3;
+
+    v = _mm256_shuffle_epi8(v, _mm256_setr_epi8(1, 0, 2, 1, 4, 3, 5, 4,
+        7, 6, 8, 7, 10, 9, 11, 10, 1, 0, 2, 1, 4, 3, 5, 4,
+        7, 6, 8, 7, 10, 9, 11, 10));
+    t0 = _mm256_and_si256(v, _mm256_set1_epi32(0x0fc0fc00));
+    t1 = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+    t2 = _mm256_and_si256(v, _mm256_set1_epi32(0x003f03f0));
+    t3 = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+
+    return _mm256_or_si256(t1, t3);
+}
+
+static inline AVX2 __m256i
+base64_lookup_avx2(__m256i v, const __m256i table[4])
+{
+    __m256i quarter, out = _mm256_setzero_si256();
+    int i;
+
+    quarter = _mm256_and_si256(_mm256_srli_epi16(v, 4),
+        _mm256_set1_epi8(0x03));
+    for (i = 0; i < 4; i++) {
+        out = _mm256_or_si256(out, _mm256_and_si256(
+            _mm256_cmpeq_epi8(quarter, _mm256_set1_epi8(i)),
+            _mm256_shuffle_epi8(table[i], v)));
+    }
+
+    return out;
+}
+
+static inline AVX2 __m256i
+base64_values_avx2(__m256i v, __m256i c62, __m256i c63, __m256i *valid)
+{
+    __m256i upper, lower, digit, is62, is63;
+
+    upper = range_mask_avx2(v, _mm256_set1_epi8('A'), _mm256_set1_epi8('Z'));
+    lower = range_mask_avx2(v, _mm256_set1_epi8('a'), _mm256_set1_epi8('z'));
+    digit = range_mask_avx2(v, _mm256_set1_epi8('0'), _mm256_set1_epi8('9'));
+    is62 = _mm256_cmpeq_epi8(v, c62);
+    is63 = _mm256_cmpeq_epi8(v, c63);
+
+    *valid = _mm256_or_si256(_mm256_or_si256(upper, lower),
+        _mm256_or_si256(digit, _mm256_or_si256(is62, is63)));
+
+    return _mm256_or_si256(
+        _mm256_or_si256(
+        _mm256_and_si256(upper, _mm256_sub_epi8(v, _mm256_set1_epi8('A'))),
+        _mm256_and_si256(lower, _mm256_sub_epi8(v, _mm256_set1_epi8('a' - 26)))),
+        _mm256_or_si256(
+        _mm256_and_si256(digit, _mm256_sub_epi8(v, _mm256_set1_epi8('0' - 52))),
+        _mm256_or_si256(_mm256_and_si256(is62, _mm256_set1_epi8(62)),
+        _mm256_and_si256(is63, _mm256_set1_epi8(63)))));
+}
+
+/* 12 bytes at the start of each lane, moved together to the first 24
+ * bytes of the register */
+static inline AVX2 __m256i
+base64_join_avx2(__m256i v)
+{
+    v = _mm256_maddubs_epi16(v, _mm256_set1_epi32(0x01400140));
+    v = _mm256_madd_epi16(v, _mm256_set1_epi32(0x00011000));
+    v = _mm256_shuffle_epi8(v, _mm256_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+        14, 13, 12, -1, -1, -1, -1, 2, 1, 0, 6, 5, 4, 10, 9, 8,
+        14, 13, 12, -1, -1, -1, -1));
+    return _mm256_permutevar8x32_epi32(v,
+        _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7));
+}
+
+static inline AVX2 __m256i
+base16_values_avx2(__m256i v, __m256i a, __m256i A, __m256i *valid)
+{
+    const __m256i five = _mm256_set1_epi8(5);
+    __m256i digit, lower, upper;
+
+    digit = range_mask_avx2(v, _mm256_set1_epi8('0'), _mm256_set1_epi8('9'));
+    lower = range_mask_avx2(v, a, _mm256_add_epi8(a, five));
+    upper = range_mask_avx2(v, A, _mm256_add_epi8(A, five));
+
+    *valid = _mm256_or_si256(digit, _mm256_or_si256(lower, upper));
+
+    return _mm256_or_si256(
+        _mm256_and_si256(digit, _mm256_sub_epi8(v, _mm256_set1_epi8('0'))),
+        _mm256_or_si256(
+        _mm256_and_si256(lower, _mm256_sub_epi8(v,
+        _mm256_sub_epi8(a, _mm256_set1_epi8(10)))),
+        _mm256_and_si256(upper, _mm256_sub_epi8(v,
+        _mm256_sub_epi8(A, _mm256_set1_epi8(10))))));
+}
+
+static AVX2 size_t
+base64_encode_avx2(char *out, const uint8_t *in, size_t len, const char base64_map[SOL_STATIC_ARRAY_SIZE(65)])
+{
+    __m256i table[4];
+    size_t i, o;
+    int n;
+
+    for (n = 0; n < 4; n++)
+        table[n] = _mm256_broadcastsi128_si256(
+            _mm_loadu_si128((const __m128i *)(base64_map + n * 16)));
+
+    /* each lane loads 16 bytes but consumes 12 */
+    for (i = 0, o = 0; len - i >= 28; i += 24, o += 32) {
+        __m256i v = _mm256_inserti128_si256(_mm256_castsi128_si256(
+            _mm_loadu_si128((const __m128i *)(in + i))),
+            _mm_loadu_si128((const __m128i *)(in + i + 12)), 1);
+
+        _mm256_storeu_si256((__m256i *)(out + o),
+            base64_lookup_avx2(base64_split_avx2(v), table));
+    }
+
+    _mm256_zeroupper();
+    return i + base64_encode_ssse3(out + o, in + i, len - i, base64_map);
+}
+
+static AVX2 size_t
+base64_decode_avx2(uint8_t *out, const char *in, size_t len, const char base64_map[SOL_STATIC_ARRAY_SIZE(65)])
+{
+    __m256i c62, c63, valid;
+    size_t i, o;
+
+    if (len < 32 || !base64_map_is_decodable(base64_map))
+        return base64_decode_ssse3(out, in, len, base64_map);
+
+    c62 = _mm256_set1_epi8(base64_map[62]);
+    c63 = _mm256_set1_epi8(base64_map[63]);
+
+    for (i = 0, o = 0; len - i >= 32; i += 32, o += 24) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+
+        v = base64_values_avx2(v, c62, c63, &valid);
+        if ((uint32_t)_mm256_movemask_epi8(valid) != UINT32_MAX)
+            break;
+
+        v = base64_join_avx2(v);
+        _mm_storeu_si128((__m128i *)(out + o), _mm256_castsi256_si128(v));
+        _mm_storel_epi64((__m128i *)(out + o + 16),
+            _mm256_extracti128_si256(v, 1));
+    }
+
+    _mm256_zeroupper();
+    return i + base64_decode_ssse3(out + o, in + i, len - i, base64_map);
+}
+
+static AVX2 size_t
+base16_encode_avx2(char *out, const uint8_t *in, size_t len, bool uppercase)
+{
+    const __m256i low_nibble = _mm256_set1_epi8(0x0f);
+    __m256i digits;
+    size_t i;
+
+    digits = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(
+        uppercase ? "0123456789ABCDEF" : "0123456789abcdef")));
+
+    for (i = 0; len - i >= 32; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+        __m256i hi, lo, first, second;
+
+        hi = _mm256_shuffle_epi8(digits,
+            _mm256_and_si256(_mm256_srli_epi16(v, 4), low_nibble));
+        lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(v, low_nibble));
+        first = _mm256_unpacklo_epi8(hi, lo);
+        second = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i *)(out + i * 2),
+            _mm256_permute2x128_si256(first, second, 0x20));
+        _mm256_storeu_si256((__m256i *)(out + i * 2 + 32),
+            _mm256_permute2x128_si256(first, second, 0x31));
+    }
+
+    _mm256_zeroupper();
+    return i + base16_encode_ssse3(out + i * 2, in + i, len - i, uppercase);
+}
+
+static AVX2 size_t
+base16_decode_avx2(uint8_t *out, const char *in, size_t len, char a, char A)
+{
+    const __m256i va = _mm256_set1_epi8(a), vA = _mm256_set1_epi8(A);
+    __m256i valid;
+    size_t i;
+
+    for (i = 0; len - i >= 32; i += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(in + i));
+
+        v = base16_values_avx2(v, va, vA, &valid);
+        if ((uint32_t)_mm256_movemask_epi8(valid) != UINT32_MAX)
+            break;
+
+        v = _mm256_maddubs_epi16(v, _mm256_set1_epi16(0x0110));
+        v = _mm256_permute4x64_epi64(_mm256_packus_epi16(v, v), 0x08);
+        _mm_storeu_si128((__m128i *)(out + i / 2), _mm256_castsi256_si128(v));
+    }
+
+    _mm256_zeroupper();
+    return i + base16_decode_ssse3(out + i / 2, in + i, len - i, a, A);
+}
+
+#undef AVX2
+
+static const struct sol_util_codec_ops codec_ops_avx2 = {
+    .base64_encode = base64_encode_avx2,
+    .base64_decode = base64_decode_avx2,
+    .base16_encode = base16_encode_avx2,
+    .base16_decode = base16_decode_avx2,
+    .name = "avx2",
+};
+
+static const struct sol_util_codec_ops *
+codec_ops_select(void)
+{
+    /* SOL_UTIL_CODEC=scalar|ssse3 caps the instruction set, mostly
+     * useful to compare implementations */
+    const char *cap = getenv("SOL_UTIL_CODEC");
+
+    if (cap && streq(cap, "scalar"))
+        return &codec_ops_scalar;
+
+    __builtin_cpu_init();
+    if ((!cap || !streq(cap, "ssse3")) && __builtin_cpu_supports("avx2"))
+        return &codec_ops_avx2;
+    if (__builtin_cpu_supports("ssse3"))
+        return &codec_ops_ssse3;
+
+    return &codec_ops_scalar;
+}
+
+#else
+
+static const struct sol_util_codec_ops *
+codec_ops_select(void)
+{
+    return &codec_ops_scalar;
+}
+
+#endif
+
+const struct sol_util_codec_ops *sol_util_codec_ops;
+
+const struct sol_util_codec_ops *
+sol_util_codec_ops_select(void)
+{
+    const struct sol_util_codec_ops *ops = codec_ops_select();
+
+    SOL_DBG("base64 and base16 codecs using %s implementation", ops->name);
+    return ops;
+}
@@ -0,0 +1,64 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sol-macros.h"
+
+/* Block kernels used by the sol_util_base64_*() and
+ * sol_util_base16_*() codecs. Every function converts as many whole
+ * blocks from the start of the input as it can and returns the number
+ * of input bytes consumed, the caller finishes the tail (and anything
+ * the kernel refused, like padding or invalid characters) with the
+ * plain C loop, which is also the one reporting errors. Output buffers
+ * must be sized as the sol_util_*_calculate_*_len() functions say.
+ *
+ * The implementation is picked at runtime from the best instruction
+ * set supported by the CPU (AVX2, SSSE3 or none), see
+ * sol_util_codec_get_ops().
+ */
+struct sol_util_codec_ops {
+    /* consumes a multiple of 3 bytes, any alphabet */
+    size_t (*base64_encode)(char *out, const uint8_t *in, size_t len, const char base64_map[SOL_STATIC_ARRAY_SIZE(65)]);
+    /* consumes a multiple of 4 characters. Only alphabets starting
+     * with A-Z, a-z and 0-9 (as SOL_BASE64_MAP and the URL safe one)
+     * are supported, others consume nothing */
+    size_t (*base64_decode)(uint8_t *out, const char *in, size_t len, const char base64_map[SOL_STATIC_ARRAY_SIZE(65)]);
+    size_t (*base16_encode)(char *out, const uint8_t *in, size_t len, bool uppercase);
+    /* accepts '0'-'9' and the 'a'-'f' ranges starting at @a a and @a A,
+     * which may be the same */
+    size_t (*base16_decode)(uint8_t *out, const char *in, size_t len, char a, char A);
+    const char *name;
+};
+
+extern const struct sol_util_codec_ops *sol_util_codec_ops;
+
+const struct sol_util_codec_ops *sol_util_codec_ops_select(void);
+
+static inline const struct sol_util_codec_ops *
+sol_util_codec_get_ops(void)
+{
+    /* racing threads all pick the same pointer, no need for a lock */
+    if (SOL_UNLIKELY(!sol_util_codec_ops))
+        sol_util_codec_ops = sol_util_codec_ops_select();
+    return sol_util_codec_ops;
+}
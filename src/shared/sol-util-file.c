@@ -401,6 +401,83 @@ sol_util_fd_set_flag(int fd, int flag)
     return 0;
 }
 
+SOL_API int
+sol_util_fd_read_int64(int fd, int64_t *value)
+{
+    char buf[32];
+    const char *str = buf, *end, *digits;
+    uint64_t acc = 0;
+    bool negative = false;
+    ssize_t len;
+
+    SOL_NULL_CHECK(value, -EINVAL);
+
+    do {
+        len = pread(fd, buf, sizeof(buf), 0);
+    } while (len < 0 && errno == EINTR);
+    if (len < 0)
+        return -errno;
+    end = buf + len;
+
+    while (str < end && (*str == ' ' || *str == '\t'))
+        str++;
+
+    if (str < end && (*str == '-' || *str == '+')) {
+        negative = *str == '-';
+        str++;
+    }
+
+    for (digits = str; str < end && *str >= '0' && *str <= '9'; str++) {
+        unsigned int d = *str - '0';
+
+        if (acc > (UINT64_MAX - d) / 10)
+            return -EINVAL;
+        acc = acc * 10 + d;
+    }
+
+    if (str == digits)
+        return -EINVAL;
+
+    if (negative) {
+        if (acc > (uint64_t)INT64_MAX + 1)
+            return -EINVAL;
+        *value = (int64_t)(0 - acc);
+    } else {
+        if (acc > INT64_MAX)
+            return -EINVAL;
+        *value = acc;
+    }
+
+    return 0;
+}
+
+SOL_API int
+sol_util_fd_write_int64(int fd, int64_t value)
+{
+    char buf[21]; /* sign and 19 digits of INT64_MIN, no NUL needed */
+    char *str = buf + sizeof(buf);
+    uint64_t u = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    ssize_t len;
+
+    do {
+        *--str = '0' + u % 10;
+        u /= 10;
+    } while (u);
+
+    if (value < 0)
+        *--str = '-';
+
+    do {
+        len = pwrite(fd, str, buf + sizeof(buf) - str, 0);
+    } while (len < 0 && errno == EINTR);
+    if (len < 0)
+        return -errno;
+    if (len != buf + sizeof(buf) - str)
+        return -EIO;
+
+    return 0;
+}
+
 SOL_API bool
 sol_util_iterate_dir(const char *path, bool (*iterate_dir_cb)(void *data, const char *dir_path, struct dirent *ent), const void *data)
 {
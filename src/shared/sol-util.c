@@ -34,6 +34,8 @@
 #include "sol-random.h"
 #include "sol-str-slice.h"
 
+#include "sol-util-codec.h"
+
 struct sol_uuid {
     uint8_t bytes[16];
 };
@@ -410,7 +412,11 @@ sol_util_base64_encode(void *buf, size_t buflen, const struct sol_str_slice slic
     input = (const uint8_t *)slice.data;
     output = buf;
 
-    for (i = 0, o = 0; i + 3 <= slice.len; i += 3) {
+    i = sol_util_codec_get_ops()->base64_encode(output, input, slice.len,
+        base64_map);
+    o = i / 3 * 4;
+
+    for (; i + 3 <= slice.len; i += 3) {
         c = (input[i] & (((1 << 6) - 1) << 2)) >> 2;
         output[o++] = base64_map[c];
 
@@ -452,10 +458,19 @@ sol_util_base64_encode(void *buf, size_t buflen, const struct sol_str_slice slic
     return o;
 }
 
+/* Inputs from this size on get a reverse table, for fewer characters
+ * it takes longer to fill than looking each one up in the map */
+#define BASE64_REVERSE_TABLE_MIN_LEN 16
+
 static inline uint8_t
-base64_index_of(char c, const char base64_map[SOL_STATIC_ARRAY_SIZE(65)])
+base64_index_of(char c, const char base64_map[SOL_STATIC_ARRAY_SIZE(65)], const uint8_t *reverse)
 {
-    const char *p = memchr(base64_map, c, 65);
+    const char *p;
+
+    if (reverse)
+        return reverse[(uint8_t)c];
+
+    p = memchr(base64_map, c, 65);
 
     if (SOL_UNLIKELY(!p))
         return UINT8_MAX;
@@ -465,6 +480,8 @@ base64_index_of(char c, const char base64_map[SOL_STATIC_ARRAY_SIZE(65)])
 SOL_API ssize_t
 sol_util_base64_decode(void *buf, size_t buflen, const struct sol_str_slice slice, const char base64_map[SOL_STATIC_ARRAY_SIZE(65)])
 {
+    uint8_t reverse_table[256];
+    const uint8_t *reverse = NULL;
     uint8_t *output;
     const char *input;
     size_t i, o, req_len;
@@ -481,16 +498,42 @@ sol_util_base64_decode(void *buf, size_t buflen, const struct sol_str_slice slic
     input = slice.data;
     output = buf;
 
-    for (i = 0, o = 0; i + 4 <= slice.len; i += 4) {
+    i = sol_util_codec_get_ops()->base64_decode(output, input, slice.len,
+        base64_map);
+    o = i / 4 * 3;
+
+    /* the first occurrence of repeated characters wins, as with
+     * memchr() */
+    if (slice.len - i >= BASE64_REVERSE_TABLE_MIN_LEN) {
+        int n;
+
+        memset(reverse_table, UINT8_MAX, sizeof(reverse_table));
+        for (n = 64; n >= 0; n--)
+            reverse_table[(uint8_t)base64_map[n]] = n;
+        reverse = reverse_table;
+
+        /* whole quads without padding, the loop below takes the rest
+         * and reports errors */
+        for (; i + 4 <= slice.len; i += 4, o += 3) {
+            uint8_t a = reverse[(uint8_t)input[i]];
+            uint8_t b = reverse[(uint8_t)input[i + 1]];
+            uint8_t c = reverse[(uint8_t)input[i + 2]];
+            uint8_t d = reverse[(uint8_t)input[i + 3]];
+
+            if ((a | b | c | d) >= 64)
+                break;
+            output[o] = (a << 2) | (b >> 4);
+            output[o + 1] = (b << 4) | (c >> 2);
+            output[o + 2] = (c << 6) | d;
+        }
+    }
+
+    for (; i + 4 <= slice.len; i += 4) {
         uint8_t _6bits[4];
         uint8_t n;
 
-        /* precomputing reverse table would make lookup faster, but would need
-         * a setup that is potentially longer than the time we use during lookup
-         * as well as the need to allocate memory for the reverse table.
-         */
         for (n = 0; n < 4; n++) {
-            _6bits[n] = base64_index_of(input[i + n], base64_map);
+            _6bits[n] = base64_index_of(input[i + n], base64_map, reverse);
             SOL_INT_CHECK(_6bits[n], == UINT8_MAX, -EINVAL);
         }
 
@@ -553,7 +596,10 @@ sol_util_base16_encode(void *buf, size_t buflen, const struct sol_str_slice slic
     output = buf;
     a = uppercase ? 'A' : 'a';
 
-    for (i = 0, o = 0; i < slice.len; i++) {
+    i = sol_util_codec_get_ops()->base16_encode(output, input, slice.len,
+        uppercase);
+
+    for (o = i * 2; i < slice.len; i++) {
         const uint8_t b = input[i];
         const uint8_t nibble[2] = {
             (b & 0xf0) >> 4,
@@ -604,7 +650,11 @@ sol_util_base16_decode(void *buf, size_t buflen, const struct sol_str_slice slic
     A = decode_case == SOL_DECODE_BOTH ? 'A' : a;
     F = A + 5;
 
-    for (i = 0, o = 0; i + 2 <= slice.len; i += 2) {
+    i = sol_util_codec_get_ops()->base16_decode(output, input, slice.len,
+        a, A);
+    o = i / 2;
+
+    for (; i + 2 <= slice.len; i += 2) {
         uint8_t n, b = 0;
         for (n = 0; n < 2; n++) {
             const uint8_t c = input[i + n];
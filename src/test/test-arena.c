@@ -17,6 +17,8 @@
  */
 
 #include <errno.h>
+#include <stdio.h>
+#include <string.h>
 
 #include "sol-arena.h"
 #include "sol-util-internal.h"
@@ -115,5 +117,151 @@ test_check_slices_after_adding_all(void)
     sol_arena_del(arena);
 }
 
+DEFINE_TEST(test_alloc);
+
+static void
+test_alloc(void)
+{
+    struct sol_arena *arena;
+    unsigned char *big;
+    uint64_t *values[1000];
+    char *c;
+    unsigned int i;
+
+    arena = sol_arena_new();
+    ASSERT(arena);
+
+    errno = 0;
+    ASSERT(!sol_arena_alloc(arena, 0, 1));
+    ASSERT_INT_EQ(errno, EINVAL);
+    errno = 0;
+    ASSERT(!sol_arena_alloc(arena, 8, 3));
+    ASSERT_INT_EQ(errno, EINVAL);
+
+    // Unaligned bytes in between must not break the alignment.
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(values); i++) {
+        c = sol_arena_alloc(arena, 1, 1);
+        ASSERT(c);
+        *c = 'x';
+
+        values[i] = sol_arena_alloc(arena, sizeof(uint64_t), __alignof__(uint64_t));
+        ASSERT(values[i]);
+        ASSERT(((uintptr_t)values[i] & (__alignof__(uint64_t) - 1)) == 0);
+        *values[i] = i;
+    }
+
+    // Larger than any chunk.
+    big = sol_arena_alloc(arena, 1024 * 1024, 64);
+    ASSERT(big);
+    ASSERT(((uintptr_t)big & 63) == 0);
+    memset(big, 0xff, 1024 * 1024);
+
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(values); i++)
+        ASSERT_INT_EQ(*values[i], i);
+
+    sol_arena_del(arena);
+}
+
+DEFINE_TEST(test_sprintf);
+
+static void
+test_sprintf(void)
+{
+    struct sol_arena *arena;
+    struct sol_str_slice first, dst;
+    char expected[64];
+    unsigned int i;
+    int r;
+
+    arena = sol_arena_new();
+    ASSERT(arena);
+
+    r = sol_arena_slice_sprintf(arena, &first, "%s-%d", "first", 1);
+    ASSERT_INT_EQ(r, 0);
+
+    // Crosses chunk boundaries both fitting and not fitting the rest.
+    for (i = 0; i < 2000; i++) {
+        snprintf(expected, sizeof(expected), "node %u of a long graph", i);
+        r = sol_arena_slice_sprintf(arena, &dst, "node %u of a long graph", i);
+        ASSERT_INT_EQ(r, 0);
+        ASSERT(sol_str_slice_str_eq(dst, expected));
+        ASSERT_INT_EQ(dst.data[dst.len], '\0');
+    }
+
+    ASSERT(sol_str_slice_str_eq(first, "first-1"));
+
+    sol_arena_del(arena);
+}
+
+DEFINE_TEST(test_slice_dup_binary);
+
+static void
+test_slice_dup_binary(void)
+{
+    static const char data[] = { 'a', '\0', 'b', '\0', 'c' };
+    struct sol_arena *arena;
+    struct sol_str_slice dst;
+
+    arena = sol_arena_new();
+    ASSERT(arena);
+
+    // Slices are copied whole, NUL bytes included.
+    ASSERT_INT_EQ(sol_arena_slice_dup(arena, &dst, SOL_STR_SLICE_STR(data, sizeof(data))), 0);
+    ASSERT_INT_EQ(dst.len, sizeof(data));
+    ASSERT(memcmp(dst.data, data, sizeof(data)) == 0);
+    ASSERT_INT_EQ(dst.data[dst.len], '\0');
+
+    // Strings stop at the first NUL.
+    ASSERT_INT_EQ(sol_arena_slice_dup_str_n(arena, &dst, data, sizeof(data)), 0);
+    ASSERT_INT_EQ(dst.len, 1);
+    ASSERT(sol_str_slice_str_eq(dst, "a"));
+
+    sol_arena_del(arena);
+}
+
+DEFINE_TEST(test_mark_reset);
+
+static void
+test_mark_reset(void)
+{
+    struct sol_arena *arena;
+    struct sol_arena_mark empty, mark;
+    char *kept, *str;
+    unsigned int i;
+
+    arena = sol_arena_new();
+    ASSERT(arena);
+
+    sol_arena_get_mark(arena, &empty);
+
+    kept = sol_arena_strdup(arena, "kept");
+    ASSERT(kept);
+    sol_arena_get_mark(arena, &mark);
+
+    str = sol_arena_strdup(arena, "released");
+    ASSERT(str);
+    ASSERT_INT_EQ(sol_arena_reset(arena, &mark), 0);
+
+    // Same position is handed out again.
+    ASSERT(sol_arena_strdup(arena, "again") == str);
+    ASSERT_INT_EQ(sol_arena_reset(arena, &mark), 0);
+
+    // Releases whole chunks too.
+    for (i = 0; i < 1000; i++)
+        ASSERT(sol_arena_strdup(arena, "filling up more than one chunk"));
+    ASSERT_INT_EQ(sol_arena_reset(arena, &mark), 0);
+    ASSERT(streq(kept, "kept"));
+
+    sol_arena_get_mark(arena, &mark);
+    ASSERT_INT_EQ(sol_arena_reset(arena, &empty), 0);
+
+    // The mark is gone with the memory before it.
+    ASSERT_INT_EQ(sol_arena_reset(arena, &mark), -EINVAL);
+
+    ASSERT(sol_arena_strdup(arena, "reused"));
+    ASSERT_INT_EQ(sol_arena_reset(arena, NULL), 0);
+
+    sol_arena_del(arena);
+}
 
 TEST_MAIN();
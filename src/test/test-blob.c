@@ -0,0 +1,192 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sol-types.h"
+#include "sol-util-internal.h"
+
+#include "test.h"
+
+static struct sol_blob *
+blob_new_str(const char *str)
+{
+    char *mem = strdup(str);
+
+    ASSERT(mem);
+    return sol_blob_new(SOL_BLOB_TYPE_DEFAULT, NULL, mem, strlen(str));
+}
+
+DEFINE_TEST(test_slice);
+
+static void
+test_slice(void)
+{
+    struct sol_blob *blob, *slice, *sub;
+
+    blob = blob_new_str("Hello, slices");
+    ASSERT(blob);
+
+    slice = sol_blob_slice(blob, 7, 6);
+    ASSERT(slice);
+    ASSERT_INT_EQ(slice->size, 6);
+    ASSERT(slice->mem == (char *)blob->mem + 7);
+    ASSERT(slice->parent == blob);
+    ASSERT_INT_EQ(blob->refcnt, 2);
+
+    sub = sol_blob_slice(slice, 1, 4);
+    ASSERT(sub);
+    ASSERT(memcmp(sub->mem, "lice", 4) == 0);
+    ASSERT_INT_EQ(slice->refcnt, 2);
+
+    /* the slices keep the memory alive */
+    sol_blob_unref(blob);
+    sol_blob_unref(slice);
+    ASSERT(memcmp(sub->mem, "lice", 4) == 0);
+
+    ASSERT(sub->parent == slice);
+    ASSERT_INT_EQ(slice->refcnt, 1);
+    ASSERT_INT_EQ(blob->refcnt, 1);
+
+    sol_blob_unref(sub);
+}
+
+DEFINE_TEST(test_slice_bounds);
+
+static void
+test_slice_bounds(void)
+{
+    struct sol_blob *blob, *slice;
+
+    blob = blob_new_str("0123456789");
+    ASSERT(blob);
+
+    slice = sol_blob_slice(blob, 10, 0);
+    ASSERT(slice);
+    ASSERT_INT_EQ(slice->size, 0);
+    sol_blob_unref(slice);
+
+    errno = 0;
+    ASSERT(!sol_blob_slice(blob, 11, 0));
+    ASSERT_INT_EQ(errno, EINVAL);
+
+    errno = 0;
+    ASSERT(!sol_blob_slice(blob, 5, 6));
+    ASSERT_INT_EQ(errno, EINVAL);
+
+    errno = 0;
+    ASSERT(!sol_blob_slice(blob, 1, SIZE_MAX));
+    ASSERT_INT_EQ(errno, EINVAL);
+
+    ASSERT_INT_EQ(blob->refcnt, 1);
+    sol_blob_unref(blob);
+}
+
+DEFINE_TEST(test_chain);
+
+static void
+test_chain(void)
+{
+    static const char expected[] = "GET /index.html HTTP/1.1\r\n";
+    struct sol_blob_chain chain = SOL_BLOB_CHAIN_INIT;
+    struct sol_blob *method, *path, *flat, *blob;
+    uint32_t i;
+    size_t size = 0;
+
+    method = blob_new_str("GET POST");
+    ASSERT(method);
+    path = blob_new_str("/index.html");
+    ASSERT(path);
+
+    ASSERT_INT_EQ(sol_blob_chain_append_slice(&chain, method, 0, 4), 0);
+    ASSERT_INT_EQ(sol_blob_chain_append(&chain, path), 0);
+    ASSERT_INT_EQ(sol_blob_chain_append(&chain,
+        sol_blob_new(SOL_BLOB_TYPE_NO_FREE, NULL, " HTTP/1.1\r\n", 11)), 0);
+    ASSERT_INT_EQ(sol_blob_chain_append_slice(&chain, method, 4, 5), -EINVAL);
+
+    ASSERT_INT_EQ(sol_blob_chain_get_len(&chain), 3);
+    ASSERT_INT_EQ(chain.size, strlen(expected));
+    ASSERT_INT_EQ(method->refcnt, 2);
+    ASSERT_INT_EQ(path->refcnt, 2);
+
+    SOL_BLOB_CHAIN_FOREACH_IDX (&chain, blob, i)
+        size += blob->size;
+    ASSERT_INT_EQ(size, chain.size);
+
+    /* the chain holds the only reference left */
+    blob = sol_ptr_vector_get(&chain.blobs, 2);
+    sol_blob_unref(blob);
+    sol_blob_unref(method);
+
+    flat = sol_blob_chain_flatten(&chain);
+    ASSERT(flat);
+    ASSERT_INT_EQ(flat->size, strlen(expected));
+    ASSERT(memcmp(flat->mem, expected, flat->size) == 0);
+    sol_blob_unref(flat);
+
+    sol_blob_chain_clear(&chain);
+    ASSERT_INT_EQ(sol_blob_chain_get_len(&chain), 0);
+    ASSERT_INT_EQ(chain.size, 0);
+    ASSERT_INT_EQ(path->refcnt, 1);
+
+    sol_blob_unref(path);
+}
+
+DEFINE_TEST(test_chain_flatten);
+
+static void
+test_chain_flatten(void)
+{
+    struct sol_blob_chain chain;
+    struct sol_blob *blob, *flat;
+
+    sol_blob_chain_init(&chain);
+
+    flat = sol_blob_chain_flatten(&chain);
+    ASSERT(flat);
+    ASSERT_INT_EQ(flat->size, 0);
+    sol_blob_unref(flat);
+
+    /* a single blob is returned as is */
+    blob = blob_new_str("single");
+    ASSERT(blob);
+    ASSERT_INT_EQ(sol_blob_chain_append(&chain, blob), 0);
+
+    flat = sol_blob_chain_flatten(&chain);
+    ASSERT(flat == blob);
+    ASSERT_INT_EQ(blob->refcnt, 3);
+    sol_blob_unref(flat);
+
+    ASSERT_INT_EQ(sol_blob_chain_append_slice(&chain, blob, 0, blob->size), 0);
+    ASSERT_INT_EQ(blob->refcnt, 3);
+
+    flat = sol_blob_chain_flatten(&chain);
+    ASSERT(flat);
+    ASSERT(flat != blob);
+    ASSERT_INT_EQ(flat->size, 12);
+    ASSERT(memcmp(flat->mem, "singlesingle", 12) == 0);
+    sol_blob_unref(flat);
+
+    sol_blob_chain_clear(&chain);
+    ASSERT_INT_EQ(blob->refcnt, 1);
+    sol_blob_unref(blob);
+}
+
+TEST_MAIN();
@@ -410,6 +410,88 @@ test_insert_printf(void)
     sol_buffer_fini(&buf);
 }
 
+DEFINE_TEST(test_inline);
+
+static void
+test_inline(void)
+{
+    SOL_BUFFER_DECLARE_INLINE(buf, 8);
+    struct sol_buffer *copy;
+    const char *long_str = "longer than the inline storage";
+    void *stolen;
+    size_t size;
+    int err;
+
+    err = sol_buffer_append_slice(&buf, sol_str_slice_from_str("1234"));
+    ASSERT_INT_EQ(err, 0);
+    ASSERT(buf.data == bufstorage);
+    ASSERT_STR_EQ(buf.data, "1234");
+
+    /* not owned while inline */
+    ASSERT(!sol_buffer_steal(&buf, NULL));
+
+    copy = sol_buffer_copy(&buf);
+    ASSERT(copy);
+    ASSERT(copy->data != bufstorage);
+    ASSERT_INT_EQ(copy->capacity, 5);
+    ASSERT_INT_EQ(copy->flags, SOL_BUFFER_FLAGS_DEFAULT);
+    ASSERT_STR_EQ(copy->data, "1234");
+    sol_buffer_free(copy);
+
+    /* 7 bytes and the NUL still fit */
+    err = sol_buffer_append_slice(&buf, sol_str_slice_from_str("567"));
+    ASSERT_INT_EQ(err, 0);
+    ASSERT(buf.data == bufstorage);
+
+    err = sol_buffer_append_slice(&buf, sol_str_slice_from_str("8"));
+    ASSERT_INT_EQ(err, 0);
+    ASSERT(buf.data != bufstorage);
+    ASSERT_INT_EQ(buf.flags, SOL_BUFFER_FLAGS_DEFAULT);
+    ASSERT_STR_EQ(buf.data, "12345678");
+
+    err = sol_buffer_append_printf(&buf, " %s", long_str);
+    ASSERT_INT_EQ(err, 0);
+    ASSERT_STR_EQ(buf.data, "12345678 longer than the inline storage");
+
+    stolen = sol_buffer_steal(&buf, &size);
+    ASSERT(stolen);
+    ASSERT_INT_EQ(size, strlen("12345678 ") + strlen(long_str));
+    free(stolen);
+    sol_buffer_fini(&buf);
+}
+
+DEFINE_TEST(test_inline_fini);
+
+static void
+test_inline_fini(void)
+{
+    SOL_BUFFER_DECLARE_INLINE(buf, 16);
+    int err;
+
+    err = sol_buffer_append_printf(&buf, "%d", 42);
+    ASSERT_INT_EQ(err, 0);
+    ASSERT_STR_EQ(buf.data, "42");
+    err = sol_buffer_insert_printf(&buf, 0, "%s", "-");
+    ASSERT_INT_EQ(err, 0);
+    ASSERT_STR_EQ(buf.data, "-42");
+
+    /* shrinking keeps the storage */
+    err = sol_buffer_resize(&buf, 2);
+    ASSERT_INT_EQ(err, 0);
+    ASSERT(buf.data == bufstorage);
+    ASSERT_INT_EQ(buf.used, 2);
+
+    /* the storage isn't freed, and afterwards the heap is used */
+    sol_buffer_fini(&buf);
+    ASSERT(!buf.data);
+
+    err = sol_buffer_append_slice(&buf, sol_str_slice_from_str("reused"));
+    ASSERT_INT_EQ(err, 0);
+    ASSERT(buf.data != bufstorage);
+    ASSERT_STR_EQ(buf.data, "reused");
+    sol_buffer_fini(&buf);
+}
+
 DEFINE_TEST(test_memory_not_owned);
 
 static void
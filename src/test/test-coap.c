@@ -16,9 +16,13 @@
  * limitations under the License.
  */
 
+#include <arpa/inet.h>
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 #include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
 
 #include "sol-str-slice.h"
 #include "sol-coap.h"
@@ -282,5 +286,118 @@ test_coap_find_options(void)
     sol_coap_packet_unref(pkt);
 }
 
+struct datagram {
+    uint8_t data[256];
+    ssize_t len;
+};
+
+static bool
+datagram_cb(void *data, int fd, uint32_t cond)
+{
+    struct datagram *datagram = data;
+
+    datagram->len = recv(fd, datagram->data, sizeof(datagram->data), 0);
+    sol_quit();
+    return false;
+}
+
+static bool
+timeout_cb(void *data)
+{
+    struct sol_timeout **timeout = data;
+
+    *timeout = NULL;
+    sol_quit();
+    return false;
+}
+
+DEFINE_TEST(test_coap_payload_blobs);
+
+static void
+test_coap_payload_blobs(void)
+{
+    static const char expected[] = "head:first,second";
+    struct sol_network_link_addr server_addr = {
+        .family = SOL_NETWORK_FAMILY_INET,
+        .addr.in = { 127, 0, 0, 1 },
+    };
+    struct sol_network_link_addr cliaddr = server_addr;
+    struct sockaddr_in sin = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t sin_len = sizeof(sin);
+    struct datagram datagram = { .len = -1 };
+    struct sol_coap_server *server;
+    struct sol_coap_packet *pkt;
+    struct sol_blob *blobs[3];
+    struct sol_buffer *buf;
+    struct sol_timeout *timeout;
+    struct sol_fd *watch;
+    size_t header_len;
+    unsigned int i;
+    int fd;
+
+    blobs[0] = sol_blob_new(SOL_BLOB_TYPE_NO_FREE, NULL, "first,", 6);
+    blobs[1] = sol_blob_new(SOL_BLOB_TYPE_NO_FREE, NULL, "", 0);
+    blobs[2] = sol_blob_new(SOL_BLOB_TYPE_NO_FREE, NULL, "second", 6);
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(blobs); i++)
+        ASSERT(blobs[i]);
+
+    pkt = sol_coap_packet_new(NULL);
+    ASSERT(pkt);
+    ASSERT(!sol_coap_header_set_type(pkt, SOL_COAP_TYPE_NONCON));
+    ASSERT(!sol_coap_header_set_code(pkt, SOL_COAP_METHOD_POST));
+    ASSERT(!sol_coap_packet_add_uri_path_option(pkt, "/blobs"));
+
+    /* the buffer goes first, then the blobs */
+    ASSERT(!sol_coap_packet_get_payload(pkt, &buf, NULL));
+    ASSERT(!sol_buffer_append_slice(buf, sol_str_slice_from_str("head:")));
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(blobs); i++)
+        ASSERT(!sol_coap_packet_add_payload_blob(pkt, blobs[i]));
+    ASSERT_INT_EQ(blobs[0]->refcnt, 2);
+    ASSERT_INT_EQ(blobs[1]->refcnt, 1);
+
+    ASSERT(sol_coap_packet_has_payload(pkt));
+    ASSERT_INT_EQ(sol_coap_packet_get_payload(pkt, &buf, NULL), -EINVAL);
+    ASSERT_INT_EQ(sol_coap_add_option(pkt, SOL_COAP_OPTION_URI_QUERY, "a", 1),
+        -EINVAL);
+    header_len = pkt->buf.used - strlen("head:");
+
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    ASSERT(fd >= 0);
+    ASSERT_INT_EQ(bind(fd, (struct sockaddr *)&sin, sizeof(sin)), 0);
+    ASSERT_INT_EQ(getsockname(fd, (struct sockaddr *)&sin, &sin_len), 0);
+    cliaddr.port = ntohs(sin.sin_port);
+
+    watch = sol_fd_add(fd, SOL_FD_FLAGS_IN, datagram_cb, &datagram);
+    ASSERT(watch);
+    timeout = sol_timeout_add(5000, timeout_cb, &timeout);
+    ASSERT(timeout);
+
+    server = sol_coap_server_new(&server_addr);
+    ASSERT(server);
+    ASSERT(!sol_coap_send_packet(server, sol_coap_packet_ref(pkt), &cliaddr));
+
+    sol_run();
+    if (timeout)
+        sol_timeout_del(timeout);
+
+    /* a single datagram, with nothing but the blobs after the buffer */
+    ASSERT_INT_EQ(datagram.len, header_len + strlen(expected));
+    ASSERT(!memcmp(datagram.data, pkt->buf.data, header_len));
+    ASSERT_INT_EQ(datagram.data[header_len - 1], 0xff);
+    ASSERT(!memcmp(datagram.data + header_len, expected, strlen(expected)));
+
+    sol_coap_server_unref(server);
+    sol_coap_packet_unref(pkt);
+    close(fd);
+
+    /* the packet is gone, and so are its references */
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(blobs); i++) {
+        ASSERT_INT_EQ(blobs[i]->refcnt, 1);
+        sol_blob_unref(blobs[i]);
+    }
+}
 
 TEST_MAIN();
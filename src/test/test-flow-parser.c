@@ -57,7 +57,8 @@ static int
 count_events(struct sol_flow_node *node, enum event_type type)
 {
     struct test_event *ev;
-    int i, count = 0;
+    uint32_t i;
+    int count = 0;
 
     SOL_VECTOR_FOREACH_IDX (&test_events, ev, i) {
         if (node && ev->node != node)
@@ -0,0 +1,590 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <linux/gpio.h>
+
+#include "sol-gpio.h"
+#include "sol-mainloop.h"
+#include "sol-util-file.h"
+#include "sol-util-internal.h"
+
+#include "test.h"
+
+/* The GPIO character device is stubbed: this test is linked with
+ * --wrap for open(), ioctl(), access(), realpath() and
+ * sol_util_iterate_dir(). Paths under /sys and /dev are taken from a
+ * fake tree, gpiochips are regular files in it and line requests are
+ * pipes, so edge events can be written to them. */
+
+#define CHIPS 4
+#define REQUESTS 16
+
+struct chip {
+    const char *label;
+    uint32_t lines;
+    uint32_t base;
+    const char *parent;
+    uint64_t values;
+};
+
+/* Both expanders look the same but for their parent device, while the
+ * SoC banks share the same parent. Sysfs bases don't follow gpiochip
+ * order. */
+static struct chip chips[CHIPS] = {
+    { "expander", 8, 504, "i2c-0/0-0020" },
+    { "expander", 8, 496, "i2c-0/0-0021" },
+    { "bank-a", 4, 0, "soc" },
+    { "bank-b", 4, 4, "soc" },
+};
+
+struct request {
+    int fd;
+    int write_fd;
+    unsigned int chip;
+    struct gpio_v2_line_request req;
+};
+
+static struct request requests[REQUESTS];
+static unsigned int n_requests;
+static int chip_fds[CHIPS];
+static unsigned int chip_opens;
+
+static char root[] = "/tmp/sol-test-gpio-XXXXXX";
+
+int __real_open(const char *path, int flags, ...);
+int __real_access(const char *path, int mode);
+char *__real_realpath(const char *path, char *resolved);
+int __real_ioctl(int fd, unsigned long request, ...);
+bool __real_sol_util_iterate_dir(const char *path, bool (*cb)(void *data, const char *dir_path, struct dirent *ent), const void *data);
+
+int __wrap_open(const char *path, int flags, ...);
+int __wrap_access(const char *path, int mode);
+char *__wrap_realpath(const char *path, char *resolved);
+int __wrap_ioctl(int fd, unsigned long request, ...);
+bool __wrap_sol_util_iterate_dir(const char *path, bool (*cb)(void *data, const char *dir_path, struct dirent *ent), const void *data);
+
+static const char *
+fake_path(const char *path, char *buf, size_t size)
+{
+    int len;
+
+    if (!strstartswith(path, "/sys/") && !strstartswith(path, "/dev/"))
+        return path;
+
+    len = snprintf(buf, size, "%s%s", root, path);
+    ASSERT(len >= 0 && (size_t)len < size);
+    return buf;
+}
+
+int
+__wrap_open(const char *path, int flags, ...)
+{
+    char buf[PATH_MAX];
+    unsigned int i;
+    va_list ap;
+    mode_t mode;
+    int fd;
+
+    va_start(ap, flags);
+    mode = (flags & O_CREAT) ? va_arg(ap, mode_t) : 0;
+    va_end(ap);
+
+    fd = __real_open(fake_path(path, buf, sizeof(buf)), flags, mode);
+    if (fd < 0)
+        return fd;
+
+    for (i = 0; i < CHIPS; i++) {
+        snprintf(buf, sizeof(buf), "/dev/gpiochip%u", i);
+        if (streq(path, buf)) {
+            chip_fds[i] = fd;
+            chip_opens++;
+        }
+    }
+
+    return fd;
+}
+
+int
+__wrap_access(const char *path, int mode)
+{
+    char buf[PATH_MAX];
+
+    return __real_access(fake_path(path, buf, sizeof(buf)), mode);
+}
+
+char *
+__wrap_realpath(const char *path, char *resolved)
+{
+    char buf[PATH_MAX];
+
+    return __real_realpath(fake_path(path, buf, sizeof(buf)), resolved);
+}
+
+bool
+__wrap_sol_util_iterate_dir(const char *path, bool (*cb)(void *data, const char *dir_path, struct dirent *ent), const void *data)
+{
+    char buf[PATH_MAX];
+
+    return __real_sol_util_iterate_dir(fake_path(path, buf, sizeof(buf)), cb, data);
+}
+
+static int
+chip_from_fd(int fd)
+{
+    unsigned int i;
+
+    for (i = 0; i < CHIPS; i++) {
+        if (chip_fds[i] == fd)
+            return i;
+    }
+
+    return -1;
+}
+
+static struct request *
+request_from_fd(int fd)
+{
+    unsigned int i;
+
+    /* Closed requests may have their fd reused, look at the latest first */
+    for (i = n_requests; i > 0; i--) {
+        if (requests[i - 1].fd == fd)
+            return &requests[i - 1];
+    }
+
+    return NULL;
+}
+
+static uint64_t
+line_bit(const struct request *r, unsigned int line)
+{
+    return (uint64_t)1 << r->req.offsets[line];
+}
+
+int
+__wrap_ioctl(int fd, unsigned long request, ...)
+{
+    struct gpio_v2_line_values *lv;
+    struct request *r;
+    unsigned int i;
+    int chip, pipe_fds[2];
+    va_list ap;
+    void *arg;
+
+    va_start(ap, request);
+    arg = va_arg(ap, void *);
+    va_end(ap);
+
+    chip = chip_from_fd(fd);
+    r = request_from_fd(fd);
+
+    if (request == GPIO_GET_CHIPINFO_IOCTL && chip >= 0) {
+        struct gpiochip_info *info = arg;
+
+        memset(info, 0, sizeof(*info));
+        snprintf(info->name, sizeof(info->name), "gpiochip%d", chip);
+        snprintf(info->label, sizeof(info->label), "%s", chips[chip].label);
+        info->lines = chips[chip].lines;
+        return 0;
+    }
+
+    if (request == GPIO_V2_GET_LINE_IOCTL && chip >= 0) {
+        struct gpio_v2_line_request *req = arg;
+        struct gpio_v2_line_config *lc = &req->config;
+
+        ASSERT(n_requests < REQUESTS);
+        ASSERT(pipe2(pipe_fds, O_CLOEXEC) == 0);
+        req->fd = pipe_fds[0];
+
+        r = &requests[n_requests++];
+        r->fd = pipe_fds[0];
+        r->write_fd = pipe_fds[1];
+        r->chip = chip;
+        r->req = *req;
+
+        if (lc->num_attrs &&
+            lc->attrs[0].attr.id == GPIO_V2_LINE_ATTR_ID_OUTPUT_VALUES) {
+            for (i = 0; i < req->num_lines; i++) {
+                if (!(lc->attrs[0].mask & ((uint64_t)1 << i)))
+                    continue;
+                if (lc->attrs[0].attr.values & ((uint64_t)1 << i))
+                    chips[chip].values |= line_bit(r, i);
+                else
+                    chips[chip].values &= ~line_bit(r, i);
+            }
+        }
+        return 0;
+    }
+
+    if (request == GPIO_V2_LINE_GET_VALUES_IOCTL && r) {
+        lv = arg;
+        lv->bits = 0;
+        for (i = 0; i < r->req.num_lines; i++) {
+            if ((lv->mask & ((uint64_t)1 << i)) &&
+                (chips[r->chip].values & line_bit(r, i)))
+                lv->bits |= (uint64_t)1 << i;
+        }
+        return 0;
+    }
+
+    if (request == GPIO_V2_LINE_SET_VALUES_IOCTL && r) {
+        lv = arg;
+        for (i = 0; i < r->req.num_lines; i++) {
+            if (!(lv->mask & ((uint64_t)1 << i)))
+                continue;
+            if (lv->bits & ((uint64_t)1 << i))
+                chips[r->chip].values |= line_bit(r, i);
+            else
+                chips[r->chip].values &= ~line_bit(r, i);
+        }
+        return 0;
+    }
+
+    return __real_ioctl(fd, request, arg);
+}
+
+static void
+make_dir(const char *fmt, ...)
+{
+    char name[PATH_MAX], path[PATH_MAX];
+    va_list ap;
+    int len;
+
+    va_start(ap, fmt);
+    vsnprintf(name, sizeof(name), fmt, ap);
+    va_end(ap);
+
+    len = snprintf(path, sizeof(path), "%s/%s", root, name);
+    ASSERT(len >= 0 && (size_t)len < sizeof(path));
+    ASSERT(mkdir(path, 0700) == 0 || errno == EEXIST);
+}
+
+static void
+make_link(const char *target, const char *fmt, ...)
+{
+    char name[PATH_MAX], path[PATH_MAX];
+    va_list ap;
+    int len;
+
+    va_start(ap, fmt);
+    vsnprintf(name, sizeof(name), fmt, ap);
+    va_end(ap);
+
+    len = snprintf(path, sizeof(path), "%s/%s", root, name);
+    ASSERT(len >= 0 && (size_t)len < sizeof(path));
+    ASSERT_INT_EQ(symlink(target, path), 0);
+}
+
+static void
+write_attribute(const char *dir, const char *name, const char *fmt, ...)
+{
+    char path[PATH_MAX];
+    va_list ap;
+    FILE *fp;
+    int len;
+
+    len = snprintf(path, sizeof(path), "%s/%s/%s", root, dir, name);
+    ASSERT(len >= 0 && (size_t)len < sizeof(path));
+    fp = fopen(path, "we");
+    ASSERT(fp);
+
+    va_start(ap, fmt);
+    vfprintf(fp, fmt, ap);
+    va_end(ap);
+
+    fputc('\n', fp);
+    ASSERT_INT_EQ(fclose(fp), 0);
+}
+
+static int
+remove_cb(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    return remove(path);
+}
+
+/* Chips as the kernel lays them out: the gpiochipN device and the
+ * legacy gpiochip<base> entry are both children of the chip parent */
+static void
+create_tree(void)
+{
+    char dir[PATH_MAX], target[PATH_MAX];
+    unsigned int i;
+    int r;
+
+    for (i = 0; i < CHIPS; i++)
+        chip_fds[i] = -1;
+
+    ASSERT(mkdtemp(root));
+    make_dir("dev");
+    make_dir("sys");
+    make_dir("sys/class");
+    make_dir("sys/class/gpio");
+    make_dir("sys/bus");
+    make_dir("sys/bus/gpio");
+    make_dir("sys/bus/gpio/devices");
+    make_dir("sys/devices");
+    make_dir("sys/devices/i2c-0");
+
+    for (i = 0; i < CHIPS; i++) {
+        chips[i].values = 0;
+
+        snprintf(dir, sizeof(dir), "%s/dev/gpiochip%u", root, i);
+        r = sol_util_write_file(dir, "%s", "");
+        ASSERT(r >= 0);
+
+        make_dir("sys/devices/%s", chips[i].parent);
+        make_dir("sys/devices/%s/gpiochip%u", chips[i].parent, i);
+        make_dir("sys/devices/%s/gpio", chips[i].parent);
+        make_dir("sys/devices/%s/gpio/gpiochip%u", chips[i].parent, chips[i].base);
+
+        snprintf(dir, sizeof(dir), "sys/devices/%s/gpio/gpiochip%u",
+            chips[i].parent, chips[i].base);
+        write_attribute(dir, "base", "%u", chips[i].base);
+        write_attribute(dir, "ngpio", "%u", chips[i].lines);
+        write_attribute(dir, "label", "%s", chips[i].label);
+        make_link("../..", "%s/device", dir);
+
+        snprintf(target, sizeof(target), "../../devices/%s/gpio/gpiochip%u",
+            chips[i].parent, chips[i].base);
+        make_link(target, "sys/class/gpio/gpiochip%u", chips[i].base);
+
+        snprintf(target, sizeof(target), "../../../devices/%s/gpiochip%u",
+            chips[i].parent, i);
+        make_link(target, "sys/bus/gpio/devices/gpiochip%u", i);
+    }
+}
+
+static void
+destroy_tree(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < n_requests; i++)
+        close(requests[i].write_fd);
+    n_requests = 0;
+    chip_opens = 0;
+
+    nftw(root, remove_cb, 8, FTW_DEPTH | FTW_PHYS);
+    strcpy(root, "/tmp/sol-test-gpio-XXXXXX");
+}
+
+static struct request *
+last_request(void)
+{
+    ASSERT(n_requests > 0);
+    return &requests[n_requests - 1];
+}
+
+DEFINE_TEST(test_chip_base);
+
+static void
+test_chip_base(void)
+{
+    struct sol_gpio_config config = {
+        SOL_SET_API_VERSION(.api_version = SOL_GPIO_CONFIG_API_VERSION, )
+        .dir = SOL_GPIO_DIR_OUT,
+    };
+    struct sol_gpio *gpio;
+    struct request *r;
+
+    create_tree();
+
+    /* Same label and number of lines, told apart by their parent */
+    gpio = sol_gpio_open_raw(497, &config);
+    ASSERT(gpio);
+    r = last_request();
+    ASSERT_INT_EQ(r->chip, 1);
+    ASSERT_INT_EQ(r->req.num_lines, 1);
+    ASSERT_INT_EQ(r->req.offsets[0], 1);
+    ASSERT(sol_gpio_write(gpio, true));
+    ASSERT_INT_EQ(chips[1].values, 1 << 1);
+    ASSERT_INT_EQ(chips[0].values, 0);
+    sol_gpio_close(gpio);
+
+    gpio = sol_gpio_open_raw(511, &config);
+    ASSERT(gpio);
+    r = last_request();
+    ASSERT_INT_EQ(r->chip, 0);
+    ASSERT_INT_EQ(r->req.offsets[0], 7);
+    sol_gpio_close(gpio);
+
+    /* Same parent, told apart by their labels */
+    gpio = sol_gpio_open_raw(6, &config);
+    ASSERT(gpio);
+    r = last_request();
+    ASSERT_INT_EQ(r->chip, 3);
+    ASSERT_INT_EQ(r->req.offsets[0], 2);
+    sol_gpio_close(gpio);
+
+    destroy_tree();
+}
+
+DEFINE_TEST(test_bank);
+
+static void
+test_bank(void)
+{
+    static const uint32_t pins[] = { 505, 497, 1, 498, 5 };
+    struct sol_gpio_config config = {
+        SOL_SET_API_VERSION(.api_version = SOL_GPIO_CONFIG_API_VERSION, )
+        .dir = SOL_GPIO_DIR_OUT,
+        .out.value = true,
+    };
+    struct sol_gpio_bank *bank;
+    uint64_t values;
+
+    create_tree();
+
+    bank = sol_gpio_bank_open(pins, SOL_UTIL_ARRAY_SIZE(pins), &config);
+    ASSERT(bank);
+
+    /* Every chip opened once, a single request per chip in use */
+    ASSERT_INT_EQ(chip_opens, CHIPS);
+    ASSERT_INT_EQ(n_requests, 4);
+    ASSERT_INT_EQ(requests[0].chip, 0);
+    ASSERT_INT_EQ(requests[0].req.num_lines, 1);
+    ASSERT_INT_EQ(requests[1].chip, 1);
+    ASSERT_INT_EQ(requests[1].req.num_lines, 2);
+    ASSERT_INT_EQ(requests[1].req.offsets[0], 1);
+    ASSERT_INT_EQ(requests[1].req.offsets[1], 2);
+    ASSERT_INT_EQ(requests[2].chip, 2);
+    ASSERT_INT_EQ(requests[3].chip, 3);
+
+    ASSERT_INT_EQ(chips[0].values, 1 << 1);
+    ASSERT_INT_EQ(chips[1].values, 1 << 1 | 1 << 2);
+    ASSERT_INT_EQ(sol_gpio_bank_read(bank, &values), 0);
+    ASSERT_INT_EQ(values, 0x1f);
+
+    ASSERT_INT_EQ(sol_gpio_bank_write(bank, 0x0a, 0x1f), 0);
+    ASSERT_INT_EQ(chips[0].values, 0);
+    ASSERT_INT_EQ(chips[1].values, 1 << 1 | 1 << 2);
+    ASSERT_INT_EQ(chips[2].values, 0);
+    ASSERT_INT_EQ(chips[3].values, 0);
+    ASSERT_INT_EQ(sol_gpio_bank_read(bank, &values), 0);
+    ASSERT_INT_EQ(values, 0x0a);
+
+    /* Pins out of the mask are left alone */
+    ASSERT_INT_EQ(sol_gpio_bank_write(bank, 0x15, 0x11), 0);
+    ASSERT_INT_EQ(chips[0].values, 1 << 1);
+    ASSERT_INT_EQ(chips[3].values, 1 << 1);
+    ASSERT_INT_EQ(sol_gpio_bank_read(bank, &values), 0);
+    ASSERT_INT_EQ(values, 0x1b);
+
+    sol_gpio_bank_close(bank);
+
+    destroy_tree();
+}
+
+struct event {
+    unsigned int count;
+    bool values[2];
+    uint64_t timestamps[2];
+};
+
+static void
+event_cb(void *data, struct sol_gpio *gpio, bool value)
+{
+    struct event *event = data;
+
+    ASSERT(event->count < 2);
+    event->values[event->count] = value;
+    ASSERT_INT_EQ(sol_gpio_get_event_timestamp(gpio,
+        &event->timestamps[event->count]), 0);
+    if (++event->count == 2)
+        sol_quit();
+}
+
+static bool
+timeout_cb(void *data)
+{
+    struct sol_timeout **timeout = data;
+
+    *timeout = NULL;
+    sol_quit();
+    return false;
+}
+
+DEFINE_TEST(test_event_timestamp);
+
+static void
+test_event_timestamp(void)
+{
+    struct event event = { };
+    struct sol_gpio_config config = {
+        SOL_SET_API_VERSION(.api_version = SOL_GPIO_CONFIG_API_VERSION, )
+        .dir = SOL_GPIO_DIR_IN,
+        .in = {
+            .trigger_mode = SOL_GPIO_EDGE_BOTH,
+            .cb = event_cb,
+            .user_data = &event,
+            .debounce_period = 500,
+        },
+    };
+    struct gpio_v2_line_event events[2] = {
+        { .timestamp_ns = 1000, .id = GPIO_V2_LINE_EVENT_RISING_EDGE },
+        { .timestamp_ns = 2000, .id = GPIO_V2_LINE_EVENT_FALLING_EDGE },
+    };
+    struct gpio_v2_line_config *lc;
+    struct sol_timeout *timeout;
+    struct sol_gpio *gpio;
+    struct request *r;
+    uint64_t timestamp;
+
+    create_tree();
+
+    gpio = sol_gpio_open_raw(2, &config);
+    ASSERT(gpio);
+    r = last_request();
+    lc = &r->req.config;
+    ASSERT(lc->flags & GPIO_V2_LINE_FLAG_EDGE_RISING);
+    ASSERT(lc->flags & GPIO_V2_LINE_FLAG_EDGE_FALLING);
+    ASSERT_INT_EQ(lc->num_attrs, 1);
+    ASSERT_INT_EQ(lc->attrs[0].attr.id, GPIO_V2_LINE_ATTR_ID_DEBOUNCE);
+    ASSERT_INT_EQ(lc->attrs[0].attr.debounce_period_us, 500);
+
+    /* Only known while dispatching an event */
+    ASSERT_INT_EQ(sol_gpio_get_event_timestamp(gpio, &timestamp), -ENOTSUP);
+
+    ASSERT_INT_EQ(write(r->write_fd, events, sizeof(events)), sizeof(events));
+    timeout = sol_timeout_add(5000, timeout_cb, &timeout);
+    ASSERT(timeout);
+    sol_run();
+    if (timeout)
+        sol_timeout_del(timeout);
+
+    ASSERT_INT_EQ(event.count, 2);
+    ASSERT(event.values[0]);
+    ASSERT(!event.values[1]);
+    ASSERT_INT_EQ(event.timestamps[0], 1000);
+    ASSERT_INT_EQ(event.timestamps[1], 2000);
+
+    sol_gpio_close(gpio);
+    destroy_tree();
+}
+
+TEST_MAIN();
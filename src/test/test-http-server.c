@@ -0,0 +1,285 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sol-buffer.h"
+#include "sol-http.h"
+#include "sol-http-server.h"
+#include "sol-mainloop.h"
+#include "sol-util-internal.h"
+
+#include "test.h"
+
+#define PORT 8091
+#define CLIENTS 2
+#define FEED_SIZE 64
+
+static struct sol_blob *
+blob_new_str(const char *str)
+{
+    return sol_blob_new(SOL_BLOB_TYPE_NO_FREE, NULL, str, strlen(str));
+}
+
+static void
+check_frame(const char *data, const char *expected)
+{
+    struct sol_blob *blob, *framed;
+
+    blob = blob_new_str(data);
+    ASSERT(blob);
+
+    framed = sol_http_progressive_response_sse_frame(blob);
+    ASSERT(framed);
+    ASSERT_INT_EQ(framed->size, strlen(expected));
+    ASSERT(memcmp(framed->mem, expected, framed->size) == 0);
+
+    sol_blob_unref(framed);
+    sol_blob_unref(blob);
+}
+
+DEFINE_TEST(test_sse_frame);
+
+static void
+test_sse_frame(void)
+{
+    check_frame("hello", "data: hello\n\n");
+    check_frame("multi\nline", "data: multi\ndata: line\n\n");
+    check_frame("trailing\n", "data: trailing\n\n");
+    check_frame("", "data: \n\n");
+
+    errno = 0;
+    ASSERT(!sol_http_progressive_response_sse_frame(NULL));
+    ASSERT_INT_EQ(errno, EINVAL);
+}
+
+struct client {
+    int fd;
+    struct sol_fd *watch;
+    struct sol_buffer received;
+    bool done;
+};
+
+struct stream {
+    struct sol_http_progressive_response *progressives[CLIENTS];
+    struct client clients[CLIENTS];
+    struct sol_blob *event;
+    unsigned int connected;
+    unsigned int fed;
+    unsigned int done;
+};
+
+static void
+feed_done_cb(void *data, struct sol_http_progressive_response *progressive,
+    struct sol_blob *blob, int status)
+{
+    struct stream *stream = data;
+
+    ASSERT_INT_EQ(status, 0);
+    ASSERT(blob == stream->event);
+
+    /* everything queued is written before the stream ends */
+    if (++stream->fed == CLIENTS) {
+        ASSERT_INT_EQ(sol_http_progressive_response_del(stream->progressives[0], true), 0);
+        ASSERT_INT_EQ(sol_http_progressive_response_del(stream->progressives[1], true), 0);
+    }
+}
+
+static int
+request_cb(void *data, struct sol_http_request *request)
+{
+    struct stream *stream = data;
+    struct sol_http_progressive_response *progressive;
+    struct sol_blob *big;
+    struct sol_http_response response = {
+        SOL_SET_API_VERSION(.api_version = SOL_HTTP_RESPONSE_API_VERSION, )
+        .content = SOL_BUFFER_INIT_EMPTY,
+        .param = SOL_HTTP_REQUEST_PARAMS_INIT,
+        .response_code = SOL_HTTP_STATUS_OK
+    };
+    struct sol_http_server_progressive_config config = {
+        SOL_SET_API_VERSION(.api_version = SOL_HTTP_SERVER_PROGRESSIVE_CONFIG_API_VERSION, )
+        .on_feed_done = feed_done_cb,
+        .user_data = stream,
+        .feed_size = FEED_SIZE
+    };
+    static char big_data[FEED_SIZE + 1];
+    unsigned int i;
+
+    ASSERT(stream->connected < CLIENTS);
+
+    response.url = sol_http_request_get_url(request);
+    ASSERT(sol_http_param_add(&response.param, SOL_HTTP_REQUEST_PARAM_HEADER(
+        "Content-Type", "text/event-stream")));
+
+    progressive = sol_http_server_send_progressive_response(request,
+        &response, &config);
+    sol_http_params_clear(&response.param);
+    ASSERT(progressive);
+    stream->progressives[stream->connected++] = progressive;
+
+    /* past feed_size, data is refused */
+    big = sol_blob_new(SOL_BLOB_TYPE_NO_FREE, NULL, big_data, sizeof(big_data));
+    ASSERT(big);
+    ASSERT_INT_EQ(sol_http_progressive_response_feed(progressive, big), -ENOSPC);
+    sol_blob_unref(big);
+
+    if (stream->connected < CLIENTS)
+        return 0;
+
+    /* framed once, the same blob is shared by every client */
+    for (i = 0; i < CLIENTS; i++)
+        ASSERT_INT_EQ(sol_http_progressive_response_feed(stream->progressives[i],
+            stream->event), 0);
+
+    return 0;
+}
+
+static bool
+client_read_cb(void *data, int fd, uint32_t cond)
+{
+    struct stream *stream = data;
+    struct client *client = NULL;
+    char buf[512];
+    ssize_t len;
+    unsigned int i;
+
+    for (i = 0; i < CLIENTS; i++) {
+        if (stream->clients[i].fd == fd)
+            client = &stream->clients[i];
+    }
+    ASSERT(client);
+
+    len = read(fd, buf, sizeof(buf));
+    if (len < 0 && (errno == EAGAIN || errno == EINTR))
+        return true;
+
+    if (len > 0)
+        ASSERT_INT_EQ(sol_buffer_append_bytes(&client->received,
+            (const uint8_t *)buf, len), 0);
+
+    /* the last chunk or the connection closed ends the stream */
+    if (len > 0 && !strstr(sol_buffer_at(&client->received, 0), "\r\n0\r\n\r\n"))
+        return true;
+
+    client->done = true;
+    client->watch = NULL;
+    if (++stream->done == CLIENTS)
+        sol_quit();
+
+    return false;
+}
+
+static void
+client_connect(struct stream *stream, struct client *client)
+{
+    static const char request[] = "GET /events HTTP/1.1\r\n"
+        "Host: localhost\r\n"
+        "Accept: text/event-stream\r\n"
+        "\r\n";
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(PORT),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+
+    sol_buffer_init(&client->received);
+
+    client->fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    ASSERT(client->fd >= 0);
+    ASSERT_INT_EQ(connect(client->fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    ASSERT_INT_EQ(write(client->fd, request, sizeof(request) - 1), sizeof(request) - 1);
+    ASSERT(fcntl(client->fd, F_SETFL, O_NONBLOCK) == 0);
+
+    client->watch = sol_fd_add(client->fd,
+        SOL_FD_FLAGS_IN | SOL_FD_FLAGS_ERR | SOL_FD_FLAGS_HUP,
+        client_read_cb, stream);
+    ASSERT(client->watch);
+}
+
+static bool
+timeout_cb(void *data)
+{
+    struct sol_timeout **timeout = data;
+
+    *timeout = NULL;
+    sol_quit();
+    return false;
+}
+
+DEFINE_TEST(test_sse_stream);
+
+static void
+test_sse_stream(void)
+{
+    struct stream stream = { };
+    struct sol_http_server *server;
+    struct sol_timeout *timeout;
+    struct sol_blob *blob;
+    struct client *client;
+    unsigned int i;
+
+    blob = blob_new_str("hello");
+    ASSERT(blob);
+    stream.event = sol_http_progressive_response_sse_frame(blob);
+    ASSERT(stream.event);
+    sol_blob_unref(blob);
+
+    server = sol_http_server_new(PORT);
+    ASSERT(server);
+    ASSERT_INT_EQ(sol_http_server_register_handler(server, "/events",
+        request_cb, &stream), 0);
+
+    for (i = 0; i < CLIENTS; i++)
+        client_connect(&stream, &stream.clients[i]);
+
+    timeout = sol_timeout_add(5000, timeout_cb, &timeout);
+    ASSERT(timeout);
+    sol_run();
+    if (timeout)
+        sol_timeout_del(timeout);
+
+    ASSERT_INT_EQ(stream.connected, CLIENTS);
+    ASSERT_INT_EQ(stream.fed, CLIENTS);
+
+    for (i = 0; i < CLIENTS; i++) {
+        client = &stream.clients[i];
+
+        ASSERT(client->done);
+        ASSERT(sol_buffer_append_char(&client->received, '\0') == 0);
+        ASSERT(strstr(client->received.data, "text/event-stream"));
+        ASSERT(strstr(client->received.data, "data: hello\n\n"));
+
+        if (client->watch)
+            sol_fd_del(client->watch);
+        close(client->fd);
+        sol_buffer_fini(&client->received);
+    }
+
+    sol_blob_unref(stream.event);
+    sol_http_server_del(server);
+}
+
+TEST_MAIN();
@@ -0,0 +1,507 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+
+#include "sol-i2c.h"
+#include "sol-mainloop.h"
+#include "sol-util-internal.h"
+
+#include "test.h"
+
+/* The I2C character device is stubbed: this test is linked with --wrap
+ * for open() and ioctl(). The device node is /dev/null, and every data
+ * transfer is logged with the slave address it went to. Register reads
+ * return the register number plus the byte offset.
+ *
+ * Operations may be done by a worker thread, so the first one of each
+ * test waits on a pipe (the gate) until everything else is queued. */
+
+#define BUS 3
+#define ADDR_A 0x10
+#define ADDR_B 0x20
+#define PLAIN_COUNT 40
+#define MAX_LOG 64
+#define MAX_OPS 64
+
+enum transfer_type {
+    TRANSFER_SMBUS,
+    TRANSFER_RDWR
+};
+
+struct transfer {
+    enum transfer_type type;
+    uint8_t addr;
+    uint8_t command;
+    uint8_t size;
+    unsigned int nmsgs;
+};
+
+static int i2c_fd = -1;
+static uint8_t slave_addr;
+static struct transfer transfers[MAX_LOG];
+static unsigned int n_transfers;
+static int fail_errno;
+static int gate[2] = { -1, -1 };
+
+static struct {
+    unsigned int order[MAX_OPS];
+    ssize_t status[MAX_OPS];
+    unsigned int calls[MAX_OPS];
+    unsigned int done;
+    unsigned int expected;
+} results;
+
+int __real_open(const char *path, int flags, ...);
+int __real_ioctl(int fd, unsigned long request, ...);
+
+int __wrap_open(const char *path, int flags, ...);
+int __wrap_ioctl(int fd, unsigned long request, ...);
+
+int
+__wrap_open(const char *path, int flags, ...)
+{
+    char buf[32];
+    va_list ap;
+    mode_t mode;
+
+    va_start(ap, flags);
+    mode = (flags & O_CREAT) ? va_arg(ap, mode_t) : 0;
+    va_end(ap);
+
+    snprintf(buf, sizeof(buf), "/dev/i2c-%u", BUS);
+    if (!streq(path, buf))
+        return __real_open(path, flags, mode);
+
+    ASSERT_INT_EQ(i2c_fd, -1);
+    i2c_fd = __real_open("/dev/null", flags);
+    return i2c_fd;
+}
+
+static void
+gate_wait(void)
+{
+    char c;
+
+    if (gate[0] < 0)
+        return;
+
+    ASSERT_INT_EQ(read(gate[0], &c, 1), 1);
+    close(gate[0]);
+    gate[0] = -1;
+}
+
+static void
+log_transfer(enum transfer_type type, uint8_t addr, uint8_t command, uint8_t size, unsigned int nmsgs)
+{
+    ASSERT(n_transfers < MAX_LOG);
+    transfers[n_transfers++] = (struct transfer){
+        .type = type,
+        .addr = addr,
+        .command = command,
+        .size = size,
+        .nmsgs = nmsgs
+    };
+}
+
+static int
+smbus_ioctl(struct i2c_smbus_ioctl_data *data)
+{
+    log_transfer(TRANSFER_SMBUS, slave_addr, data->command, data->size, 0);
+
+    if (data->read_write != I2C_SMBUS_READ || !data->data)
+        return 0;
+
+    if (data->size == I2C_SMBUS_BYTE)
+        data->data->byte = slave_addr;
+    else
+        data->data->byte = data->command;
+
+    return 0;
+}
+
+static int
+rdwr_ioctl(struct i2c_rdwr_ioctl_data *data)
+{
+    struct i2c_msg *msg;
+    uint8_t reg = 0;
+    unsigned int i, j;
+
+    ASSERT(data->nmsgs > 0);
+    ASSERT(data->nmsgs <= I2C_RDRW_IOCTL_MAX_MSGS);
+    log_transfer(TRANSFER_RDWR, data->msgs[0].addr, data->msgs[0].buf[0], 0,
+        data->nmsgs);
+
+    if (fail_errno) {
+        errno = fail_errno;
+        return -1;
+    }
+
+    for (i = 0, msg = data->msgs; i < data->nmsgs; i++, msg++) {
+        /* a single transfer goes to a single device */
+        ASSERT_INT_EQ(msg->addr, data->msgs[0].addr);
+
+        if (!(msg->flags & I2C_M_RD)) {
+            reg = msg->buf[0];
+            continue;
+        }
+        for (j = 0; j < msg->len; j++)
+            msg->buf[j] = reg + j;
+    }
+
+    return data->nmsgs;
+}
+
+int
+__wrap_ioctl(int fd, unsigned long request, ...)
+{
+    va_list ap;
+    void *arg;
+
+    va_start(ap, request);
+    arg = va_arg(ap, void *);
+    va_end(ap);
+
+    if (fd != i2c_fd)
+        return __real_ioctl(fd, request, arg);
+
+    switch (request) {
+    case I2C_FUNCS:
+        *(unsigned long *)arg = I2C_FUNC_I2C | I2C_FUNC_SMBUS_EMUL;
+        return 0;
+    case I2C_SLAVE:
+        slave_addr = (uintptr_t)arg;
+        return 0;
+    case I2C_SMBUS:
+        gate_wait();
+        return smbus_ioctl(arg);
+    case I2C_RDWR:
+        gate_wait();
+        return rdwr_ioctl(arg);
+    }
+
+    errno = ENOTTY;
+    return -1;
+}
+
+static void
+result(void *data, ssize_t status)
+{
+    unsigned int idx = (uintptr_t)data;
+
+    ASSERT(idx < MAX_OPS);
+    results.calls[idx]++;
+    results.status[idx] = status;
+    results.order[results.done++] = idx;
+    if (results.done == results.expected)
+        sol_quit();
+}
+
+static void
+write_quick_cb(void *data, struct sol_i2c *i2c, ssize_t status)
+{
+    result(data, status);
+}
+
+static void
+read_write_cb(void *data, struct sol_i2c *i2c, uint8_t *buf, ssize_t status)
+{
+    result(data, status);
+}
+
+static void
+read_write_reg_cb(void *data, struct sol_i2c *i2c, uint8_t reg, uint8_t *buf, ssize_t status)
+{
+    result(data, status);
+}
+
+static bool
+timeout_cb(void *data)
+{
+    struct sol_timeout **timeout = data;
+
+    *timeout = NULL;
+    sol_quit();
+    return false;
+}
+
+static void
+run(unsigned int expected)
+{
+    struct sol_timeout *timeout;
+
+    results.expected = expected;
+
+    /* let the first operation go */
+    ASSERT_INT_EQ(write(gate[1], "", 1), 1);
+    close(gate[1]);
+    gate[1] = -1;
+
+    timeout = sol_timeout_add(5000, timeout_cb, &timeout);
+    ASSERT(timeout);
+    sol_run();
+    if (timeout)
+        sol_timeout_del(timeout);
+
+    ASSERT_INT_EQ(results.done, expected);
+}
+
+static struct sol_i2c *
+i2c_open(void)
+{
+    struct sol_i2c *i2c;
+
+    memset(&results, 0, sizeof(results));
+    n_transfers = 0;
+    fail_errno = 0;
+
+    i2c = sol_i2c_open_raw(BUS, SOL_I2C_SPEED_100KBIT);
+    ASSERT(i2c);
+    ASSERT(i2c_fd >= 0);
+    ASSERT(sol_i2c_set_slave_address(i2c, ADDR_A));
+
+    ASSERT_INT_EQ(pipe2(gate, O_CLOEXEC), 0);
+
+    /* the operation everything else queues after */
+    ASSERT(sol_i2c_write_quick(i2c, false, write_quick_cb, (void *)0));
+    ASSERT(sol_i2c_busy(i2c));
+
+    return i2c;
+}
+
+static void
+i2c_close(struct sol_i2c *i2c)
+{
+    ASSERT(!sol_i2c_busy(i2c));
+    sol_i2c_close_raw(i2c);
+    i2c_fd = -1;
+}
+
+DEFINE_TEST(test_queue_order);
+
+static void
+test_queue_order(void)
+{
+    uint8_t reg_value, values[2], reg_write[2] = { 0xca, 0xfe };
+    struct sol_i2c *i2c;
+    unsigned int i;
+
+    i2c = i2c_open();
+
+    /* the address may change while operations are pending, each one
+     * goes to the device it was issued for */
+    ASSERT(sol_i2c_set_slave_address(i2c, ADDR_B));
+    ASSERT(sol_i2c_write_register(i2c, 0x05, reg_write, sizeof(reg_write),
+        read_write_reg_cb, (void *)1));
+    ASSERT(sol_i2c_set_slave_address(i2c, ADDR_A));
+    ASSERT(sol_i2c_read_register(i2c, 0x07, &reg_value, 1,
+        read_write_reg_cb, (void *)2));
+    ASSERT(sol_i2c_set_slave_address(i2c, ADDR_B));
+    ASSERT(sol_i2c_read(i2c, values, sizeof(values),
+        read_write_cb, (void *)3));
+    ASSERT_INT_EQ(sol_i2c_get_slave_address(i2c), ADDR_B);
+
+    run(4);
+
+    for (i = 0; i < 4; i++) {
+        ASSERT_INT_EQ(results.order[i], i);
+        ASSERT_INT_EQ(results.calls[i], 1);
+    }
+    ASSERT_INT_EQ(results.status[0], 1);
+    ASSERT_INT_EQ(results.status[1], sizeof(reg_write));
+    ASSERT_INT_EQ(results.status[2], 1);
+    ASSERT_INT_EQ(results.status[3], sizeof(values));
+
+    ASSERT_INT_EQ(n_transfers, 5);
+    ASSERT_INT_EQ(transfers[0].addr, ADDR_A);
+    ASSERT_INT_EQ(transfers[0].size, I2C_SMBUS_QUICK);
+    ASSERT_INT_EQ(transfers[1].addr, ADDR_B);
+    ASSERT_INT_EQ(transfers[1].command, 0x05);
+    ASSERT_INT_EQ(transfers[1].size, I2C_SMBUS_WORD_DATA);
+    ASSERT_INT_EQ(transfers[2].addr, ADDR_A);
+    ASSERT_INT_EQ(transfers[2].command, 0x07);
+    ASSERT_INT_EQ(transfers[2].size, I2C_SMBUS_BYTE_DATA);
+    for (i = 3; i < 5; i++) {
+        ASSERT_INT_EQ(transfers[i].addr, ADDR_B);
+        ASSERT_INT_EQ(transfers[i].size, I2C_SMBUS_BYTE);
+    }
+
+    ASSERT_INT_EQ(reg_value, 0x07);
+    ASSERT_INT_EQ(values[0], ADDR_B);
+    ASSERT_INT_EQ(values[1], ADDR_B);
+
+    i2c_close(i2c);
+}
+
+DEFINE_TEST(test_cancel);
+
+static void
+test_cancel(void)
+{
+    uint8_t values[3][1];
+    struct sol_i2c_pending *pending[3];
+    struct sol_i2c *i2c;
+    unsigned int i;
+
+    i2c = i2c_open();
+
+    for (i = 0; i < 3; i++) {
+        pending[i] = sol_i2c_read_register(i2c, 0x10 + i, values[i], 1,
+            read_write_reg_cb, (void *)(uintptr_t)(i + 1));
+        ASSERT(pending[i]);
+    }
+
+    /* the callback is called right away, the transfer is never done */
+    sol_i2c_pending_cancel(i2c, pending[1]);
+    ASSERT_INT_EQ(results.done, 1);
+    ASSERT_INT_EQ(results.order[0], 2);
+    ASSERT_INT_EQ(results.status[2], -ECANCELED);
+
+    run(4);
+
+    ASSERT_INT_EQ(results.order[1], 0);
+    ASSERT_INT_EQ(results.order[2], 1);
+    ASSERT_INT_EQ(results.order[3], 3);
+    for (i = 0; i < 4; i++)
+        ASSERT_INT_EQ(results.calls[i], 1);
+    ASSERT_INT_EQ(results.status[1], 1);
+    ASSERT_INT_EQ(results.status[3], 1);
+
+    ASSERT_INT_EQ(n_transfers, 3);
+    ASSERT_INT_EQ(transfers[1].command, 0x10);
+    ASSERT_INT_EQ(transfers[2].command, 0x12);
+
+    i2c_close(i2c);
+}
+
+DEFINE_TEST(test_combined);
+
+static void
+test_combined(void)
+{
+    const unsigned int reads = I2C_RDRW_IOCTL_MAX_MSGS / 2 + 9;
+    const unsigned int times = I2C_RDRW_IOCTL_MAX_MSGS / 2 + 9;
+    static uint8_t values[MAX_OPS][PLAIN_COUNT];
+    static uint8_t multiple[I2C_RDRW_IOCTL_MAX_MSGS][4];
+    uint8_t reg_write[PLAIN_COUNT] = { };
+    struct sol_i2c *i2c;
+    unsigned int i, j, n;
+
+    ASSERT(reads + 3 < MAX_OPS);
+    ASSERT(times <= I2C_RDRW_IOCTL_MAX_MSGS);
+
+    i2c = i2c_open();
+
+    /* too big for SMBus, so these are plain-I2C reads of two messages
+     * each: they are combined up to I2C_RDRW_IOCTL_MAX_MSGS messages */
+    for (i = 0; i < reads; i++)
+        ASSERT(sol_i2c_read_register(i2c, i, values[i], PLAIN_COUNT,
+            read_write_reg_cb, (void *)(uintptr_t)(i + 1)));
+
+    /* more messages than a transfer takes, split on its own */
+    ASSERT(sol_i2c_read_register_multiple(i2c, 0x80, multiple[0],
+        sizeof(multiple[0]), times, read_write_reg_cb,
+        (void *)(uintptr_t)(reads + 1)));
+
+    /* another device, so not combined with the reads */
+    ASSERT(sol_i2c_set_slave_address(i2c, ADDR_B));
+    ASSERT(sol_i2c_write_register(i2c, 0x90, reg_write, sizeof(reg_write),
+        read_write_reg_cb, (void *)(uintptr_t)(reads + 2)));
+
+    run(reads + 3);
+
+    for (i = 0; i < reads + 3; i++) {
+        ASSERT_INT_EQ(results.order[i], i);
+        ASSERT_INT_EQ(results.calls[i], 1);
+    }
+    for (i = 1; i <= reads; i++)
+        ASSERT_INT_EQ(results.status[i], PLAIN_COUNT);
+    ASSERT_INT_EQ(results.status[reads + 1], sizeof(multiple[0]) * times);
+    ASSERT_INT_EQ(results.status[reads + 2], sizeof(reg_write));
+
+    /* quick, two combined reads, two halves of the multiple read and
+     * the write */
+    ASSERT_INT_EQ(n_transfers, 6);
+    ASSERT_INT_EQ(transfers[0].type, TRANSFER_SMBUS);
+    n = I2C_RDRW_IOCTL_MAX_MSGS / 2;
+    ASSERT_INT_EQ(transfers[1].nmsgs, n * 2);
+    ASSERT_INT_EQ(transfers[1].command, 0);
+    ASSERT_INT_EQ(transfers[2].nmsgs, (reads - n) * 2);
+    ASSERT_INT_EQ(transfers[2].command, n);
+    ASSERT_INT_EQ(transfers[3].nmsgs, n * 2);
+    ASSERT_INT_EQ(transfers[3].command, 0x80);
+    ASSERT_INT_EQ(transfers[4].nmsgs, (times - n) * 2);
+    ASSERT_INT_EQ(transfers[4].command, 0x80);
+    for (i = 1; i < 5; i++) {
+        ASSERT_INT_EQ(transfers[i].type, TRANSFER_RDWR);
+        ASSERT_INT_EQ(transfers[i].addr, ADDR_A);
+    }
+    ASSERT_INT_EQ(transfers[5].type, TRANSFER_RDWR);
+    ASSERT_INT_EQ(transfers[5].nmsgs, 1);
+    ASSERT_INT_EQ(transfers[5].addr, ADDR_B);
+    ASSERT_INT_EQ(transfers[5].command, 0x90);
+
+    /* every read got its own data */
+    for (i = 0; i < reads; i++) {
+        for (j = 0; j < PLAIN_COUNT; j++)
+            ASSERT_INT_EQ(values[i][j], (uint8_t)(i + j));
+    }
+    for (i = 0; i < times; i++) {
+        for (j = 0; j < sizeof(multiple[0]); j++)
+            ASSERT_INT_EQ(multiple[i][j], 0x80 + j);
+    }
+
+    i2c_close(i2c);
+}
+
+DEFINE_TEST(test_combined_error);
+
+static void
+test_combined_error(void)
+{
+    uint8_t values[3][PLAIN_COUNT];
+    struct sol_i2c *i2c;
+    unsigned int i;
+
+    i2c = i2c_open();
+    fail_errno = EIO;
+
+    for (i = 0; i < 3; i++)
+        ASSERT(sol_i2c_read_register(i2c, i, values[i], PLAIN_COUNT,
+            read_write_reg_cb, (void *)(uintptr_t)(i + 1)));
+
+    run(4);
+
+    /* the kernel doesn't tell which message failed */
+    ASSERT_INT_EQ(n_transfers, 2);
+    ASSERT_INT_EQ(transfers[1].nmsgs, 6);
+    for (i = 1; i < 4; i++)
+        ASSERT_INT_EQ(results.status[i], -EIO);
+
+    i2c_close(i2c);
+}
+
+TEST_MAIN();
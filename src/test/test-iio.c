@@ -0,0 +1,287 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "sol-iio.h"
+#include "sol-mainloop.h"
+#include "sol-util-file.h"
+#include "sol-util-internal.h"
+
+#include "test.h"
+
+/* Buffered reads are tested against a fake sysfs tree, with a FIFO
+ * standing for the device node. */
+
+#define AXES 3
+#define BATCH_SIZE 3
+#define SCANS 5
+
+static const char *const axes[AXES] = {
+    "in_accel_x", "in_accel_y", "in_accel_z"
+};
+
+static char root[] = "/tmp/sol-test-iio-XXXXXX";
+static bool root_named;
+
+struct reading {
+    struct sol_iio_channel *channels[AXES];
+    unsigned int batches;
+    unsigned int scans;
+};
+
+static void
+write_attribute(const char *name, const char *value)
+{
+    char path[PATH_MAX];
+    int r;
+
+    r = snprintf(path, sizeof(path), "%s/sys/%s", root, name);
+    ASSERT(r >= 0 && (size_t)r < sizeof(path));
+    r = sol_util_write_file(path, "%s\n", value);
+    ASSERT(r > 0);
+}
+
+static void
+make_dir(const char *name)
+{
+    char path[PATH_MAX];
+    int len;
+
+    len = snprintf(path, sizeof(path), "%s/%s", root, name);
+    ASSERT(len >= 0 && (size_t)len < sizeof(path));
+    ASSERT_INT_EQ(mkdir(path, 0700), 0);
+}
+
+static int
+remove_cb(const char *path, const struct stat *st, int flag, struct FTW *ftw)
+{
+    return remove(path);
+}
+
+static int
+create_tree(void)
+{
+    char name[NAME_MAX], path[PATH_MAX];
+    unsigned int i;
+    int fd;
+
+    /* sysfs path is looked up once, so every test uses the same one */
+    if (root_named) {
+        ASSERT_INT_EQ(mkdir(root, 0700), 0);
+    } else {
+        ASSERT(mkdtemp(root));
+        root_named = true;
+    }
+    make_dir("sys");
+    make_dir("dev");
+    make_dir("sys/iio:device0");
+    make_dir("sys/iio:device0/trigger");
+    make_dir("sys/iio:device0/buffer");
+    make_dir("sys/iio:device0/scan_elements");
+    make_dir("sys/trigger0");
+
+    write_attribute("iio:device0/name", "fake_accel");
+    write_attribute("iio:device0/trigger/current_trigger", "fake_trigger");
+    write_attribute("iio:device0/buffer/enable", "0");
+    write_attribute("iio:device0/buffer/length", "2");
+    write_attribute("iio:device0/buffer/watermark", "1");
+    write_attribute("trigger0/name", "fake_trigger");
+
+    for (i = 0; i < AXES; i++) {
+        snprintf(name, sizeof(name), "iio:device0/%s_raw", axes[i]);
+        write_attribute(name, "0");
+        snprintf(name, sizeof(name), "iio:device0/scan_elements/%s_en", axes[i]);
+        write_attribute(name, "0");
+        snprintf(name, sizeof(name), "iio:device0/scan_elements/%s_index", axes[i]);
+        write_attribute(name, i == 0 ? "0" : i == 1 ? "1" : "2");
+        /* 6 bytes scans, not a power of two */
+        snprintf(name, sizeof(name), "iio:device0/scan_elements/%s_type", axes[i]);
+        write_attribute(name, "le:s16/16>>0");
+    }
+
+    snprintf(path, sizeof(path), "%s/dev/iio:device0", root);
+    ASSERT_INT_EQ(mkfifo(path, 0600), 0);
+
+    /* keep a writer around, so device never sees a hang up */
+    fd = open(path, O_RDWR | O_CLOEXEC | O_NONBLOCK);
+    ASSERT(fd >= 0);
+
+    snprintf(path, sizeof(path), "%s/sys", root);
+    setenv("SOL_IIO_SYSFS_DEVICES_PATH", path, 1);
+    snprintf(path, sizeof(path), "%s/dev", root);
+    setenv("SOL_IIO_DEV_PATH", path, 1);
+
+    return fd;
+}
+
+static void
+reader_cb(void *data, struct sol_iio_device *device)
+{
+    struct reading *reading = data;
+    const double *samples;
+    unsigned int i, j, count;
+    double value;
+
+    for (i = 0; i < AXES; i++) {
+        samples = sol_iio_read_channel_samples(reading->channels[i], &count);
+        ASSERT(samples);
+        ASSERT(count > 0);
+        ASSERT(count <= BATCH_SIZE);
+
+        for (j = 0; j < count; j++)
+            ASSERT_INT_EQ(samples[j], (reading->scans + j) * (i + 1) - (int)i);
+
+        ASSERT(sol_iio_read_channel_value(reading->channels[i], &value));
+        ASSERT_INT_EQ(value, samples[count - 1]);
+    }
+
+    reading->batches++;
+    reading->scans += count;
+    if (reading->scans == SCANS)
+        sol_quit();
+}
+
+static bool
+timeout_cb(void *data)
+{
+    struct sol_timeout **timeout = data;
+
+    *timeout = NULL;
+    sol_quit();
+    return false;
+}
+
+DEFINE_TEST(test_buffer_batch);
+
+static void
+test_buffer_batch(void)
+{
+    struct sol_iio_config config = {
+        SOL_SET_API_VERSION(.api_version = SOL_IIO_CONFIG_API_VERSION, )
+        .sol_iio_reader_cb = reader_cb,
+        .buffer_size = 0,
+        .sampling_frequency = -1,
+        .batch_size = BATCH_SIZE,
+    };
+    struct sol_iio_channel_config channel_config = SOL_IIO_CHANNEL_CONFIG_INIT;
+    struct reading reading = { };
+    struct sol_iio_device *device;
+    struct sol_timeout *timeout;
+    int16_t scans[SCANS][AXES];
+    unsigned int i, j;
+    int fd;
+
+    fd = create_tree();
+    config.data = &reading;
+
+    device = sol_iio_open(0, &config);
+    ASSERT(device);
+
+    channel_config.scale = 1.0;
+    channel_config.use_custom_offset = true;
+    for (i = 0; i < AXES; i++) {
+        reading.channels[i] = sol_iio_add_channel(device, axes[i], &channel_config);
+        ASSERT(reading.channels[i]);
+    }
+    ASSERT(sol_iio_device_start_buffer(device));
+
+    /* More scans than a batch at once: no more than a batch must be
+     * decoded on a single reading */
+    for (i = 0; i < SCANS; i++) {
+        for (j = 0; j < AXES; j++)
+            scans[i][j] = i * (j + 1) - j;
+    }
+    ASSERT_INT_EQ(write(fd, scans, sizeof(scans)), sizeof(scans));
+
+    timeout = sol_timeout_add(5000, timeout_cb, &timeout);
+    ASSERT(timeout);
+    sol_run();
+    if (timeout)
+        sol_timeout_del(timeout);
+
+    ASSERT_INT_EQ(reading.scans, SCANS);
+    ASSERT_INT_EQ(reading.batches, 2);
+
+    sol_iio_close(device);
+    close(fd);
+    nftw(root, remove_cb, 8, FTW_DEPTH | FTW_PHYS);
+}
+
+DEFINE_TEST(test_sysfs_reopen);
+
+static void
+test_sysfs_reopen(void)
+{
+    struct sol_iio_config config = {
+        SOL_SET_API_VERSION(.api_version = SOL_IIO_CONFIG_API_VERSION, )
+        .buffer_size = -1,
+        .sampling_frequency = -1,
+    };
+    struct sol_iio_channel_config channel_config = SOL_IIO_CHANNEL_CONFIG_INIT;
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    struct sol_iio_channel *channel;
+    struct sol_iio_device *device;
+    double value;
+    int fd, sock, len;
+
+    fd = create_tree();
+
+    /* the attribute exists, but can't be opened */
+    len = snprintf(addr.sun_path, sizeof(addr.sun_path),
+        "%s/sys/iio:device0/%s_raw", root, axes[0]);
+    ASSERT(len >= 0 && (size_t)len < sizeof(addr.sun_path));
+    ASSERT_INT_EQ(unlink(addr.sun_path), 0);
+    sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    ASSERT(sock >= 0);
+    ASSERT_INT_EQ(bind(sock, (struct sockaddr *)&addr, sizeof(addr)), 0);
+
+    device = sol_iio_open(0, &config);
+    ASSERT(device);
+
+    channel_config.scale = 1.0;
+    channel_config.use_custom_offset = true;
+    channel = sol_iio_add_channel(device, axes[0], &channel_config);
+    ASSERT(channel);
+    ASSERT(!sol_iio_read_channel_value(channel, &value));
+
+    close(sock);
+    ASSERT_INT_EQ(unlink(addr.sun_path), 0);
+    write_attribute("iio:device0/in_accel_x_raw", "21");
+    ASSERT(sol_iio_read_channel_value(channel, &value));
+    ASSERT_INT_EQ(value, 21);
+
+    /* then it's kept open */
+    write_attribute("iio:device0/in_accel_x_raw", "-4");
+    ASSERT(sol_iio_read_channel_value(channel, &value));
+    ASSERT_INT_EQ(value, -4);
+
+    sol_iio_close(device);
+    close(fd);
+    nftw(root, remove_cb, 8, FTW_DEPTH | FTW_PHYS);
+}
+
+TEST_MAIN();
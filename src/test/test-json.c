@@ -23,6 +23,8 @@
 #include "sol-util.h"
 #include <float.h>
 
+#include "sol-json-scan.h"
+
 #define TOKENS (const enum sol_json_type[])
 struct test_entry {
     const char *input;
@@ -567,4 +569,302 @@ test_json_token_get_double(void)
     }
 }
 
+DEFINE_TEST(test_json_long_runs);
+
+static void
+test_json_long_runs(void)
+{
+    /* whitespace, strings and numbers longer than the vector blocks
+     * used by the scanner, with interesting bytes around the block
+     * boundaries */
+    static const char doc[] =
+        "  \t\t\n\n\r\r                                        \n{"
+        "\"0123456789abcdefghij\\\"klmnopqrstuvwxyz0123456789ABCDEFGHIJ\\\\\\n\\u0041\""
+        "                                 :"
+        "[1234567890123456789012345678901234567890.12345678901234567890123456789e+12345,"
+        "\v\f 0, -1.5,"
+        "\"abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz\"]}   \t";
+    static const enum sol_json_type types[] = {
+        SOL_JSON_TYPE_OBJECT_START,
+        SOL_JSON_TYPE_STRING,
+        SOL_JSON_TYPE_PAIR_SEP,
+        SOL_JSON_TYPE_ARRAY_START,
+        SOL_JSON_TYPE_NUMBER,
+        SOL_JSON_TYPE_ELEMENT_SEP,
+        SOL_JSON_TYPE_NUMBER,
+        SOL_JSON_TYPE_ELEMENT_SEP,
+        SOL_JSON_TYPE_NUMBER,
+        SOL_JSON_TYPE_ELEMENT_SEP,
+        SOL_JSON_TYPE_STRING,
+        SOL_JSON_TYPE_ARRAY_END,
+        SOL_JSON_TYPE_OBJECT_END,
+    };
+    static const char *bad_docs[] = {
+        "\"0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefghij",
+        "\"0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdef\\x\"",
+        "\"0123456789abcdefghijklmnopqrstuvwxyz0123456789abcdefgh\\",
+        "                                                      x",
+        "                                                   nul",
+    };
+    struct sol_json_scanner scanner;
+    struct sol_json_token token;
+    char *str;
+    unsigned int i;
+
+    sol_json_scanner_init(&scanner, doc, sizeof(doc) - 1);
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(types); i++) {
+        ASSERT(sol_json_scanner_next(&scanner, &token));
+        ASSERT_INT_EQ(sol_json_token_get_type(&token), types[i]);
+
+        if (i == 1) {
+            str = sol_json_token_get_unescaped_string_copy(&token);
+            ASSERT(str);
+            ASSERT_STR_EQ(str, "0123456789abcdefghij\"klmnopqrstuvwxyz"
+                "0123456789ABCDEFGHIJ\\\nA");
+            free(str);
+        } else if (i == 4) {
+            ASSERT_INT_EQ(sol_json_token_get_size(&token), 77);
+        } else if (i == 10) {
+            ASSERT_INT_EQ(sol_json_token_get_size(&token), 54);
+        }
+    }
+    ASSERT(!sol_json_scanner_next(&scanner, &token));
+    ASSERT_INT_EQ(errno, 0);
+
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(bad_docs); i++) {
+        sol_json_scanner_init(&scanner, bad_docs[i], strlen(bad_docs[i]));
+        ASSERT(!sol_json_scanner_next(&scanner, &token));
+        ASSERT_INT_EQ(errno, EINVAL);
+    }
+}
+
+DEFINE_TEST(test_json_index);
+
+static void
+test_json_index(void)
+{
+    static const char doc[] =
+        "{\"a\": {\"b\": [1, {\"c\": \"x\"}, [true, null]]},"
+        " \"it's\": -2.5, \"\\u0041\": false, \"a\": 3, \"d\": []}";
+    static const struct {
+        const char *path;
+        int r;
+    } paths[] = {
+        { "$.a", 0 },
+        { "$.a.b", 0 },
+        { "$.a.b[0]", 0 },
+        { "$.a.b[1].c", 0 },
+        { "$.a.b[2][1]", 0 },
+        { "$['a']['b'][1]['c']", 0 },
+        { "$['it\\'s']", 0 },
+        { "$.\\u0041", 0 },
+        { "$.d", 0 },
+        { "$.a.b[3]", -ENOENT },
+        { "$.d[0]", -ENOENT },
+        { "$.a[0]", -ENOENT },
+        { "$.a.b.c", -ENOENT },
+        { "$.a.b[1].c.d", -ENOENT },
+        { "$.x", -ENOENT },
+        { "a.b", -ENOENT },
+    };
+    static const char *bad_docs[] = {
+        "",
+        "{",
+        "{\"a\" 1}",
+        "{\"a\": 1,}",
+        "[1, 2,]",
+        "[1 2]",
+        "{1: 2}",
+        "[1}",
+        "{\"a\": 1]",
+        "[] []",
+        "[1, tru]",
+    };
+    static const char padded[] = " \n\t{\"a\": [1, {\"b\": 2}]}";
+    static const char *padded_paths[] = { "$.a[1].b", "$.a", "$" };
+    struct sol_json_index *index;
+    struct sol_json_scanner scanner;
+    struct sol_json_token token, key, expected;
+    unsigned int i;
+    int r;
+
+    index = sol_json_index_new(doc, sizeof(doc) - 1);
+    ASSERT(index);
+
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(paths); i++) {
+        r = sol_json_index_get_value_by_path(index,
+            sol_str_slice_from_str(paths[i].path), &token);
+        ASSERT_INT_EQ(r, paths[i].r);
+        if (r < 0)
+            continue;
+
+        /* indexed tokens span the whole value */
+        sol_json_scanner_init(&scanner, doc, sizeof(doc) - 1);
+        ASSERT_INT_EQ(sol_json_get_value_by_path(&scanner,
+            sol_str_slice_from_str(paths[i].path), &expected), 0);
+        ASSERT(token.start == expected.start);
+        if (sol_json_token_get_type(&expected) == SOL_JSON_TYPE_OBJECT_START ||
+            sol_json_token_get_type(&expected) == SOL_JSON_TYPE_ARRAY_START) {
+            sol_json_scanner_init(&scanner, expected.start,
+                doc + sizeof(doc) - 1 - expected.start);
+            ASSERT(sol_json_scanner_next(&scanner, &expected));
+            ASSERT(sol_json_scanner_skip_over(&scanner, &expected));
+        }
+        ASSERT(token.end == expected.end);
+    }
+
+    ASSERT_INT_EQ(sol_json_index_get_value_by_path(index,
+        sol_str_slice_from_str("$"), &token), 0);
+    ASSERT(token.start == doc);
+    ASSERT(token.end == doc + sizeof(doc) - 1);
+
+    /* first match wins on duplicated keys, like the scanner */
+    ASSERT_INT_EQ(sol_json_index_object_get_value_by_key(index,
+        sol_str_slice_from_str("a"), &token), 0);
+    ASSERT_INT_EQ(sol_json_token_get_type(&token), SOL_JSON_TYPE_OBJECT_START);
+    ASSERT_INT_EQ(sol_json_index_object_get_value_by_key(index,
+        sol_str_slice_from_str("b"), &token), -ENOENT);
+    ASSERT_INT_EQ(sol_json_index_array_get_at_index(index, 0, &token),
+        -EINVAL);
+
+    ASSERT_INT_EQ(sol_json_index_get_member_count(index), 5);
+    ASSERT_INT_EQ(sol_json_index_get_member(index, 1, &key, &token), 0);
+    ASSERT(sol_json_token_str_eq(&key, "it's", strlen("it's")));
+    ASSERT_INT_EQ(sol_json_token_get_type(&token), SOL_JSON_TYPE_NUMBER);
+    ASSERT_INT_EQ(sol_json_index_get_member(index, 5, &key, &token), -ENOENT);
+    sol_json_index_del(index);
+
+    index = sol_json_index_new("[[], {}, \"s\"]", strlen("[[], {}, \"s\"]"));
+    ASSERT(index);
+    ASSERT_INT_EQ(sol_json_index_get_member_count(index), 3);
+    ASSERT_INT_EQ(sol_json_index_array_get_at_index(index, 2, &token), 0);
+    ASSERT(SOL_JSON_TOKEN_STR_LITERAL_EQ(&token, "s"));
+    ASSERT_INT_EQ(sol_json_index_array_get_at_index(index, 3, &token),
+        -ENOENT);
+    ASSERT_INT_EQ(sol_json_index_get_member(index, 1, &key, &token), 0);
+    ASSERT(!key.start);
+    ASSERT_INT_EQ(sol_json_token_get_size(&token), 2);
+    sol_json_index_del(index);
+
+    index = sol_json_index_new("42", 2);
+    ASSERT(index);
+    ASSERT_INT_EQ(sol_json_index_get_member_count(index), 0);
+    ASSERT_INT_EQ(sol_json_index_get_value_by_path(index,
+        sol_str_slice_from_str("$"), &token), -EINVAL);
+    sol_json_index_del(index);
+
+    /* scanning and the index agree on the root of padded documents */
+    index = sol_json_index_new(padded, strlen(padded));
+    ASSERT(index);
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(padded_paths); i++) {
+        r = sol_json_index_get_value_by_path(index,
+            sol_str_slice_from_str(padded_paths[i]), &token);
+        ASSERT_INT_EQ(r, 0);
+        sol_json_scanner_init(&scanner, padded, strlen(padded));
+        r = sol_json_get_value_by_path(&scanner,
+            sol_str_slice_from_str(padded_paths[i]), &expected);
+        ASSERT_INT_EQ(r, 0);
+        ASSERT(token.start == expected.start);
+    }
+    ASSERT(token.start == padded + 3);
+    sol_json_index_del(index);
+
+    sol_json_scanner_init(&scanner, "  ", 2);
+    r = sol_json_get_value_by_path(&scanner,
+        sol_str_slice_from_str("$"), &expected);
+    ASSERT_INT_EQ(r, -ENOENT);
+
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(bad_docs); i++) {
+        index = sol_json_index_new(bad_docs[i], strlen(bad_docs[i]));
+        ASSERT(!index);
+        ASSERT_INT_EQ(errno, EINVAL);
+    }
+}
+
+/* Compares a scanner to a byte at a time loop over a run of 'fill'
+ * bytes stopped by 'stop', for every run length and alignment. */
+static void
+check_scan_run(const char *(*scan)(const char *p, const char *end),
+    const char *fill, char stop, bool (*in_run)(char c))
+{
+    char buf[128];
+    const char *p, *end, *expected;
+    size_t start, len, i, fill_len = strlen(fill);
+
+    for (start = 0; start < 32; start++) {
+        for (len = 0; start + len < sizeof(buf) - 1; len++) {
+            for (i = 0; i < sizeof(buf); i++)
+                buf[i] = fill[i % fill_len];
+            buf[start + len] = stop;
+
+            p = buf + start;
+            for (end = p + len + 1; end <= buf + sizeof(buf); end += 31) {
+                expected = p;
+                while (expected < end && in_run(*expected))
+                    expected++;
+                ASSERT(scan(p, end) == expected);
+            }
+        }
+    }
+}
+
+static bool
+in_whitespace_run(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static bool
+in_string_run(char c)
+{
+    return c != '"' && c != '\\';
+}
+
+static bool
+in_digit_run(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+DEFINE_TEST(test_json_scan_implementations);
+
+static void
+test_json_scan_implementations(void)
+{
+    static const char *names[] = { "scalar", "sse2", "avx2" };
+    static const char whitespace_stops[] = { 'x', '\v', '\f', '\0', (char)0xa0 };
+    static const char string_stops[] = { '"', '\\' };
+    static const char digit_stops[] = { '/', ':', '.', '\0', (char)0xb5 };
+    const struct sol_json_scan_ops *ops, *saved;
+    unsigned int i, j;
+
+    saved = sol_json_scan_get_ops();
+
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(names); i++) {
+        ops = sol_json_scan_ops_get(names[i]);
+        if (!ops) {
+            SOL_DBG("JSON scanner %s implementation not supported, skipping", names[i]);
+            continue;
+        }
+
+        for (j = 0; j < SOL_UTIL_ARRAY_SIZE(whitespace_stops); j++)
+            check_scan_run(ops->skip_whitespace, " \t\n\r  ",
+                whitespace_stops[j], in_whitespace_run);
+        for (j = 0; j < SOL_UTIL_ARRAY_SIZE(string_stops); j++)
+            check_scan_run(ops->find_string_delim, "ab\x80\xa2\xdc 0\x7f",
+                string_stops[j], in_string_run);
+        for (j = 0; j < SOL_UTIL_ARRAY_SIZE(digit_stops); j++)
+            check_scan_run(ops->skip_digits, "0123456789",
+                digit_stops[j], in_digit_run);
+
+        /* and the tokenizer on top of it */
+        sol_json_scan_ops = ops;
+        test_json();
+        test_json_long_runs();
+        test_json_index();
+    }
+
+    sol_json_scan_ops = saved;
+}
+
 TEST_MAIN();
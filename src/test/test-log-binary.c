@@ -0,0 +1,225 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "sol-log-binary.h"
+#include "sol-str-slice.h"
+#include "sol-util-internal.h"
+
+#include "test.h"
+
+static ssize_t
+pack(void *buf, size_t size, const char *format, ...)
+{
+    va_list args;
+    ssize_t r;
+
+    va_start(args, format);
+    r = sol_log_binary_pack(buf, size, format, args);
+    va_end(args);
+
+    return r;
+}
+
+/* Packs and formats, then compares with the output of vsnprintf() */
+static bool
+roundtrip(const char *format, ...)
+{
+    char expected[256], output[256];
+    uint8_t args[256];
+    va_list ap, copy;
+    ssize_t packed;
+    int len;
+
+    va_start(ap, format);
+    va_copy(copy, ap);
+    vsnprintf(expected, sizeof(expected), format, copy);
+    va_end(copy);
+    packed = sol_log_binary_pack(args, sizeof(args), format, ap);
+    va_end(ap);
+
+    if (packed < 0) {
+        fprintf(stderr, "could not pack \"%s\": %zd\n", format, packed);
+        return false;
+    }
+
+    len = sol_log_binary_format(output, sizeof(output), format, args, packed);
+    if (len != (int)strlen(expected) || !streq(expected, output)) {
+        fprintf(stderr, "\"%s\": expected \"%s\", got \"%s\" (%d)\n",
+            format, expected, output, len);
+        return false;
+    }
+
+    return true;
+}
+
+/* formats can't be in the expression given to ASSERT() */
+#define ASSERT_ROUNDTRIP(...) \
+    do { \
+        bool ok = roundtrip(__VA_ARGS__); \
+        ASSERT(ok); \
+    } while (0)
+
+DEFINE_TEST(test_format);
+
+static void
+test_format(void)
+{
+    struct sol_str_slice slice = SOL_STR_SLICE_LITERAL("sliced string");
+    int i = 42;
+
+    slice.len = 6;
+
+    ASSERT_ROUNDTRIP("no conversions");
+    ASSERT_ROUNDTRIP("");
+    ASSERT_ROUNDTRIP("%d %i %u %x %X %o", -1, 2, 3u, 0xbeefu, 0xbeefu, 8u);
+    ASSERT_ROUNDTRIP("%hhx %hd %c", 0x1ff, (short)-7, 'z');
+    ASSERT_ROUNDTRIP("%ld %lu %lld %llx", -1L, ~0UL, -1LL, ~0ULL);
+    ASSERT_ROUNDTRIP("%jd %zu %zd %td", (intmax_t)-3, (size_t)7, (ssize_t)-5,
+        (ptrdiff_t)-9);
+    ASSERT_ROUNDTRIP("%" PRIu64 " %" PRId32 " %" PRIx16, UINT64_MAX, INT32_MIN,
+        (uint16_t)0xabc);
+    ASSERT_ROUNDTRIP("%f %.2e %10.3g %a %lf", 3.5, 1e10, 0.000123, 1.0, -2.25);
+    ASSERT_ROUNDTRIP("%Lf", (long double)1.0 / 3);
+    ASSERT_ROUNDTRIP("%s|%10s|%-10s|%.3s", "a", "right", "left", "truncated");
+    ASSERT_ROUNDTRIP("%.*s!", SOL_STR_SLICE_PRINT(slice));
+    ASSERT_ROUNDTRIP("%*d|%-*d|%.*f|%*.*f", 5, 1, 5, 2, 2, 3.14159, 8, 1, 2.5);
+    ASSERT_ROUNDTRIP("%.*s|", -1, "negative precision");
+    ASSERT_ROUNDTRIP("%p %p", &i, NULL);
+    ASSERT_ROUNDTRIP("100%% %d%%", 50);
+    ASSERT_ROUNDTRIP("%+d % d %05d %#x %'d", 1, 2, 3, 4u, 5);
+}
+
+DEFINE_TEST(test_truncated_output);
+
+static void
+test_truncated_output(void)
+{
+    uint8_t args[64];
+    char out[8];
+    ssize_t packed;
+    int len;
+
+    packed = pack(args, sizeof(args), "%s=%d", "answer", 42);
+    ASSERT(packed > 0);
+
+    len = sol_log_binary_format(out, sizeof(out), "%s=%d", args, packed);
+    ASSERT_INT_EQ(len, 9);
+    ASSERT_STR_EQ(out, "answer=");
+
+    len = sol_log_binary_format(NULL, 0, "%s=%d", args, packed);
+    ASSERT_INT_EQ(len, 9);
+
+    /* arguments not matching the format */
+    len = sol_log_binary_format(out, sizeof(out), "%s=%d%d", args, packed);
+    ASSERT_INT_EQ(len, -EINVAL);
+}
+
+DEFINE_TEST(test_unsupported);
+
+static void
+test_unsupported(void)
+{
+    uint8_t args[16];
+    ssize_t r;
+    int n;
+
+    r = pack(args, sizeof(args), "%n", &n);
+    ASSERT_INT_EQ(r, -EINVAL);
+    r = pack(args, sizeof(args), "%m");
+    ASSERT_INT_EQ(r, -EINVAL);
+    r = pack(args, sizeof(args), "%1$d", 1);
+    ASSERT_INT_EQ(r, -EINVAL);
+    r = pack(args, sizeof(args), "%*1$d", 1);
+    ASSERT_INT_EQ(r, -EINVAL);
+    r = pack(args, sizeof(args), "%ls", L"wide");
+    ASSERT_INT_EQ(r, -EINVAL);
+
+    r = pack(args, sizeof(args), "%d %d %d", 1, 2, 3);
+    ASSERT_INT_EQ(r, -ENOBUFS);
+    r = pack(args, sizeof(args), "%s", "longer than sixteen bytes");
+    ASSERT_INT_EQ(r, -ENOBUFS);
+}
+
+DEFINE_TEST(test_file);
+
+static void
+test_file(void)
+{
+    struct sol_buffer storage = SOL_BUFFER_INIT_EMPTY;
+    struct sol_log_binary_record rec = {
+        .domain = "test",
+        .file = __FILE__,
+        .function = __PRETTY_FUNCTION__,
+        .format = "%s %d",
+        .thread = 1234,
+        .pid = 99,
+        .level = 2,
+    };
+    uint64_t main_thread;
+    uint32_t main_pid;
+    uint8_t args[64];
+    char out[64];
+    ssize_t packed;
+    FILE *fp;
+    int i;
+
+    packed = pack(args, sizeof(args), rec.format, "record", 0);
+    ASSERT(packed > 0);
+    rec.args = args;
+    rec.args_size = packed;
+
+    fp = tmpfile();
+    ASSERT(fp);
+
+    ASSERT_INT_EQ(sol_log_binary_write_header(fp, 1, 2), 0);
+    for (i = 0; i < 3; i++) {
+        rec.line = i;
+        ASSERT_INT_EQ(sol_log_binary_write(fp, &rec), 0);
+    }
+
+    rewind(fp);
+    ASSERT_INT_EQ(sol_log_binary_read_header(fp, &main_thread, &main_pid), 0);
+    ASSERT_INT_EQ(main_thread, 1);
+    ASSERT_INT_EQ(main_pid, 2);
+
+    for (i = 0; i < 3; i++) {
+        memset(&rec, 0, sizeof(rec));
+        ASSERT_INT_EQ(sol_log_binary_read(fp, &storage, &rec), 0);
+        ASSERT_STR_EQ(rec.domain, "test");
+        ASSERT_STR_EQ(rec.file, __FILE__);
+        ASSERT_STR_EQ(rec.function, __PRETTY_FUNCTION__);
+        ASSERT_INT_EQ(rec.line, i);
+        ASSERT_INT_EQ(rec.thread, 1234);
+        ASSERT_INT_EQ(rec.pid, 99);
+        ASSERT_INT_EQ(rec.level, 2);
+        ASSERT_INT_EQ(sol_log_binary_format(out, sizeof(out), rec.format,
+            rec.args, rec.args_size), 8);
+        ASSERT_STR_EQ(out, "record 0");
+    }
+
+    ASSERT_INT_EQ(sol_log_binary_read(fp, &storage, &rec), -ENODATA);
+
+    fclose(fp);
+    sol_buffer_fini(&storage);
+}
+
+TEST_MAIN();
@@ -19,6 +19,7 @@
 #include "sol-mainloop.h"
 #include "sol-message-digest.h"
 #include "sol-buffer.h"
+#include "sol-util-internal.h"
 
 #include "test.h"
 
@@ -407,4 +408,99 @@ test_feed_after_last(void)
     sol_run();
 }
 
+DEFINE_TEST(test_del_pending);
+
+static struct sol_blob *del_pending_blobs[3];
+
+/* data is set for handles that may report before being deleted */
+static void
+on_digest_ready_del_pending(void *data, struct sol_message_digest *handle, struct sol_blob *digest)
+{
+    ASSERT(data);
+}
+
+static void
+on_feed_done_del_pending(void *data, struct sol_message_digest *handle, struct sol_blob *input)
+{
+    ASSERT(data);
+}
+
+static bool
+on_timeout_del_pending_check(void *data)
+{
+    uint8_t i;
+
+    /* the handles are gone, so must be their references to the input */
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(del_pending_blobs); i++) {
+        ASSERT_INT_EQ(del_pending_blobs[i]->refcnt, 1);
+        sol_blob_unref(del_pending_blobs[i]);
+    }
+
+    sol_quit();
+    return false;
+}
+
+static bool
+on_timeout_del_pending_later(void *data)
+{
+    sol_message_digest_del(data);
+    sol_timeout_add(100, on_timeout_del_pending_check, NULL);
+    return false;
+}
+
+static bool
+on_timeout_del_pending(void *data)
+{
+    struct sol_message_digest_config cfg = {
+        SOL_SET_API_VERSION(.api_version = SOL_MESSAGE_DIGEST_CONFIG_API_VERSION, )
+        .algorithm = "sha512",
+        .on_digest_ready = on_digest_ready_del_pending,
+        .on_feed_done = on_feed_done_del_pending,
+    };
+    struct sol_message_digest *md;
+    static char mem[] = "x";
+    uint8_t i;
+    int r;
+
+    init_big_blobs();
+
+    del_pending_blobs[0] = sol_blob_new(SOL_BLOB_TYPE_NO_FREE, NULL,
+        mem, sizeof(mem));
+    ASSERT(del_pending_blobs[0] != NULL);
+    for (i = 1; i < SOL_UTIL_ARRAY_SIZE(del_pending_blobs); i++) {
+        del_pending_blobs[i] = sol_blob_new(SOL_BLOB_TYPE_NO_FREE, NULL,
+            big_blob_of_chars, sizeof(big_blob_of_chars));
+        ASSERT(del_pending_blobs[i] != NULL);
+    }
+
+    /* deleted before anything is processed, small and big inputs */
+    for (i = 0; i < 2; i++) {
+        md = sol_message_digest_new(&cfg);
+        ASSERT(md != NULL);
+
+        r = sol_message_digest_feed(md, del_pending_blobs[i], true);
+        ASSERT_INT_EQ(r, 0);
+
+        sol_message_digest_del(md);
+    }
+
+    /* deleted while a big input is possibly being processed */
+    cfg.data = del_pending_blobs;
+    md = sol_message_digest_new(&cfg);
+    ASSERT(md != NULL);
+
+    r = sol_message_digest_feed(md, del_pending_blobs[2], true);
+    ASSERT_INT_EQ(r, 0);
+
+    sol_timeout_add(0, on_timeout_del_pending_later, md);
+    return false;
+}
+
+static void
+test_del_pending(void)
+{
+    sol_timeout_add(0, on_timeout_del_pending, NULL);
+    sol_run();
+}
+
 TEST_MAIN();
@@ -0,0 +1,477 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "sol-flow.h"
+#include "sol-flow-single.h"
+#include "sol-mainloop.h"
+#include "sol-util-internal.h"
+#include "sol-vector.h"
+
+#include "sol-flow/mqtt.h"
+
+#include "test.h"
+
+/* Minimal MQTT 3.1.1 broker stand-in. It acknowledges CONNECT,
+ * SUBSCRIBE, UNSUBSCRIBE and PINGREQ, keeps track of the filters the
+ * client asked for and lets the test push PUBLISH packets to the
+ * connected client. Like a real broker, a message is sent once per
+ * subscribed filter matching its topic, dispatching to the nodes is
+ * up to the client side.
+ */
+
+#define MQTT_CONNECT 1
+#define MQTT_PUBLISH 3
+#define MQTT_SUBSCRIBE 8
+#define MQTT_UNSUBSCRIBE 10
+#define MQTT_PINGREQ 12
+#define MQTT_DISCONNECT 14
+
+static struct {
+    int listen_fd;
+    int client_fd;
+    uint16_t port;
+    struct sol_fd *listen_watch;
+    struct sol_fd *client_watch;
+    struct sol_buffer in;
+    struct sol_ptr_vector filters;
+    unsigned int connections;
+    unsigned int subscribes;
+    unsigned int publishes;
+    bool disconnected;
+} broker;
+
+struct sub_data {
+    unsigned int count;
+    char last[32];
+};
+
+static bool
+quit_loop(void *data)
+{
+    sol_quit();
+    return false;
+}
+
+static void
+run_for(uint32_t ms)
+{
+    sol_timeout_add(ms, quit_loop, NULL);
+    sol_run();
+}
+
+#define RUN_UNTIL(expr) \
+    do { \
+        int i_; \
+        for (i_ = 0; i_ < 500 && !(expr); i_++) \
+            run_for(10); \
+        ASSERT(expr); \
+    } while (0)
+
+static void
+broker_send(const uint8_t *data, size_t len)
+{
+    ASSERT_INT_EQ(write(broker.client_fd, data, len), (ssize_t)len);
+}
+
+/* '$' topics are not used by the test, so they get no special care */
+static bool
+filter_matches(const char *filter, const char *topic)
+{
+    size_t flen, tlen;
+
+    while (true) {
+        flen = strcspn(filter, "/");
+        tlen = strcspn(topic, "/");
+
+        if (flen == 1 && filter[0] == '#')
+            return true;
+        if (!(flen == 1 && filter[0] == '+') &&
+            (flen != tlen || memcmp(filter, topic, flen)))
+            return false;
+
+        filter += flen;
+        topic += tlen;
+
+        /* 'a/#' also matches 'a' */
+        if (!*topic)
+            return !*filter || streq(filter, "/#");
+        if (!*filter)
+            return false;
+
+        filter++;
+        topic++;
+    }
+}
+
+static void
+broker_publish(const char *topic, const char *payload)
+{
+    uint8_t pkt[128];
+    size_t tlen = strlen(topic), plen = strlen(payload);
+    size_t len = 2 + tlen + plen;
+    const char *filter;
+    uint32_t i;
+
+    ASSERT(len < 128);
+
+    pkt[0] = MQTT_PUBLISH << 4;
+    pkt[1] = len;
+    pkt[2] = tlen >> 8;
+    pkt[3] = tlen & 0xff;
+    memcpy(pkt + 4, topic, tlen);
+    memcpy(pkt + 4 + tlen, payload, plen);
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&broker.filters, filter, i) {
+        if (filter_matches(filter, topic))
+            broker_send(pkt, 2 + len);
+    }
+}
+
+static int
+broker_find_filter(const char *filter)
+{
+    const char *itr;
+    uint32_t i;
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&broker.filters, itr, i) {
+        if (streq(itr, filter))
+            return i;
+    }
+
+    return -ENOENT;
+}
+
+static void
+broker_handle(uint8_t type, const uint8_t *p, size_t len)
+{
+    uint8_t ack[128];
+    size_t i, tlen = 0, n = 0;
+    char *filter;
+    int idx;
+
+    switch (type) {
+    case MQTT_CONNECT:
+        broker_send((const uint8_t[]){ 0x20, 0x02, 0x00, 0x00 }, 4);
+        break;
+    case MQTT_SUBSCRIBE:
+        /* packet id, then (topic length, topic, qos) tuples */
+        for (i = 2; i + 2 < len; i += 3 + tlen) {
+            tlen = (p[i] << 8) | p[i + 1];
+            filter = strndup((const char *)p + i + 2, tlen);
+            ASSERT(filter);
+            ASSERT(broker_find_filter(filter) < 0);
+            ASSERT_INT_EQ(sol_ptr_vector_append(&broker.filters, filter), 0);
+            ack[4 + n++] = p[i + 2 + tlen];
+        }
+        broker.subscribes++;
+        ack[0] = 0x90;
+        ack[1] = 2 + n;
+        ack[2] = p[0];
+        ack[3] = p[1];
+        broker_send(ack, 4 + n);
+        break;
+    case MQTT_UNSUBSCRIBE:
+        for (i = 2; i + 2 <= len; i += 2 + tlen) {
+            tlen = (p[i] << 8) | p[i + 1];
+            filter = strndup((const char *)p + i + 2, tlen);
+            ASSERT(filter);
+            idx = broker_find_filter(filter);
+            ASSERT(idx >= 0);
+            free(sol_ptr_vector_take(&broker.filters, idx));
+            free(filter);
+        }
+        broker_send((const uint8_t[]){ 0xb0, 0x02, p[0], p[1] }, 4);
+        break;
+    case MQTT_PUBLISH:
+        broker.publishes++;
+        break;
+    case MQTT_PINGREQ:
+        broker_send((const uint8_t[]){ 0xd0, 0x00 }, 2);
+        break;
+    case MQTT_DISCONNECT:
+        broker.disconnected = true;
+        break;
+    }
+}
+
+static void
+broker_process(void)
+{
+    const uint8_t *p;
+    size_t hdr, len, mult;
+    uint8_t byte;
+
+    while (broker.in.used >= 2) {
+        p = broker.in.data;
+        hdr = 1;
+        len = 0;
+        mult = 1;
+        do {
+            if (hdr >= broker.in.used)
+                return;
+            byte = p[hdr++];
+            len += (byte & 127) * mult;
+            mult *= 128;
+        } while (byte & 128);
+
+        if (hdr + len > broker.in.used)
+            return;
+
+        broker_handle(p[0] >> 4, p + hdr, len);
+        ASSERT_INT_EQ(sol_buffer_remove_data(&broker.in, 0, hdr + len), 0);
+    }
+}
+
+static bool
+on_client_data(void *data, int fd, uint32_t active_flags)
+{
+    ssize_t n = 0;
+
+    if (active_flags & SOL_FD_FLAGS_IN) {
+        ASSERT_INT_EQ(sol_buffer_ensure(&broker.in, broker.in.used + 512), 0);
+        n = read(fd, (char *)broker.in.data + broker.in.used, 512);
+        if (n > 0) {
+            broker.in.used += n;
+            broker_process();
+            return true;
+        }
+    }
+
+    if (n < 0 && errno == EINTR)
+        return true;
+
+    broker.disconnected = true;
+    broker.client_watch = NULL;
+    close(broker.client_fd);
+    broker.client_fd = -1;
+    return false;
+}
+
+static bool
+on_client_connect(void *data, int fd, uint32_t active_flags)
+{
+    int client_fd;
+
+    client_fd = accept(fd, NULL, NULL);
+    ASSERT(client_fd >= 0);
+
+    /* a single broker connection is expected, no matter the node count */
+    ASSERT_INT_EQ(broker.client_fd, -1);
+
+    broker.connections++;
+    broker.disconnected = false;
+    broker.client_fd = client_fd;
+    broker.client_watch = sol_fd_add(client_fd,
+        SOL_FD_FLAGS_IN | SOL_FD_FLAGS_HUP | SOL_FD_FLAGS_ERR,
+        on_client_data, NULL);
+    ASSERT(broker.client_watch);
+
+    return true;
+}
+
+static void
+broker_start(void)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    socklen_t addrlen = sizeof(addr);
+
+    broker.client_fd = -1;
+    broker.in = (struct sol_buffer)SOL_BUFFER_INIT_EMPTY;
+    sol_ptr_vector_init(&broker.filters);
+
+    broker.listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    ASSERT(broker.listen_fd >= 0);
+    ASSERT_INT_EQ(bind(broker.listen_fd, (struct sockaddr *)&addr, sizeof(addr)), 0);
+    ASSERT_INT_EQ(listen(broker.listen_fd, 4), 0);
+    ASSERT_INT_EQ(getsockname(broker.listen_fd, (struct sockaddr *)&addr, &addrlen), 0);
+    broker.port = ntohs(addr.sin_port);
+
+    broker.listen_watch = sol_fd_add(broker.listen_fd, SOL_FD_FLAGS_IN,
+        on_client_connect, NULL);
+    ASSERT(broker.listen_watch);
+}
+
+static void
+broker_stop(void)
+{
+    char *filter;
+    uint32_t i;
+
+    if (broker.client_watch)
+        sol_fd_del(broker.client_watch);
+    if (broker.client_fd >= 0)
+        close(broker.client_fd);
+    sol_fd_del(broker.listen_watch);
+    close(broker.listen_fd);
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&broker.filters, filter, i)
+        free(filter);
+    sol_ptr_vector_clear(&broker.filters);
+    sol_buffer_fini(&broker.in);
+}
+
+static void
+on_packet(void *user_data, struct sol_flow_node *node, uint16_t port, const struct sol_flow_packet *packet)
+{
+    struct sub_data *sub = user_data;
+    struct sol_blob *blob;
+
+    if (port != SOL_FLOW_NODE_TYPE_MQTT_CLIENT__OUT__OUTDATA)
+        return;
+
+    ASSERT_INT_EQ(sol_flow_packet_get_blob(packet, &blob), 0);
+    ASSERT(blob->size < sizeof(sub->last));
+
+    memcpy(sub->last, blob->mem, blob->size);
+    sub->last[blob->size] = '\0';
+    sub->count++;
+}
+
+static struct sol_flow_node *
+client_new(const char *topic, struct sub_data *sub)
+{
+    const struct sol_flow_node_type *type;
+    struct sol_flow_node_type_mqtt_client_options opts =
+        SOL_FLOW_NODE_TYPE_MQTT_CLIENT_OPTIONS_DEFAULTS();
+    struct sol_flow_node *node;
+
+    opts.host = "127.0.0.1";
+    opts.port = broker.port;
+    opts.topic = topic;
+
+    ASSERT_INT_EQ(sol_flow_get_node_type("mqtt", SOL_FLOW_NODE_TYPE_MQTT_CLIENT, &type), 0);
+
+    node = sol_flow_single_new(topic, type, &opts.base,
+        SOL_FLOW_SINGLE_CONNECTIONS(SOL_FLOW_NODE_TYPE_MQTT_CLIENT__IN__PUBLISH,
+        SOL_FLOW_NODE_TYPE_MQTT_CLIENT__IN__SUBSCRIBE,
+        SOL_FLOW_NODE_TYPE_MQTT_CLIENT__IN__DATA),
+        SOL_FLOW_SINGLE_CONNECTIONS(SOL_FLOW_NODE_TYPE_MQTT_CLIENT__OUT__OUTDATA),
+        on_packet, sub);
+    ASSERT(node);
+
+    return node;
+}
+
+DEFINE_TEST(shared_connection_topic_dispatch);
+
+static void
+shared_connection_topic_dispatch(void)
+{
+    struct sub_data kitchen = { 0 }, kitchen2 = { 0 }, all = { 0 }, other = { 0 };
+    struct sol_flow_node *n_kitchen, *n_kitchen2, *n_all, *n_other;
+    struct sol_blob *blob;
+
+    broker_start();
+
+    n_kitchen = client_new("sensors/+/temp", &kitchen);
+    n_all = client_new("sensors/#", &all);
+    n_other = client_new("other/topic", &other);
+
+    ASSERT_INT_EQ(sol_flow_send_empty_packet(n_kitchen, SOL_FLOW_NODE_TYPE_MQTT_CLIENT__IN__SUBSCRIBE), 0);
+    ASSERT_INT_EQ(sol_flow_send_empty_packet(n_all, SOL_FLOW_NODE_TYPE_MQTT_CLIENT__IN__SUBSCRIBE), 0);
+    ASSERT_INT_EQ(sol_flow_send_empty_packet(n_other, SOL_FLOW_NODE_TYPE_MQTT_CLIENT__IN__SUBSCRIBE), 0);
+
+    /* 'sensors/#' covers 'sensors/+/temp', so only the former is kept
+     * on the broker and overlapping topics are received once */
+    RUN_UNTIL(broker.subscribes == 3 && sol_ptr_vector_get_len(&broker.filters) == 2);
+    ASSERT(broker_find_filter("sensors/#") >= 0);
+    ASSERT(broker_find_filter("other/topic") >= 0);
+    ASSERT_INT_EQ(broker.connections, 1);
+
+    broker_publish("sensors/kitchen/temp", "21");
+    RUN_UNTIL(kitchen.count == 1 && all.count == 1);
+    run_for(50);
+    ASSERT_INT_EQ(kitchen.count, 1);
+    ASSERT_INT_EQ(all.count, 1);
+    ASSERT_STR_EQ(kitchen.last, "21");
+    ASSERT_STR_EQ(all.last, "21");
+
+    /* 'sensors/#' also matches its parent level, '+' does not */
+    broker_publish("sensors", "on");
+    broker_publish("other/topic", "x");
+    broker_publish("sensors/kitchen/humidity/raw", "40");
+    RUN_UNTIL(all.count == 3 && other.count == 1);
+    run_for(50);
+    ASSERT_INT_EQ(kitchen.count, 1);
+    ASSERT_INT_EQ(all.count, 3);
+    ASSERT_INT_EQ(other.count, 1);
+    ASSERT_STR_EQ(all.last, "40");
+    ASSERT_STR_EQ(other.last, "x");
+
+    /* same filter from another node is served without a new SUBSCRIBE */
+    n_kitchen2 = client_new("sensors/+/temp", &kitchen2);
+    ASSERT_INT_EQ(sol_flow_send_empty_packet(n_kitchen2, SOL_FLOW_NODE_TYPE_MQTT_CLIENT__IN__SUBSCRIBE), 0);
+    run_for(50);
+    ASSERT_INT_EQ(broker.subscribes, 3);
+
+    broker_publish("sensors/hall/temp", "19");
+    RUN_UNTIL(kitchen.count == 2 && kitchen2.count == 1 && all.count == 4);
+    run_for(50);
+    ASSERT_INT_EQ(kitchen.count, 2);
+    ASSERT_INT_EQ(kitchen2.count, 1);
+    ASSERT_INT_EQ(all.count, 4);
+    ASSERT_INT_EQ(other.count, 1);
+
+    /* publishing goes through the very same connection */
+    blob = sol_blob_new(SOL_BLOB_TYPE_NO_FREE, NULL, "hello", 5);
+    ASSERT(blob);
+    ASSERT_INT_EQ(sol_flow_send_blob_packet(n_other, SOL_FLOW_NODE_TYPE_MQTT_CLIENT__IN__DATA, blob), 0);
+    ASSERT_INT_EQ(sol_flow_send_empty_packet(n_other, SOL_FLOW_NODE_TYPE_MQTT_CLIENT__IN__PUBLISH), 0);
+    sol_blob_unref(blob);
+    RUN_UNTIL(broker.publishes == 1);
+    ASSERT_INT_EQ(broker.connections, 1);
+
+    /* filters are dropped from the broker with their last subscriber,
+     * the ones they covered are subscribed again */
+    sol_flow_node_del(n_all);
+    RUN_UNTIL(broker_find_filter("sensors/#") < 0 &&
+        broker_find_filter("sensors/+/temp") >= 0);
+    ASSERT_INT_EQ(sol_ptr_vector_get_len(&broker.filters), 2);
+    ASSERT_INT_EQ(broker.subscribes, 4);
+
+    broker_publish("sensors/hall/temp", "18");
+    RUN_UNTIL(kitchen.count == 3 && kitchen2.count == 2);
+    run_for(50);
+    ASSERT_INT_EQ(kitchen.count, 3);
+    ASSERT_INT_EQ(kitchen2.count, 2);
+    ASSERT_STR_EQ(kitchen2.last, "18");
+
+    sol_flow_node_del(n_kitchen);
+    run_for(50);
+    ASSERT(broker_find_filter("sensors/+/temp") >= 0);
+
+    sol_flow_node_del(n_kitchen2);
+    RUN_UNTIL(sol_ptr_vector_get_len(&broker.filters) == 1);
+
+    sol_flow_node_del(n_other);
+    RUN_UNTIL(broker.disconnected);
+    ASSERT_INT_EQ(broker.connections, 1);
+
+    broker_stop();
+}
+
+TEST_MAIN();
@@ -0,0 +1,344 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sol-fs-storage.h"
+#include "sol-mainloop.h"
+#include "sol-util-file.h"
+
+#include "test.h"
+
+#define LOG_PATH "fs-log-test.log"
+#define LEGACY_PATH "fs-log-test-legacy"
+#define PLAIN_PATH "fs-log-test-plain"
+#define COMPACTION_THRESHOLD 512
+
+static const struct sol_fs_log_config config = {
+    .api_version = SOL_FS_LOG_CONFIG_API_VERSION,
+    .path = LOG_PATH,
+    .flush_interval = 10,
+    .compaction_threshold = COMPACTION_THRESHOLD
+};
+
+static struct sol_irange irange_value = {
+    .val = -33,
+    .min = -10000,
+    .max = 10000,
+    .step = 3
+};
+
+static int pending_callbacks;
+
+static void
+write_cb(void *data, const char *name, struct sol_blob *blob, int status)
+{
+    ASSERT_INT_EQ(status, 0);
+    pending_callbacks--;
+}
+
+static void
+write_cancelled_cb(void *data, const char *name, struct sol_blob *blob, int status)
+{
+    ASSERT_INT_EQ(status, -ECANCELED);
+    pending_callbacks--;
+}
+
+static int
+log_write(const char *name, const void *value, size_t size,
+    void (*cb)(void *data, const char *name, struct sol_blob *blob, int status))
+{
+    struct sol_blob *blob;
+    void *mem;
+    int r;
+
+    mem = malloc(size);
+    ASSERT(mem);
+    memcpy(mem, value, size);
+
+    blob = sol_blob_new(SOL_BLOB_TYPE_DEFAULT, NULL, mem, size);
+    ASSERT(blob);
+
+    r = sol_fs_log_write_raw(name, blob, cb, NULL);
+    sol_blob_unref(blob);
+    return r;
+}
+
+static int
+log_read(const char *name, void *value, size_t size)
+{
+    struct sol_buffer buf = SOL_BUFFER_INIT_FLAGS(value, size,
+        SOL_BUFFER_FLAGS_MEMORY_NOT_OWNED | SOL_BUFFER_FLAGS_NO_NUL_BYTE);
+
+    return sol_fs_log_read_raw(name, &buf);
+}
+
+static int
+log_read_string(const char *name, char **value)
+{
+    struct sol_buffer buf = SOL_BUFFER_INIT_EMPTY;
+    int r;
+
+    r = sol_fs_log_read_raw(name, &buf);
+    if (r < 0) {
+        sol_buffer_fini(&buf);
+        return r;
+    }
+
+    *value = (char *)sol_buffer_steal(&buf, NULL);
+    return 0;
+}
+
+static off_t
+log_size(void)
+{
+    struct stat st;
+
+    ASSERT_INT_EQ(stat(LOG_PATH, &st), 0);
+    return st.st_size;
+}
+
+static void
+write_values(void)
+{
+    int32_t i;
+    bool b = true;
+    int r;
+
+    i = 1;
+    r = log_write("int", &i, sizeof(i), write_cancelled_cb);
+    ASSERT_INT_EQ(r, 0);
+
+    r = log_write("boolean", &b, sizeof(b), write_cb);
+    ASSERT_INT_EQ(r, 0);
+
+    r = log_write("irange", &irange_value, sizeof(irange_value), write_cb);
+    ASSERT_INT_EQ(r, 0);
+
+    r = log_write("string", "gama delta", strlen("gama delta"), write_cb);
+    ASSERT_INT_EQ(r, 0);
+
+    /* Supersedes the first write */
+    i = 7804;
+    r = log_write("int", &i, sizeof(i), write_cb);
+    ASSERT_INT_EQ(r, 0);
+
+    pending_callbacks = 5;
+}
+
+static void
+read_values(void)
+{
+    struct sol_irange irange;
+    char *string;
+    int32_t i;
+    bool b;
+    int r;
+
+    r = log_read("int", &i, sizeof(i));
+    ASSERT_INT_EQ(r, 0);
+    ASSERT_INT_EQ(i, 7804);
+
+    r = log_read("boolean", &b, sizeof(b));
+    ASSERT_INT_EQ(r, 0);
+    ASSERT(b);
+
+    r = log_read("irange", &irange, sizeof(irange));
+    ASSERT_INT_EQ(r, 0);
+    ASSERT(sol_irange_equal(&irange, &irange_value));
+
+    r = log_read_string("string", &string);
+    ASSERT_INT_EQ(r, 0);
+    ASSERT_STR_EQ(string, "gama delta");
+    free(string);
+}
+
+static void
+test_reopen(void)
+{
+    off_t size;
+    int fd, r;
+
+    ASSERT_INT_EQ(sol_fs_log_close(), 0);
+    size = log_size();
+
+    /* A torn record at the end, as left by a power cut */
+    fd = open(LOG_PATH, O_WRONLY | O_APPEND | O_CLOEXEC);
+    ASSERT(fd >= 0);
+    ASSERT_INT_EQ(write(fd, "\x01\x02\x03\x04\x05\x00\x00\x00int", 11), 11);
+    close(fd);
+
+    r = sol_fs_log_open(&config);
+    ASSERT_INT_EQ(r, 0);
+    ASSERT_INT_EQ(log_size(), size);
+    read_values();
+
+    /* Another user of the same log just takes a reference */
+    ASSERT_INT_EQ(sol_fs_log_open(NULL), 0);
+    ASSERT_INT_EQ(sol_fs_log_close(), 0);
+    read_values();
+}
+
+static void
+test_fallback(void)
+{
+    int32_t i;
+    char *string;
+    int r;
+
+    r = log_read("missing", &i, sizeof(i));
+    ASSERT_INT_EQ(r, -ENOENT);
+
+    /* Values not in the log are still read from their own file */
+    r = sol_util_write_file(LEGACY_PATH, "legacy");
+    ASSERT(r > 0);
+    r = log_read_string(LEGACY_PATH, &string);
+    ASSERT_INT_EQ(r, 0);
+    ASSERT_STR_EQ(string, "legacy");
+    free(string);
+    unlink(LEGACY_PATH);
+}
+
+/* The log doesn't take over plain per file storage while it's open */
+static void
+plain_write_cb(void *data, const char *name, struct sol_blob *blob, int status)
+{
+    int32_t i;
+    int r;
+
+    ASSERT_INT_EQ(status, 0);
+    ASSERT_INT_EQ(access(PLAIN_PATH, F_OK), 0);
+
+    r = sol_fs_read_int32(PLAIN_PATH, &i);
+    ASSERT_INT_EQ(r, 0);
+    ASSERT_INT_EQ(i, 42);
+    unlink(PLAIN_PATH);
+
+    /* Nor are log values seen by plain storage */
+    r = log_read("int", &i, sizeof(i));
+    ASSERT_INT_EQ(r, 0);
+    r = sol_fs_read_int32("int", &i);
+    ASSERT_INT_EQ(r, -ENOENT);
+
+    ASSERT_INT_EQ(sol_fs_log_close(), 0);
+    unlink(LOG_PATH);
+
+    /* Log entry points need an open log */
+    r = log_read("int", &i, sizeof(i));
+    ASSERT_INT_EQ(r, -EBADF);
+
+    sol_quit();
+}
+
+static void
+test_plain_storage(void)
+{
+    int r;
+
+    unlink(PLAIN_PATH);
+    r = sol_fs_write_int32(PLAIN_PATH, 42, plain_write_cb, NULL);
+    ASSERT_INT_EQ(r, 0);
+}
+
+static void
+test_compaction(void)
+{
+    int32_t i;
+    int r;
+
+    for (i = 0; i < 200; i++) {
+        r = log_write("int", &i, sizeof(i), write_cb);
+        ASSERT_INT_EQ(r, 0);
+        pending_callbacks = 1;
+        ASSERT_INT_EQ(sol_fs_log_flush(), 0);
+        ASSERT_INT_EQ(pending_callbacks, 0);
+    }
+
+    ASSERT(log_size() <= 2 * COMPACTION_THRESHOLD);
+
+    r = log_read("int", &i, sizeof(i));
+    ASSERT_INT_EQ(r, 0);
+    ASSERT_INT_EQ(i, 199);
+
+    ASSERT_INT_EQ(sol_fs_log_close(), 0);
+    ASSERT_INT_EQ(sol_fs_log_open(&config), 0);
+
+    r = log_read("int", &i, sizeof(i));
+    ASSERT_INT_EQ(r, 0);
+    ASSERT_INT_EQ(i, 199);
+}
+
+static bool
+check_flushed(void *data)
+{
+    ASSERT_INT_EQ(pending_callbacks, 0);
+
+    read_values();
+    test_reopen();
+    test_fallback();
+    test_compaction();
+    test_plain_storage();
+
+    return false;
+}
+
+static bool
+perform_tests(void *data)
+{
+    int r;
+
+    unlink(LOG_PATH);
+
+    r = sol_fs_log_open(&config);
+    ASSERT_INT_EQ(r, 0);
+
+    /* A different log can't be opened at the same time */
+    r = sol_fs_log_open(&(struct sol_fs_log_config) {
+            .api_version = SOL_FS_LOG_CONFIG_API_VERSION,
+            .path = LOG_PATH ".other"
+        });
+    ASSERT_INT_EQ(r, -EBUSY);
+
+    write_values();
+    read_values(); /* Served from pending writes */
+    ASSERT_INT_EQ(pending_callbacks, 5);
+
+    sol_timeout_add(100, check_flushed, NULL);
+
+    return false;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int err;
+
+    err = sol_init();
+    ASSERT(!err);
+
+    sol_idle_add(perform_tests, NULL);
+
+    sol_run();
+
+    sol_shutdown();
+
+    return 0;
+}
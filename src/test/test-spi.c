@@ -0,0 +1,389 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/spi/spidev.h>
+
+#include "sol-mainloop.h"
+#include "sol-spi.h"
+#include "sol-util-internal.h"
+
+#include "test.h"
+
+/* The spidev device is stubbed: this test is linked with --wrap for
+ * open() and ioctl(). The device node is /dev/null and transfers are
+ * looped back, every byte read being the byte written plus one. */
+
+#define BUS 1
+#define CHIP_SELECT 2
+#define MAX_MSGS 8
+
+static int spi_fd = -1;
+static unsigned int n_messages;
+static struct spi_ioc_transfer msgs[MAX_MSGS];
+static unsigned int n_msgs;
+static int fail_errno;
+
+int __real_open(const char *path, int flags, ...);
+int __real_ioctl(int fd, unsigned long request, ...);
+
+int __wrap_open(const char *path, int flags, ...);
+int __wrap_ioctl(int fd, unsigned long request, ...);
+
+int
+__wrap_open(const char *path, int flags, ...)
+{
+    char buf[32];
+    va_list ap;
+    mode_t mode;
+
+    va_start(ap, flags);
+    mode = (flags & O_CREAT) ? va_arg(ap, mode_t) : 0;
+    va_end(ap);
+
+    snprintf(buf, sizeof(buf), "/dev/spidev%u.%u", BUS, CHIP_SELECT);
+    if (!streq(path, buf))
+        return __real_open(path, flags, mode);
+
+    ASSERT_INT_EQ(spi_fd, -1);
+    spi_fd = __real_open("/dev/null", flags);
+    return spi_fd;
+}
+
+int
+__wrap_ioctl(int fd, unsigned long request, ...)
+{
+    struct spi_ioc_transfer *tr;
+    const uint8_t *tx;
+    uint8_t *rx;
+    unsigned int i, j, size, rem;
+    va_list ap;
+    void *arg;
+    int total = 0;
+
+    va_start(ap, request);
+    arg = va_arg(ap, void *);
+    va_end(ap);
+
+    if (fd != spi_fd)
+        return __real_ioctl(fd, request, arg);
+
+    if (request == SPI_IOC_WR_MODE || request == SPI_IOC_WR_MAX_SPEED_HZ)
+        return 0;
+
+    /* SPI_IOC_MESSAGE(n) */
+    ASSERT_INT_EQ(_IOC_TYPE(request), SPI_IOC_MAGIC);
+    ASSERT_INT_EQ(_IOC_NR(request), 0);
+    size = _IOC_SIZE(request);
+    rem = size % sizeof(struct spi_ioc_transfer);
+    ASSERT_INT_EQ(rem, 0);
+
+    n_messages++;
+    n_msgs = size / sizeof(struct spi_ioc_transfer);
+    ASSERT(n_msgs > 0);
+    ASSERT(n_msgs <= MAX_MSGS);
+    memcpy(msgs, arg, n_msgs * sizeof(struct spi_ioc_transfer));
+
+    if (fail_errno) {
+        errno = fail_errno;
+        return -1;
+    }
+
+    for (i = 0, tr = msgs; i < n_msgs; i++, tr++) {
+        tx = (const uint8_t *)(uintptr_t)tr->tx_buf;
+        rx = (uint8_t *)(uintptr_t)tr->rx_buf;
+
+        for (j = 0; rx && j < tr->len; j++)
+            rx[j] = (tx ? tx[j] : 0) + 1;
+        total += tr->len;
+    }
+
+    return total;
+}
+
+struct transfer {
+    const struct sol_spi_chain_item *items;
+    unsigned int count;
+    ssize_t status;
+    unsigned int done;
+};
+
+static void
+chain_cb(void *data, struct sol_spi *spi, const struct sol_spi_chain_item *items, unsigned int count, ssize_t status)
+{
+    struct transfer *transfer = data;
+
+    ASSERT(items == transfer->items);
+    transfer->count = count;
+    transfer->status = status;
+    transfer->done++;
+    sol_quit();
+}
+
+static void
+transfer_cb(void *data, struct sol_spi *spi, const uint8_t *tx, uint8_t *rx, ssize_t status)
+{
+    struct transfer *transfer = data;
+
+    transfer->status = status;
+    transfer->done++;
+    sol_quit();
+}
+
+static bool
+timeout_cb(void *data)
+{
+    struct sol_timeout **timeout = data;
+
+    *timeout = NULL;
+    sol_quit();
+    return false;
+}
+
+static void
+run(void)
+{
+    struct sol_timeout *timeout;
+
+    timeout = sol_timeout_add(5000, timeout_cb, &timeout);
+    ASSERT(timeout);
+    sol_run();
+    if (timeout)
+        sol_timeout_del(timeout);
+}
+
+static struct sol_spi *
+spi_open(void)
+{
+    struct sol_spi_config config = {
+        SOL_SET_API_VERSION(.api_version = SOL_SPI_CONFIG_API_VERSION, )
+        .chip_select = CHIP_SELECT,
+        .mode = SOL_SPI_MODE_0,
+        .frequency = 100000,
+        .bits_per_word = SOL_SPI_DATA_BITS_DEFAULT,
+    };
+    struct sol_spi *spi;
+
+    spi = sol_spi_open(BUS, &config);
+    ASSERT(spi);
+    ASSERT(spi_fd >= 0);
+    n_messages = 0;
+    fail_errno = 0;
+
+    return spi;
+}
+
+static void
+spi_close(struct sol_spi *spi)
+{
+    sol_spi_close(spi);
+    spi_fd = -1;
+}
+
+DEFINE_TEST(test_chain);
+
+static void
+test_chain(void)
+{
+    static const uint8_t header[] = { 0x02, 0x10 };
+    static const uint8_t data[] = "pixels";
+    uint8_t rx_header[sizeof(header)], rx_status[3] = { };
+    const struct sol_spi_chain_item items[] = {
+        { .tx = header, .rx = rx_header, .count = sizeof(header),
+          .delay_usecs = 10 },
+        { .tx = data, .count = sizeof(data), .cs_change = true },
+        { .rx = rx_status, .count = sizeof(rx_status) },
+    };
+    struct transfer transfer = { .items = items };
+    struct sol_spi *spi;
+    unsigned int i;
+
+    spi = spi_open();
+
+    ASSERT(sol_spi_transfer_chain(spi, items, SOL_UTIL_ARRAY_SIZE(items),
+        chain_cb, &transfer));
+
+    /* only one transfer may be pending */
+    ASSERT(!sol_spi_transfer_chain(spi, items, SOL_UTIL_ARRAY_SIZE(items),
+        chain_cb, &transfer));
+    ASSERT(!sol_spi_transfer(spi, header, rx_header, sizeof(header),
+        transfer_cb, &transfer));
+
+    run();
+
+    ASSERT_INT_EQ(transfer.done, 1);
+    ASSERT_INT_EQ(transfer.count, SOL_UTIL_ARRAY_SIZE(items));
+    ASSERT_INT_EQ(transfer.status,
+        sizeof(header) + sizeof(data) + sizeof(rx_status));
+
+    /* all of them in a single message */
+    ASSERT_INT_EQ(n_messages, 1);
+    ASSERT_INT_EQ(n_msgs, SOL_UTIL_ARRAY_SIZE(items));
+    for (i = 0; i < n_msgs; i++) {
+        ASSERT(msgs[i].tx_buf == (uintptr_t)items[i].tx);
+        ASSERT(msgs[i].rx_buf == (uintptr_t)items[i].rx);
+        ASSERT_INT_EQ(msgs[i].len, items[i].count);
+        ASSERT_INT_EQ(msgs[i].delay_usecs, items[i].delay_usecs);
+        ASSERT_INT_EQ(msgs[i].cs_change, items[i].cs_change);
+        ASSERT_INT_EQ(msgs[i].bits_per_word, SOL_SPI_DATA_BITS_DEFAULT);
+    }
+
+    for (i = 0; i < sizeof(header); i++)
+        ASSERT_INT_EQ(rx_header[i], header[i] + 1);
+    /* no tx buffer sends zeros */
+    for (i = 0; i < sizeof(rx_status); i++)
+        ASSERT_INT_EQ(rx_status[i], 1);
+
+    spi_close(spi);
+}
+
+DEFINE_TEST(test_chain_reuse);
+
+static void
+test_chain_reuse(void)
+{
+    uint8_t tx[MAX_MSGS], rx[MAX_MSGS];
+    struct sol_spi_chain_item items[MAX_MSGS] = { };
+    struct transfer transfer = { .items = items };
+    struct sol_spi *spi;
+    unsigned int i;
+
+    spi = spi_open();
+
+    for (i = 0; i < MAX_MSGS; i++) {
+        tx[i] = i;
+        items[i].tx = &tx[i];
+        items[i].rx = &rx[i];
+        items[i].count = 1;
+    }
+
+    /* a single transfer, then chains longer and shorter than that:
+     * every message must have just what was asked for */
+    ASSERT(sol_spi_transfer(spi, tx, rx, 1, transfer_cb, &transfer));
+    run();
+    ASSERT_INT_EQ(transfer.done, 1);
+    ASSERT_INT_EQ(transfer.status, 1);
+    ASSERT_INT_EQ(n_msgs, 1);
+    ASSERT_INT_EQ(msgs[0].delay_usecs, 0);
+
+    items[MAX_MSGS - 1].delay_usecs = 5;
+    ASSERT(sol_spi_transfer_chain(spi, items, MAX_MSGS, chain_cb, &transfer));
+    run();
+    ASSERT_INT_EQ(transfer.done, 2);
+    ASSERT_INT_EQ(transfer.status, MAX_MSGS);
+    ASSERT_INT_EQ(n_msgs, MAX_MSGS);
+    ASSERT_INT_EQ(msgs[MAX_MSGS - 1].delay_usecs, 5);
+    for (i = 0; i < MAX_MSGS; i++)
+        ASSERT_INT_EQ(rx[i], i + 1);
+
+    items[0].cs_change = true;
+    ASSERT(sol_spi_transfer_chain(spi, items, 2, chain_cb, &transfer));
+    run();
+    ASSERT_INT_EQ(transfer.done, 3);
+    ASSERT_INT_EQ(transfer.count, 2);
+    ASSERT_INT_EQ(transfer.status, 2);
+    ASSERT_INT_EQ(n_msgs, 2);
+    ASSERT_INT_EQ(msgs[0].cs_change, 1);
+    ASSERT_INT_EQ(msgs[1].delay_usecs, 0);
+
+    ASSERT_INT_EQ(n_messages, 3);
+
+    spi_close(spi);
+}
+
+DEFINE_TEST(test_chain_invalid);
+
+static void
+test_chain_invalid(void)
+{
+    uint8_t tx[4] = { }, rx[4];
+    struct sol_spi_chain_item items[2] = {
+        { .tx = tx, .rx = rx, .count = sizeof(tx) },
+        { .tx = tx, .rx = rx, .count = sizeof(tx) },
+    };
+    struct transfer transfer = { .items = items };
+    struct sol_spi *spi;
+
+    spi = spi_open();
+
+    ASSERT(!sol_spi_transfer_chain(spi, NULL, 1, chain_cb, &transfer));
+    ASSERT(!sol_spi_transfer_chain(spi, items, 0, chain_cb, &transfer));
+    ASSERT(!sol_spi_transfer_chain(spi, items, SOL_SPI_CHAIN_MAX + 1,
+        chain_cb, &transfer));
+    ASSERT(!sol_spi_transfer(spi, tx, rx, 0, transfer_cb, &transfer));
+
+#if SIZE_MAX > UINT32_MAX
+    /* spi_ioc_transfer can't take it, it must not be truncated */
+    items[1].count = (size_t)UINT32_MAX + 1;
+    errno = 0;
+    ASSERT(!sol_spi_transfer_chain(spi, items, 2, chain_cb, &transfer));
+    ASSERT_INT_EQ(errno, EINVAL);
+
+    errno = 0;
+    ASSERT(!sol_spi_transfer(spi, tx, rx, (size_t)UINT32_MAX + 1,
+        transfer_cb, &transfer));
+    ASSERT_INT_EQ(errno, EINVAL);
+    items[1].count = sizeof(tx);
+#endif
+
+    ASSERT_INT_EQ(n_messages, 0);
+
+    /* refused chains leave the bus usable */
+    ASSERT(sol_spi_transfer_chain(spi, items, 2, chain_cb, &transfer));
+    run();
+    ASSERT_INT_EQ(transfer.done, 1);
+    ASSERT_INT_EQ(transfer.status, 2 * sizeof(tx));
+
+    spi_close(spi);
+}
+
+DEFINE_TEST(test_chain_error);
+
+static void
+test_chain_error(void)
+{
+    uint8_t tx[4] = { }, rx[4];
+    const struct sol_spi_chain_item items[] = {
+        { .tx = tx, .rx = rx, .count = sizeof(tx) },
+        { .tx = tx, .rx = rx, .count = sizeof(tx) },
+    };
+    struct transfer transfer = { .items = items };
+    struct sol_spi *spi;
+
+    spi = spi_open();
+    fail_errno = EIO;
+
+    ASSERT(sol_spi_transfer_chain(spi, items, SOL_UTIL_ARRAY_SIZE(items),
+        chain_cb, &transfer));
+    run();
+
+    ASSERT_INT_EQ(n_messages, 1);
+    ASSERT_INT_EQ(transfer.done, 1);
+    ASSERT_INT_EQ(transfer.count, SOL_UTIL_ARRAY_SIZE(items));
+    ASSERT(transfer.status < 0);
+
+    spi_close(spi);
+}
+
+TEST_MAIN();
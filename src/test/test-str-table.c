@@ -18,6 +18,7 @@
 
 #include <errno.h>
 #include <inttypes.h>
+#include <stdio.h>
 
 #include "sol-str-table.h"
 #include "sol-str-slice.h"
@@ -171,5 +172,110 @@ test_str_table_fallback(void)
 
 }
 
+DEFINE_TEST(test_str_table_hash);
+
+static void
+test_str_table_hash(void)
+{
+    SOL_STR_TABLE_HASH_DECLARE(hash, test_enum_table2);
+    enum test2 v;
+    int16_t i16;
+
+    v = sol_str_table_hash_lookup_fallback(&hash,
+        sol_str_slice_from_str("test0"), TEST2_UNKNOWN);
+    ASSERT_INT_EQ(v, TEST2_0);
+
+    v = sol_str_table_hash_lookup_fallback(&hash,
+        sol_str_slice_from_str("test5"), TEST2_UNKNOWN);
+    ASSERT_INT_EQ(v, TEST2_5);
+
+    v = sol_str_table_hash_lookup_fallback(&hash,
+        sol_str_slice_from_str("test9"), TEST2_UNKNOWN);
+    ASSERT_INT_EQ(v, TEST2_UNKNOWN);
+
+    v = sol_str_table_hash_lookup_fallback(&hash,
+        sol_str_slice_from_str("test"), TEST2_UNKNOWN);
+    ASSERT_INT_EQ(v, TEST2_UNKNOWN);
+
+    v = sol_str_table_hash_lookup_fallback(&hash,
+        sol_str_slice_from_str(""), TEST2_UNKNOWN);
+    ASSERT_INT_EQ(v, TEST2_UNKNOWN);
+
+    i16 = -1;
+    ASSERT(sol_str_table_hash_lookup(&hash, sol_str_slice_from_str("test3"), &i16));
+    ASSERT_INT_EQ(i16, TEST2_3);
+    ASSERT(!sol_str_table_hash_lookup(&hash, sol_str_slice_from_str("test33"), &i16));
+    ASSERT_INT_EQ(i16, TEST2_3);
+}
+
+DEFINE_TEST(test_str_table_hash_empty);
+
+static void
+test_str_table_hash_empty(void)
+{
+    static const struct sol_str_table table[] = {
+        { }
+    };
+    SOL_STR_TABLE_HASH_DECLARE(hash, table);
+
+    ASSERT_INT_EQ(sol_str_table_hash_lookup_fallback(&hash,
+        sol_str_slice_from_str("test"), -1), -1);
+}
+
+DEFINE_TEST(test_str_table_hash_repeated);
+
+static void
+test_str_table_hash_repeated(void)
+{
+    static const struct sol_str_table table[] = {
+        SOL_STR_TABLE_ITEM("a", 1),
+        SOL_STR_TABLE_ITEM("b", 2),
+        SOL_STR_TABLE_ITEM("a", 3),
+        { }
+    };
+    SOL_STR_TABLE_HASH_DECLARE(hash, table);
+
+    /* no hash for it, so it's looked up as a plain table */
+    ASSERT_INT_EQ(sol_str_table_hash_lookup_fallback(&hash,
+        sol_str_slice_from_str("a"), -1), 1);
+    ASSERT_INT_EQ(sol_str_table_hash_lookup_fallback(&hash,
+        sol_str_slice_from_str("b"), -1), 2);
+    ASSERT_INT_EQ(sol_str_table_hash_lookup_fallback(&hash,
+        sol_str_slice_from_str("c"), -1), -1);
+}
+
+DEFINE_TEST(test_str_table_ptr_hash);
+
+static void
+test_str_table_ptr_hash(void)
+{
+    static struct sol_str_table_ptr table[1001];
+    static char keys[1000][16];
+    SOL_STR_TABLE_PTR_HASH_DECLARE(hash, table);
+    char miss[16];
+    const void *p;
+    unsigned int i;
+    int len;
+
+    for (i = 0; i < 1000; i++) {
+        len = snprintf(keys[i], sizeof(keys[i]), "key-%u", i * 7);
+        table[i].key = keys[i];
+        table[i].len = len;
+        table[i].val = keys[i];
+    }
+
+    for (i = 0; i < 1000; i++) {
+        p = sol_str_table_ptr_hash_lookup_fallback(&hash,
+            sol_str_slice_from_str(keys[i]), NULL);
+        ASSERT(p == keys[i]);
+    }
+
+    for (i = 0; i < 1000; i++) {
+        snprintf(miss, sizeof(miss), "key-%u", i * 7 + 1);
+        ASSERT(!sol_str_table_ptr_hash_lookup(&hash,
+            sol_str_slice_from_str(miss), &p));
+    }
+}
+
 
 TEST_MAIN();
@@ -0,0 +1,227 @@
+/*
+ * This file is part of the Soletta Project
+ *
+ * Copyright (C) 2015 Intel Corporation. All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "sol-mainloop.h"
+#include "sol-task-pool.h"
+
+#include "test.h"
+
+#define TASKS 1000
+
+static pthread_t main_thread;
+static int values[TASKS];
+static unsigned int done_count;
+static unsigned int sum;
+static bool gate_open;
+static bool gate_reached;
+
+static int
+square_work(void *data)
+{
+    int *value = data;
+
+    ASSERT(!pthread_equal(pthread_self(), main_thread));
+    *value = *value * *value;
+
+    return 0;
+}
+
+static void
+square_done(void *data, int status)
+{
+    int *value = data;
+
+    ASSERT(pthread_equal(pthread_self(), main_thread));
+    ASSERT_INT_EQ(status, 0);
+
+    sum += *value;
+    done_count++;
+}
+
+static int
+gate_work(void *data)
+{
+    __atomic_store_n(&gate_reached, true, __ATOMIC_SEQ_CST);
+    while (!__atomic_load_n(&gate_open, __ATOMIC_SEQ_CST))
+        usleep(100);
+
+    return 42;
+}
+
+static void
+gate_done(void *data, int status)
+{
+    ASSERT_INT_EQ(status, 42);
+    done_count++;
+}
+
+static void
+cancelled_done(void *data, int status)
+{
+    ASSERT_INT_EQ(status, -ECANCELED);
+    done_count++;
+}
+
+static int
+nop_work(void *data)
+{
+    return 0;
+}
+
+static void
+nop_done(void *data, int status)
+{
+    /* Either run or cancelled by sol_task_pool_del() */
+    ASSERT(status == 0 || status == -ECANCELED);
+    done_count++;
+}
+
+static void
+del_from_done(void *data, int status)
+{
+    struct sol_task_pool *pool = data;
+
+    ASSERT_INT_EQ(status, 0);
+
+    ASSERT(sol_task_pool_submit(pool, nop_work, nop_done, NULL));
+    done_count++;
+    sol_task_pool_del(pool);
+
+    sol_quit();
+}
+
+static bool
+check_del(void *data)
+{
+    struct sol_task_pool *pool;
+
+    done_count = 0;
+
+    pool = sol_task_pool_new(&(struct sol_task_pool_config) {
+            SOL_SET_API_VERSION(.api_version = SOL_TASK_POOL_CONFIG_API_VERSION, )
+            .threads = 1
+        });
+    ASSERT(pool);
+
+    ASSERT(sol_task_pool_submit(pool, nop_work, del_from_done, pool));
+
+    return false;
+}
+
+static bool
+check_cancel(void *data)
+{
+    struct sol_task_pool *pool = data;
+
+    if (done_count < 2)
+        return true;
+
+    sol_task_pool_del(pool);
+    sol_idle_add(check_del, NULL);
+
+    return false;
+}
+
+static bool
+check_squares(void *data)
+{
+    struct sol_task_pool *pool = data;
+    struct sol_task *running, *queued;
+
+    if (done_count < TASKS)
+        return true;
+
+    ASSERT_INT_EQ(sum, (TASKS - 1) * TASKS * (2 * TASKS - 1) / 6);
+    sol_task_pool_del(pool);
+
+    pool = sol_task_pool_new(&(struct sol_task_pool_config) {
+            SOL_SET_API_VERSION(.api_version = SOL_TASK_POOL_CONFIG_API_VERSION, )
+            .threads = 1
+        });
+    ASSERT(pool);
+    ASSERT_INT_EQ(sol_task_pool_get_thread_count(pool), 1);
+
+    done_count = 0;
+    running = sol_task_pool_submit(pool, gate_work, gate_done, NULL);
+    ASSERT(running);
+    while (!__atomic_load_n(&gate_reached, __ATOMIC_SEQ_CST))
+        usleep(100);
+
+    /* The only thread is blocked, so this one can't have started */
+    queued = sol_task_pool_submit(pool, nop_work, cancelled_done, NULL);
+    ASSERT(queued);
+    ASSERT_INT_EQ(sol_task_pool_cancel(pool, running), -EBUSY);
+    ASSERT_INT_EQ(sol_task_pool_cancel(pool, queued), 0);
+
+    __atomic_store_n(&gate_open, true, __ATOMIC_SEQ_CST);
+    sol_timeout_add(1, check_cancel, pool);
+
+    return false;
+}
+
+static bool
+perform_tests(void *data)
+{
+    struct sol_task_pool *pool;
+    unsigned int i;
+
+    pool = sol_task_pool_new(NULL);
+    ASSERT(pool);
+    ASSERT(sol_task_pool_get_thread_count(pool) > 0);
+    sol_task_pool_del(pool);
+
+    pool = sol_task_pool_new(&(struct sol_task_pool_config) {
+            SOL_SET_API_VERSION(.api_version = SOL_TASK_POOL_CONFIG_API_VERSION, )
+            .threads = 4
+        });
+    ASSERT(pool);
+    ASSERT_INT_EQ(sol_task_pool_get_thread_count(pool), 4);
+
+    for (i = 0; i < TASKS; i++) {
+        values[i] = i;
+        ASSERT(sol_task_pool_submit(pool, square_work, square_done, &values[i]));
+    }
+
+    sol_timeout_add(1, check_squares, pool);
+
+    return false;
+}
+
+int
+main(int argc, char *argv[])
+{
+    int err;
+
+    err = sol_init();
+    ASSERT(!err);
+
+    main_thread = pthread_self();
+    sol_idle_add(perform_tests, NULL);
+
+    sol_run();
+
+    ASSERT_INT_EQ(done_count, 2);
+
+    sol_shutdown();
+
+    return 0;
+}
@@ -20,10 +20,14 @@
 #include <limits.h>
 #include <stdbool.h>
 #include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #ifdef HAVE_LOCALE
 #include <locale.h>
 #endif
 
+#include "sol-util-file.h"
 #include "sol-util-internal.h"
 #include "sol-log.h"
 
@@ -366,6 +370,76 @@ test_base64_decode(void)
     ASSERT_INT_EQ(r, -EINVAL);
 }
 
+static size_t
+base64_encode_reference(char *out, const uint8_t *in, size_t len, const char *base64_map)
+{
+    uint32_t bits = 0;
+    size_t i, o = 0;
+    int nbits = 0;
+
+    for (i = 0; i < len; i++) {
+        bits = (bits << 8) | in[i];
+        for (nbits += 8; nbits >= 6; nbits -= 6)
+            out[o++] = base64_map[(bits >> (nbits - 6)) & 0x3f];
+    }
+    if (nbits > 0)
+        out[o++] = base64_map[(bits << (6 - nbits)) & 0x3f];
+    while (o % 4)
+        out[o++] = base64_map[64];
+
+    return o;
+}
+
+DEFINE_TEST(test_base64_long);
+
+static void
+test_base64_long(void)
+{
+    /* long enough for the vector versions, which work on blocks */
+    static const char *const maps[] = {
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/=",
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_.",
+        "zyxwvutsrqponmlkjihgfedcbaZYXWVUTSRQPONMLKJIHGFEDCBA9876543210!?#"
+    };
+    uint8_t input[200], decoded[200];
+    char encoded[272], expected[272];
+    ssize_t r, exp_len;
+    size_t i, len;
+
+    for (i = 0; i < sizeof(input); i++)
+        input[i] = i * 37 + 11;
+
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(maps); i++) {
+        for (len = 1; len <= sizeof(input); len++) {
+            struct sol_str_slice slice = SOL_STR_SLICE_STR((const char *)input, len);
+
+            exp_len = base64_encode_reference(expected, input, len, maps[i]);
+            r = sol_util_base64_encode(encoded, sizeof(encoded), slice, maps[i]);
+            ASSERT_INT_EQ(r, exp_len);
+            ASSERT(memcmp(encoded, expected, r) == 0);
+
+            slice = SOL_STR_SLICE_STR(encoded, r);
+            r = sol_util_base64_decode(decoded, sizeof(decoded), slice, maps[i]);
+            ASSERT_INT_EQ(r, len);
+            ASSERT(memcmp(decoded, input, len) == 0);
+        }
+    }
+
+    /* invalid char after some valid blocks */
+    r = base64_encode_reference(encoded, input, 150, maps[0]);
+    encoded[101] = '*';
+    r = sol_util_base64_decode(decoded, sizeof(decoded),
+        SOL_STR_SLICE_STR(encoded, r), maps[0]);
+    ASSERT_INT_EQ(r, -EINVAL);
+
+    /* a character of another alphabet */
+    r = base64_encode_reference(encoded, input, 150, maps[0]);
+    encoded[40] = '-';
+    r = sol_util_base64_decode(decoded, sizeof(decoded),
+        SOL_STR_SLICE_STR(encoded, r), maps[0]);
+    ASSERT_INT_EQ(r, -EINVAL);
+}
+
 DEFINE_TEST(test_base16_encode);
 
 static void
@@ -443,6 +517,63 @@ test_base16_decode(void)
     ASSERT_INT_EQ(r, -EINVAL);
 }
 
+DEFINE_TEST(test_base16_long);
+
+static void
+test_base16_long(void)
+{
+    uint8_t input[150], decoded[150];
+    char encoded[301], expected[301];
+    ssize_t r;
+    size_t i, len;
+
+    for (i = 0; i < sizeof(input); i++)
+        input[i] = i * 37 + 11;
+
+    for (len = 1; len <= sizeof(input); len++) {
+        struct sol_str_slice slice = SOL_STR_SLICE_STR((const char *)input, len);
+
+        for (i = 0; i < len; i++)
+            snprintf(expected + i * 2, 3, "%02x", input[i]);
+        r = sol_util_base16_encode(encoded, sizeof(encoded), slice, false);
+        ASSERT_INT_EQ(r, len * 2);
+        ASSERT(memcmp(encoded, expected, r) == 0);
+
+        slice = SOL_STR_SLICE_STR(encoded, r);
+        r = sol_util_base16_decode(decoded, sizeof(decoded), slice,
+            SOL_DECODE_LOWERCASE);
+        ASSERT_INT_EQ(r, len);
+        ASSERT(memcmp(decoded, input, len) == 0);
+
+        for (i = 0; i < len; i++)
+            snprintf(expected + i * 2, 3, "%02X", input[i]);
+        slice = SOL_STR_SLICE_STR((const char *)input, len);
+        r = sol_util_base16_encode(encoded, sizeof(encoded), slice, true);
+        ASSERT_INT_EQ(r, len * 2);
+        ASSERT(memcmp(encoded, expected, r) == 0);
+
+        slice = SOL_STR_SLICE_STR(encoded, r);
+        r = sol_util_base16_decode(decoded, sizeof(decoded), slice,
+            SOL_DECODE_BOTH);
+        ASSERT_INT_EQ(r, len);
+        ASSERT(memcmp(decoded, input, len) == 0);
+    }
+
+    /* mixed case after some valid blocks */
+    encoded[70] = 'a';
+    r = sol_util_base16_decode(decoded, sizeof(decoded),
+        SOL_STR_SLICE_STR(encoded, 300), SOL_DECODE_UPPERCASE);
+    ASSERT_INT_EQ(r, -EINVAL);
+    r = sol_util_base16_decode(decoded, sizeof(decoded),
+        SOL_STR_SLICE_STR(encoded, 300), SOL_DECODE_BOTH);
+    ASSERT_INT_EQ(r, 150);
+
+    encoded[90] = 'g';
+    r = sol_util_base16_decode(decoded, sizeof(decoded),
+        SOL_STR_SLICE_STR(encoded, 300), SOL_DECODE_BOTH);
+    ASSERT_INT_EQ(r, -EINVAL);
+}
+
 DEFINE_TEST(test_unicode_utf_conversion);
 
 static void
@@ -593,4 +724,55 @@ test_escape_quotes(void)
     }
 }
 
+DEFINE_TEST(test_fd_int64);
+
+static void
+test_fd_int64(void)
+{
+    static const int64_t values[] = {
+        0, 7, -7, 1234567890123LL, INT64_MAX, INT64_MIN
+    };
+    static const struct {
+        const char *str;
+        int64_t value;
+        int result;
+    } reads[] = {
+        { "42\n", 42, 0 },
+        { "  -13\n", -13, 0 },
+        { "+3", 3, 0 },
+        { "12.5\n", 12, 0 },
+        { "abc", 0, -EINVAL },
+        { "", 0, -EINVAL },
+        { "-", 0, -EINVAL },
+        { "9223372036854775808\n", 0, -EINVAL },
+        { "-9223372036854775809\n", 0, -EINVAL },
+    };
+    char path[] = "/tmp/sol-test-util-XXXXXX";
+    int64_t value;
+    size_t i;
+    int fd;
+
+    fd = mkstemp(path);
+    ASSERT(fd >= 0);
+    unlink(path);
+
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(values); i++) {
+        ASSERT_INT_EQ(ftruncate(fd, 0), 0);
+        ASSERT_INT_EQ(sol_util_fd_write_int64(fd, values[i]), 0);
+        ASSERT_INT_EQ(sol_util_fd_read_int64(fd, &value), 0);
+        ASSERT(value == values[i]);
+    }
+
+    for (i = 0; i < SOL_UTIL_ARRAY_SIZE(reads); i++) {
+        ASSERT_INT_EQ(ftruncate(fd, 0), 0);
+        ASSERT_INT_EQ(pwrite(fd, reads[i].str, strlen(reads[i].str), 0),
+            (ssize_t)strlen(reads[i].str));
+        ASSERT_INT_EQ(sol_util_fd_read_int64(fd, &value), reads[i].result);
+        if (!reads[i].result)
+            ASSERT(value == reads[i].value);
+    }
+
+    close(fd);
+}
+
 TEST_MAIN();
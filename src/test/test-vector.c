@@ -332,13 +332,13 @@ vector_append_n(void)
     ASSERT_INT_EQ(errno, EINVAL);
 
     errno = 0;
-    elem = sol_vector_append_n(v, UINT16_MAX);
+    elem = sol_vector_append_n(v, UINT32_MAX);
     ASSERT(!elem);
     ASSERT_INT_EQ(errno, EOVERFLOW);
     ASSERT_INT_EQ(v->len, 18);
 
     errno = 0;
-    elem = sol_vector_append_n(v, UINT16_MAX - v->len + 1);
+    elem = sol_vector_append_n(v, INT32_MAX - v->len + 1);
     ASSERT(!elem);
     ASSERT_INT_EQ(errno, EOVERFLOW);
     ASSERT_INT_EQ(v->len, 18);
@@ -530,4 +530,103 @@ test_ptr_vector_del(void)
     ASSERT(s == NULL);
 }
 
+DEFINE_TEST(test_vector_capacity);
+
+static void
+test_vector_capacity(void)
+{
+    struct sol_vector v = SOL_VECTOR_INIT(int);
+    void *data;
+    uint32_t i;
+
+    for (i = 0; i < 8; i++)
+        ASSERT(sol_vector_append(&v));
+    ASSERT_INT_EQ(v.len, 8);
+    ASSERT_INT_EQ(v.capacity, 8);
+
+    // Alternating around a power of two must not resize every time.
+    for (i = 0; i < 4; i++) {
+        ASSERT(sol_vector_append(&v));
+        ASSERT_INT_EQ(v.capacity, 16);
+        ASSERT_INT_EQ(sol_vector_del_last(&v), 0);
+        ASSERT_INT_EQ(v.capacity, 16);
+    }
+
+    // Only shrinks once a quarter of it is used.
+    while (v.len > 5)
+        sol_vector_del_last(&v);
+    ASSERT_INT_EQ(v.capacity, 16);
+    sol_vector_del_last(&v);
+    ASSERT_INT_EQ(v.len, 4);
+    ASSERT_INT_EQ(v.capacity, 8);
+
+    data = sol_vector_take_data(&v);
+    ASSERT(data);
+    ASSERT_INT_EQ(v.capacity, 0);
+    free(data);
+
+    ASSERT(sol_vector_append_n(&v, 5));
+    ASSERT_INT_EQ(v.capacity, 8);
+    sol_vector_clear(&v);
+    ASSERT_INT_EQ(v.len, 0);
+    ASSERT_INT_EQ(v.capacity, 0);
+}
+
+DEFINE_TEST(test_vector_large);
+
+static void
+test_vector_large(void)
+{
+    static const uint32_t N = UINT16_MAX * 2U;
+    struct sol_vector v = SOL_VECTOR_INIT(uint32_t);
+    struct sol_ptr_vector pv = SOL_PTR_VECTOR_INIT;
+    struct s *s, key;
+    uint32_t i, *elem;
+    int32_t r;
+
+    for (i = 0; i < N; i++) {
+        elem = sol_vector_append(&v);
+        ASSERT(elem);
+        *elem = i;
+    }
+    ASSERT_INT_EQ(v.len, N);
+
+    SOL_VECTOR_FOREACH_IDX (&v, elem, i) {
+        if (*elem != i)
+            break;
+    }
+    ASSERT_INT_EQ(i, N);
+
+    ASSERT_INT_EQ(sol_vector_del(&v, UINT16_MAX + 1U), 0);
+    elem = sol_vector_get(&v, UINT16_MAX + 1U);
+    ASSERT(elem);
+    ASSERT_INT_EQ(*elem, UINT16_MAX + 2U);
+    ASSERT(!sol_vector_get(&v, N - 1));
+
+    while (v.len > 0)
+        sol_vector_del_last(&v);
+    ASSERT(!v.data);
+    ASSERT_INT_EQ(v.capacity, 0);
+
+    // Sorted insertion and lookup past the old 16 bits limit.
+    for (i = 0; i < N; i += 2) {
+        r = sol_ptr_vector_insert_sorted(&pv, create_s(i), sort_cb);
+        ASSERT_INT_EQ(r, i / 2);
+    }
+    s = create_s(UINT16_MAX);
+    r = sol_ptr_vector_insert_sorted(&pv, s, sort_cb);
+    ASSERT_INT_EQ(r, UINT16_MAX / 2 + 1);
+    ASSERT_INT_EQ(sol_ptr_vector_find_sorted(&pv, s, sort_cb), r);
+
+    key.a = N - 2;
+    r = sol_ptr_vector_match_sorted(&pv, &key, sort_cb);
+    ASSERT_INT_EQ(r, N / 2);
+    s = sol_ptr_vector_get(&pv, r);
+    ASSERT_INT_EQ(s->a, N - 2);
+
+    SOL_PTR_VECTOR_FOREACH_IDX (&pv, s, i)
+        free(s);
+    sol_ptr_vector_clear(&pv);
+}
+
 TEST_MAIN();